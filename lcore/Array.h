@@ -30,11 +30,11 @@ namespace lcore
     //---
     //---
     //-------------------------------------------------------
-    template<class T, class CapacityIncrement, class isTriviallyCopyable>
+    template<class T, class CapacityIncrement, class isTriviallyRelocatable>
     class ArrayBuffer
     {
     protected:
-        typedef ArrayBuffer<T, CapacityIncrement, isTriviallyCopyable> this_type;
+        typedef ArrayBuffer<T, CapacityIncrement, isTriviallyRelocatable> this_type;
         typedef T value_type;
         typedef s32 size_type;
         typedef CapacityIncrement capacity_increment_type;
@@ -75,26 +75,30 @@ namespace lcore
             LFREE(items_);
         }
 
-        void helper_push_back(const value_type& t)
+        template<class... Args>
+        void helper_emplace_back(Args&&... args)
         {
-            if(capacity_<=size_){
-                helper_reserve(capacity_increment_type::getNewCapacity(capacity_));
-            }
-            LPLACEMENT_NEW(&items_[size_]) value_type(t);
-            ++size_;
-        }
-        void helper_push_back(value_type&& t)
-        {
-            if(capacity_<=size_){
-                helper_reserve(capacity_increment_type::getNewCapacity(capacity_));
+            if(size_<capacity_){
+                LPLACEMENT_NEW(&items_[size_]) value_type(lcore::forward<Args>(args)...);
+                ++size_;
+                return;
             }
-            LPLACEMENT_NEW(&items_[size_]) value_type(move(t));
+
+            size_type capacity = capacity_increment_type::getInitCapacity(capacity_increment_type::getNewCapacity(capacity_));
+            value_type* newItems = reinterpret_cast<value_type*>(LMALLOC(capacity*sizeof(value_type)));
+
+            //Construct new item first, because arguments may refer to old items
+            LPLACEMENT_NEW(&newItems[size_]) value_type(lcore::forward<Args>(args)...);
+            relocate(newItems);
+
+            items_ = newItems;
+            capacity_ = capacity;
             ++size_;
         }
 
         void helper_pop_back()
         {
-            ACC_ASSERT(0<size_);
+            LASSERT(0<size_);
             --size_;
             items_[size_].~value_type();
         }
@@ -115,14 +119,7 @@ namespace lcore
 
             capacity = capacity_increment_type::getInitCapacity(capacity);
             value_type* newItems = reinterpret_cast<value_type*>(LMALLOC(capacity*sizeof(value_type)));
-
-            //Copy, and destruct
-            for(s32 i = 0; i<size_; ++i){
-                LPLACEMENT_NEW(&newItems[i]) value_type(move(items_[i]));
-                items_[i].~value_type();
-            }
-
-            LFREE(items_);
+            relocate(newItems);
 
             items_ = newItems;
             capacity_ = capacity;
@@ -159,6 +156,20 @@ namespace lcore
         size_type capacity_;
         size_type size_;
         value_type* items_;
+
+    private:
+        /**
+        @brief Move items to new buffer, and release old buffer
+        */
+        void relocate(value_type* newItems)
+        {
+            //Move, and destruct
+            for(s32 i = 0; i<size_; ++i){
+                LPLACEMENT_NEW(&newItems[i]) value_type(move(items_[i]));
+                items_[i].~value_type();
+            }
+            LFREE(items_);
+        }
     };
 
 
@@ -207,26 +218,30 @@ namespace lcore
             LFREE(items_);
         }
 
-        void helper_push_back(const value_type& t)
-        {
-            if(capacity_<=size_){
-                helper_reserve(capacity_increment_type::getNewCapacity(capacity_));
-            }
-            LPLACEMENT_NEW(&items_[size_]) value_type(t);
-            ++size_;
-        }
-        void helper_push_back(value_type&& t)
+        template<class... Args>
+        void helper_emplace_back(Args&&... args)
         {
-            if(capacity_<=size_){
-                helper_reserve(capacity_increment_type::getNewCapacity(capacity_));
+            if(size_<capacity_){
+                LPLACEMENT_NEW(&items_[size_]) value_type(lcore::forward<Args>(args)...);
+                ++size_;
+                return;
             }
-            LPLACEMENT_NEW(&items_[size_]) value_type(move(t));
+
+            size_type capacity = capacity_increment_type::getInitCapacity(capacity_increment_type::getNewCapacity(capacity_));
+            value_type* newItems = reinterpret_cast<value_type*>(LMALLOC(capacity*sizeof(value_type)));
+
+            //Construct new item first, because arguments may refer to old items
+            LPLACEMENT_NEW(&newItems[size_]) value_type(lcore::forward<Args>(args)...);
+            relocate(newItems);
+
+            items_ = newItems;
+            capacity_ = capacity;
             ++size_;
         }
 
         void helper_pop_back()
         {
-            ACC_ASSERT(0<size_);
+            LASSERT(0<size_);
             --size_;
             items_[size_].~value_type();
         }
@@ -247,14 +262,7 @@ namespace lcore
 
             capacity = capacity_increment_type::getInitCapacity(capacity);
             value_type* newItems = reinterpret_cast<value_type*>(LMALLOC(capacity*sizeof(value_type)));
-
-            //Copy, and destruct
-            for(s32 i = 0; i<size_; ++i){
-                LPLACEMENT_NEW(&newItems[i]) value_type(items_[i]);
-                items_[i].~value_type();
-            }
-
-            LFREE(items_);
+            relocate(newItems);
 
             items_ = newItems;
             capacity_ = capacity;
@@ -281,16 +289,26 @@ namespace lcore
         void helper_removeAt(s32 index)
         {
             LASSERT(0<=index && index<size_);
-            for(s32 i = index+1; i<size_; ++i){
-                items_[i-1] = move(items_[i]);
-            }
+            items_[index].~value_type();
             --size_;
-            items_[size_].~value_type();
+            lcore::memmove(items_+index, items_+index+1, sizeof(value_type)*(size_-index));
         }
 
         size_type capacity_;
         size_type size_;
         value_type* items_;
+
+    private:
+        /**
+        @brief Copy bits of items to new buffer, and release old buffer. No need to destruct.
+        */
+        void relocate(value_type* newItems)
+        {
+            if(0<size_){
+                lcore::memcpy(newItems, items_, sizeof(value_type)*size_);
+            }
+            LFREE(items_);
+        }
     };
 
     //-------------------------------------------------------
@@ -299,11 +317,11 @@ namespace lcore
     //---
     //-------------------------------------------------------
     template<class T, class CapacityIncrement=ArrayStaticCapacityIncrement<> >
-    class Array : public ArrayBuffer<T, CapacityIncrement, typename std::is_trivially_copyable<T>::type>
+    class Array : public ArrayBuffer<T, CapacityIncrement, typename is_trivially_relocatable<T>::type>
     {
     public:
         typedef Array<T, CapacityIncrement> this_type;
-        typedef ArrayBuffer<T, CapacityIncrement, typename std::is_trivially_copyable<T>::type> parent_type;
+        typedef ArrayBuffer<T, CapacityIncrement, typename is_trivially_relocatable<T>::type> parent_type;
         typedef T value_type;
         typedef T* iterator;
         typedef const T* const_iterator;
@@ -333,6 +351,8 @@ namespace lcore
 
         void push_back(const T& t);
         void push_back(T&& t);
+        template<class... Args>
+        void emplace_back(Args&&... args);
         void pop_back();
 
         inline iterator begin();
@@ -437,13 +457,20 @@ namespace lcore
     template<class T, class CapacityIncrement>
     void Array<T, CapacityIncrement>::push_back(const T& t)
     {
-        helper_push_back(t);
+        helper_emplace_back(t);
     }
 
     template<class T, class CapacityIncrement>
     void Array<T, CapacityIncrement>::push_back(T&& t)
     {
-        helper_push_back(move(t));
+        helper_emplace_back(move(t));
+    }
+
+    template<class T, class CapacityIncrement>
+    template<class... Args>
+    void Array<T, CapacityIncrement>::emplace_back(Args&&... args)
+    {
+        helper_emplace_back(lcore::forward<Args>(args)...);
     }
 
     template<class T, class CapacityIncrement>
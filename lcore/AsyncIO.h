@@ -0,0 +1,215 @@
+﻿#ifndef INC_LCORE_ASYNCIO_H_
+#define INC_LCORE_ASYNCIO_H_
+/**
+@file AsyncIO.h
+@author t-sakai
+@date 2026/10/19 create
+
+非同期読み込み. Linuxではio_uringが使えればio_uring, 使えなければI/Oスレッドでpreadする.
+Windowsは常にI/Oスレッド.
+
+要求の発行, poll, completeは1つのスレッドから呼ぶ.
+VFSのファイルはFileProxyOS::readAsyncで, 開いているハンドルのまま要求を出せる. パックの中のファイルは対象外.
+*/
+#include "lcore.h"
+#include "SyncObject.h"
+
+namespace lcore
+{
+    //----------------------------------------------------
+    //---
+    //--- AsyncIO
+    //---
+    //----------------------------------------------------
+    class AsyncIO
+    {
+    public:
+#if defined(_WIN32)
+        typedef HANDLE Handle;
+#else
+        typedef s32 Handle;
+#endif
+        static const Handle InvalidHandle;
+
+        typedef u32 RequestID;
+        static const RequestID InvalidID = 0;
+
+        enum Priority
+        {
+            Priority_High = 0,
+            Priority_Normal,
+            Priority_Low,
+            Priority_Num,
+        };
+
+        enum Status
+        {
+            Status_Invalid = -1, ///< 不明なID, 解放済み
+            Status_Pending = 0, ///< 発行待ち
+            Status_Reading, ///< 読み込み中
+            Status_Done, ///< 完了
+            Status_Error, ///< 失敗. 終端を越えた読み込みを含む
+        };
+
+        enum Backend
+        {
+            Backend_None = 0,
+            Backend_IOUring,
+            Backend_Thread,
+        };
+
+        /// 読み込み先. ファイルの任意の位置から呼び出し側のバッファへ
+        struct Segment
+        {
+            s64 offset_;
+            s64 size_;
+            void* data_;
+        };
+
+        /**
+        @brief 完了通知. poll, completeを呼んだスレッドで呼ぶ
+        @param id ... 要求
+        @param status ... Status_DoneかStatus_Error
+        @param userData ... 要求時に渡した値
+        */
+        typedef void(*Callback)(RequestID id, s32 status, void* userData);
+
+        struct Param
+        {
+            s32 maxRequests_; ///< 同時に保持する要求の数
+            s32 maxInFlight_; ///< 同時にOSへ発行する読み込みの数
+            s32 numThreads_; ///< I/Oスレッドの数
+            bool disableIOUring_; ///< io_uringを使わない
+        };
+
+        static const s32 DefaultMaxRequests = 256;
+        static const s32 DefaultMaxInFlight = 32;
+        static const s32 DefaultNumThreads = 2;
+        /// 1回のOSの読み込みの最大. 大きいセグメントは分けて読む
+        static const s64 MaxIOSize = 1LL<<30;
+
+        static void getDefaultParam(Param& param);
+
+        /// 読み込み用に開く. 失敗したらInvalidHandle
+        static Handle openFile(const Char* path);
+        static void closeFile(Handle handle);
+
+        AsyncIO();
+        ~AsyncIO();
+
+        bool initialize(const Param& param);
+
+        /// 発行済みの読み込みが終わるのを待ってから解放する
+        void terminate();
+
+        inline Backend getBackend() const;
+        inline s32 getNumInFlight() const;
+
+        /**
+        @brief 読み込み要求
+        @return 要求. 空きがなければInvalidID
+        @param callback ... NULLでなければ, 通知後に要求を解放する. NULLならcompleteで解放する
+        */
+        RequestID read(Handle handle, s64 offset, s64 size, void* data, s32 priority=Priority_Normal, Callback callback=NULL, void* userData=NULL);
+
+        /**
+        @brief 分散読み込み要求. 全てのセグメントを読んだら完了
+        @return 要求. 空きがなければInvalidID
+        */
+        RequestID read(Handle handle, s32 numSegments, const Segment* segments, s32 priority=Priority_Normal, Callback callback=NULL, void* userData=NULL);
+
+        /**
+        @brief 完了を回収し, 発行待ちをOSへ発行する. ブロックしない
+        @return 前回のpollかcompleteの後に完了した要求の数. コールバックのない要求も数える
+        */
+        s32 poll();
+
+        /**
+        @brief 完了まで待って要求を解放する. コールバック付きの要求には使わない
+        @return Status_DoneかStatus_Error. 不明なIDならStatus_Invalid
+        */
+        s32 complete(RequestID id);
+
+        /// 全ての要求が完了するまで待つ
+        void completeAll();
+
+        s32 getStatus(RequestID id) const;
+    private:
+        AsyncIO(const AsyncIO&);
+        AsyncIO& operator=(const AsyncIO&);
+
+        static const s32 InlineSegments = 2;
+        static const u32 IndexBits = 16;
+        static const u32 IndexMask = (0x01U<<IndexBits)-1;
+
+        struct Request
+        {
+            u32 generation_;
+            s32 status_;
+            s32 priority_;
+            s32 next_;
+            Handle handle_;
+            Callback callback_;
+            void* userData_;
+            s32 numSegments_;
+            s32 nextSegment_; ///< 次に発行するセグメント
+            s32 numOutstanding_; ///< 発行して完了していないセグメント
+            bool error_;
+            Segment* segments_;
+            Segment inlineSegments_[InlineSegments];
+        };
+
+        /// OSへ発行する読み込み1つ
+        struct Operation
+        {
+            s32 request_;
+            s32 segment_;
+            s64 done_; ///< セグメント内で読んだバイト数
+            s64 size_; ///< 今回の読み込みのバイト数
+            s32 next_;
+            s32 result_; ///< 読んだバイト数, 負ならエラー
+        };
+
+        class Driver;
+        class DriverIOUring;
+        class DriverThread;
+
+        s32 getRequestIndex(RequestID id) const;
+        void skipEmptySegments(Request& request);
+        void pushPending(s32 index);
+        void popPending(s32 priority);
+        void dispatch();
+        void finishOperation(s32 index);
+        void notify(s32 index);
+        s32 step(bool wait);
+        void releaseRequest(s32 index);
+
+        Backend backend_;
+        s32 maxRequests_;
+        s32 maxInFlight_;
+        s32 numInFlight_;
+        s32 numActive_; ///< 完了していない要求の数
+        s32 numCompleted_; ///< 前回のstepの後に完了した要求の数
+        Request* requests_;
+        s32 freeRequests_;
+        Operation* operations_;
+        s32 freeOperations_;
+        s32* completed_;
+        s32 pendingHead_[Priority_Num];
+        s32 pendingTail_[Priority_Num];
+        s32 notifyHead_; ///< コールバック待ち
+        s32 notifyTail_;
+        Driver* driver_;
+    };
+
+    inline AsyncIO::Backend AsyncIO::getBackend() const
+    {
+        return backend_;
+    }
+
+    inline s32 AsyncIO::getNumInFlight() const
+    {
+        return numInFlight_;
+    }
+}
+#endif //INC_LCORE_ASYNCIO_H_
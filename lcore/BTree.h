@@ -0,0 +1,935 @@
+﻿#ifndef INC_LCORE_BTREE_H_
+#define INC_LCORE_BTREE_H_
+/**
+@file BTree.h
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "lcore.h"
+#include "ObjectAllocator.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define LCORE_BTREE_SSE 1
+#endif
+
+namespace lcore
+{
+namespace btree_detail
+{
+    //---------------------------------------------------------------
+    //---
+    //--- NodeSearch
+    //---
+    //---------------------------------------------------------------
+    /**
+    @brief ノード内のキー探索
+    */
+    template<class Key, class Comparator>
+    struct NodeSearch
+    {
+        /// key未満のキー数
+        static s32 lowerBound(const Key* keys, s32 count, const Key& key, const Comparator& comparator)
+        {
+            s32 first = 0;
+            while(0<count){
+                s32 half = count>>1;
+                if(comparator(keys[first+half], key)<0){
+                    first += half+1;
+                    count -= half+1;
+                }else{
+                    count = half;
+                }
+            }
+            return first;
+        }
+
+        /// key以下のキー数
+        static s32 upperBound(const Key* keys, s32 count, const Key& key, const Comparator& comparator)
+        {
+            s32 first = 0;
+            while(0<count){
+                s32 half = count>>1;
+                if(comparator(keys[first+half], key)<=0){
+                    first += half+1;
+                    count -= half+1;
+                }else{
+                    count = half;
+                }
+            }
+            return first;
+        }
+    };
+
+#if defined(LCORE_BTREE_SSE)
+    /**
+    @brief 4キーずつ比較する。キーは昇順なので、比較結果のマスクは先頭から連続する
+    @param bias ... 符号なしを符号付きで比較するためのxor
+    */
+    template<s32 Bias>
+    struct NodeSearchSSE32
+    {
+        static s32 lowerBound(const s32* keys, s32 count, s32 key)
+        {
+            __m128i bias = _mm_set1_epi32(Bias);
+            __m128i k = _mm_xor_si128(_mm_set1_epi32(key), bias);
+            s32 i=0;
+            for(; (i+4)<=count; i+=4){
+                __m128i v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys+i)), bias);
+                u32 mask = static_cast<u32>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(v, k))));
+                if(0x0FU != mask){
+                    return i + populationCount(static_cast<u8>(mask));
+                }
+            }
+            key ^= Bias;
+            for(; i<count; ++i){
+                if(key <= (keys[i]^Bias)){
+                    break;
+                }
+            }
+            return i;
+        }
+
+        static s32 upperBound(const s32* keys, s32 count, s32 key)
+        {
+            __m128i bias = _mm_set1_epi32(Bias);
+            __m128i k = _mm_xor_si128(_mm_set1_epi32(key), bias);
+            s32 i=0;
+            for(; (i+4)<=count; i+=4){
+                __m128i v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys+i)), bias);
+                u32 mask = static_cast<u32>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(v, k)))) ^ 0x0FU;
+                if(0x0FU != mask){
+                    return i + populationCount(static_cast<u8>(mask));
+                }
+            }
+            key ^= Bias;
+            for(; i<count; ++i){
+                if(key < (keys[i]^Bias)){
+                    break;
+                }
+            }
+            return i;
+        }
+    };
+
+    template<>
+    struct NodeSearch<s32, DefaultComparator<s32> >
+    {
+        static s32 lowerBound(const s32* keys, s32 count, s32 key, const DefaultComparator<s32>&)
+        {
+            return NodeSearchSSE32<0>::lowerBound(keys, count, key);
+        }
+
+        static s32 upperBound(const s32* keys, s32 count, s32 key, const DefaultComparator<s32>&)
+        {
+            return NodeSearchSSE32<0>::upperBound(keys, count, key);
+        }
+    };
+
+    template<>
+    struct NodeSearch<u32, DefaultComparator<u32> >
+    {
+        static const s32 Bias = static_cast<s32>(0x80000000U);
+
+        static s32 lowerBound(const u32* keys, s32 count, u32 key, const DefaultComparator<u32>&)
+        {
+            return NodeSearchSSE32<Bias>::lowerBound(reinterpret_cast<const s32*>(keys), count, static_cast<s32>(key));
+        }
+
+        static s32 upperBound(const u32* keys, s32 count, u32 key, const DefaultComparator<u32>&)
+        {
+            return NodeSearchSSE32<Bias>::upperBound(reinterpret_cast<const s32*>(keys), count, static_cast<s32>(key));
+        }
+    };
+
+    template<>
+    struct NodeSearch<f32, DefaultComparator<f32> >
+    {
+        static s32 lowerBound(const f32* keys, s32 count, f32 key, const DefaultComparator<f32>&)
+        {
+            __m128 k = _mm_set1_ps(key);
+            s32 i=0;
+            for(; (i+4)<=count; i+=4){
+                u32 mask = static_cast<u32>(_mm_movemask_ps(_mm_cmplt_ps(_mm_loadu_ps(keys+i), k)));
+                if(0x0FU != mask){
+                    return i + populationCount(static_cast<u8>(mask));
+                }
+            }
+            for(; i<count; ++i){
+                if(key <= keys[i]){
+                    break;
+                }
+            }
+            return i;
+        }
+
+        static s32 upperBound(const f32* keys, s32 count, f32 key, const DefaultComparator<f32>&)
+        {
+            __m128 k = _mm_set1_ps(key);
+            s32 i=0;
+            for(; (i+4)<=count; i+=4){
+                u32 mask = static_cast<u32>(_mm_movemask_ps(_mm_cmple_ps(_mm_loadu_ps(keys+i), k)));
+                if(0x0FU != mask){
+                    return i + populationCount(static_cast<u8>(mask));
+                }
+            }
+            for(; i<count; ++i){
+                if(key < keys[i]){
+                    break;
+                }
+            }
+            return i;
+        }
+    };
+#endif
+}
+
+    //---------------------------------------------------------------
+    //---
+    //--- BTreeMap
+    //---
+    //---------------------------------------------------------------
+    /**
+    @brief B+木による順序付きマップ
+
+    ノードはNodeBytes（キャッシュラインの倍数）に収まるように要素数を決め、ObjectAllocatorから確保する。
+    要素は葉にのみ置き、葉は双方向リストでつなぐ。キーと値はmemcpyで移動するので、trivially relocatableであること。
+    */
+    template<class Key, class Value, class Comparator=DefaultComparator<Key>, s32 NodeBytes=256>
+    class BTreeMap
+    {
+        LSTATIC_ASSERT(is_trivially_relocatable<Key>::value, "BTreeMap requires trivially relocatable key");
+        LSTATIC_ASSERT(is_trivially_relocatable<Value>::value, "BTreeMap requires trivially relocatable value");
+    public:
+        typedef BTreeMap<Key, Value, Comparator, NodeBytes> this_type;
+        typedef Key key_type;
+        typedef Value value_type;
+        typedef Comparator comparator_type;
+        typedef s32 size_type;
+        typedef btree_detail::NodeSearch<Key, Comparator> search_type;
+
+        static const s32 CacheLineSize = 64;
+        static const s32 DefaultPageSize = 16*1024;
+
+        static const s32 InternalCapacity = ((NodeBytes-CacheLineSize/8-static_cast<s32>(sizeof(void*)))/static_cast<s32>(sizeof(Key)+sizeof(void*))<3)
+            ? 3 : (NodeBytes-CacheLineSize/8-static_cast<s32>(sizeof(void*)))/static_cast<s32>(sizeof(Key)+sizeof(void*));
+        static const s32 LeafCapacity = ((NodeBytes-CacheLineSize/8-2*static_cast<s32>(sizeof(void*)))/static_cast<s32>(sizeof(Key)+sizeof(Value))<3)
+            ? 3 : (NodeBytes-CacheLineSize/8-2*static_cast<s32>(sizeof(void*)))/static_cast<s32>(sizeof(Key)+sizeof(Value));
+        static const s32 MinInternalCount = InternalCapacity/2;
+        static const s32 MinLeafCount = LeafCapacity/2;
+
+    private:
+        struct Node
+        {
+            s32 count_; /// キー数
+        };
+
+        struct LALIGN(64) Internal : public Node
+        {
+            Key keys_[InternalCapacity]; /// keys_[i]はchildren_[i+1]以下の最小キー以下
+            void* children_[InternalCapacity+1]; /// count_+1個
+        };
+
+        struct LALIGN(64) Leaf : public Node
+        {
+            Leaf* prev_;
+            Leaf* next_;
+            Key keys_[LeafCapacity];
+            Value values_[LeafCapacity];
+        };
+
+    public:
+        class Iterator
+        {
+        public:
+            Iterator()
+                :leaf_(NULL)
+                ,index_(0)
+            {}
+
+            inline bool operator==(const Iterator& rhs) const{ return leaf_ == rhs.leaf_ && index_ == rhs.index_;}
+            inline bool operator!=(const Iterator& rhs) const{ return leaf_ != rhs.leaf_ || index_ != rhs.index_;}
+
+            inline Iterator& operator++()
+            {
+                LASSERT(NULL != leaf_);
+                if(leaf_->count_ <= ++index_){
+                    leaf_ = leaf_->next_;
+                    index_ = 0;
+                }
+                return *this;
+            }
+
+            inline const Key& getKey() const{ return leaf_->keys_[index_];}
+            inline Value& getValue() const{ return leaf_->values_[index_];}
+        private:
+            friend class BTreeMap;
+
+            Iterator(Leaf* leaf, s32 index)
+                :leaf_(leaf)
+                ,index_(index)
+            {}
+
+            Leaf* leaf_;
+            s32 index_;
+        };
+
+        typedef Iterator iterator;
+
+        BTreeMap();
+        explicit BTreeMap(s32 pageSize);
+        ~BTreeMap();
+
+        inline size_type size() const{ return size_;}
+        inline bool empty() const{ return 0 == size_;}
+        /// 根から葉までの段数。空なら-1
+        inline s32 getHeight() const{ return (NULL == root_)? -1 : height_;}
+
+        Value* find(const Key& key);
+        const Value* find(const Key& key) const;
+
+        /**
+        @brief 挿入
+        @return キーがすでにあればfalse
+        */
+        bool insert(const Key& key, const Value& value);
+
+        /**
+        @brief 削除
+        @return キーがなければfalse
+        */
+        bool erase(const Key& key);
+
+        void clear();
+
+        /**
+        @brief ソート済みの入力から一括構築。キーは狭義単調増加であること
+        @param leafFill ... 葉あたりの要素数の目安
+        */
+        void bulkLoad(const Key* keys, const Value* values, s32 count, s32 leafFill=LeafCapacity);
+
+        inline iterator begin(){ return iterator(head_, 0);}
+        inline iterator end(){ return iterator();}
+
+        /// key以上の最初の要素
+        iterator lowerBound(const Key& key);
+
+        /// keyより大きい最初の要素
+        iterator upperBound(const Key& key);
+
+        /**
+        @brief [first, last)の要素をfunc(key, value)で列挙
+        @return 列挙した要素数
+        */
+        template<class Func>
+        s32 traverse(const Key& first, const Key& last, Func& func);
+
+        /// 構造の検証
+        bool check() const;
+
+        void swap(this_type& rhs);
+    private:
+        BTreeMap(const this_type&) = delete;
+        this_type& operator=(const this_type&) = delete;
+
+        enum InsertResult
+        {
+            Insert_Exists = 0,
+            Insert_Inserted,
+            Insert_Split,
+        };
+
+        inline Leaf* createLeaf()
+        {
+            Leaf* leaf = LPLACEMENT_NEW(leafAllocator_.allocate()) Leaf;
+            leaf->count_ = 0;
+            leaf->prev_ = leaf->next_ = NULL;
+            return leaf;
+        }
+
+        inline Internal* createInternal()
+        {
+            Internal* internal = LPLACEMENT_NEW(internalAllocator_.allocate()) Internal;
+            internal->count_ = 0;
+            return internal;
+        }
+
+        inline void destroyLeaf(Leaf* leaf){ leafAllocator_.deallocate(leaf);}
+        inline void destroyInternal(Internal* internal){ internalAllocator_.deallocate(internal);}
+
+        Leaf* findLeaf(const Key& key) const;
+        s32 insertRecursive(void* node, s32 level, const Key& key, const Value& value, Key& splitKey, void*& splitNode);
+        bool eraseRecursive(void* node, s32 level, const Key& key);
+        void rebalanceLeaf(Internal* parent, s32 index);
+        void rebalanceInternal(Internal* parent, s32 index);
+        static void removeEntry(Internal* parent, s32 index);
+        void clearRecursive(void* node, s32 level);
+        bool checkRecursive(const void* node, s32 level, const Key* lower, const Key* upper, s32& count) const;
+
+        static s32 calcNumNodes(s32 count, s32 fill, s32 minCount, s32 maxCount);
+
+        void* root_;
+        Leaf* head_;
+        s32 height_;
+        size_type size_;
+        comparator_type comparator_;
+        ObjectAllocator<Leaf> leafAllocator_;
+        ObjectAllocator<Internal> internalAllocator_;
+    };
+
+    template<class Key, class Value, class Comparator, s32 NodeBytes>
+    BTreeMap<Key, Value, Comparator, NodeBytes>::BTreeMap()
+        :root_(NULL)
+        ,head_(NULL)
+        ,height_(0)
+        ,size_(0)
+    {
+        leafAllocator_.initialize(DefaultPageSize);
+        internalAllocator_.initialize(DefaultPageSize);
+    }
+
+    template<class Key, class Value, class Comparator, s32 NodeBytes>
+    BTreeMap<Key, Value, Comparator, NodeBytes>::BTreeMap(s32 pageSize)
+        :root_(NULL)
+        ,head_(NULL)
+        ,height_(0)
+        ,size_(0)
+    {
+        leafAllocator_.initialize(pageSize);
+        internalAllocator_.initialize(pageSize);
+    }
+
+    template<class Key, class Value, class Comparator, s32 NodeBytes>
+    BTreeMap<Key, Value, Comparator, NodeBytes>::~BTreeMap()
+    {
+        clear();
+        internalAllocator_.terminate();
+        leafAllocator_.terminate();
+    }
+
+    template<class Key, class Value, class Comparator, s32 NodeBytes>
+    typename BTreeMap<Key, Value, Comparator, NodeBytes>::Leaf*
+        BTreeMap<Key, Value, Comparator, NodeBytes>::findLeaf(const Key& key) const
+    {
+        void* node = root_;
+        for(s32 level=height_; 0<level; --level){
+            const Internal* internal = static_cast<const Internal*>(node);
+            s32 index = search_type::upperBound(internal->keys_, internal->count_, key, comparator_);
+            node = internal->children_[index];
+        }
+        return static_cast<Leaf*>(node);
+    }
+
+    template<class Key, class Value, class Comparator, s32 NodeBytes>
+    Value* BTreeMap<Key, Value, Comparator, NodeBytes>::find(const Key& key)
+    {
+        if(NULL == root_){
+            return NULL;
+        }
+        Leaf* leaf = findLeaf(key);
+        s32 index = search_type::lowerBound(leaf->keys_, leaf->count_, key, comparator_);
+        return (index<leaf->count_ && 0 == comparator_(leaf->keys_[index], key))? &leaf->values_[index] : NULL;
+    }
+
+    template<class Key, class Value, class Comparator, s32 NodeBytes>
+    const Value* BTreeMap<Key, Value, Comparator, NodeBytes>::find(const Key& key) const
+    {
+        return const_cast<this_type*>(this)->find(key);
+    }
+
+    template<class Key, class Value, class Comparator, s32 NodeBytes>
+    bool BTreeMap<Key, Value, Comparator, NodeBytes>::insert(const Key& key, const Value& value)
+    {
+        if(NULL == root_){
+            Leaf* leaf = createLeaf();
+            leaf->keys_[0] = key;
+            leaf->values_[0] = value;
+            leaf->count_ = 1;
+            root_ = head_ = leaf;
+            height_ = 0;
+            size_ = 1;
+            return true;
+        }
+
+        Key splitKey;
+        void* splitNode = NULL;
+        s32 result = insertRecursive(root_, height_, key, value, splitKey, splitNode);
+        if(Insert_Exists == result){
+            return false;
+        }
+        if(Insert_Split == result){
+            Internal* root = createInternal();
+            root->count_ = 1;
+            root->keys_[0] = splitKey;
+            root->children_[0] = root_;
+            root->children_[1] = splitNode;
+            root_ = root;
+            ++height_;
+        }
+        ++size_;
+        return true;
+    }
+
+    template<class Key, class Value, class Comparator, s32 NodeBytes>
+    s32 BTreeMap<Key, Value, Comparator, NodeBytes>::insertRecursive(void* node, s32 level, const Key& key, const Value& value, Key& splitKey, void*& splitNode)
+    {
+        if(0 == level){
+            Leaf* leaf = static_cast<Leaf*>(node);
+            s32 pos = search_type::lowerBound(leaf->keys_, leaf->count_, key, comparator_);
+            if(pos<leaf->count_ && 0 == comparator_(leaf->keys_[pos], key)){
+                return Insert_Exists;
+            }
+
+            Leaf* target = leaf;
+            if(LeafCapacity <= leaf->count_){
+                //Split, both halves keep at least MinLeafCount after inserting
+                Leaf* right = createLeaf();
+                s32 left = (LeafCapacity+2)>>1;
+                s32 moveFrom = (pos<left)? left-1 : left;
+                right->count_ = LeafCapacity - moveFrom;
+                lcore::memcpy(right->keys_, leaf->keys_+moveFrom, sizeof(Key)*right->count_);
+                lcore::memcpy(right->values_, leaf->values_+moveFrom, sizeof(Value)*right->count_);
+                leaf->count_ = moveFrom;
+
+                right->prev_ = leaf;
+                right->next_ = leaf->next_;
+                if(NULL != leaf->next_){
+                    leaf->next_->prev_ = right;
+                }
+                leaf->next_ = right;
+
+                if(moveFrom<=pos){
+                    target = right;
+                    pos -= moveFrom;
+                }
+                splitNode = right;
+            }
+
+            s32 count = target->count_-pos;
+            lcore::memmove(target->keys_+pos+1, target->keys_+pos, sizeof(Key)*count);
+            lcore::memmove(target->values_+pos+1, target->values_+pos, sizeof(Value)*count);
+            target->keys_[pos] = key;
+            target->values_[pos] = value;
+            ++target->count_;
+
+            if(target != leaf || NULL != splitNode){
+                splitKey = static_cast<Leaf*>(splitNode)->keys_[0];
+                return Insert_Split;
+            }
+            return Insert_Inserted;
+        }
+
+        Internal* internal = static_cast<Internal*>(node);
+        s32 index = search_type::upperBound(internal->keys_, internal->count_, key, comparator_);
+        Key childKey;
+        void* childNode = NULL;
+        s32 result = insertRecursive(internal->children_[index], level-1, key, value, childKey, childNode);
+        if(Insert_Split != result){
+            return result;
+        }
+
+        if(internal->count_<InternalCapacity){
+            s32 count = internal->count_-index;
+            lcore::memmove(internal->keys_+index+1, internal->keys_+index, sizeof(Key)*count);
+            lcore::memmove(internal->children_+index+2, internal->children_+index+1, sizeof(void*)*count);
+            internal->keys_[index] = childKey;
+            internal->children_[index+1] = childNode;
+            ++internal->count_;
+            return Insert_Inserted;
+        }
+
+        //Split, the middle key moves up
+        Key keys[InternalCapacity+1];
+        void* children[InternalCapacity+2];
+        lcore::memcpy(keys, internal->keys_, sizeof(Key)*index);
+        keys[index] = childKey;
+        lcore::memcpy(keys+index+1, internal->keys_+index, sizeof(Key)*(InternalCapacity-index));
+        lcore::memcpy(children, internal->children_, sizeof(void*)*(index+1));
+        children[index+1] = childNode;
+        lcore::memcpy(children+index+2, internal->children_+index+1, sizeof(void*)*(InternalCapacity-index));
+
+        static const s32 Total = InternalCapacity+1;
+        static const s32 Left = Total>>1;
+        Internal* right = createInternal();
+        lcore::memcpy(internal->keys_, keys, sizeof(Key)*Left);
+        lcore::memcpy(internal->children_, children, sizeof(void*)*(Left+1));
+        internal->count_ = Left;
+
+        right->count_ = Total-Left-1;
+        lcore::memcpy(right->keys_, keys+Left+1, sizeof(Key)*right->count_);
+        lcore::memcpy(right->children_, children+Left+1, sizeof(void*)*(right->count_+1));
+
+        splitKey = keys[Left];
+        splitNode = right;
+        return Insert_Split;
+    }
+
+    template<class Key, class Value, class Comparator, s32 NodeBytes>
+    bool BTreeMap<Key, Value, Comparator, NodeBytes>::erase(const Key& key)
+    {
+        if(NULL == root_ || !eraseRecursive(root_, height_, key)){
+            return false;
+        }
+        --size_;
+        if(0<height_){
+            Internal* root = static_cast<Internal*>(root_);
+            if(root->count_<=0){
+                root_ = root->children_[0];
+                destroyInternal(root);
+                --height_;
+            }
+        }else{
+            Leaf* root = static_cast<Leaf*>(root_);
+            if(root->count_<=0){
+                destroyLeaf(root);
+                root_ = head_ = NULL;
+            }
+        }
+        return true;
+    }
+
+    template<class Key, class Value, class Comparator, s32 NodeBytes>
+    bool BTreeMap<Key, Value, Comparator, NodeBytes>::eraseRecursive(void* node, s32 level, const Key& key)
+    {
+        if(0 == level){
+            Leaf* leaf = static_cast<Leaf*>(node);
+            s32 pos = search_type::lowerBound(leaf->keys_, leaf->count_, key, comparator_);
+            if(leaf->count_<=pos || 0 != comparator_(leaf->keys_[pos], key)){
+                return false;
+            }
+            s32 count = leaf->count_-pos-1;
+            lcore::memmove(leaf->keys_+pos, leaf->keys_+pos+1, sizeof(Key)*count);
+            lcore::memmove(leaf->values_+pos, leaf->values_+pos+1, sizeof(Value)*count);
+            --leaf->count_;
+            return true;
+        }
+
+        Internal* internal = static_cast<Internal*>(node);
+        s32 index = search_type::upperBound(internal->keys_, internal->count_, key, comparator_);
+        if(!eraseRecursive(internal->children_[index], level-1, key)){
+            return false;
+        }
+        if(1 == level){
+            if(static_cast<Leaf*>(internal->children_[index])->count_<MinLeafCount){
+                rebalanceLeaf(internal, index);
+            }
+        }else{
+            if(static_cast<Internal*>(internal->children_[index])->count_<MinInternalCount){
+                rebalanceInternal(internal, index);
+            }
+        }
+        return true;
+    }
+
+    template<class Key, class Value, class Comparator, s32 NodeBytes>
+    void BTreeMap<Key, Value, Comparator, NodeBytes>::rebalanceLeaf(Internal* parent, s32 index)
+    {
+        Leaf* child = static_cast<Leaf*>(parent->children_[index]);
+        if(0<index){
+            Leaf* left = static_cast<Leaf*>(parent->children_[index-1]);
+            if(MinLeafCount<left->count_){
+                lcore::memmove(child->keys_+1, child->keys_, sizeof(Key)*child->count_);
+                lcore::memmove(child->values_+1, child->values_, sizeof(Value)*child->count_);
+                --left->count_;
+                child->keys_[0] = left->keys_[left->count_];
+                child->values_[0] = left->values_[left->count_];
+                ++child->count_;
+                parent->keys_[index-1] = child->keys_[0];
+                return;
+            }
+        }
+        if(index<parent->count_){
+            Leaf* right = static_cast<Leaf*>(parent->children_[index+1]);
+            if(MinLeafCount<right->count_){
+                child->keys_[child->count_] = right->keys_[0];
+                child->values_[child->count_] = right->values_[0];
+                ++child->count_;
+                --right->count_;
+                lcore::memmove(right->keys_, right->keys_+1, sizeof(Key)*right->count_);
+                lcore::memmove(right->values_, right->values_+1, sizeof(Value)*right->count_);
+                parent->keys_[index] = right->keys_[0];
+                return;
+            }
+        }
+
+        //Merge into the left one
+        s32 leftIndex = (0<index)? index-1 : index;
+        Leaf* left = static_cast<Leaf*>(parent->children_[leftIndex]);
+        Leaf* right = static_cast<Leaf*>(parent->children_[leftIndex+1]);
+        lcore::memcpy(left->keys_+left->count_, right->keys_, sizeof(Key)*right->count_);
+        lcore::memcpy(left->values_+left->count_, right->values_, sizeof(Value)*right->count_);
+        left->count_ += right->count_;
+        left->next_ = right->next_;
+        if(NULL != right->next_){
+            right->next_->prev_ = left;
+        }
+        destroyLeaf(right);
+        removeEntry(parent, leftIndex);
+    }
+
+    template<class Key, class Value, class Comparator, s32 NodeBytes>
+    void BTreeMap<Key, Value, Comparator, NodeBytes>::rebalanceInternal(Internal* parent, s32 index)
+    {
+        Internal* child = static_cast<Internal*>(parent->children_[index]);
+        if(0<index){
+            Internal* left = static_cast<Internal*>(parent->children_[index-1]);
+            if(MinInternalCount<left->count_){
+                lcore::memmove(child->keys_+1, child->keys_, sizeof(Key)*child->count_);
+                lcore::memmove(child->children_+1, child->children_, sizeof(void*)*(child->count_+1));
+                child->keys_[0] = parent->keys_[index-1];
+                child->children_[0] = left->children_[left->count_];
+                ++child->count_;
+                --left->count_;
+                parent->keys_[index-1] = left->keys_[left->count_];
+                return;
+            }
+        }
+        if(index<parent->count_){
+            Internal* right = static_cast<Internal*>(parent->children_[index+1]);
+            if(MinInternalCount<right->count_){
+                child->keys_[child->count_] = parent->keys_[index];
+                child->children_[child->count_+1] = right->children_[0];
+                ++child->count_;
+                parent->keys_[index] = right->keys_[0];
+                --right->count_;
+                lcore::memmove(right->keys_, right->keys_+1, sizeof(Key)*right->count_);
+                lcore::memmove(right->children_, right->children_+1, sizeof(void*)*(right->count_+1));
+                return;
+            }
+        }
+
+        //Merge into the left one, the separator moves down
+        s32 leftIndex = (0<index)? index-1 : index;
+        Internal* left = static_cast<Internal*>(parent->children_[leftIndex]);
+        Internal* right = static_cast<Internal*>(parent->children_[leftIndex+1]);
+        left->keys_[left->count_] = parent->keys_[leftIndex];
+        lcore::memcpy(left->keys_+left->count_+1, right->keys_, sizeof(Key)*right->count_);
+        lcore::memcpy(left->children_+left->count_+1, right->children_, sizeof(void*)*(right->count_+1));
+        left->count_ += right->count_+1;
+        destroyInternal(right);
+        removeEntry(parent, leftIndex);
+    }
+
+    template<class Key, class Value, class Comparator, s32 NodeBytes>
+    void BTreeMap<Key, Value, Comparator, NodeBytes>::removeEntry(Internal* parent, s32 index)
+    {
+        s32 count = parent->count_-index-1;
+        lcore::memmove(parent->keys_+index, parent->keys_+index+1, sizeof(Key)*count);
+        lcore::memmove(parent->children_+index+1, parent->children_+index+2, sizeof(void*)*count);
+        --parent->count_;
+    }
+
+    template<class Key, class Value, class Comparator, s32 NodeBytes>
+    void BTreeMap<Key, Value, Comparator, NodeBytes>::clear()
+    {
+        if(NULL != root_){
+            clearRecursive(root_, height_);
+        }
+        root_ = head_ = NULL;
+        height_ = 0;
+        size_ = 0;
+    }
+
+    template<class Key, class Value, class Comparator, s32 NodeBytes>
+    void BTreeMap<Key, Value, Comparator, NodeBytes>::clearRecursive(void* node, s32 level)
+    {
+        if(0 == level){
+            destroyLeaf(static_cast<Leaf*>(node));
+            return;
+        }
+        Internal* internal = static_cast<Internal*>(node);
+        for(s32 i=0; i<=internal->count_; ++i){
+            clearRecursive(internal->children_[i], level-1);
+        }
+        destroyInternal(internal);
+    }
+
+    template<class Key, class Value, class Comparator, s32 NodeBytes>
+    s32 BTreeMap<Key, Value, Comparator, NodeBytes>::calcNumNodes(s32 count, s32 fill, s32 minCount, s32 maxCount)
+    {
+        s32 num = (count+fill-1)/fill;
+        s32 lower = (count+maxCount-1)/maxCount;
+        s32 upper = maximum(count/maximum(minCount, 1), 1);
+        return clamp(num, lower, upper);
+    }
+
+    template<class Key, class Value, class Comparator, s32 NodeBytes>
+    void BTreeMap<Key, Value, Comparator, NodeBytes>::bulkLoad(const Key* keys, const Value* values, s32 count, s32 leafFill)
+    {
+        LASSERT(0<=count);
+        clear();
+        if(count<=0){
+            return;
+        }
+        LASSERT(NULL != keys);
+        LASSERT(NULL != values);
+        leafFill = clamp(leafFill, 1, static_cast<s32>(LeafCapacity));
+
+        //Leaves, distribute evenly so that every leaf keeps the minimum
+        s32 numNodes = calcNumNodes(count, leafFill, MinLeafCount, LeafCapacity);
+        void** nodes = reinterpret_cast<void**>(LMALLOC(sizeof(void*)*numNodes));
+        Key* firstKeys = reinterpret_cast<Key*>(LMALLOC(sizeof(Key)*numNodes));
+        s32 offset = 0;
+        Leaf* prev = NULL;
+        for(s32 i=0; i<numNodes; ++i){
+            s32 n = count/numNodes + ((i<(count%numNodes))? 1 : 0);
+            Leaf* leaf = createLeaf();
+            lcore::memcpy(leaf->keys_, keys+offset, sizeof(Key)*n);
+            lcore::memcpy(leaf->values_, values+offset, sizeof(Value)*n);
+            leaf->count_ = n;
+            leaf->prev_ = prev;
+            if(NULL != prev){
+                prev->next_ = leaf;
+            }
+            prev = leaf;
+            nodes[i] = leaf;
+            firstKeys[i] = keys[offset];
+            offset += n;
+        }
+        head_ = static_cast<Leaf*>(nodes[0]);
+        height_ = 0;
+
+        //Upper levels are built in place
+        while(1<numNodes){
+            s32 numParents = calcNumNodes(numNodes, InternalCapacity+1, MinInternalCount+1, InternalCapacity+1);
+            s32 src = 0;
+            for(s32 i=0; i<numParents; ++i){
+                s32 n = numNodes/numParents + ((i<(numNodes%numParents))? 1 : 0);
+                Internal* internal = createInternal();
+                internal->children_[0] = nodes[src];
+                for(s32 j=1; j<n; ++j){
+                    internal->keys_[j-1] = firstKeys[src+j];
+                    internal->children_[j] = nodes[src+j];
+                }
+                internal->count_ = n-1;
+                firstKeys[i] = firstKeys[src];
+                nodes[i] = internal;
+                src += n;
+            }
+            numNodes = numParents;
+            ++height_;
+        }
+        root_ = nodes[0];
+        size_ = count;
+        LFREE(firstKeys);
+        LFREE(nodes);
+    }
+
+    template<class Key, class Value, class Comparator, s32 NodeBytes>
+    typename BTreeMap<Key, Value, Comparator, NodeBytes>::iterator
+        BTreeMap<Key, Value, Comparator, NodeBytes>::lowerBound(const Key& key)
+    {
+        if(NULL == root_){
+            return end();
+        }
+        Leaf* leaf = findLeaf(key);
+        s32 index = search_type::lowerBound(leaf->keys_, leaf->count_, key, comparator_);
+        return (index<leaf->count_)? iterator(leaf, index) : iterator(leaf->next_, 0);
+    }
+
+    template<class Key, class Value, class Comparator, s32 NodeBytes>
+    typename BTreeMap<Key, Value, Comparator, NodeBytes>::iterator
+        BTreeMap<Key, Value, Comparator, NodeBytes>::upperBound(const Key& key)
+    {
+        if(NULL == root_){
+            return end();
+        }
+        Leaf* leaf = findLeaf(key);
+        s32 index = search_type::upperBound(leaf->keys_, leaf->count_, key, comparator_);
+        return (index<leaf->count_)? iterator(leaf, index) : iterator(leaf->next_, 0);
+    }
+
+    template<class Key, class Value, class Comparator, s32 NodeBytes>
+    template<class Func>
+    s32 BTreeMap<Key, Value, Comparator, NodeBytes>::traverse(const Key& first, const Key& last, Func& func)
+    {
+        s32 count = 0;
+        for(iterator itr = lowerBound(first); itr != end(); ++itr){
+            if(0 <= comparator_(itr.getKey(), last)){
+                break;
+            }
+            func(itr.getKey(), itr.getValue());
+            ++count;
+        }
+        return count;
+    }
+
+    template<class Key, class Value, class Comparator, s32 NodeBytes>
+    bool BTreeMap<Key, Value, Comparator, NodeBytes>::check() const
+    {
+        if(NULL == root_){
+            return 0 == size_ && NULL == head_;
+        }
+        s32 count = 0;
+        if(!checkRecursive(root_, height_, NULL, NULL, count) || count != size_){
+            return false;
+        }
+
+        //Leaf chain is ordered and covers all elements
+        count = 0;
+        const Leaf* prev = NULL;
+        for(const Leaf* leaf = head_; NULL != leaf; leaf = leaf->next_){
+            if(leaf->prev_ != prev){
+                return false;
+            }
+            if(NULL != prev && 0 <= comparator_(prev->keys_[prev->count_-1], leaf->keys_[0])){
+                return false;
+            }
+            count += leaf->count_;
+            prev = leaf;
+        }
+        return count == size_;
+    }
+
+    template<class Key, class Value, class Comparator, s32 NodeBytes>
+    bool BTreeMap<Key, Value, Comparator, NodeBytes>::checkRecursive(const void* node, s32 level, const Key* lower, const Key* upper, s32& count) const
+    {
+        bool isRoot = (node == root_);
+        if(0 == level){
+            const Leaf* leaf = static_cast<const Leaf*>(node);
+            if(leaf->count_<=0 || LeafCapacity<leaf->count_ || (!isRoot && leaf->count_<MinLeafCount)){
+                return false;
+            }
+            for(s32 i=0; i<leaf->count_; ++i){
+                if(0<i && 0 <= comparator_(leaf->keys_[i-1], leaf->keys_[i])){
+                    return false;
+                }
+                if((NULL != lower && comparator_(leaf->keys_[i], *lower)<0)
+                    || (NULL != upper && 0 <= comparator_(leaf->keys_[i], *upper)))
+                {
+                    return false;
+                }
+            }
+            count += leaf->count_;
+            return true;
+        }
+
+        const Internal* internal = static_cast<const Internal*>(node);
+        if(InternalCapacity<internal->count_ || (isRoot && internal->count_<1) || (!isRoot && internal->count_<MinInternalCount)){
+            return false;
+        }
+        for(s32 i=0; i<=internal->count_; ++i){
+            if(0<i && i<internal->count_ && 0 <= comparator_(internal->keys_[i-1], internal->keys_[i])){
+                return false;
+            }
+            const Key* childLower = (0<i)? &internal->keys_[i-1] : lower;
+            const Key* childUpper = (i<internal->count_)? &internal->keys_[i] : upper;
+            if(!checkRecursive(internal->children_[i], level-1, childLower, childUpper, count)){
+                return false;
+            }
+        }
+        return true;
+    }
+
+    template<class Key, class Value, class Comparator, s32 NodeBytes>
+    void BTreeMap<Key, Value, Comparator, NodeBytes>::swap(this_type& rhs)
+    {
+        lcore::swap(root_, rhs.root_);
+        lcore::swap(head_, rhs.head_);
+        lcore::swap(height_, rhs.height_);
+        lcore::swap(size_, rhs.size_);
+        lcore::swap(comparator_, rhs.comparator_);
+        leafAllocator_.swap(rhs.leafAllocator_);
+        internalAllocator_.swap(rhs.internalAllocator_);
+    }
+}
+#endif //INC_LCORE_BTREE_H_
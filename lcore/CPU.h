@@ -7,6 +7,12 @@
 */
 #include "lcore.h"
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
 namespace lcore
 {
 
@@ -16,6 +22,11 @@ namespace lcore
     {
         CPUID_FUNC_VERSIONID = 0x00000000U,
         CPUID_FUNC_CPUINFO   = 0x00000001U,
+        CPUID_FUNC_EXTENDED_FEATURE = 0x00000007U,
+        CPUID_FUNC_TSCINFO   = 0x00000015U,
+        CPUID_FUNC_EXT_VERSIONID = 0x80000000U,
+        CPUID_FUNC_EXT_CPUINFO   = 0x80000001U,
+        CPUID_FUNC_EXT_POWERINFO = 0x80000007U,
     };
 
     /// CPUID_FUNC_CPUINFOをEAXに指定した場合の、EDXに返ってくるフラグ
@@ -93,23 +104,108 @@ namespace lcore
         CPUINFO2_RESERVED2 = LCORE_CPUID_BIT_FLAG(31),
     };
 
+    /// CPUID_FUNC_EXTENDED_FEATUREをEAXに、0をECXに指定した場合の、EBXに返ってくるフラグ
+    enum CPUINFO_EXTENDED_FEATURE_FLAG
+    {
+        CPUINFO7_BMI1 = LCORE_CPUID_BIT_FLAG(3),
+        CPUINFO7_AVX2 = LCORE_CPUID_BIT_FLAG(5),
+        CPUINFO7_BMI2 = LCORE_CPUID_BIT_FLAG(8),
+    };
+
+    /// CPUID_FUNC_EXT_CPUINFOをEAXに指定した場合の、EDXに返ってくるフラグ
+    enum CPUINFO_EXT_FLAG
+    {
+        CPUINFO_EXT_SYSCALL = LCORE_CPUID_BIT_FLAG(11),
+        CPUINFO_EXT_NX = LCORE_CPUID_BIT_FLAG(20),
+        CPUINFO_EXT_RDTSCP = LCORE_CPUID_BIT_FLAG(27),
+        CPUINFO_EXT_LM = LCORE_CPUID_BIT_FLAG(29),
+    };
+
+    /// CPUID_FUNC_EXT_POWERINFOをEAXに指定した場合の、EDXに返ってくるフラグ
+    enum CPUINFO_POWER_FLAG
+    {
+        CPUINFO_POWER_INVARIANT_TSC = LCORE_CPUID_BIT_FLAG(8),
+    };
+
 #undef LCORE_CPUID_BIT_FLAG
 
-#if defined(__GNUC__)
-    void cpuid(u32);
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define LCORE_CPU_X86 1
+#endif
+
+/**
+@brief 関数単位で命令セットを有効にする。実行前にisSupport*で確かめること
 
-#elif defined(_MSC_VER)
+MSVCはオプションなしで全ての組み込み関数を使えるので空
+*/
+#if defined(__GNUC__)
+#define LCORE_TARGET(x) __attribute__((target(x)))
+#else
+#define LCORE_TARGET(x)
+#endif
 
     bool isSupportCPUID();
 
+    /**
+    @brief cpuid命令。x86以外では全て0を返す
+    */
     void cpuid(s32 func, s32& a, s32& b, s32& c, s32& d);
 
+    /**
+    @brief サブリーフ指定付きcpuid命令
+    */
+    void cpuidex(s32 func, s32 subfunc, s32& a, s32& b, s32& c, s32& d);
+
     /**
     @brief 論理プロセッサ数取得
     @return 論理プロセッサ数
     */
     u32 getLogicalCPUCount();
 
+    bool isSupportSSE41();
+
+    /// AES-NIとSSSE3に対応しているか
+    bool isSupportAESNI();
+
+    /// CPUとOSの両方がAVXに対応しているか
+    bool isSupportAVX();
+
+    /// CPUとOSの両方がAVX2に対応しているか
+    bool isSupportAVX2();
+
+    /// rdtsc命令があるか
+    bool isSupportTSC();
+
+    /// rdtscp命令があるか
+    bool isSupportRDTSCP();
+
+    /// コア間・電源状態に依らず一定の速度で進むTSCか
+    bool isInvariantTSC();
+
+    /**
+    @brief cpuidのリーフ0x15から求めたTSC周波数
+    @return 取得できなければ0
+    */
+    u64 getTSCFrequencyFromCPUID();
+
+#if defined(LCORE_CPU_X86)
+    /// タイムスタンプカウンタ読み出し。前後の命令とは順序付けされない
+    inline u64 rdtsc()
+    {
+        return __rdtsc();
+    }
+
+    /**
+    @brief 先行する命令の完了を待つタイムスタンプカウンタ読み出し
+    @param aux ... IA32_TSC_AUXの値（OSが設定したプロセッサ番号）
+    */
+    inline u64 rdtscp(u32& aux)
+    {
+        unsigned int a;
+        u64 t = __rdtscp(&a);
+        aux = a;
+        return t;
+    }
 #endif
 
     struct CPUCore
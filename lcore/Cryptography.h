@@ -9,6 +9,8 @@
 
 namespace lcore
 {
+    class ThreadPool;
+
     //----------------------------------------------------
     //---
     //--- PKCS5
@@ -88,18 +90,22 @@ namespace lcore
         static const u32 Key256Bytes = 32;
         static const u32 BlockSizeInBytes = 16;
 
+        /// 並列処理で1ジョブが受け持つバイト数。ブロックサイズの倍数
+        static const s32 ParallelChunkSize = 256*1024;
+
         enum Mode
         {
             Mode_None = -1,
             Mode_ECB = 0,
             Mode_CBC = 1,
+            Mode_CTR = 2,
         };
 
         /**
         @param context
         @param cipher ... dataLength以上のサイズ
         @param data ... 
-        @param dataLength ... dataのバイトサイズ。16の倍数
+        @param dataLength ... dataのバイトサイズ。CTR以外は16の倍数
         */
         static s32 encrypt(const AESContext& context, u8* cipher, const u8* data, s32 dataLength);
 
@@ -107,9 +113,34 @@ namespace lcore
         @param context
         @param data ... cipherLength以上のサイズ
         @param cipher ... 
-        @param cipherLength ... cipherのバイトサイズ。16の倍数
+        @param cipherLength ... cipherのバイトサイズ。CTR以外は16の倍数
         */
         static s32 decrypt(const AESContext& context, u8* data, const u8* cipher, s32 cipherLength);
+
+        /**
+        @brief ParallelChunkSizeごとにスレッドプールで分けて処理する
+
+        CBCの暗号化は前のブロックに依存するので、呼び出したスレッドだけで処理する。
+        呼び出したスレッドも処理に加わり、すべて終わるまで戻らない。
+        */
+        static s32 encrypt(ThreadPool& threadPool, const AESContext& context, u8* cipher, const u8* data, s32 dataLength);
+        static s32 decrypt(ThreadPool& threadPool, const AESContext& context, u8* data, const u8* cipher, s32 cipherLength);
+
+        /**
+        @brief CTRモード。暗号化と復号は同じ処理
+
+        カウンタはIVを128ビットのビッグエンディアン整数として、上位64ビットにnonceを排他的論理和し、ブロック番号を足したもの。
+        IVが0ならnonce||ブロック番号になる。
+        @param dst ... length以上のサイズ。srcと同じでもよい
+        @param length ... バイトサイズ。任意
+        @param offset ... 鍵ストリーム上のバイト位置。途中から部分的に処理できる
+        @param nonce ... 同じ鍵とIVで別のデータを暗号化するときは、データごとに変えて鍵ストリームの再利用を避ける
+        */
+        static s32 ctr(const AESContext& context, u8* dst, const u8* src, s32 length, u64 offset=0, u64 nonce=0);
+        static s32 ctr(ThreadPool& threadPool, const AESContext& context, u8* dst, const u8* src, s32 length, u64 offset=0, u64 nonce=0);
+
+        /// CPUがAES-NIに対応しているか. 結果は最初の呼び出しで決まる
+        static bool isHardwareAccelerated();
     };
 
     class AESContext
@@ -126,12 +157,21 @@ namespace lcore
 
         bool initialize(const u8* IV, const u8* key, u32 keyLength, AES::Mode mode);
 
+        /**
+        @brief AES-NIを使うか決める。構築時はCPUが対応していれば使う
+        @param enable ... falseならAES-NIに対応していてもソフトウェアで処理する
+        */
+        void setHardwareAccelerated(bool enable);
+
+        /// AES-NIで処理するか
+        bool isHardwareAccelerated() const{ return 0 != aesni_;}
+
         u32 Ek_[BufferSize];
         u32 Dk_[BufferSize];
         u32 IV_[4];
         u8 Nr_;
         s8 mode_;
-        u8 dummy0_;
+        u8 aesni_;
         u8 dummy1_;
     };
 
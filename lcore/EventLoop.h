@@ -0,0 +1,255 @@
+﻿#ifndef INC_LCORE_EVENTLOOP_H_
+#define INC_LCORE_EVENTLOOP_H_
+/**
+@file EventLoop.h
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "lcore.h"
+#include "Socket.h"
+#include "List.h"
+#include "Array.h"
+
+#if defined(__linux__)
+#define LCORE_EVENTLOOP_EPOLL 1
+struct epoll_event;
+#endif
+
+namespace lcore
+{
+    class EventLoop;
+
+    //----------------------------------------------------
+    //---
+    //--- Connection
+    //---
+    //----------------------------------------------------
+    /**
+    @brief イベントループが管理する接続
+    */
+    class Connection : public intrusive::ListNodeBase<Connection>
+    {
+    public:
+        typedef intrusive::ListNodeBase<Connection> base_type;
+
+        inline Socket& getSocket(){ return socket_;}
+        inline NetworkBuffer& getReceiveBuffer(){ return receiveBuffer_;}
+        inline NetworkBuffer& getSendBuffer(){ return sendBuffer_;}
+
+        inline s32 getIndex() const{ return index_;}
+        inline void* getUserData(){ return userData_;}
+        inline void setUserData(void* userData){ userData_ = userData;}
+
+        inline bool isConnecting() const{ return 0 != (flags_&Flag_Connecting);}
+        inline bool isClosed() const{ return 0 != (flags_&Flag_Closed);}
+
+    private:
+        friend class EventLoop;
+
+        static const u32 Flag_Active = (0x01U<<0);
+        static const u32 Flag_Connecting = (0x01U<<1);
+        static const u32 Flag_Closed = (0x01U<<2);
+        static const u32 Flag_ReceivePending = (0x01U<<3);
+
+        static const s32 TimerNone = -1;
+        static const s32 TimerExpired = -2;
+
+        Connection();
+        ~Connection();
+
+        Connection(const Connection&) = delete;
+        Connection& operator=(const Connection&) = delete;
+
+        Socket socket_;
+        NetworkBuffer receiveBuffer_;
+        NetworkBuffer sendBuffer_;
+        void* userData_;
+        s32 index_;
+        s32 nextFree_;
+        u32 flags_;
+        s32 timerSlot_;
+        u32 timerRounds_;
+    };
+
+    //----------------------------------------------------
+    //---
+    //--- EventHandler
+    //---
+    //----------------------------------------------------
+    /**
+    @brief 接続のイベント通知先
+
+    コールバックはイベントループのスレッドから呼ばれる。
+    */
+    class EventHandler
+    {
+    public:
+        virtual ~EventHandler()
+        {}
+
+        /**
+        @brief 接続を受け付けた
+        @return falseなら接続を閉じる
+        */
+        virtual bool onAccept(EventLoop& /*loop*/, Connection& /*connection*/){ return true;}
+
+        /// EventLoop::connectによる接続が確立した
+        virtual void onConnect(EventLoop& /*loop*/, Connection& /*connection*/){}
+
+        /**
+        @brief 受信バッファにデータが届いた
+
+        受信バッファから消費しなかったデータは残る。バッファが一杯なら、消費されるまで受信を止める。
+        送信バッファが空いたときも、受信バッファにデータが残っていれば新しい受信なしで呼ぶ。
+        */
+        virtual void onReceive(EventLoop& loop, Connection& connection) =0;
+
+        /// EventLoop::setTimeoutの時間が経過した。デフォルトでは接続を閉じる
+        virtual void onTimeout(EventLoop& loop, Connection& connection);
+
+        /// 接続を閉じる直前
+        virtual void onClose(EventLoop& /*loop*/, Connection& /*connection*/){}
+    };
+
+    //----------------------------------------------------
+    //---
+    //--- EventLoop
+    //---
+    //----------------------------------------------------
+    /**
+    @brief ノンブロッキングソケットのイベントループ
+
+    Linuxではepollをエッジトリガで使用し、それ以外ではselectを使用する。
+    ひとつのループはひとつのスレッドで回す。複数のループをThreadPoolのワーカーで回す場合は、
+    listenでreusePortを指定して同じポートで待ち受ける。
+    */
+    class EventLoop
+    {
+    public:
+        static const s32 DefaultBufferSize = 16*1024;
+        static const u32 DefaultTimerTick = 10; /// ミリ秒
+        static const s32 TimerWheelSize = 256;
+        static const s32 MaxEvents = 256;
+
+        EventLoop();
+        ~EventLoop();
+
+        /**
+        @brief 初期化
+        @return 成否
+        @param handler ... イベント通知先
+        @param maxConnections ... 最大接続数
+        @param bufferSize ... 接続毎の送受信バッファサイズ
+        @param timerTick ... タイマーの分解能（ミリ秒）
+        */
+        bool initialize(EventHandler* handler, s32 maxConnections, s32 bufferSize=DefaultBufferSize, u32 timerTick=DefaultTimerTick);
+
+        /// 全ての接続を閉じて終了
+        void terminate();
+
+        /**
+        @brief 待ち受け開始
+        @return 成否
+        @param port ... ポート
+        @param acceptIP ... 受け付けるIP
+        @param backlog ... 要求キューのサイズ
+        @param reusePort ... 他のループと同じポートで待ち受ける
+        */
+        bool listen(u16 port, u64 acceptIP, s32 backlog, bool reusePort);
+
+        /**
+        @brief ノンブロッキングで接続開始。確立するとEventHandler::onConnectが呼ばれる
+        @return 接続。失敗ならNULL
+        */
+        Connection* connect(const SOCKADDR& address);
+
+        /**
+        @brief イベントを一回処理
+        @return 処理したイベント数。失敗なら-1
+        @param timeout ... 待ち時間（ミリ秒）
+        */
+        s32 poll(u32 timeout);
+
+        /**
+        @brief stopが呼ばれるまでpollを繰り返す
+
+        stop後に再度回す場合はinitializeし直す。
+        */
+        void run();
+
+        /// runを終了させる。他のスレッドから呼べる
+        void stop();
+
+        /// ThreadPool::addに渡すジョブ。dataはEventLoop
+        static void runJob(u32 threadId, s32 jobId, void* data);
+
+        /**
+        @brief 送信バッファに書き込んで送信
+        @return 送信バッファに空きがなければfalse
+        */
+        bool send(Connection& connection, const void* data, s32 size);
+
+        /**
+        @brief 送信バッファを送信
+        @return エラーで閉じたらfalse
+        */
+        bool flush(Connection& connection);
+
+        /// 接続を閉じる。解放はpollの最後に行う
+        void close(Connection& connection);
+
+        /**
+        @brief タイムアウト設定。経過するとEventHandler::onTimeoutが呼ばれる
+        @param milliSeconds ... 0なら解除
+        */
+        void setTimeout(Connection& connection, u32 milliSeconds);
+
+        inline s32 getNumConnections() const{ return numConnections_;}
+        inline s32 getMaxConnections() const{ return maxConnections_;}
+    private:
+        EventLoop(const EventLoop&) = delete;
+        EventLoop& operator=(const EventLoop&) = delete;
+
+        typedef intrusive::List<Connection> ConnectionList;
+
+        Connection* acquire();
+        void release(Connection* connection);
+        void releaseClosed();
+
+        bool addEvent(Connection& connection);
+        void removeEvent(Connection& connection);
+
+        void acceptAll();
+        void onReadable(Connection& connection);
+        void onWritable(Connection& connection);
+        void processPendingReceives();
+
+        void cancelTimeout(Connection& connection);
+        void advanceTimer(u32 now);
+
+        EventHandler* handler_;
+        s32 maxConnections_;
+        s32 bufferSize_;
+        s32 numConnections_;
+        s32 freeList_;
+        Connection* connections_;
+        Socket listener_;
+        volatile s32 running_;
+
+        Array<Connection*> pendingReceives_;
+        Array<Connection*> closed_;
+
+#if defined(LCORE_EVENTLOOP_EPOLL)
+        s32 epoll_;
+        epoll_event* events_;
+#endif
+
+        u32 timerTick_;
+        u32 timerLastTime_;
+        s32 timerCurrent_;
+        s32 numTimers_;
+        ConnectionList timerWheel_[TimerWheelSize];
+        ConnectionList timerExpired_;
+    };
+}
+#endif //INC_LCORE_EVENTLOOP_H_
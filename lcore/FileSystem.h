@@ -12,6 +12,7 @@ namespace lcore
 {
     class FileProxy;
     class DirectoryProxy;
+    class AESContext;
 
     class VirtualFileSystemBase;
     class VirtualFileSystemPack;
@@ -60,6 +61,7 @@ namespace fs
         static const u16 Flag_ShareName = 0x01U<<1;
         static const u16 Flag_Compressed = 0x01U<<2;
         static const u16 Flag_ShareDescs = 0x01U<<3;
+        static const u16 Flag_Encrypted = 0x01U<<4;
 
         inline u16 getType() const;
         inline bool checkFlag(u16 flag) const;
@@ -145,6 +147,7 @@ namespace fs
         ~File();
 
         inline bool isCompressed() const;
+        inline bool isEncrypted() const;
         inline s64 getUncompressedSize() const;
         inline s64 getCompressedSize() const;
         void set(
@@ -154,6 +157,13 @@ namespace fs
             void* data,
             bool compressed, bool share);
 
+        /**
+        @brief Lf[^AESCTR[hŕȂǂ
+        @param cipher ... Xg[̈ʒu̓pbN̐ΈʒuBgԂ͗Lł邱ƁBNULLȂÍȂ
+        @param nonce ... pbÑwb_nonce
+        */
+        void setCipher(const AESContext* cipher, u64 nonce);
+
         inline bool read(s64 size, void* data);
         bool read(s64 offset, s64 size, void* data);
         inline bool write(s64 size, void* data);
@@ -174,6 +184,8 @@ namespace fs
         s64 uncompressedSize_;
         s64 compressedSize_;
         void* data_;
+        const AESContext* cipher_;
+        u64 nonce_;
     };
 
     inline bool File::isCompressed() const
@@ -181,6 +193,11 @@ namespace fs
         return checkFlag(Flag_Compressed);
     }
 
+    inline bool File::isEncrypted() const
+    {
+        return checkFlag(Flag_Encrypted);
+    }
+
     inline s64 File::getUncompressedSize() const
     {
         return uncompressedSize_;
@@ -304,8 +321,9 @@ namespace fs
         */
         bool mountOS(s32 id, const Char* path);
         /**
+        @param cipher ... ÍpbŇB}EgĂԂ͗Lł邱
         */
-        bool mountPack(s32 id, const Char* path, bool checkHash);
+        bool mountPack(s32 id, const Char* path, bool checkHash, const AESContext* cipher=NULL);
         /**
         */
         void unmount(s32 id);
@@ -329,8 +347,9 @@ namespace fs
         void closeDirectory(DirectoryProxy* directory);
 
         /**
+        @param cipher ... NULLłȂ΃t@C̃f[^CTR[hňÍBnonce̓pbNƂɗō
         */
-        bool packDirectory(const Char* filepath, const Char* path);
+        bool packDirectory(const Char* filepath, const Char* path, const AESContext* cipher=NULL);
     private:
         FileSystem(const FileSystem&) = delete;
         FileSystem(FileSystem&&) = delete;
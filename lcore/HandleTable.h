@@ -7,6 +7,7 @@
 */
 #include "lcore.h"
 #include "Array.h"
+#include "SyncObject.h"
 
 namespace lcore
 {
@@ -288,6 +289,330 @@ namespace lcore
         lcore::swap(freeList_, rhs.freeList_);
     }
 
+    //----------------------------------------------------------------------
+    //---
+    //--- ConcurrentHandleTable
+    //---
+    //----------------------------------------------------------------------
+    /**
+    @brief HandleTable that can create and destroy handles from multiple threads
+
+    The free list head is a tagged index updated by CAS.
+    Entries live in fixed size blocks that never move on growth, so valid() may run concurrently with create and destroy on other threads.
+    A per-thread Cache takes and returns free indices in batches.
+    Call clear() and the destructor only while no other thread uses the table.
+    */
+    template<class T=u32, s32 U=24, s32 BlockBits=10>
+    class ConcurrentHandleTable
+    {
+    public:
+        typedef ConcurrentHandleTable<T,U,BlockBits> this_type;
+        typedef Handle<T,U> handle_type;
+        typedef typename handle_type::value_type value_type;
+
+        LSTATIC_ASSERT(sizeof(value_type) == sizeof(s32), "ConcurrentHandleTable requires 32bit handles");
+
+        static const s32 BlockSize = 0x01<<BlockBits;
+        static const s32 MaxCapacity = handle_type::Mask;
+        static const s32 MaxBlocks = (MaxCapacity+BlockSize-1)>>BlockBits;
+
+        /**
+        @brief Free indices owned by one thread
+        */
+        class Cache
+        {
+        public:
+            static const s32 Size = 64;
+            static const s32 Batch = Size/2;
+
+            Cache()
+                :size_(0)
+            {}
+
+            s32 size() const{ return size_;}
+        private:
+            friend class ConcurrentHandleTable;
+
+            s32 size_;
+            value_type indices_[Size];
+        };
+
+        ConcurrentHandleTable();
+        ~ConcurrentHandleTable();
+
+        /// Number of reserved entries
+        s32 capacity() const{ return atomicLoad(numBlocks_)<<BlockBits;}
+        s32 size() const{ return atomicLoad(size_);}
+        /// Returns an invalid handle once MaxCapacity is used up
+        handle_type create();
+        void destroy(handle_type handle);
+
+        /// Only the calling thread may use cache. Returns an invalid handle once MaxCapacity is used up
+        handle_type create(Cache& cache);
+        void destroy(Cache& cache, handle_type handle);
+        /// Returns the free indices in cache to the shared list
+        void flush(Cache& cache);
+
+        bool valid(handle_type handle) const;
+        void clear();
+    private:
+        ConcurrentHandleTable(const this_type&);
+        this_type& operator=(const this_type&);
+
+        static const s32 Shift = handle_type::Shift;
+        static const value_type MaxCount = handle_type::MaxCount;
+        static const value_type UsedFlag = handle_type::UsedFlag;
+        static const value_type InvalidID = handle_type::Mask;
+
+        inline static value_type getCount(value_type value)
+        {
+            return (value>>Shift) & MaxCount;
+        }
+
+        inline static value_type getNext(value_type value)
+        {
+            return value & handle_type::Mask;
+        }
+
+        inline static s32 makeEntry(value_type count, value_type next, value_type flag)
+        {
+            return static_cast<s32>((count<<Shift) | (next & handle_type::Mask) | flag);
+        }
+
+        inline volatile s32& entry(value_type index) const
+        {
+            return atomicLoad(blocks_[index>>BlockBits])[index&(BlockSize-1)];
+        }
+
+        /// Tag in the upper 32 bits, index in the lower 32 bits
+        inline static s64 makeHead(s64 head, value_type index)
+        {
+            return static_cast<s64>((static_cast<u64>(head)&0xFFFFFFFF00000000ULL) + 0x100000000ULL) | index;
+        }
+
+        void allocateBlocks(value_type begin, value_type end);
+        value_type pop();
+        void push(value_type index);
+        /**
+        @brief Reserve count new indices
+        @return The first index, or InvalidID if it would exceed MaxCapacity
+        */
+        value_type reserve(s32 count);
+        handle_type use(value_type index);
+
+        s32* volatile* blocks_;
+        volatile s32 numBlocks_;
+        volatile s32 size_;
+        volatile s32 nextId_;
+        volatile s64 head_;
+    };
+
+    template<class T, s32 U, s32 BlockBits>
+    ConcurrentHandleTable<T,U,BlockBits>::ConcurrentHandleTable()
+        :blocks_(NULL)
+        ,numBlocks_(0)
+        ,size_(0)
+        ,nextId_(0)
+        ,head_(InvalidID)
+    {
+        blocks_ = LNEW s32*[MaxBlocks];
+        lcore::memset(const_cast<s32**>(blocks_), 0, sizeof(s32*)*MaxBlocks);
+    }
+
+    template<class T, s32 U, s32 BlockBits>
+    ConcurrentHandleTable<T,U,BlockBits>::~ConcurrentHandleTable()
+    {
+        for(s32 i=0; i<MaxBlocks; ++i){
+            LDELETE_ARRAY(blocks_[i]);
+        }
+        s32** blocks = const_cast<s32**>(blocks_);
+        LDELETE_ARRAY(blocks);
+    }
+
+    template<class T, s32 U, s32 BlockBits>
+    typename ConcurrentHandleTable<T,U,BlockBits>::handle_type ConcurrentHandleTable<T,U,BlockBits>::create()
+    {
+        value_type index = pop();
+        if(InvalidID == index){
+            index = reserve(1);
+            if(InvalidID == index){
+                return handle_type::construct(handle_type::Invalid);
+            }
+        }
+        return use(index);
+    }
+
+    template<class T, s32 U, s32 BlockBits>
+    void ConcurrentHandleTable<T,U,BlockBits>::destroy(handle_type handle)
+    {
+        LASSERT(valid(handle));
+        atomicDecrement(size_);
+        push(handle.index());
+    }
+
+    template<class T, s32 U, s32 BlockBits>
+    typename ConcurrentHandleTable<T,U,BlockBits>::handle_type ConcurrentHandleTable<T,U,BlockBits>::create(Cache& cache)
+    {
+        if(cache.size_<=0){
+            //Take up to half from the free list, reserve new ones if short
+            while(cache.size_<Cache::Batch){
+                value_type index = pop();
+                if(InvalidID == index){
+                    break;
+                }
+                cache.indices_[cache.size_++] = index;
+            }
+            if(cache.size_<=0){
+                value_type begin = reserve(Cache::Batch);
+                if(InvalidID != begin){
+                    for(s32 i=Cache::Batch-1; 0<=i; --i){
+                        cache.indices_[cache.size_++] = begin + i;
+                    }
+                }else{
+                    //Fewer than Batch left, reserve one at a time
+                    begin = reserve(1);
+                    if(InvalidID == begin){
+                        return handle_type::construct(handle_type::Invalid);
+                    }
+                    cache.indices_[cache.size_++] = begin;
+                }
+            }
+        }
+        return use(cache.indices_[--cache.size_]);
+    }
+
+    template<class T, s32 U, s32 BlockBits>
+    void ConcurrentHandleTable<T,U,BlockBits>::destroy(Cache& cache, handle_type handle)
+    {
+        LASSERT(valid(handle));
+        atomicDecrement(size_);
+        value_type index = handle.index();
+        atomicStore(entry(index), makeEntry(handle.count(), InvalidID, 0));
+        if(Cache::Size<=cache.size_){
+            //Return half to the shared list
+            while(Cache::Batch<cache.size_){
+                push(cache.indices_[--cache.size_]);
+            }
+        }
+        cache.indices_[cache.size_++] = index;
+    }
+
+    template<class T, s32 U, s32 BlockBits>
+    void ConcurrentHandleTable<T,U,BlockBits>::flush(Cache& cache)
+    {
+        while(0<cache.size_){
+            push(cache.indices_[--cache.size_]);
+        }
+    }
+
+    template<class T, s32 U, s32 BlockBits>
+    bool ConcurrentHandleTable<T,U,BlockBits>::valid(handle_type handle) const
+    {
+        value_type index = handle.index();
+        if(MaxCapacity<=static_cast<s32>(index)){
+            return false;
+        }
+        const s32* block = atomicLoad(blocks_[index>>BlockBits]);
+        if(NULL == block){
+            return false;
+        }
+        value_type value = static_cast<value_type>(atomicLoad(entry(index)));
+        return 0 != (value & UsedFlag) && value == handle.value_;
+    }
+
+    template<class T, s32 U, s32 BlockBits>
+    void ConcurrentHandleTable<T,U,BlockBits>::clear()
+    {
+        s32 numBlocks = (nextId_+BlockSize-1)>>BlockBits;
+        for(s32 i=0; i<numBlocks; ++i){
+            if(NULL != blocks_[i]){
+                lcore::memset(const_cast<s32*>(blocks_[i]), 0, sizeof(s32)*BlockSize);
+            }
+        }
+        size_ = 0;
+        nextId_ = 0;
+        head_ = InvalidID;
+    }
+
+    template<class T, s32 U, s32 BlockBits>
+    void ConcurrentHandleTable<T,U,BlockBits>::allocateBlocks(value_type begin, value_type end)
+    {
+        for(value_type i=(begin>>BlockBits); i<=((end-1)>>BlockBits); ++i){
+            if(NULL != atomicLoad(blocks_[i])){
+                continue;
+            }
+            s32* block = LNEW s32[BlockSize];
+            lcore::memset(block, 0, sizeof(s32)*BlockSize);
+            if(NULL == atomicCompareExchange(blocks_[i], block, static_cast<s32*>(NULL))){
+                atomicIncrement(numBlocks_);
+            }else{
+                //Another thread got it first
+                LDELETE_ARRAY(block);
+            }
+        }
+    }
+
+    template<class T, s32 U, s32 BlockBits>
+    typename ConcurrentHandleTable<T,U,BlockBits>::value_type ConcurrentHandleTable<T,U,BlockBits>::pop()
+    {
+        for(;;){
+            s64 head = atomicLoad(head_);
+            value_type index = static_cast<value_type>(head & 0xFFFFFFFF);
+            if(InvalidID == index){
+                return InvalidID;
+            }
+            //If it was rewritten after we read it, the tag changed and the CAS fails
+            value_type next = getNext(static_cast<value_type>(atomicLoad(entry(index))));
+            if(head == atomicCompareExchange(head_, makeHead(head, next), head)){
+                return index;
+            }
+        }
+    }
+
+    template<class T, s32 U, s32 BlockBits>
+    void ConcurrentHandleTable<T,U,BlockBits>::push(value_type index)
+    {
+        value_type count = getCount(static_cast<value_type>(atomicLoad(entry(index))));
+        for(;;){
+            s64 head = atomicLoad(head_);
+            atomicStore(entry(index), makeEntry(count, static_cast<value_type>(head & 0xFFFFFFFF), 0));
+            if(head == atomicCompareExchange(head_, makeHead(head, index), head)){
+                return;
+            }
+        }
+    }
+
+    template<class T, s32 U, s32 BlockBits>
+    typename ConcurrentHandleTable<T,U,BlockBits>::value_type ConcurrentHandleTable<T,U,BlockBits>::reserve(s32 count)
+    {
+        LASSERT(0<count);
+        //Reserve with CAS so the count never passes the limit
+        for(;;){
+            s32 begin = atomicLoad(nextId_);
+            if(MaxCapacity-count<begin){
+                return InvalidID;
+            }
+            if(begin == atomicCompareExchange(nextId_, begin+count, begin)){
+                allocateBlocks(begin, begin+count);
+                return static_cast<value_type>(begin);
+            }
+        }
+    }
+
+    template<class T, s32 U, s32 BlockBits>
+    typename ConcurrentHandleTable<T,U,BlockBits>::handle_type ConcurrentHandleTable<T,U,BlockBits>::use(value_type index)
+    {
+        value_type count = getCount(static_cast<value_type>(atomicLoad(entry(index)))) + 1;
+        if(MaxCount<count){
+            count = 1;
+        }
+        atomicIncrement(size_);
+
+        //Set used flag
+        atomicStore(entry(index), makeEntry(count, index, UsedFlag));
+        return handle_type::construct(count, index, UsedFlag);
+    }
+
     //----------------------------------------------------------------------
     //---
     //---
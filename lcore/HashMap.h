@@ -279,6 +279,14 @@ namespace lcore
         }
 
         bool insert(const_key_param_type key, const_value_param_type value);
+        bool insert(const_key_param_type key, value_type&& value);
+
+        /**
+        @brief Construct value in place
+        @return false if key already exists
+        */
+        template<class... Args>
+        bool emplace(const_key_param_type key, Args&&... args);
 
         void erase(const_key_param_type key);
         void eraseAt(size_type pos);
@@ -334,6 +342,8 @@ namespace lcore
         void expand();
 
         size_type find_(const_key_param_type key, size_type hash) const;
+        s32 reserve_(const_key_param_type key, size_type hash);
+        void link_(s32 entryPos, size_type hash);
         void erase_(size_type pos, u32 rawHash);
 
         void create(size_type capacity);
@@ -419,9 +429,55 @@ namespace lcore
     bool HashMap<Key, Value, MemoryAllocator>::insert(const_key_param_type key, const_value_param_type value)
     {
         size_type hash = calcHash_(key);
-        if(0<capacity_ && find_(key, hash) != end()){
+        s32 entryPos = reserve_(key, hash);
+        if(entryPos<0){
+            return false;
+        }
+        construct(&keys_[entryPos], key);
+        construct(&values_[entryPos], value);
+        ++size_;
+        return true;
+    }
+
+    template<class Key, class Value, class MemoryAllocator>
+    bool HashMap<Key, Value, MemoryAllocator>::insert(const_key_param_type key, value_type&& value)
+    {
+        size_type hash = calcHash_(key);
+        s32 entryPos = reserve_(key, hash);
+        if(entryPos<0){
             return false;
         }
+        construct(&keys_[entryPos], key);
+        LPLACEMENT_NEW(&values_[entryPos]) value_type(lcore::move(value));
+        ++size_;
+        return true;
+    }
+
+    template<class Key, class Value, class MemoryAllocator>
+    template<class... Args>
+    bool HashMap<Key, Value, MemoryAllocator>::emplace(const_key_param_type key, Args&&... args)
+    {
+        size_type hash = calcHash_(key);
+        s32 entryPos = reserve_(key, hash);
+        if(entryPos<0){
+            return false;
+        }
+        construct(&keys_[entryPos], key);
+        LPLACEMENT_NEW(&values_[entryPos]) value_type(lcore::forward<Args>(args)...);
+        ++size_;
+        return true;
+    }
+
+    /**
+    @brief Reserve and link an entry for the key
+    @return entry position, or -1 if the key already exists
+    */
+    template<class Key, class Value, class MemoryAllocator>
+    s32 HashMap<Key, Value, MemoryAllocator>::reserve_(const_key_param_type key, size_type hash)
+    {
+        if(0<capacity_ && find_(key, hash) != end()){
+            return -1;
+        }
 
         s32 entryPos;
         if(freeList_<0){
@@ -436,15 +492,17 @@ namespace lcore
             entryPos = freeList_;
             freeList_ = buckets_[freeList_].next_;
         }
+        link_(entryPos, hash);
+        return entryPos;
+    }
 
+    template<class Key, class Value, class MemoryAllocator>
+    void HashMap<Key, Value, MemoryAllocator>::link_(s32 entryPos, size_type hash)
+    {
         s32 bucketPos = hash % capacity_;
         buckets_[entryPos].next_ = (buckets_[bucketPos].index_<0)? -1 : buckets_[bucketPos].index_;
         buckets_[bucketPos].index_ = entryPos;
         buckets_[entryPos].hash_ = hash | bucket_type::OccupyFlag;
-        construct(&keys_[entryPos], key);
-        construct(&values_[entryPos], value);
-        ++size_;
-        return true;
     }
 
     template<class Key, class Value, class MemoryAllocator>
@@ -546,16 +604,22 @@ namespace lcore
         this_type tmp;
         tmp.create(capacity_+1);
 
-
+        //Keys are unique and hashes are cached in buckets, so move entries without finding and rehashing.
+        //Entries stay at same positions, only chains are rebuilt.
         for(size_type i=0; i<capacity_; ++i){
             if(buckets_[i].isOccupy()){
-#if _DEBUG
-                if(false == tmp.insert(keys_[i], values_[i])){
-                    LASSERT(false);
-                }
-#else
-                tmp.insert(keys_[i], values_[i]);
-#endif
+                LPLACEMENT_NEW(&tmp.keys_[i]) key_type(lcore::move(keys_[i]));
+                LPLACEMENT_NEW(&tmp.values_[i]) value_type(lcore::move(values_[i]));
+                tmp.link_(i, buckets_[i].hash_ & bucket_type::HashMask);
+            }
+        }
+        //Free entries of this are linked to free list of tmp
+        tmp.empty_ = empty_;
+        tmp.size_ = size_;
+        for(s32 i=empty_-1; 0<=i; --i){
+            if(!buckets_[i].isOccupy()){
+                tmp.buckets_[i].next_ = tmp.freeList_;
+                tmp.freeList_ = i;
             }
         }
         tmp.swap(*this);
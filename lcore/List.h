@@ -106,6 +106,18 @@ namespace intrusive
             :value_(value)
         {}
 
+        ListNodeContainer(T&& value)
+            :value_(lcore::move(value))
+        {}
+
+        /**
+        @brief Construct value in place. Single argument is converted by the constructors above.
+        */
+        template<class Arg0, class Arg1, class... Args>
+        ListNodeContainer(Arg0&& arg0, Arg1&& arg1, Args&&... args)
+            :value_(lcore::forward<Arg0>(arg0), lcore::forward<Arg1>(arg1), lcore::forward<Args>(args)...)
+        {}
+
         ~ListNodeContainer()
         {}
 
@@ -237,7 +249,7 @@ namespace intrusive
 
         void swap(this_type& rhs);
     private:
-        this_type(const this_type&);
+        List(const this_type&);
         this_type& operator=(const this_type&);
 
         u32 size_;
@@ -9,6 +9,8 @@
 
 namespace lcore
 {
+    class ThreadPool;
+
     struct NoiseSample1
     {
     public:
@@ -260,10 +262,16 @@ namespace lcore
         typedef NoiseSample2(Noise::*Func2D)(f32 px, f32 py, f32 frequency) const;
         typedef NoiseSample3(Noise::*Func3D)(f32 px, f32 py, f32 pz, f32 frequency) const;
 
+        /// Evaluate count points at once
+        typedef void(Noise::*Batch2D)(s32 count, NoiseSample2* samples, const f32* px, const f32* py, f32 frequency) const;
+        typedef void(Noise::*Batch3D)(s32 count, NoiseSample3* samples, const f32* px, const f32* py, const f32* pz, f32 frequency) const;
+
         static const s32 PermutationTableSize = 256*2;
         static const u32 PermutationTableSizeMask = (PermutationTableSize>>1)-1;
         static const s32 NumGrad2 = 8;
         static const s32 NumGrad3 = 16;
+        /// SIMD gathers load 4 bytes from the permutation table
+        static const s32 PermutationTablePadding = 4;
 
         static s32 fastFloor(f32 x)
         {
@@ -313,6 +321,25 @@ namespace lcore
         NoiseSample2 fbm(Func2D func2D, f32 px, f32 py, s32 octave, f32 frequency, f32 lacunarity=2.0f, f32 persistence=0.5f) const;
         NoiseSample3 fbm(Func3D func3D, f32 px, f32 py, f32 pz, s32 octave, f32 frequency, f32 lacunarity=2.0f, f32 persistence=0.5f) const;
 
+        void fbm(Batch2D batch2D, s32 count, NoiseSample2* samples, const f32* px, const f32* py, s32 octave, f32 frequency, f32 lacunarity=2.0f, f32 persistence=0.5f) const;
+        void fbm(Batch3D batch3D, s32 count, NoiseSample3* samples, const f32* px, const f32* py, const f32* pz, s32 octave, f32 frequency, f32 lacunarity=2.0f, f32 persistence=0.5f) const;
+
+        /**
+        @brief fbm on a regular grid, samples[y*width + x] at (x0 + x*step, y0 + y*step)
+        */
+        void grid2D(Batch2D batch2D, NoiseSample2* samples, s32 width, s32 height, f32 x0, f32 y0, f32 step, s32 octave, f32 frequency, f32 lacunarity=2.0f, f32 persistence=0.5f) const;
+
+        /**
+        @brief fbm on a regular grid, samples[(z*height + y)*width + x] at (x0 + x*step, y0 + y*step, z0 + z*step)
+        */
+        void grid3D(Batch3D batch3D, NoiseSample3* samples, s32 width, s32 height, s32 depth, f32 x0, f32 y0, f32 z0, f32 step, s32 octave, f32 frequency, f32 lacunarity=2.0f, f32 persistence=0.5f) const;
+
+        /**
+        @brief Rows are shared by the calling thread and the pool. Results are the same as the serial version
+        */
+        void grid2D(ThreadPool& threadPool, Batch2D batch2D, NoiseSample2* samples, s32 width, s32 height, f32 x0, f32 y0, f32 step, s32 octave, f32 frequency, f32 lacunarity=2.0f, f32 persistence=0.5f) const;
+        void grid3D(ThreadPool& threadPool, Batch3D batch3D, NoiseSample3* samples, s32 width, s32 height, s32 depth, f32 x0, f32 y0, f32 z0, f32 step, s32 octave, f32 frequency, f32 lacunarity=2.0f, f32 persistence=0.5f) const;
+
         //NoiseSample2 turbulence(Func2D func2D, f32 px, f32 py, s32 octave, f32 frequency, f32 lacunarity=2.0f, f32 persistence=0.5f) const;
         //NoiseSample3 turbulence(Func3D func3D, f32 px, f32 py, f32 pz, s32 octave, f32 frequency, f32 lacunarity=2.0f, f32 persistence=0.5f) const;
 
@@ -331,12 +358,23 @@ namespace lcore
         NoiseSample2 perlin2D(f32 px, f32 py, f32 frequency) const;
         NoiseSample3 perlin3D(f32 px, f32 py, f32 pz, f32 frequency) const;
 
+        NoiseSample2 simplex2D(f32 px, f32 py, f32 frequency) const;
+        NoiseSample3 simplex3D(f32 px, f32 py, f32 pz, f32 frequency) const;
+
+        //-------------------------------------------------------
+        // 4 or 8 points per step with SSE2/AVX2
+        void perlin2D(s32 count, NoiseSample2* samples, const f32* px, const f32* py, f32 frequency) const;
+        void perlin3D(s32 count, NoiseSample3* samples, const f32* px, const f32* py, const f32* pz, f32 frequency) const;
+
+        void simplex2D(s32 count, NoiseSample2* samples, const f32* px, const f32* py, f32 frequency) const;
+        void simplex3D(s32 count, NoiseSample3* samples, const f32* px, const f32* py, const f32* pz, f32 frequency) const;
+
     private:
         static const Vector2 grad2_[NumGrad2];
         static const s8 grad3_[NumGrad3][3];
         //static const s8 simple_[64][4];
 
-        u8 permutation_[PermutationTableSize];
+        u8 permutation_[PermutationTableSize+PermutationTablePadding];
     };
 }
 
@@ -18,6 +18,9 @@ namespace lcore
         static const u32 value_size = sizeof(T);
         typedef Allocator allocator_type;
 
+        /// Aligns each entry to alignof(T)
+        static const u32 Alignment = (alignof(T)<sizeof(void*))? static_cast<u32>(sizeof(void*)) : static_cast<u32>(alignof(T));
+
         ObjectAllocator();
         ~ObjectAllocator();
 
@@ -43,6 +46,8 @@ namespace lcore
             Page* next_;
         };
 
+        static const u32 EntryOffset = (sizeof(Page)+Alignment-1) & ~(Alignment-1);
+
         void createEntries();
 
         s32 pageSize_;
@@ -67,7 +72,7 @@ namespace lcore
     template<class T, typename Allocator>
     void ObjectAllocator<T, Allocator>::initialize(s32 pageSize)
     {
-        LASSERT(sizeof(Page) <= pageSize);
+        LASSERT(static_cast<s32>(EntryOffset+sizeof(T)) <= pageSize);
         LASSERT(NULL == page_);
         pageSize_ = pageSize;
     }
@@ -77,7 +82,7 @@ namespace lcore
     {
         while(NULL != page_){
             Page* next = page_->next_;
-            LALLOCATOR_FREE(allocator_type, page_);
+            LALLOCATOR_ALIGNED_FREE(allocator_type, page_, Alignment);
             page_ = next;
         }
         next_ = NULL;
@@ -116,10 +121,10 @@ namespace lcore
     void ObjectAllocator<T, Allocator>::createEntries()
     {
         s32 entrySize = sizeof(Entry);
-        Page* page = (Page*)LALLOCATOR_MALLOC(allocator_type, pageSize_);
-        s32 numEntries = (pageSize_-sizeof(Page))/entrySize;
+        Page* page = (Page*)LALLOCATOR_ALIGNED_MALLOC(allocator_type, pageSize_, Alignment);
+        s32 numEntries = (pageSize_-EntryOffset)/entrySize;
 
-        Entry* entry = reinterpret_cast<Entry*>(reinterpret_cast<u8*>(page) + sizeof(Page));
+        Entry* entry = reinterpret_cast<Entry*>(reinterpret_cast<u8*>(page) + EntryOffset);
         for(s32 i=1; i<numEntries; ++i){
             entry[i-1].next_ = &entry[i];
         }
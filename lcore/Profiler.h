@@ -0,0 +1,259 @@
+﻿#ifndef INC_LCORE_PROFILER_H_
+#define INC_LCORE_PROFILER_H_
+/**
+@file Profiler.h
+@author t-sakai
+@date 2026/10/19 create
+
+LENABLE_PROFILEが定義されている場合のみ、LPROFILE_*マクロが計測コードになる。
+*/
+#include "lcore.h"
+#include "SyncObject.h"
+#include "Timestamp.h"
+
+namespace lcore
+{
+    class File;
+
+    //---------------------------------------------------------------
+    //---
+    //--- ProfileEvent
+    //---
+    //---------------------------------------------------------------
+    struct ProfileEvent
+    {
+        enum Type
+        {
+            Type_Zone = 0,
+            Type_Counter,
+            Type_Frame,
+        };
+
+        u64 begin_;
+        union
+        {
+            u64 end_;
+            f64 value_;
+            u64 frame_;
+        };
+        const Char* name_; ///< 文字列リテラルなど、書き出しまで有効な文字列
+        u32 type_;
+        u32 depth_; ///< 区間は入れ子の深さ、それ以外は開いている区間の数
+    };
+
+    //---------------------------------------------------------------
+    //---
+    //--- ProfileThreadBuffer
+    //---
+    //---------------------------------------------------------------
+    /**
+    @brief スレッドごとのリングバッファ
+
+    書き込みは所有スレッドのみ。いっぱいになれば古いイベントから上書きする。
+    */
+    class ProfileThreadBuffer
+    {
+    public:
+        static const s32 NameSize = 32;
+
+        inline void beginZone();
+        inline void endZone(const Char* name, u64 begin, u64 end);
+        inline void counter(const Char* name, f64 value);
+        inline void frame(u64 frame);
+
+        inline u32 getID() const;
+        inline const Char* getName() const;
+    private:
+        friend class Profiler;
+
+        inline ProfileEvent& next();
+        inline void commit();
+
+        ProfileEvent* events_;
+        u32 capacity_;
+        u32 id_;
+        volatile s32 head_; ///< 書き込んだイベントの総数（u32として扱う）
+        s32 depth_;
+        Char name_[NameSize];
+    };
+
+    inline void ProfileThreadBuffer::beginZone()
+    {
+        ++depth_;
+    }
+
+    inline void ProfileThreadBuffer::endZone(const Char* name, u64 begin, u64 end)
+    {
+        ProfileEvent& event = next();
+        event.begin_ = begin;
+        event.end_ = end;
+        event.name_ = name;
+        event.type_ = ProfileEvent::Type_Zone;
+        event.depth_ = --depth_;
+        commit();
+    }
+
+    inline void ProfileThreadBuffer::counter(const Char* name, f64 value)
+    {
+        ProfileEvent& event = next();
+        event.begin_ = Timestamp::now();
+        event.value_ = value;
+        event.name_ = name;
+        event.type_ = ProfileEvent::Type_Counter;
+        event.depth_ = depth_;
+        commit();
+    }
+
+    inline void ProfileThreadBuffer::frame(u64 frame)
+    {
+        ProfileEvent& event = next();
+        event.begin_ = Timestamp::now();
+        event.frame_ = frame;
+        event.name_ = "Frame";
+        event.type_ = ProfileEvent::Type_Frame;
+        event.depth_ = depth_;
+        commit();
+    }
+
+    inline u32 ProfileThreadBuffer::getID() const
+    {
+        return id_;
+    }
+
+    inline const Char* ProfileThreadBuffer::getName() const
+    {
+        return name_;
+    }
+
+    inline ProfileEvent& ProfileThreadBuffer::next()
+    {
+        return events_[static_cast<u32>(head_) & (capacity_-1)];
+    }
+
+    inline void ProfileThreadBuffer::commit()
+    {
+        atomicStore(head_, static_cast<s32>(static_cast<u32>(head_)+1));
+    }
+
+    //---------------------------------------------------------------
+    //---
+    //--- Profiler
+    //---
+    //---------------------------------------------------------------
+    /**
+    @brief 階層付きCPUプロファイラ
+
+    initialize/terminateは計測中のスレッドがない状態で呼ぶ。
+    スレッドのバッファは最初の計測時に確保する。
+    */
+    class Profiler
+    {
+    public:
+        static const s32 MaxThreads = 64;
+        static const s32 DefaultEventsPerThread = 64*1024;
+
+        /**
+        @brief 初期化
+        @param eventsPerThread ... スレッドあたりのイベント数、2のべき乗に切り上げる
+        */
+        static bool initialize(s32 eventsPerThread=DefaultEventsPerThread);
+        static void terminate();
+        static bool isInitialized();
+
+        /**
+        @brief 呼び出しスレッドのバッファ。なければ登録する
+        @return 未初期化か、スレッド数が上限を超えればNULL
+        */
+        static ProfileThreadBuffer* getThreadBuffer();
+
+        static void setThreadName(const Char* name);
+
+        /// フレーム境界
+        static void frame();
+        inline static u64 getFrame();
+
+        static void counter(const Char* name, f64 value);
+
+        static s32 getNumThreads();
+        static ProfileThreadBuffer* getThread(s32 index);
+
+        /**
+        @brief スレッドのバッファを書き込みと並行して読む
+        @return 書き出したイベント数。読んでいる間に上書きされたイベントは含まない
+        @param events ... バッファの容量以上の大きさ
+        */
+        static s32 snapshot(s32 index, ProfileEvent* events);
+        static s32 getEventsPerThread();
+
+        /**
+        @brief Chrome trace_event形式のJSONで書き出す
+        @return 書き出したイベント数、失敗すれば-1
+        */
+        static s32 exportChromeTrace(File& file);
+        static s32 exportChromeTrace(const Char* filepath);
+    private:
+        Profiler() = delete;
+
+        static s32 eventsPerThread_;
+        static volatile s32 generation_;
+        static volatile s32 numThreads_;
+        static ProfileThreadBuffer* volatile threads_[MaxThreads];
+        static u64 frame_;
+        static u64 startTime_;
+    };
+
+    inline u64 Profiler::getFrame()
+    {
+        return frame_;
+    }
+
+    //---------------------------------------------------------------
+    //---
+    //--- ProfileScope
+    //---
+    //---------------------------------------------------------------
+    class ProfileScope
+    {
+    public:
+        inline explicit ProfileScope(const Char* name)
+            :buffer_(Profiler::getThreadBuffer())
+            ,name_(name)
+        {
+            if(NULL != buffer_){
+                buffer_->beginZone();
+                begin_ = Timestamp::now();
+            }
+        }
+
+        inline ~ProfileScope()
+        {
+            if(NULL != buffer_){
+                buffer_->endZone(name_, begin_, Timestamp::now());
+            }
+        }
+    private:
+        ProfileScope(const ProfileScope&) = delete;
+        ProfileScope& operator=(const ProfileScope&) = delete;
+
+        ProfileThreadBuffer* buffer_;
+        const Char* name_;
+        u64 begin_;
+    };
+}
+
+#define LPROFILE_CONCAT_IMPL(x, y) x##y
+#define LPROFILE_CONCAT(x, y) LPROFILE_CONCAT_IMPL(x, y)
+
+#if defined(LENABLE_PROFILE)
+#define LPROFILE_SCOPE(name) lcore::ProfileScope LPROFILE_CONCAT(lprofileScope, __LINE__)(name)
+#define LPROFILE_COUNTER(name, value) lcore::Profiler::counter((name), static_cast<lcore::f64>(value))
+#define LPROFILE_FRAME() lcore::Profiler::frame()
+#define LPROFILE_THREAD_NAME(name) lcore::Profiler::setThreadName(name)
+#else
+#define LPROFILE_SCOPE(name)
+#define LPROFILE_COUNTER(name, value)
+#define LPROFILE_FRAME()
+#define LPROFILE_THREAD_NAME(name)
+#endif
+
+#endif //INC_LCORE_PROFILER_H_
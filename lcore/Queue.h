@@ -12,6 +12,7 @@ namespace lcore
     template<class T, class IncSize= ArrayStaticCapacityIncrement<16>, class Allocator=DefaultAllocator>
     class QueuePOD : public IncSize
     {
+        LSTATIC_ASSERT(is_trivially_relocatable<T>::value, "QueuePOD requires trivially relocatable type");
     public:
         typedef QueuePOD<T, IncSize, Allocator> this_type;
         typedef T value_type;
@@ -56,7 +57,14 @@ namespace lcore
         inline size_type size() const;
 
         void push_front(const_reference_type item);
+        void push_front(value_type&& item);
         void push_back(const_reference_type item);
+        void push_back(value_type&& item);
+
+        template<class... Args>
+        void emplace_front(Args&&... args);
+        template<class... Args>
+        void emplace_back(Args&&... args);
 
         const_reference_type pop_front();
         const_reference_type pop_back();
@@ -80,12 +88,16 @@ namespace lcore
         this_type& operator=(const this_type& queue);
 
         void expand();
+        pointer_type allocate(size_type capacity);
+        void relocate(pointer_type items, size_type capacity);
         size_type beginCursor() const;
+        inline pointer_type reserve_front();
+        inline pointer_type reserve_back();
 
         size_type next_;
         size_type size_;
         size_type capacity_;
-        size_type* items_;
+        pointer_type items_;
     };
 
     template<class T, class IncSize, class Allocator>
@@ -111,6 +123,68 @@ namespace lcore
 
     template<class T, class IncSize, class Allocator>
     void QueuePOD<T, IncSize, Allocator>::push_front(const_reference_type item)
+    {
+        //Copy before expanding, because item may refer to the old buffer
+        value_type tmp(item);
+        *reserve_front() = lcore::move(tmp);
+    }
+
+    template<class T, class IncSize, class Allocator>
+    void QueuePOD<T, IncSize, Allocator>::push_front(value_type&& item)
+    {
+        value_type tmp(lcore::move(item));
+        *reserve_front() = lcore::move(tmp);
+    }
+
+    template<class T, class IncSize, class Allocator>
+    void QueuePOD<T, IncSize, Allocator>::push_back(const_reference_type item)
+    {
+        value_type tmp(item);
+        *reserve_back() = lcore::move(tmp);
+    }
+
+    template<class T, class IncSize, class Allocator>
+    void QueuePOD<T, IncSize, Allocator>::push_back(value_type&& item)
+    {
+        value_type tmp(lcore::move(item));
+        *reserve_back() = lcore::move(tmp);
+    }
+
+    template<class T, class IncSize, class Allocator>
+    template<class... Args>
+    void QueuePOD<T, IncSize, Allocator>::emplace_front(Args&&... args)
+    {
+        if(size_<capacity_){
+            LPLACEMENT_NEW(reserve_front()) value_type(lcore::forward<Args>(args)...);
+            return;
+        }
+        //Construct new item first, because arguments may refer to old items.
+        //After relocation the front slot is the last one of the new buffer
+        size_type next_capacity = inc_size_type::getNewCapacity(capacity_);
+        pointer_type items = allocate(next_capacity);
+        LPLACEMENT_NEW(&items[next_capacity-1]) value_type(lcore::forward<Args>(args)...);
+        relocate(items, next_capacity);
+        reserve_front();
+    }
+
+    template<class T, class IncSize, class Allocator>
+    template<class... Args>
+    void QueuePOD<T, IncSize, Allocator>::emplace_back(Args&&... args)
+    {
+        if(size_<capacity_){
+            LPLACEMENT_NEW(reserve_back()) value_type(lcore::forward<Args>(args)...);
+            return;
+        }
+        //Construct new item first, because arguments may refer to old items
+        size_type next_capacity = inc_size_type::getNewCapacity(capacity_);
+        pointer_type items = allocate(next_capacity);
+        LPLACEMENT_NEW(&items[size_]) value_type(lcore::forward<Args>(args)...);
+        relocate(items, next_capacity);
+        reserve_back();
+    }
+
+    template<class T, class IncSize, class Allocator>
+    inline typename QueuePOD<T, IncSize, Allocator>::pointer_type QueuePOD<T, IncSize, Allocator>::reserve_front()
     {
         if(capacity_<=size_){
             expand();
@@ -120,22 +194,23 @@ namespace lcore
         if(next_front<0){
             next_front += capacity_;
         }
-        items_[next_front] = item;
         ++size_;
+        return &items_[next_front];
     }
 
     template<class T, class IncSize, class Allocator>
-    void QueuePOD<T, IncSize, Allocator>::push_back(const_reference_type item)
+    inline typename QueuePOD<T, IncSize, Allocator>::pointer_type QueuePOD<T, IncSize, Allocator>::reserve_back()
     {
         if(capacity_<=size_){
             expand();
         }
-        items_[next_] = item;
+        pointer_type item = &items_[next_];
         ++next_;
         if(capacity_<=next_){
             next_ = 0;
         }
         ++size_;
+        return item;
     }
 
     template<class T, class IncSize, class Allocator>
@@ -238,32 +313,37 @@ namespace lcore
     void QueuePOD<T, IncSize, Allocator>::expand()
     {
         size_type next_capacity = inc_size_type::getNewCapacity(capacity_);
-        pointer_type items = (pointer_type)LALLOCATOR_MALLOC(allocator_type, sizeof(value_type)*next_capacity);
+        relocate(allocate(next_capacity), next_capacity);
+    }
+
+    template<class T, class IncSize, class Allocator>
+    typename QueuePOD<T, IncSize, Allocator>::pointer_type QueuePOD<T, IncSize, Allocator>::allocate(size_type capacity)
+    {
+        LASSERT(size_<capacity);
+        pointer_type items = (pointer_type)LALLOCATOR_MALLOC(allocator_type, sizeof(value_type)*capacity);
 #if _DEBUG
-        lcore::memset(items, 0xFF, sizeof(value_type)*next_capacity);
+        lcore::memset(items, 0xFF, sizeof(value_type)*capacity);
 #endif
-        size_type src = next_-size_;
-        size_type dst = src;
-        if(src<0){
-            src += capacity_;
-        }
-        if(dst<0){
-            dst += next_capacity;
-        }
+        return items;
+    }
 
-        for(size_type i=0; i<size_; ++i){
-            items[dst] = items_[src];
-            if(capacity_<=++src){
-                src = 0;
-            }
-            if(next_capacity<=++dst){
-                dst = 0;
-            }
+    template<class T, class IncSize, class Allocator>
+    void QueuePOD<T, IncSize, Allocator>::relocate(pointer_type items, size_type next_capacity)
+    {
+        //Items are PODs, copy at most two contiguous runs into the front of the new buffer
+        size_type src = beginCursor();
+        size_type count0 = lcore::minimum(size_, capacity_-src);
+        size_type count1 = size_-count0;
+        if(0<count0){
+            lcore::memcpy(items, items_+src, sizeof(value_type)*count0);
+        }
+        if(0<count1){
+            lcore::memcpy(items+count0, items_, sizeof(value_type)*count1);
         }
         LALLOCATOR_FREE(allocator_type, items_);
         items_ = items;
         capacity_ = next_capacity;
-        next_ = dst;
+        next_ = (size_<next_capacity)? size_ : 0;
     }
 
     template<class T, class IncSize, class Allocator>
@@ -164,6 +164,13 @@ namespace lcore
         */
         f64 drand();
 
+        /**
+        @brief 2^64回分進める
+
+        コピーしてからjumpすれば、重ならない系列を作れる
+        */
+        void jump();
+
         void swap(RandXorshift128Plus& rhs);
     private:
         u64 s0_;
@@ -208,6 +215,13 @@ namespace lcore
         */
         f64 drand();
 
+        /**
+        @brief 2^64回分進める
+
+        コピーしてからjumpすれば、重ならない系列を作れる
+        */
+        void jump();
+
         void swap(RandXorshift128Plus32& rhs);
     private:
         u64 s0_;
@@ -216,6 +230,89 @@ namespace lcore
         s32 flag_;
     };
 
+    //---------------------------------------------
+    //---
+    //--- RandXorshift128Plus32x8
+    //---
+    //---------------------------------------------
+    /**
+    @brief 8系列のxorshift128+で配列をまとめて埋める
+
+    系列iはRandXorshift128Plusをi回jumpした状態から始まり、各系列の64bitの上位32bitを使う。
+    値はi番目のステップのLanes個が順に並ぶ。AVX2、SSE2、スカラのどれで生成しても同じ値になる。
+    命令セットは構築時にCPUに合わせて決まり、setSIMDで狭めることができる。
+    countがLanesの倍数でなければ、最後のステップの余りは捨てる。
+
+    スレッドごとに使う場合は、コピーを渡してからjumpする。
+    */
+    class RandXorshift128Plus32x8
+    {
+    public:
+        static const s32 Lanes = 8;
+
+        enum SIMD
+        {
+            SIMD_Scalar = 0,
+            SIMD_SSE2,
+            SIMD_AVX2,
+        };
+
+        /// CPUが対応する最も広い命令セット. 結果は最初の呼び出しで決まる
+        static SIMD getSupportedSIMD();
+
+        RandXorshift128Plus32x8();
+        explicit RandXorshift128Plus32x8(u64 seed);
+        ~RandXorshift128Plus32x8();
+
+        /**
+        @brief 擬似乱数生成器初期化
+        @param seed
+        */
+        void srand(u64 seed);
+
+        /**
+        @brief 0 - 0xFFFFFFFFUの乱数生成
+        */
+        void rand(s32 count, u32* values);
+
+        /**
+        @brief 0.0 - 0.99999994の乱数生成
+        */
+        void frand2(s32 count, f32* values);
+
+        /**
+        @brief [vmin, vmax)の乱数生成。剰余の代わりに乗算で縮める
+        */
+        void range_ropen(s32 count, u32* values, u32 vmin, u32 vmax);
+
+        /**
+        @brief [vmin, vmax)の乱数生成
+        */
+        void range_ropen(s32 count, f32* values, f32 vmin, f32 vmax);
+
+        /**
+        @brief 全系列をLanes*2^64回分進める
+        */
+        void jump();
+
+        /**
+        @brief 生成に使う命令セットを決める
+        @param simd ... CPUが対応していなければ対応する中で最も広いものになる
+        */
+        void setSIMD(SIMD simd);
+
+        /// 生成に使う命令セット
+        SIMD getSIMD() const{ return simd_;}
+
+        void swap(RandXorshift128Plus32x8& rhs);
+    private:
+        void initializeLanes();
+
+        u64 s0_[Lanes];
+        u64 s1_[Lanes];
+        SIMD simd_;
+    };
+
     //---------------------------------------------
     //---
     //--- RandWELL
@@ -7,6 +7,7 @@
 */
 #include "lcore.h"
 #include "Sort.h"
+#include "Array.h"
 
 namespace lcore
 {
@@ -201,5 +202,201 @@ namespace lcore
             return insert(context, rightNode, x, y+leftNode.height_, rightNode.width_, rightNode.height_, id, rects);
         }
     }
+
+    //----------------------------------------------------
+    //---
+    //--- RectPackStatistics
+    //---
+    //----------------------------------------------------
+    struct RectPackStatistics
+    {
+        s32 numRects_;
+        s32 numFreeRects_; ///< 󂫗̈̒fА
+        s64 usedArea_; ///< zű`̖ʐ
+        s64 freeArea_; ///< ꂩzuɎgʐ
+        f32 occupancy_; ///< usedArea_/Ŝ̖ʐ
+    };
+
+    //----------------------------------------------------
+    //---
+    //--- SkylinePack
+    //---
+    //----------------------------------------------------
+    /**
+    @brief XJCC@(bottom-left)1zu
+
+    XJCC艺̌Ԃ͎gȂB폜`́AXJCC̏[ɂƂ󂫂ɖ߂B
+    */
+    class SkylinePack
+    {
+    public:
+        SkylinePack();
+        ~SkylinePack();
+
+        void initialize(u16 width, u16 height);
+        /// ׂĂ̋`폜
+        void clear();
+
+        /**
+        @return zułȂfalse
+        */
+        bool insert(u16& x, u16& y, u16 width, u16 height);
+
+        /**
+        @return 󂫂ɖ߂true
+        */
+        bool remove(u16 x, u16 y, u16 width, u16 height);
+
+        template<class T>
+        bool insert(T& rect);
+        template<class T>
+        bool remove(const T& rect);
+
+        inline u16 getWidth() const;
+        inline u16 getHeight() const;
+        void getStatistics(RectPackStatistics& statistics) const;
+    private:
+        SkylinePack(const SkylinePack&) = delete;
+        SkylinePack& operator=(const SkylinePack&) = delete;
+
+        struct Segment
+        {
+            s32 x_;
+            s32 y_;
+            s32 width_;
+        };
+
+        /// [x, x+width)̍yɂ
+        void setLevel(s32 x, s32 width, s32 y);
+
+        u16 width_;
+        u16 height_;
+        s32 numRects_;
+        s64 usedArea_;
+        Array<Segment> segments_;
+    };
+
+    template<class T>
+    bool SkylinePack::insert(T& rect)
+    {
+        return insert(rect.X(), rect.Y(), rect.W(), rect.H());
+    }
+
+    template<class T>
+    bool SkylinePack::remove(const T& rect)
+    {
+        return remove(rect.X(), rect.Y(), rect.W(), rect.H());
+    }
+
+    inline u16 SkylinePack::getWidth() const
+    {
+        return width_;
+    }
+
+    inline u16 SkylinePack::getHeight() const
+    {
+        return height_;
+    }
+
+    //----------------------------------------------------
+    //---
+    //--- GuillotinePack
+    //---
+    //----------------------------------------------------
+    /**
+    @brief 󂫗̈悩IŁAM`1zu
+
+    ؂ŎA폜ŌZ킪󂢂番Ö̗ɌB
+    ZłȂׂ荇󂫂͌ȂB
+    */
+    class GuillotinePack
+    {
+    public:
+        enum Heuristic
+        {
+            Heuristic_BestAreaFit = 0, ///< c̖ʐςŏ̋
+            Heuristic_BestShortSideFit, ///< c̒Zӂŏ̋
+        };
+
+        GuillotinePack();
+        ~GuillotinePack();
+
+        void initialize(u16 width, u16 height, Heuristic heuristic=Heuristic_BestAreaFit);
+        /// ׂĂ̋`폜
+        void clear();
+
+        /**
+        @return zułȂfalse
+        */
+        bool insert(u16& x, u16& y, u16 width, u16 height);
+
+        /// zu`폜
+        void remove(u16 x, u16 y, u16 width, u16 height);
+
+        template<class T>
+        bool insert(T& rect);
+        template<class T>
+        void remove(const T& rect);
+
+        inline u16 getWidth() const;
+        inline u16 getHeight() const;
+        void getStatistics(RectPackStatistics& statistics) const;
+    private:
+        GuillotinePack(const GuillotinePack&) = delete;
+        GuillotinePack& operator=(const GuillotinePack&) = delete;
+
+        /// 󂫁Azuς݂̗tA2ɕ
+        struct Node
+        {
+            s32 x_;
+            s32 y_;
+            s32 width_;
+            s32 height_;
+            s32 parent_;
+            s32 child_; ///< q̑g̐擪BtȂ-1Agp̑gł͎̖gp̑g
+            s32 free_; ///< 󂫂̗tȂfreeLeaves_̈ʒuAȊO-1
+        };
+
+        s32 score(const Node& node, s32 width, s32 height) const;
+        s32 popPair();
+        void pushPair(s32 index);
+        void addFree(s32 index);
+        void removeFree(s32 index);
+        /// t𕪊āApwidth x height̗t
+        s32 split(s32 index, s32 width, s32 height);
+        /// Z킪󂫂Ȃeɖ߂
+        void coalesce(s32 index);
+
+        u16 width_;
+        u16 height_;
+        s32 heuristic_;
+        s32 numRects_;
+        s64 usedArea_;
+        s32 freePair_;
+        Array<Node> nodes_;
+        Array<s32> freeLeaves_;
+    };
+
+    template<class T>
+    bool GuillotinePack::insert(T& rect)
+    {
+        return insert(rect.X(), rect.Y(), rect.W(), rect.H());
+    }
+
+    template<class T>
+    void GuillotinePack::remove(const T& rect)
+    {
+        remove(rect.X(), rect.Y(), rect.W(), rect.H());
+    }
+
+    inline u16 GuillotinePack::getWidth() const
+    {
+        return width_;
+    }
+
+    inline u16 GuillotinePack::getHeight() const
+    {
+        return height_;
+    }
 }
 #endif //INC_LCORE_RECTPACK_H_
@@ -0,0 +1,205 @@
+﻿#ifndef INC_LCORE_REFCOUNT_H_
+#define INC_LCORE_REFCOUNT_H_
+/**
+@file RefCount.h
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "lcore.h"
+#include "Array.h"
+#include "SyncObject.h"
+
+namespace lcore
+{
+    //---------------------------------------------------
+    //---
+    //--- RefCountSingleThread
+    //---
+    //---------------------------------------------------
+    /**
+    @brief 単一スレッド用. アトミック命令を使わない
+    */
+    struct RefCountSingleThread
+    {
+        static inline s32 load(const s32& count)
+        {
+            return count;
+        }
+
+        static inline void increment(s32& count)
+        {
+            ++count;
+        }
+
+        /// @return 減算後の値
+        static inline s32 decrement(s32& count)
+        {
+            return --count;
+        }
+    };
+
+    //---------------------------------------------------
+    //---
+    //--- RefCountMultiThread
+    //---
+    //---------------------------------------------------
+    /**
+    @brief スレッド間で共有する用
+
+    増加は参照元が既に参照を持っているので順序付け不要.
+    減少はacquire-releaseで, 他スレッドの書き込みを見てから破棄する.
+    */
+    struct RefCountMultiThread
+    {
+        static inline s32 load(const s32& count)
+        {
+            return atomicLoadRelaxed(count);
+        }
+
+        static inline void increment(s32& count)
+        {
+            atomicAddRelaxed(count, 1);
+        }
+
+        /// @return 減算後の値
+        static inline s32 decrement(s32& count)
+        {
+            return atomicAddAcqRel(count, -1) - 1;
+        }
+    };
+
+    //---------------------------------------------------
+    //---
+    //--- RefCount
+    //---
+    //---------------------------------------------------
+    /**
+    @brief 参照カウント
+
+    intrusive_ptr_addref/intrusive_ptr_releaseの実装に使う.
+    コピーしても参照数は引き継がない.
+    */
+    template<class Policy>
+    class RefCount
+    {
+    public:
+        typedef Policy policy_type;
+
+        RefCount()
+            :count_(0)
+        {}
+
+        RefCount(const RefCount&)
+            :count_(0)
+        {}
+
+        ~RefCount()
+        {}
+
+        RefCount& operator=(const RefCount&)
+        {
+            return *this;
+        }
+
+        inline s32 get() const
+        {
+            return Policy::load(count_);
+        }
+
+        inline void addRef()
+        {
+            Policy::increment(count_);
+        }
+
+        /// @return 0になったらtrue
+        inline bool release()
+        {
+            LASSERT(0<get());
+            return 0 == Policy::decrement(count_);
+        }
+
+        /// 他スレッドから参照されていないこと
+        inline void reset()
+        {
+            count_ = 0;
+        }
+
+        /// 他スレッドから参照されていないこと
+        inline void swap(RefCount& rhs)
+        {
+            lcore::swap(count_, rhs.count_);
+        }
+    private:
+        s32 count_;
+    };
+
+    //---------------------------------------------------
+    //---
+    //--- DeferredReleaseQueue
+    //---
+    //---------------------------------------------------
+    /**
+    @brief 解放の遅延キュー
+
+    pushはどのスレッドからでも呼べる.
+    processは1フレームに1回, 所有スレッドから呼び, 前回のprocess以降に積まれたものを解放する.
+    解放中に積まれたものは次のprocessで解放する.
+    */
+    class DeferredReleaseQueue
+    {
+    public:
+        typedef void(*ReleaseFunc)(void* ptr);
+
+        DeferredReleaseQueue();
+
+        /// 残りをすべて解放する
+        ~DeferredReleaseQueue();
+
+        /**
+        @brief 追加
+        @param ptr ... 解放するオブジェクト
+        @param func ... 解放関数
+        */
+        void push(void* ptr, ReleaseFunc func);
+
+        /**
+        @brief 追加. LDELETE_RAWで解放する
+        */
+        template<class T>
+        void push(T* ptr)
+        {
+            push(ptr, &DeferredReleaseQueue::deleteRaw<T>);
+        }
+
+        /**
+        @brief 解放
+        @return 解放した数
+        */
+        s32 process();
+
+        /// 未処理の数
+        s32 size() const;
+    private:
+        DeferredReleaseQueue(const DeferredReleaseQueue&);
+        DeferredReleaseQueue& operator=(const DeferredReleaseQueue&);
+
+        template<class T>
+        static void deleteRaw(void* ptr)
+        {
+            T* t = static_cast<T*>(ptr);
+            LDELETE_RAW(t);
+        }
+
+        struct Entry
+        {
+            void* ptr_;
+            ReleaseFunc func_;
+        };
+        typedef Array<Entry, ArrayStaticCapacityIncrement<64> > EntryArray;
+
+        mutable SpinLock lock_;
+        EntryArray pending_;
+        EntryArray processing_;
+    };
+}
+#endif //INC_LCORE_REFCOUNT_H_
@@ -7,6 +7,7 @@
 */
 #include "lcore.h"
 
+#if defined(_WIN32)
 #ifndef WIN32_LEAN_AND_MEAN
 #define WIN32_LEAN_AND_MEAN
 #endif
@@ -14,6 +15,27 @@
 #include <winsock2.h>
 #include <ws2tcpip.h>
 #include <iphlpapi.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#endif
+
+#if defined(__linux__)
+#include <netinet/udp.h>
+#define LCORE_SOCKET_MMSG 1
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+struct mmsghdr;
+#endif
 
 namespace lcore
 {
@@ -48,9 +70,15 @@ namespace lcore
     /// shutdownに使用
     enum Shut
     {
+#if defined(_WIN32)
         Shut_RECEIVE = SD_RECEIVE,
         Shut_SEND    = SD_SEND,
         Shut_BOTH    = SD_BOTH,
+#else
+        Shut_RECEIVE = SHUT_RD,
+        Shut_SEND    = SHUT_WR,
+        Shut_BOTH    = SHUT_RDWR,
+#endif
     };
 
     enum SocketOption
@@ -61,11 +89,16 @@ namespace lcore
         SocketOption_KEEPALIVE = SO_KEEPALIVE,
         SocketOption_DONTROUTE = SO_DONTROUTE,
         SocketOption_BROADCAST = SO_BROADCAST,
-        SocketOption_USELOOPBACK = SO_USELOOPBACK,
         SocketOption_LINGER = SO_LINGER,
         SocketOption_OOBINLINE = SO_OOBINLINE,
+#if defined(_WIN32)
+        SocketOption_USELOOPBACK = SO_USELOOPBACK,
         SocketOption_DONTLINGER = SO_DONTLINGER,
         SocketOption_EXCLUSIVEADDRUSE = SO_EXCLUSIVEADDRUSE,
+#endif
+#if defined(SO_REUSEPORT)
+        SocketOption_REUSEPORT = SO_REUSEPORT,
+#endif
 
         SocketOption_SNDBUF = SO_SNDBUF,
         SocketOption_RCVBUF = SO_RCVBUF,
@@ -80,6 +113,7 @@ namespace lcore
 
     enum SocketError
     {
+#if defined(_WIN32)
         SocketError_EINTR = WSAEINTR, //Interrupted function call
         SocketError_EACCESS = WSAEACCES, //Permission denied
         SocketError_EFAULT = WSAEFAULT, //Bad address
@@ -123,6 +157,41 @@ namespace lcore
         SocketError_ETRY_AGAIN = WSATRY_AGAIN, //Nonauthoritative host not found
         SocketError_ENO_RECOVERY = WSANO_RECOVERY, //This is a nonrecoverable error
         SocketError_ENO_DATA_ = WSANO_DATA, //Valid name, no data record of requested type
+#else
+        SocketError_EINTR = EINTR, //Interrupted function call
+        SocketError_EACCESS = EACCES, //Permission denied
+        SocketError_EFAULT = EFAULT, //Bad address
+        SocketError_EINVAL = EINVAL, //Invalid argument
+        SocketError_EMFILE = EMFILE, //Too many open files
+        SocketError_EWOULDBLOCK = EWOULDBLOCK, //Resource temporarily unavailable
+        SocketError_EINPROGRESS = EINPROGRESS, //Operation now in progress
+        SocketError_EALREADY = EALREADY, //Operation already in progress
+        SocketError_ENOTSOCK = ENOTSOCK, //Socket operation on nonsocket
+        SocketError_EDESTANDDRREQ = EDESTADDRREQ, //Destination address required
+        SocketError_EMSGSIZE = EMSGSIZE, //Message too long
+        SocketError_EPROTOTYPE = EPROTOTYPE, //Protocol wrong type for socket
+        SocketError_ENOPROTOOPT = ENOPROTOOPT, //Bad protocol option
+        SocketError_EPROTONOSUPPORT = EPROTONOSUPPORT, //Protocol not supported
+        SocketError_ESOCKTNOSUPPORT = ESOCKTNOSUPPORT, //Socket type not supported
+        SocketError_EOPNOTSUPP = EOPNOTSUPP, //Operation not supported
+        SocketError_EPFNOSUPPORT = EPFNOSUPPORT, //Protocol family not supported
+        SocketError_EAFNOSUPPORT = EAFNOSUPPORT, //Address family not supported by protocol family
+        SocketError_EADDRINUSE = EADDRINUSE, //Address already in use
+        SocketError_EADDRNOTAVAIL = EADDRNOTAVAIL, //Cannot assign requested address
+        SocketError_ENETDOWN = ENETDOWN, //Network is down
+        SocketError_ENETUNREACH = ENETUNREACH, //Network is unreachable
+        SocketError_ENETRESET = ENETRESET, //Network dropped connection on reset
+        SocketError_ECONNABORTED = ECONNABORTED, //Software caused connection abort
+        SocketError_ECONNRESET = ECONNRESET, //Connection reset by peer
+        SocketError_ENOBUFS = ENOBUFS, //No buffer space available
+        SocketError_EISCONN = EISCONN, //Socket is already connected
+        SocketError_ENOTCONN = ENOTCONN, //Socket is not connected
+        SocketError_ESHUTDOWN = ESHUTDOWN, //Cannot send after socket shutdown
+        SocketError_ETIMEOUT = ETIMEDOUT, //Connection timed out
+        SocketError_ECONNREFUSED = ECONNREFUSED, //Connection refused
+        SocketError_EHOSTDOWN = EHOSTDOWN, //Host is down
+        SocketError_EHOSTUNREACH = EHOSTUNREACH, //No route to host
+#endif
     };
 
     static const u64 InAddrAny = INADDR_ANY;
@@ -130,11 +199,29 @@ namespace lcore
     class SocketBase;
     class FDSet;
     class NetworkBuffer;
+    class PacketArena;
+    class PacketCounter;
+    class Socket;
 
 #ifndef _WIN32
     typedef s32 SOCKET;
+    typedef sockaddr SOCKADDR;
+    static const SOCKET INVALID_SOCKET = -1;
+    static const s32 SOCKET_ERROR = -1;
 #endif
 
+    /**
+    @brief 直前のソケット操作が、ブロックするため完了しなかったか
+    */
+    inline bool isSocketWouldBlock(s32 error)
+    {
+#if defined(_WIN32)
+        return WSAEWOULDBLOCK == error;
+#else
+        return EWOULDBLOCK == error || EAGAIN == error;
+#endif
+    }
+
     //----------------------------------------------------
     //---
     //--- SocketUtil
@@ -145,10 +232,27 @@ namespace lcore
     public:
         static u64 getIP(Family family, const Char* ipInString);
         static bool getIPString(Family family, Char* dst, u32 size, u64 ip);
-        static u16 htons(u16 port);
-        static u16 ntohs(u16 port);
+        //Parenthesized, htons/ntohs may be macros
+        static u16 (htons)(u16 port);
+        static u16 (ntohs)(u16 port);
 
         static s32 select(s32 nfds, fd_set* readfds, fd_set* writefds, fd_set* exceptfds, const timeval* timeout);
+
+        /**
+        @brief 同じポートで待ち受けるUDPソケット群を作成
+
+        count>1ならSO_REUSEPORTを設定し、カーネルが送信元毎にソケットへ振り分ける。ワーカースレッド毎にひとつ使う。
+        @return 成否
+        @param sockets ... 出力。count個
+        @param port ... ポート
+        @param acceptIP ... 受け付けるIP
+        */
+        static bool createDatagramGroup(Socket* sockets, s32 count, u16 port, u64 acceptIP);
+
+        /**
+        @brief UDP_SEGMENT（GSO）が使用可能か。一度カーネルに拒否されると、以降はfalse
+        */
+        static bool isUDPSegmentAvailable();
     };
 
     //----------------------------------------------------
@@ -185,7 +289,9 @@ namespace lcore
 
         static SocketSystem instance_;
 
+#if defined(_WIN32)
         WSADATA wsaData_; /// Windowsソケット初期化情報
+#endif
     };
 
     //----------------------------------------------------
@@ -337,11 +443,16 @@ namespace lcore
         template<class T>
         s32 setOption(SocketOption name, const T* val)
         {
-            return setOption(name, static_cast<const Char*>(val), sizeof(T));
+            return setOption(name, reinterpret_cast<const Char*>(val), sizeof(T));
         }
 
         bool setNonBlock();
 
+        /**
+        @brief Nagleアルゴリズムの有効・無効
+        */
+        bool setNoDelay(bool enable);
+
         /**
         @brief
         */
@@ -363,6 +474,36 @@ namespace lcore
 
         inline s32 sendto(const Char* buff, s32 len, s32 flags, const SOCKADDR* to, s32 tolen);
 
+        /**
+        @brief 複数のデータグラムを受信
+
+        Linuxではrecvmmsgで一回のシステムコールで受信する。空きスロットがなくなるか、ブロックするまで受信する。
+        @return 受信したパケット数。失敗なら-1
+        @param arena ... 未使用のスロットに受信し、sizeを進める
+        @param counter ... 統計。NULL可
+        */
+        s32 recvBatch(PacketArena& arena, s32 flags, PacketCounter* counter=NULL);
+
+        /**
+        @brief 複数のデータグラムを送信
+
+        Linuxではsendmmsgで一回のシステムコールで送信する。
+        @return 送信したパケット数。失敗なら-1
+        @param arena ... 送信するパケット
+        @param offset ... 先頭パケットのインデックス
+        @param count ... パケット数
+        @param counter ... 統計。NULL可
+        */
+        s32 sendBatch(PacketArena& arena, s32 offset, s32 count, s32 flags, PacketCounter* counter=NULL);
+
+        /**
+        @brief 連続したデータをsegmentSize毎のデータグラムに分割して送信
+
+        UDP_SEGMENTが使用可能ならカーネルで分割する。使用できなければsendtoを繰り返す。
+        @return 送信したバイト数。失敗なら-1
+        */
+        s32 sendSegments(const Char* buff, s32 len, s32 segmentSize, s32 flags, const SOCKADDR* to, s32 tolen, PacketCounter* counter=NULL);
+
         /**
         @brief 指定方向の接続を閉じる
         @return 成否
@@ -446,7 +587,7 @@ namespace lcore
         LASSERT(buff != NULL);
         LASSERT(len > 0);
 
-        return ::recv(socket_, buff, len, flags);
+        return static_cast<s32>(::recv(socket_, buff, len, flags));
     }
 
     // バイト受信
@@ -456,7 +597,14 @@ namespace lcore
         LASSERT(buff != NULL);
         LASSERT(len > 0);
 
+#if defined(_WIN32)
         return ::recvfrom(socket_, buff, len, flags, from, fromlen);
+#else
+        socklen_t length = static_cast<socklen_t>(*fromlen);
+        s32 ret = static_cast<s32>(::recvfrom(socket_, buff, len, flags, from, &length));
+        *fromlen = static_cast<s32>(length);
+        return ret;
+#endif
     }
 
     // バイト送信
@@ -466,7 +614,12 @@ namespace lcore
         LASSERT(buff != NULL);
         LASSERT(len > 0);
 
+#if defined(_WIN32)
         return ::send(socket_, buff, len, flags);
+#else
+        //Report broken pipes as errors, not signals
+        return static_cast<s32>(::send(socket_, buff, len, flags|MSG_NOSIGNAL));
+#endif
     }
 
     // バイト送信
@@ -476,7 +629,11 @@ namespace lcore
         LASSERT(buff != NULL);
         LASSERT(len > 0);
 
+#if defined(_WIN32)
         return ::sendto(socket_, buff, len, flags, to, tolen);
+#else
+        return static_cast<s32>(::sendto(socket_, buff, len, flags|MSG_NOSIGNAL, to, static_cast<socklen_t>(tolen)));
+#endif
     }
 
     //----------------------------------------------------
@@ -570,6 +727,252 @@ namespace lcore
             SocketBase::swap(rhs);
         }
     };
+
+    //----------------------------------------------------
+    //---
+    //--- NetworkBuffer
+    //---
+    //----------------------------------------------------
+    /**
+    @brief 送受信用リングバッファ
+
+    容量は2のべき乗に切り上げる。ノンブロッキングソケットに対して、ブロックするまで送受信する。
+    */
+    class NetworkBuffer
+    {
+    public:
+        enum Result
+        {
+            Result_WouldBlock = 0, /// これ以上送受信できない
+            Result_Full, /// 受信バッファが一杯、または送信バッファが空
+            Result_Closed, /// 相手が接続を閉じた
+            Result_Error, /// エラー
+        };
+
+        NetworkBuffer();
+        explicit NetworkBuffer(s32 capacity);
+        ~NetworkBuffer();
+
+        /**
+        @brief バッファ確保
+        @param capacity ... 最低容量
+        */
+        void initialize(s32 capacity);
+
+        /// 解放
+        void release();
+
+        bool valid() const{ return NULL != buffer_;}
+        s32 capacity() const{ return static_cast<s32>(capacity_);}
+        s32 size() const{ return static_cast<s32>(tail_-head_);}
+        s32 getFreeSize() const{ return static_cast<s32>(capacity_-(tail_-head_));}
+        bool empty() const{ return tail_ == head_;}
+        bool full() const{ return capacity_ == (tail_-head_);}
+
+        void clear()
+        {
+            head_ = tail_ = 0;
+        }
+
+        /**
+        @brief 書き込み
+        @return 書き込んだバイト数
+        */
+        s32 write(const void* data, s32 size);
+
+        /**
+        @brief 読み込み
+        @return 読み込んだバイト数
+        */
+        s32 read(void* data, s32 size);
+
+        /**
+        @brief 読み込み位置を進めずに読み込み
+        @return 読み込んだバイト数
+        */
+        s32 peek(void* data, s32 size) const;
+
+        /**
+        @brief 読み込み位置を進める
+        */
+        void skip(s32 size);
+
+        /**
+        @brief 読み込み可能な連続領域を取得
+        @return 連続領域のバイト数
+        */
+        s32 getReadRegion(const Char*& data) const;
+
+        /**
+        @brief ブロックするかバッファが一杯になるまで受信
+        @param received ... 出力。受信したバイト数
+        */
+        Result recv(SocketBase& socket, s32& received);
+
+        /**
+        @brief ブロックするかバッファが空になるまで送信
+        @param sent ... 出力。送信したバイト数
+        */
+        Result send(SocketBase& socket, s32& sent);
+
+        void swap(NetworkBuffer& rhs);
+    private:
+        NetworkBuffer(const NetworkBuffer&);
+        NetworkBuffer& operator=(const NetworkBuffer&);
+
+        u32 capacity_;
+        u32 head_; /// 読み込み位置。単調増加し、マスクして使用
+        u32 tail_; /// 書き込み位置。単調増加し、マスクして使用
+        Char* buffer_;
+    };
+
+    //----------------------------------------------------
+    //---
+    //--- PacketArena
+    //---
+    //----------------------------------------------------
+    /**
+    @brief データグラム用の事前確保したパケット領域
+
+    固定長スロットを連続して確保する。SocketBase::recvBatch/sendBatchはスロットへ直接送受信し、コピーしない。
+    */
+    class PacketArena
+    {
+    public:
+        static const s32 DefaultPacketSize = 2048;
+        static const s32 Align = 64;
+
+        struct Packet
+        {
+            inline const SOCKADDR* getAddress() const{ return reinterpret_cast<const SOCKADDR*>(&address_);}
+
+            Char* data_; /// スロットの先頭
+            s32 size_; /// データサイズ
+            s32 addressLength_;
+            sockaddr_storage address_; /// 送信元、または送信先
+        };
+
+        PacketArena();
+        PacketArena(s32 maxPackets, s32 packetSize);
+        ~PacketArena();
+
+        /**
+        @brief 領域確保
+        @param maxPackets ... スロット数
+        @param packetSize ... スロットのバイト数
+        */
+        void initialize(s32 maxPackets, s32 packetSize=DefaultPacketSize);
+
+        /// 解放
+        void release();
+
+        inline s32 capacity() const{ return capacity_;}
+        inline s32 size() const{ return size_;}
+        inline bool full() const{ return capacity_<=size_;}
+        inline s32 getPacketSize() const{ return packetSize_;}
+
+        inline void clear(){ size_ = 0;}
+
+        inline Packet& operator[](s32 index)
+        {
+            LASSERT(0<=index && index<capacity_);
+            return packets_[index];
+        }
+
+        inline const Packet& operator[](s32 index) const
+        {
+            LASSERT(0<=index && index<capacity_);
+            return packets_[index];
+        }
+
+        /**
+        @brief 送信用スロットを追加。データはPacket::data_へ直接書き込む
+        @return スロット。空きがなければNULL
+        */
+        Packet* push(const SOCKADDR* to, s32 tolen);
+
+        /**
+        @brief データをコピーしてスロットを追加
+        @return 成否
+        */
+        bool push(const void* data, s32 size, const SOCKADDR* to, s32 tolen);
+
+        void swap(PacketArena& rhs);
+    private:
+        PacketArena(const PacketArena&);
+        PacketArena& operator=(const PacketArena&);
+
+        friend class SocketBase;
+
+        s32 capacity_;
+        s32 packetSize_;
+        s32 size_;
+        Char* buffer_;
+        Packet* packets_;
+#if defined(LCORE_SOCKET_MMSG)
+        mmsghdr* headers_; /// recvmmsg/sendmmsg用
+#endif
+    };
+
+    //----------------------------------------------------
+    //---
+    //--- PacketCounter
+    //---
+    //----------------------------------------------------
+    /**
+    @brief データグラム送受信の統計
+
+    スレッドセーフではない。ワーカー毎に持ち、addで集計する。
+    */
+    class PacketCounter
+    {
+    public:
+        PacketCounter();
+
+        /// カウンタと計測開始時刻をリセット
+        void reset();
+
+        inline void addReceived(s32 packets, s32 bytes)
+        {
+            ++receiveCalls_;
+            receivedPackets_ += packets;
+            receivedBytes_ += bytes;
+        }
+
+        inline void addSent(s32 packets, s32 bytes)
+        {
+            ++sendCalls_;
+            sentPackets_ += packets;
+            sentBytes_ += bytes;
+        }
+
+        /// 他のカウンタを合算
+        void add(const PacketCounter& rhs);
+
+        inline u64 getReceiveCalls() const{ return receiveCalls_;}
+        inline u64 getReceivedPackets() const{ return receivedPackets_;}
+        inline u64 getReceivedBytes() const{ return receivedBytes_;}
+        inline u64 getSendCalls() const{ return sendCalls_;}
+        inline u64 getSentPackets() const{ return sentPackets_;}
+        inline u64 getSentBytes() const{ return sentBytes_;}
+
+        /// resetからの経過秒
+        f64 getElapsedTime() const;
+
+        /// 受信パケット毎秒
+        f64 getReceivedPacketsPerSecond() const;
+
+        /// 送信パケット毎秒
+        f64 getSentPacketsPerSecond() const;
+    private:
+        ClockType start_;
+        u64 receiveCalls_;
+        u64 receivedPackets_;
+        u64 receivedBytes_;
+        u64 sendCalls_;
+        u64 sentPackets_;
+        u64 sentBytes_;
+    };
 }
 
 #endif //INC_LCORE_SOCKET_H_
@@ -278,7 +278,9 @@ namespace lcore
 
         Timsort(comp_type compFunc)
             :compFunc_(compFunc)
-        {}
+        {
+            a_.keys_ = temparray_;
+        }
 
         ~Timsort()
         {
@@ -651,6 +653,7 @@ namespace lcore
     template<class T, class Comp>
     void Timsort<T, Comp>::merge_init(s32 size)
     {
+        merge_free();
         allocated_ = (size + 1)/2;
         if(MERGESTATE_TEMP_SIZE/2<allocated_){
             allocated_ = MERGESTATE_TEMP_SIZE/2;
@@ -449,5 +449,172 @@ namespace thread
         s16 state_;
     };
 #endif
+
+    //-------------------------------------------------------
+    //---
+    //--- Atomic
+    //---
+    //-------------------------------------------------------
+    /// 読み込み。以降のメモリ操作が前に移動しない
+    inline s32 atomicLoad(const volatile s32& value)
+    {
+#if defined(_MSC_VER)
+        s32 x = value;
+        _ReadWriteBarrier();
+        return x;
+#else
+        return __atomic_load_n(&value, __ATOMIC_ACQUIRE);
+#endif
+    }
+
+    /// 書き込み。以前のメモリ操作が後に移動しない
+    inline void atomicStore(volatile s32& value, s32 x)
+    {
+#if defined(_MSC_VER)
+        _ReadWriteBarrier();
+        value = x;
+#else
+        __atomic_store_n(&value, x, __ATOMIC_RELEASE);
+#endif
+    }
+
+    /// @return 以前の値
+    inline s32 atomicExchange(volatile s32& value, s32 x)
+    {
+#if defined(_MSC_VER)
+        return InterlockedExchange(reinterpret_cast<volatile LONG*>(&value), x);
+#else
+        return __atomic_exchange_n(&value, x, __ATOMIC_SEQ_CST);
+#endif
+    }
+
+    /// @return 以前の値。comparandと等しければ交換した
+    inline s32 atomicCompareExchange(volatile s32& value, s32 exchange, s32 comparand)
+    {
+#if defined(_MSC_VER)
+        return InterlockedCompareExchange(reinterpret_cast<volatile LONG*>(&value), exchange, comparand);
+#else
+        __atomic_compare_exchange_n(&value, &comparand, exchange, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+        return comparand;
+#endif
+    }
+
+    /// @return 加算前の値
+    inline s32 atomicAdd(volatile s32& value, s32 x)
+    {
+#if defined(_MSC_VER)
+        return InterlockedExchangeAdd(reinterpret_cast<volatile LONG*>(&value), x);
+#else
+        return __atomic_fetch_add(&value, x, __ATOMIC_SEQ_CST);
+#endif
+    }
+
+    /// @return 加算後の値
+    inline s32 atomicIncrement(volatile s32& value)
+    {
+        return atomicAdd(value, 1) + 1;
+    }
+
+    /// @return 減算後の値
+    inline s32 atomicDecrement(volatile s32& value)
+    {
+        return atomicAdd(value, -1) - 1;
+    }
+
+    /// 順序付けなしの読み込み
+    inline s32 atomicLoadRelaxed(const volatile s32& value)
+    {
+#if defined(_MSC_VER)
+        return value;
+#else
+        return __atomic_load_n(&value, __ATOMIC_RELAXED);
+#endif
+    }
+
+    /// 順序付けなしの加算
+    /// @return 加算前の値
+    inline s32 atomicAddRelaxed(volatile s32& value, s32 x)
+    {
+#if defined(_MSC_VER)
+        return InterlockedExchangeAddNoFence(reinterpret_cast<volatile LONG*>(&value), x);
+#else
+        return __atomic_fetch_add(&value, x, __ATOMIC_RELAXED);
+#endif
+    }
+
+    /// acquire-release加算
+    /// @return 加算前の値
+    inline s32 atomicAddAcqRel(volatile s32& value, s32 x)
+    {
+#if defined(_MSC_VER)
+        return InterlockedExchangeAdd(reinterpret_cast<volatile LONG*>(&value), x);
+#else
+        return __atomic_fetch_add(&value, x, __ATOMIC_ACQ_REL);
+#endif
+    }
+
+    inline s64 atomicLoad(const volatile s64& value)
+    {
+#if defined(_MSC_VER)
+        s64 x = value;
+        _ReadWriteBarrier();
+        return x;
+#else
+        return __atomic_load_n(&value, __ATOMIC_ACQUIRE);
+#endif
+    }
+
+    inline void atomicStore(volatile s64& value, s64 x)
+    {
+#if defined(_MSC_VER)
+        _ReadWriteBarrier();
+        value = x;
+#else
+        __atomic_store_n(&value, x, __ATOMIC_RELEASE);
+#endif
+    }
+
+    inline s64 atomicCompareExchange(volatile s64& value, s64 exchange, s64 comparand)
+    {
+#if defined(_MSC_VER)
+        return InterlockedCompareExchange64(reinterpret_cast<volatile LONGLONG*>(&value), exchange, comparand);
+#else
+        __atomic_compare_exchange_n(&value, &comparand, exchange, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+        return comparand;
+#endif
+    }
+
+    template<class T>
+    inline T* atomicLoad(T* const volatile& value)
+    {
+#if defined(_MSC_VER)
+        T* x = value;
+        _ReadWriteBarrier();
+        return x;
+#else
+        return __atomic_load_n(&value, __ATOMIC_ACQUIRE);
+#endif
+    }
+
+    template<class T>
+    inline T* atomicCompareExchange(T* volatile& value, T* exchange, T* comparand)
+    {
+#if defined(_MSC_VER)
+        return reinterpret_cast<T*>(InterlockedCompareExchangePointer(reinterpret_cast<PVOID volatile*>(&value), exchange, comparand));
+#else
+        __atomic_compare_exchange_n(&value, &comparand, exchange, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+        return comparand;
+#endif
+    }
+
+    /// 前後のメモリ操作を入れ替えない
+    inline void atomicFence()
+    {
+#if defined(_MSC_VER)
+        MemoryBarrier();
+#else
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#endif
+    }
 }
 #endif //INC_LCORE_SYNCOBJECT_H_
@@ -469,6 +469,19 @@ namespace lcore
         WorkerThread** threads_;
     };
 
+    //----------------------------------------------------
+    //---
+    //--- parallelFor
+    //---
+    //----------------------------------------------------
+    typedef void(*ParallelForProc)(void* data, u32 index);
+
+    /**
+    @brief [0, count)をthreadPoolのスレッドと呼び出したスレッドで分けて処理する. 全部終わるまで待つ
+    @param threadPool ... NULLなら呼び出したスレッドだけで処理する
+    */
+    void parallelFor(ThreadPool* threadPool, ParallelForProc proc, void* data, u32 count);
+
     //----------------------------------------------------
     //---
     //--- ThreadAffinity
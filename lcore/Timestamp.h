@@ -0,0 +1,154 @@
+﻿#ifndef INC_LCORE_TIMESTAMP_H_
+#define INC_LCORE_TIMESTAMP_H_
+/**
+@file Timestamp.h
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "lcore.h"
+#include "CPU.h"
+
+namespace lcore
+{
+    //---------------------------------------------------------------
+    //---
+    //--- Timestamp
+    //---
+    //---------------------------------------------------------------
+    /**
+    @brief 低コストなタイムスタンプ
+
+    不変TSCが使え、コア間でずれていなければrdtscを直接読む。
+    そうでなければgetPerformanceCounterにフォールバックする。
+    initialize前はフォールバックの状態で、周波数は0として扱う。
+    */
+    class Timestamp
+    {
+    public:
+        /// コア間のずれの許容値
+        static const s32 DefaultDriftToleranceNanoSeconds = 1000;
+        /// 校正にかける時間
+        static const s32 DefaultCalibrationMilliSeconds = 20;
+
+        /**
+        @brief 初期化。TSCを使えるか判定して校正する
+        @param checkDrift ... コア間のずれを調べるか
+        @return TSCを使うか
+        */
+        static bool initialize(bool checkDrift=true);
+
+        /// TSCを使っているか
+        inline static bool isTSC();
+
+        /// 現在のタイムスタンプ
+        inline static u64 now();
+
+        /// 先行する命令の完了を待ってから読む
+        inline static u64 nowSerialized();
+
+        /// 1秒あたりのカウント数
+        inline static u64 getFrequency();
+
+        /// カウントをナノ秒に変換
+        inline static u64 toNanoSeconds(u64 ticks);
+
+        /// カウントを秒に変換
+        inline static f64 toSeconds(u64 ticks);
+
+        /// 2つのタイムスタンプ間のナノ秒
+        inline static u64 calcNanoSeconds(u64 prev, u64 current);
+
+        /// initializeで観測したコア間のずれの最大値（カウント）
+        inline static u64 getMaxDrift();
+
+        /**
+        @brief コア間のずれを調べる
+
+        2つのスレッドを異なるコアに固定し、ロックを取りながら交互にTSCを読む。
+        後から読んだ値が前の値より小さければ、その差をずれとする。
+        @return 観測したずれの最大値（カウント）
+        @param iterations ... コアの組あたりの読み出し回数
+        */
+        static u64 measureDrift(s32 iterations);
+
+        /// 64bit x 64bitの上位を含む積を右に32bitずらす
+        inline static u64 mulShift32(u64 a, u64 b);
+    private:
+        Timestamp() = delete;
+
+        static u64 calibrate(s32 milliSeconds);
+        static void setFrequency(u64 frequency);
+
+        static bool tsc_;
+        static bool rdtscp_;
+        static u64 frequency_;
+        static u64 nanoSecondsMultiplier_; ///< 32bit固定小数点のナノ秒/カウント
+        static f64 invFrequency_;
+        static u64 maxDrift_;
+    };
+
+    inline bool Timestamp::isTSC()
+    {
+        return tsc_;
+    }
+
+    inline u64 Timestamp::now()
+    {
+#if defined(LCORE_CPU_X86)
+        if(tsc_){
+            return rdtsc();
+        }
+#endif
+        return static_cast<u64>(getPerformanceCounter());
+    }
+
+    inline u64 Timestamp::nowSerialized()
+    {
+#if defined(LCORE_CPU_X86)
+        if(rdtscp_){
+            u32 aux;
+            return rdtscp(aux);
+        }
+        if(tsc_){
+            _mm_lfence();
+            return rdtsc();
+        }
+#endif
+        return static_cast<u64>(getPerformanceCounter());
+    }
+
+    inline u64 Timestamp::getFrequency()
+    {
+        return frequency_;
+    }
+
+    inline u64 Timestamp::mulShift32(u64 a, u64 b)
+    {
+        u64 al = a & 0xFFFFFFFFULL;
+        u64 ah = a >> 32;
+        u64 bl = b & 0xFFFFFFFFULL;
+        u64 bh = b >> 32;
+        return ((ah*bh)<<32) + ah*bl + al*bh + ((al*bl)>>32);
+    }
+
+    inline u64 Timestamp::toNanoSeconds(u64 ticks)
+    {
+        return mulShift32(ticks, nanoSecondsMultiplier_);
+    }
+
+    inline f64 Timestamp::toSeconds(u64 ticks)
+    {
+        return static_cast<f64>(ticks) * invFrequency_;
+    }
+
+    inline u64 Timestamp::calcNanoSeconds(u64 prev, u64 current)
+    {
+        return toNanoSeconds(current-prev);
+    }
+
+    inline u64 Timestamp::getMaxDrift()
+    {
+        return maxDrift_;
+    }
+}
+#endif //INC_LCORE_TIMESTAMP_H_
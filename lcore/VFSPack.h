@@ -10,14 +10,22 @@
 namespace lcore
 {
     class DirectoryProxy;
+    class AESContext;
 
     static const u32 VFSPackSignature = 'LPAK';
 
     struct VFSPackHeader
     {
+        /// ÍɎgnonce. pbNƂɍ闐
+        inline u64 getNonce() const
+        {
+            return (static_cast<u64>(nonce_)<<32) | reserved_;
+        }
+
         u32 signature_;
-        u32 reserved_;
+        u32 reserved_; ///< . nbV̎noncẻ32rbg
         s32 numEntries_;
+        u32 nonce_; ///< . noncȅ32rbg
         s64 offsetString_;
         s64 offsetData_;
     };
@@ -62,7 +70,16 @@ namespace lcore
         Char* stringBuffer_;
     };
 
-    bool writeVFSPack(const Char* filepath, const Char* root);
-    bool readVFSPack(VFSPack& pack, const Char* filepath, bool checkHash);
+    /**
+    @param cipher ... NULLłȂCTR[hŁApbN̐ΈʒuXg[̈ʒuƂăt@CƂɈÍB
+    _ANZXł͓ǂ񂾔͈͂΂悢B
+    JE^̓wb_nonce||ʒuȂ̂ŁAōʂ̃pbNƌXg[dȂȂ
+    */
+    bool writeVFSPack(const Char* filepath, const Char* root, const AESContext* cipher=NULL);
+
+    /**
+    @param cipher ... ÍGg̕ɎgBpbNgԂ͗Lł邱
+    */
+    bool readVFSPack(VFSPack& pack, const Char* filepath, bool checkHash, const AESContext* cipher=NULL);
 }
 #endif //INC_LCORE_VFSPACK_H_
@@ -8,6 +8,7 @@
 #include "lcore.h"
 #include "FileSystem.h"
 #include "File.h"
+#include "AsyncIO.h"
 
 namespace lcore
 {
@@ -309,6 +310,14 @@ namespace lcore
         virtual bool read(s64 offset, s64 size, void* data);
         virtual bool write(s64 offset, s64 size, void* data);
 
+        /**
+        @brief Issue a read of this file through asyncIO
+        @return The request, InvalidID if asyncIO has no free slot
+
+        Do not call read or write while the request is in flight.
+        */
+        AsyncIO::RequestID readAsync(AsyncIO& asyncIO, s64 offset, s64 size, void* data, s32 priority=AsyncIO::Priority_Normal, AsyncIO::Callback callback=NULL, void* userData=NULL);
+
         virtual bool thisParent(VirtualFileSystemBase* vfs) const;
     protected:
         friend class VirtualFileSystemOS;
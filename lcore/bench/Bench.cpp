@@ -0,0 +1,279 @@
+﻿/**
+@file Bench.cpp
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "Bench.h"
+#include "Sort.h"
+#include "File.h"
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+
+namespace lcore
+{
+namespace bench
+{
+namespace
+{
+    static const s32 DefaultWarmup = 3;
+    static const s32 DefaultRepetitions = 31;
+
+    Registrar* head_ = NULL;
+    Registrar* tail_ = NULL;
+
+    struct Options
+    {
+        s32 warmup_;
+        s32 repetitions_;
+        const Char* filter_;
+        const Char* json_;
+        bool list_;
+    };
+
+    bool contains(const Char* str, const Char* pattern)
+    {
+        s32 length = lcore::strlen_s32(pattern);
+        for(const Char* s=str; CharNull != *s; ++s){
+            if(0 == lcore::strncmp(s, pattern, length)){
+                return true;
+            }
+        }
+        return 0 == length;
+    }
+
+    void printUsage()
+    {
+        ::printf("usage: lcore_bench [--filter substring] [--warmup N] [--reps N] [--json path|-] [--list]\n");
+        ::printf("  run in the directory of lcore/test for the VFS benchmarks\n");
+    }
+
+    bool parseOptions(Options& options, s32 argc, char** argv)
+    {
+        options.warmup_ = DefaultWarmup;
+        options.repetitions_ = DefaultRepetitions;
+        options.filter_ = "";
+        options.json_ = NULL;
+        options.list_ = false;
+        for(s32 i=1; i<argc; ++i){
+            const Char* arg = argv[i];
+            bool hasValue = (i+1)<argc;
+            if(0 == lcore::strncmp(arg, "--filter", 9) && hasValue){
+                options.filter_ = argv[++i];
+            }else if(0 == lcore::strncmp(arg, "--warmup", 9) && hasValue){
+                options.warmup_ = maximum(::atoi(argv[++i]), 0);
+            }else if(0 == lcore::strncmp(arg, "--reps", 7) && hasValue){
+                options.repetitions_ = maximum(::atoi(argv[++i]), 1);
+            }else if(0 == lcore::strncmp(arg, "--json", 7) && hasValue){
+                options.json_ = argv[++i];
+            }else if(0 == lcore::strncmp(arg, "--list", 7)){
+                options.list_ = true;
+            }else{
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// JSONの文字列にエスケープの要る文字は名前に使わない
+    void printJSON(File* file, const Char* format, ...)
+    {
+        Char buffer[512];
+        va_list args;
+        va_start(args, format);
+        s32 count = ::vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+        if(count<=0){
+            return;
+        }
+        count = minimum(count, static_cast<s32>(sizeof(buffer))-1);
+        if(NULL != file){
+            file->write(count, buffer);
+        }else{
+            ::fwrite(buffer, 1, count, stdout);
+        }
+    }
+
+    void printJSONNumber(File* file, const Char* name, f64 value, const Char* separator)
+    {
+        if(value<0.0){
+            printJSON(file, "\"%s\":null%s", name, separator);
+        }else{
+            printJSON(file, "\"%s\":%.4f%s", name, value, separator);
+        }
+    }
+
+    bool writeJSON(const Char* path, const Options& options, s32 numResults, const Result* results)
+    {
+        File file;
+        File* out = NULL;
+        if(0 != lcore::strncmp(path, "-", 2)){
+            if(!file.open(path, ios::out)){
+                return false;
+            }
+            out = &file;
+        }
+        printJSON(out, "{\"context\":{\"timer\":\"%s\",\"frequency\":%llu,\"warmup\":%d,\"repetitions\":%d},\n\"benchmarks\":[",
+            Timestamp::isTSC()? "tsc" : "performance_counter",
+            static_cast<unsigned long long>(Timestamp::getFrequency()),
+            options.warmup_, options.repetitions_);
+        for(s32 i=0; i<numResults; ++i){
+            const Result& result = results[i];
+            printJSON(out, "%s\n{\"name\":\"%s\",\"elements\":%d,", (0<i)? "," : "", result.name_, result.elements_);
+            if(NULL != result.skipReason_){
+                printJSON(out, "\"skipped\":\"%s\"}", result.skipReason_);
+                continue;
+            }
+            printJSON(out, "\"repetitions\":%d,", result.repetitions_);
+            printJSONNumber(out, "min_ns", result.minimum_, ",");
+            printJSONNumber(out, "mean_ns", result.mean_, ",");
+            printJSONNumber(out, "median_ns", result.median_, ",");
+            printJSONNumber(out, "p99_ns", result.p99_, ",");
+            printJSONNumber(out, "ns_per_element", result.nsPerElement_, ",");
+            printJSONNumber(out, "cycles_per_element", result.cyclesPerElement_, ",");
+            printJSONNumber(out, "elements_per_second", result.elementsPerSecond_, "}");
+        }
+        printJSON(out, "\n]}\n");
+        file.close();
+        return true;
+    }
+}
+
+    volatile u64 State::sink_ = 0;
+
+    State::State(s32 elements, s32 warmup, s32 repetitions, u64* samples)
+        :elements_(elements)
+        ,warmup_(warmup)
+        ,repetitions_(repetitions)
+        ,iteration_(0)
+        ,manual_(false)
+        ,skipped_(false)
+        ,skipReason_(NULL)
+        ,begin_(0)
+        ,elapsed_(0)
+        ,samples_(samples)
+    {
+        LASSERT(0<elements_);
+        LASSERT(0<=warmup_);
+        LASSERT(0<repetitions_);
+        LASSERT(NULL != samples_);
+    }
+
+    void State::skip(const Char* reason)
+    {
+        LASSERT(NULL != reason);
+        skipped_ = true;
+        skipReason_ = reason;
+    }
+
+    Registrar::Registrar(const Char* name, s32 elements, BenchProc proc)
+        :name_(name)
+        ,elements_(elements)
+        ,proc_(proc)
+        ,next_(NULL)
+    {
+        LASSERT(NULL != name_);
+        LASSERT(NULL != proc_);
+        if(NULL == tail_){
+            head_ = tail_ = this;
+        }else{
+            tail_->next_ = this;
+            tail_ = this;
+        }
+    }
+
+    void calcResult(Result& result, s32 numSamples, u64* samples)
+    {
+        LASSERT(0<numSamples);
+        LASSERT(NULL != samples);
+        introsort(numSamples, samples);
+
+        f64 sum = 0.0;
+        for(s32 i=0; i<numSamples; ++i){
+            sum += static_cast<f64>(samples[i]);
+        }
+        //Nearest rank
+        s32 p99 = (numSamples*99 + 99)/100 - 1;
+        f64 median = (numSamples&1)
+            ? static_cast<f64>(samples[numSamples/2])
+            : 0.5*(static_cast<f64>(samples[numSamples/2-1]) + static_cast<f64>(samples[numSamples/2]));
+
+        f64 toNanoSeconds = Timestamp::toSeconds(1)*1.0e9;
+        result.repetitions_ = numSamples;
+        result.minimum_ = static_cast<f64>(samples[0])*toNanoSeconds;
+        result.mean_ = sum/numSamples*toNanoSeconds;
+        result.median_ = median*toNanoSeconds;
+        result.p99_ = static_cast<f64>(samples[p99])*toNanoSeconds;
+        result.nsPerElement_ = result.median_/result.elements_;
+        result.cyclesPerElement_ = (Timestamp::isTSC())? median/result.elements_ : -1.0;
+        result.elementsPerSecond_ = (0.0<result.median_)? result.elements_*1.0e9/result.median_ : 0.0;
+    }
+}
+}
+
+int main(int argc, char** argv)
+{
+    using namespace lcore;
+    using namespace lcore::bench;
+
+    Options options;
+    if(!parseOptions(options, argc, argv)){
+        printUsage();
+        return 1;
+    }
+
+    s32 numBenchmarks = 0;
+    for(Registrar* registrar=head_; NULL != registrar; registrar=registrar->next_){
+        if(contains(registrar->name_, options.filter_)){
+            ++numBenchmarks;
+        }
+    }
+    if(options.list_){
+        for(Registrar* registrar=head_; NULL != registrar; registrar=registrar->next_){
+            if(contains(registrar->name_, options.filter_)){
+                ::printf("%s\n", registrar->name_);
+            }
+        }
+        return 0;
+    }
+
+    Timestamp::initialize();
+    //Progress goes to stderr when JSON is written to stdout
+    FILE* log = (NULL != options.json_ && 0 == lcore::strncmp(options.json_, "-", 2))? stderr : stdout;
+    ::fprintf(log, "timer: %s, %llu Hz\n", Timestamp::isTSC()? "TSC" : "performance counter", static_cast<unsigned long long>(Timestamp::getFrequency()));
+    ::fprintf(log, "%-40s %10s %14s %14s %12s %12s %12s\n", "name", "elements", "median[ns]", "p99[ns]", "ns/elem", "cycles/elem", "Melem/s");
+
+    Result* results = reinterpret_cast<Result*>(LMALLOC(sizeof(Result)*maximum(numBenchmarks, 1)));
+    u64* samples = reinterpret_cast<u64*>(LMALLOC(sizeof(u64)*options.repetitions_));
+    s32 numResults = 0;
+    for(Registrar* registrar=head_; NULL != registrar; registrar=registrar->next_){
+        if(!contains(registrar->name_, options.filter_)){
+            continue;
+        }
+        State state(registrar->elements_, options.warmup_, options.repetitions_, samples);
+        registrar->proc_(state);
+
+        Result& result = results[numResults++];
+        result.name_ = registrar->name_;
+        result.skipReason_ = NULL;
+        result.elements_ = state.getElements();
+        s32 numSamples = state.getNumSamples();
+        if(state.isSkipped() || numSamples<=0){
+            result.skipReason_ = (state.isSkipped())? state.getSkipReason() : "no samples";
+            ::fprintf(log, "%-40s skipped: %s\n", result.name_, result.skipReason_);
+            continue;
+        }
+        calcResult(result, numSamples, samples);
+        ::fprintf(log, "%-40s %10d %14.1f %14.1f %12.3f %12.3f %12.3f\n",
+            result.name_, result.elements_, result.median_, result.p99_, result.nsPerElement_, result.cyclesPerElement_, result.elementsPerSecond_*1.0e-6);
+    }
+
+    s32 status = 0;
+    if(NULL != options.json_ && !writeJSON(options.json_, options, numResults, results)){
+        ::fprintf(stderr, "cannot write %s\n", options.json_);
+        status = 1;
+    }
+    LFREE(samples);
+    LFREE(results);
+    return status;
+}
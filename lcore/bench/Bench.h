@@ -0,0 +1,197 @@
+﻿#ifndef INC_LCORE_BENCH_H_
+#define INC_LCORE_BENCH_H_
+/**
+@file Bench.h
+@author t-sakai
+@date 2026/10/19 create
+
+LBENCHで登録した計測を、ウォームアップの後に指定回数くり返して中央値とp99を求める。
+*/
+#include "lcore.h"
+#include "Timestamp.h"
+
+namespace lcore
+{
+namespace bench
+{
+    //---------------------------------------------------------------
+    //---
+    //--- State
+    //---
+    //---------------------------------------------------------------
+    /**
+    @brief 1つの計測の状態
+
+    next()がfalseを返すまでループする。start/stopを呼べばその区間の合計を、
+    呼ばなければnext()の間を1回分の時間とする。
+    */
+    class State
+    {
+    public:
+        State(s32 elements, s32 warmup, s32 repetitions, u64* samples);
+
+        inline bool next();
+
+        /// 計測区間の開始。1回の中で何度呼んでもよい
+        inline void start();
+        /// 計測区間の終了
+        inline void stop();
+
+        /// 実行できない理由を残して中断する
+        void skip(const Char* reason);
+
+        /// 1回あたりに処理する要素数
+        inline s32 getElements() const;
+        /// 要素数を変える。最初のnext()の前に呼ぶ
+        inline void setElements(s32 elements);
+
+        inline bool isSkipped() const;
+        inline const Char* getSkipReason() const;
+        inline s32 getNumSamples() const;
+
+        /// 最適化で計算が消えないように値を使う
+        inline static void consume(u64 x);
+        inline static void consume(const void* x);
+    private:
+        State(const State&) = delete;
+        State& operator=(const State&) = delete;
+
+        static volatile u64 sink_;
+
+        s32 elements_;
+        s32 warmup_;
+        s32 repetitions_;
+        s32 iteration_;
+        bool manual_;
+        bool skipped_;
+        const Char* skipReason_;
+        u64 begin_;
+        u64 elapsed_;
+        u64* samples_;
+    };
+
+    inline bool State::next()
+    {
+        u64 t = Timestamp::nowSerialized();
+        if(0<iteration_ && warmup_<iteration_){
+            samples_[iteration_-warmup_-1] = (manual_)? elapsed_ : t-begin_;
+        }
+        if(skipped_ || (warmup_+repetitions_)<=iteration_){
+            return false;
+        }
+        ++iteration_;
+        manual_ = false;
+        elapsed_ = 0;
+        begin_ = Timestamp::nowSerialized();
+        return true;
+    }
+
+    inline void State::start()
+    {
+        manual_ = true;
+        begin_ = Timestamp::nowSerialized();
+    }
+
+    inline void State::stop()
+    {
+        elapsed_ += Timestamp::nowSerialized()-begin_;
+    }
+
+    inline s32 State::getElements() const
+    {
+        return elements_;
+    }
+
+    inline void State::setElements(s32 elements)
+    {
+        LASSERT(0<elements);
+        elements_ = elements;
+    }
+
+    inline bool State::isSkipped() const
+    {
+        return skipped_;
+    }
+
+    inline const Char* State::getSkipReason() const
+    {
+        return skipReason_;
+    }
+
+    inline s32 State::getNumSamples() const
+    {
+        return (warmup_<iteration_)? iteration_-warmup_ : 0;
+    }
+
+    inline void State::consume(u64 x)
+    {
+        sink_ += x;
+    }
+
+    inline void State::consume(const void* x)
+    {
+        sink_ += reinterpret_cast<uintptr_t>(x);
+    }
+
+    typedef void(*BenchProc)(State& state);
+
+    //---------------------------------------------------------------
+    //---
+    //--- Registrar
+    //---
+    //---------------------------------------------------------------
+    /**
+    @brief 静的初期化で計測を登録する
+    */
+    struct Registrar
+    {
+        Registrar(const Char* name, s32 elements, BenchProc proc);
+
+        const Char* name_;
+        s32 elements_;
+        BenchProc proc_;
+        Registrar* next_;
+    };
+
+    //---------------------------------------------------------------
+    //---
+    //--- Result
+    //---
+    //---------------------------------------------------------------
+    struct Result
+    {
+        const Char* name_;
+        const Char* skipReason_; ///< 中断していなければNULL
+        s32 elements_;
+        s32 repetitions_;
+        f64 minimum_; ///< ナノ秒
+        f64 mean_;
+        f64 median_;
+        f64 p99_;
+        f64 nsPerElement_; ///< 中央値から求める
+        f64 cyclesPerElement_; ///< TSCでなければ負
+        f64 elementsPerSecond_; ///< 中央値から求める
+    };
+
+    /**
+    @brief サンプルから統計を求める
+    @param samples ... タイムスタンプのカウント。並べ替える
+    */
+    void calcResult(Result& result, s32 numSamples, u64* samples);
+}
+}
+
+#define LBENCH_CONCAT_IMPL(x, y) x##y
+#define LBENCH_CONCAT(x, y) LBENCH_CONCAT_IMPL(x, y)
+
+/**
+@brief 計測を登録する
+@param name ... 文字列リテラル
+@param elements ... 1回あたりに処理する要素数
+*/
+#define LBENCH(name, elements) \
+    static void LBENCH_CONCAT(lbenchProc, __LINE__)(lcore::bench::State& state); \
+    static lcore::bench::Registrar LBENCH_CONCAT(lbenchRegistrar, __LINE__)(name, elements, LBENCH_CONCAT(lbenchProc, __LINE__)); \
+    static void LBENCH_CONCAT(lbenchProc, __LINE__)(lcore::bench::State& state)
+
+#endif //INC_LCORE_BENCH_H_
@@ -0,0 +1,115 @@
+﻿#include "Bench.h"
+#include "ChunkAllocator.h"
+#include "StackAllocator.h"
+#include "Pool.h"
+#include "Random.h"
+
+namespace lcore
+{
+namespace
+{
+    static const s32 NumAllocations = 4096;
+    static const u32 ObjectSize = 64;
+
+    struct Object
+    {
+        u8 data_[ObjectSize];
+    };
+
+    /// ChunkAllocatorが扱う範囲の大きさ。検査用の領域の分を空けておく
+    void createSizes(u32* sizes, s32 count)
+    {
+        RandXorshift random(12345);
+        for(s32 i=0; i<count; ++i){
+            sizes[i] = 16 + random.rand()%(ChunkAllocator::MaxSize-32);
+        }
+    }
+}
+
+    LBENCH("Allocator/malloc/random_size", NumAllocations)
+    {
+        void** pointers = LNEW void*[NumAllocations];
+        u32* sizes = LNEW u32[NumAllocations];
+        createSizes(sizes, NumAllocations);
+        while(state.next()){
+            for(s32 i=0; i<NumAllocations; ++i){
+                pointers[i] = LMALLOC(sizes[i]);
+            }
+            for(s32 i=0; i<NumAllocations; i+=2){
+                LFREE(pointers[i]);
+            }
+            for(s32 i=1; i<NumAllocations; i+=2){
+                LFREE(pointers[i]);
+            }
+        }
+        LDELETE_ARRAY(sizes);
+        LDELETE_ARRAY(pointers);
+    }
+
+    LBENCH("Allocator/ChunkAllocator/random_size", NumAllocations)
+    {
+        void** pointers = LNEW void*[NumAllocations];
+        u32* sizes = LNEW u32[NumAllocations];
+        createSizes(sizes, NumAllocations);
+        ChunkAllocator allocator;
+        while(state.next()){
+            for(s32 i=0; i<NumAllocations; ++i){
+                pointers[i] = allocator.allocate(sizes[i]);
+            }
+            for(s32 i=0; i<NumAllocations; i+=2){
+                allocator.deallocate(pointers[i], sizes[i]);
+            }
+            for(s32 i=1; i<NumAllocations; i+=2){
+                allocator.deallocate(pointers[i], sizes[i]);
+            }
+        }
+        LDELETE_ARRAY(sizes);
+        LDELETE_ARRAY(pointers);
+    }
+
+    LBENCH("Allocator/StackAllocator/fixed_size", NumAllocations)
+    {
+        void** pointers = LNEW void*[NumAllocations];
+        StackAllocator<> allocator(ObjectSize);
+        while(state.next()){
+            for(s32 i=0; i<NumAllocations; ++i){
+                pointers[i] = allocator.allocate();
+            }
+            for(s32 i=NumAllocations-1; 0<=i; --i){
+                allocator.deallocate(pointers[i]);
+            }
+        }
+        LDELETE_ARRAY(pointers);
+    }
+
+    LBENCH("Allocator/ObjectPool/fixed_size", NumAllocations)
+    {
+        Object** objects = LNEW Object*[NumAllocations];
+        ObjectPool<Object> pool;
+        pool.initialize(64*1024);
+        while(state.next()){
+            for(s32 i=0; i<NumAllocations; ++i){
+                objects[i] = pool.pop();
+            }
+            for(s32 i=0; i<NumAllocations; ++i){
+                pool.push(objects[i]);
+            }
+        }
+        pool.terminate();
+        LDELETE_ARRAY(objects);
+    }
+
+    LBENCH("Allocator/malloc/fixed_size", NumAllocations)
+    {
+        void** pointers = LNEW void*[NumAllocations];
+        while(state.next()){
+            for(s32 i=0; i<NumAllocations; ++i){
+                pointers[i] = LMALLOC(ObjectSize);
+            }
+            for(s32 i=0; i<NumAllocations; ++i){
+                LFREE(pointers[i]);
+            }
+        }
+        LDELETE_ARRAY(pointers);
+    }
+}
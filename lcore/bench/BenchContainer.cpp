@@ -0,0 +1,149 @@
+﻿#include "Bench.h"
+#include "HashMap.h"
+#include "Queue.h"
+
+namespace lcore
+{
+namespace
+{
+    static const s32 NumKeys = 64*1024;
+
+    /// 重複しないキー
+    void createKeys(u32* keys, s32 count)
+    {
+        for(s32 i=0; i<count; ++i){
+            keys[i] = static_cast<u32>(i)*2654435761U;
+        }
+    }
+
+    template<class HashMapType>
+    void benchInsert(bench::State& state)
+    {
+        u32* keys = LNEW u32[NumKeys];
+        createKeys(keys, NumKeys);
+        while(state.next()){
+            HashMapType hashMap;
+            state.start();
+            for(s32 i=0; i<NumKeys; ++i){
+                hashMap.insert(keys[i], static_cast<u32>(i));
+            }
+            state.stop();
+        }
+        LDELETE_ARRAY(keys);
+    }
+
+    template<class HashMapType>
+    void benchFind(bench::State& state)
+    {
+        u32* keys = LNEW u32[NumKeys];
+        createKeys(keys, NumKeys);
+        HashMapType hashMap;
+        for(s32 i=0; i<NumKeys; ++i){
+            hashMap.insert(keys[i], static_cast<u32>(i));
+        }
+        //Half of the lookups miss
+        for(s32 i=1; i<NumKeys; i+=2){
+            keys[i] = ~keys[i];
+        }
+        while(state.next()){
+            u64 sum = 0;
+            for(s32 i=0; i<NumKeys; ++i){
+                typename HashMapType::size_type pos = hashMap.find(keys[i]);
+                if(hashMap.valid(pos)){
+                    sum += hashMap.getValue(pos);
+                }
+            }
+            bench::State::consume(sum);
+        }
+        LDELETE_ARRAY(keys);
+    }
+
+    template<class HashMapType>
+    void benchErase(bench::State& state)
+    {
+        u32* keys = LNEW u32[NumKeys];
+        createKeys(keys, NumKeys);
+        while(state.next()){
+            HashMapType hashMap;
+            for(s32 i=0; i<NumKeys; ++i){
+                hashMap.insert(keys[i], static_cast<u32>(i));
+            }
+            state.start();
+            for(s32 i=0; i<NumKeys; ++i){
+                hashMap.erase(keys[i]);
+            }
+            state.stop();
+        }
+        LDELETE_ARRAY(keys);
+    }
+
+    typedef HashMap<u32, u32> HashMapU32;
+    typedef HopscotchHashMap<u32, u32> HopscotchHashMapU32;
+    typedef QueuePOD<u32, ArrayStaticCapacityIncrement<1024> > QueueU32;
+}
+
+    LBENCH("HashMap/insert", NumKeys)
+    {
+        benchInsert<HashMapU32>(state);
+    }
+
+    LBENCH("HashMap/find", NumKeys)
+    {
+        benchFind<HashMapU32>(state);
+    }
+
+    LBENCH("HashMap/erase", NumKeys)
+    {
+        benchErase<HashMapU32>(state);
+    }
+
+    LBENCH("HopscotchHashMap/insert", NumKeys)
+    {
+        benchInsert<HopscotchHashMapU32>(state);
+    }
+
+    LBENCH("HopscotchHashMap/find", NumKeys)
+    {
+        benchFind<HopscotchHashMapU32>(state);
+    }
+
+    LBENCH("HopscotchHashMap/erase", NumKeys)
+    {
+        benchErase<HopscotchHashMapU32>(state);
+    }
+
+    LBENCH("QueuePOD/push_back+pop_front", NumKeys)
+    {
+        QueueU32 queue;
+        while(state.next()){
+            for(s32 i=0; i<NumKeys; ++i){
+                queue.push_back(static_cast<u32>(i));
+            }
+            u32 sum = 0;
+            u32 x;
+            while(queue.try_pop_front(x)){
+                sum += x;
+            }
+            bench::State::consume(sum);
+        }
+    }
+
+    LBENCH("QueuePOD/steady", NumKeys)
+    {
+        //Keep a few elements in the queue, like a job queue
+        QueueU32 queue;
+        for(u32 i=0; i<64; ++i){
+            queue.push_back(i);
+        }
+        while(state.next()){
+            u32 sum = 0;
+            u32 x;
+            for(s32 i=0; i<NumKeys; ++i){
+                queue.try_pop_front(x);
+                sum += x;
+                queue.push_back(x+1);
+            }
+            bench::State::consume(sum);
+        }
+    }
+}
@@ -0,0 +1,135 @@
+﻿#include "Bench.h"
+#include "EventLoop.h"
+#include "Thread.h"
+
+namespace lcore
+{
+namespace
+{
+    static const u16 EchoPort = 18513;
+    static const s32 NumClients = 16;
+    static const s32 MessageSize = 1024;
+    static const s32 NumRoundTrips = 500;
+
+    class EchoServer : public EventHandler
+    {
+    public:
+        virtual void onReceive(EventLoop& loop, Connection& connection)
+        {
+            NetworkBuffer& receiveBuffer = connection.getReceiveBuffer();
+            while(!receiveBuffer.empty()){
+                const Char* data;
+                s32 size = minimum(receiveBuffer.getReadRegion(data), connection.getSendBuffer().getFreeSize());
+                if(size<=0 || !loop.send(connection, data, size)){
+                    break;
+                }
+                receiveBuffer.skip(size);
+            }
+        }
+    };
+
+    /// 受け取った分を数えて, NumRoundTrips往復したら閉じる
+    class EchoClient : public EventHandler
+    {
+    public:
+        EchoClient()
+        {
+            for(s32 i=0; i<MessageSize; ++i){
+                message_[i] = static_cast<Char>(i);
+            }
+            reset();
+        }
+
+        void reset()
+        {
+            lcore::memset(received_, 0, sizeof(received_));
+            lcore::memset(roundTrips_, 0, sizeof(roundTrips_));
+            numClosed_ = 0;
+        }
+
+        virtual void onConnect(EventLoop& loop, Connection& connection)
+        {
+            loop.send(connection, message_, MessageSize);
+        }
+
+        virtual void onReceive(EventLoop& loop, Connection& connection)
+        {
+            s32 index = connection.getIndex();
+            NetworkBuffer& receiveBuffer = connection.getReceiveBuffer();
+            Char buffer[MessageSize];
+            received_[index] += receiveBuffer.read(buffer, MessageSize-received_[index]);
+            if(received_[index]<MessageSize){
+                return;
+            }
+            received_[index] = 0;
+            if(NumRoundTrips <= ++roundTrips_[index]){
+                loop.close(connection);
+                return;
+            }
+            loop.send(connection, message_, MessageSize);
+        }
+
+        virtual void onClose(EventLoop& /*loop*/, Connection& /*connection*/)
+        {
+            ++numClosed_;
+        }
+
+        s32 received_[NumClients];
+        s32 roundTrips_[NumClients];
+        s32 numClosed_;
+        Char message_[MessageSize];
+    };
+
+    /// ループバックで, 1要素を1往復とした時間を測る
+    void benchEcho(bench::State& state)
+    {
+        SocketSystem::initialize();
+
+        EchoServer echoServer;
+        EventLoop server;
+        if(!server.initialize(&echoServer, NumClients) || !server.listen(EchoPort, INADDR_ANY, NumClients, false)){
+            server.terminate();
+            SocketSystem::terminate();
+            state.skip("cannot listen");
+            return;
+        }
+
+        ThreadPool threadPool(1, 1);
+        threadPool.start();
+        threadPool.add(EventLoop::runJob, &server);
+
+        sockaddr_in address;
+        lcore::memset(&address, 0, sizeof(sockaddr_in));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(EchoPort);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        EchoClient echoClient;
+        while(state.next()){
+            echoClient.reset();
+            EventLoop client;
+            client.initialize(&echoClient, NumClients);
+            state.start();
+            for(s32 i=0; i<NumClients; ++i){
+                if(NULL == client.connect(*reinterpret_cast<const SOCKADDR*>(&address))){
+                    ++echoClient.numClosed_;
+                }
+            }
+            while(echoClient.numClosed_<NumClients){
+                if(client.poll(10)<0){
+                    break;
+                }
+            }
+            state.stop();
+            client.terminate();
+        }
+
+        server.stop();
+        threadPool.waitAllFinish(thread::Infinite);
+        server.terminate();
+        SocketSystem::terminate();
+    }
+
+    static bench::Registrar registrarEcho("EventLoop/echo", NumClients*NumRoundTrips, benchEcho);
+}
+}
@@ -0,0 +1,107 @@
+﻿#include "Bench.h"
+#include "xxHash.h"
+#include "MurmurHash.h"
+#include "Random.h"
+
+namespace lcore
+{
+namespace
+{
+    static const s32 MaxBytes = 64*1024;
+    /// 1回あたりの入力の総量を揃える
+    static const s32 TotalBytes = 1024*1024;
+
+    enum HashType
+    {
+        HashType_xxHash32,
+        HashType_xxHash64,
+        HashType_MurmurHash32,
+    };
+
+    const u8* getInput()
+    {
+        static u8 input[MaxBytes];
+        static bool initialized = false;
+        if(!initialized){
+            RandXorshift random(12345);
+            for(s32 i=0; i<MaxBytes; ++i){
+                input[i] = static_cast<u8>(random.rand());
+            }
+            initialized = true;
+        }
+        return input;
+    }
+
+    /// 要素はバイト数。cycles/elementはcycles/byte
+    void benchHash(bench::State& state, HashType type, s32 size)
+    {
+        const u8* input = getInput();
+        s32 count = TotalBytes/size;
+        while(state.next()){
+            u64 sum = 0;
+            for(s32 i=0; i<count; ++i){
+                //Slide the window so small inputs do not stay on one cache line
+                const u8* data = input + (i*64)%(MaxBytes-size+1);
+                switch(type)
+                {
+                case HashType_xxHash32:
+                    sum += xxHash32(data, size);
+                    break;
+                case HashType_xxHash64:
+                    sum += xxHash64(data, size);
+                    break;
+                default:
+                    sum += MurmurHash32(data, size);
+                    break;
+                }
+            }
+            bench::State::consume(sum);
+        }
+    }
+}
+
+    LBENCH("Hash/xxHash32/16B", TotalBytes)
+    {
+        benchHash(state, HashType_xxHash32, 16);
+    }
+
+    LBENCH("Hash/xxHash32/1KB", TotalBytes)
+    {
+        benchHash(state, HashType_xxHash32, 1024);
+    }
+
+    LBENCH("Hash/xxHash32/64KB", TotalBytes)
+    {
+        benchHash(state, HashType_xxHash32, 64*1024);
+    }
+
+    LBENCH("Hash/xxHash64/16B", TotalBytes)
+    {
+        benchHash(state, HashType_xxHash64, 16);
+    }
+
+    LBENCH("Hash/xxHash64/1KB", TotalBytes)
+    {
+        benchHash(state, HashType_xxHash64, 1024);
+    }
+
+    LBENCH("Hash/xxHash64/64KB", TotalBytes)
+    {
+        benchHash(state, HashType_xxHash64, 64*1024);
+    }
+
+    LBENCH("Hash/MurmurHash32/16B", TotalBytes)
+    {
+        benchHash(state, HashType_MurmurHash32, 16);
+    }
+
+    LBENCH("Hash/MurmurHash32/1KB", TotalBytes)
+    {
+        benchHash(state, HashType_MurmurHash32, 1024);
+    }
+
+    LBENCH("Hash/MurmurHash32/64KB", TotalBytes)
+    {
+        benchHash(state, HashType_MurmurHash32, 64*1024);
+    }
+}
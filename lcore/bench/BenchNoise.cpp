@@ -0,0 +1,103 @@
+﻿#include "Bench.h"
+#include "Noise.h"
+#include "Random.h"
+
+namespace lcore
+{
+namespace
+{
+    static const s32 NumPoints = 64*1024;
+    static const s32 GridSize = 256;
+
+    struct Points
+    {
+        Points()
+        {
+            RandXorshift128Plus32 random(12345);
+            for(s32 i=0; i<NumPoints; ++i){
+                x_[i] = random.frand2()*256.0f;
+                y_[i] = random.frand2()*256.0f;
+                z_[i] = random.frand2()*256.0f;
+            }
+        }
+
+        f32 x_[NumPoints];
+        f32 y_[NumPoints];
+        f32 z_[NumPoints];
+    };
+
+    const Points& getPoints()
+    {
+        static Points points;
+        return points;
+    }
+
+    /// 1点ずつ呼ぶ
+    void benchScalar(bench::State& state, Noise::Func3D func)
+    {
+        Noise noise(1);
+        const Points& points = getPoints();
+        while(state.next()){
+            f32 sum = 0.0f;
+            for(s32 i=0; i<NumPoints; ++i){
+                sum += (noise.*func)(points.x_[i], points.y_[i], points.z_[i], 0.1f).value_;
+            }
+            bench::State::consume(static_cast<u64>(sum));
+        }
+    }
+
+    void benchBatch(bench::State& state, Noise::Batch3D func)
+    {
+        Noise noise(1);
+        const Points& points = getPoints();
+        NoiseSample3* samples = LNEW NoiseSample3[NumPoints];
+        while(state.next()){
+            (noise.*func)(NumPoints, samples, points.x_, points.y_, points.z_, 0.1f);
+            bench::State::consume(samples);
+        }
+        LDELETE_ARRAY(samples);
+    }
+
+    /// 要素はグリッドの点の数
+    void benchGrid(bench::State& state, Noise::Batch2D func)
+    {
+        Noise noise(1);
+        NoiseSample2* samples = LNEW NoiseSample2[GridSize*GridSize];
+        while(state.next()){
+            noise.grid2D(func, samples, GridSize, GridSize, 0.0f, 0.0f, 0.25f, 4, 0.1f);
+            bench::State::consume(samples);
+        }
+        LDELETE_ARRAY(samples);
+    }
+}
+
+    LBENCH("Noise/perlin3D/scalar", NumPoints)
+    {
+        benchScalar(state, &Noise::perlin3D);
+    }
+
+    LBENCH("Noise/perlin3D/batch", NumPoints)
+    {
+        benchBatch(state, &Noise::perlin3D);
+    }
+
+    LBENCH("Noise/simplex3D/scalar", NumPoints)
+    {
+        benchScalar(state, &Noise::simplex3D);
+    }
+
+    LBENCH("Noise/simplex3D/batch", NumPoints)
+    {
+        benchBatch(state, &Noise::simplex3D);
+    }
+
+    LBENCH("Noise/perlin2D/grid_fbm4", GridSize*GridSize)
+    {
+        benchGrid(state, &Noise::perlin2D);
+    }
+
+    LBENCH("Noise/simplex2D/grid_fbm4", GridSize*GridSize)
+    {
+        benchGrid(state, &Noise::simplex2D);
+    }
+}
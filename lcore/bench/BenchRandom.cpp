@@ -0,0 +1,98 @@
+﻿#include "Bench.h"
+#include "Random.h"
+
+namespace lcore
+{
+namespace
+{
+    static const s32 NumSamples = 1024*1024;
+
+    template<class T, class Seed>
+    void benchRand(bench::State& state, Seed seed)
+    {
+        T random(seed);
+        while(state.next()){
+            u64 sum = 0;
+            for(s32 i=0; i<NumSamples; ++i){
+                sum += random.rand();
+            }
+            bench::State::consume(sum);
+        }
+    }
+
+    template<class T, class Seed>
+    void benchFrand(bench::State& state, Seed seed)
+    {
+        T random(seed);
+        while(state.next()){
+            f32 sum = 0.0f;
+            for(s32 i=0; i<NumSamples; ++i){
+                sum += random.frand();
+            }
+            bench::State::consume(static_cast<u64>(sum));
+        }
+    }
+}
+
+    LBENCH("Random/RandXorshift/rand", NumSamples)
+    {
+        benchRand<RandXorshift>(state, 12345U);
+    }
+
+    LBENCH("Random/RandXorshift64Star/rand", NumSamples)
+    {
+        benchRand<RandXorshift64Star>(state, 12345ULL);
+    }
+
+    LBENCH("Random/RandXorshift64Star32/rand", NumSamples)
+    {
+        benchRand<RandXorshift64Star32>(state, 12345ULL);
+    }
+
+    LBENCH("Random/RandXorshift128Plus/rand", NumSamples)
+    {
+        benchRand<RandXorshift128Plus>(state, 12345ULL);
+    }
+
+    LBENCH("Random/RandXorshift128Plus32/rand", NumSamples)
+    {
+        benchRand<RandXorshift128Plus32>(state, 12345ULL);
+    }
+
+    LBENCH("Random/RandWELL/rand", NumSamples)
+    {
+        benchRand<RandWELL>(state, 12345U);
+    }
+
+    LBENCH("Random/RandXorshift128Plus32x8/rand", NumSamples)
+    {
+        u32* values = LNEW u32[NumSamples];
+        RandXorshift128Plus32x8 random(12345ULL);
+        while(state.next()){
+            random.rand(NumSamples, values);
+            bench::State::consume(values[NumSamples-1]);
+        }
+        LDELETE_ARRAY(values);
+    }
+
+    LBENCH("Random/RandXorshift/frand", NumSamples)
+    {
+        benchFrand<RandXorshift>(state, 12345U);
+    }
+
+    LBENCH("Random/RandXorshift128Plus32/frand", NumSamples)
+    {
+        benchFrand<RandXorshift128Plus32>(state, 12345ULL);
+    }
+
+    LBENCH("Random/RandXorshift128Plus32x8/frand2", NumSamples)
+    {
+        f32* values = LNEW f32[NumSamples];
+        RandXorshift128Plus32x8 random(12345ULL);
+        while(state.next()){
+            random.frand2(NumSamples, values);
+            bench::State::consume(static_cast<u64>(values[NumSamples-1]*1024.0f));
+        }
+        LDELETE_ARRAY(values);
+    }
+}
@@ -0,0 +1,148 @@
+﻿#include "Bench.h"
+#include "RectPack.h"
+#include "../test/RectPackUtil.h"
+
+namespace lcore
+{
+namespace
+{
+    //Glyph sized rects, about as many as fill the atlas
+    static const s32 NumRects = 1024;
+    static const u16 Size = 512;
+
+    //More glyphs than fit, same input as TestRectPack::Utilization
+    static const s32 NumOverfullRects = 2048;
+    static const u16 OverfullSize = 256;
+
+    struct Rects
+    {
+        Rects()
+        {
+            randomRects(NumRects, rects_, 12345, 4, 24);
+            randomRects(NumOverfullRects, overfull_, 4, 4, 16);
+        }
+
+        RectPackRect rects_[NumRects];
+        RectPackRect overfull_[NumOverfullRects];
+    };
+
+    const Rects& getRects()
+    {
+        static Rects rects;
+        return rects;
+    }
+
+    template<class T>
+    void benchInsert(bench::State& state, T& pack, s32 numRects, const RectPackRect* source)
+    {
+        RectPackRect* rects = LNEW RectPackRect[numRects];
+        lcore::memcpy(rects, source, sizeof(RectPackRect)*numRects);
+        while(state.next()){
+            pack.clear();
+            s32 count = 0;
+            for(s32 i=0; i<numRects; ++i){
+                count += pack.insert(rects[i])? 1 : 0;
+            }
+            bench::State::consume(static_cast<u64>(count));
+        }
+        LDELETE_ARRAY(rects);
+    }
+
+    void benchBatch(bench::State& state, u16 size, s32 numRects, const RectPackRect* source)
+    {
+        RectPackRect* rects = LNEW RectPackRect[numRects];
+        RectPack::Node* nodes = LNEW RectPack::Node[numRects*4];
+        RectPack::Context context;
+        RectPack::initialize(context, size, size, numRects*4, nodes);
+        while(state.next()){
+            lcore::memcpy(rects, source, sizeof(RectPackRect)*numRects);
+            state.start();
+            context.free_ = 0;
+            bench::State::consume(static_cast<u64>(RectPack::pack(context, numRects, rects)));
+            state.stop();
+        }
+        LDELETE_ARRAY(nodes);
+        LDELETE_ARRAY(rects);
+    }
+
+    /// 半分を入れ替え続ける。要素は削除と挿入の組
+    template<class T>
+    void benchChurn(bench::State& state, T& pack)
+    {
+        const Rects& source = getRects();
+        RectPackRect* rects = LNEW RectPackRect[NumRects];
+        bool* placed = LNEW bool[NumRects];
+        lcore::memcpy(rects, source.rects_, sizeof(RectPackRect)*NumRects);
+        pack.clear();
+        for(s32 i=0; i<NumRects; ++i){
+            placed[i] = pack.insert(rects[i]);
+        }
+        s32 index = 0;
+        while(state.next()){
+            for(s32 i=0; i<NumRects/2; ++i){
+                if(placed[index]){
+                    pack.remove(rects[index]);
+                }
+                placed[index] = pack.insert(rects[index]);
+                index = (index+7)%NumRects;
+            }
+        }
+        bench::State::consume(placed);
+        LDELETE_ARRAY(placed);
+        LDELETE_ARRAY(rects);
+    }
+}
+
+    LBENCH("RectPack/batch", NumRects)
+    {
+        benchBatch(state, Size, NumRects, getRects().rects_);
+    }
+
+    LBENCH("RectPack/skyline/insert", NumRects)
+    {
+        SkylinePack pack;
+        pack.initialize(Size, Size);
+        benchInsert(state, pack, NumRects, getRects().rects_);
+    }
+
+    LBENCH("RectPack/guillotine/insert", NumRects)
+    {
+        GuillotinePack pack;
+        pack.initialize(Size, Size);
+        benchInsert(state, pack, NumRects, getRects().rects_);
+    }
+
+    //Rejected rects still cost a search, the occupancy is logged by TestRectPack::Utilization
+    LBENCH("RectPack/batch/overfull", NumOverfullRects)
+    {
+        benchBatch(state, OverfullSize, NumOverfullRects, getRects().overfull_);
+    }
+
+    LBENCH("RectPack/skyline/overfull", NumOverfullRects)
+    {
+        SkylinePack pack;
+        pack.initialize(OverfullSize, OverfullSize);
+        benchInsert(state, pack, NumOverfullRects, getRects().overfull_);
+    }
+
+    LBENCH("RectPack/guillotine/overfull", NumOverfullRects)
+    {
+        GuillotinePack pack;
+        pack.initialize(OverfullSize, OverfullSize);
+        benchInsert(state, pack, NumOverfullRects, getRects().overfull_);
+    }
+
+    LBENCH("RectPack/skyline/churn", NumRects/2)
+    {
+        SkylinePack pack;
+        pack.initialize(Size, Size);
+        benchChurn(state, pack);
+    }
+
+    LBENCH("RectPack/guillotine/churn", NumRects/2)
+    {
+        GuillotinePack pack;
+        pack.initialize(Size, Size);
+        benchChurn(state, pack);
+    }
+}
@@ -0,0 +1,142 @@
+﻿#include "Bench.h"
+#include "Search.h"
+#include "Random.h"
+
+namespace lcore
+{
+namespace
+{
+    static const s32 NumQueries = 4096;
+    static const s32 MaxSize = 4*1024*1024;
+
+    /// 0.5刻みの値と, その範囲のクエリ
+    struct Data
+    {
+        Data()
+        {
+            values_ = LNEW f32[MaxSize];
+            for(s32 i=0; i<MaxSize; ++i){
+                values_[i] = static_cast<f32>(i)*0.5f;
+            }
+        }
+
+        ~Data()
+        {
+            LDELETE_ARRAY(values_);
+        }
+
+        void makeQueries(s32 size)
+        {
+            RandXorshift128Plus32 random(size);
+            for(s32 i=0; i<NumQueries; ++i){
+                queries_[i] = random.frand2()*static_cast<f32>(size)*0.5f;
+            }
+        }
+
+        f32* values_;
+        f32 queries_[NumQueries];
+    };
+
+    Data& getData(s32 size)
+    {
+        static Data data;
+        data.makeQueries(size);
+        return data;
+    }
+
+    template<s32 Size>
+    void benchLowerBound(bench::State& state)
+    {
+        Data& data = getData(Size);
+        while(state.next()){
+            u64 sum = 0;
+            for(s32 i=0; i<NumQueries; ++i){
+                sum += lower_bound(data.values_, data.values_+Size, data.queries_[i]) - data.values_;
+            }
+            bench::State::consume(sum);
+        }
+    }
+
+    template<s32 Size>
+    void benchBranchless(bench::State& state)
+    {
+        Data& data = getData(Size);
+        while(state.next()){
+            u64 sum = 0;
+            for(s32 i=0; i<NumQueries; ++i){
+                sum += branchlessLowerBound(Size, data.values_, data.queries_[i]);
+            }
+            bench::State::consume(sum);
+        }
+    }
+
+    template<s32 Size>
+    void benchPrefetch(bench::State& state)
+    {
+        Data& data = getData(Size);
+        while(state.next()){
+            u64 sum = 0;
+            for(s32 i=0; i<NumQueries; ++i){
+                sum += prefetchLowerBound(Size, data.values_, data.queries_[i]);
+            }
+            bench::State::consume(sum);
+        }
+    }
+
+    template<s32 Size>
+    void benchEytzinger(bench::State& state)
+    {
+        Data& data = getData(Size);
+        EytzingerArray<f32> eytzinger;
+        eytzinger.build(Size, data.values_);
+        while(state.next()){
+            u64 sum = 0;
+            for(s32 i=0; i<NumQueries; ++i){
+                sum += eytzinger.lowerBound(data.queries_[i]);
+            }
+            bench::State::consume(sum);
+        }
+    }
+
+    template<s32 Size>
+    void benchLinear(bench::State& state)
+    {
+        Data& data = getData(Size);
+        while(state.next()){
+            u64 sum = 0;
+            for(s32 i=0; i<NumQueries; ++i){
+                sum += linearLowerBound(Size, data.values_, data.queries_[i]);
+            }
+            bench::State::consume(sum);
+        }
+    }
+}
+
+//要素数ごとに同じクエリ数で比べる
+#define LBENCH_SEARCH(size) \
+    static bench::Registrar registrarLowerBound##size("Search/lower_bound/" #size, NumQueries, benchLowerBound<size>); \
+    static bench::Registrar registrarBranchless##size("Search/branchless/" #size, NumQueries, benchBranchless<size>); \
+    static bench::Registrar registrarPrefetch##size("Search/prefetch/" #size, NumQueries, benchPrefetch<size>); \
+    static bench::Registrar registrarEytzinger##size("Search/eytzinger/" #size, NumQueries, benchEytzinger<size>);
+
+#define LBENCH_SEARCH_LINEAR(size) \
+    static bench::Registrar registrarLinear##size("Search/linear/" #size, NumQueries, benchLinear<size>);
+
+    LBENCH_SEARCH(8)
+    LBENCH_SEARCH_LINEAR(8)
+    LBENCH_SEARCH(32)
+    LBENCH_SEARCH_LINEAR(32)
+    LBENCH_SEARCH(64)
+    LBENCH_SEARCH_LINEAR(64)
+    LBENCH_SEARCH(128)
+    LBENCH_SEARCH_LINEAR(128)
+    LBENCH_SEARCH(512)
+    LBENCH_SEARCH_LINEAR(512)
+    LBENCH_SEARCH(4096)
+    LBENCH_SEARCH(65536)
+    LBENCH_SEARCH(1048576)
+    LBENCH_SEARCH(4194304)
+
+#undef LBENCH_SEARCH_LINEAR
+#undef LBENCH_SEARCH
+}
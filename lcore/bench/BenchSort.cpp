@@ -0,0 +1,99 @@
+﻿#include "Bench.h"
+#include "Sort.h"
+#include "Random.h"
+#include <algorithm>
+
+namespace lcore
+{
+namespace
+{
+    static const s32 NumValues = 64*1024;
+
+    typedef bool(*CompFunc)(const u32& lhs, const u32& rhs);
+
+    void createRandom(u32* values, s32 count)
+    {
+        RandXorshift random(12345);
+        for(s32 i=0; i<count; ++i){
+            values[i] = random.rand();
+        }
+    }
+
+    /// 整列済みの列に少しだけ乱れを入れる
+    void createPartiallySorted(u32* values, s32 count)
+    {
+        RandXorshift random(12345);
+        for(s32 i=0; i<count; ++i){
+            values[i] = static_cast<u32>(i);
+        }
+        for(s32 i=0; i<count/100; ++i){
+            lcore::swap(values[random.rand()%count], values[random.rand()%count]);
+        }
+    }
+
+    enum SortType
+    {
+        SortType_Introsort,
+        SortType_Timsort,
+        SortType_Std,
+    };
+
+    void benchSort(bench::State& state, SortType type, void(*create)(u32*, s32))
+    {
+        u32* source = LNEW u32[NumValues];
+        u32* values = LNEW u32[NumValues];
+        create(source, NumValues);
+        Timsort<u32, CompFunc> timsort(less<u32>);
+        while(state.next()){
+            lcore::memcpy(values, source, sizeof(u32)*NumValues);
+            state.start();
+            switch(type)
+            {
+            case SortType_Introsort:
+                introsort(NumValues, values);
+                break;
+            case SortType_Timsort:
+                timsort.sort(values, NumValues);
+                break;
+            default:
+                std::sort(values, values+NumValues);
+                break;
+            }
+            state.stop();
+            bench::State::consume(values[NumValues/2]);
+        }
+        LDELETE_ARRAY(values);
+        LDELETE_ARRAY(source);
+    }
+}
+
+    LBENCH("Sort/introsort/random", NumValues)
+    {
+        benchSort(state, SortType_Introsort, createRandom);
+    }
+
+    LBENCH("Sort/Timsort/random", NumValues)
+    {
+        benchSort(state, SortType_Timsort, createRandom);
+    }
+
+    LBENCH("Sort/std::sort/random", NumValues)
+    {
+        benchSort(state, SortType_Std, createRandom);
+    }
+
+    LBENCH("Sort/introsort/partially_sorted", NumValues)
+    {
+        benchSort(state, SortType_Introsort, createPartiallySorted);
+    }
+
+    LBENCH("Sort/Timsort/partially_sorted", NumValues)
+    {
+        benchSort(state, SortType_Timsort, createPartiallySorted);
+    }
+
+    LBENCH("Sort/std::sort/partially_sorted", NumValues)
+    {
+        benchSort(state, SortType_Std, createPartiallySorted);
+    }
+}
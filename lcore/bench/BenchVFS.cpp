@@ -0,0 +1,108 @@
+﻿#include "Bench.h"
+#include "File.h"
+#include "VFSPack.h"
+#include "VirtualFileSystem.h"
+#include <cstdio>
+
+namespace lcore
+{
+namespace
+{
+    /// lcore/testのデータ
+    static const Char* SmallFiles[] =
+    {
+        "file00.txt",
+        "directory00/file01.txt",
+        "directory00/directory01/file02.txt",
+    };
+    static const s32 NumSmallFiles = sizeof(SmallFiles)/sizeof(SmallFiles[0]);
+
+    static const Char* LargeFile = "lcore_bench_vfs.bin";
+    static const s32 LargeFileSize = 4*1024*1024;
+    static const s32 ReadSize = 64*1024;
+
+    /// 開いて全体を読んで閉じる
+    bool openRead(bench::State& state, VirtualFileSystemBase& vfs)
+    {
+        u8 buffer[256];
+        while(state.next()){
+            for(s32 i=0; i<NumSmallFiles; ++i){
+                FileProxy* file = vfs.openFile(SmallFiles[i]);
+                if(NULL == file){
+                    return false;
+                }
+                s64 size = minimum(file->getUncompressedSize(), static_cast<s64>(sizeof(buffer)));
+                file->read(0, size, buffer);
+                bench::State::consume(buffer[0]);
+                vfs.closeFile(file);
+            }
+        }
+        return true;
+    }
+
+    bool createLargeFile()
+    {
+        File file;
+        if(!file.open(LargeFile, ios::out)){
+            return false;
+        }
+        u8* data = reinterpret_cast<u8*>(LMALLOC(ReadSize));
+        for(s32 i=0; i<ReadSize; ++i){
+            data[i] = static_cast<u8>(i*31);
+        }
+        bool result = true;
+        for(s32 i=0; i<LargeFileSize; i+=ReadSize){
+            result = result && file.write(ReadSize, data);
+        }
+        LFREE(data);
+        file.close();
+        return result;
+    }
+}
+
+    LBENCH("VFS/OS/open_read_close", NumSmallFiles)
+    {
+        VirtualFileSystemOS vfs("data");
+        if(!openRead(state, vfs)){
+            state.skip("no data directory, run in lcore/test");
+        }
+    }
+
+    LBENCH("VFS/Pack/open_read_close", NumSmallFiles)
+    {
+        VFSPack vfsPack;
+        if(!readVFSPack(vfsPack, "data.lpak", true)){
+            state.skip("no data.lpak, run in lcore/test");
+            return;
+        }
+        VirtualFileSystemPack vfs(vfsPack);
+        if(!openRead(state, vfs)){
+            state.skip("broken data.lpak");
+        }
+    }
+
+    LBENCH("VFS/OS/sequential_read_64KB", LargeFileSize)
+    {
+        if(!createLargeFile()){
+            state.skip("cannot create a temporary file");
+            return;
+        }
+        VirtualFileSystemOS vfs(".");
+        FileProxy* file = vfs.openFile(LargeFile);
+        if(NULL == file){
+            state.skip("cannot open a temporary file");
+        }else{
+            //The first pass runs in warmup and fills the page cache
+            u8* buffer = reinterpret_cast<u8*>(LMALLOC(ReadSize));
+            while(state.next()){
+                for(s64 offset=0; offset<LargeFileSize; offset+=ReadSize){
+                    file->read(offset, ReadSize, buffer);
+                }
+                bench::State::consume(buffer[0]);
+            }
+            LFREE(buffer);
+            vfs.closeFile(file);
+        }
+        ::remove(LargeFile);
+    }
+}
@@ -15,6 +15,7 @@
 #include <cctype>
 #include <limits>
 #include <new>
+#include <type_traits>
 
 //#define LCORE_DISABLE_F16C
 
@@ -294,6 +295,16 @@ namespace lcore
 
 #define LSTATIC_ASSERT(exp, message) static_assert(exp, message)
 
+    /**
+    @brief 再配置をmemcpyで行える型
+
+    バッファを所有する型でも、自己参照ポインタを持たなければ特殊化してtrue_typeにできる
+    */
+    template<class T>
+    struct is_trivially_relocatable : public std::is_trivially_copyable<T>::type
+    {
+    };
+
     //---------------------------------------------------------
     //---
     //--- Allocator Function
@@ -377,7 +388,7 @@ namespace lcore
 
         inline static T* construct(void* ptr, T&& x)
         {
-            return LPLACEMENT_NEW(ptr) T(x);
+            return LPLACEMENT_NEW(ptr) T(lcore::move(x));
         }
     };
 
@@ -395,6 +406,12 @@ namespace lcore
         return ConstructImpl<T>::construct(ptr, x);
     }
 
+    template<class T>
+    inline typename std::enable_if<!std::is_lvalue_reference<T>::value, T*>::type construct(void* ptr, T&& x)
+    {
+        return ConstructImpl<T>::construct(ptr, lcore::move(x));
+    }
+
 
     //---------------------------------------------------------
     //---
@@ -1071,6 +1088,11 @@ namespace lcore
         return ::memcpy(dst, src, size);
     }
 
+    inline void* memmove(void* dst, const void* src, size_t size)
+    {
+        return ::memmove(dst, src, size);
+    }
+
     //---------------------------------------------------------
     //---
     //--- Color
@@ -0,0 +1,901 @@
+﻿/**
+@file AsyncIO.cpp
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "AsyncIO.h"
+#include "Thread.h"
+
+#if defined(_WIN32)
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define LCORE_ASYNCIO_IOURING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+#endif
+#endif
+
+namespace lcore
+{
+namespace
+{
+    static const s32 Invalid = -1;
+
+    /// 位置指定の同期読み込み
+    s32 readAt(AsyncIO::Handle handle, s64 offset, s64 size, void* data)
+    {
+#if defined(_WIN32)
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = static_cast<DWORD>(offset & 0xFFFFFFFFLL);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset>>32);
+        DWORD numBytesRead = 0;
+        if(!ReadFile(handle, data, static_cast<DWORD>(size), &numBytesRead, &overlapped)){
+            return (ERROR_HANDLE_EOF == GetLastError())? 0 : -1;
+        }
+        return static_cast<s32>(numBytesRead);
+#else
+        for(;;){
+            ssize_t result = ::pread(handle, data, static_cast<size_t>(size), static_cast<off_t>(offset));
+            if(0<=result){
+                return static_cast<s32>(result);
+            }
+            if(EINTR != errno){
+                return -errno;
+            }
+        }
+#endif
+    }
+}
+
+    //----------------------------------------------------
+    //---
+    //--- Driver
+    //---
+    //----------------------------------------------------
+    class AsyncIO::Driver
+    {
+    public:
+        virtual ~Driver()
+        {}
+
+        /// 発行. flushまでOSへ渡さなくてもよい
+        virtual void submit(s32 operation) =0;
+        virtual void flush() =0;
+
+        /**
+        @brief 完了した読み込みを回収する. Operation::result_を埋める
+        @return 回収した数
+        @param wait ... 1つも完了していなければ待つ
+        */
+        virtual s32 reap(s32 maxCount, s32* operations, bool wait) =0;
+    protected:
+        explicit Driver(AsyncIO* owner)
+            :owner_(owner)
+        {}
+
+        inline void getTarget(s32 operation, Handle& handle, s64& offset, s64& size, u8*& data) const
+        {
+            const Operation& op = owner_->operations_[operation];
+            const Request& request = owner_->requests_[op.request_];
+            const Segment& segment = request.segments_[op.segment_];
+            handle = request.handle_;
+            offset = segment.offset_ + op.done_;
+            size = op.size_;
+            data = static_cast<u8*>(segment.data_) + op.done_;
+        }
+
+        AsyncIO* owner_;
+    };
+
+#if defined(LCORE_ASYNCIO_IOURING)
+    //----------------------------------------------------
+    //---
+    //--- DriverIOUring
+    //---
+    //----------------------------------------------------
+    /**
+    @brief liburingを使わずにシステムコールで直接扱う
+    */
+    class AsyncIO::DriverIOUring : public AsyncIO::Driver
+    {
+    public:
+        static DriverIOUring* create(AsyncIO* owner, s32 entries);
+        virtual ~DriverIOUring();
+
+        virtual void submit(s32 operation);
+        virtual void flush();
+        virtual s32 reap(s32 maxCount, s32* operations, bool wait);
+    private:
+        explicit DriverIOUring(AsyncIO* owner);
+        bool initialize(s32 entries);
+
+        s32 enter(u32 toSubmit, u32 minComplete, u32 flags);
+
+        s32 fd_;
+        u32 toSubmit_;
+        u8* sqRing_;
+        u8* cqRing_;
+        size_t sqRingSize_;
+        size_t cqRingSize_;
+        io_uring_sqe* sqes_;
+        size_t sqesSize_;
+        u32* sqTail_;
+        u32 sqMask_;
+        u32* sqArray_;
+        u32* cqHead_;
+        u32* cqTail_;
+        u32 cqMask_;
+        io_uring_cqe* cqes_;
+        iovec* iovecs_;
+    };
+
+    AsyncIO::DriverIOUring* AsyncIO::DriverIOUring::create(AsyncIO* owner, s32 entries)
+    {
+        DriverIOUring* driver = LNEW DriverIOUring(owner);
+        if(!driver->initialize(entries)){
+            LDELETE(driver);
+        }
+        return driver;
+    }
+
+    AsyncIO::DriverIOUring::DriverIOUring(AsyncIO* owner)
+        :Driver(owner)
+        ,fd_(-1)
+        ,toSubmit_(0)
+        ,sqRing_(static_cast<u8*>(MAP_FAILED))
+        ,cqRing_(static_cast<u8*>(MAP_FAILED))
+        ,sqRingSize_(0)
+        ,cqRingSize_(0)
+        ,sqes_(static_cast<io_uring_sqe*>(MAP_FAILED))
+        ,sqesSize_(0)
+        ,iovecs_(NULL)
+    {
+    }
+
+    AsyncIO::DriverIOUring::~DriverIOUring()
+    {
+        if(MAP_FAILED != sqes_){
+            munmap(sqes_, sqesSize_);
+        }
+        if(MAP_FAILED != cqRing_ && cqRing_ != sqRing_){
+            munmap(cqRing_, cqRingSize_);
+        }
+        if(MAP_FAILED != sqRing_){
+            munmap(sqRing_, sqRingSize_);
+        }
+        if(0<=fd_){
+            close(fd_);
+        }
+        LFREE(iovecs_);
+    }
+
+    bool AsyncIO::DriverIOUring::initialize(s32 entries)
+    {
+        io_uring_params params;
+        lcore::memset(&params, 0, sizeof(params));
+        fd_ = static_cast<s32>(syscall(__NR_io_uring_setup, static_cast<u32>(entries), &params));
+        if(fd_<0){
+            //カーネルが古い, seccompで禁止されているなど
+            return false;
+        }
+        //一度に発行できる数が少なければ使わない
+        if(params.sq_entries<static_cast<u32>(entries)){
+            return false;
+        }
+
+        sqRingSize_ = params.sq_off.array + params.sq_entries*sizeof(u32);
+        cqRingSize_ = params.cq_off.cqes + params.cq_entries*sizeof(io_uring_cqe);
+        bool singleMap = 0 != (params.features & IORING_FEAT_SINGLE_MMAP);
+        if(singleMap){
+            sqRingSize_ = cqRingSize_ = maximum(sqRingSize_, cqRingSize_);
+        }
+        sqRing_ = static_cast<u8*>(mmap(NULL, sqRingSize_, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, fd_, IORING_OFF_SQ_RING));
+        if(MAP_FAILED == sqRing_){
+            return false;
+        }
+        if(singleMap){
+            cqRing_ = sqRing_;
+        }else{
+            cqRing_ = static_cast<u8*>(mmap(NULL, cqRingSize_, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, fd_, IORING_OFF_CQ_RING));
+            if(MAP_FAILED == cqRing_){
+                return false;
+            }
+        }
+        sqesSize_ = params.sq_entries*sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe*>(mmap(NULL, sqesSize_, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, fd_, IORING_OFF_SQES));
+        if(MAP_FAILED == sqes_){
+            return false;
+        }
+
+        sqTail_ = reinterpret_cast<u32*>(sqRing_ + params.sq_off.tail);
+        sqMask_ = *reinterpret_cast<u32*>(sqRing_ + params.sq_off.ring_mask);
+        sqArray_ = reinterpret_cast<u32*>(sqRing_ + params.sq_off.array);
+        cqHead_ = reinterpret_cast<u32*>(cqRing_ + params.cq_off.head);
+        cqTail_ = reinterpret_cast<u32*>(cqRing_ + params.cq_off.tail);
+        cqMask_ = *reinterpret_cast<u32*>(cqRing_ + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cqRing_ + params.cq_off.cqes);
+
+        iovecs_ = static_cast<iovec*>(LMALLOC(sizeof(iovec)*entries));
+        return true;
+    }
+
+    s32 AsyncIO::DriverIOUring::enter(u32 toSubmit, u32 minComplete, u32 flags)
+    {
+        for(;;){
+            s32 result = static_cast<s32>(syscall(__NR_io_uring_enter, fd_, toSubmit, minComplete, flags, NULL, 0));
+            if(0<=result || EINTR != errno){
+                return result;
+            }
+        }
+    }
+
+    void AsyncIO::DriverIOUring::submit(s32 operation)
+    {
+        Handle handle;
+        s64 offset;
+        s64 size;
+        u8* data;
+        getTarget(operation, handle, offset, size, data);
+        iovecs_[operation].iov_base = data;
+        iovecs_[operation].iov_len = static_cast<size_t>(size);
+
+        //発行中の数はmaxInFlight_以下なので溢れない
+        u32 tail = *sqTail_;
+        u32 index = tail & sqMask_;
+        io_uring_sqe& sqe = sqes_[index];
+        lcore::memset(&sqe, 0, sizeof(io_uring_sqe));
+        sqe.opcode = IORING_OP_READV;
+        sqe.fd = handle;
+        sqe.off = static_cast<u64>(offset);
+        sqe.addr = reinterpret_cast<u64>(&iovecs_[operation]);
+        sqe.len = 1;
+        sqe.user_data = static_cast<u64>(operation);
+        sqArray_[index] = index;
+        __atomic_store_n(sqTail_, tail+1, __ATOMIC_RELEASE);
+        ++toSubmit_;
+    }
+
+    void AsyncIO::DriverIOUring::flush()
+    {
+        if(toSubmit_<=0){
+            return;
+        }
+        s32 result = enter(toSubmit_, 0, 0);
+        if(0<result){
+            toSubmit_ -= static_cast<u32>(result);
+        }
+    }
+
+    s32 AsyncIO::DriverIOUring::reap(s32 maxCount, s32* operations, bool wait)
+    {
+        u32 head = *cqHead_;
+        u32 tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+        if(head == tail && (wait || 0<toSubmit_)){
+            //未発行分も一緒に渡す
+            u32 toSubmit = toSubmit_;
+            s32 result = enter(toSubmit, (wait)? 1 : 0, (wait)? IORING_ENTER_GETEVENTS : 0);
+            if(0<result){
+                toSubmit_ -= minimum(static_cast<u32>(result), toSubmit);
+            }
+            tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+        }
+
+        s32 count = 0;
+        while(head != tail && count<maxCount){
+            const io_uring_cqe& cqe = cqes_[head & cqMask_];
+            s32 operation = static_cast<s32>(cqe.user_data);
+            owner_->operations_[operation].result_ = cqe.res;
+            operations[count++] = operation;
+            ++head;
+        }
+        __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+        return count;
+    }
+#endif
+
+    //----------------------------------------------------
+    //---
+    //--- DriverThread
+    //---
+    //----------------------------------------------------
+    /**
+    @brief I/Oスレッドで同期読み込みする
+    */
+    class AsyncIO::DriverThread : public AsyncIO::Driver
+    {
+    public:
+        static DriverThread* create(AsyncIO* owner, s32 numThreads);
+        virtual ~DriverThread();
+
+        virtual void submit(s32 operation);
+        virtual void flush();
+        virtual s32 reap(s32 maxCount, s32* operations, bool wait);
+    private:
+        explicit DriverThread(AsyncIO* owner);
+        bool initialize(s32 numThreads);
+
+#if defined(_WIN32)
+        static void proc(u32 threadId, void* data);
+#else
+        static void proc(void* data);
+#endif
+        void run();
+
+        bool canRun_;
+        s32 submitHead_;
+        s32 submitTail_;
+        s32 completeHead_;
+        s32 completeTail_;
+        CriticalSection cs_;
+        Event submitted_; ///< submitが空でなくなった
+        Event completed_; ///< 完了が積まれた
+        s32 numThreads_;
+        ThreadRaw* threads_;
+    };
+
+    AsyncIO::DriverThread* AsyncIO::DriverThread::create(AsyncIO* owner, s32 numThreads)
+    {
+        DriverThread* driver = LNEW DriverThread(owner);
+        if(!driver->initialize(numThreads)){
+            LDELETE(driver);
+        }
+        return driver;
+    }
+
+    AsyncIO::DriverThread::DriverThread(AsyncIO* owner)
+        :Driver(owner)
+        ,canRun_(true)
+        ,submitHead_(Invalid)
+        ,submitTail_(Invalid)
+        ,completeHead_(Invalid)
+        ,completeTail_(Invalid)
+        ,submitted_(false, false)
+        ,completed_(false, false)
+        ,numThreads_(0)
+        ,threads_(NULL)
+    {
+    }
+
+    AsyncIO::DriverThread::~DriverThread()
+    {
+        {
+            CSLock lock(cs_);
+            canRun_ = false;
+        }
+        //起きたスレッドが次を起こす
+        submitted_.set();
+        for(s32 i=0; i<numThreads_; ++i){
+            threads_[i].join();
+        }
+        LDELETE_ARRAY(threads_);
+    }
+
+    bool AsyncIO::DriverThread::initialize(s32 numThreads)
+    {
+        threads_ = LNEW ThreadRaw[numThreads];
+        for(s32 i=0; i<numThreads; ++i){
+            if(!threads_[i].create(DriverThread::proc, this, false)){
+                return false;
+            }
+            ++numThreads_;
+        }
+        return true;
+    }
+
+#if defined(_WIN32)
+    void AsyncIO::DriverThread::proc(u32 /*threadId*/, void* data)
+#else
+    void AsyncIO::DriverThread::proc(void* data)
+#endif
+    {
+        static_cast<DriverThread*>(data)->run();
+    }
+
+    void AsyncIO::DriverThread::run()
+    {
+        Operation* operations = owner_->operations_;
+        for(;;){
+            s32 operation = Invalid;
+            bool wakeNext = false;
+            bool canRun;
+            {
+                CSLock lock(cs_);
+                canRun = canRun_;
+                if(!canRun){
+                    wakeNext = true;
+                }else if(Invalid != submitHead_){
+                    operation = submitHead_;
+                    submitHead_ = operations[operation].next_;
+                    if(Invalid == submitHead_){
+                        submitTail_ = Invalid;
+                    }else{
+                        //残りを他のスレッドに渡す
+                        wakeNext = true;
+                    }
+                }
+            }
+            if(wakeNext){
+                submitted_.set();
+            }
+            if(Invalid == operation){
+                if(!canRun){
+                    return;
+                }
+                submitted_.wait(thread::Infinite);
+                continue;
+            }
+
+            Handle handle;
+            s64 offset;
+            s64 size;
+            u8* data;
+            getTarget(operation, handle, offset, size, data);
+            operations[operation].result_ = readAt(handle, offset, size, data);
+
+            {
+                CSLock lock(cs_);
+                operations[operation].next_ = Invalid;
+                if(Invalid == completeTail_){
+                    completeHead_ = operation;
+                }else{
+                    operations[completeTail_].next_ = operation;
+                }
+                completeTail_ = operation;
+            }
+            completed_.set();
+        }
+    }
+
+    void AsyncIO::DriverThread::submit(s32 operation)
+    {
+        Operation* operations = owner_->operations_;
+        CSLock lock(cs_);
+        operations[operation].next_ = Invalid;
+        if(Invalid == submitTail_){
+            submitHead_ = operation;
+        }else{
+            operations[submitTail_].next_ = operation;
+        }
+        submitTail_ = operation;
+    }
+
+    void AsyncIO::DriverThread::flush()
+    {
+        submitted_.set();
+    }
+
+    s32 AsyncIO::DriverThread::reap(s32 maxCount, s32* operations, bool wait)
+    {
+        Operation* ops = owner_->operations_;
+        for(;;){
+            s32 count = 0;
+            {
+                CSLock lock(cs_);
+                while(Invalid != completeHead_ && count<maxCount){
+                    operations[count++] = completeHead_;
+                    completeHead_ = ops[completeHead_].next_;
+                }
+                if(Invalid == completeHead_){
+                    completeTail_ = Invalid;
+                }
+            }
+            if(0<count || !wait){
+                return count;
+            }
+            completed_.wait(thread::Infinite);
+        }
+    }
+
+    //----------------------------------------------------
+    //---
+    //--- AsyncIO
+    //---
+    //----------------------------------------------------
+#if defined(_WIN32)
+    const AsyncIO::Handle AsyncIO::InvalidHandle = INVALID_HANDLE_VALUE;
+#else
+    const AsyncIO::Handle AsyncIO::InvalidHandle = -1;
+#endif
+
+    void AsyncIO::getDefaultParam(Param& param)
+    {
+        param.maxRequests_ = DefaultMaxRequests;
+        param.maxInFlight_ = DefaultMaxInFlight;
+        param.numThreads_ = DefaultNumThreads;
+        param.disableIOUring_ = false;
+    }
+
+    AsyncIO::Handle AsyncIO::openFile(const Char* path)
+    {
+        LASSERT(NULL != path);
+#if defined(_WIN32)
+        return CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+#else
+        return ::open(path, O_RDONLY|O_CLOEXEC);
+#endif
+    }
+
+    void AsyncIO::closeFile(Handle handle)
+    {
+        if(InvalidHandle == handle){
+            return;
+        }
+#if defined(_WIN32)
+        CloseHandle(handle);
+#else
+        ::close(handle);
+#endif
+    }
+
+    AsyncIO::AsyncIO()
+        :backend_(Backend_None)
+        ,maxRequests_(0)
+        ,maxInFlight_(0)
+        ,numInFlight_(0)
+        ,numActive_(0)
+        ,numCompleted_(0)
+        ,requests_(NULL)
+        ,freeRequests_(Invalid)
+        ,operations_(NULL)
+        ,freeOperations_(Invalid)
+        ,completed_(NULL)
+        ,notifyHead_(Invalid)
+        ,notifyTail_(Invalid)
+        ,driver_(NULL)
+    {
+        for(s32 i=0; i<Priority_Num; ++i){
+            pendingHead_[i] = pendingTail_[i] = Invalid;
+        }
+    }
+
+    AsyncIO::~AsyncIO()
+    {
+        terminate();
+    }
+
+    bool AsyncIO::initialize(const Param& param)
+    {
+        LASSERT(0<param.maxRequests_ && param.maxRequests_<=static_cast<s32>(IndexMask+1));
+        LASSERT(0<param.maxInFlight_);
+        terminate();
+
+        maxRequests_ = param.maxRequests_;
+        maxInFlight_ = param.maxInFlight_;
+        requests_ = static_cast<Request*>(LMALLOC(sizeof(Request)*maxRequests_));
+        for(s32 i=0; i<maxRequests_; ++i){
+            requests_[i].generation_ = 0;
+            requests_[i].status_ = Status_Invalid;
+            requests_[i].next_ = i+1;
+            requests_[i].segments_ = NULL;
+        }
+        requests_[maxRequests_-1].next_ = Invalid;
+        freeRequests_ = 0;
+
+        operations_ = static_cast<Operation*>(LMALLOC(sizeof(Operation)*maxInFlight_));
+        for(s32 i=0; i<maxInFlight_; ++i){
+            operations_[i].next_ = i+1;
+        }
+        operations_[maxInFlight_-1].next_ = Invalid;
+        freeOperations_ = 0;
+        completed_ = static_cast<s32*>(LMALLOC(sizeof(s32)*maxInFlight_));
+
+#if defined(LCORE_ASYNCIO_IOURING)
+        if(!param.disableIOUring_){
+            driver_ = DriverIOUring::create(this, maxInFlight_);
+            backend_ = (NULL != driver_)? Backend_IOUring : Backend_None;
+        }
+#endif
+        if(NULL == driver_){
+            driver_ = DriverThread::create(this, maximum(param.numThreads_, 1));
+            backend_ = (NULL != driver_)? Backend_Thread : Backend_None;
+        }
+        if(NULL == driver_){
+            terminate();
+            return false;
+        }
+        return true;
+    }
+
+    void AsyncIO::terminate()
+    {
+        if(NULL != driver_){
+            completeAll();
+            LDELETE(driver_);
+        }
+        if(NULL != requests_){
+            for(s32 i=0; i<maxRequests_; ++i){
+                if(requests_[i].segments_ != requests_[i].inlineSegments_){
+                    LFREE(requests_[i].segments_);
+                }
+            }
+        }
+        LFREE(completed_);
+        LFREE(operations_);
+        LFREE(requests_);
+        backend_ = Backend_None;
+        maxRequests_ = 0;
+        maxInFlight_ = 0;
+        numInFlight_ = 0;
+        numActive_ = 0;
+        numCompleted_ = 0;
+        freeRequests_ = Invalid;
+        freeOperations_ = Invalid;
+        for(s32 i=0; i<Priority_Num; ++i){
+            pendingHead_[i] = pendingTail_[i] = Invalid;
+        }
+        notifyHead_ = notifyTail_ = Invalid;
+    }
+
+    AsyncIO::RequestID AsyncIO::read(Handle handle, s64 offset, s64 size, void* data, s32 priority, Callback callback, void* userData)
+    {
+        Segment segment = {offset, size, data};
+        return read(handle, 1, &segment, priority, callback, userData);
+    }
+
+    AsyncIO::RequestID AsyncIO::read(Handle handle, s32 numSegments, const Segment* segments, s32 priority, Callback callback, void* userData)
+    {
+        LASSERT(NULL != driver_);
+        LASSERT(InvalidHandle != handle);
+        LASSERT(0<=numSegments);
+        LASSERT(0==numSegments || NULL != segments);
+        LASSERT(0<=priority && priority<Priority_Num);
+        if(Invalid == freeRequests_){
+            return InvalidID;
+        }
+        s32 index = freeRequests_;
+        Request& request = requests_[index];
+        freeRequests_ = request.next_;
+
+        request.generation_ = (request.generation_+1) & IndexMask;
+        if(0 == request.generation_){
+            request.generation_ = 1;
+        }
+        request.status_ = Status_Pending;
+        request.priority_ = priority;
+        request.next_ = Invalid;
+        request.handle_ = handle;
+        request.callback_ = callback;
+        request.userData_ = userData;
+        request.numSegments_ = numSegments;
+        request.nextSegment_ = 0;
+        request.numOutstanding_ = 0;
+        request.error_ = false;
+        request.segments_ = (numSegments<=InlineSegments)
+            ? request.inlineSegments_
+            : static_cast<Segment*>(LMALLOC(sizeof(Segment)*numSegments));
+        for(s32 i=0; i<numSegments; ++i){
+            LASSERT(0<=segments[i].offset_);
+            LASSERT(0<=segments[i].size_);
+            LASSERT(segments[i].size_<=0 || NULL != segments[i].data_);
+            request.segments_[i] = segments[i];
+        }
+        ++numActive_;
+
+        skipEmptySegments(request);
+        if(request.numSegments_<=request.nextSegment_){
+            //読むものがなければ次のpollで通知する
+            notify(index);
+        }else{
+            pushPending(index);
+            dispatch();
+        }
+        return (request.generation_<<IndexBits) | static_cast<u32>(index);
+    }
+
+    s32 AsyncIO::poll()
+    {
+        return step(false);
+    }
+
+    s32 AsyncIO::complete(RequestID id)
+    {
+        s32 index = getRequestIndex(id);
+        if(index<0){
+            return Status_Invalid;
+        }
+        Request& request = requests_[index];
+        LASSERT(NULL == request.callback_);
+        while(request.status_<Status_Done){
+            step(true);
+        }
+        s32 status = request.status_;
+        releaseRequest(index);
+        return status;
+    }
+
+    void AsyncIO::completeAll()
+    {
+        while(0<numActive_ || Invalid != notifyHead_){
+            step(0<numActive_);
+        }
+    }
+
+    s32 AsyncIO::getStatus(RequestID id) const
+    {
+        s32 index = getRequestIndex(id);
+        return (index<0)? Status_Invalid : requests_[index].status_;
+    }
+
+    s32 AsyncIO::getRequestIndex(RequestID id) const
+    {
+        s32 index = static_cast<s32>(id & IndexMask);
+        u32 generation = id>>IndexBits;
+        if(maxRequests_<=index || 0 == generation){
+            return Invalid;
+        }
+        const Request& request = requests_[index];
+        return (generation == request.generation_ && Status_Invalid != request.status_)? index : Invalid;
+    }
+
+    void AsyncIO::skipEmptySegments(Request& request)
+    {
+        while(request.nextSegment_<request.numSegments_ && request.segments_[request.nextSegment_].size_<=0){
+            ++request.nextSegment_;
+        }
+    }
+
+    void AsyncIO::pushPending(s32 index)
+    {
+        Request& request = requests_[index];
+        s32 priority = request.priority_;
+        request.next_ = Invalid;
+        if(Invalid == pendingTail_[priority]){
+            pendingHead_[priority] = index;
+        }else{
+            requests_[pendingTail_[priority]].next_ = index;
+        }
+        pendingTail_[priority] = index;
+    }
+
+    void AsyncIO::popPending(s32 priority)
+    {
+        s32 index = pendingHead_[priority];
+        LASSERT(Invalid != index);
+        pendingHead_[priority] = requests_[index].next_;
+        if(Invalid == pendingHead_[priority]){
+            pendingTail_[priority] = Invalid;
+        }
+        requests_[index].next_ = Invalid;
+    }
+
+    //優先度の高い要求から, 空いている分だけ発行する
+    void AsyncIO::dispatch()
+    {
+        s64 maxIOSize = MaxIOSize;
+        s32 count = 0;
+        for(s32 priority=0; priority<Priority_Num; ++priority){
+            while(Invalid != pendingHead_[priority]){
+                if(Invalid == freeOperations_){
+                    break;
+                }
+                s32 index = pendingHead_[priority];
+                Request& request = requests_[index];
+                LASSERT(request.nextSegment_<request.numSegments_);
+
+                s32 operation = freeOperations_;
+                Operation& op = operations_[operation];
+                freeOperations_ = op.next_;
+                op.request_ = index;
+                op.segment_ = request.nextSegment_;
+                op.done_ = 0;
+                op.size_ = minimum(request.segments_[op.segment_].size_, maxIOSize);
+                op.next_ = Invalid;
+                op.result_ = 0;
+
+                ++request.nextSegment_;
+                ++request.numOutstanding_;
+                request.status_ = Status_Reading;
+                ++numInFlight_;
+                driver_->submit(operation);
+                ++count;
+
+                //全て発行したら発行待ちから外す
+                skipEmptySegments(request);
+                if(request.numSegments_<=request.nextSegment_){
+                    popPending(priority);
+                }
+            }
+        }
+        if(0<count){
+            driver_->flush();
+        }
+    }
+
+    void AsyncIO::finishOperation(s32 operation)
+    {
+        Operation& op = operations_[operation];
+        s32 index = op.request_;
+        Request& request = requests_[index];
+        const Segment& segment = request.segments_[op.segment_];
+        --numInFlight_;
+
+        if(op.result_<0 || 0 == op.result_){
+            //エラーか終端
+            request.error_ = true;
+        }else{
+            op.done_ += op.result_;
+            if(op.done_<segment.size_){
+                //足りない分を続けて読む
+                s64 maxIOSize = MaxIOSize;
+                op.size_ = minimum(segment.size_-op.done_, maxIOSize);
+                ++numInFlight_;
+                driver_->submit(operation);
+                return;
+            }
+        }
+
+        op.next_ = freeOperations_;
+        freeOperations_ = operation;
+        --request.numOutstanding_;
+        if(request.numOutstanding_<=0 && request.numSegments_<=request.nextSegment_){
+            notify(index);
+        }
+    }
+
+    void AsyncIO::notify(s32 index)
+    {
+        Request& request = requests_[index];
+        request.status_ = (request.error_)? Status_Error : Status_Done;
+        --numActive_;
+        ++numCompleted_;
+        if(NULL == request.callback_){
+            return;
+        }
+        request.next_ = Invalid;
+        if(Invalid == notifyTail_){
+            notifyHead_ = index;
+        }else{
+            requests_[notifyTail_].next_ = index;
+        }
+        notifyTail_ = index;
+    }
+
+    s32 AsyncIO::step(bool wait)
+    {
+        s32 numCompleted = driver_->reap(maxInFlight_, completed_, wait && 0<numInFlight_);
+        for(s32 i=0; i<numCompleted; ++i){
+            finishOperation(completed_[i]);
+        }
+        //空いた分と続きを発行する
+        dispatch();
+        driver_->flush();
+
+        while(Invalid != notifyHead_){
+            s32 index = notifyHead_;
+            Request& request = requests_[index];
+            notifyHead_ = request.next_;
+            if(Invalid == notifyHead_){
+                notifyTail_ = Invalid;
+            }
+            RequestID id = (request.generation_<<IndexBits) | static_cast<u32>(index);
+            Callback callback = request.callback_;
+            s32 status = request.status_;
+            void* userData = request.userData_;
+            releaseRequest(index);
+            //コールバックから次の要求を出してもよい
+            callback(id, status, userData);
+        }
+        s32 count = numCompleted_;
+        numCompleted_ = 0;
+        return count;
+    }
+
+    void AsyncIO::releaseRequest(s32 index)
+    {
+        Request& request = requests_[index];
+        if(request.segments_ != request.inlineSegments_){
+            LFREE(request.segments_);
+        }
+        request.segments_ = NULL;
+        request.status_ = Status_Invalid;
+        request.next_ = freeRequests_;
+        freeRequests_ = index;
+    }
+}
@@ -13,11 +13,42 @@
 #include <unistd.h>
 #endif
 
+#if defined(__GNUC__) && defined(LCORE_CPU_X86)
+#include <cpuid.h>
+#endif
+
 
 namespace lcore
 {
 #if defined(__GNUC__)
-    void cpuid(u32);
+
+    bool isSupportCPUID()
+    {
+#if defined(LCORE_CPU_X86)
+        return 0 != __get_cpuid_max(0, NULL);
+#else
+        return false;
+#endif
+    }
+
+    void cpuid(s32 func, s32& a, s32& b, s32& c, s32& d)
+    {
+        cpuidex(func, 0, a, b, c, d);
+    }
+
+    void cpuidex(s32 func, s32 subfunc, s32& a, s32& b, s32& c, s32& d)
+    {
+#if defined(LCORE_CPU_X86)
+        u32 ta, tb, tc, td;
+        __cpuid_count(func, subfunc, ta, tb, tc, td);
+        a = static_cast<s32>(ta);
+        b = static_cast<s32>(tb);
+        c = static_cast<s32>(tc);
+        d = static_cast<s32>(td);
+#else
+        a = b = c = d = 0;
+#endif
+    }
 
 #elif defined(_MSC_VER)
 
@@ -82,6 +113,16 @@ namespace lcore
 #endif
     }
 
+    void cpuidex(s32 func, s32 subfunc, s32& a, s32& b, s32& c, s32& d)
+    {
+        s32 cpuinfo[4];
+        __cpuidex(cpuinfo, func, subfunc);
+        a = cpuinfo[0];
+        b = cpuinfo[1];
+        c = cpuinfo[2];
+        d = cpuinfo[3];
+    }
+
 #if 0
     bool isWin2000()
     {
@@ -94,6 +135,7 @@ namespace lcore
         VER_SET_CONDITION(conditionMask, VER_MAJORVERSION, VER_GREATER_EQUAL);
         return TRUE == VerifyVersionInfo(&versionInfo, VER_MAJORVERSION, conditionMask);
     }
+#endif
 #endif
 
     /**
@@ -108,9 +150,114 @@ namespace lcore
         return systemInfo.dwNumberOfProcessors;
 #elif defined(__linux__)
         return sysconf(_SC_NPROCESSORS_ONLN);
+#else
+        return 1;
 #endif
     }
 
+namespace
+{
+    /// OSが保存するレジスタの状態
+    u64 getXCR0()
+    {
+#if defined(_MSC_VER)
+        return _xgetbv(0);
+#elif defined(LCORE_CPU_X86)
+        u32 a, d;
+        __asm__ volatile("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+        return (static_cast<u64>(d)<<32) | a;
+#else
+        return 0;
+#endif
+    }
+}
+
+    bool isSupportSSE41()
+    {
+        s32 a, b, c, d;
+        cpuid(CPUID_FUNC_CPUINFO, a, b, c, d);
+        return 0 != (c & CPUINFO2_SSE41);
+    }
+
+    bool isSupportAESNI()
+    {
+        s32 a, b, c, d;
+        cpuid(CPUID_FUNC_CPUINFO, a, b, c, d);
+        return (CPUINFO2_AES|CPUINFO2_SSSE3) == (c & (CPUINFO2_AES|CPUINFO2_SSSE3));
+    }
+
+    bool isSupportAVX()
+    {
+        s32 a, b, c, d;
+        cpuid(CPUID_FUNC_CPUINFO, a, b, c, d);
+        if((CPUINFO2_OSXSAVE|CPUINFO2_AVX) != (c & (CPUINFO2_OSXSAVE|CPUINFO2_AVX))){
+            return false;
+        }
+        //XMM, YMM
+        return 0x06U == (getXCR0() & 0x06U);
+    }
+
+    bool isSupportAVX2()
+    {
+        if(!isSupportAVX()){
+            return false;
+        }
+        s32 a, b, c, d;
+        cpuid(CPUID_FUNC_VERSIONID, a, b, c, d);
+        if(static_cast<u32>(a)<CPUID_FUNC_EXTENDED_FEATURE){
+            return false;
+        }
+        cpuidex(CPUID_FUNC_EXTENDED_FEATURE, 0, a, b, c, d);
+        return 0 != (b & CPUINFO7_AVX2);
+    }
+
+    bool isSupportTSC()
+    {
+        s32 a, b, c, d;
+        cpuid(CPUID_FUNC_CPUINFO, a, b, c, d);
+        return 0 != (d & CPUINFO_TSC);
+    }
+
+    bool isSupportRDTSCP()
+    {
+        s32 a, b, c, d;
+        cpuid(CPUID_FUNC_EXT_VERSIONID, a, b, c, d);
+        if(static_cast<u32>(a)<CPUID_FUNC_EXT_CPUINFO){
+            return false;
+        }
+        cpuid(CPUID_FUNC_EXT_CPUINFO, a, b, c, d);
+        return 0 != (d & CPUINFO_EXT_RDTSCP);
+    }
+
+    bool isInvariantTSC()
+    {
+        if(!isSupportTSC()){
+            return false;
+        }
+        s32 a, b, c, d;
+        cpuid(CPUID_FUNC_EXT_VERSIONID, a, b, c, d);
+        if(static_cast<u32>(a)<CPUID_FUNC_EXT_POWERINFO){
+            return false;
+        }
+        cpuid(CPUID_FUNC_EXT_POWERINFO, a, b, c, d);
+        return 0 != (d & CPUINFO_POWER_INVARIANT_TSC);
+    }
+
+    u64 getTSCFrequencyFromCPUID()
+    {
+        s32 a, b, c, d;
+        cpuid(CPUID_FUNC_VERSIONID, a, b, c, d);
+        if(static_cast<u32>(a)<CPUID_FUNC_TSCINFO){
+            return 0;
+        }
+        //EAX:分母, EBX:分子, ECX:水晶発振器の周波数
+        cpuid(CPUID_FUNC_TSCINFO, a, b, c, d);
+        if(0 == a || 0 == b || 0 == c){
+            return 0;
+        }
+        return static_cast<u64>(static_cast<u32>(c)) * static_cast<u32>(b) / static_cast<u32>(a);
+    }
+
 namespace
 {
     s16 calcIDIn2Thread(u64 mask)
@@ -205,6 +352,4 @@ namespace
         return;
 #endif
     }
-
-#endif
 }
@@ -4,6 +4,13 @@
 @date 2014/01/06 create
 */
 #include "Cryptography.h"
+#include "CPU.h"
+#include "Thread.h"
+
+#if defined(LCORE_CPU_X86)
+#include <wmmintrin.h>
+#include <tmmintrin.h>
+#endif
 
 namespace lcore
 {
@@ -978,7 +985,7 @@ namespace
         s1 = GETU32(pt +  4) ^ rk[1];
         s2 = GETU32(pt +  8) ^ rk[2];
         s3 = GETU32(pt + 12) ^ rk[3];
-        if(AES::Mode_ECB != context.mode_){
+        if(NULL != iv){
             s0 = s0 ^ iv[0];
             s1 = s1 ^ iv[1];
             s2 = s2 ^ iv[2];
@@ -1074,7 +1081,7 @@ namespace
             rk[3];
         PUTU32(ct + 12, s3);
 
-        if(AES::Mode_ECB != context.mode_){
+        if(NULL != iv){
             iv[0] = s0;
             iv[1] = s1;
             iv[2] = s2;
@@ -1178,7 +1185,7 @@ namespace
             (Td4[(t0      ) & 0xff] & 0x000000ff) ^
             rk[3];
 
-        if(AES::Mode_ECB != context.mode_){
+        if(NULL != iv){
             s0 = s0 ^ iv[0]; iv[0] = v0;
             s1 = s1 ^ iv[1]; iv[1] = v1;
             s2 = s2 ^ iv[2]; iv[2] = v2;
@@ -1193,8 +1200,400 @@ namespace
 
  }
 
+namespace
+{
+    /// ブロック番号からカウンタブロックを作る。IVを128ビットのビッグエンディアン整数として加算する
+    inline void getCounter(u64& high, u64& low, const u32* IV, u64 block)
+    {
+        high = (static_cast<u64>(IV[0])<<32) | IV[1];
+        low = (static_cast<u64>(IV[2])<<32) | IV[3];
+        u64 next = low + block;
+        high += (next<low)? 1 : 0;
+        low = next;
+    }
+
+    inline void incrementCounter(u64& high, u64& low)
+    {
+        if(0 == ++low){
+            ++high;
+        }
+    }
+
+    inline void putCounter(u8* bytes, u64 high, u64 low)
+    {
+        PUTU32(bytes     , static_cast<u32>(high>>32));
+        PUTU32(bytes +  4, static_cast<u32>(high));
+        PUTU32(bytes +  8, static_cast<u32>(low>>32));
+        PUTU32(bytes + 12, static_cast<u32>(low));
+    }
+
+    inline void xorBytes(u8* dst, const u8* src, const u8* key, s32 length)
+    {
+        for(s32 i=0; i<length; ++i){
+            dst[i] = src[i] ^ key[i];
+        }
+    }
+
+    //----------------------------------------------------
+    // ソフトウェア実装
+    void encryptBlocksSoftware(const AESContext& context, u32* iv, u8* dst, const u8* src, s32 numBlocks)
+    {
+        for(s32 i=0; i<numBlocks; ++i){
+            encryptBlock(context, iv, dst, src);
+            dst += AES::BlockSizeInBytes;
+            src += AES::BlockSizeInBytes;
+        }
+    }
+
+    void decryptBlocksSoftware(const AESContext& context, u32* iv, u8* dst, const u8* src, s32 numBlocks)
+    {
+        for(s32 i=0; i<numBlocks; ++i){
+            decryptBlock(context, iv, dst, src);
+            dst += AES::BlockSizeInBytes;
+            src += AES::BlockSizeInBytes;
+        }
+    }
+
+    void ctrSoftware(const AESContext& context, u8* dst, const u8* src, s32 numBlocks, u64 high, u64 low)
+    {
+        u8 counter[AES::BlockSizeInBytes];
+        u8 key[AES::BlockSizeInBytes];
+        for(s32 i=0; i<numBlocks; ++i){
+            putCounter(counter, high, low);
+            encryptBlock(context, NULL, key, counter);
+            xorBytes(dst, src, key, AES::BlockSizeInBytes);
+            incrementCounter(high, low);
+            dst += AES::BlockSizeInBytes;
+            src += AES::BlockSizeInBytes;
+        }
+    }
+
+#if defined(LCORE_CPU_X86)
+    //----------------------------------------------------
+    // AES-NI
+    // 鍵スケジュールはビッグエンディアンのu32で持っているので、バイト列の順に並べ直して使う。
+    // Dk_は等価逆暗号の鍵なので、そのままaesdecに使える
+    static const s32 NumBlocksInFlight = 8;
+    static const s32 MaxRounds = 14;
+
+    LCORE_TARGET("aes,ssse3") inline __m128i swapWords(__m128i x)
+    {
+        return _mm_shuffle_epi8(x, _mm_setr_epi8(3,2,1,0, 7,6,5,4, 11,10,9,8, 15,14,13,12));
+    }
+
+    LCORE_TARGET("aes,ssse3") inline void loadKeys(__m128i* keys, const u32* rk, s32 Nr)
+    {
+        for(s32 i=0; i<=Nr; ++i){
+            keys[i] = swapWords(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rk + i*4)));
+        }
+    }
+
+    LCORE_TARGET("aes,ssse3") inline __m128i loadIV(const u32* iv)
+    {
+        return swapWords(_mm_loadu_si128(reinterpret_cast<const __m128i*>(iv)));
+    }
+
+    LCORE_TARGET("aes,ssse3") inline void storeIV(u32* iv, __m128i x)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(iv), swapWords(x));
+    }
+
+    LCORE_TARGET("aes,ssse3") inline __m128i encrypt1(__m128i x, const __m128i* keys, s32 Nr)
+    {
+        x = _mm_xor_si128(x, keys[0]);
+        for(s32 r=1; r<Nr; ++r){
+            x = _mm_aesenc_si128(x, keys[r]);
+        }
+        return _mm_aesenclast_si128(x, keys[Nr]);
+    }
+
+    LCORE_TARGET("aes,ssse3") inline __m128i decrypt1(__m128i x, const __m128i* keys, s32 Nr)
+    {
+        x = _mm_xor_si128(x, keys[0]);
+        for(s32 r=1; r<Nr; ++r){
+            x = _mm_aesdec_si128(x, keys[r]);
+        }
+        return _mm_aesdeclast_si128(x, keys[Nr]);
+    }
+
+    /// 依存のない8ブロックを交互に進めて、aesencのレイテンシを隠す
+    LCORE_TARGET("aes,ssse3") inline void encrypt8(__m128i* x, const __m128i* keys, s32 Nr)
+    {
+        for(s32 i=0; i<NumBlocksInFlight; ++i){
+            x[i] = _mm_xor_si128(x[i], keys[0]);
+        }
+        for(s32 r=1; r<Nr; ++r){
+            for(s32 i=0; i<NumBlocksInFlight; ++i){
+                x[i] = _mm_aesenc_si128(x[i], keys[r]);
+            }
+        }
+        for(s32 i=0; i<NumBlocksInFlight; ++i){
+            x[i] = _mm_aesenclast_si128(x[i], keys[Nr]);
+        }
+    }
+
+    LCORE_TARGET("aes,ssse3") inline void decrypt8(__m128i* x, const __m128i* keys, s32 Nr)
+    {
+        for(s32 i=0; i<NumBlocksInFlight; ++i){
+            x[i] = _mm_xor_si128(x[i], keys[0]);
+        }
+        for(s32 r=1; r<Nr; ++r){
+            for(s32 i=0; i<NumBlocksInFlight; ++i){
+                x[i] = _mm_aesdec_si128(x[i], keys[r]);
+            }
+        }
+        for(s32 i=0; i<NumBlocksInFlight; ++i){
+            x[i] = _mm_aesdeclast_si128(x[i], keys[Nr]);
+        }
+    }
+
+    LCORE_TARGET("aes,ssse3") void encryptBlocksAESNI(const AESContext& context, u32* iv, u8* dst, const u8* src, s32 numBlocks)
+    {
+        __m128i keys[MaxRounds+1];
+        s32 Nr = context.Nr_;
+        loadKeys(keys, context.Ek_, Nr);
+        const __m128i* s = reinterpret_cast<const __m128i*>(src);
+        __m128i* d = reinterpret_cast<__m128i*>(dst);
+
+        if(NULL != iv){
+            //CBCは前のブロックに依存するので1つずつ
+            __m128i x = loadIV(iv);
+            for(s32 i=0; i<numBlocks; ++i){
+                x = encrypt1(_mm_xor_si128(_mm_loadu_si128(s+i), x), keys, Nr);
+                _mm_storeu_si128(d+i, x);
+            }
+            storeIV(iv, x);
+            return;
+        }
+
+        s32 i=0;
+        for(; (i+NumBlocksInFlight)<=numBlocks; i+=NumBlocksInFlight){
+            __m128i x[NumBlocksInFlight];
+            for(s32 j=0; j<NumBlocksInFlight; ++j){
+                x[j] = _mm_loadu_si128(s+i+j);
+            }
+            encrypt8(x, keys, Nr);
+            for(s32 j=0; j<NumBlocksInFlight; ++j){
+                _mm_storeu_si128(d+i+j, x[j]);
+            }
+        }
+        for(; i<numBlocks; ++i){
+            _mm_storeu_si128(d+i, encrypt1(_mm_loadu_si128(s+i), keys, Nr));
+        }
+    }
+
+    LCORE_TARGET("aes,ssse3") void decryptBlocksAESNI(const AESContext& context, u32* iv, u8* dst, const u8* src, s32 numBlocks)
+    {
+        __m128i keys[MaxRounds+1];
+        s32 Nr = context.Nr_;
+        loadKeys(keys, context.Dk_, Nr);
+        const __m128i* s = reinterpret_cast<const __m128i*>(src);
+        __m128i* d = reinterpret_cast<__m128i*>(dst);
+
+        //CBCの復号はブロック間の依存がない。入力を先に読むのでその場で復号してもよい
+        __m128i prev = (NULL != iv)? loadIV(iv) : _mm_setzero_si128();
+        s32 i=0;
+        for(; (i+NumBlocksInFlight)<=numBlocks; i+=NumBlocksInFlight){
+            __m128i c[NumBlocksInFlight];
+            __m128i x[NumBlocksInFlight];
+            for(s32 j=0; j<NumBlocksInFlight; ++j){
+                c[j] = x[j] = _mm_loadu_si128(s+i+j);
+            }
+            decrypt8(x, keys, Nr);
+            if(NULL != iv){
+                x[0] = _mm_xor_si128(x[0], prev);
+                for(s32 j=1; j<NumBlocksInFlight; ++j){
+                    x[j] = _mm_xor_si128(x[j], c[j-1]);
+                }
+                prev = c[NumBlocksInFlight-1];
+            }
+            for(s32 j=0; j<NumBlocksInFlight; ++j){
+                _mm_storeu_si128(d+i+j, x[j]);
+            }
+        }
+        for(; i<numBlocks; ++i){
+            __m128i c = _mm_loadu_si128(s+i);
+            __m128i x = decrypt1(c, keys, Nr);
+            if(NULL != iv){
+                x = _mm_xor_si128(x, prev);
+                prev = c;
+            }
+            _mm_storeu_si128(d+i, x);
+        }
+        if(NULL != iv){
+            storeIV(iv, prev);
+        }
+    }
+
+    LCORE_TARGET("aes,ssse3") void ctrAESNI(const AESContext& context, u8* dst, const u8* src, s32 numBlocks, u64 high, u64 low)
+    {
+        __m128i keys[MaxRounds+1];
+        s32 Nr = context.Nr_;
+        loadKeys(keys, context.Ek_, Nr);
+        const __m128i* s = reinterpret_cast<const __m128i*>(src);
+        __m128i* d = reinterpret_cast<__m128i*>(dst);
+        //64ビット2つをビッグエンディアンのバイト列に並べ替える
+        const __m128i swapBytes = _mm_setr_epi8(15,14,13,12, 11,10,9,8, 7,6,5,4, 3,2,1,0);
+
+        s32 i=0;
+        for(; (i+NumBlocksInFlight)<=numBlocks; i+=NumBlocksInFlight){
+            __m128i x[NumBlocksInFlight];
+            for(s32 j=0; j<NumBlocksInFlight; ++j){
+                x[j] = _mm_shuffle_epi8(_mm_set_epi64x(static_cast<s64>(high), static_cast<s64>(low)), swapBytes);
+                incrementCounter(high, low);
+            }
+            encrypt8(x, keys, Nr);
+            for(s32 j=0; j<NumBlocksInFlight; ++j){
+                _mm_storeu_si128(d+i+j, _mm_xor_si128(x[j], _mm_loadu_si128(s+i+j)));
+            }
+        }
+        for(; i<numBlocks; ++i){
+            __m128i x = _mm_shuffle_epi8(_mm_set_epi64x(static_cast<s64>(high), static_cast<s64>(low)), swapBytes);
+            incrementCounter(high, low);
+            x = encrypt1(x, keys, Nr);
+            _mm_storeu_si128(d+i, _mm_xor_si128(x, _mm_loadu_si128(s+i)));
+        }
+    }
+
+    bool useAESNI()
+    {
+        static const bool aesni = isSupportAESNI();
+        return aesni;
+    }
+#endif
+
+    //----------------------------------------------------
+    /**
+    @param iv ... ECBはNULL
+    */
+    void encryptBlocks(const AESContext& context, u32* iv, u8* dst, const u8* src, s32 numBlocks)
+    {
+#if defined(LCORE_CPU_X86)
+        if(context.isHardwareAccelerated()){
+            encryptBlocksAESNI(context, iv, dst, src, numBlocks);
+            return;
+        }
+#endif
+        encryptBlocksSoftware(context, iv, dst, src, numBlocks);
+    }
+
+    void decryptBlocks(const AESContext& context, u32* iv, u8* dst, const u8* src, s32 numBlocks)
+    {
+#if defined(LCORE_CPU_X86)
+        if(context.isHardwareAccelerated()){
+            decryptBlocksAESNI(context, iv, dst, src, numBlocks);
+            return;
+        }
+#endif
+        decryptBlocksSoftware(context, iv, dst, src, numBlocks);
+    }
+
+    void ctrBlocks(const AESContext& context, u8* dst, const u8* src, s32 numBlocks, u64 high, u64 low)
+    {
+#if defined(LCORE_CPU_X86)
+        if(context.isHardwareAccelerated()){
+            ctrAESNI(context, dst, src, numBlocks, high, low);
+            return;
+        }
+#endif
+        ctrSoftware(context, dst, src, numBlocks, high, low);
+    }
+
+    void processCTR(const AESContext& context, u8* dst, const u8* src, s32 length, u64 offset, u64 nonce)
+    {
+        u64 high, low;
+        getCounter(high, low, context.IV_, offset/AES::BlockSizeInBytes);
+        high ^= nonce;
+
+        //ブロックの途中から始まる分
+        s32 skip = static_cast<s32>(offset%AES::BlockSizeInBytes);
+        if(0<skip && 0<length){
+            u8 counter[AES::BlockSizeInBytes];
+            u8 key[AES::BlockSizeInBytes];
+            putCounter(counter, high, low);
+            encryptBlock(context, NULL, key, counter);
+            s32 size = minimum(length, static_cast<s32>(AES::BlockSizeInBytes)-skip);
+            xorBytes(dst, src, key+skip, size);
+            incrementCounter(high, low);
+            dst += size;
+            src += size;
+            length -= size;
+        }
+
+        s32 numBlocks = length/AES::BlockSizeInBytes;
+        ctrBlocks(context, dst, src, numBlocks, high, low);
+
+        s32 rest = length - numBlocks*AES::BlockSizeInBytes;
+        if(0<rest){
+            u64 next = low + numBlocks;
+            high += (next<low)? 1 : 0;
+            low = next;
+            u8 counter[AES::BlockSizeInBytes];
+            u8 key[AES::BlockSizeInBytes];
+            putCounter(counter, high, low);
+            encryptBlock(context, NULL, key, counter);
+            s32 done = numBlocks*AES::BlockSizeInBytes;
+            xorBytes(dst+done, src+done, key, rest);
+        }
+    }
+
+    //----------------------------------------------------
+    //---
+    //--- 並列処理
+    //---
+    //----------------------------------------------------
+    enum JobType
+    {
+        JobType_Encrypt,
+        JobType_Decrypt,
+        JobType_CTR,
+    };
+
+    struct AESJob
+    {
+        const AESContext* context_;
+        u8* dst_;
+        const u8* src_;
+        s32 length_;
+        s32 type_;
+        u64 offset_;
+        u64 nonce_;
+        u32* ivs_; ///< CBCの復号で各チャンクの直前の暗号文
+    };
+
+    void processChunk(void* data, u32 index)
+    {
+        const AESJob& job = *reinterpret_cast<const AESJob*>(data);
+        s32 chunk = static_cast<s32>(index);
+        s32 begin = chunk*AES::ParallelChunkSize;
+        s32 size = minimum(job.length_-begin, AES::ParallelChunkSize);
+        u8* dst = job.dst_ + begin;
+        const u8* src = job.src_ + begin;
+        u32* iv = (NULL != job.ivs_)? job.ivs_ + chunk*4 : NULL;
+        switch(job.type_)
+        {
+        case JobType_Encrypt:
+            encryptBlocks(*job.context_, iv, dst, src, size/AES::BlockSizeInBytes);
+            break;
+        case JobType_Decrypt:
+            decryptBlocks(*job.context_, iv, dst, src, size/AES::BlockSizeInBytes);
+            break;
+        default:
+            processCTR(*job.context_, dst, src, size, job.offset_+begin, job.nonce_);
+            break;
+        }
+    }
+
+    void processParallel(ThreadPool& threadPool, AESJob& job)
+    {
+        s32 numChunks = (job.length_ + AES::ParallelChunkSize - 1)/AES::ParallelChunkSize;
+        parallelFor(&threadPool, processChunk, &job, static_cast<u32>(numChunks));
+    }
+}
+
     AESContext::AESContext()
         :mode_(AES::Mode_None)
+        ,aesni_(AES::isHardwareAccelerated()? 1 : 0)
     {
         for(u32 i=0; i<4; ++i){
             IV_[i] = 0;
@@ -1203,6 +1602,7 @@ namespace
 
     AESContext::AESContext(const u8* IV, const u8* key, u32 keyLength, AES::Mode mode)
         :mode_(AES::Mode_None)
+        ,aesni_(AES::isHardwareAccelerated()? 1 : 0)
     {
         for(u32 i=0; i<4; ++i){
             IV_[i] = 0;
@@ -1244,21 +1644,24 @@ namespace
         return true;
     }
 
+    void AESContext::setHardwareAccelerated(bool enable)
+    {
+        aesni_ = (enable && AES::isHardwareAccelerated())? 1 : 0;
+    }
+
     s32 AES::encrypt(const AESContext& context, u8* cipher, const u8* data, s32 dataLength)
     {
         LASSERT(NULL != cipher);
         LASSERT(NULL != data);
-        LASSERT(PKCS5::checkLength(dataLength, BlockSizeInBytes));
         LASSERT(context.isInitialized());
+        if(Mode_CTR == context.mode_){
+            return ctr(context, cipher, data, dataLength);
+        }
+        LASSERT(PKCS5::checkLength(dataLength, BlockSizeInBytes));
 
         u32 IV[4];
         lcore::memcpy(IV, context.IV_, sizeof(u32)*4);
-
-        for(s32 i=0; i<dataLength; i+=AES::BlockSizeInBytes){
-            encryptBlock(context, IV, cipher, data);
-            cipher += AES::BlockSizeInBytes;
-            data += AES::BlockSizeInBytes;
-        }
+        encryptBlocks(context, (Mode_ECB == context.mode_)? NULL : IV, cipher, data, dataLength/BlockSizeInBytes);
         return dataLength;
     }
 
@@ -1266,20 +1669,128 @@ namespace
     {
         LASSERT(NULL != data);
         LASSERT(NULL != cipher);
-        LASSERT(PKCS5::checkLength(cipherLength, BlockSizeInBytes));
         LASSERT(context.isInitialized());
+        if(Mode_CTR == context.mode_){
+            return ctr(context, data, cipher, cipherLength);
+        }
+        LASSERT(PKCS5::checkLength(cipherLength, BlockSizeInBytes));
 
         u32 IV[4];
         lcore::memcpy(IV, context.IV_, sizeof(u32)*4);
+        decryptBlocks(context, (Mode_ECB == context.mode_)? NULL : IV, data, cipher, cipherLength/BlockSizeInBytes);
+        return cipherLength;
+    }
 
-        for(s32 i=0; i<cipherLength; i+=AES::BlockSizeInBytes){
-            decryptBlock(context, IV, data, cipher);
-            data += AES::BlockSizeInBytes;
-            cipher += AES::BlockSizeInBytes;
+    s32 AES::encrypt(ThreadPool& threadPool, const AESContext& context, u8* cipher, const u8* data, s32 dataLength)
+    {
+        LASSERT(NULL != cipher);
+        LASSERT(NULL != data);
+        LASSERT(context.isInitialized());
+        if(Mode_CTR == context.mode_){
+            return ctr(threadPool, context, cipher, data, dataLength);
         }
+        if(Mode_ECB != context.mode_ || dataLength<=ParallelChunkSize){
+            return encrypt(context, cipher, data, dataLength);
+        }
+        LASSERT(PKCS5::checkLength(dataLength, BlockSizeInBytes));
+
+        AESJob job;
+        job.context_ = &context;
+        job.dst_ = cipher;
+        job.src_ = data;
+        job.length_ = dataLength;
+        job.type_ = JobType_Encrypt;
+        job.offset_ = 0;
+        job.nonce_ = 0;
+        job.ivs_ = NULL;
+        processParallel(threadPool, job);
+        return dataLength;
+    }
+
+    s32 AES::decrypt(ThreadPool& threadPool, const AESContext& context, u8* data, const u8* cipher, s32 cipherLength)
+    {
+        LASSERT(NULL != data);
+        LASSERT(NULL != cipher);
+        LASSERT(context.isInitialized());
+        if(Mode_CTR == context.mode_){
+            return ctr(threadPool, context, data, cipher, cipherLength);
+        }
+        if(cipherLength<=ParallelChunkSize){
+            return decrypt(context, data, cipher, cipherLength);
+        }
+        LASSERT(PKCS5::checkLength(cipherLength, BlockSizeInBytes));
+
+        AESJob job;
+        job.context_ = &context;
+        job.dst_ = data;
+        job.src_ = cipher;
+        job.length_ = cipherLength;
+        job.type_ = JobType_Decrypt;
+        job.offset_ = 0;
+        job.nonce_ = 0;
+        job.ivs_ = NULL;
+        if(Mode_CBC == context.mode_){
+            //その場で復号すると前のチャンクの暗号文が消えるので、先に各チャンクのIVを取っておく
+            s32 numChunks = (cipherLength + ParallelChunkSize - 1)/ParallelChunkSize;
+            job.ivs_ = reinterpret_cast<u32*>(LMALLOC(sizeof(u32)*4*numChunks));
+            lcore::memcpy(job.ivs_, context.IV_, sizeof(u32)*4);
+            for(s32 i=1; i<numChunks; ++i){
+                const u8* prev = cipher + i*ParallelChunkSize - BlockSizeInBytes;
+                u32* iv = job.ivs_ + i*4;
+                iv[0] = GETU32(prev);
+                iv[1] = GETU32(prev + 4);
+                iv[2] = GETU32(prev + 8);
+                iv[3] = GETU32(prev + 12);
+            }
+        }
+        processParallel(threadPool, job);
+        LFREE(job.ivs_);
         return cipherLength;
     }
 
+    s32 AES::ctr(const AESContext& context, u8* dst, const u8* src, s32 length, u64 offset, u64 nonce)
+    {
+        LASSERT(NULL != dst);
+        LASSERT(NULL != src);
+        LASSERT(0<=length);
+        LASSERT(context.isInitialized());
+        processCTR(context, dst, src, length, offset, nonce);
+        return length;
+    }
+
+    s32 AES::ctr(ThreadPool& threadPool, const AESContext& context, u8* dst, const u8* src, s32 length, u64 offset, u64 nonce)
+    {
+        LASSERT(NULL != dst);
+        LASSERT(NULL != src);
+        LASSERT(0<=length);
+        LASSERT(context.isInitialized());
+        if(length<=ParallelChunkSize){
+            processCTR(context, dst, src, length, offset, nonce);
+            return length;
+        }
+
+        AESJob job;
+        job.context_ = &context;
+        job.dst_ = dst;
+        job.src_ = src;
+        job.length_ = length;
+        job.type_ = JobType_CTR;
+        job.offset_ = offset;
+        job.nonce_ = nonce;
+        job.ivs_ = NULL;
+        processParallel(threadPool, job);
+        return length;
+    }
+
+    bool AES::isHardwareAccelerated()
+    {
+#if defined(LCORE_CPU_X86)
+        return useAESNI();
+#else
+        return false;
+#endif
+    }
+
     //----------------------------------------------------
     //---
     //--- BlowFish
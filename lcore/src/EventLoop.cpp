@@ -0,0 +1,616 @@
+/**
+@file EventLoop.cpp
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "EventLoop.h"
+#include "SyncObject.h"
+
+#if defined(LCORE_EVENTLOOP_EPOLL)
+#include <sys/epoll.h>
+#endif
+
+namespace lcore
+{
+    //----------------------------------------------------
+    //---
+    //--- Connection
+    //---
+    //----------------------------------------------------
+    Connection::Connection()
+        :userData_(NULL)
+        ,index_(0)
+        ,nextFree_(-1)
+        ,flags_(0)
+        ,timerSlot_(TimerNone)
+        ,timerRounds_(0)
+    {
+    }
+
+    Connection::~Connection()
+    {
+    }
+
+    //----------------------------------------------------
+    //---
+    //--- EventHandler
+    //---
+    //----------------------------------------------------
+    void EventHandler::onTimeout(EventLoop& loop, Connection& connection)
+    {
+        loop.close(connection);
+    }
+
+    //----------------------------------------------------
+    //---
+    //--- EventLoop
+    //---
+    //----------------------------------------------------
+    EventLoop::EventLoop()
+        :handler_(NULL)
+        ,maxConnections_(0)
+        ,bufferSize_(DefaultBufferSize)
+        ,numConnections_(0)
+        ,freeList_(-1)
+        ,connections_(NULL)
+        ,running_(0)
+#if defined(LCORE_EVENTLOOP_EPOLL)
+        ,epoll_(-1)
+        ,events_(NULL)
+#endif
+        ,timerTick_(DefaultTimerTick)
+        ,timerLastTime_(0)
+        ,timerCurrent_(0)
+        ,numTimers_(0)
+    {
+    }
+
+    EventLoop::~EventLoop()
+    {
+        terminate();
+    }
+
+    bool EventLoop::initialize(EventHandler* handler, s32 maxConnections, s32 bufferSize, u32 timerTick)
+    {
+        LASSERT(NULL != handler);
+        LASSERT(0<maxConnections);
+        LASSERT(0<bufferSize);
+        terminate();
+
+#if defined(LCORE_EVENTLOOP_EPOLL)
+        epoll_ = epoll_create1(EPOLL_CLOEXEC);
+        if(epoll_<0){
+            return false;
+        }
+        events_ = LNEW epoll_event[MaxEvents];
+#endif
+
+        handler_ = handler;
+        maxConnections_ = maxConnections;
+        bufferSize_ = bufferSize;
+        numConnections_ = 0;
+        connections_ = LNEW Connection[maxConnections_];
+        for(s32 i=0; i<maxConnections_; ++i){
+            connections_[i].index_ = i;
+            connections_[i].nextFree_ = i+1;
+        }
+        connections_[maxConnections_-1].nextFree_ = -1;
+        freeList_ = 0;
+
+        timerTick_ = maximum(timerTick, 1U);
+        timerLastTime_ = getTimeMilliSec();
+        timerCurrent_ = 0;
+        numTimers_ = 0;
+        atomicStore(running_, 1);
+        return true;
+    }
+
+    void EventLoop::terminate()
+    {
+        if(NULL != connections_){
+            for(s32 i=0; i<maxConnections_; ++i){
+                if(0 != (connections_[i].flags_&Connection::Flag_Active)){
+                    close(connections_[i]);
+                }
+            }
+            releaseClosed();
+        }
+        pendingReceives_.clear();
+        listener_.close();
+
+#if defined(LCORE_EVENTLOOP_EPOLL)
+        LDELETE_ARRAY(events_);
+        if(0<=epoll_){
+            ::close(epoll_);
+            epoll_ = -1;
+        }
+#endif
+        LDELETE_ARRAY(connections_);
+        handler_ = NULL;
+        maxConnections_ = 0;
+        numConnections_ = 0;
+        freeList_ = -1;
+        numTimers_ = 0;
+        for(s32 i=0; i<TimerWheelSize; ++i){
+            timerWheel_[i].clear();
+        }
+        timerExpired_.clear();
+    }
+
+    bool EventLoop::listen(u16 port, u64 acceptIP, s32 backlog, bool reusePort)
+    {
+        LASSERT(NULL != connections_);
+        listener_.close();
+        if(!listener_.create(Family_INET, SocketType_STREAM, Protocol_TCP)){
+            return false;
+        }
+        s32 enable = 1;
+        listener_.setOption(SocketOption_REUSEADDR, &enable);
+        if(reusePort){
+#if defined(SO_REUSEPORT)
+            if(SOCKET_ERROR == listener_.setOption(SocketOption_REUSEPORT, &enable)){
+                listener_.close();
+                return false;
+            }
+#else
+            listener_.close();
+            return false;
+#endif
+        }
+        if(SOCKET_ERROR == listener_.bind(port, acceptIP)
+            || SOCKET_ERROR == listener_.listen(backlog)
+            || !listener_.setNonBlock())
+        {
+            listener_.close();
+            return false;
+        }
+
+#if defined(LCORE_EVENTLOOP_EPOLL)
+        epoll_event event;
+        event.events = EPOLLIN | EPOLLET;
+        event.data.ptr = NULL;
+        if(epoll_ctl(epoll_, EPOLL_CTL_ADD, listener_.getRaw(), &event)<0){
+            listener_.close();
+            return false;
+        }
+#endif
+        return true;
+    }
+
+    Connection* EventLoop::connect(const SOCKADDR& address)
+    {
+        LASSERT(NULL != connections_);
+        Connection* connection = acquire();
+        if(NULL == connection){
+            return NULL;
+        }
+        Socket& socket = connection->socket_;
+        if(!socket.create(static_cast<Family>(address.sa_family), SocketType_STREAM, Protocol_TCP)
+            || !socket.setNonBlock())
+        {
+            release(connection);
+            return NULL;
+        }
+        socket.setNoDelay(true);
+
+        if(SOCKET_ERROR == socket.connect(address)){
+            s32 error = SocketSystem::getError();
+            if(SocketError_EINPROGRESS != error && !isSocketWouldBlock(error)){
+                release(connection);
+                return NULL;
+            }
+        }
+        //Completion is notified as writable, even if connected immediately
+        connection->flags_ |= Connection::Flag_Connecting;
+        if(!addEvent(*connection)){
+            release(connection);
+            return NULL;
+        }
+        return connection;
+    }
+
+    s32 EventLoop::poll(u32 timeout)
+    {
+        LASSERT(NULL != connections_);
+        if(0<numTimers_){
+            timeout = minimum(timeout, timerTick_);
+        }
+
+        s32 count = 0;
+#if defined(LCORE_EVENTLOOP_EPOLL)
+        count = epoll_wait(epoll_, events_, MaxEvents, static_cast<s32>(timeout));
+        if(count<0){
+            if(EINTR != errno){
+                return -1;
+            }
+            count = 0;
+        }
+        for(s32 i=0; i<count; ++i){
+            Connection* connection = reinterpret_cast<Connection*>(events_[i].data.ptr);
+            if(NULL == connection){
+                acceptAll();
+                continue;
+            }
+            u32 events = events_[i].events;
+            if(connection->isClosed()){
+                continue;
+            }
+            if(0 != (events & EPOLLERR)){
+                close(*connection);
+                continue;
+            }
+            if(0 != (events & EPOLLOUT)){
+                onWritable(*connection);
+            }
+            if(0 != (events & (EPOLLIN|EPOLLRDHUP|EPOLLHUP)) && !connection->isClosed()){
+                onReadable(*connection);
+            }
+        }
+
+#else
+        //Level triggered fallback
+        FDSet readSet;
+        FDSet writeSet;
+        readSet.zero();
+        writeSet.zero();
+        SOCKET maxSocket = 0;
+        if(listener_.valid()){
+            readSet.set(listener_);
+            maxSocket = listener_.getRaw();
+        }
+        for(s32 i=0; i<maxConnections_; ++i){
+            Connection& connection = connections_[i];
+            if(0 == (connection.flags_&Connection::Flag_Active) || connection.isClosed()){
+                continue;
+            }
+            bool interest = false;
+            if(connection.isConnecting() || !connection.sendBuffer_.empty()){
+                writeSet.set(connection.socket_);
+                interest = true;
+            }
+            if(!connection.isConnecting() && !connection.receiveBuffer_.full()){
+                readSet.set(connection.socket_);
+                interest = true;
+            }
+            if(interest){
+                maxSocket = maximum(maxSocket, connection.socket_.getRaw());
+            }
+        }
+        timeval tv;
+        tv.tv_sec = timeout/1000;
+        tv.tv_usec = (timeout%1000)*1000;
+        count = SocketUtil::select(static_cast<s32>(maxSocket+1), &readSet.set_, &writeSet.set_, NULL, &tv);
+        if(count<0){
+            if(SocketError_EINTR != SocketSystem::getError()){
+                return -1;
+            }
+            count = 0;
+        }
+        if(0<count){
+            if(listener_.valid() && readSet.isSet(listener_)){
+                acceptAll();
+            }
+            for(s32 i=0; i<maxConnections_; ++i){
+                Connection& connection = connections_[i];
+                if(0 == (connection.flags_&Connection::Flag_Active) || connection.isClosed()){
+                    continue;
+                }
+                if(writeSet.isSet(connection.socket_)){
+                    onWritable(connection);
+                }
+                if(readSet.isSet(connection.socket_) && !connection.isClosed()){
+                    onReadable(connection);
+                }
+            }
+        }
+#endif
+
+        processPendingReceives();
+        advanceTimer(getTimeMilliSec());
+        releaseClosed();
+        return count;
+    }
+
+    void EventLoop::run()
+    {
+        while(0 != atomicLoad(running_)){
+            if(poll(timerTick_)<0){
+                break;
+            }
+        }
+    }
+
+    void EventLoop::stop()
+    {
+        atomicStore(running_, 0);
+    }
+
+    void EventLoop::runJob(u32 /*threadId*/, s32 /*jobId*/, void* data)
+    {
+        LASSERT(NULL != data);
+        reinterpret_cast<EventLoop*>(data)->run();
+    }
+
+    bool EventLoop::send(Connection& connection, const void* data, s32 size)
+    {
+        if(connection.isClosed()){
+            return false;
+        }
+        NetworkBuffer& sendBuffer = connection.sendBuffer_;
+        if(sendBuffer.getFreeSize()<size){
+            if(!flush(connection) || sendBuffer.getFreeSize()<size){
+                return false;
+            }
+        }
+        sendBuffer.write(data, size);
+        return flush(connection);
+    }
+
+    bool EventLoop::flush(Connection& connection)
+    {
+        if(connection.isClosed()){
+            return false;
+        }
+        if(connection.isConnecting() || connection.sendBuffer_.empty()){
+            return true;
+        }
+        s32 sent;
+        if(NetworkBuffer::Result_Error == connection.sendBuffer_.send(connection.socket_, sent)){
+            close(connection);
+            return false;
+        }
+        return true;
+    }
+
+    void EventLoop::close(Connection& connection)
+    {
+        LASSERT(0 != (connection.flags_&Connection::Flag_Active));
+        if(connection.isClosed()){
+            return;
+        }
+        connection.flags_ |= Connection::Flag_Closed;
+        cancelTimeout(connection);
+        handler_->onClose(*this, connection);
+        closed_.push_back(&connection);
+    }
+
+    void EventLoop::setTimeout(Connection& connection, u32 milliSeconds)
+    {
+        cancelTimeout(connection);
+        if(0 == milliSeconds || connection.isClosed()){
+            return;
+        }
+        if(numTimers_<=0){
+            timerLastTime_ = getTimeMilliSec();
+        }
+        u32 ticks = maximum((milliSeconds+timerTick_-1)/timerTick_, 1U);
+        s32 slot = static_cast<s32>((timerCurrent_+ticks) & (TimerWheelSize-1));
+        connection.timerSlot_ = slot;
+        connection.timerRounds_ = (ticks-1)/TimerWheelSize;
+        timerWheel_[slot].push_back(&connection);
+        ++numTimers_;
+    }
+
+    Connection* EventLoop::acquire()
+    {
+        if(freeList_<0){
+            return NULL;
+        }
+        Connection* connection = &connections_[freeList_];
+        freeList_ = connection->nextFree_;
+        connection->nextFree_ = -1;
+
+        //Buffers are kept while pooled
+        if(!connection->receiveBuffer_.valid()){
+            connection->receiveBuffer_.initialize(bufferSize_);
+            connection->sendBuffer_.initialize(bufferSize_);
+        }
+        connection->receiveBuffer_.clear();
+        connection->sendBuffer_.clear();
+        connection->userData_ = NULL;
+        connection->flags_ = Connection::Flag_Active;
+        connection->timerSlot_ = Connection::TimerNone;
+        connection->timerRounds_ = 0;
+        ++numConnections_;
+        return connection;
+    }
+
+    void EventLoop::release(Connection* connection)
+    {
+        LASSERT(NULL != connection);
+        cancelTimeout(*connection);
+        if(connection->socket_.valid()){
+            removeEvent(*connection);
+            connection->socket_.close();
+        }
+        connection->userData_ = NULL;
+        connection->flags_ = 0;
+        connection->nextFree_ = freeList_;
+        freeList_ = connection->index_;
+        --numConnections_;
+    }
+
+    void EventLoop::releaseClosed()
+    {
+        for(s32 i=0; i<closed_.size(); ++i){
+            release(closed_[i]);
+        }
+        closed_.clear();
+    }
+
+    bool EventLoop::addEvent(Connection& connection)
+    {
+#if defined(LCORE_EVENTLOOP_EPOLL)
+        epoll_event event;
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        event.data.ptr = &connection;
+        return 0 <= epoll_ctl(epoll_, EPOLL_CTL_ADD, connection.socket_.getRaw(), &event);
+#else
+        return true;
+#endif
+    }
+
+    void EventLoop::removeEvent(Connection& connection)
+    {
+#if defined(LCORE_EVENTLOOP_EPOLL)
+        epoll_event event;
+        epoll_ctl(epoll_, EPOLL_CTL_DEL, connection.socket_.getRaw(), &event);
+#endif
+    }
+
+    void EventLoop::acceptAll()
+    {
+        for(;;){
+            Socket socket;
+            if(!listener_.accept(socket, NULL, NULL)){
+                s32 error = SocketSystem::getError();
+                if(SocketError_EINTR == error || SocketError_ECONNABORTED == error){
+                    continue;
+                }
+                return;
+            }
+            Connection* connection = acquire();
+            if(NULL == connection){
+                //Refuse, the pool is exhausted
+                socket.close();
+                continue;
+            }
+            connection->socket_.swap(socket);
+            if(!connection->socket_.setNonBlock() || !addEvent(*connection)){
+                release(connection);
+                continue;
+            }
+            connection->socket_.setNoDelay(true);
+            if(!handler_->onAccept(*this, *connection)){
+                close(*connection);
+            }
+        }
+    }
+
+    void EventLoop::onReadable(Connection& connection)
+    {
+        NetworkBuffer& receiveBuffer = connection.receiveBuffer_;
+        for(;;){
+            s32 received;
+            NetworkBuffer::Result result = receiveBuffer.recv(connection.socket_, received);
+            if(0<received || (NetworkBuffer::Result_Full == result && !receiveBuffer.empty())){
+                handler_->onReceive(*this, connection);
+                if(connection.isClosed()){
+                    return;
+                }
+            }
+            switch(result)
+            {
+            case NetworkBuffer::Result_WouldBlock:
+                return;
+            case NetworkBuffer::Result_Full:
+                if(receiveBuffer.full()){
+                    //Not consumed, retry after the next wait without new edges
+                    if(0 == (connection.flags_&Connection::Flag_ReceivePending)){
+                        connection.flags_ |= Connection::Flag_ReceivePending;
+                        pendingReceives_.push_back(&connection);
+                    }
+                    return;
+                }
+                break;
+            default:
+                close(connection);
+                return;
+            }
+        }
+    }
+
+    void EventLoop::onWritable(Connection& connection)
+    {
+        if(connection.isConnecting()){
+            s32 error = 0;
+            s32 length = sizeof(s32);
+            if(SOCKET_ERROR == connection.socket_.getOption(SocketOption_ERROR, reinterpret_cast<Char*>(&error), &length)
+                || 0 != error)
+            {
+                close(connection);
+                return;
+            }
+            connection.flags_ &= ~Connection::Flag_Connecting;
+            handler_->onConnect(*this, connection);
+            if(connection.isClosed()){
+                return;
+            }
+        }
+        s32 freeSize = connection.sendBuffer_.getFreeSize();
+        if(!flush(connection)){
+            return;
+        }
+        //Data left unconsumed while the send buffer was full gets no new edge, re-drive it
+        if(freeSize<connection.sendBuffer_.getFreeSize() && !connection.receiveBuffer_.empty()){
+            handler_->onReceive(*this, connection);
+        }
+    }
+
+    void EventLoop::processPendingReceives()
+    {
+        s32 count = pendingReceives_.size();
+        for(s32 i=0; i<count; ++i){
+            Connection* connection = pendingReceives_[i];
+            if(0 == (connection->flags_&Connection::Flag_ReceivePending)){
+                continue;
+            }
+            connection->flags_ &= ~Connection::Flag_ReceivePending;
+            if(!connection->isClosed()){
+                onReadable(*connection);
+            }
+        }
+        //Keep ones re-queued while processing
+        for(s32 i=count; i<pendingReceives_.size(); ++i){
+            pendingReceives_[i-count] = pendingReceives_[i];
+        }
+        pendingReceives_.resize(pendingReceives_.size()-count);
+    }
+
+    void EventLoop::cancelTimeout(Connection& connection)
+    {
+        if(0<=connection.timerSlot_){
+            timerWheel_[connection.timerSlot_].remove(&connection);
+        }else if(Connection::TimerExpired == connection.timerSlot_){
+            timerExpired_.remove(&connection);
+        }else{
+            return;
+        }
+        connection.timerSlot_ = Connection::TimerNone;
+        --numTimers_;
+    }
+
+    void EventLoop::advanceTimer(u32 now)
+    {
+        if(numTimers_<=0){
+            timerLastTime_ = now;
+            return;
+        }
+        u32 ticks = (now-timerLastTime_)/timerTick_;
+        timerLastTime_ += ticks*timerTick_;
+        for(u32 i=0; i<ticks; ++i){
+            timerCurrent_ = (timerCurrent_+1) & (TimerWheelSize-1);
+            ConnectionList& slot = timerWheel_[timerCurrent_];
+            Connection* connection = slot.begin();
+            while(connection != slot.end()){
+                Connection* next = connection->getNext();
+                if(0<connection->timerRounds_){
+                    --connection->timerRounds_;
+                }else{
+                    slot.remove(connection);
+                    connection->timerSlot_ = Connection::TimerExpired;
+                    timerExpired_.push_back(connection);
+                }
+                connection = next;
+            }
+        }
+
+        //Callbacks may set or cancel other timers
+        while(0<timerExpired_.size()){
+            Connection* connection = timerExpired_.pop_front();
+            connection->timerSlot_ = Connection::TimerNone;
+            --numTimers_;
+            handler_->onTimeout(*this, *connection);
+        }
+    }
+}
@@ -732,7 +732,7 @@ namespace lcore
         DWORD numByhtesWrote = 0;
         return WriteFile(file_, data, static_cast<DWORD>(size), &numByhtesWrote, NULL);
 #else
-        return 0<fwrite(ptr, size, 1, file_);
+        return 0<fwrite(data, size, 1, file_);
 #endif
     }
 
@@ -742,7 +742,7 @@ namespace lcore
         DWORD numBytesRead = 0;
         return ReadFile(file_, data, static_cast<DWORD>(size), &numBytesRead, NULL);
 #else
-        return 0<fread(ptr, size, 1, file_);
+        return 0<fread(data, size, 1, file_);
 #endif
     }
 
@@ -16,6 +16,7 @@
 #include "FileSystem.h"
 #include "VirtualFileSystem.h"
 #include "VFSPack.h"
+#include "Cryptography.h"
 
 namespace lcore
 {
@@ -120,6 +121,8 @@ namespace fs
         ,uncompressedSize_(0)
         ,compressedSize_(0)
         ,data_(NULL)
+        ,cipher_(NULL)
+        ,nonce_(0)
     {
     }
 
@@ -157,6 +160,19 @@ namespace fs
         }
     }
 
+    void File::setCipher(const AESContext* cipher, u64 nonce)
+    {
+        LASSERT(NULL == cipher || checkFlag(Flag_ShareData));
+        LASSERT(NULL == cipher || AES::Mode_CTR == cipher->mode_);
+        cipher_ = cipher;
+        nonce_ = nonce;
+        if(NULL != cipher_){
+            setFlag(Flag_Encrypted);
+        }else{
+            resetFlag(Flag_Encrypted);
+        }
+    }
+
     bool File::read(s64 offset, s64 size, void* data)
     {
         LASSERT(0<=offset);
@@ -174,7 +190,19 @@ namespace fs
 
         } else if(checkFlag(Flag_ShareData)){
             HANDLE handle = static_cast<HANDLE>(data_);
-            return lcore::File::read(handle, offset+offset_, readSize, data);
+            if(!lcore::File::read(handle, offset+offset_, readSize, data)){
+                return false;
+            }
+            if(checkFlag(Flag_Encrypted)){
+                //ǂ񂾔͈͂
+                static const s64 MaxChunkSize = 0x40000000;
+                u8* bytes = static_cast<u8*>(data);
+                for(s64 i=0; i<readSize; i+=MaxChunkSize){
+                    s32 chunkSize = static_cast<s32>(lcore::minimum(readSize-i, MaxChunkSize));
+                    AES::ctr(*cipher_, bytes+i, bytes+i, chunkSize, static_cast<u64>(offset_+offset+i), nonce_);
+                }
+            }
+            return true;
 
         } else{
             lcore::memcpy(data, static_cast<u8*>(data_)+offset, readSize);
@@ -189,6 +217,9 @@ namespace fs
         if(checkFlag(Flag_ShareData)){
             resetFlag(Flag_ShareData);
             resetFlag(Flag_Compressed);
+            resetFlag(Flag_Encrypted);
+            cipher_ = NULL;
+            nonce_ = 0;
             data_ = LNEW u8[size];
 
         } else if(checkFlag(Flag_Compressed)){
@@ -217,6 +248,8 @@ namespace fs
         lcore::swap(uncompressedSize_, rhs.uncompressedSize_);
         lcore::swap(compressedSize_, rhs.compressedSize_);
         lcore::swap(data_, rhs.data_);
+        lcore::swap(cipher_, rhs.cipher_);
+        lcore::swap(nonce_, rhs.nonce_);
     }
 
     void File::destroy()
@@ -231,6 +264,9 @@ namespace fs
             LDELETE_ARRAY(data_);
         }
         resetFlag(Flag_Compressed);
+        resetFlag(Flag_Encrypted);
+        cipher_ = NULL;
+        nonce_ = 0;
     }
 
     //--------------------------------------------
@@ -464,11 +500,11 @@ namespace fs
     }
 
     //
-    bool FileSystem::mountPack(s32 id, const Char* path, bool checkHash)
+    bool FileSystem::mountPack(s32 id, const Char* path, bool checkHash, const AESContext* cipher)
     {
         LASSERT(0<=id && id<MaxMounts);
         VFSPack vfsPack;
-        if(!readVFSPack(vfsPack, path, checkHash)){
+        if(!readVFSPack(vfsPack, path, checkHash, cipher)){
             return false;
         }
         LDELETE(vfs_[id]);
@@ -565,10 +601,10 @@ namespace fs
     }
 
     //
-    bool FileSystem::packDirectory(const Char* filepath, const Char* path)
+    bool FileSystem::packDirectory(const Char* filepath, const Char* path, const AESContext* cipher)
     {
         LASSERT(NULL != filepath);
         LASSERT(NULL != path);
-        return writeVFSPack(filepath, path);
+        return writeVFSPack(filepath, path, cipher);
     }
 }
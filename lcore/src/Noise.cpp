@@ -5,11 +5,25 @@
 */
 #include "Noise.h"
 #include "Random.h"
+#include "CPU.h"
+#include "Thread.h"
 
 #include <math.h>
 #include <xmmintrin.h> //SSE߃Zbg
 #include <emmintrin.h> //SSE2߃Zbg
 
+#if defined(LCORE_CPU_X86)
+#define LCORE_NOISE_AVX2
+#include <immintrin.h> //AVX2߃Zbg
+#endif
+
+//SSE2AVX2ŋʂ̌vZ. GCC͕KWJ, Ăяo̖߃ZbgŐ
+#if defined(__GNUC__)
+#define LCORE_NOISE_KERNEL inline __attribute__((always_inline))
+#else
+#define LCORE_NOISE_KERNEL inline
+#endif
+
 namespace lcore
 {
 namespace
@@ -18,6 +32,692 @@ namespace
     {
         return _mm_cvtt_ss2si(_mm_load_ss(&x));
     }
+
+    //---------------------------------------------------
+    //---
+    //--- SIMD
+    //---
+    //---------------------------------------------------
+    // ze[uSoABgrad2_, grad3_Ɠl
+    const f32 Grad2X[Noise::NumGrad2] = {1.0f, -1.0f, 0.0f, 0.0f, 0.70710678118f, -0.70710678118f, 0.70710678118f, -0.70710678118f};
+    const f32 Grad2Y[Noise::NumGrad2] = {0.0f, 0.0f, 1.0f, -1.0f, 0.70710678118f, 0.70710678118f, -0.70710678118f, -0.70710678118f};
+    const f32 Grad3X[Noise::NumGrad3] = {1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f};
+    const f32 Grad3Y[Noise::NumGrad3] = {1.0f, 1.0f, -1.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, 1.0f, -1.0f, -1.0f};
+    const f32 Grad3Z[Noise::NumGrad3] = {0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, -1.0f, -1.0f, 0.0f, 0.0f, 1.0f, -1.0f};
+
+    const f32 Simplex2F = 0.366025403784f; //(sqrt(3)-1)/2
+    const f32 Simplex2G = 0.211324865405f; //(3-sqrt(3))/6
+    const f32 Simplex2Scale = 99.20f; //l[-1 1]Ɏ߂
+    const f32 Simplex3F = 0.333333333333f;
+    const f32 Simplex3G = 0.166666666667f;
+    const f32 Simplex3Scale = 76.88f;
+
+    /// fbm, gridňxɏ_̐
+    const s32 BatchSize = 64;
+
+    inline void simplexCorner(NoiseSample2& sample, const Noise::Vector2& g, f32 x, f32 y)
+    {
+        f32 t = 0.5f - x*x - y*y;
+        if(t<=0.0f){
+            return;
+        }
+        f32 t2 = t*t;
+        f32 t4 = t2*t2;
+        f32 gd = g.x_*x + g.y_*y;
+        f32 d = -8.0f*t2*t*gd;
+        sample.value_ += t4*gd;
+        sample.dx_ += d*x + t4*g.x_;
+        sample.dy_ += d*y + t4*g.y_;
+    }
+
+    inline void simplexCorner(NoiseSample3& sample, const Noise::Vector3& g, f32 x, f32 y, f32 z)
+    {
+        f32 t = 0.5f - x*x - y*y - z*z;
+        if(t<=0.0f){
+            return;
+        }
+        f32 t2 = t*t;
+        f32 t4 = t2*t2;
+        f32 gd = g.x_*x + g.y_*y + g.z_*z;
+        f32 d = -8.0f*t2*t*gd;
+        sample.value_ += t4*gd;
+        sample.dx_ += d*x + t4*g.x_;
+        sample.dy_ += d*y + t4*g.y_;
+        sample.dz_ += d*z + t4*g.z_;
+    }
+
+    //---------------------------------------------------
+    struct SSE2
+    {
+        static const s32 Width = 4;
+        typedef __m128 Float;
+        typedef __m128i Int;
+
+        static inline Float load(const f32* x){ return _mm_loadu_ps(x);}
+        static inline void store(f32* x, Float v){ _mm_storeu_ps(x, v);}
+        static inline Float set(f32 x){ return _mm_set1_ps(x);}
+        static inline Int seti(s32 x){ return _mm_set1_epi32(x);}
+
+        static inline Float add(Float x0, Float x1){ return _mm_add_ps(x0, x1);}
+        static inline Float sub(Float x0, Float x1){ return _mm_sub_ps(x0, x1);}
+        static inline Float mul(Float x0, Float x1){ return _mm_mul_ps(x0, x1);}
+        static inline Float maximum(Float x0, Float x1){ return _mm_max_ps(x0, x1);}
+        static inline Float cmpgt(Float x0, Float x1){ return _mm_cmpgt_ps(x0, x1);}
+        static inline Float cmpge(Float x0, Float x1){ return _mm_cmpge_ps(x0, x1);}
+        static inline Float andf(Float x0, Float x1){ return _mm_and_ps(x0, x1);}
+
+        static inline Int iadd(Int x0, Int x1){ return _mm_add_epi32(x0, x1);}
+        static inline Int isub(Int x0, Int x1){ return _mm_sub_epi32(x0, x1);}
+        static inline Int iand(Int x0, Int x1){ return _mm_and_si128(x0, x1);}
+        static inline Int srli(Int x, s32 count){ return _mm_srli_epi32(x, count);}
+        /// rʂ0-1
+        static inline Int toMask(Float x){ return _mm_castps_si128(x);}
+        static inline Float toFloat(Int x){ return _mm_cvtepi32_ps(x);}
+
+        /// Noise::fastFloorƓ
+        static inline Int floor(Float x)
+        {
+            Int i = _mm_cvttps_epi32(x);
+            return _mm_add_epi32(i, _mm_castps_si128(_mm_cmple_ps(x, _mm_setzero_ps())));
+        }
+
+        static inline Int gather(const u8* table, Int index)
+        {
+            s32 i[Width];
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(i), index);
+            return _mm_set_epi32(table[i[3]], table[i[2]], table[i[1]], table[i[0]]);
+        }
+
+        static inline Float gather(const f32* table, Int index)
+        {
+            s32 i[Width];
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(i), index);
+            return _mm_set_ps(table[i[3]], table[i[2]], table[i[1]], table[i[0]]);
+        }
+    };
+
+#if defined(LCORE_NOISE_AVX2)
+    struct AVX2
+    {
+        static const s32 Width = 8;
+        typedef __m256 Float;
+        typedef __m256i Int;
+
+        LCORE_TARGET("avx2") static inline Float load(const f32* x){ return _mm256_loadu_ps(x);}
+        LCORE_TARGET("avx2") static inline void store(f32* x, Float v){ _mm256_storeu_ps(x, v);}
+        LCORE_TARGET("avx2") static inline Float set(f32 x){ return _mm256_set1_ps(x);}
+        LCORE_TARGET("avx2") static inline Int seti(s32 x){ return _mm256_set1_epi32(x);}
+
+        LCORE_TARGET("avx2") static inline Float add(Float x0, Float x1){ return _mm256_add_ps(x0, x1);}
+        LCORE_TARGET("avx2") static inline Float sub(Float x0, Float x1){ return _mm256_sub_ps(x0, x1);}
+        LCORE_TARGET("avx2") static inline Float mul(Float x0, Float x1){ return _mm256_mul_ps(x0, x1);}
+        LCORE_TARGET("avx2") static inline Float maximum(Float x0, Float x1){ return _mm256_max_ps(x0, x1);}
+        LCORE_TARGET("avx2") static inline Float cmpgt(Float x0, Float x1){ return _mm256_cmp_ps(x0, x1, _CMP_GT_OQ);}
+        LCORE_TARGET("avx2") static inline Float cmpge(Float x0, Float x1){ return _mm256_cmp_ps(x0, x1, _CMP_GE_OQ);}
+        LCORE_TARGET("avx2") static inline Float andf(Float x0, Float x1){ return _mm256_and_ps(x0, x1);}
+
+        LCORE_TARGET("avx2") static inline Int iadd(Int x0, Int x1){ return _mm256_add_epi32(x0, x1);}
+        LCORE_TARGET("avx2") static inline Int isub(Int x0, Int x1){ return _mm256_sub_epi32(x0, x1);}
+        LCORE_TARGET("avx2") static inline Int iand(Int x0, Int x1){ return _mm256_and_si256(x0, x1);}
+        LCORE_TARGET("avx2") static inline Int srli(Int x, s32 count){ return _mm256_srli_epi32(x, count);}
+        LCORE_TARGET("avx2") static inline Int toMask(Float x){ return _mm256_castps_si256(x);}
+        LCORE_TARGET("avx2") static inline Float toFloat(Int x){ return _mm256_cvtepi32_ps(x);}
+
+        LCORE_TARGET("avx2") static inline Int floor(Float x)
+        {
+            Int i = _mm256_cvttps_epi32(x);
+            return _mm256_add_epi32(i, _mm256_castps_si256(_mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_LE_OQ)));
+        }
+
+        /// 4oCgǂŉ8rbggBe[ǔPermutationTablePaddingv
+        LCORE_TARGET("avx2") static inline Int gather(const u8* table, Int index)
+        {
+            Int x = _mm256_i32gather_epi32(reinterpret_cast<const int*>(table), index, 1);
+            return _mm256_and_si256(x, _mm256_set1_epi32(0xFF));
+        }
+
+        LCORE_TARGET("avx2") static inline Float gather(const f32* table, Int index)
+        {
+            return _mm256_i32gather_ps(table, index, 4);
+        }
+    };
+
+    bool useAVX2()
+    {
+        static const bool avx2 = isSupportAVX2();
+        return avx2;
+    }
+#endif
+
+//J[lAVX2̓ɕKWĴ, AVXłȂ֐Ƃ̊Ԃ__m256󂯓nƂ͂Ȃ
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+    template<class T>
+    LCORE_NOISE_KERNEL void fade(typename T::Float& r, const typename T::Float& x)
+    {
+        typedef typename T::Float Float;
+        Float t = T::add(T::mul(x, T::sub(T::mul(x, T::set(6.0f)), T::set(15.0f))), T::set(10.0f));
+        r = T::mul(T::mul(T::mul(x, x), x), t);
+    }
+
+    template<class T>
+    LCORE_NOISE_KERNEL void fadeDerivative(typename T::Float& r, const typename T::Float& x)
+    {
+        typedef typename T::Float Float;
+        Float t = T::add(T::mul(x, T::sub(x, T::set(2.0f))), T::set(1.0f));
+        r = T::mul(T::mul(T::mul(T::set(30.0f), x), x), t);
+    }
+
+    /// x0*y0 + x1*y1
+    template<class T>
+    LCORE_NOISE_KERNEL void dot2(typename T::Float& r, const typename T::Float& x0, const typename T::Float& y0, const typename T::Float& x1, const typename T::Float& y1)
+    {
+        r = T::add(T::mul(x0, y0), T::mul(x1, y1));
+    }
+
+    template<class T>
+    LCORE_NOISE_KERNEL void dot3(typename T::Float& r, const typename T::Float& x0, const typename T::Float& y0, const typename T::Float& x1, const typename T::Float& y1, const typename T::Float& x2, const typename T::Float& y2)
+    {
+        r = T::add(T::add(T::mul(x0, y0), T::mul(x1, y1)), T::mul(x2, y2));
+    }
+
+    /// iq8_̒lOd`Ԃ̌WɕבւĕԂ
+    template<class T>
+    LCORE_NOISE_KERNEL void trilinear(typename T::Float& r,
+        const typename T::Float& v000, const typename T::Float& v100, const typename T::Float& v010, const typename T::Float& v110,
+        const typename T::Float& v001, const typename T::Float& v101, const typename T::Float& v011, const typename T::Float& v111,
+        const typename T::Float& tx, const typename T::Float& ty, const typename T::Float& tz)
+    {
+        typedef typename T::Float Float;
+        Float b = T::sub(v100, v000);
+        Float c = T::sub(v010, v000);
+        Float d = T::sub(v001, v000);
+        Float e = T::add(T::sub(T::sub(v110, v010), v100), v000);
+        Float f = T::add(T::sub(T::sub(v101, v001), v100), v000);
+        Float g = T::add(T::sub(T::sub(v011, v001), v010), v000);
+        Float h = T::sub(T::add(T::add(T::sub(T::add(T::sub(T::sub(v111, v011), v101), v001), v110), v010), v100), v000);
+        Float r0 = T::add(T::add(v000, T::mul(b, tx)), T::mul(T::add(c, T::mul(e, tx)), ty));
+        Float r1 = T::add(T::add(d, T::mul(f, tx)), T::mul(T::add(g, T::mul(h, tx)), ty));
+        r = T::add(r0, T::mul(r1, tz));
+    }
+
+    //---------------------------------------------------
+    template<class T>
+    struct Perlin2D
+    {
+        typedef typename T::Float Float;
+        typedef typename T::Int Int;
+
+        static LCORE_NOISE_KERNEL void evaluate(Float& value, Float& dx, Float& dy, const u8* permutation, const Float& px, const Float& py, const Float& frequency)
+        {
+            Float one = T::set(1.0f);
+            Int ix0 = T::floor(px);
+            Int iy0 = T::floor(py);
+            Float tx0 = T::sub(px, T::toFloat(ix0));
+            Float ty0 = T::sub(py, T::toFloat(iy0));
+            Float tx1 = T::sub(tx0, one);
+            Float ty1 = T::sub(ty0, one);
+            Int mask = T::seti(Noise::PermutationTableSizeMask);
+            ix0 = T::iand(ix0, mask);
+            iy0 = T::iand(iy0, mask);
+            Int ix1 = T::iadd(ix0, T::seti(1));
+            Int iy1 = T::iadd(iy0, T::seti(1));
+
+            Int h0 = T::gather(permutation, ix0);
+            Int h1 = T::gather(permutation, ix1);
+            Int gradMask = T::seti(Noise::NumGrad2-1);
+            Int h00 = T::iand(T::gather(permutation, T::iadd(h0, iy0)), gradMask);
+            Int h10 = T::iand(T::gather(permutation, T::iadd(h1, iy0)), gradMask);
+            Int h01 = T::iand(T::gather(permutation, T::iadd(h0, iy1)), gradMask);
+            Int h11 = T::iand(T::gather(permutation, T::iadd(h1, iy1)), gradMask);
+
+            Float g00x = T::gather(Grad2X, h00);
+            Float g00y = T::gather(Grad2Y, h00);
+            Float g10x = T::gather(Grad2X, h10);
+            Float g10y = T::gather(Grad2Y, h10);
+            Float g01x = T::gather(Grad2X, h01);
+            Float g01y = T::gather(Grad2Y, h01);
+            Float g11x = T::gather(Grad2X, h11);
+            Float g11y = T::gather(Grad2Y, h11);
+
+            Float v00, v10, v01, v11;
+            dot2<T>(v00, tx0, g00x, ty0, g00y);
+            dot2<T>(v10, tx1, g10x, ty0, g10y);
+            dot2<T>(v01, tx0, g01x, ty1, g01y);
+            dot2<T>(v11, tx1, g11x, ty1, g11y);
+
+            Float dtx, dty, tx, ty;
+            fadeDerivative<T>(dtx, tx0);
+            fadeDerivative<T>(dty, ty0);
+            fade<T>(tx, tx0);
+            fade<T>(ty, ty0);
+
+            Float b = T::sub(v10, v00);
+            Float c = T::sub(v01, v00);
+            Float d = T::add(T::sub(T::sub(v11, v01), v10), v00);
+
+            bilinear(value, v00, v10, v01, v11, tx, ty);
+            bilinear(dx, g00x, g10x, g01x, g11x, tx, ty);
+            bilinear(dy, g00y, g10y, g01y, g11y, tx, ty);
+            dx = T::add(dx, T::mul(T::add(b, T::mul(d, ty)), dtx));
+            dy = T::add(dy, T::mul(T::add(c, T::mul(d, tx)), dty));
+
+            Float scale = T::set(1.41421356f);
+            value = T::mul(value, scale);
+            scale = T::mul(frequency, scale);
+            dx = T::mul(dx, scale);
+            dy = T::mul(dy, scale);
+        }
+
+        static LCORE_NOISE_KERNEL void bilinear(Float& r, const Float& v00, const Float& v10, const Float& v01, const Float& v11, const Float& tx, const Float& ty)
+        {
+            Float b = T::sub(v10, v00);
+            Float c = T::sub(v01, v00);
+            Float d = T::add(T::sub(T::sub(v11, v01), v10), v00);
+            r = T::add(T::add(v00, T::mul(b, tx)), T::mul(T::add(c, T::mul(d, tx)), ty));
+        }
+    };
+
+    //---------------------------------------------------
+    template<class T>
+    struct Perlin3D
+    {
+        typedef typename T::Float Float;
+        typedef typename T::Int Int;
+
+        static LCORE_NOISE_KERNEL void evaluate(Float& value, Float& dx, Float& dy, Float& dz, const u8* permutation, const Float& px, const Float& py, const Float& pz, const Float& frequency)
+        {
+            Float one = T::set(1.0f);
+            Int ix0 = T::floor(px);
+            Int iy0 = T::floor(py);
+            Int iz0 = T::floor(pz);
+            Float tx0 = T::sub(px, T::toFloat(ix0));
+            Float ty0 = T::sub(py, T::toFloat(iy0));
+            Float tz0 = T::sub(pz, T::toFloat(iz0));
+            Float tx1 = T::sub(tx0, one);
+            Float ty1 = T::sub(ty0, one);
+            Float tz1 = T::sub(tz0, one);
+            Int mask = T::seti(Noise::PermutationTableSizeMask);
+            ix0 = T::iand(ix0, mask);
+            iy0 = T::iand(iy0, mask);
+            iz0 = T::iand(iz0, mask);
+            Int ix1 = T::iadd(ix0, T::seti(1));
+            Int iy1 = T::iadd(iy0, T::seti(1));
+            Int iz1 = T::iadd(iz0, T::seti(1));
+
+            Int h0 = T::gather(permutation, ix0);
+            Int h1 = T::gather(permutation, ix1);
+            Int h00 = T::gather(permutation, T::iadd(h0, iy0));
+            Int h10 = T::gather(permutation, T::iadd(h1, iy0));
+            Int h01 = T::gather(permutation, T::iadd(h0, iy1));
+            Int h11 = T::gather(permutation, T::iadd(h1, iy1));
+
+            Int gradMask = T::seti(Noise::NumGrad3-1);
+            Int h000 = T::iand(T::gather(permutation, T::iadd(h00, iz0)), gradMask);
+            Int h100 = T::iand(T::gather(permutation, T::iadd(h10, iz0)), gradMask);
+            Int h010 = T::iand(T::gather(permutation, T::iadd(h01, iz0)), gradMask);
+            Int h110 = T::iand(T::gather(permutation, T::iadd(h11, iz0)), gradMask);
+            Int h001 = T::iand(T::gather(permutation, T::iadd(h00, iz1)), gradMask);
+            Int h101 = T::iand(T::gather(permutation, T::iadd(h10, iz1)), gradMask);
+            Int h011 = T::iand(T::gather(permutation, T::iadd(h01, iz1)), gradMask);
+            Int h111 = T::iand(T::gather(permutation, T::iadd(h11, iz1)), gradMask);
+
+            Float g000x = T::gather(Grad3X, h000), g000y = T::gather(Grad3Y, h000), g000z = T::gather(Grad3Z, h000);
+            Float g100x = T::gather(Grad3X, h100), g100y = T::gather(Grad3Y, h100), g100z = T::gather(Grad3Z, h100);
+            Float g010x = T::gather(Grad3X, h010), g010y = T::gather(Grad3Y, h010), g010z = T::gather(Grad3Z, h010);
+            Float g110x = T::gather(Grad3X, h110), g110y = T::gather(Grad3Y, h110), g110z = T::gather(Grad3Z, h110);
+            Float g001x = T::gather(Grad3X, h001), g001y = T::gather(Grad3Y, h001), g001z = T::gather(Grad3Z, h001);
+            Float g101x = T::gather(Grad3X, h101), g101y = T::gather(Grad3Y, h101), g101z = T::gather(Grad3Z, h101);
+            Float g011x = T::gather(Grad3X, h011), g011y = T::gather(Grad3Y, h011), g011z = T::gather(Grad3Z, h011);
+            Float g111x = T::gather(Grad3X, h111), g111y = T::gather(Grad3Y, h111), g111z = T::gather(Grad3Z, h111);
+
+            Float v000, v100, v010, v110, v001, v101, v011, v111;
+            dot3<T>(v000, tx0, g000x, ty0, g000y, tz0, g000z);
+            dot3<T>(v100, tx1, g100x, ty0, g100y, tz0, g100z);
+            dot3<T>(v010, tx0, g010x, ty1, g010y, tz0, g010z);
+            dot3<T>(v110, tx1, g110x, ty1, g110y, tz0, g110z);
+            dot3<T>(v001, tx0, g001x, ty0, g001y, tz1, g001z);
+            dot3<T>(v101, tx1, g101x, ty0, g101y, tz1, g101z);
+            dot3<T>(v011, tx0, g011x, ty1, g011y, tz1, g011z);
+            dot3<T>(v111, tx1, g111x, ty1, g111y, tz1, g111z);
+
+            Float dtx, dty, dtz, tx, ty, tz;
+            fadeDerivative<T>(dtx, tx0);
+            fadeDerivative<T>(dty, ty0);
+            fadeDerivative<T>(dtz, tz0);
+            fade<T>(tx, tx0);
+            fade<T>(ty, ty0);
+            fade<T>(tz, tz0);
+
+            trilinear<T>(value, v000, v100, v010, v110, v001, v101, v011, v111, tx, ty, tz);
+            trilinear<T>(dx, g000x, g100x, g010x, g110x, g001x, g101x, g011x, g111x, tx, ty, tz);
+            trilinear<T>(dy, g000y, g100y, g010y, g110y, g001y, g101y, g011y, g111y, tx, ty, tz);
+            trilinear<T>(dz, g000z, g100z, g010z, g110z, g001z, g101z, g011z, g111z, tx, ty, tz);
+
+            Float b = T::sub(v100, v000);
+            Float c = T::sub(v010, v000);
+            Float d = T::sub(v001, v000);
+            Float e = T::add(T::sub(T::sub(v110, v010), v100), v000);
+            Float f = T::add(T::sub(T::sub(v101, v001), v100), v000);
+            Float g = T::add(T::sub(T::sub(v011, v001), v010), v000);
+            Float h = T::sub(T::add(T::add(T::sub(T::add(T::sub(T::sub(v111, v011), v101), v001), v110), v010), v100), v000);
+            dx = T::add(dx, T::mul(T::add(T::add(b, T::mul(e, ty)), T::mul(T::add(f, T::mul(h, ty)), tz)), dtx));
+            dy = T::add(dy, T::mul(T::add(T::add(c, T::mul(e, tx)), T::mul(T::add(g, T::mul(h, tx)), tz)), dty));
+            dz = T::add(dz, T::mul(T::add(T::add(d, T::mul(f, tx)), T::mul(T::add(g, T::mul(h, tx)), ty)), dtz));
+            dx = T::mul(dx, frequency);
+            dy = T::mul(dy, frequency);
+            dz = T::mul(dz, frequency);
+        }
+    };
+
+    //---------------------------------------------------
+    template<class T>
+    struct Simplex2D
+    {
+        typedef typename T::Float Float;
+        typedef typename T::Int Int;
+
+        static LCORE_NOISE_KERNEL void corner(Float& value, Float& dx, Float& dy, const u8* permutation, const Int& hx, const Int& hy, const Float& x, const Float& y)
+        {
+            Int h = T::iand(T::gather(permutation, T::iadd(T::gather(permutation, hx), hy)), T::seti(Noise::NumGrad2-1));
+            Float gx = T::gather(Grad2X, h);
+            Float gy = T::gather(Grad2Y, h);
+
+            //͈͊O̒_t=0Ŋ^ȂȂ
+            Float t = T::sub(T::sub(T::set(0.5f), T::mul(x, x)), T::mul(y, y));
+            t = T::maximum(t, T::set(0.0f));
+            Float t2 = T::mul(t, t);
+            Float t4 = T::mul(t2, t2);
+            Float gd;
+            dot2<T>(gd, gx, x, gy, y);
+            value = T::add(value, T::mul(t4, gd));
+            Float d = T::mul(T::mul(T::mul(T::set(-8.0f), t2), t), gd);
+            dx = T::add(dx, T::add(T::mul(d, x), T::mul(t4, gx)));
+            dy = T::add(dy, T::add(T::mul(d, y), T::mul(t4, gy)));
+        }
+
+        static LCORE_NOISE_KERNEL void evaluate(Float& value, Float& dx, Float& dy, const u8* permutation, const Float& px, const Float& py, const Float& frequency)
+        {
+            Float s = T::mul(T::add(px, py), T::set(Simplex2F));
+            Int i = T::floor(T::add(px, s));
+            Int j = T::floor(T::add(py, s));
+            Float t = T::mul(T::toFloat(T::iadd(i, j)), T::set(Simplex2G));
+            Float x0 = T::sub(px, T::sub(T::toFloat(i), t));
+            Float y0 = T::sub(py, T::sub(T::toFloat(j), t));
+
+            Int one = T::seti(1);
+            Int i1 = T::srli(T::toMask(T::cmpgt(x0, y0)), 31);
+            Int j1 = T::isub(one, i1);
+            Float x1 = T::add(T::sub(x0, T::toFloat(i1)), T::set(Simplex2G));
+            Float y1 = T::add(T::sub(y0, T::toFloat(j1)), T::set(Simplex2G));
+            Float x2 = T::add(T::sub(x0, T::set(1.0f)), T::set(2.0f*Simplex2G));
+            Float y2 = T::add(T::sub(y0, T::set(1.0f)), T::set(2.0f*Simplex2G));
+
+            Int mask = T::seti(Noise::PermutationTableSizeMask);
+            i = T::iand(i, mask);
+            j = T::iand(j, mask);
+
+            value = dx = dy = T::set(0.0f);
+            corner(value, dx, dy, permutation, i, j, x0, y0);
+            corner(value, dx, dy, permutation, T::iadd(i, i1), T::iadd(j, j1), x1, y1);
+            corner(value, dx, dy, permutation, T::iadd(i, one), T::iadd(j, one), x2, y2);
+
+            Float scale = T::set(Simplex2Scale);
+            value = T::mul(value, scale);
+            scale = T::mul(scale, frequency);
+            dx = T::mul(dx, scale);
+            dy = T::mul(dy, scale);
+        }
+    };
+
+    //---------------------------------------------------
+    template<class T>
+    struct Simplex3D
+    {
+        typedef typename T::Float Float;
+        typedef typename T::Int Int;
+
+        static LCORE_NOISE_KERNEL void corner(Float& value, Float& dx, Float& dy, Float& dz, const u8* permutation, const Int& hx, const Int& hy, const Int& hz, const Float& x, const Float& y, const Float& z)
+        {
+            Int h = T::gather(permutation, T::iadd(T::gather(permutation, hx), hy));
+            h = T::iand(T::gather(permutation, T::iadd(h, hz)), T::seti(Noise::NumGrad3-1));
+            Float gx = T::gather(Grad3X, h);
+            Float gy = T::gather(Grad3Y, h);
+            Float gz = T::gather(Grad3Z, h);
+
+            Float t = T::sub(T::sub(T::sub(T::set(0.5f), T::mul(x, x)), T::mul(y, y)), T::mul(z, z));
+            t = T::maximum(t, T::set(0.0f));
+            Float t2 = T::mul(t, t);
+            Float t4 = T::mul(t2, t2);
+            Float gd;
+            dot3<T>(gd, gx, x, gy, y, gz, z);
+            value = T::add(value, T::mul(t4, gd));
+            Float d = T::mul(T::mul(T::mul(T::set(-8.0f), t2), t), gd);
+            dx = T::add(dx, T::add(T::mul(d, x), T::mul(t4, gx)));
+            dy = T::add(dy, T::add(T::mul(d, y), T::mul(t4, gy)));
+            dz = T::add(dz, T::add(T::mul(d, z), T::mul(t4, gz)));
+        }
+
+        static LCORE_NOISE_KERNEL void evaluate(Float& value, Float& dx, Float& dy, Float& dz, const u8* permutation, const Float& px, const Float& py, const Float& pz, const Float& frequency)
+        {
+            Float s = T::mul(T::add(T::add(px, py), pz), T::set(Simplex3F));
+            Int i = T::floor(T::add(px, s));
+            Int j = T::floor(T::add(py, s));
+            Int k = T::floor(T::add(pz, s));
+            Float t = T::mul(T::toFloat(T::iadd(T::iadd(i, j), k)), T::set(Simplex3G));
+            Float x0 = T::sub(px, T::sub(T::toFloat(i), t));
+            Float y0 = T::sub(py, T::sub(T::toFloat(j), t));
+            Float z0 = T::sub(pz, T::sub(T::toFloat(k), t));
+
+            //P̂̒_̏Ԃ͍W̑傫̏ʂŌ܂
+            Int one = T::seti(1);
+            Int rx = T::isub(T::seti(0), T::iadd(T::toMask(T::cmpge(x0, y0)), T::toMask(T::cmpge(x0, z0))));
+            Int ry = T::isub(T::seti(0), T::iadd(T::toMask(T::cmpgt(y0, x0)), T::toMask(T::cmpge(y0, z0))));
+            Int rz = T::isub(T::seti(0), T::iadd(T::toMask(T::cmpgt(z0, x0)), T::toMask(T::cmpgt(z0, y0))));
+            Int i1 = T::srli(rx, 1);
+            Int j1 = T::srli(ry, 1);
+            Int k1 = T::srli(rz, 1);
+            Int i2 = T::srli(T::iadd(rx, one), 1);
+            Int j2 = T::srli(T::iadd(ry, one), 1);
+            Int k2 = T::srli(T::iadd(rz, one), 1);
+
+            Float g1 = T::set(Simplex3G);
+            Float g2 = T::set(2.0f*Simplex3G);
+            Float g3 = T::set(3.0f*Simplex3G);
+            Float x1 = T::add(T::sub(x0, T::toFloat(i1)), g1);
+            Float y1 = T::add(T::sub(y0, T::toFloat(j1)), g1);
+            Float z1 = T::add(T::sub(z0, T::toFloat(k1)), g1);
+            Float x2 = T::add(T::sub(x0, T::toFloat(i2)), g2);
+            Float y2 = T::add(T::sub(y0, T::toFloat(j2)), g2);
+            Float z2 = T::add(T::sub(z0, T::toFloat(k2)), g2);
+            Float x3 = T::add(T::sub(x0, T::set(1.0f)), g3);
+            Float y3 = T::add(T::sub(y0, T::set(1.0f)), g3);
+            Float z3 = T::add(T::sub(z0, T::set(1.0f)), g3);
+
+            Int mask = T::seti(Noise::PermutationTableSizeMask);
+            i = T::iand(i, mask);
+            j = T::iand(j, mask);
+            k = T::iand(k, mask);
+
+            value = dx = dy = dz = T::set(0.0f);
+            corner(value, dx, dy, dz, permutation, i, j, k, x0, y0, z0);
+            corner(value, dx, dy, dz, permutation, T::iadd(i, i1), T::iadd(j, j1), T::iadd(k, k1), x1, y1, z1);
+            corner(value, dx, dy, dz, permutation, T::iadd(i, i2), T::iadd(j, j2), T::iadd(k, k2), x2, y2, z2);
+            corner(value, dx, dy, dz, permutation, T::iadd(i, one), T::iadd(j, one), T::iadd(k, one), x3, y3, z3);
+
+            Float scale = T::set(Simplex3Scale);
+            value = T::mul(value, scale);
+            scale = T::mul(scale, frequency);
+            dx = T::mul(dx, scale);
+            dy = T::mul(dy, scale);
+            dz = T::mul(dz, scale);
+        }
+    };
+
+    //---------------------------------------------------
+    /// [0Ŗ߂ēJ[lŌvZ
+    template<class T, class Kernel>
+    LCORE_NOISE_KERNEL void batch2D(s32 count, NoiseSample2* samples, const f32* px, const f32* py, f32 frequency, const u8* permutation)
+    {
+        typedef typename T::Float Float;
+        Float f = T::set(frequency);
+        f32 value[T::Width];
+        f32 dx[T::Width];
+        f32 dy[T::Width];
+        f32 x[T::Width];
+        f32 y[T::Width];
+        for(s32 i=0; i<count; i+=T::Width){
+            s32 n = minimum(count-i, T::Width);
+            Float vx, vy;
+            if(n<T::Width){
+                for(s32 j=0; j<T::Width; ++j){
+                    x[j] = (j<n)? px[i+j] : 0.0f;
+                    y[j] = (j<n)? py[i+j] : 0.0f;
+                }
+                vx = T::load(x);
+                vy = T::load(y);
+            }else{
+                vx = T::load(px+i);
+                vy = T::load(py+i);
+            }
+            Float rv, rdx, rdy;
+            Kernel::evaluate(rv, rdx, rdy, permutation, T::mul(vx, f), T::mul(vy, f), f);
+            T::store(value, rv);
+            T::store(dx, rdx);
+            T::store(dy, rdy);
+            for(s32 j=0; j<n; ++j){
+                samples[i+j] = NoiseSample2(value[j], dx[j], dy[j]);
+            }
+        }
+    }
+
+    template<class T, class Kernel>
+    LCORE_NOISE_KERNEL void batch3D(s32 count, NoiseSample3* samples, const f32* px, const f32* py, const f32* pz, f32 frequency, const u8* permutation)
+    {
+        typedef typename T::Float Float;
+        Float f = T::set(frequency);
+        f32 value[T::Width];
+        f32 dx[T::Width];
+        f32 dy[T::Width];
+        f32 dz[T::Width];
+        f32 x[T::Width];
+        f32 y[T::Width];
+        f32 z[T::Width];
+        for(s32 i=0; i<count; i+=T::Width){
+            s32 n = minimum(count-i, T::Width);
+            Float vx, vy, vz;
+            if(n<T::Width){
+                for(s32 j=0; j<T::Width; ++j){
+                    x[j] = (j<n)? px[i+j] : 0.0f;
+                    y[j] = (j<n)? py[i+j] : 0.0f;
+                    z[j] = (j<n)? pz[i+j] : 0.0f;
+                }
+                vx = T::load(x);
+                vy = T::load(y);
+                vz = T::load(z);
+            }else{
+                vx = T::load(px+i);
+                vy = T::load(py+i);
+                vz = T::load(pz+i);
+            }
+            Float rv, rdx, rdy, rdz;
+            Kernel::evaluate(rv, rdx, rdy, rdz, permutation, T::mul(vx, f), T::mul(vy, f), T::mul(vz, f), f);
+            T::store(value, rv);
+            T::store(dx, rdx);
+            T::store(dy, rdy);
+            T::store(dz, rdz);
+            for(s32 j=0; j<n; ++j){
+                samples[i+j] = NoiseSample3(value[j], dx[j], dy[j], dz[j]);
+            }
+        }
+    }
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#if defined(LCORE_NOISE_AVX2)
+    //---------------------------------------------------
+    /// AVX2̓. useAVX2()truêƂĂ
+    template<class Kernel>
+    LCORE_TARGET("avx2") void batch2DAVX2(s32 count, NoiseSample2* samples, const f32* px, const f32* py, f32 frequency, const u8* permutation)
+    {
+        batch2D<AVX2, Kernel>(count, samples, px, py, frequency, permutation);
+    }
+
+    template<class Kernel>
+    LCORE_TARGET("avx2") void batch3DAVX2(s32 count, NoiseSample3* samples, const f32* px, const f32* py, const f32* pz, f32 frequency, const u8* permutation)
+    {
+        batch3D<AVX2, Kernel>(count, samples, px, py, pz, frequency, permutation);
+    }
+#endif
+
+    //---------------------------------------------------
+    //---
+    //--- Grid
+    //---
+    //---------------------------------------------------
+    struct GridJob
+    {
+        const Noise* noise_;
+        Noise::Batch2D batch2D_;
+        Noise::Batch3D batch3D_;
+        NoiseSample2* samples2_;
+        NoiseSample3* samples3_;
+        s32 width_;
+        s32 height_;
+        s32 numRows_; ///< 3depth*height
+        f32 x0_;
+        f32 y0_;
+        f32 z0_;
+        f32 step_;
+        s32 octave_;
+        f32 frequency_;
+        f32 lacunarity_;
+        f32 persistence_;
+    };
+
+    void generateRow(const GridJob& job, s32 row)
+    {
+        f32 px[BatchSize];
+        f32 py[BatchSize];
+        f32 pz[BatchSize];
+        s32 y = row%job.height_;
+        s32 z = row/job.height_;
+        f32 fy = job.y0_ + job.step_*y;
+        f32 fz = job.z0_ + job.step_*z;
+        for(s32 i=0; i<BatchSize; ++i){
+            py[i] = fy;
+            pz[i] = fz;
+        }
+        for(s32 x=0; x<job.width_; x+=BatchSize){
+            s32 n = minimum(job.width_-x, BatchSize);
+            for(s32 i=0; i<n; ++i){
+                px[i] = job.x0_ + job.step_*(x+i);
+            }
+            if(NULL != job.batch2D_){
+                job.noise_->fbm(job.batch2D_, n, job.samples2_ + row*job.width_ + x, px, py, job.octave_, job.frequency_, job.lacunarity_, job.persistence_);
+            }else{
+                job.noise_->fbm(job.batch3D_, n, job.samples3_ + row*job.width_ + x, px, py, pz, job.octave_, job.frequency_, job.lacunarity_, job.persistence_);
+            }
+        }
+    }
+
+    void gridProc(void* data, u32 row)
+    {
+        generateRow(*reinterpret_cast<const GridJob*>(data), static_cast<s32>(row));
+    }
+
+    void generateGrid(GridJob& job, ThreadPool* threadPool)
+    {
+        LASSERT(NULL != job.batch2D_ || NULL != job.batch3D_);
+        LASSERT(0<=job.width_ && 0<=job.numRows_);
+        LASSERT(NULL != job.samples2_ || NULL != job.samples3_ || 0 == job.width_*job.numRows_);
+        parallelFor(threadPool, gridProc, &job, static_cast<u32>(job.numRows_));
+    }
 }
 
 
@@ -432,6 +1132,9 @@ namespace
         for(s32 i=size; i<PermutationTableSize; ++i){
             permutation_[i] = permutation_[i - size];
         }
+        for(s32 i=PermutationTableSize; i<(PermutationTableSize+PermutationTablePadding); ++i){
+            permutation_[i] = 0;
+        }
     }
 
     NoiseSample2 Noise::fbm(Func2D func2D, f32 px, f32 py, s32 octave, f32 frequency, f32 lacunarity, f32 persistence) const
@@ -468,6 +1171,87 @@ namespace
         return total * (1.0f/scale);
     }
 
+    void Noise::fbm(Batch2D batch2D, s32 count, NoiseSample2* samples, const f32* px, const f32* py, s32 octave, f32 frequency, f32 lacunarity, f32 persistence) const
+    {
+        NoiseSample2 octaveSamples[BatchSize];
+        //IN^[u܂Ƃ߂Đi߂āA_̍WLbVɒu܂܂ɂ
+        for(s32 i=0; i<count; i+=BatchSize){
+            s32 n = minimum(count-i, BatchSize);
+            NoiseSample2* total = samples + i;
+            (this->*batch2D)(n, total, px+i, py+i, frequency);
+            f32 f = frequency;
+            f32 scale = 1.0f;
+            f32 amplitude = 1.0f;
+
+            for(s32 j=1; j<octave; ++j){
+                f *= lacunarity;
+                amplitude *= persistence;
+                scale += amplitude;
+                (this->*batch2D)(n, octaveSamples, px+i, py+i, f);
+                for(s32 k=0; k<n; ++k){
+                    total[k].add(amplitude, octaveSamples[k]);
+                }
+            }
+
+            f32 invScale = 1.0f/scale;
+            for(s32 k=0; k<n; ++k){
+                total[k] = total[k] * invScale;
+            }
+        }
+    }
+
+    void Noise::fbm(Batch3D batch3D, s32 count, NoiseSample3* samples, const f32* px, const f32* py, const f32* pz, s32 octave, f32 frequency, f32 lacunarity, f32 persistence) const
+    {
+        NoiseSample3 octaveSamples[BatchSize];
+        for(s32 i=0; i<count; i+=BatchSize){
+            s32 n = minimum(count-i, BatchSize);
+            NoiseSample3* total = samples + i;
+            (this->*batch3D)(n, total, px+i, py+i, pz+i, frequency);
+            f32 f = frequency;
+            f32 scale = 1.0f;
+            f32 amplitude = 1.0f;
+
+            for(s32 j=1; j<octave; ++j){
+                f *= lacunarity;
+                amplitude *= persistence;
+                scale += amplitude;
+                (this->*batch3D)(n, octaveSamples, px+i, py+i, pz+i, f);
+                for(s32 k=0; k<n; ++k){
+                    total[k].add(amplitude, octaveSamples[k]);
+                }
+            }
+
+            f32 invScale = 1.0f/scale;
+            for(s32 k=0; k<n; ++k){
+                total[k] = total[k] * invScale;
+            }
+        }
+    }
+
+    void Noise::grid2D(Batch2D batch2D, NoiseSample2* samples, s32 width, s32 height, f32 x0, f32 y0, f32 step, s32 octave, f32 frequency, f32 lacunarity, f32 persistence) const
+    {
+        GridJob job = {this, batch2D, NULL, samples, NULL, width, height, height, x0, y0, 0.0f, step, octave, frequency, lacunarity, persistence};
+        generateGrid(job, NULL);
+    }
+
+    void Noise::grid3D(Batch3D batch3D, NoiseSample3* samples, s32 width, s32 height, s32 depth, f32 x0, f32 y0, f32 z0, f32 step, s32 octave, f32 frequency, f32 lacunarity, f32 persistence) const
+    {
+        GridJob job = {this, NULL, batch3D, NULL, samples, width, height, height*depth, x0, y0, z0, step, octave, frequency, lacunarity, persistence};
+        generateGrid(job, NULL);
+    }
+
+    void Noise::grid2D(ThreadPool& threadPool, Batch2D batch2D, NoiseSample2* samples, s32 width, s32 height, f32 x0, f32 y0, f32 step, s32 octave, f32 frequency, f32 lacunarity, f32 persistence) const
+    {
+        GridJob job = {this, batch2D, NULL, samples, NULL, width, height, height, x0, y0, 0.0f, step, octave, frequency, lacunarity, persistence};
+        generateGrid(job, &threadPool);
+    }
+
+    void Noise::grid3D(ThreadPool& threadPool, Batch3D batch3D, NoiseSample3* samples, s32 width, s32 height, s32 depth, f32 x0, f32 y0, f32 z0, f32 step, s32 octave, f32 frequency, f32 lacunarity, f32 persistence) const
+    {
+        GridJob job = {this, NULL, batch3D, NULL, samples, width, height, height*depth, x0, y0, z0, step, octave, frequency, lacunarity, persistence};
+        generateGrid(job, &threadPool);
+    }
+
     NoiseSample1 Noise::value1D(f32 px, f32 frequency) const
     {
         px += frequency;
@@ -760,7 +1544,7 @@ namespace
         sample.value_ = a + b * tx + (c + e * tx) * ty + (d + f * tx + (g + h * tx) * ty) * tz;
         sample.dx_ = da.x_ + db.x_ * tx + (dc.x_ + de.x_ * tx) * ty + (dd.x_ + df.x_ * tx + (dg.x_ + dh.x_ * tx) * ty) * tz;
         sample.dy_ = da.y_ + db.y_ * tx + (dc.y_ + de.y_ * tx) * ty + (dd.y_ + df.y_ * tx + (dg.y_ + dh.y_ * tx) * ty) * tz;
-        sample.dz_ = da.z_ + db.z_ * tx + (dc.z_ + de.z_ * tx) * ty + (dd.z_ + df.z_ * tx + (dg.z_ + dh.x_ * tx) * ty) * tz;
+        sample.dz_ = da.z_ + db.z_ * tx + (dc.z_ + de.z_ * tx) * ty + (dd.z_ + df.z_ * tx + (dg.z_ + dh.z_ * tx) * ty) * tz;
 
         sample.dx_ += (b + e * ty + (f + h * ty) * tz) * dtx;
         sample.dy_ += (c + e * tx + (g + h * tx) * tz) * dty;
@@ -771,6 +1555,147 @@ namespace
         return sample;
     }
 
+    NoiseSample2 Noise::simplex2D(f32 px, f32 py, f32 frequency) const
+    {
+        px *= frequency;
+        py *= frequency;
+        f32 s = (px+py)*Simplex2F;
+        s32 i = fastFloor(px+s);
+        s32 j = fastFloor(py+s);
+        f32 t = (i+j)*Simplex2G;
+        f32 x0 = px - (i-t);
+        f32 y0 = py - (j-t);
+
+        s32 i1 = (y0<x0)? 1 : 0;
+        s32 j1 = 1-i1;
+        f32 x1 = x0 - i1 + Simplex2G;
+        f32 y1 = y0 - j1 + Simplex2G;
+        f32 x2 = x0 - 1.0f + 2.0f*Simplex2G;
+        f32 y2 = y0 - 1.0f + 2.0f*Simplex2G;
+
+        i &= PermutationTableSizeMask;
+        j &= PermutationTableSizeMask;
+        s32 h0 = permutation_[permutation_[i]+j] & 0x07;
+        s32 h1 = permutation_[permutation_[i+i1]+j+j1] & 0x07;
+        s32 h2 = permutation_[permutation_[i+1]+j+1] & 0x07;
+
+        NoiseSample2 sample(0.0f, 0.0f, 0.0f);
+        simplexCorner(sample, grad2_[h0], x0, y0);
+        simplexCorner(sample, grad2_[h1], x1, y1);
+        simplexCorner(sample, grad2_[h2], x2, y2);
+        sample.value_ *= Simplex2Scale;
+        sample.dx_ *= Simplex2Scale*frequency;
+        sample.dy_ *= Simplex2Scale*frequency;
+        return sample;
+    }
+
+    NoiseSample3 Noise::simplex3D(f32 px, f32 py, f32 pz, f32 frequency) const
+    {
+        px *= frequency;
+        py *= frequency;
+        pz *= frequency;
+        f32 s = (px+py+pz)*Simplex3F;
+        s32 i = fastFloor(px+s);
+        s32 j = fastFloor(py+s);
+        s32 k = fastFloor(pz+s);
+        f32 t = (i+j+k)*Simplex3G;
+        f32 x0 = px - (i-t);
+        f32 y0 = py - (j-t);
+        f32 z0 = pz - (k-t);
+
+        //P̂̒_̏Ԃ͍W̑傫̏ʂŌ܂
+        s32 rx = (y0<=x0) + (z0<=x0);
+        s32 ry = (x0<y0) + (z0<=y0);
+        s32 rz = (x0<z0) + (y0<z0);
+        s32 i1 = rx>>1;
+        s32 j1 = ry>>1;
+        s32 k1 = rz>>1;
+        s32 i2 = (rx+1)>>1;
+        s32 j2 = (ry+1)>>1;
+        s32 k2 = (rz+1)>>1;
+
+        f32 x1 = x0 - i1 + Simplex3G;
+        f32 y1 = y0 - j1 + Simplex3G;
+        f32 z1 = z0 - k1 + Simplex3G;
+        f32 x2 = x0 - i2 + 2.0f*Simplex3G;
+        f32 y2 = y0 - j2 + 2.0f*Simplex3G;
+        f32 z2 = z0 - k2 + 2.0f*Simplex3G;
+        f32 x3 = x0 - 1.0f + 3.0f*Simplex3G;
+        f32 y3 = y0 - 1.0f + 3.0f*Simplex3G;
+        f32 z3 = z0 - 1.0f + 3.0f*Simplex3G;
+
+        i &= PermutationTableSizeMask;
+        j &= PermutationTableSizeMask;
+        k &= PermutationTableSizeMask;
+        s32 h0 = permutation_[permutation_[permutation_[i]+j]+k] & 0x0F;
+        s32 h1 = permutation_[permutation_[permutation_[i+i1]+j+j1]+k+k1] & 0x0F;
+        s32 h2 = permutation_[permutation_[permutation_[i+i2]+j+j2]+k+k2] & 0x0F;
+        s32 h3 = permutation_[permutation_[permutation_[i+1]+j+1]+k+1] & 0x0F;
+
+        NoiseSample3 sample(0.0f, 0.0f, 0.0f, 0.0f);
+        simplexCorner(sample, grad3(grad3_, h0), x0, y0, z0);
+        simplexCorner(sample, grad3(grad3_, h1), x1, y1, z1);
+        simplexCorner(sample, grad3(grad3_, h2), x2, y2, z2);
+        simplexCorner(sample, grad3(grad3_, h3), x3, y3, z3);
+        sample.value_ *= Simplex3Scale;
+        sample.dx_ *= Simplex3Scale*frequency;
+        sample.dy_ *= Simplex3Scale*frequency;
+        sample.dz_ *= Simplex3Scale*frequency;
+        return sample;
+    }
+
+    void Noise::perlin2D(s32 count, NoiseSample2* samples, const f32* px, const f32* py, f32 frequency) const
+    {
+        LASSERT(0<=count);
+        LASSERT(0 == count || (NULL != samples && NULL != px && NULL != py));
+#if defined(LCORE_NOISE_AVX2)
+        if(useAVX2()){
+            batch2DAVX2<Perlin2D<AVX2> >(count, samples, px, py, frequency, permutation_);
+            return;
+        }
+#endif
+        batch2D<SSE2, Perlin2D<SSE2> >(count, samples, px, py, frequency, permutation_);
+    }
+
+    void Noise::perlin3D(s32 count, NoiseSample3* samples, const f32* px, const f32* py, const f32* pz, f32 frequency) const
+    {
+        LASSERT(0<=count);
+        LASSERT(0 == count || (NULL != samples && NULL != px && NULL != py && NULL != pz));
+#if defined(LCORE_NOISE_AVX2)
+        if(useAVX2()){
+            batch3DAVX2<Perlin3D<AVX2> >(count, samples, px, py, pz, frequency, permutation_);
+            return;
+        }
+#endif
+        batch3D<SSE2, Perlin3D<SSE2> >(count, samples, px, py, pz, frequency, permutation_);
+    }
+
+    void Noise::simplex2D(s32 count, NoiseSample2* samples, const f32* px, const f32* py, f32 frequency) const
+    {
+        LASSERT(0<=count);
+        LASSERT(0 == count || (NULL != samples && NULL != px && NULL != py));
+#if defined(LCORE_NOISE_AVX2)
+        if(useAVX2()){
+            batch2DAVX2<Simplex2D<AVX2> >(count, samples, px, py, frequency, permutation_);
+            return;
+        }
+#endif
+        batch2D<SSE2, Simplex2D<SSE2> >(count, samples, px, py, frequency, permutation_);
+    }
+
+    void Noise::simplex3D(s32 count, NoiseSample3* samples, const f32* px, const f32* py, const f32* pz, f32 frequency) const
+    {
+        LASSERT(0<=count);
+        LASSERT(0 == count || (NULL != samples && NULL != px && NULL != py && NULL != pz));
+#if defined(LCORE_NOISE_AVX2)
+        if(useAVX2()){
+            batch3DAVX2<Simplex3D<AVX2> >(count, samples, px, py, pz, frequency, permutation_);
+            return;
+        }
+#endif
+        batch3D<SSE2, Simplex3D<SSE2> >(count, samples, px, py, pz, frequency, permutation_);
+    }
+
 
     const Noise::Vector2 Noise::grad2_[Noise::NumGrad2] =
     {
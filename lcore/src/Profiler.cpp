@@ -0,0 +1,308 @@
+﻿/**
+@file Profiler.cpp
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "Profiler.h"
+#include "File.h"
+#include <cstdarg>
+#include <cstdio>
+
+#if defined(_MSC_VER)
+#define LCORE_PROFILER_THREAD __declspec(thread)
+#else
+#define LCORE_PROFILER_THREAD __thread
+#endif
+
+namespace lcore
+{
+namespace
+{
+    LCORE_PROFILER_THREAD ProfileThreadBuffer* threadBuffer_ = NULL;
+    LCORE_PROFILER_THREAD s32 threadGeneration_ = 0;
+    s32 nextGeneration_ = 0;
+
+    //---------------------------------------------------------------
+    /**
+    @brief 書き出し用のバッファ付きライタ
+    */
+    class TraceWriter
+    {
+    public:
+        static const s32 BufferSize = 4096;
+        static const s32 MaxPrintSize = 256;
+
+        explicit TraceWriter(File& file)
+            :file_(file)
+            ,size_(0)
+            ,error_(false)
+        {}
+
+        void print(const Char* format, ...)
+        {
+            if(BufferSize<(size_+MaxPrintSize)){
+                flush();
+            }
+            va_list args;
+            va_start(args, format);
+            s32 count = ::vsnprintf(buffer_+size_, MaxPrintSize, format, args);
+            va_end(args);
+            if(0<count){
+                size_ += minimum(count, MaxPrintSize-1);
+            }
+        }
+
+        /// JSONの文字列としてエスケープして書く
+        void string(const Char* str)
+        {
+            for(const Char* c=str; CharNull != *c; ++c){
+                if(BufferSize<(size_+8)){
+                    flush();
+                }
+                u8 x = static_cast<u8>(*c);
+                if('"' == x || '\\' == x){
+                    buffer_[size_++] = '\\';
+                    buffer_[size_++] = *c;
+                }else if(x<0x20){
+                    size_ += ::snprintf(buffer_+size_, 8, "\\u%04x", x);
+                }else{
+                    buffer_[size_++] = *c;
+                }
+            }
+        }
+
+        bool flush()
+        {
+            if(0<size_ && !file_.write(size_, buffer_)){
+                error_ = true;
+            }
+            size_ = 0;
+            return !error_;
+        }
+    private:
+        File& file_;
+        s32 size_;
+        bool error_;
+        Char buffer_[BufferSize];
+    };
+}
+
+    s32 Profiler::eventsPerThread_ = 0;
+    volatile s32 Profiler::generation_ = 0;
+    volatile s32 Profiler::numThreads_ = 0;
+    ProfileThreadBuffer* volatile Profiler::threads_[MaxThreads] = {};
+    u64 Profiler::frame_ = 0;
+    u64 Profiler::startTime_ = 0;
+
+    bool Profiler::initialize(s32 eventsPerThread)
+    {
+        LASSERT(0<eventsPerThread);
+        terminate();
+        if(0 == Timestamp::getFrequency()){
+            Timestamp::initialize();
+        }
+        eventsPerThread_ = static_cast<s32>(roundUpPow2(static_cast<u32>(eventsPerThread)));
+        numThreads_ = 0;
+        frame_ = 0;
+        startTime_ = Timestamp::now();
+        //0は未初期化
+        if(++nextGeneration_ <= 0){
+            nextGeneration_ = 1;
+        }
+        atomicStore(generation_, nextGeneration_);
+        return true;
+    }
+
+    void Profiler::terminate()
+    {
+        atomicStore(generation_, 0);
+        s32 numThreads = minimum(static_cast<s32>(numThreads_), MaxThreads);
+        for(s32 i=0; i<numThreads; ++i){
+            ProfileThreadBuffer* buffer = threads_[i];
+            if(NULL == buffer){
+                continue;
+            }
+            LFREE(buffer->events_);
+            LDELETE(buffer);
+            threads_[i] = NULL;
+        }
+        numThreads_ = 0;
+    }
+
+    bool Profiler::isInitialized()
+    {
+        return 0 != atomicLoad(generation_);
+    }
+
+    ProfileThreadBuffer* Profiler::getThreadBuffer()
+    {
+        s32 generation = generation_;
+        if(threadGeneration_ == generation){
+            return threadBuffer_;
+        }
+        threadGeneration_ = generation;
+        threadBuffer_ = NULL;
+        if(0 == generation){
+            return NULL;
+        }
+
+        s32 index = atomicIncrement(numThreads_)-1;
+        if(MaxThreads<=index){
+            return NULL;
+        }
+        ProfileThreadBuffer* buffer = LNEW ProfileThreadBuffer;
+        buffer->events_ = reinterpret_cast<ProfileEvent*>(LMALLOC(sizeof(ProfileEvent)*eventsPerThread_));
+        buffer->capacity_ = static_cast<u32>(eventsPerThread_);
+        buffer->id_ = static_cast<u32>(index+1);
+        buffer->head_ = 0;
+        buffer->depth_ = 0;
+        lcore::snprintf(buffer->name_, ProfileThreadBuffer::NameSize, "Thread %d", index);
+        atomicFence();
+        threads_[index] = buffer;
+        threadBuffer_ = buffer;
+        return buffer;
+    }
+
+    void Profiler::setThreadName(const Char* name)
+    {
+        LASSERT(NULL != name);
+        ProfileThreadBuffer* buffer = getThreadBuffer();
+        if(NULL == buffer){
+            return;
+        }
+        s32 i=0;
+        for(; i<(ProfileThreadBuffer::NameSize-1) && CharNull != name[i]; ++i){
+            buffer->name_[i] = name[i];
+        }
+        buffer->name_[i] = CharNull;
+    }
+
+    void Profiler::frame()
+    {
+        ProfileThreadBuffer* buffer = getThreadBuffer();
+        if(NULL != buffer){
+            buffer->frame(++frame_);
+        }
+    }
+
+    void Profiler::counter(const Char* name, f64 value)
+    {
+        ProfileThreadBuffer* buffer = getThreadBuffer();
+        if(NULL != buffer){
+            buffer->counter(name, value);
+        }
+    }
+
+    s32 Profiler::getNumThreads()
+    {
+        return minimum(atomicLoad(numThreads_), MaxThreads);
+    }
+
+    ProfileThreadBuffer* Profiler::getThread(s32 index)
+    {
+        LASSERT(0<=index && index<MaxThreads);
+        return threads_[index];
+    }
+
+    s32 Profiler::getEventsPerThread()
+    {
+        return eventsPerThread_;
+    }
+
+    s32 Profiler::snapshot(s32 index, ProfileEvent* events)
+    {
+        LASSERT(NULL != events);
+        ProfileThreadBuffer* buffer = getThread(index);
+        if(NULL == buffer){
+            return 0;
+        }
+        u32 capacity = buffer->capacity_;
+        u32 mask = capacity-1;
+        u32 head = static_cast<u32>(atomicLoad(buffer->head_));
+        u32 count = minimum(head, capacity);
+        u32 first = head-count;
+        for(u32 i=0; i<count; ++i){
+            events[i] = buffer->events_[(first+i) & mask];
+        }
+        atomicFence();
+
+        //Slots which the writer reached while copying are not reliable, including the one being written
+        u32 current = static_cast<u32>(atomicLoad(buffer->head_));
+        s32 overwritten = static_cast<s32>(current + 1 - capacity - first);
+        if(overwritten<=0){
+            return static_cast<s32>(count);
+        }
+        if(static_cast<s32>(count)<=overwritten){
+            return 0;
+        }
+        count -= overwritten;
+        lcore::memmove(events, events+overwritten, sizeof(ProfileEvent)*count);
+        return static_cast<s32>(count);
+    }
+
+    s32 Profiler::exportChromeTrace(File& file)
+    {
+        if(!file.is_open() || eventsPerThread_<=0){
+            return -1;
+        }
+        ProfileEvent* events = reinterpret_cast<ProfileEvent*>(LMALLOC(sizeof(ProfileEvent)*eventsPerThread_));
+        TraceWriter writer(file);
+        writer.print("{\"traceEvents\":[\n");
+
+        s32 total = 0;
+        const Char* separator = "";
+        s32 numThreads = getNumThreads();
+        for(s32 i=0; i<numThreads; ++i){
+            ProfileThreadBuffer* buffer = getThread(i);
+            if(NULL == buffer){
+                continue;
+            }
+            u32 tid = buffer->getID();
+            writer.print("%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"", separator, tid);
+            writer.string(buffer->getName());
+            writer.print("\"}}");
+            separator = ",\n";
+
+            s32 count = snapshot(i, events);
+            for(s32 j=0; j<count; ++j){
+                const ProfileEvent& event = events[j];
+                f64 ts = static_cast<f64>(Timestamp::toNanoSeconds(event.begin_-startTime_))*1.0e-3;
+                writer.print(",\n{\"name\":\"");
+                writer.string(event.name_);
+                switch(event.type_)
+                {
+                case ProfileEvent::Type_Zone:
+                    writer.print("\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"depth\":%u}}",
+                        tid, ts, static_cast<f64>(Timestamp::toNanoSeconds(event.end_-event.begin_))*1.0e-3, event.depth_);
+                    break;
+                case ProfileEvent::Type_Counter:
+                    writer.print("\",\"ph\":\"C\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"args\":{\"value\":%.17g}}", tid, ts, event.value_);
+                    break;
+                case ProfileEvent::Type_Frame:
+                    writer.print("\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"args\":{\"frame\":%llu}}", tid, ts, static_cast<unsigned long long>(event.frame_));
+                    break;
+                default:
+                    writer.print("\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%u,\"ts\":%.3f}", tid, ts);
+                    break;
+                }
+            }
+            total += count;
+        }
+        writer.print("\n],\"displayTimeUnit\":\"ns\"}\n");
+        bool result = writer.flush();
+        LFREE(events);
+        return (result)? total : -1;
+    }
+
+    s32 Profiler::exportChromeTrace(const Char* filepath)
+    {
+        LASSERT(NULL != filepath);
+        File file;
+        if(!file.open(filepath, ios::out)){
+            return -1;
+        }
+        s32 result = exportChromeTrace(file);
+        file.close();
+        return result;
+    }
+}
@@ -4,6 +4,7 @@
 @date 2011/09/04
 */
 #include "Random.h"
+#include "CPU.h"
 
 #ifdef _WIN32
 
@@ -333,6 +334,33 @@ LCORE_RANDOM_XORSHIFT_PROC
         lcore::swap(flag_, rhs.flag_);
     }
 
+namespace
+{
+    /// xorshift128+の2^64回分のジャンプ多項式（下位から）
+    static const u64 Xorshift128PlusJump[2] = {0x8a5cd789635d2dffULL, 0x121fd2155c472f96ULL};
+
+    void jumpXorshift128Plus(u64& state0, u64& state1)
+    {
+        u64 t0 = 0;
+        u64 t1 = 0;
+        for(s32 i=0; i<2; ++i){
+            for(s32 j=0; j<64; ++j){
+                if(Xorshift128PlusJump[i] & (1ULL<<j)){
+                    t0 ^= state0;
+                    t1 ^= state1;
+                }
+                u64 s1 = state0;
+                const u64 s0 = state1;
+                state0 = s0;
+                s1 ^= s1<<23;
+                state1 = s1^s0^(s1>>18)^(s0>>5);
+            }
+        }
+        state0 = t0;
+        state1 = t1;
+    }
+}
+
     //---------------------------------------------
     //---
     //--- RandXorshift128Plus
@@ -382,6 +410,11 @@ LCORE_RANDOM_XORSHIFT128PLUS_PROC
         return (*(f64*)&t)- 0.9999999999999998;
     }
 
+    void RandXorshift128Plus::jump()
+    {
+        jumpXorshift128Plus(s0_, s1_);
+    }
+
     void RandXorshift128Plus::swap(RandXorshift128Plus& rhs)
     {
         lcore::swap(s0_, rhs.s0_);
@@ -462,6 +495,13 @@ LCORE_RANDOM_XORSHIFT128PLUS_PROC
         return rand()*(1.0/4294967295.0); 
     }
 
+    void RandXorshift128Plus32::jump()
+    {
+        jumpXorshift128Plus(s0_, s1_);
+        //Drop the buffered half
+        flag_ = 1;
+    }
+
     void RandXorshift128Plus32::swap(RandXorshift128Plus32& rhs)
     {
         lcore::swap(s0_, rhs.s0_);
@@ -470,6 +510,351 @@ LCORE_RANDOM_XORSHIFT128PLUS_PROC
         lcore::swap(flag_, rhs.flag_);
     }
 
+    //---------------------------------------------
+    //---
+    //--- RandXorshift128Plus32x8
+    //---
+    //---------------------------------------------
+namespace
+{
+    static const s32 Lanes = RandXorshift128Plus32x8::Lanes;
+
+    /// スカラ版。SIMD版と同じ値を返す
+    struct TransformBits
+    {
+        inline void operator()(u32* values, u32 x) const
+        {
+            *values = x;
+        }
+
+#if defined(LCORE_CPU_X86)
+        inline void operator()(u32* values, __m128i x) const
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(values), x);
+        }
+
+        LCORE_TARGET("avx2") inline void operator()(u32* values, __m256i x) const
+        {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(values), x);
+        }
+#endif
+    };
+
+    /// 上位24bitを[0, 1)に
+    struct TransformFloat
+    {
+        inline void operator()(f32* values, u32 x) const
+        {
+            *values = static_cast<f32>(static_cast<s32>(x>>8)) * (1.0f/16777216.0f);
+        }
+
+#if defined(LCORE_CPU_X86)
+        inline void operator()(f32* values, __m128i x) const
+        {
+            __m128 f = _mm_cvtepi32_ps(_mm_srli_epi32(x, 8));
+            _mm_storeu_ps(values, _mm_mul_ps(f, _mm_set1_ps(1.0f/16777216.0f)));
+        }
+
+        LCORE_TARGET("avx2") inline void operator()(f32* values, __m256i x) const
+        {
+            __m256 f = _mm256_cvtepi32_ps(_mm256_srli_epi32(x, 8));
+            _mm256_storeu_ps(values, _mm256_mul_ps(f, _mm256_set1_ps(1.0f/16777216.0f)));
+        }
+#endif
+    };
+
+    /// (x*range)>>32 + vmin
+    struct TransformRangeU32
+    {
+        u32 vmin_;
+        u32 range_;
+
+        inline void operator()(u32* values, u32 x) const
+        {
+            *values = static_cast<u32>((static_cast<u64>(x)*range_)>>32) + vmin_;
+        }
+
+#if defined(LCORE_CPU_X86)
+        inline void operator()(u32* values, __m128i x) const
+        {
+            const __m128i range = _mm_set1_epi32(static_cast<s32>(range_));
+            __m128i even = _mm_srli_epi64(_mm_mul_epu32(x, range), 32);
+            __m128i odd = _mm_mul_epu32(_mm_srli_epi64(x, 32), range);
+            odd = _mm_and_si128(odd, _mm_set_epi32(-1, 0, -1, 0));
+            __m128i r = _mm_add_epi32(_mm_or_si128(even, odd), _mm_set1_epi32(static_cast<s32>(vmin_)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(values), r);
+        }
+
+        LCORE_TARGET("avx2") inline void operator()(u32* values, __m256i x) const
+        {
+            const __m256i range = _mm256_set1_epi32(static_cast<s32>(range_));
+            __m256i even = _mm256_srli_epi64(_mm256_mul_epu32(x, range), 32);
+            __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(x, 32), range);
+            odd = _mm256_and_si256(odd, _mm256_set_epi32(-1, 0, -1, 0, -1, 0, -1, 0));
+            __m256i r = _mm256_add_epi32(_mm256_or_si256(even, odd), _mm256_set1_epi32(static_cast<s32>(vmin_)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(values), r);
+        }
+#endif
+    };
+
+    /// vmin + scale*[0, 1)
+    struct TransformRangeF32
+    {
+        f32 vmin_;
+        f32 scale_;
+
+        inline void operator()(f32* values, u32 x) const
+        {
+            f32 f = static_cast<f32>(static_cast<s32>(x>>8)) * (1.0f/16777216.0f);
+            *values = vmin_ + scale_*f;
+        }
+
+#if defined(LCORE_CPU_X86)
+        inline void operator()(f32* values, __m128i x) const
+        {
+            __m128 f = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(x, 8)), _mm_set1_ps(1.0f/16777216.0f));
+            _mm_storeu_ps(values, _mm_add_ps(_mm_set1_ps(vmin_), _mm_mul_ps(_mm_set1_ps(scale_), f)));
+        }
+
+        LCORE_TARGET("avx2") inline void operator()(f32* values, __m256i x) const
+        {
+            __m256 f = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(x, 8)), _mm256_set1_ps(1.0f/16777216.0f));
+            _mm256_storeu_ps(values, _mm256_add_ps(_mm256_set1_ps(vmin_), _mm256_mul_ps(_mm256_set1_ps(scale_), f)));
+        }
+#endif
+    };
+
+    template<class T, class Transform>
+    void generateScalar(u64* state0, u64* state1, s32 steps, T* values, const Transform& transform)
+    {
+        for(s32 i=0; i<steps; ++i){
+            for(s32 j=0; j<Lanes; ++j){
+                u64 s1 = state0[j];
+                const u64 s0 = state1[j];
+                state0[j] = s0;
+                s1 ^= s1<<23;
+                state1[j] = s1^s0^(s1>>18)^(s0>>5);
+                transform(values+j, static_cast<u32>((state1[j]+s0)>>32));
+            }
+            values += Lanes;
+        }
+    }
+
+#if defined(LCORE_CPU_X86)
+    /// 2系列分進めて、64bitの和を返す
+    inline __m128i stepSSE2(__m128i& state0, __m128i& state1)
+    {
+        __m128i s1 = state0;
+        const __m128i s0 = state1;
+        state0 = s0;
+        s1 = _mm_xor_si128(s1, _mm_slli_epi64(s1, 23));
+        state1 = _mm_xor_si128(_mm_xor_si128(s1, s0), _mm_xor_si128(_mm_srli_epi64(s1, 18), _mm_srli_epi64(s0, 5)));
+        return _mm_add_epi64(state1, s0);
+    }
+
+    /// 4系列の上位32bitを系列の順に並べる
+    inline __m128i packHigh(__m128i r0, __m128i r1)
+    {
+        return _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(r0), _mm_castsi128_ps(r1), _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+
+    template<class T, class Transform>
+    void generateSSE2(u64* state0, u64* state1, s32 steps, T* values, const Transform& transform)
+    {
+        __m128i s0[4];
+        __m128i s1[4];
+        for(s32 i=0; i<4; ++i){
+            s0[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state0+i*2));
+            s1[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(state1+i*2));
+        }
+        for(s32 i=0; i<steps; ++i){
+            __m128i r0 = stepSSE2(s0[0], s1[0]);
+            __m128i r1 = stepSSE2(s0[1], s1[1]);
+            __m128i r2 = stepSSE2(s0[2], s1[2]);
+            __m128i r3 = stepSSE2(s0[3], s1[3]);
+            transform(values, packHigh(r0, r1));
+            transform(values+4, packHigh(r2, r3));
+            values += Lanes;
+        }
+        for(s32 i=0; i<4; ++i){
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(state0+i*2), s0[i]);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(state1+i*2), s1[i]);
+        }
+    }
+
+    LCORE_TARGET("avx2") inline __m256i stepAVX2(__m256i& state0, __m256i& state1)
+    {
+        __m256i s1 = state0;
+        const __m256i s0 = state1;
+        state0 = s0;
+        s1 = _mm256_xor_si256(s1, _mm256_slli_epi64(s1, 23));
+        state1 = _mm256_xor_si256(_mm256_xor_si256(s1, s0), _mm256_xor_si256(_mm256_srli_epi64(s1, 18), _mm256_srli_epi64(s0, 5)));
+        return _mm256_add_epi64(state1, s0);
+    }
+
+    template<class T, class Transform>
+    LCORE_TARGET("avx2") void generateAVX2(u64* state0, u64* state1, s32 steps, T* values, const Transform& transform)
+    {
+        __m256i s00 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(state0));
+        __m256i s01 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(state0+4));
+        __m256i s10 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(state1));
+        __m256i s11 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(state1+4));
+        for(s32 i=0; i<steps; ++i){
+            __m256i r0 = stepAVX2(s00, s10);
+            __m256i r1 = stepAVX2(s01, s11);
+            //Each 128bit half holds [0 1 4 5] and [2 3 6 7]
+            __m256i x = _mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(r0), _mm256_castsi256_ps(r1), _MM_SHUFFLE(3, 1, 3, 1)));
+            transform(values, _mm256_permute4x64_epi64(x, _MM_SHUFFLE(3, 1, 2, 0)));
+            values += Lanes;
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(state0), s00);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(state0+4), s01);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(state1), s10);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(state1+4), s11);
+    }
+
+    bool useAVX2()
+    {
+        static const bool avx2 = isSupportAVX2();
+        return avx2;
+    }
+#endif
+
+    template<class T, class Transform>
+    void generateSteps(RandXorshift128Plus32x8::SIMD simd, u64* state0, u64* state1, s32 steps, T* values, const Transform& transform)
+    {
+#if defined(LCORE_CPU_X86)
+        switch(simd)
+        {
+        case RandXorshift128Plus32x8::SIMD_AVX2:
+            generateAVX2(state0, state1, steps, values, transform);
+            break;
+        case RandXorshift128Plus32x8::SIMD_SSE2:
+            generateSSE2(state0, state1, steps, values, transform);
+            break;
+        default:
+            generateScalar(state0, state1, steps, values, transform);
+            break;
+        }
+#else
+        generateScalar(state0, state1, steps, values, transform);
+#endif
+    }
+
+    template<class T, class Transform>
+    void generate(RandXorshift128Plus32x8::SIMD simd, u64* state0, u64* state1, s32 count, T* values, const Transform& transform)
+    {
+        LASSERT(0<=count);
+        LASSERT(0 == count || NULL != values);
+        s32 steps = count/Lanes;
+        generateSteps(simd, state0, state1, steps, values, transform);
+
+        s32 rest = count - steps*Lanes;
+        if(0<rest){
+            T tmp[Lanes];
+            generateSteps(simd, state0, state1, 1, tmp, transform);
+            for(s32 i=0; i<rest; ++i){
+                values[steps*Lanes + i] = tmp[i];
+            }
+        }
+    }
+}
+
+    RandXorshift128Plus32x8::SIMD RandXorshift128Plus32x8::getSupportedSIMD()
+    {
+#if defined(LCORE_CPU_X86)
+        return useAVX2()? SIMD_AVX2 : SIMD_SSE2;
+#else
+        return SIMD_Scalar;
+#endif
+    }
+
+    RandXorshift128Plus32x8::RandXorshift128Plus32x8()
+        :simd_(getSupportedSIMD())
+    {
+        s0_[0] = 0x8a5cd789635d2dffULL;
+        s1_[0] = 0x121fd2155c472f96ULL;
+        initializeLanes();
+    }
+
+    RandXorshift128Plus32x8::RandXorshift128Plus32x8(u64 seed)
+        :simd_(getSupportedSIMD())
+    {
+        srand(seed);
+    }
+
+    RandXorshift128Plus32x8::~RandXorshift128Plus32x8()
+    {
+    }
+
+    void RandXorshift128Plus32x8::srand(u64 seed)
+    {
+        s0_[0] = seed;
+        s1_[0] = scramble(seed, 1);
+        initializeLanes();
+    }
+
+    void RandXorshift128Plus32x8::rand(s32 count, u32* values)
+    {
+        TransformBits transform;
+        generate(simd_, s0_, s1_, count, values, transform);
+    }
+
+    void RandXorshift128Plus32x8::frand2(s32 count, f32* values)
+    {
+        TransformFloat transform;
+        generate(simd_, s0_, s1_, count, values, transform);
+    }
+
+    void RandXorshift128Plus32x8::range_ropen(s32 count, u32* values, u32 vmin, u32 vmax)
+    {
+        LASSERT(vmin<=vmax);
+        TransformRangeU32 transform = {vmin, vmax-vmin};
+        generate(simd_, s0_, s1_, count, values, transform);
+    }
+
+    void RandXorshift128Plus32x8::range_ropen(s32 count, f32* values, f32 vmin, f32 vmax)
+    {
+        LASSERT(vmin<=vmax);
+        TransformRangeF32 transform = {vmin, vmax-vmin};
+        generate(simd_, s0_, s1_, count, values, transform);
+    }
+
+    void RandXorshift128Plus32x8::jump()
+    {
+        //Lanes are consecutive jumps, so continue from the last one
+        u64 s0 = s0_[Lanes-1];
+        u64 s1 = s1_[Lanes-1];
+        for(s32 i=0; i<Lanes; ++i){
+            jumpXorshift128Plus(s0, s1);
+            s0_[i] = s0;
+            s1_[i] = s1;
+        }
+    }
+
+    void RandXorshift128Plus32x8::setSIMD(SIMD simd)
+    {
+        simd_ = minimum(simd, getSupportedSIMD());
+    }
+
+    void RandXorshift128Plus32x8::swap(RandXorshift128Plus32x8& rhs)
+    {
+        for(s32 i=0; i<Lanes; ++i){
+            lcore::swap(s0_[i], rhs.s0_[i]);
+            lcore::swap(s1_[i], rhs.s1_[i]);
+        }
+        lcore::swap(simd_, rhs.simd_);
+    }
+
+    void RandXorshift128Plus32x8::initializeLanes()
+    {
+        for(s32 i=1; i<Lanes; ++i){
+            s0_[i] = s0_[i-1];
+            s1_[i] = s1_[i-1];
+            jumpXorshift128Plus(s0_[i], s1_[i]);
+        }
+    }
+
     //---------------------------------------------
     //---
     //--- RandWELL
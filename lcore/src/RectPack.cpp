@@ -37,4 +37,370 @@ namespace lcore
         context.width_ = width;
         context.height_ = height;
     }
+
+    //----------------------------------------------------
+    //---
+    //--- SkylinePack
+    //---
+    //----------------------------------------------------
+    SkylinePack::SkylinePack()
+        :width_(0)
+        ,height_(0)
+        ,numRects_(0)
+        ,usedArea_(0)
+    {
+    }
+
+    SkylinePack::~SkylinePack()
+    {
+    }
+
+    void SkylinePack::initialize(u16 width, u16 height)
+    {
+        LASSERT(0<width && 0<height);
+        width_ = width;
+        height_ = height;
+        clear();
+    }
+
+    void SkylinePack::clear()
+    {
+        numRects_ = 0;
+        usedArea_ = 0;
+        segments_.clear();
+        Segment segment = {0, 0, width_};
+        segments_.push_back(segment);
+    }
+
+    bool SkylinePack::insert(u16& x, u16& y, u16 width, u16 height)
+    {
+        LASSERT(0<width && 0<height);
+        s32 bestIndex = -1;
+        s32 bestTop = height_+1;
+        s32 bestWidth = width_+1;
+        s32 bestY = 0;
+        for(s32 i=0; i<segments_.size(); ++i){
+            s32 left = segments_[i].x_;
+            if(width_<(left+width)){
+                break;
+            }
+            //`̕ɂԂ̍łʒuɒu
+            s32 top = segments_[i].y_;
+            for(s32 j=i+1; j<segments_.size() && segments_[j].x_<(left+width); ++j){
+                top = maximum(top, segments_[j].y_);
+            }
+            if(height_<(top+height)){
+                continue;
+            }
+            if((top+height)<bestTop || ((top+height) == bestTop && segments_[i].width_<bestWidth)){
+                bestIndex = i;
+                bestTop = top+height;
+                bestWidth = segments_[i].width_;
+                bestY = top;
+            }
+        }
+        if(bestIndex<0){
+            return false;
+        }
+        x = static_cast<u16>(segments_[bestIndex].x_);
+        y = static_cast<u16>(bestY);
+        setLevel(x, width, bestTop);
+        ++numRects_;
+        usedArea_ += static_cast<s64>(width)*height;
+        return true;
+    }
+
+    bool SkylinePack::remove(u16 x, u16 y, u16 width, u16 height)
+    {
+        LASSERT(0<numRects_);
+        LASSERT((x+width)<=width_ && (y+height)<=height_);
+        --numRects_;
+        usedArea_ -= static_cast<s64>(width)*height;
+
+        //ɉڂĂȂΉ
+        s32 top = y+height;
+        s32 end = x+width;
+        for(s32 i=0; i<segments_.size() && segments_[i].x_<end; ++i){
+            if(x<(segments_[i].x_+segments_[i].width_) && top != segments_[i].y_){
+                return false;
+            }
+        }
+        setLevel(x, width, y);
+        return true;
+    }
+
+    void SkylinePack::getStatistics(RectPackStatistics& statistics) const
+    {
+        s64 total = static_cast<s64>(width_)*height_;
+        s64 below = 0;
+        for(s32 i=0; i<segments_.size(); ++i){
+            below += static_cast<s64>(segments_[i].width_)*segments_[i].y_;
+        }
+        statistics.numRects_ = numRects_;
+        statistics.numFreeRects_ = segments_.size();
+        statistics.usedArea_ = usedArea_;
+        statistics.freeArea_ = total - below;
+        statistics.occupancy_ = (0<total)? static_cast<f32>(static_cast<f64>(usedArea_)/total) : 0.0f;
+    }
+
+    void SkylinePack::setLevel(s32 x, s32 width, s32 y)
+    {
+        s32 end = x+width;
+        s32 first = 0;
+        while((segments_[first].x_+segments_[first].width_)<=x){
+            ++first;
+        }
+        s32 last = first+1;
+        while(last<segments_.size() && segments_[last].x_<end){
+            ++last;
+        }
+
+        //dȂԂA̎cAVԁAE̎cɒu
+        Segment pieces[3];
+        s32 count = 0;
+        const Segment& left = segments_[first];
+        if(left.x_<x){
+            Segment segment = {left.x_, left.y_, x-left.x_};
+            pieces[count++] = segment;
+        }
+        Segment segment = {x, y, width};
+        pieces[count++] = segment;
+        const Segment& right = segments_[last-1];
+        s32 rightEnd = right.x_+right.width_;
+        if(end<rightEnd){
+            Segment rest = {end, right.y_, rightEnd-end};
+            pieces[count++] = rest;
+        }
+
+        s32 size = segments_.size();
+        s32 newSize = size - (last-first) + count;
+        if(size<newSize){
+            segments_.resize(newSize);
+        }
+        lcore::memmove(&segments_[first+count], &segments_[last], sizeof(Segment)*(size-last));
+        if(newSize<size){
+            segments_.resize(newSize);
+        }
+        for(s32 i=0; i<count; ++i){
+            segments_[first+i] = pieces[i];
+        }
+
+        //ׂ̗
+        s32 i = maximum(first-1, 0);
+        s32 mergeEnd = first+count;
+        while(i<mergeEnd && (i+1)<segments_.size()){
+            if(segments_[i].y_ == segments_[i+1].y_){
+                segments_[i].width_ += segments_[i+1].width_;
+                segments_.removeAt(i+1);
+                --mergeEnd;
+            }else{
+                ++i;
+            }
+        }
+    }
+
+    //----------------------------------------------------
+    //---
+    //--- GuillotinePack
+    //---
+    //----------------------------------------------------
+    GuillotinePack::GuillotinePack()
+        :width_(0)
+        ,height_(0)
+        ,heuristic_(Heuristic_BestAreaFit)
+        ,numRects_(0)
+        ,usedArea_(0)
+        ,freePair_(-1)
+    {
+    }
+
+    GuillotinePack::~GuillotinePack()
+    {
+    }
+
+    void GuillotinePack::initialize(u16 width, u16 height, Heuristic heuristic)
+    {
+        LASSERT(0<width && 0<height);
+        width_ = width;
+        height_ = height;
+        heuristic_ = heuristic;
+        clear();
+    }
+
+    void GuillotinePack::clear()
+    {
+        numRects_ = 0;
+        usedArea_ = 0;
+        freePair_ = -1;
+        nodes_.clear();
+        freeLeaves_.clear();
+        Node root = {0, 0, width_, height_, -1, -1, -1};
+        nodes_.push_back(root);
+        addFree(0);
+    }
+
+    bool GuillotinePack::insert(u16& x, u16& y, u16 width, u16 height)
+    {
+        LASSERT(0<width && 0<height);
+        s32 bestIndex = -1;
+        s32 bestScore = 0x7FFFFFFF;
+        for(s32 i=0; i<freeLeaves_.size(); ++i){
+            const Node& node = nodes_[freeLeaves_[i]];
+            if(node.width_<width || node.height_<height){
+                continue;
+            }
+            if(node.width_ == width && node.height_ == height){
+                bestIndex = freeLeaves_[i];
+                break;
+            }
+            s32 s = score(node, width, height);
+            if(s<bestScore){
+                bestIndex = freeLeaves_[i];
+                bestScore = s;
+            }
+        }
+        if(bestIndex<0){
+            return false;
+        }
+
+        removeFree(bestIndex);
+        s32 leaf = split(bestIndex, width, height);
+        x = static_cast<u16>(nodes_[leaf].x_);
+        y = static_cast<u16>(nodes_[leaf].y_);
+        ++numRects_;
+        usedArea_ += static_cast<s64>(width)*height;
+        return true;
+    }
+
+    void GuillotinePack::remove(u16 x, u16 y, u16 width, u16 height)
+    {
+        LASSERT(0<numRects_);
+        LASSERT((x+width)<=width_ && (y+height)<=height_);
+
+        //̊p܂ޗtT
+        s32 index = 0;
+        while(0<=nodes_[index].child_){
+            const Node& child = nodes_[nodes_[index].child_];
+            bool inside = x<(child.x_+child.width_) && y<(child.y_+child.height_);
+            index = (inside)? nodes_[index].child_ : nodes_[index].child_+1;
+        }
+        LASSERT(nodes_[index].x_ == x && nodes_[index].y_ == y);
+        LASSERT(nodes_[index].width_ == width && nodes_[index].height_ == height);
+        LASSERT(nodes_[index].free_<0);
+
+        --numRects_;
+        usedArea_ -= static_cast<s64>(width)*height;
+        addFree(index);
+        coalesce(index);
+    }
+
+    void GuillotinePack::getStatistics(RectPackStatistics& statistics) const
+    {
+        s64 total = static_cast<s64>(width_)*height_;
+        s64 freeArea = 0;
+        for(s32 i=0; i<freeLeaves_.size(); ++i){
+            const Node& node = nodes_[freeLeaves_[i]];
+            freeArea += static_cast<s64>(node.width_)*node.height_;
+        }
+        statistics.numRects_ = numRects_;
+        statistics.numFreeRects_ = freeLeaves_.size();
+        statistics.usedArea_ = usedArea_;
+        statistics.freeArea_ = freeArea;
+        statistics.occupancy_ = (0<total)? static_cast<f32>(static_cast<f64>(usedArea_)/total) : 0.0f;
+    }
+
+    s32 GuillotinePack::score(const Node& node, s32 width, s32 height) const
+    {
+        s32 restWidth = node.width_ - width;
+        s32 restHeight = node.height_ - height;
+        switch(heuristic_)
+        {
+        case Heuristic_BestShortSideFit:
+            return minimum(restWidth, restHeight);
+        default:
+            return node.width_*node.height_ - width*height;
+        }
+    }
+
+    s32 GuillotinePack::popPair()
+    {
+        if(0<=freePair_){
+            s32 index = freePair_;
+            freePair_ = nodes_[index].child_;
+            return index;
+        }
+        s32 index = nodes_.size();
+        nodes_.resize(index+2);
+        return index;
+    }
+
+    void GuillotinePack::pushPair(s32 index)
+    {
+        nodes_[index].child_ = freePair_;
+        freePair_ = index;
+    }
+
+    void GuillotinePack::addFree(s32 index)
+    {
+        nodes_[index].free_ = freeLeaves_.size();
+        freeLeaves_.push_back(index);
+    }
+
+    void GuillotinePack::removeFree(s32 index)
+    {
+        s32 position = nodes_[index].free_;
+        LASSERT(0<=position && freeLeaves_[position] == index);
+        s32 last = freeLeaves_.back();
+        freeLeaves_[position] = last;
+        nodes_[last].free_ = position;
+        freeLeaves_.pop_back();
+        nodes_[index].free_ = -1;
+    }
+
+    s32 GuillotinePack::split(s32 index, s32 width, s32 height)
+    {
+        for(;;){
+            Node node = nodes_[index];
+            s32 restWidth = node.width_ - width;
+            s32 restHeight = node.height_ - height;
+            if(0 == restWidth && 0 == restHeight){
+                return index;
+            }
+            //c̒Z̎Őɐ؂
+            s32 child = popPair();
+            Node& first = nodes_[child];
+            Node& second = nodes_[child+1];
+            if(restWidth<=restHeight){
+                Node bottom = {node.x_, node.y_, node.width_, height, index, -1, -1};
+                Node top = {node.x_, node.y_+height, node.width_, restHeight, index, -1, -1};
+                first = bottom;
+                second = top;
+            }else{
+                Node left = {node.x_, node.y_, width, node.height_, index, -1, -1};
+                Node right = {node.x_+width, node.y_, restWidth, node.height_, index, -1, -1};
+                first = left;
+                second = right;
+            }
+            nodes_[index].child_ = child;
+            addFree(child+1);
+            index = child;
+        }
+    }
+
+    void GuillotinePack::coalesce(s32 index)
+    {
+        for(s32 parent = nodes_[index].parent_; 0<=parent; parent = nodes_[parent].parent_){
+            s32 child = nodes_[parent].child_;
+            if(0<=nodes_[child].child_ || nodes_[child].free_<0
+                || 0<=nodes_[child+1].child_ || nodes_[child+1].free_<0)
+            {
+                return;
+            }
+            removeFree(child);
+            removeFree(child+1);
+            pushPair(child);
+            nodes_[parent].child_ = -1;
+            addFree(parent);
+        }
+    }
 }
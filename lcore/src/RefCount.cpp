@@ -0,0 +1,53 @@
+﻿/**
+@file RefCount.cpp
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "RefCount.h"
+
+namespace lcore
+{
+    DeferredReleaseQueue::DeferredReleaseQueue()
+    {
+    }
+
+    DeferredReleaseQueue::~DeferredReleaseQueue()
+    {
+        //解放中に積まれたものがなくなるまで
+        while(0<process()){
+        }
+    }
+
+    void DeferredReleaseQueue::push(void* ptr, ReleaseFunc func)
+    {
+        LASSERT(NULL != func);
+        if(NULL == ptr){
+            return;
+        }
+        Entry entry = {ptr, func};
+        SPLock lock(lock_);
+        pending_.push_back(entry);
+    }
+
+    s32 DeferredReleaseQueue::process()
+    {
+        LASSERT(processing_.size()<=0);
+        {
+            SPLock lock(lock_);
+            pending_.swap(processing_);
+        }
+        //ロックの外で解放する. 解放関数からpushしてもよい
+        s32 count = processing_.size();
+        for(s32 i=0; i<count; ++i){
+            processing_[i].func_(processing_[i].ptr_);
+        }
+        processing_.clear();
+        return count;
+    }
+
+    s32 DeferredReleaseQueue::size() const
+    {
+        SPLock lock(lock_);
+        return pending_.size();
+    }
+}
@@ -4,11 +4,34 @@
 @date 2011/08/06
 */
 #include "Socket.h"
+#include "SyncObject.h"
 
 #include <memory.h>
 
 namespace lcore
 {
+namespace
+{
+#if !defined(_WIN32)
+    inline s32 closesocket(SOCKET socket)
+    {
+        return ::close(socket);
+    }
+#else
+    inline bool hasPendingData(SOCKET socket)
+    {
+        u_long size = 0;
+        return 0 == ioctlsocket(socket, FIONREAD, &size) && 0<size;
+    }
+#endif
+
+    static const s32 MaxUDPPayload = 65507;
+    static const s32 MaxUDPSegments = 64;
+
+    /// カーネルがUDP_SEGMENTを拒否したら1
+    volatile s32 udpSegmentUnavailable_ = 0;
+}
+
     //----------------------------------------------------
     //---
     //--- SocketUtil
@@ -29,19 +52,61 @@ namespace lcore
         return (NULL != ret);
     }
 
-    u16 SocketUtil::htons(u16 port)
+    u16 (SocketUtil::htons)(u16 port)
     {
         return ::htons(port);
     }
 
-    u16 SocketUtil::ntohs(u16 port)
+    u16 (SocketUtil::ntohs)(u16 port)
     {
         return ::ntohs(port);
     }
 
     s32 SocketUtil::select(s32 nfds, fd_set* readfds, fd_set* writefds, fd_set* exceptfds, const timeval* timeout)
     {
-        return ::select(nfds, readfds, writefds, exceptfds, timeout);
+        //POSIXの::selectはtimeoutを書き換えるため, 複製を渡す
+        if(NULL == timeout){
+            return ::select(nfds, readfds, writefds, exceptfds, NULL);
+        }
+        timeval tv = *timeout;
+        return ::select(nfds, readfds, writefds, exceptfds, &tv);
+    }
+
+    bool SocketUtil::createDatagramGroup(Socket* sockets, s32 count, u16 port, u64 acceptIP)
+    {
+        LASSERT(NULL != sockets);
+        LASSERT(0<count);
+        bool result = true;
+        for(s32 i=0; i<count && result; ++i){
+            sockets[i].close();
+            result = sockets[i].create(Family_INET, SocketType_DGRAM, Protocol_UDP);
+            if(result && 1<count){
+#if defined(SO_REUSEPORT)
+                s32 enable = 1;
+                result = (SOCKET_ERROR != sockets[i].setOption(SocketOption_REUSEPORT, &enable));
+#else
+                result = false;
+#endif
+            }
+            if(result){
+                result = (SOCKET_ERROR != sockets[i].bind(port, acceptIP));
+            }
+        }
+        if(!result){
+            for(s32 i=0; i<count; ++i){
+                sockets[i].close();
+            }
+        }
+        return result;
+    }
+
+    bool SocketUtil::isUDPSegmentAvailable()
+    {
+#if defined(LCORE_SOCKET_MMSG)
+        return 0 == atomicLoad(udpSegmentUnavailable_);
+#else
+        return false;
+#endif
     }
 
     //----------------------------------------------------
@@ -55,20 +120,30 @@ namespace lcore
     // 初期化
     bool SocketSystem::initialize()
     {
+#if defined(_WIN32)
         s32 ret = WSAStartup(MAKEWORD(2,2), &instance_.wsaData_);
         return ret == 0;
+#else
+        return true;
+#endif
     }
 
     // 終了
     void SocketSystem::terminate()
     {
+#if defined(_WIN32)
         WSACleanup();
+#endif
     }
 
     // エラーコード取得
     s32 SocketSystem::getError()
     {
+#if defined(_WIN32)
         return WSAGetLastError();
+#else
+        return errno;
+#endif
     }
 
     void SocketSystem::printError(const Char* message)
@@ -188,7 +263,14 @@ namespace lcore
 
     s32 SocketBase::getOption(SocketOption name, Char* val, s32* length)
     {
+#if defined(_WIN32)
         return ::getsockopt(socket_, SOL_SOCKET, name, val, length);
+#else
+        socklen_t len = static_cast<socklen_t>(*length);
+        s32 ret = ::getsockopt(socket_, SOL_SOCKET, name, val, &len);
+        *length = static_cast<s32>(len);
+        return ret;
+#endif
     }
 
     bool SocketBase::setNonBlock()
@@ -210,6 +292,13 @@ namespace lcore
 #endif
     }
 
+    bool SocketBase::setNoDelay(bool enable)
+    {
+        LASSERT(socket_ != INVALID_SOCKET);
+        s32 val = (enable)? 1 : 0;
+        return SOCKET_ERROR != ::setsockopt(socket_, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const Char*>(&val), sizeof(s32));
+    }
+
     void SocketBase::close()
     {
         if(socket_ != INVALID_SOCKET){
@@ -246,9 +335,16 @@ namespace lcore
     {
         LASSERT(socket_ != INVALID_SOCKET);
         sockaddr_in info;
+        lcore::memset(&info, 0, sizeof(sockaddr_in));
+#if defined(_WIN32)
         info.sin_family = static_cast<ADDRESS_FAMILY>(family_);
         info.sin_port = htons(port);
         info.sin_addr.S_un.S_addr = static_cast<ULONG>(acceptIP);
+#else
+        info.sin_family = static_cast<sa_family_t>(family_);
+        info.sin_port = htons(port);
+        info.sin_addr.s_addr = static_cast<in_addr_t>(acceptIP);
+#endif
 
         return ::bind(socket_, (const sockaddr*)&info, static_cast<int>(sizeof(sockaddr_in)));
     }
@@ -262,7 +358,15 @@ namespace lcore
     {
         LASSERT(socket_ != INVALID_SOCKET);
 
+#if defined(_WIN32)
         SOCKET ret = ::accept(socket_, addr, addrlen);
+#else
+        socklen_t len = (NULL != addrlen)? static_cast<socklen_t>(*addrlen) : 0;
+        SOCKET ret = ::accept(socket_, addr, (NULL != addrlen)? &len : NULL);
+        if(NULL != addrlen){
+            *addrlen = static_cast<s32>(len);
+        }
+#endif
 
         if(ret != INVALID_SOCKET){
             SocketBase tmp(family_, type_, protocol_, ret);
@@ -272,6 +376,229 @@ namespace lcore
         return false;
     }
 
+    s32 SocketBase::recvBatch(PacketArena& arena, s32 flags, PacketCounter* counter)
+    {
+        LASSERT(socket_ != INVALID_SOCKET);
+        s32 start = arena.size_;
+        s32 count = arena.capacity_ - start;
+        if(count<=0){
+            return 0;
+        }
+
+        s32 received = 0;
+        s32 bytes = 0;
+#if defined(LCORE_SOCKET_MMSG)
+        mmsghdr* headers = arena.headers_ + start;
+        for(s32 i=0; i<count; ++i){
+            headers[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+            headers[i].msg_hdr.msg_iov->iov_len = arena.packetSize_;
+            headers[i].msg_hdr.msg_flags = 0;
+            headers[i].msg_len = 0;
+        }
+        //Block only for the first datagram
+        do{
+            received = ::recvmmsg(socket_, headers, count, flags|MSG_WAITFORONE, NULL);
+        }while(received<0 && EINTR == errno);
+        if(received<0){
+            return isSocketWouldBlock(errno)? 0 : -1;
+        }
+        for(s32 i=0; i<received; ++i){
+            PacketArena::Packet& packet = arena.packets_[start+i];
+            packet.size_ = static_cast<s32>(headers[i].msg_len);
+            packet.addressLength_ = static_cast<s32>(headers[i].msg_hdr.msg_namelen);
+            bytes += packet.size_;
+        }
+
+#else
+        while(received<count){
+            //Block only for the first datagram
+#if defined(_WIN32)
+            if(0<received && !hasPendingData(socket_)){
+                break;
+            }
+            s32 f = flags;
+#else
+            s32 f = (0<received)? (flags|MSG_DONTWAIT) : flags;
+#endif
+            PacketArena::Packet& packet = arena.packets_[start+received];
+            packet.addressLength_ = sizeof(sockaddr_storage);
+            s32 size = recvfrom(packet.data_, arena.packetSize_, f, reinterpret_cast<SOCKADDR*>(&packet.address_), &packet.addressLength_);
+            if(size<0){
+                s32 error = SocketSystem::getError();
+                if(SocketError_EINTR == error){
+                    continue;
+                }
+                if(0<received || isSocketWouldBlock(error)){
+                    break;
+                }
+                return -1;
+            }
+            packet.size_ = size;
+            bytes += size;
+            ++received;
+        }
+        if(received<=0){
+            return 0;
+        }
+#endif
+        arena.size_ += received;
+        if(NULL != counter){
+            counter->addReceived(received, bytes);
+        }
+        return received;
+    }
+
+    s32 SocketBase::sendBatch(PacketArena& arena, s32 offset, s32 count, s32 flags, PacketCounter* counter)
+    {
+        LASSERT(socket_ != INVALID_SOCKET);
+        LASSERT(0<=offset && 0<=count && (offset+count)<=arena.size_);
+
+        s32 sent = 0;
+        s32 bytes = 0;
+#if defined(LCORE_SOCKET_MMSG)
+        mmsghdr* headers = arena.headers_ + offset;
+        for(s32 i=0; i<count; ++i){
+            PacketArena::Packet& packet = arena.packets_[offset+i];
+            headers[i].msg_hdr.msg_name = (0<packet.addressLength_)? &packet.address_ : NULL;
+            headers[i].msg_hdr.msg_namelen = static_cast<socklen_t>(packet.addressLength_);
+            headers[i].msg_hdr.msg_iov->iov_len = packet.size_;
+            headers[i].msg_hdr.msg_flags = 0;
+        }
+        while(sent<count){
+            s32 ret = ::sendmmsg(socket_, headers+sent, count-sent, flags|MSG_NOSIGNAL);
+            if(ret<0){
+                if(EINTR == errno){
+                    continue;
+                }
+                if(0<sent || isSocketWouldBlock(errno)){
+                    break;
+                }
+                return -1;
+            }
+            sent += ret;
+        }
+        //Restore receive address slots
+        for(s32 i=0; i<count; ++i){
+            headers[i].msg_hdr.msg_name = &arena.packets_[offset+i].address_;
+        }
+        for(s32 i=0; i<sent; ++i){
+            bytes += arena.packets_[offset+i].size_;
+        }
+
+#else
+        while(sent<count){
+            const PacketArena::Packet& packet = arena.packets_[offset+sent];
+            s32 size = sendto(packet.data_, packet.size_, flags, (0<packet.addressLength_)? packet.getAddress() : NULL, packet.addressLength_);
+            if(size<0){
+                s32 error = SocketSystem::getError();
+                if(SocketError_EINTR == error){
+                    continue;
+                }
+                if(0<sent || isSocketWouldBlock(error)){
+                    break;
+                }
+                return -1;
+            }
+            bytes += size;
+            ++sent;
+        }
+#endif
+        if(NULL != counter && 0<sent){
+            counter->addSent(sent, bytes);
+        }
+        return sent;
+    }
+
+    s32 SocketBase::sendSegments(const Char* buff, s32 len, s32 segmentSize, s32 flags, const SOCKADDR* to, s32 tolen, PacketCounter* counter)
+    {
+        LASSERT(socket_ != INVALID_SOCKET);
+        LASSERT(NULL != buff);
+        LASSERT(0<segmentSize);
+
+        s32 total = 0;
+        s32 packets = 0;
+        bool blocked = false;
+#if defined(LCORE_SOCKET_MMSG)
+        if(0 == atomicLoad(udpSegmentUnavailable_) && segmentSize<=MaxUDPPayload){
+            s32 maxChunk = minimum(segmentSize*MaxUDPSegments, (MaxUDPPayload/segmentSize)*segmentSize);
+            //cmsghdrの境界に揃える
+            union Control
+            {
+                cmsghdr align_;
+                Char buffer_[CMSG_SPACE(sizeof(u16))];
+            };
+            Control control;
+            while(total<len){
+                s32 size = minimum(len-total, maxChunk);
+                iovec iov;
+                iov.iov_base = const_cast<Char*>(buff+total);
+                iov.iov_len = size;
+
+                msghdr message;
+                lcore::memset(&message, 0, sizeof(msghdr));
+                message.msg_name = const_cast<SOCKADDR*>(to);
+                message.msg_namelen = (NULL != to)? static_cast<socklen_t>(tolen) : 0;
+                message.msg_iov = &iov;
+                message.msg_iovlen = 1;
+                if(segmentSize<size){
+                    lcore::memset(control.buffer_, 0, sizeof(control.buffer_));
+                    message.msg_control = control.buffer_;
+                    message.msg_controllen = sizeof(control.buffer_);
+                    cmsghdr* cmsg = CMSG_FIRSTHDR(&message);
+                    cmsg->cmsg_level = SOL_UDP;
+                    cmsg->cmsg_type = UDP_SEGMENT;
+                    cmsg->cmsg_len = CMSG_LEN(sizeof(u16));
+                    u16 gsoSize = static_cast<u16>(segmentSize);
+                    lcore::memcpy(CMSG_DATA(cmsg), &gsoSize, sizeof(u16));
+                }
+                s32 ret = static_cast<s32>(::sendmsg(socket_, &message, flags|MSG_NOSIGNAL));
+                if(ret<0){
+                    s32 error = errno;
+                    if(EINTR == error){
+                        continue;
+                    }
+                    if(isSocketWouldBlock(error)){
+                        blocked = true;
+                        break;
+                    }
+                    if(segmentSize<size && (EIO == error || EINVAL == error || ENOPROTOOPT == error || EOPNOTSUPP == error)){
+                        //Not supported by the kernel or device, split by hand from now on
+                        atomicStore(udpSegmentUnavailable_, 1);
+                        break;
+                    }
+                    if(0<total){
+                        blocked = true;
+                        break;
+                    }
+                    return -1;
+                }
+                total += ret;
+                packets += (ret+segmentSize-1)/segmentSize;
+            }
+        }
+#endif
+        while(!blocked && total<len){
+            s32 size = minimum(len-total, segmentSize);
+            s32 ret = sendto(buff+total, size, flags, to, tolen);
+            if(ret<0){
+                s32 error = SocketSystem::getError();
+                if(SocketError_EINTR == error){
+                    continue;
+                }
+                if(0<total || isSocketWouldBlock(error)){
+                    break;
+                }
+                return -1;
+            }
+            total += ret;
+            ++packets;
+        }
+        if(NULL != counter && 0<packets){
+            counter->addSent(packets, total);
+        }
+        return total;
+    }
+
     // スワップ
     void SocketBase::swap(SocketBase& rhs)
     {
@@ -279,5 +606,333 @@ namespace lcore
         lcore::swap(type_, rhs.type_);
         lcore::swap(protocol_, rhs.protocol_);
         lcore::swap(socket_, rhs.socket_);
-    }    
+    }
+
+    //----------------------------------------------------
+    //---
+    //--- NetworkBuffer
+    //---
+    //----------------------------------------------------
+    NetworkBuffer::NetworkBuffer()
+        :capacity_(0)
+        ,head_(0)
+        ,tail_(0)
+        ,buffer_(NULL)
+    {
+    }
+
+    NetworkBuffer::NetworkBuffer(s32 capacity)
+        :capacity_(0)
+        ,head_(0)
+        ,tail_(0)
+        ,buffer_(NULL)
+    {
+        initialize(capacity);
+    }
+
+    NetworkBuffer::~NetworkBuffer()
+    {
+        release();
+    }
+
+    void NetworkBuffer::initialize(s32 capacity)
+    {
+        LASSERT(0<capacity);
+        u32 newCapacity = roundUpPow2(static_cast<u32>(capacity));
+        head_ = tail_ = 0;
+        if(newCapacity == capacity_){
+            return;
+        }
+        LFREE(buffer_);
+        capacity_ = newCapacity;
+        buffer_ = reinterpret_cast<Char*>(LMALLOC(capacity_));
+    }
+
+    void NetworkBuffer::release()
+    {
+        LFREE(buffer_);
+        capacity_ = 0;
+        head_ = tail_ = 0;
+    }
+
+    s32 NetworkBuffer::write(const void* data, s32 size)
+    {
+        LASSERT(NULL != data);
+        LASSERT(0<=size);
+        u32 count = minimum(static_cast<u32>(size), capacity_-(tail_-head_));
+        u32 mask = capacity_-1;
+        u32 offset = tail_ & mask;
+        u32 count0 = minimum(count, capacity_-offset);
+        const Char* src = reinterpret_cast<const Char*>(data);
+        lcore::memcpy(buffer_+offset, src, count0);
+        lcore::memcpy(buffer_, src+count0, count-count0);
+        tail_ += count;
+        return static_cast<s32>(count);
+    }
+
+    s32 NetworkBuffer::read(void* data, s32 size)
+    {
+        s32 count = peek(data, size);
+        head_ += static_cast<u32>(count);
+        return count;
+    }
+
+    s32 NetworkBuffer::peek(void* data, s32 size) const
+    {
+        LASSERT(NULL != data);
+        LASSERT(0<=size);
+        u32 count = minimum(static_cast<u32>(size), tail_-head_);
+        u32 mask = capacity_-1;
+        u32 offset = head_ & mask;
+        u32 count0 = minimum(count, capacity_-offset);
+        Char* dst = reinterpret_cast<Char*>(data);
+        lcore::memcpy(dst, buffer_+offset, count0);
+        lcore::memcpy(dst+count0, buffer_, count-count0);
+        return static_cast<s32>(count);
+    }
+
+    void NetworkBuffer::skip(s32 size)
+    {
+        LASSERT(0<=size);
+        head_ += minimum(static_cast<u32>(size), tail_-head_);
+    }
+
+    s32 NetworkBuffer::getReadRegion(const Char*& data) const
+    {
+        u32 offset = head_ & (capacity_-1);
+        data = buffer_ + offset;
+        return static_cast<s32>(minimum(tail_-head_, capacity_-offset));
+    }
+
+    NetworkBuffer::Result NetworkBuffer::recv(SocketBase& socket, s32& received)
+    {
+        LASSERT(NULL != buffer_);
+        received = 0;
+        u32 mask = capacity_-1;
+        for(;;){
+            u32 freeSize = capacity_-(tail_-head_);
+            if(freeSize<=0){
+                return Result_Full;
+            }
+            //Receive into contiguous free region
+            u32 offset = tail_ & mask;
+            u32 size = minimum(freeSize, capacity_-offset);
+            s32 ret = socket.recv(buffer_+offset, static_cast<s32>(size), 0);
+            if(0<ret){
+                tail_ += static_cast<u32>(ret);
+                received += ret;
+                continue;
+            }
+            if(0 == ret){
+                return Result_Closed;
+            }
+            s32 error = SocketSystem::getError();
+            if(SocketError_EINTR == error){
+                continue;
+            }
+            return isSocketWouldBlock(error)? Result_WouldBlock : Result_Error;
+        }
+    }
+
+    NetworkBuffer::Result NetworkBuffer::send(SocketBase& socket, s32& sent)
+    {
+        LASSERT(NULL != buffer_);
+        sent = 0;
+        for(;;){
+            const Char* data;
+            s32 size = getReadRegion(data);
+            if(size<=0){
+                return Result_Full;
+            }
+            s32 ret = socket.send(data, size, 0);
+            if(0<ret){
+                head_ += static_cast<u32>(ret);
+                sent += ret;
+                continue;
+            }
+            s32 error = SocketSystem::getError();
+            if(SocketError_EINTR == error){
+                continue;
+            }
+            return isSocketWouldBlock(error)? Result_WouldBlock : Result_Error;
+        }
+    }
+
+    void NetworkBuffer::swap(NetworkBuffer& rhs)
+    {
+        lcore::swap(capacity_, rhs.capacity_);
+        lcore::swap(head_, rhs.head_);
+        lcore::swap(tail_, rhs.tail_);
+        lcore::swap(buffer_, rhs.buffer_);
+    }
+
+    //----------------------------------------------------
+    //---
+    //--- PacketArena
+    //---
+    //----------------------------------------------------
+    PacketArena::PacketArena()
+        :capacity_(0)
+        ,packetSize_(0)
+        ,size_(0)
+        ,buffer_(NULL)
+        ,packets_(NULL)
+#if defined(LCORE_SOCKET_MMSG)
+        ,headers_(NULL)
+#endif
+    {
+    }
+
+    PacketArena::PacketArena(s32 maxPackets, s32 packetSize)
+        :capacity_(0)
+        ,packetSize_(0)
+        ,size_(0)
+        ,buffer_(NULL)
+        ,packets_(NULL)
+#if defined(LCORE_SOCKET_MMSG)
+        ,headers_(NULL)
+#endif
+    {
+        initialize(maxPackets, packetSize);
+    }
+
+    PacketArena::~PacketArena()
+    {
+        release();
+    }
+
+    void PacketArena::initialize(s32 maxPackets, s32 packetSize)
+    {
+        LASSERT(0<maxPackets);
+        LASSERT(0<packetSize);
+        release();
+
+        capacity_ = maxPackets;
+        packetSize_ = (packetSize+Align-1) & ~(Align-1);
+        size_ = 0;
+        buffer_ = reinterpret_cast<Char*>(LALIGNED_MALLOC(packetSize_*capacity_, Align));
+        packets_ = reinterpret_cast<Packet*>(LMALLOC(sizeof(Packet)*capacity_));
+        lcore::memset(packets_, 0, sizeof(Packet)*capacity_);
+        for(s32 i=0; i<capacity_; ++i){
+            packets_[i].data_ = buffer_ + packetSize_*i;
+        }
+
+#if defined(LCORE_SOCKET_MMSG)
+        //Headers and iovecs stay bound to their slots
+        headers_ = reinterpret_cast<mmsghdr*>(LMALLOC((sizeof(mmsghdr)+sizeof(iovec))*capacity_));
+        iovec* iovecs = reinterpret_cast<iovec*>(headers_ + capacity_);
+        lcore::memset(headers_, 0, sizeof(mmsghdr)*capacity_);
+        for(s32 i=0; i<capacity_; ++i){
+            iovecs[i].iov_base = packets_[i].data_;
+            iovecs[i].iov_len = packetSize_;
+            headers_[i].msg_hdr.msg_name = &packets_[i].address_;
+            headers_[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+            headers_[i].msg_hdr.msg_iov = &iovecs[i];
+            headers_[i].msg_hdr.msg_iovlen = 1;
+        }
+#endif
+    }
+
+    void PacketArena::release()
+    {
+#if defined(LCORE_SOCKET_MMSG)
+        LFREE(headers_);
+#endif
+        LFREE(packets_);
+        LALIGNED_FREE(buffer_, Align);
+        capacity_ = 0;
+        packetSize_ = 0;
+        size_ = 0;
+    }
+
+    PacketArena::Packet* PacketArena::push(const SOCKADDR* to, s32 tolen)
+    {
+        if(capacity_<=size_){
+            return NULL;
+        }
+        Packet& packet = packets_[size_];
+        ++size_;
+        packet.size_ = 0;
+        if(NULL != to){
+            LASSERT(0<tolen && tolen<=static_cast<s32>(sizeof(sockaddr_storage)));
+            lcore::memcpy(&packet.address_, to, tolen);
+            packet.addressLength_ = tolen;
+        }else{
+            packet.addressLength_ = 0;
+        }
+        return &packet;
+    }
+
+    bool PacketArena::push(const void* data, s32 size, const SOCKADDR* to, s32 tolen)
+    {
+        LASSERT(NULL != data);
+        LASSERT(0<=size && size<=packetSize_);
+        Packet* packet = push(to, tolen);
+        if(NULL == packet){
+            return false;
+        }
+        lcore::memcpy(packet->data_, data, size);
+        packet->size_ = size;
+        return true;
+    }
+
+    void PacketArena::swap(PacketArena& rhs)
+    {
+        lcore::swap(capacity_, rhs.capacity_);
+        lcore::swap(packetSize_, rhs.packetSize_);
+        lcore::swap(size_, rhs.size_);
+        lcore::swap(buffer_, rhs.buffer_);
+        lcore::swap(packets_, rhs.packets_);
+#if defined(LCORE_SOCKET_MMSG)
+        lcore::swap(headers_, rhs.headers_);
+#endif
+    }
+
+    //----------------------------------------------------
+    //---
+    //--- PacketCounter
+    //---
+    //----------------------------------------------------
+    PacketCounter::PacketCounter()
+    {
+        reset();
+    }
+
+    void PacketCounter::reset()
+    {
+        start_ = getPerformanceCounter();
+        receiveCalls_ = 0;
+        receivedPackets_ = 0;
+        receivedBytes_ = 0;
+        sendCalls_ = 0;
+        sentPackets_ = 0;
+        sentBytes_ = 0;
+    }
+
+    void PacketCounter::add(const PacketCounter& rhs)
+    {
+        receiveCalls_ += rhs.receiveCalls_;
+        receivedPackets_ += rhs.receivedPackets_;
+        receivedBytes_ += rhs.receivedBytes_;
+        sendCalls_ += rhs.sendCalls_;
+        sentPackets_ += rhs.sentPackets_;
+        sentBytes_ += rhs.sentBytes_;
+    }
+
+    f64 PacketCounter::getElapsedTime() const
+    {
+        return calcTime64(start_, getPerformanceCounter());
+    }
+
+    f64 PacketCounter::getReceivedPacketsPerSecond() const
+    {
+        f64 time = getElapsedTime();
+        return (0.0<time)? receivedPackets_/time : 0.0;
+    }
+
+    f64 PacketCounter::getSentPacketsPerSecond() const
+    {
+        f64 time = getElapsedTime();
+        return (0.0<time)? sentPackets_/time : 0.0;
+    }
 }
@@ -250,13 +250,13 @@ namespace lcore
         pthread_mutex_lock(&lock_);
         state_ = 1;
 
+        //ロック中に起こす. 待っていた側が戻ってすぐ破棄してもよいように
         if(manualReset_){
-            pthread_mutex_unlock(&lock_);
             pthread_cond_broadcast(&condVariable_);
         }else{
-            pthread_mutex_unlock(&lock_);
             pthread_cond_signal(&condVariable_);
         }
+        pthread_mutex_unlock(&lock_);
     }
 
     void Event::reset()
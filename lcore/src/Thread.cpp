@@ -908,6 +908,74 @@ namespace lcore
         jobSemaphore_.release(1);
     }
 
+    //----------------------------------------------------
+    //---
+    //--- parallelFor
+    //---
+    //----------------------------------------------------
+namespace
+{
+    struct ParallelForJob
+    {
+        ParallelForJob()
+            :finished_(true, false)
+        {}
+
+        ParallelForProc proc_;
+        void* data_;
+        s32 count_;
+        s32 next_;
+        s32 running_; ///< 呼び出したスレッドを含む
+        Event finished_; ///< 最後に終わったスレッドが立てる
+    };
+
+    void processItems(ParallelForJob& job)
+    {
+        for(;;){
+            s32 index = atomicIncrement(job.next_)-1;
+            if(job.count_<=index){
+                break;
+            }
+            job.proc_(job.data_, static_cast<u32>(index));
+        }
+    }
+
+    void parallelForProc(u32 /*threadId*/, s32 /*jobId*/, void* data)
+    {
+        ParallelForJob& job = *reinterpret_cast<ParallelForJob*>(data);
+        processItems(job);
+        if(0 == atomicDecrement(job.running_)){
+            job.finished_.set();
+        }
+    }
+}
+
+    void parallelFor(ThreadPool* threadPool, ParallelForProc proc, void* data, u32 count)
+    {
+        LASSERT(NULL != proc);
+        ParallelForJob job;
+        job.proc_ = proc;
+        job.data_ = data;
+        job.count_ = static_cast<s32>(count);
+        job.next_ = 0;
+        job.running_ = 1;
+        if(NULL != threadPool){
+            s32 numJobs = minimum(threadPool->getNumMaxThreads(), job.count_-1);
+            for(s32 i=0; i<numJobs; ++i){
+                atomicIncrement(job.running_);
+                if(ThreadPool::InvalidJobId == threadPool->add(parallelForProc, &job)){
+                    atomicDecrement(job.running_);
+                    break;
+                }
+            }
+        }
+        //呼び出したスレッドも処理する
+        processItems(job);
+        if(0 != atomicDecrement(job.running_)){
+            job.finished_.wait(thread::Infinite);
+        }
+    }
+
     //----------------------------------------------------
     //---
     //--- ThreadAffinity
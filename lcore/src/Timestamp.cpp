@@ -0,0 +1,240 @@
+/**
+@file Timestamp.cpp
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "Timestamp.h"
+#include "SyncObject.h"
+
+#if defined(_WIN32)
+#if !defined(WIN32_LEAN_AND_MEAN)
+#define WIN32_LEAN_AND_MEAN
+#endif //WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace lcore
+{
+namespace
+{
+    static const s32 DriftIterations = 20000;
+    static const s32 MaxDriftCPUs = 64;
+    static const s32 NumCalibrations = 3;
+
+    struct DriftContext
+    {
+        volatile s32 lock_;
+        volatile s32 ready_;
+        u64 last_;
+        u64 maxDrift_;
+        s32 iterations_;
+    };
+
+    struct DriftThread
+    {
+        DriftContext* context_;
+        s32 cpu_;
+    };
+
+    void pinCurrentThread(s32 cpu)
+    {
+#if defined(_WIN32)
+        SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1)<<cpu);
+#elif defined(__linux__)
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        CPU_SET(cpu, &cpuSet);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuSet);
+#endif
+    }
+
+    void runDrift(DriftThread& thread)
+    {
+#if defined(LCORE_CPU_X86)
+        DriftContext& context = *thread.context_;
+        pinCurrentThread(thread.cpu_);
+
+        //Start both at the same time
+        atomicIncrement(context.ready_);
+        while(atomicLoad(context.ready_)<2){
+        }
+
+        for(s32 i=0; i<context.iterations_; ++i){
+            while(0 != atomicCompareExchange(context.lock_, 1, 0)){
+            }
+            _mm_lfence();
+            u64 t = rdtsc();
+            if(t<context.last_ && context.maxDrift_<(context.last_-t)){
+                context.maxDrift_ = context.last_-t;
+            }
+            context.last_ = t;
+            atomicStore(context.lock_, 0);
+        }
+#endif
+    }
+
+#if defined(_WIN32)
+    DWORD WINAPI driftProc(LPVOID data)
+    {
+        runDrift(*reinterpret_cast<DriftThread*>(data));
+        return 0;
+    }
+#else
+    void* driftProc(void* data)
+    {
+        runDrift(*reinterpret_cast<DriftThread*>(data));
+        return NULL;
+    }
+#endif
+
+    bool runDriftPair(DriftThread threads[2])
+    {
+#if defined(_WIN32)
+        HANDLE handles[2];
+        for(s32 i=0; i<2; ++i){
+            handles[i] = CreateThread(NULL, 0, driftProc, &threads[i], 0, NULL);
+            if(NULL == handles[i]){
+                if(0<i){
+                    //Release the waiting one
+                    atomicIncrement(threads[0].context_->ready_);
+                    WaitForSingleObject(handles[0], INFINITE);
+                    CloseHandle(handles[0]);
+                }
+                return false;
+            }
+        }
+        WaitForMultipleObjects(2, handles, TRUE, INFINITE);
+        CloseHandle(handles[0]);
+        CloseHandle(handles[1]);
+        return true;
+#else
+        pthread_t handles[2];
+        for(s32 i=0; i<2; ++i){
+            if(0 != pthread_create(&handles[i], NULL, driftProc, &threads[i])){
+                if(0<i){
+                    atomicIncrement(threads[0].context_->ready_);
+                    pthread_join(handles[0], NULL);
+                }
+                return false;
+            }
+        }
+        pthread_join(handles[0], NULL);
+        pthread_join(handles[1], NULL);
+        return true;
+#endif
+    }
+}
+
+    bool Timestamp::tsc_ = false;
+    bool Timestamp::rdtscp_ = false;
+    u64 Timestamp::frequency_ = 0;
+    u64 Timestamp::nanoSecondsMultiplier_ = 0;
+    f64 Timestamp::invFrequency_ = 0.0;
+    u64 Timestamp::maxDrift_ = 0;
+
+    bool Timestamp::initialize(bool checkDrift)
+    {
+        tsc_ = false;
+        rdtscp_ = false;
+        maxDrift_ = 0;
+        setFrequency(static_cast<u64>(getPerformanceFrequency()));
+
+#if defined(LCORE_CPU_X86)
+        if(!isInvariantTSC()){
+            return false;
+        }
+        u64 frequency = getTSCFrequencyFromCPUID();
+        if(0 == frequency){
+            frequency = calibrate(DefaultCalibrationMilliSeconds);
+        }
+        if(0 == frequency){
+            return false;
+        }
+        if(checkDrift){
+            maxDrift_ = measureDrift(DriftIterations);
+            u64 tolerance = frequency * DefaultDriftToleranceNanoSeconds / 1000000000ULL;
+            if(tolerance<maxDrift_){
+                return false;
+            }
+        }
+        tsc_ = true;
+        rdtscp_ = isSupportRDTSCP();
+        setFrequency(frequency);
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    u64 Timestamp::measureDrift(s32 iterations)
+    {
+#if defined(LCORE_CPU_X86)
+        s32 numCPUs = minimum(static_cast<s32>(getLogicalCPUCount()), MaxDriftCPUs);
+        u64 maxDrift = 0;
+        for(s32 i=1; i<numCPUs; ++i){
+            DriftContext context;
+            context.lock_ = 0;
+            context.ready_ = 0;
+            context.last_ = 0;
+            context.maxDrift_ = 0;
+            context.iterations_ = iterations;
+
+            DriftThread threads[2];
+            threads[0].context_ = &context;
+            threads[0].cpu_ = 0;
+            threads[1].context_ = &context;
+            threads[1].cpu_ = i;
+            if(!runDriftPair(threads)){
+                break;
+            }
+            maxDrift = maximum(maxDrift, context.maxDrift_);
+        }
+        return maxDrift;
+#else
+        return 0;
+#endif
+    }
+
+    u64 Timestamp::calibrate(s32 milliSeconds)
+    {
+#if defined(LCORE_CPU_X86)
+        ClockType clockFrequency = getPerformanceFrequency();
+        u64 minTicks = static_cast<u64>(clockFrequency) * milliSeconds / 1000;
+        u64 frequencies[NumCalibrations];
+        for(s32 i=0; i<NumCalibrations; ++i){
+            ClockType clock0 = getPerformanceCounter();
+            u64 tsc0 = rdtsc();
+            ClockType clock1;
+            do{
+                clock1 = getPerformanceCounter();
+            }while(static_cast<u64>(clock1-clock0)<minTicks);
+            u64 tsc1 = rdtsc();
+            frequencies[i] = static_cast<u64>(static_cast<f64>(tsc1-tsc0) * clockFrequency / static_cast<f64>(clock1-clock0));
+        }
+        //Median
+        for(s32 i=1; i<NumCalibrations; ++i){
+            for(s32 j=i; 0<j && frequencies[j]<frequencies[j-1]; --j){
+                lcore::swap(frequencies[j], frequencies[j-1]);
+            }
+        }
+        return frequencies[NumCalibrations/2];
+#else
+        return 0;
+#endif
+    }
+
+    void Timestamp::setFrequency(u64 frequency)
+    {
+        frequency_ = frequency;
+        if(0 == frequency){
+            nanoSecondsMultiplier_ = 0;
+            invFrequency_ = 0.0;
+            return;
+        }
+        nanoSecondsMultiplier_ = (1000000000ULL<<32)/frequency;
+        invFrequency_ = 1.0/static_cast<f64>(frequency);
+    }
+}
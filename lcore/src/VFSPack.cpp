@@ -20,6 +20,7 @@
 #include "LString.h"
 #include "Random.h"
 #include "xxHash.h"
+#include "Cryptography.h"
 
 namespace lcore
 {
@@ -245,7 +246,7 @@ namespace
         bool traverse(const Char* root);
         bool traverseDirectory(Entry* rootEntry);
 
-        bool write(const Char* filepath);
+        bool write(const Char* filepath, const AESContext* cipher);
     private:
         typedef Array<Entry*> EntryArray;
         bool createNextPath(String& path, const Char* parentPath, const Char* name);
@@ -435,9 +436,10 @@ namespace
         return true;
     }
 
-    bool Traversal::write(const Char* filepath)
+    bool Traversal::write(const Char* filepath, const AESContext* cipher)
     {
         LASSERT(NULL != filepath);
+        LASSERT(NULL == cipher || AES::Mode_CTR == cipher->mode_);
 
         HANDLE handle = CreateFile(
             filepath,
@@ -456,6 +458,7 @@ namespace
 
             header.signature_ = VFSPackSignature;
             cryptRandom(sizeof(header.reserved_), &header.reserved_);
+            cryptRandom(sizeof(header.nonce_), &header.nonce_);
             header.numEntries_ = entries_.size();
             header.offsetString_ = sizeof(VFSPackHeader) + sizeof(VFSData)*entries_.size();
 
@@ -466,6 +469,9 @@ namespace
             for(s32 i=0; i<entries_.size(); ++i){
                 data[i].file_.type_ = entries_[i]->getType();
                 data[i].file_.flags_ = entries_[i]->getFlags();
+                if(NULL != cipher && fs::Type_File == entries_[i]->getType()){
+                    data[i].file_.flags_ |= fs::Descriptor::Flag_Encrypted;
+                }
                 data[i].file_.nameOffset_ = stringBuffer.length();
                 data[i].file_.nameLength_ = entries_[i]->getNameLength();
 
@@ -547,6 +553,14 @@ namespace
                     result = false;
                     break;
                 }
+                if(NULL != cipher){
+                    //pbN̈ʒuXg[̈ʒuɂāAǂޑCӂ͈̔͂𕜍ł悤ɂ
+                    static const s64 MaxChunkSize = 0x40000000;
+                    for(s64 j=0; j<size.QuadPart; j+=MaxChunkSize){
+                        s32 chunkSize = static_cast<s32>(lcore::minimum(size.QuadPart-j, MaxChunkSize));
+                        AES::ctr(*cipher, buffer+j, buffer+j, chunkSize, static_cast<u64>(data[i].file_.dataOffset_+j), header.getNonce());
+                    }
+                }
                 if(!File::write(scopedHandle.handle_, size.QuadPart, buffer)){
                     result = false;
                     break;
@@ -608,7 +622,7 @@ namespace
 }
 
     //--------------------------------------------------------------------------
-    bool writeVFSPack(const Char* filepath, const Char* root)
+    bool writeVFSPack(const Char* filepath, const Char* root, const AESContext* cipher)
     {
         LASSERT(NULL != filepath);
         LASSERT(NULL != root);
@@ -617,13 +631,14 @@ namespace
         if(!traversal.traverse(root)){
             return false;
         }
-        return traversal.write(filepath);
+        return traversal.write(filepath, cipher);
     }
 
     //-------------------------------------------------------------------------
-    bool readVFSPack(VFSPack& pack, const Char* filepath, bool checkHash)
+    bool readVFSPack(VFSPack& pack, const Char* filepath, bool checkHash, const AESContext* cipher)
     {
         LASSERT(NULL != filepath);
+        LASSERT(NULL == cipher || AES::Mode_CTR == cipher->mode_);
         lcore::memset(&pack, 0, sizeof(VFSPack));
 
         HANDLE h = CreateFile(
@@ -757,6 +772,14 @@ namespace
                     false,
                     true);
                 ++count;
+                if(0 != (vfsData.file_.flags_ & fs::Descriptor::Flag_Encrypted)){
+                    if(NULL == cipher){
+                        i = header.numEntries_-1;
+                        result = false;
+                        break;
+                    }
+                    file->setCipher(cipher, header.getNonce());
+                }
             }
                 break;
             case fs::Type_Directory:
@@ -510,6 +510,11 @@ namespace lcore
         return File::write(handle_, offset, size, data);
     }
 
+    AsyncIO::RequestID FileProxyOS::readAsync(AsyncIO& asyncIO, s64 offset, s64 size, void* data, s32 priority, AsyncIO::Callback callback, void* userData)
+    {
+        return asyncIO.read(handle_, offset, size, data, priority, callback, userData);
+    }
+
     bool FileProxyOS::thisParent(VirtualFileSystemBase* vfs) const
     {
         return static_cast<VirtualFileSystemBase*>(parent_) == vfs;
@@ -0,0 +1,28 @@
+﻿#ifndef INC_LCORE_TEST_RECTPACKUTIL_H_
+#define INC_LCORE_TEST_RECTPACKUTIL_H_
+/**
+@file RectPackUtil.h
+@author t-sakai
+@date 2026/10/19 create
+
+TestRectPackとBenchRectPackで共有する入力の生成。
+*/
+#include "Random.h"
+#include "RectPack.h"
+
+namespace lcore
+{
+    /// 辺の長さが[minSize, maxSize]の乱数で決まる矩形を作る
+    inline void randomRects(s32 numRects, RectPackRect* rects, u32 seed, s32 minSize, s32 maxSize)
+    {
+        RandXorshift128Plus32 random(seed);
+        for(s32 i=0; i<numRects; ++i){
+            rects[i].ID() = i;
+            rects[i].X() = 0;
+            rects[i].Y() = 0;
+            rects[i].W() = static_cast<u16>(range_rclose(random, minSize, maxSize));
+            rects[i].H() = static_cast<u16>(range_rclose(random, minSize, maxSize));
+        }
+    }
+}
+#endif //INC_LCORE_TEST_RECTPACKUTIL_H_
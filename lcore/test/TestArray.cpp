@@ -36,6 +36,49 @@ namespace
         s32 value_;
     };
 
+    class MoveOnlyClass
+    {
+    public:
+        MoveOnlyClass()
+            :value_(NULL)
+        {}
+
+        MoveOnlyClass(s32 value0, s32 value1)
+            :value_(LNEW s32(value0+value1))
+        {}
+
+        MoveOnlyClass(MoveOnlyClass&& rhs)
+            :value_(rhs.value_)
+        {
+            rhs.value_ = NULL;
+        }
+
+        ~MoveOnlyClass()
+        {
+            LDELETE(value_);
+        }
+
+        MoveOnlyClass& operator=(MoveOnlyClass&& rhs)
+        {
+            if(this != &rhs){
+                LDELETE(value_);
+                value_ = rhs.value_;
+                rhs.value_ = NULL;
+            }
+            return *this;
+        }
+
+        s32 get() const
+        {
+            return (NULL == value_)? -1 : *value_;
+        }
+    private:
+        MoveOnlyClass(const MoveOnlyClass&) = delete;
+        MoveOnlyClass& operator=(const MoveOnlyClass&) = delete;
+
+        s32* value_;
+    };
+
     struct AllocStats
     {
         size_t allocated_;
@@ -222,4 +265,35 @@ namespace
             EXPECT_EQ(array[i], expects[i+1]);
         }
     }
+
+    TEST_CASE("TestArray::TestMoveOnlyArray")
+    {
+        const s32 NumSamples = 127;
+        Array<MoveOnlyClass> array;
+
+        //Emplace back, and move on expand
+        for(s32 i=0; i<NumSamples; ++i){
+            array.emplace_back(i, 1);
+        }
+        EXPECT_TRUE(array.size() == NumSamples);
+        EXPECT_TRUE(array.capacity() == 128);
+        for(s32 i=0; i<NumSamples; ++i){
+            EXPECT_TRUE(array[i].get() == i+1);
+        }
+
+        //Push back rvalue
+        array.push_back(MoveOnlyClass(NumSamples, 1));
+        array.push_back(MoveOnlyClass(NumSamples+1, 1));
+        EXPECT_TRUE(array.size() == NumSamples+2);
+        EXPECT_TRUE(array.capacity() == 144);
+        for(s32 i=0; i<array.size(); ++i){
+            EXPECT_TRUE(array[i].get() == i+1);
+        }
+
+        //Remove at
+        array.removeAt(0);
+        for(s32 i=0; i<array.size(); ++i){
+            EXPECT_TRUE(array[i].get() == i+2);
+        }
+    }
 }
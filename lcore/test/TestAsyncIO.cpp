@@ -0,0 +1,236 @@
+﻿#include <catch_wrap.hpp>
+#include <stdio.h>
+#include "AsyncIO.h"
+#include "File.h"
+#include "VirtualFileSystem.h"
+
+namespace lcore
+{
+    namespace
+    {
+        static const Char* Filename = "TestAsyncIO.bin";
+        static const s32 FileSize = 64*1024 + 123;
+        static const AsyncIO::RequestID InvalidID = AsyncIO::InvalidID;
+
+        inline u8 valueAt(s64 offset)
+        {
+            return static_cast<u8>((offset*7) ^ (offset>>8));
+        }
+
+        bool writeTestFile()
+        {
+            u8* data = LNEW u8[FileSize];
+            for(s32 i=0; i<FileSize; ++i){
+                data[i] = valueAt(i);
+            }
+            File file;
+            bool result = file.open(Filename, ios::out) && file.write(FileSize, data);
+            file.close();
+            LDELETE_ARRAY(data);
+            return result;
+        }
+
+        bool check(s64 offset, s64 size, const u8* data)
+        {
+            for(s64 i=0; i<size; ++i){
+                if(valueAt(offset+i) != data[i]){
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        struct Order
+        {
+            s32 count_;
+            s32 order_[8];
+        };
+
+        void orderCallback(AsyncIO::RequestID, s32 status, void* userData)
+        {
+            Order* order = reinterpret_cast<Order*>(userData);
+            order->order_[order->count_++] = status;
+        }
+
+        struct Chain
+        {
+            AsyncIO* asyncIO_;
+            AsyncIO::Handle handle_;
+            s32 remain_;
+            s32 numDone_;
+            u8 buffer_[256];
+        };
+
+        //コールバックから次の要求を出す
+        void chainCallback(AsyncIO::RequestID, s32 status, void* userData)
+        {
+            Chain* chain = reinterpret_cast<Chain*>(userData);
+            if(AsyncIO::Status_Done == status && check(chain->numDone_*256, 256, chain->buffer_)){
+                ++chain->numDone_;
+            }
+            if(0 < --chain->remain_){
+                chain->asyncIO_->read(chain->handle_, chain->numDone_*256, 256, chain->buffer_, AsyncIO::Priority_Normal, chainCallback, chain);
+            }
+        }
+
+        void testBackend(bool disableIOUring)
+        {
+            AsyncIO::Param param;
+            AsyncIO::getDefaultParam(param);
+            param.maxInFlight_ = 4;
+            param.disableIOUring_ = disableIOUring;
+
+            AsyncIO asyncIO;
+            CHECK(asyncIO.initialize(param));
+            CHECK(AsyncIO::Backend_None != asyncIO.getBackend());
+            if(disableIOUring){
+                EXPECT_TRUE(AsyncIO::Backend_Thread == asyncIO.getBackend());
+            }
+
+            AsyncIO::Handle handle = AsyncIO::openFile(Filename);
+            CHECK(AsyncIO::InvalidHandle != handle);
+
+            //単一
+            u8* buffer = LNEW u8[FileSize];
+            AsyncIO::RequestID id = asyncIO.read(handle, 0, FileSize, buffer);
+            CHECK(InvalidID != id);
+            EXPECT_TRUE(AsyncIO::Status_Done == asyncIO.complete(id));
+            EXPECT_TRUE(check(0, FileSize, buffer));
+            EXPECT_TRUE(AsyncIO::Status_Invalid == asyncIO.getStatus(id));
+            EXPECT_TRUE(AsyncIO::Status_Invalid == asyncIO.complete(id));
+
+            //分散. 空のセグメントを含む
+            u8 scatter[5][1000];
+            AsyncIO::Segment segments[5] = {
+                {FileSize-1000, 1000, scatter[0]},
+                {0, 0, NULL},
+                {10, 1000, scatter[1]},
+                {30000, 1000, scatter[2]},
+                {4095, 1000, scatter[3]},
+            };
+            id = asyncIO.read(handle, 5, segments, AsyncIO::Priority_High);
+            EXPECT_TRUE(AsyncIO::Status_Done == asyncIO.complete(id));
+            EXPECT_TRUE(check(FileSize-1000, 1000, scatter[0]));
+            EXPECT_TRUE(check(10, 1000, scatter[1]));
+            EXPECT_TRUE(check(30000, 1000, scatter[2]));
+            EXPECT_TRUE(check(4095, 1000, scatter[3]));
+
+            //終端を越える
+            id = asyncIO.read(handle, FileSize-10, 20, scatter[4]);
+            EXPECT_TRUE(AsyncIO::Status_Error == asyncIO.complete(id));
+
+            //発行数の上限を越える要求. 優先度の高い方から発行される
+            static const s32 NumRequests = 32;
+            AsyncIO::RequestID ids[NumRequests];
+            for(s32 i=0; i<NumRequests; ++i){
+                ids[i] = asyncIO.read(handle, i*1024, 1024, buffer+i*1024, i%AsyncIO::Priority_Num);
+                CHECK(InvalidID != ids[i]);
+                EXPECT_TRUE(asyncIO.getNumInFlight() <= 4);
+            }
+            for(s32 i=NumRequests-1; 0<=i; --i){
+                EXPECT_TRUE(AsyncIO::Status_Done == asyncIO.complete(ids[i]));
+            }
+            lcore::memset(buffer, 0, FileSize);
+
+            //コールバックのない要求もpollで数える
+            id = asyncIO.read(handle, 0, 256, buffer);
+            s32 numCompleted = 0;
+            while(asyncIO.getStatus(id)<AsyncIO::Status_Done){
+                numCompleted += asyncIO.poll();
+            }
+            EXPECT_TRUE(1 == numCompleted);
+            EXPECT_TRUE(AsyncIO::Status_Done == asyncIO.complete(id));
+
+            //コールバック. 空の要求は次のpollで通知
+            Order order = {};
+            AsyncIO::Segment empty = {0, 0, NULL};
+            asyncIO.read(handle, 1, &empty, AsyncIO::Priority_Low, orderCallback, &order);
+            EXPECT_TRUE(0 == order.count_);
+            EXPECT_TRUE(1 == asyncIO.poll());
+            EXPECT_TRUE(1 == order.count_);
+            EXPECT_TRUE(AsyncIO::Status_Done == order.order_[0]);
+
+            Chain chain;
+            chain.asyncIO_ = &asyncIO;
+            chain.handle_ = handle;
+            chain.remain_ = 16;
+            chain.numDone_ = 0;
+            asyncIO.read(handle, 0, 256, chain.buffer_, AsyncIO::Priority_Normal, chainCallback, &chain);
+            asyncIO.completeAll();
+            EXPECT_TRUE(0 == chain.remain_);
+            EXPECT_TRUE(16 == chain.numDone_);
+            EXPECT_TRUE(0 == asyncIO.getNumInFlight());
+
+            LDELETE_ARRAY(buffer);
+            AsyncIO::closeFile(handle);
+            asyncIO.terminate();
+        }
+    }
+
+    TEST_CASE("TestAsyncIO::Thread")
+    {
+        CHECK(writeTestFile());
+        testBackend(true);
+        ::remove(Filename);
+    }
+
+    TEST_CASE("TestAsyncIO::Default")
+    {
+        CHECK(writeTestFile());
+        testBackend(false);
+        ::remove(Filename);
+    }
+
+    TEST_CASE("TestAsyncIO::Capacity")
+    {
+        CHECK(writeTestFile());
+        AsyncIO::Param param;
+        AsyncIO::getDefaultParam(param);
+        param.maxRequests_ = 2;
+        AsyncIO asyncIO;
+        CHECK(asyncIO.initialize(param));
+        AsyncIO::Handle handle = AsyncIO::openFile(Filename);
+        u8 buffer[3][16];
+        AsyncIO::RequestID id0 = asyncIO.read(handle, 0, 16, buffer[0]);
+        AsyncIO::RequestID id1 = asyncIO.read(handle, 16, 16, buffer[1]);
+        CHECK(InvalidID != id1);
+        EXPECT_TRUE(InvalidID == asyncIO.read(handle, 32, 16, buffer[2]));
+        EXPECT_TRUE(AsyncIO::Status_Done == asyncIO.complete(id0));
+        AsyncIO::RequestID id2 = asyncIO.read(handle, 32, 16, buffer[2]);
+        //解放した要求のIDは再利用されない
+        EXPECT_TRUE(id0 != id2);
+        EXPECT_TRUE(AsyncIO::Status_Invalid == asyncIO.getStatus(id0));
+        EXPECT_TRUE(AsyncIO::Status_Done == asyncIO.complete(id1));
+        EXPECT_TRUE(AsyncIO::Status_Done == asyncIO.complete(id2));
+        EXPECT_TRUE(check(0, 16, buffer[0]));
+        EXPECT_TRUE(check(16, 16, buffer[1]));
+        EXPECT_TRUE(check(32, 16, buffer[2]));
+        AsyncIO::closeFile(handle);
+        asyncIO.terminate();
+        ::remove(Filename);
+    }
+
+#if defined(_WIN32)
+    TEST_CASE("TestAsyncIO::FileProxyOS")
+    {
+        AsyncIO::Param param;
+        AsyncIO::getDefaultParam(param);
+        AsyncIO asyncIO;
+        CHECK(asyncIO.initialize(param));
+
+        //VFSで開いたハンドルのまま読む
+        VirtualFileSystemOS vfs("data");
+        FileProxyOS* file = static_cast<FileProxyOS*>(vfs.openFile("file00.txt"));
+        CHECK(NULL != file);
+        u8 expected[8];
+        u8 buffer[6];
+        CHECK(file->read(0, sizeof(expected), expected));
+        AsyncIO::RequestID id = file->readAsync(asyncIO, 2, sizeof(buffer), buffer);
+        CHECK(InvalidID != id);
+        EXPECT_TRUE(AsyncIO::Status_Done == asyncIO.complete(id));
+        EXPECT_TRUE(0 == lcore::memcmp(expected+2, buffer, sizeof(buffer)));
+        vfs.closeFile(file);
+        asyncIO.terminate();
+    }
+#endif
+}
@@ -0,0 +1,242 @@
+#include <catch_wrap.hpp>
+#include <map>
+#include "Random.h"
+#include "BTree.h"
+
+namespace lcore
+{
+    namespace
+    {
+        static const s32 NumSamples = 16*1024;
+#ifdef _DEBUG
+        static const s32 SpeedSamples = NumSamples;
+#else
+        static const s32 SpeedSamples = 1000*1000;
+#endif
+
+        typedef BTreeMap<u32, s32> BTreeMapU32;
+
+        struct SumFunc
+        {
+            SumFunc()
+                :count_(0)
+                ,sum_(0)
+                ,ordered_(true)
+                ,last_(0)
+            {}
+
+            void operator()(const u32& key, s32& value)
+            {
+                if(0<count_ && key<=last_){
+                    ordered_ = false;
+                }
+                last_ = key;
+                sum_ += value;
+                ++count_;
+            }
+
+            s32 count_;
+            s64 sum_;
+            bool ordered_;
+            u32 last_;
+        };
+
+        template<class Map>
+        bool compare(Map& map, std::map<u32, s32>& reference)
+        {
+            if(map.size() != static_cast<s32>(reference.size())){
+                return false;
+            }
+            typename Map::iterator itr = map.begin();
+            for(std::map<u32, s32>::iterator ref = reference.begin(); ref != reference.end(); ++ref, ++itr){
+                if(itr == map.end() || itr.getKey() != ref->first || itr.getValue() != ref->second){
+                    return false;
+                }
+            }
+            return itr == map.end();
+        }
+    }
+
+    TEST_CASE("TestBTree::InsertErase")
+    {
+        RandXorshift128Plus32 random;
+        random.srand(12345);
+
+        BTreeMapU32 map;
+        std::map<u32, s32> reference;
+        EXPECT_TRUE(-1 == map.getHeight());
+        EXPECT_TRUE(map.check());
+
+        for(s32 i=0; i<NumSamples; ++i){
+            u32 key = random.rand()%(NumSamples*2);
+            bool inserted = reference.insert(std::make_pair(key, i)).second;
+            EXPECT_TRUE(inserted == map.insert(key, i));
+        }
+        EXPECT_TRUE(map.check());
+        EXPECT_TRUE(compare(map, reference));
+        LOG_INFO("BTree height: " << map.getHeight() << ", leaf capacity: " << BTreeMapU32::LeafCapacity << ", internal capacity: " << BTreeMapU32::InternalCapacity);
+
+        for(u32 key=0; key<NumSamples*2; ++key){
+            std::map<u32, s32>::iterator ref = reference.find(key);
+            s32* value = map.find(key);
+            if(ref == reference.end()){
+                EXPECT_TRUE(NULL == value);
+            }else{
+                EXPECT_TRUE(NULL != value);
+                EXPECT_TRUE(ref->second == *value);
+            }
+        }
+
+        for(s32 i=0; i<NumSamples; ++i){
+            u32 key = random.rand()%(NumSamples*2);
+            bool erased = (0<reference.erase(key));
+            EXPECT_TRUE(erased == map.erase(key));
+            if(0 == (i&1023)){
+                EXPECT_TRUE(map.check());
+            }
+        }
+        EXPECT_TRUE(map.check());
+        EXPECT_TRUE(compare(map, reference));
+
+        for(std::map<u32, s32>::iterator ref = reference.begin(); ref != reference.end(); ++ref){
+            EXPECT_TRUE(map.erase(ref->first));
+        }
+        EXPECT_TRUE(0 == map.size());
+        EXPECT_TRUE(-1 == map.getHeight());
+        EXPECT_TRUE(map.check());
+    }
+
+    TEST_CASE("TestBTree::BulkLoad")
+    {
+        static const s32 Fills[] = {1, 7, BTreeMapU32::LeafCapacity};
+        u32* keys = LNEW u32[NumSamples];
+        s32* values = LNEW s32[NumSamples];
+        for(s32 i=0; i<NumSamples; ++i){
+            keys[i] = static_cast<u32>(i*3);
+            values[i] = i;
+        }
+
+        for(s32 f=0; f<static_cast<s32>(sizeof(Fills)/sizeof(Fills[0])); ++f){
+            for(s32 count=0; count<NumSamples; count = count*2+1){
+                BTreeMapU32 map;
+                map.bulkLoad(keys, values, count, Fills[f]);
+                EXPECT_TRUE(count == map.size());
+                EXPECT_TRUE(map.check());
+            }
+            BTreeMapU32 map;
+            map.bulkLoad(keys, values, NumSamples, Fills[f]);
+            EXPECT_TRUE(map.check());
+
+            //Still updatable after loading
+            for(s32 i=0; i<NumSamples; i+=2){
+                EXPECT_TRUE(map.insert(keys[i]+1, -i));
+                EXPECT_TRUE(map.erase(keys[i+1]));
+            }
+            EXPECT_TRUE(map.check());
+        }
+
+        LDELETE_ARRAY(values);
+        LDELETE_ARRAY(keys);
+    }
+
+    TEST_CASE("TestBTree::Range")
+    {
+        BTreeMapU32 map;
+        for(s32 i=0; i<NumSamples; ++i){
+            map.insert(static_cast<u32>(i*2), i);
+        }
+
+        BTreeMapU32::iterator itr = map.lowerBound(101);
+        EXPECT_TRUE(102 == itr.getKey());
+        itr = map.lowerBound(102);
+        EXPECT_TRUE(102 == itr.getKey());
+        itr = map.upperBound(102);
+        EXPECT_TRUE(104 == itr.getKey());
+        EXPECT_TRUE(map.lowerBound(NumSamples*2) == map.end());
+        EXPECT_TRUE(map.upperBound(NumSamples*2-2) == map.end());
+
+        SumFunc func;
+        s32 count = map.traverse(1000, 3000, func);
+        EXPECT_TRUE(1000 == count);
+        EXPECT_TRUE(func.ordered_);
+        s64 sum = 0;
+        for(s32 i=500; i<1500; ++i){
+            sum += i;
+        }
+        EXPECT_TRUE(sum == func.sum_);
+    }
+
+    TEST_CASE("TestBTree::Float")
+    {
+        BTreeMap<f32, s32> map;
+        RandXorshift128Plus32 random;
+        random.srand(67890);
+        std::map<f32, s32> reference;
+        for(s32 i=0; i<NumSamples; ++i){
+            f32 key = random.frand2()*2.0f - 1.0f;
+            EXPECT_TRUE(reference.insert(std::make_pair(key, i)).second == map.insert(key, i));
+        }
+        EXPECT_TRUE(map.check());
+        BTreeMap<f32, s32>::iterator itr = map.lowerBound(0.0f);
+        std::map<f32, s32>::iterator ref = reference.lower_bound(0.0f);
+        EXPECT_TRUE(ref->first == itr.getKey());
+        EXPECT_TRUE(ref->second == itr.getValue());
+    }
+
+    TEST_CASE("TestBTree::Speed")
+    {
+        RandXorshift128Plus32 random;
+        random.srand(13579);
+        u32* keys = LNEW u32[SpeedSamples];
+        for(s32 i=0; i<SpeedSamples; ++i){
+            keys[i] = random.rand();
+        }
+
+        {
+            BTreeMapU32 map;
+            ClockType start = getPerformanceCounter();
+            for(s32 i=0; i<SpeedSamples; ++i){
+                map.insert(keys[i], i);
+            }
+            f64 insertTime = calcTime64(start, getPerformanceCounter());
+
+            s64 sum = 0;
+            start = getPerformanceCounter();
+            for(s32 i=0; i<SpeedSamples; ++i){
+                sum += *map.find(keys[i]);
+            }
+            f64 findTime = calcTime64(start, getPerformanceCounter());
+
+            start = getPerformanceCounter();
+            for(BTreeMapU32::iterator itr = map.begin(); itr != map.end(); ++itr){
+                sum += itr.getValue();
+            }
+            f64 iterateTime = calcTime64(start, getPerformanceCounter());
+            LOG_INFO("BTreeMap insert: " << insertTime << " find: " << findTime << " iterate: " << iterateTime << " (" << sum << ")");
+        }
+
+        {
+            std::map<u32, s32> map;
+            ClockType start = getPerformanceCounter();
+            for(s32 i=0; i<SpeedSamples; ++i){
+                map.insert(std::make_pair(keys[i], i));
+            }
+            f64 insertTime = calcTime64(start, getPerformanceCounter());
+
+            s64 sum = 0;
+            start = getPerformanceCounter();
+            for(s32 i=0; i<SpeedSamples; ++i){
+                sum += map.find(keys[i])->second;
+            }
+            f64 findTime = calcTime64(start, getPerformanceCounter());
+
+            start = getPerformanceCounter();
+            for(std::map<u32, s32>::iterator itr = map.begin(); itr != map.end(); ++itr){
+                sum += itr->second;
+            }
+            f64 iterateTime = calcTime64(start, getPerformanceCounter());
+            LOG_INFO("std::map insert: " << insertTime << " find: " << findTime << " iterate: " << iterateTime << " (" << sum << ")");
+        }
+        LDELETE_ARRAY(keys);
+    }
+}
@@ -0,0 +1,263 @@
+﻿#include <catch_wrap.hpp>
+#include "lcore.h"
+#include "Cryptography.h"
+#include "Random.h"
+#include "Thread.h"
+
+namespace lcore
+{
+    namespace
+    {
+        //FIPS-197 C.1, C.3
+        const u8 Key128[] = {0x00,0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,0x09,0x0a,0x0b,0x0c,0x0d,0x0e,0x0f};
+        const u8 Key256[] = {
+            0x00,0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,0x09,0x0a,0x0b,0x0c,0x0d,0x0e,0x0f,
+            0x10,0x11,0x12,0x13,0x14,0x15,0x16,0x17,0x18,0x19,0x1a,0x1b,0x1c,0x1d,0x1e,0x1f};
+        const u8 Plain[] = {0x00,0x11,0x22,0x33,0x44,0x55,0x66,0x77,0x88,0x99,0xaa,0xbb,0xcc,0xdd,0xee,0xff};
+        const u8 Cipher128[] = {0x69,0xc4,0xe0,0xd8,0x6a,0x7b,0x04,0x30,0xd8,0xcd,0xb7,0x80,0x70,0xb4,0xc5,0x5a};
+        const u8 Cipher256[] = {0x8e,0xa2,0xb7,0xca,0x51,0x67,0x45,0xbf,0xea,0xfc,0x49,0x90,0x4b,0x49,0x60,0x89};
+
+        //SP800-38A F.2.1, F.5.1
+        const u8 SPKey[] = {0x2b,0x7e,0x15,0x16,0x28,0xae,0xd2,0xa6,0xab,0xf7,0x15,0x88,0x09,0xcf,0x4f,0x3c};
+        const u8 SPPlain[] = {
+            0x6b,0xc1,0xbe,0xe2,0x2e,0x40,0x9f,0x96,0xe9,0x3d,0x7e,0x11,0x73,0x93,0x17,0x2a,
+            0xae,0x2d,0x8a,0x57,0x1e,0x03,0xac,0x9c,0x9e,0xb7,0x6f,0xac,0x45,0xaf,0x8e,0x51,
+            0x30,0xc8,0x1c,0x46,0xa3,0x5c,0xe4,0x11,0xe5,0xfb,0xc1,0x19,0x1a,0x0a,0x52,0xef,
+            0xf6,0x9f,0x24,0x45,0xdf,0x4f,0x9b,0x17,0xad,0x2b,0x41,0x7b,0xe6,0x6c,0x37,0x10};
+        const u8 CBCIV[] = {0x00,0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,0x09,0x0a,0x0b,0x0c,0x0d,0x0e,0x0f};
+        const u8 CBCCipher[] = {
+            0x76,0x49,0xab,0xac,0x81,0x19,0xb2,0x46,0xce,0xe9,0x8e,0x9b,0x12,0xe9,0x19,0x7d,
+            0x50,0x86,0xcb,0x9b,0x50,0x72,0x19,0xee,0x95,0xdb,0x11,0x3a,0x91,0x76,0x78,0xb2,
+            0x73,0xbe,0xd6,0xb8,0xe3,0xc1,0x74,0x3b,0x71,0x16,0xe6,0x9e,0x22,0x22,0x95,0x16,
+            0x3f,0xf1,0xca,0xa1,0x68,0x1f,0xac,0x09,0x12,0x0e,0xca,0x30,0x75,0x86,0xe1,0xa7};
+        const u8 CTRIV[] = {0xf0,0xf1,0xf2,0xf3,0xf4,0xf5,0xf6,0xf7,0xf8,0xf9,0xfa,0xfb,0xfc,0xfd,0xfe,0xff};
+        const u8 CTRCipher[] = {
+            0x87,0x4d,0x61,0x91,0xb6,0x20,0xe3,0x26,0x1b,0xef,0x68,0x64,0x99,0x0d,0xb6,0xce,
+            0x98,0x06,0xf6,0x6b,0x79,0x70,0xfd,0xff,0x86,0x17,0x18,0x7b,0xb9,0xff,0xfd,0xff,
+            0x5a,0xe4,0xdf,0x3e,0xdb,0xd5,0xd3,0x5e,0x5b,0x4f,0x09,0x02,0x0d,0xb0,0x3e,0xab,
+            0x1e,0x03,0x1d,0xda,0x2f,0xbe,0x03,0xd1,0x79,0x21,0x70,0xa0,0xf3,0x00,0x9c,0xee};
+
+        void randomBytes(s32 length, u8* bytes, u32 seed)
+        {
+            RandXorshift128Plus32 random(seed);
+            for(s32 i=0; i<length; ++i){
+                bytes[i] = static_cast<u8>(random.rand());
+            }
+        }
+    }
+
+    namespace
+    {
+        void testKnownAnswer(bool aesni)
+        {
+            u8 buffer[sizeof(SPPlain)];
+
+            AESContext ecb128(NULL, Key128, AES::Key128Bytes, AES::Mode_ECB);
+            ecb128.setHardwareAccelerated(aesni);
+            EXPECT_TRUE(aesni == ecb128.isHardwareAccelerated());
+            AES::encrypt(ecb128, buffer, Plain, sizeof(Plain));
+            EXPECT_TRUE(0 == lcore::memcmp(buffer, Cipher128, sizeof(Cipher128)));
+            AES::decrypt(ecb128, buffer, buffer, sizeof(Cipher128));
+            EXPECT_TRUE(0 == lcore::memcmp(buffer, Plain, sizeof(Plain)));
+
+            AESContext ecb256(NULL, Key256, AES::Key256Bytes, AES::Mode_ECB);
+            ecb256.setHardwareAccelerated(aesni);
+            AES::encrypt(ecb256, buffer, Plain, sizeof(Plain));
+            EXPECT_TRUE(0 == lcore::memcmp(buffer, Cipher256, sizeof(Cipher256)));
+            AES::decrypt(ecb256, buffer, buffer, sizeof(Cipher256));
+            EXPECT_TRUE(0 == lcore::memcmp(buffer, Plain, sizeof(Plain)));
+
+            AESContext cbc(CBCIV, SPKey, AES::Key128Bytes, AES::Mode_CBC);
+            cbc.setHardwareAccelerated(aesni);
+            AES::encrypt(cbc, buffer, SPPlain, sizeof(SPPlain));
+            EXPECT_TRUE(0 == lcore::memcmp(buffer, CBCCipher, sizeof(CBCCipher)));
+            AES::decrypt(cbc, buffer, buffer, sizeof(CBCCipher));
+            EXPECT_TRUE(0 == lcore::memcmp(buffer, SPPlain, sizeof(SPPlain)));
+
+            AESContext ctr(CTRIV, SPKey, AES::Key128Bytes, AES::Mode_CTR);
+            ctr.setHardwareAccelerated(aesni);
+            AES::encrypt(ctr, buffer, SPPlain, sizeof(SPPlain));
+            EXPECT_TRUE(0 == lcore::memcmp(buffer, CTRCipher, sizeof(CTRCipher)));
+            AES::decrypt(ctr, buffer, buffer, sizeof(CTRCipher));
+            EXPECT_TRUE(0 == lcore::memcmp(buffer, SPPlain, sizeof(SPPlain)));
+        }
+
+        void testBlocks(bool aesni)
+        {
+            //Long enough for the interleaved blocks and a tail
+            static const s32 Size = 16*37;
+            u8* plain = LNEW u8[Size];
+            u8* cipher = LNEW u8[Size];
+            u8* data = LNEW u8[Size];
+            randomBytes(Size, plain, 1);
+
+            //Blocks one by one
+            AESContext ecb(NULL, Key256, AES::Key256Bytes, AES::Mode_ECB);
+            ecb.setHardwareAccelerated(aesni);
+            AES::encrypt(ecb, cipher, plain, Size);
+            bool each = true;
+            for(s32 i=0; i<Size; i+=AES::BlockSizeInBytes){
+                AES::encrypt(ecb, data, plain+i, AES::BlockSizeInBytes);
+                each = each && 0 == lcore::memcmp(data, cipher+i, AES::BlockSizeInBytes);
+            }
+            EXPECT_TRUE(each);
+            AES::decrypt(ecb, data, cipher, Size);
+            EXPECT_TRUE(0 == lcore::memcmp(data, plain, Size));
+
+            AESContext cbc(CBCIV, Key128, AES::Key128Bytes, AES::Mode_CBC);
+            cbc.setHardwareAccelerated(aesni);
+            AES::encrypt(cbc, cipher, plain, Size);
+            lcore::memcpy(data, cipher, Size);
+            AES::decrypt(cbc, data, data, Size);
+            EXPECT_TRUE(0 == lcore::memcmp(data, plain, Size));
+
+            //The counter carries over 64 bits
+            const u8 IV[] = {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x01,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xfe};
+            AESContext ctr(IV, Key128, AES::Key128Bytes, AES::Mode_CTR);
+            ctr.setHardwareAccelerated(aesni);
+            AES::ctr(ctr, cipher, plain, Size);
+            u8 counter[AES::BlockSizeInBytes] = {0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x02,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x01};
+            u8 key[AES::BlockSizeInBytes];
+            AESContext ecb128(NULL, Key128, AES::Key128Bytes, AES::Mode_ECB);
+            AES::encrypt(ecb128, key, counter, AES::BlockSizeInBytes);
+            bool carry = true;
+            for(u32 i=0; i<AES::BlockSizeInBytes; ++i){
+                carry = carry && (plain[3*AES::BlockSizeInBytes + i] ^ key[i]) == cipher[3*AES::BlockSizeInBytes + i];
+            }
+            EXPECT_TRUE(carry);
+
+            LDELETE_ARRAY(data);
+            LDELETE_ARRAY(cipher);
+            LDELETE_ARRAY(plain);
+        }
+    }
+
+    TEST_CASE("TestCryptography::AESKnownAnswer")
+    {
+        testKnownAnswer(false);
+        if(AES::isHardwareAccelerated()){
+            testKnownAnswer(true);
+        }
+    }
+
+    TEST_CASE("TestCryptography::AESBlocks")
+    {
+        testBlocks(false);
+        if(AES::isHardwareAccelerated()){
+            testBlocks(true);
+        }
+    }
+
+    TEST_CASE("TestCryptography::AESNonce")
+    {
+        static const s32 Size = 16*11+3;
+        static const u64 Nonce = 0x0123456789abcdefULL;
+        u8 plain[Size];
+        u8 cipher[Size];
+        u8 data[Size];
+        randomBytes(Size, plain, 6);
+
+        //The nonce is xored into the upper 64 bits of the counter
+        AESContext context(CTRIV, Key128, AES::Key128Bytes, AES::Mode_CTR);
+        AES::ctr(context, cipher, plain, Size, 5, Nonce);
+        u8 IV[AES::BlockSizeInBytes];
+        lcore::memcpy(IV, CTRIV, sizeof(IV));
+        for(s32 i=0; i<8; ++i){
+            IV[i] ^= static_cast<u8>(Nonce>>(56-8*i));
+        }
+        AESContext shifted(IV, Key128, AES::Key128Bytes, AES::Mode_CTR);
+        AES::ctr(shifted, data, plain, Size, 5);
+        EXPECT_TRUE(0 == lcore::memcmp(cipher, data, Size));
+
+        //Another nonce gives another key stream
+        AES::ctr(context, data, plain, Size, 5, Nonce+1);
+        EXPECT_TRUE(0 != lcore::memcmp(cipher, data, Size));
+        AES::ctr(context, data, cipher, Size, 5, Nonce);
+        EXPECT_TRUE(0 == lcore::memcmp(plain, data, Size));
+    }
+
+    TEST_CASE("TestCryptography::AESRandomAccess")
+    {
+        static const s32 Size = 4099;
+        u8* plain = LNEW u8[Size];
+        u8* cipher = LNEW u8[Size];
+        u8* data = LNEW u8[Size];
+        randomBytes(Size, plain, 2);
+
+        AESContext context(CTRIV, Key128, AES::Key128Bytes, AES::Mode_CTR);
+        AES::ctr(context, cipher, plain, Size);
+
+        //Any slice decrypts alone
+        RandXorshift128Plus32 random(3);
+        bool slice = true;
+        for(s32 i=0; i<256; ++i){
+            s32 offset = static_cast<s32>(random.rand()%Size);
+            s32 length = static_cast<s32>(random.rand()%(Size-offset+1));
+            AES::ctr(context, data, cipher+offset, length, offset);
+            slice = slice && 0 == lcore::memcmp(data, plain+offset, length);
+        }
+        EXPECT_TRUE(slice);
+
+        LDELETE_ARRAY(data);
+        LDELETE_ARRAY(cipher);
+        LDELETE_ARRAY(plain);
+    }
+
+    TEST_CASE("TestCryptography::AESParallel")
+    {
+        static const s32 Size = AES::ParallelChunkSize*5 + 16*3;
+        u8* plain = LNEW u8[Size];
+        u8* serial = LNEW u8[Size];
+        u8* parallel = LNEW u8[Size];
+        randomBytes(Size, plain, 4);
+
+        ThreadPool threadPool(4, 8);
+        threadPool.start();
+
+        AESContext ecb(NULL, Key256, AES::Key256Bytes, AES::Mode_ECB);
+        AES::encrypt(ecb, serial, plain, Size);
+        AES::encrypt(threadPool, ecb, parallel, plain, Size);
+        EXPECT_TRUE(0 == lcore::memcmp(serial, parallel, Size));
+        AES::decrypt(threadPool, ecb, parallel, parallel, Size);
+        EXPECT_TRUE(0 == lcore::memcmp(plain, parallel, Size));
+
+        AESContext cbc(CBCIV, Key128, AES::Key128Bytes, AES::Mode_CBC);
+        AES::encrypt(cbc, serial, plain, Size);
+        AES::encrypt(threadPool, cbc, parallel, plain, Size);
+        EXPECT_TRUE(0 == lcore::memcmp(serial, parallel, Size));
+        AES::decrypt(threadPool, cbc, parallel, parallel, Size);
+        EXPECT_TRUE(0 == lcore::memcmp(plain, parallel, Size));
+
+        AESContext ctr(CTRIV, Key128, AES::Key128Bytes, AES::Mode_CTR);
+        AES::ctr(ctr, serial, plain, Size-5, 7);
+        AES::ctr(threadPool, ctr, parallel, plain, Size-5, 7);
+        EXPECT_TRUE(0 == lcore::memcmp(serial, parallel, Size-5));
+
+        LDELETE_ARRAY(parallel);
+        LDELETE_ARRAY(serial);
+        LDELETE_ARRAY(plain);
+    }
+
+    TEST_CASE("TestCryptography::AESSpeed")
+    {
+        static const s32 Size = 16*1024*1024;
+        u8* data = LNEW u8[Size];
+        randomBytes(Size, data, 5);
+
+        AESContext context(CTRIV, Key128, AES::Key128Bytes, AES::Mode_CTR);
+        ClockType start = getPerformanceCounter();
+        AES::ctr(context, data, data, Size);
+        f64 serialTime = calcTime64(start, getPerformanceCounter());
+
+        ThreadPool threadPool(4, 8);
+        threadPool.start();
+        start = getPerformanceCounter();
+        AES::ctr(threadPool, context, data, data, Size);
+        f64 parallelTime = calcTime64(start, getPerformanceCounter());
+
+        LOG_INFO("AES-128 CTR (" << (AES::isHardwareAccelerated()? "AES-NI" : "software") << ") serial: "
+            << (Size/serialTime/(1024.0*1024.0)) << " MB/s, parallel: " << (Size/parallelTime/(1024.0*1024.0)) << " MB/s");
+
+        LDELETE_ARRAY(data);
+    }
+}
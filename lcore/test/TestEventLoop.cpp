@@ -0,0 +1,143 @@
+#include <catch_wrap.hpp>
+
+#include "EventLoop.h"
+#include "Thread.h"
+
+namespace lcore
+{
+    namespace
+    {
+        static const u16 EchoPort = 18512;
+        static const s32 NumClients = 16;
+        static const s32 MessageSize = 1024;
+        static const s32 NumRoundTrips = 100;
+
+        class EchoServer : public EventHandler
+        {
+        public:
+            virtual void onReceive(EventLoop& loop, Connection& connection)
+            {
+                NetworkBuffer& receiveBuffer = connection.getReceiveBuffer();
+                while(!receiveBuffer.empty()){
+                    const Char* data;
+                    s32 size = minimum(receiveBuffer.getReadRegion(data), connection.getSendBuffer().getFreeSize());
+                    if(size<=0 || !loop.send(connection, data, size)){
+                        break;
+                    }
+                    receiveBuffer.skip(size);
+                }
+            }
+        };
+
+        struct Client
+        {
+            s32 received_;
+            s32 roundTrips_;
+            bool error_;
+        };
+
+        class EchoClient : public EventHandler
+        {
+        public:
+            EchoClient()
+                :numFinished_(0)
+                ,numClosed_(0)
+            {
+                for(s32 i=0; i<MessageSize; ++i){
+                    message_[i] = static_cast<Char>(i);
+                }
+            }
+
+            virtual void onConnect(EventLoop& loop, Connection& connection)
+            {
+                loop.setTimeout(connection, 5000);
+                loop.send(connection, message_, MessageSize);
+            }
+
+            virtual void onReceive(EventLoop& loop, Connection& connection)
+            {
+                Client& client = clients_[connection.getIndex()];
+                NetworkBuffer& receiveBuffer = connection.getReceiveBuffer();
+                Char buffer[MessageSize];
+                s32 size = receiveBuffer.read(buffer, MessageSize-client.received_);
+                for(s32 i=0; i<size; ++i){
+                    if(message_[client.received_+i] != buffer[i]){
+                        client.error_ = true;
+                    }
+                }
+                client.received_ += size;
+                if(client.received_<MessageSize){
+                    return;
+                }
+                client.received_ = 0;
+                loop.setTimeout(connection, 5000);
+                if(NumRoundTrips <= ++client.roundTrips_){
+                    ++numFinished_;
+                    loop.close(connection);
+                    return;
+                }
+                loop.send(connection, message_, MessageSize);
+            }
+
+            virtual void onClose(EventLoop& /*loop*/, Connection& /*connection*/)
+            {
+                ++numClosed_;
+            }
+
+            Client clients_[NumClients];
+            s32 numFinished_;
+            s32 numClosed_;
+            Char message_[MessageSize];
+        };
+    }
+
+    TEST_CASE("TestEventLoop::Echo")
+    {
+        SocketSystem::initialize();
+
+        EchoServer echoServer;
+        EventLoop server;
+        bool result = server.initialize(&echoServer, NumClients);
+        EXPECT_TRUE(result);
+        result = server.listen(EchoPort, INADDR_ANY, NumClients, false);
+        EXPECT_TRUE(result);
+
+        ThreadPool threadPool(1, 1);
+        threadPool.start();
+        threadPool.add(EventLoop::runJob, &server);
+
+        EchoClient echoClient;
+        lcore::memset(echoClient.clients_, 0, sizeof(echoClient.clients_));
+        EventLoop client;
+        client.initialize(&echoClient, NumClients);
+
+        sockaddr_in address;
+        lcore::memset(&address, 0, sizeof(sockaddr_in));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(EchoPort);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        for(s32 i=0; i<NumClients; ++i){
+            Connection* connection = client.connect(*reinterpret_cast<const SOCKADDR*>(&address));
+            EXPECT_TRUE(NULL != connection);
+        }
+
+        while(echoClient.numClosed_<NumClients){
+            if(client.poll(10)<0){
+                break;
+            }
+        }
+
+        server.stop();
+        threadPool.waitAllFinish(thread::Infinite);
+
+        EXPECT_TRUE(NumClients == echoClient.numFinished_);
+        for(s32 i=0; i<NumClients; ++i){
+            EXPECT_FALSE(echoClient.clients_[i].error_);
+            EXPECT_TRUE(NumRoundTrips == echoClient.clients_[i].roundTrips_);
+        }
+
+        client.terminate();
+        server.terminate();
+        SocketSystem::terminate();
+    }
+}
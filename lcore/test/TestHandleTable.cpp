@@ -1,10 +1,12 @@
 #include <catch_wrap.hpp>
 #include "Random.h"
 #include "HandleTable.h"
+#include "Thread.h"
 
 namespace lcore
 {
     typedef HandleTable<u32, 24> HandleTableType;
+    typedef ConcurrentHandleTable<u32, 24, 6> ConcurrentHandleTableType;
 
     TEST_CASE("TestHandleTable::HandleTable")
     {
@@ -45,4 +47,161 @@ namespace lcore
             CHECK_FALSE(handleTable.valid(handles[idx]));
         }
     }
+
+    TEST_CASE("TestHandleTable::ConcurrentHandleTable")
+    {
+        static const s32 NumSamples = 300;
+        ConcurrentHandleTableType handleTable;
+        ConcurrentHandleTableType::Cache cache;
+        ConcurrentHandleTableType::handle_type handles[NumSamples];
+
+        for(s32 i=0; i<NumSamples; ++i){
+            handles[i] = (i&1)? handleTable.create(cache) : handleTable.create();
+        }
+        EXPECT_TRUE(NumSamples == handleTable.size());
+        EXPECT_TRUE(NumSamples<=handleTable.capacity());
+        for(s32 i=0; i<NumSamples; ++i){
+            CHECK(handleTable.valid(handles[i]));
+        }
+        for(s32 i=0; i<NumSamples; i+=2){
+            if(i&2){
+                handleTable.destroy(cache, handles[i]);
+            }else{
+                handleTable.destroy(handles[i]);
+            }
+            CHECK_FALSE(handleTable.valid(handles[i]));
+        }
+        EXPECT_TRUE(NumSamples/2 == handleTable.size());
+
+        //Reused entries get a new count, so the old handles stay invalid
+        handleTable.flush(cache);
+        for(s32 i=0; i<NumSamples; ++i){
+            ConcurrentHandleTableType::handle_type handle = handleTable.create(cache);
+            CHECK(handleTable.valid(handle));
+        }
+        for(s32 i=0; i<NumSamples; i+=2){
+            CHECK_FALSE(handleTable.valid(handles[i]));
+        }
+        handleTable.clear();
+        EXPECT_TRUE(0 == handleTable.size());
+        CHECK_FALSE(handleTable.valid(handles[1]));
+    }
+
+    namespace
+    {
+        static const s32 NumJobs = 4;
+        static const s32 NumLoops = 2000;
+
+        struct HandleJob
+        {
+            ConcurrentHandleTableType* handleTable_;
+            ConcurrentHandleTableType::handle_type handles_[NumLoops];
+            s32 numHandles_;
+            u32 seed_;
+            bool valid_;
+        };
+
+#if defined(_WIN32)
+        void handleProc(u32 /*threadId*/, void* data)
+#else
+        void handleProc(void* data)
+#endif
+        {
+            HandleJob& job = *reinterpret_cast<HandleJob*>(data);
+            ConcurrentHandleTableType& handleTable = *job.handleTable_;
+            ConcurrentHandleTableType::Cache cache;
+            RandXorshift128Plus32 random(job.seed_);
+            job.numHandles_ = 0;
+            job.valid_ = true;
+            for(s32 i=0; i<NumLoops; ++i){
+                //Create twice as often as destroy
+                if(0<job.numHandles_ && 0 == random.rand()%3){
+                    s32 index = random.rand()%job.numHandles_;
+                    if(random.rand()&1){
+                        handleTable.destroy(cache, job.handles_[index]);
+                    }else{
+                        handleTable.destroy(job.handles_[index]);
+                    }
+                    job.valid_ = job.valid_ && !handleTable.valid(job.handles_[index]);
+                    job.handles_[index] = job.handles_[--job.numHandles_];
+                }else{
+                    ConcurrentHandleTableType::handle_type handle = (random.rand()&1)? handleTable.create(cache) : handleTable.create();
+                    job.valid_ = job.valid_ && handleTable.valid(handle);
+                    job.handles_[job.numHandles_++] = handle;
+                }
+            }
+            handleTable.flush(cache);
+        }
+    }
+
+    TEST_CASE("TestHandleTable::ConcurrentHandleTableThreads")
+    {
+        ConcurrentHandleTableType handleTable;
+        HandleJob* jobs = LNEW HandleJob[NumJobs];
+        ThreadRaw threads[NumJobs];
+        for(s32 i=0; i<NumJobs; ++i){
+            jobs[i].handleTable_ = &handleTable;
+            jobs[i].seed_ = 123+i;
+            EXPECT_TRUE(threads[i].create(handleProc, &jobs[i], false));
+        }
+        for(s32 i=0; i<NumJobs; ++i){
+            threads[i].join();
+        }
+
+        //Every live handle is valid and owns a distinct entry
+        s32 total = 0;
+        bool valid = true;
+        bool* used = LNEW bool[handleTable.capacity()];
+        lcore::memset(used, 0, sizeof(bool)*handleTable.capacity());
+        for(s32 i=0; i<NumJobs; ++i){
+            valid = valid && jobs[i].valid_;
+            for(s32 j=0; j<jobs[i].numHandles_; ++j){
+                ConcurrentHandleTableType::handle_type handle = jobs[i].handles_[j];
+                valid = valid && handleTable.valid(handle) && !used[handle.index()];
+                used[handle.index()] = true;
+            }
+            total += jobs[i].numHandles_;
+        }
+        EXPECT_TRUE(valid);
+        EXPECT_TRUE(total == handleTable.size());
+
+        LDELETE_ARRAY(used);
+        LDELETE_ARRAY(jobs);
+    }
+
+    TEST_CASE("TestHandleTable::ConcurrentHandleTableExhausted")
+    {
+        //MaxCapacity is 255 with 8 index bits
+        typedef ConcurrentHandleTable<u32, 8, 4> SmallTableType;
+        static const s32 MaxCapacity = SmallTableType::MaxCapacity;
+        SmallTableType::handle_type* handles = LNEW SmallTableType::handle_type[MaxCapacity];
+        {
+            SmallTableType handleTable;
+            for(s32 i=0; i<MaxCapacity; ++i){
+                handles[i] = handleTable.create();
+                CHECK(handleTable.valid(handles[i]));
+            }
+            EXPECT_TRUE(handleTable.create().isNull());
+            EXPECT_TRUE(MaxCapacity == handleTable.size());
+
+            //Destroyed entries are reusable after exhaustion
+            handleTable.destroy(handles[7]);
+            SmallTableType::handle_type handle = handleTable.create();
+            EXPECT_TRUE(handleTable.valid(handle));
+            EXPECT_TRUE(7 == handle.index());
+            EXPECT_TRUE(handleTable.create().isNull());
+        }
+        {
+            //The cache takes the tail one by one when less than a batch is left
+            SmallTableType handleTable;
+            SmallTableType::Cache cache;
+            for(s32 i=0; i<MaxCapacity; ++i){
+                handles[i] = handleTable.create(cache);
+                CHECK(handleTable.valid(handles[i]));
+            }
+            EXPECT_TRUE(handleTable.create(cache).isNull());
+            EXPECT_TRUE(MaxCapacity == handleTable.size());
+        }
+        LDELETE_ARRAY(handles);
+    }
 }
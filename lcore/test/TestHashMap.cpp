@@ -219,6 +219,67 @@ namespace lcore
         TearDown();
     }
 
+    namespace
+    {
+        /// Move-only value. A moved-from value becomes -1
+        struct MoveOnlyValue
+        {
+            MoveOnlyValue(s32 x, s32 y)
+                :x_(x)
+                ,y_(y)
+            {}
+
+            MoveOnlyValue(MoveOnlyValue&& rhs)
+                :x_(rhs.x_)
+                ,y_(rhs.y_)
+            {
+                rhs.x_ = -1;
+                rhs.y_ = -1;
+            }
+
+            s32 x_;
+            s32 y_;
+
+        private:
+            MoveOnlyValue(const MoveOnlyValue&) = delete;
+            MoveOnlyValue& operator=(const MoveOnlyValue&) = delete;
+        };
+    }
+
+    TEST_CASE("TestHashMapCollection::TestMoveAndEmplace")
+    {
+        static const s32 NumItems = 1000;
+        lcore::HashMap<s32, MoveOnlyValue> hashmap;
+        for(s32 i=0; i<NumItems; i+=2){
+            MoveOnlyValue value(i, i*2);
+            EXPECT_TRUE(hashmap.insert(i, lcore::move(value)));
+            EXPECT_TRUE(-1 == value.x_);
+            EXPECT_TRUE(hashmap.emplace(i+1, i+1, (i+1)*2));
+        }
+        EXPECT_TRUE(NumItems == hashmap.size());
+
+        //Inserting an existing key fails and keeps the value
+        MoveOnlyValue value(-2, -2);
+        EXPECT_FALSE(hashmap.insert(0, lcore::move(value)));
+        EXPECT_FALSE(hashmap.emplace(1, -2, -2));
+
+        //Values survive being moved by expansion
+        bool same = true;
+        for(s32 i=0; i<NumItems; ++i){
+            lcore::HashMap<s32, MoveOnlyValue>::size_type pos = hashmap.find(i);
+            same = same && hashmap.valid(pos);
+            same = same && i == hashmap.getValue(pos).x_ && i*2 == hashmap.getValue(pos).y_;
+        }
+        EXPECT_TRUE(same);
+
+        for(s32 i=0; i<NumItems; i+=2){
+            hashmap.erase(i);
+        }
+        EXPECT_TRUE(NumItems/2 == hashmap.size());
+        EXPECT_FALSE(hashmap.valid(hashmap.find(0)));
+        EXPECT_TRUE(hashmap.valid(hashmap.find(1)));
+    }
+
     TEST_CASE("TestHashMapCollection::Speed")
     {
         SetUp();
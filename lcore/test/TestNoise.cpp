@@ -0,0 +1,202 @@
+#include <catch_wrap.hpp>
+#include "lcore.h"
+#include "Noise.h"
+#include "Random.h"
+#include "Thread.h"
+
+namespace lcore
+{
+    namespace
+    {
+        static const f32 Tolerance = 1.0e-4f;
+
+        bool nearlyEqual(f32 x0, f32 x1, f32 tolerance)
+        {
+            return absolute(x0-x1) <= tolerance*maximum(1.0f, absolute(x0));
+        }
+
+        bool nearlyEqual(const NoiseSample2& x0, const NoiseSample2& x1)
+        {
+            return nearlyEqual(x0.value_, x1.value_, Tolerance)
+                && nearlyEqual(x0.dx_, x1.dx_, Tolerance)
+                && nearlyEqual(x0.dy_, x1.dy_, Tolerance);
+        }
+
+        bool nearlyEqual(const NoiseSample3& x0, const NoiseSample3& x1)
+        {
+            return nearlyEqual(x0.value_, x1.value_, Tolerance)
+                && nearlyEqual(x0.dx_, x1.dx_, Tolerance)
+                && nearlyEqual(x0.dy_, x1.dy_, Tolerance)
+                && nearlyEqual(x0.dz_, x1.dz_, Tolerance);
+        }
+
+        void randomPoints(s32 count, f32* x, f32* y, f32* z)
+        {
+            RandXorshift128Plus32 random(12345);
+            for(s32 i=0; i<count; ++i){
+                x[i] = random.frand2()*512.0f - 256.0f;
+                y[i] = random.frand2()*512.0f - 256.0f;
+                z[i] = random.frand2()*512.0f - 256.0f;
+            }
+            //Lattice points
+            x[0] = y[0] = z[0] = 0.0f;
+            x[1] = y[1] = z[1] = -1.0f;
+            x[2] = y[2] = z[2] = 3.0f;
+        }
+
+        template<class T>
+        bool compareDerivative(const T& sample, f32 value, f32 delta, f32 derivative)
+        {
+            f32 numerical = (value-sample.value_)/delta;
+            return absolute(numerical-derivative) < 0.05f*maximum(1.0f, absolute(derivative));
+        }
+    }
+
+    TEST_CASE("TestNoise::Batch")
+    {
+        static const s32 Count = 1021; //Not a multiple of the SIMD width
+        Noise noise(3);
+        f32* x = LNEW f32[Count];
+        f32* y = LNEW f32[Count];
+        f32* z = LNEW f32[Count];
+        NoiseSample2* samples2 = LNEW NoiseSample2[Count];
+        NoiseSample3* samples3 = LNEW NoiseSample3[Count];
+        randomPoints(Count, x, y, z);
+
+        noise.perlin2D(Count, samples2, x, y, 0.37f);
+        noise.perlin3D(Count, samples3, x, y, z, 0.37f);
+        bool perlin = true;
+        for(s32 i=0; i<Count; ++i){
+            perlin = perlin && nearlyEqual(noise.perlin2D(x[i], y[i], 0.37f), samples2[i]);
+            perlin = perlin && nearlyEqual(noise.perlin3D(x[i], y[i], z[i], 0.37f), samples3[i]);
+        }
+        EXPECT_TRUE(perlin);
+
+        noise.simplex2D(Count, samples2, x, y, 0.37f);
+        noise.simplex3D(Count, samples3, x, y, z, 0.37f);
+        bool simplex = true;
+        bool range = true;
+        for(s32 i=0; i<Count; ++i){
+            simplex = simplex && nearlyEqual(noise.simplex2D(x[i], y[i], 0.37f), samples2[i]);
+            simplex = simplex && nearlyEqual(noise.simplex3D(x[i], y[i], z[i], 0.37f), samples3[i]);
+            range = range && absolute(samples2[i].value_)<=1.0f && absolute(samples3[i].value_)<=1.0f;
+        }
+        EXPECT_TRUE(simplex);
+        EXPECT_TRUE(range);
+
+        LDELETE_ARRAY(samples3);
+        LDELETE_ARRAY(samples2);
+        LDELETE_ARRAY(z);
+        LDELETE_ARRAY(y);
+        LDELETE_ARRAY(x);
+    }
+
+    TEST_CASE("TestNoise::Derivative")
+    {
+        static const f32 Delta = 1.0e-3f;
+        Noise noise(7);
+        RandXorshift128Plus32 random(5);
+        bool perlin = true;
+        bool simplex = true;
+        for(s32 i=0; i<1024; ++i){
+            f32 x = random.frand2()*64.0f;
+            f32 y = random.frand2()*64.0f;
+            f32 z = random.frand2()*64.0f;
+            NoiseSample3 p = noise.perlin3D(x, y, z, 0.5f);
+            perlin = perlin && compareDerivative(p, noise.perlin3D(x+Delta, y, z, 0.5f).value_, Delta, p.dx_);
+            perlin = perlin && compareDerivative(p, noise.perlin3D(x, y+Delta, z, 0.5f).value_, Delta, p.dy_);
+            perlin = perlin && compareDerivative(p, noise.perlin3D(x, y, z+Delta, 0.5f).value_, Delta, p.dz_);
+
+            NoiseSample2 s2 = noise.simplex2D(x, y, 0.5f);
+            simplex = simplex && compareDerivative(s2, noise.simplex2D(x+Delta, y, 0.5f).value_, Delta, s2.dx_);
+            simplex = simplex && compareDerivative(s2, noise.simplex2D(x, y+Delta, 0.5f).value_, Delta, s2.dy_);
+            NoiseSample3 s3 = noise.simplex3D(x, y, z, 0.5f);
+            simplex = simplex && compareDerivative(s3, noise.simplex3D(x+Delta, y, z, 0.5f).value_, Delta, s3.dx_);
+            simplex = simplex && compareDerivative(s3, noise.simplex3D(x, y+Delta, z, 0.5f).value_, Delta, s3.dy_);
+            simplex = simplex && compareDerivative(s3, noise.simplex3D(x, y, z+Delta, 0.5f).value_, Delta, s3.dz_);
+        }
+        EXPECT_TRUE(perlin);
+        EXPECT_TRUE(simplex);
+    }
+
+    TEST_CASE("TestNoise::Grid")
+    {
+        static const s32 Width = 67;
+        static const s32 Height = 33;
+        static const s32 Depth = 5;
+        static const f32 Step = 0.173f;
+        Noise noise(11);
+        NoiseSample2* grid2 = LNEW NoiseSample2[Width*Height];
+        NoiseSample2* parallel2 = LNEW NoiseSample2[Width*Height];
+        NoiseSample3* grid3 = LNEW NoiseSample3[Width*Height*Depth];
+        NoiseSample3* parallel3 = LNEW NoiseSample3[Width*Height*Depth];
+
+        noise.grid2D(&Noise::perlin2D, grid2, Width, Height, -3.0f, 2.0f, Step, 5, 0.5f);
+        noise.grid3D(&Noise::simplex3D, grid3, Width, Height, Depth, -3.0f, 2.0f, 1.0f, Step, 4, 0.5f, 2.1f, 0.45f);
+        bool fbm = true;
+        for(s32 y=0; y<Height; ++y){
+            for(s32 x=0; x<Width; ++x){
+                NoiseSample2 sample = noise.fbm(&Noise::perlin2D, -3.0f + Step*x, 2.0f + Step*y, 5, 0.5f);
+                fbm = fbm && nearlyEqual(sample, grid2[y*Width + x]);
+            }
+        }
+        for(s32 z=0; z<Depth; ++z){
+            for(s32 y=0; y<Height; ++y){
+                for(s32 x=0; x<Width; ++x){
+                    NoiseSample3 sample = noise.fbm(&Noise::simplex3D, -3.0f + Step*x, 2.0f + Step*y, 1.0f + Step*z, 4, 0.5f, 2.1f, 0.45f);
+                    fbm = fbm && nearlyEqual(sample, grid3[(z*Height + y)*Width + x]);
+                }
+            }
+        }
+        EXPECT_TRUE(fbm);
+
+        ThreadPool threadPool(4, 8);
+        threadPool.start();
+        noise.grid2D(threadPool, &Noise::perlin2D, parallel2, Width, Height, -3.0f, 2.0f, Step, 5, 0.5f);
+        noise.grid3D(threadPool, &Noise::simplex3D, parallel3, Width, Height, Depth, -3.0f, 2.0f, 1.0f, Step, 4, 0.5f, 2.1f, 0.45f);
+        //Same kernels, so the results are bitwise identical
+        EXPECT_TRUE(0 == lcore::memcmp(grid2, parallel2, sizeof(NoiseSample2)*Width*Height));
+        EXPECT_TRUE(0 == lcore::memcmp(grid3, parallel3, sizeof(NoiseSample3)*Width*Height*Depth));
+
+        LDELETE_ARRAY(parallel3);
+        LDELETE_ARRAY(grid3);
+        LDELETE_ARRAY(parallel2);
+        LDELETE_ARRAY(grid2);
+    }
+
+    TEST_CASE("TestNoise::Speed")
+    {
+        static const s32 Count = 256*1024;
+        Noise noise(1);
+        f32* x = LNEW f32[Count];
+        f32* y = LNEW f32[Count];
+        f32* z = LNEW f32[Count];
+        NoiseSample3* samples = LNEW NoiseSample3[Count];
+        randomPoints(Count, x, y, z);
+
+        f32 sum = 0.0f;
+        ClockType start = getPerformanceCounter();
+        for(s32 i=0; i<Count; ++i){
+            sum += noise.perlin3D(x[i], y[i], z[i], 0.1f).value_;
+        }
+        f64 scalarTime = calcTime64(start, getPerformanceCounter());
+
+        start = getPerformanceCounter();
+        noise.perlin3D(Count, samples, x, y, z, 0.1f);
+        f64 batchTime = calcTime64(start, getPerformanceCounter());
+        sum += samples[Count-1].value_;
+
+        start = getPerformanceCounter();
+        noise.simplex3D(Count, samples, x, y, z, 0.1f);
+        f64 simplexTime = calcTime64(start, getPerformanceCounter());
+        sum += samples[Count-1].value_;
+
+        LOG_INFO("perlin3D scalar: " << (scalarTime*1.0e9/Count) << " ns/point, batch: " << (batchTime*1.0e9/Count)
+            << " ns/point, simplex3D batch: " << (simplexTime*1.0e9/Count) << " ns/point (" << sum << ")");
+
+        LDELETE_ARRAY(samples);
+        LDELETE_ARRAY(z);
+        LDELETE_ARRAY(y);
+        LDELETE_ARRAY(x);
+    }
+}
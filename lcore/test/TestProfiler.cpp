@@ -0,0 +1,159 @@
+#include <catch_wrap.hpp>
+
+#define LENABLE_PROFILE
+#include "Profiler.h"
+#include "File.h"
+#include "Thread.h"
+
+namespace lcore
+{
+    namespace
+    {
+        static const s32 NumWorkers = 4;
+        static const s32 NumWorkerZones = 100000;
+
+        struct Worker
+        {
+            s32 id_;
+            s32* finished_;
+        };
+
+#if defined(_WIN32)
+        void workerProc(u32 /*threadId*/, void* data)
+#else
+        void workerProc(void* data)
+#endif
+        {
+            Worker& worker = *reinterpret_cast<Worker*>(data);
+            LPROFILE_THREAD_NAME("Worker");
+            for(s32 i=0; i<NumWorkerZones; ++i){
+                LPROFILE_SCOPE("Worker::outer");
+                {
+                    LPROFILE_SCOPE("Worker::inner");
+                    LPROFILE_COUNTER("Worker::count", i+worker.id_);
+                }
+            }
+            atomicIncrement(*worker.finished_);
+        }
+
+        bool isValid(const ProfileEvent& event)
+        {
+            switch(event.type_)
+            {
+            case ProfileEvent::Type_Zone:
+                return event.begin_<=event.end_ && NULL != event.name_;
+            case ProfileEvent::Type_Counter:
+            case ProfileEvent::Type_Frame:
+                return NULL != event.name_;
+            default:
+                return false;
+            }
+        }
+    }
+
+    TEST_CASE("TestProfiler::Zone")
+    {
+        Profiler::initialize(1024);
+        EXPECT_TRUE(Profiler::isInitialized());
+        EXPECT_TRUE(1024 == Profiler::getEventsPerThread());
+
+        LPROFILE_THREAD_NAME("Main");
+        LPROFILE_FRAME();
+        {
+            LPROFILE_SCOPE("outer");
+            {
+                LPROFILE_SCOPE("inner");
+                LPROFILE_COUNTER("counter", 3.5f);
+            }
+        }
+        EXPECT_TRUE(1ULL == Profiler::getFrame());
+        EXPECT_TRUE(1 == Profiler::getNumThreads());
+
+        ProfileEvent* events = LNEW ProfileEvent[Profiler::getEventsPerThread()];
+        s32 count = Profiler::snapshot(0, events);
+        EXPECT_TRUE(4 == count);
+        EXPECT_TRUE(ProfileEvent::Type_Frame == events[0].type_);
+        EXPECT_TRUE(1ULL == events[0].frame_);
+        EXPECT_TRUE(ProfileEvent::Type_Counter == events[1].type_);
+        EXPECT_TRUE(3.5 == events[1].value_);
+        EXPECT_TRUE(2U == events[1].depth_);
+        //Inner zone ends first
+        EXPECT_TRUE(ProfileEvent::Type_Zone == events[2].type_);
+        EXPECT_TRUE(0 == lcore::strncmp(events[2].name_, "inner", 6));
+        EXPECT_TRUE(1U == events[2].depth_);
+        EXPECT_TRUE(0 == lcore::strncmp(events[3].name_, "outer", 6));
+        EXPECT_TRUE(0U == events[3].depth_);
+        EXPECT_TRUE(events[3].begin_<=events[2].begin_ && events[2].end_<=events[3].end_);
+        EXPECT_TRUE(0 == lcore::strncmp(Profiler::getThread(0)->getName(), "Main", 5));
+
+        //Ring buffer keeps the latest events
+        for(s32 i=0; i<3000; ++i){
+            LPROFILE_SCOPE("wrap");
+        }
+        count = Profiler::snapshot(0, events);
+        EXPECT_TRUE(1000<count && count<=1024);
+        for(s32 i=0; i<count; ++i){
+            EXPECT_TRUE(0 == lcore::strncmp(events[i].name_, "wrap", 5));
+        }
+        LDELETE_ARRAY(events);
+        Profiler::terminate();
+        EXPECT_FALSE(Profiler::isInitialized());
+        EXPECT_TRUE(NULL == Profiler::getThreadBuffer());
+    }
+
+    TEST_CASE("TestProfiler::Threads")
+    {
+        Profiler::initialize(4096);
+        LPROFILE_THREAD_NAME("Main");
+
+        s32 finished = 0;
+        Worker workers[NumWorkers];
+        ThreadRaw threads[NumWorkers];
+        for(s32 i=0; i<NumWorkers; ++i){
+            workers[i].id_ = i;
+            workers[i].finished_ = &finished;
+            EXPECT_TRUE(threads[i].create(workerProc, &workers[i], false));
+        }
+
+        //Read concurrently with writers
+        ProfileEvent* events = LNEW ProfileEvent[Profiler::getEventsPerThread()];
+        bool valid = true;
+        s32 numSnapshots = 0;
+        while(atomicLoad(finished)<NumWorkers){
+            LPROFILE_FRAME();
+            for(s32 i=0; i<Profiler::getNumThreads(); ++i){
+                s32 count = Profiler::snapshot(i, events);
+                for(s32 j=0; j<count; ++j){
+                    valid = valid && isValid(events[j]);
+                }
+            }
+            ++numSnapshots;
+        }
+        for(s32 i=0; i<NumWorkers; ++i){
+            threads[i].join();
+        }
+        EXPECT_TRUE(valid);
+        EXPECT_TRUE(1<Profiler::getNumThreads());
+        LOG_INFO("Profiler: " << Profiler::getNumThreads() << " threads, " << numSnapshots << " concurrent snapshots");
+
+        s32 exported = Profiler::exportChromeTrace("profile_trace.json");
+        EXPECT_TRUE(0<exported);
+        LOG_INFO("    exported " << exported << " events to profile_trace.json");
+        LDELETE_ARRAY(events);
+        Profiler::terminate();
+    }
+
+    TEST_CASE("TestProfiler::Overhead")
+    {
+        static const s32 Count = 1000000;
+        Profiler::initialize();
+
+        ClockType start = getPerformanceCounter();
+        for(s32 i=0; i<Count; ++i){
+            LPROFILE_SCOPE("overhead");
+        }
+        f64 time = calcTime64(start, getPerformanceCounter());
+        LOG_INFO("LPROFILE_SCOPE: " << (time*1.0e9/Count) << " ns/zone (" << (Timestamp::isTSC()? "TSC" : "performance counter") << ")");
+        Profiler::terminate();
+    }
+}
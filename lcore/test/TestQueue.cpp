@@ -95,4 +95,51 @@ namespace lcore
             EXPECT_EQ(0, queue.size());
         }
     }
+
+    TEST_CASE("TestQueue::QueuePODEmplace")
+    {
+        struct Item
+        {
+            Item(s32 x, s32 y)
+                :x_(x)
+                ,y_(y)
+            {}
+
+            s32 x_;
+            s32 y_;
+        };
+        QueuePOD<Item, lcore::ArrayStaticCapacityIncrement<4> > queue;
+        for(s32 i=0; i<8; ++i){
+            queue.emplace_back(i, i*2);
+            queue.emplace_front(-i, -i*2);
+        }
+        EXPECT_TRUE(16 == queue.size());
+        for(s32 i=7; 0<=i; --i){
+            Item item = queue.pop_front();
+            EXPECT_TRUE(-i == item.x_);
+            EXPECT_TRUE(-i*2 == item.y_);
+        }
+        for(s32 i=7; 0<=i; --i){
+            Item item = queue.pop_back();
+            EXPECT_TRUE(i == item.x_);
+            EXPECT_TRUE(i*2 == item.y_);
+        }
+        EXPECT_TRUE(0 == queue.size());
+
+        //Arguments may refer to an item while the queue expands
+        while(queue.size()<16){
+            queue.emplace_back(queue.size(), 1);
+        }
+        const Item& front = queue.get(queue.begin());
+        queue.emplace_back(front.x_, front.y_);
+        const Item& back = queue.get(queue.begin());
+        queue.emplace_front(back.x_, back.y_);
+        EXPECT_TRUE(18 == queue.size());
+        Item item = queue.pop_back();
+        EXPECT_TRUE(0 == item.x_);
+        EXPECT_TRUE(1 == item.y_);
+        item = queue.pop_front();
+        EXPECT_TRUE(0 == item.x_);
+        EXPECT_TRUE(1 == item.y_);
+    }
 }
@@ -1,6 +1,7 @@
 #include <catch_wrap.hpp>
 #include "lcore.h"
 #include "Random.h"
+#include "CPU.h"
 
 namespace lcore
 {
@@ -50,4 +51,141 @@ namespace lcore
         LOG_INFO("Div:" <<  timeDiv);
         LDELETE_ARRAY(sr);
     }
+
+    TEST_CASE("TestRandom::Bulk")
+    {
+        static const s32 Count = 8*1000+5;
+        u64 seed = lcore::getDefaultSeed64();
+        u32* values = LNEW u32[Count];
+        f32* fvalues = LNEW f32[Count];
+        f32* freference = LNEW f32[Count];
+
+        RandXorshift128Plus32x8 scalar(seed);
+        scalar.setSIMD(RandXorshift128Plus32x8::SIMD_Scalar);
+        EXPECT_TRUE(RandXorshift128Plus32x8::SIMD_Scalar == scalar.getSIMD());
+        scalar.frand2(Count, freference);
+
+        //Every path up to the supported one gives the scalar reference sequence
+        RandXorshift128Plus32x8::SIMD supported = RandXorshift128Plus32x8::getSupportedSIMD();
+        for(s32 simd=RandXorshift128Plus32x8::SIMD_Scalar; simd<=supported; ++simd){
+            RandXorshift128Plus32x8 bulk(seed);
+            bulk.setSIMD(static_cast<RandXorshift128Plus32x8::SIMD>(simd));
+            EXPECT_TRUE(simd == bulk.getSIMD());
+            bulk.rand(Count, values);
+
+            //Lane i is the scalar generator jumped i times
+            RandXorshift128Plus lanes[RandXorshift128Plus32x8::Lanes];
+            lanes[0].srand(seed);
+            for(s32 i=1; i<RandXorshift128Plus32x8::Lanes; ++i){
+                lanes[i] = lanes[i-1];
+                lanes[i].jump();
+            }
+            bool equal = true;
+            for(s32 i=0; i<Count; ++i){
+                u32 expected = static_cast<u32>(lanes[i%RandXorshift128Plus32x8::Lanes].rand()>>32);
+                equal = equal && (expected == values[i]);
+            }
+            EXPECT_TRUE(equal);
+
+            //The rest of the last step was dropped
+            for(s32 i=Count%RandXorshift128Plus32x8::Lanes; i<RandXorshift128Plus32x8::Lanes; ++i){
+                lanes[i].rand();
+            }
+            bulk.rand(RandXorshift128Plus32x8::Lanes, values);
+            for(s32 i=0; i<RandXorshift128Plus32x8::Lanes; ++i){
+                EXPECT_TRUE(static_cast<u32>(lanes[i].rand()>>32) == values[i]);
+            }
+
+            bulk.srand(seed);
+            bulk.frand2(Count, fvalues);
+            EXPECT_TRUE(0 == lcore::memcmp(freference, fvalues, sizeof(f32)*Count));
+        }
+        LDELETE_ARRAY(freference);
+        LDELETE_ARRAY(fvalues);
+        LDELETE_ARRAY(values);
+    }
+
+    TEST_CASE("TestRandom::BulkRange")
+    {
+        static const s32 Count = 1024*1024;
+        RandXorshift128Plus32x8 bulk(lcore::getDefaultSeed64());
+        f32* fvalues = LNEW f32[Count];
+        u32* uvalues = LNEW u32[Count];
+
+        bulk.frand2(Count, fvalues);
+        f64 sum = 0.0;
+        for(s32 i=0; i<Count; ++i){
+            EXPECT_TRUE(0.0f <= fvalues[i]);
+            EXPECT_TRUE(fvalues[i] < 1.0f);
+            sum += fvalues[i];
+        }
+        EXPECT_TRUE(absolute(sum/Count - 0.5) < 0.01);
+
+        bulk.range_ropen(Count, fvalues, -2.0f, 6.0f);
+        for(s32 i=0; i<Count; ++i){
+            EXPECT_TRUE(-2.0f <= fvalues[i]);
+            EXPECT_TRUE(fvalues[i] < 6.0f);
+        }
+
+        s32 histogram[10] = {};
+        bulk.range_ropen(Count, uvalues, 10U, 20U);
+        for(s32 i=0; i<Count; ++i){
+            EXPECT_TRUE(10U <= uvalues[i]);
+            EXPECT_TRUE(uvalues[i] < 20U);
+            ++histogram[uvalues[i]-10];
+        }
+        for(s32 i=0; i<10; ++i){
+            EXPECT_TRUE(absolute(histogram[i] - Count/10) < Count/100);
+        }
+        LDELETE_ARRAY(uvalues);
+        LDELETE_ARRAY(fvalues);
+    }
+
+    TEST_CASE("TestRandom::Jump")
+    {
+        u64 seed = lcore::getDefaultSeed64();
+        RandXorshift128Plus32x8 bulk(seed);
+        RandXorshift128Plus32x8 worker = bulk;
+        worker.jump();
+
+        //A jumped copy continues with the next Lanes streams
+        RandXorshift128Plus lane(seed);
+        for(s32 i=0; i<RandXorshift128Plus32x8::Lanes; ++i){
+            lane.jump();
+        }
+        u32 values[RandXorshift128Plus32x8::Lanes*2];
+        worker.rand(RandXorshift128Plus32x8::Lanes*2, values);
+        EXPECT_TRUE(static_cast<u32>(lane.rand()>>32) == values[0]);
+        EXPECT_TRUE(static_cast<u32>(lane.rand()>>32) == values[RandXorshift128Plus32x8::Lanes]);
+
+        RandXorshift128Plus32 scalar0(seed);
+        RandXorshift128Plus32 scalar1 = scalar0;
+        scalar1.jump();
+        s32 same = 0;
+        for(s32 i=0; i<1024; ++i){
+            same += (scalar0.rand() == scalar1.rand())? 1 : 0;
+        }
+        EXPECT_TRUE(same < 4);
+    }
+
+    TEST_CASE("TestRandom::SpeedBulk")
+    {
+        static const s32 Count = 1024*1024;
+        f32* values = LNEW f32[Count];
+
+        RandXorshift128Plus32 random(lcore::getDefaultSeed64());
+        lcore::ClockType clockScalar = lcore::getPerformanceCounter();
+        for(s32 i=0; i<Count; ++i){
+            values[i] = random.frand2();
+        }
+        lcore::f64 timeScalar = lcore::calcTime64(clockScalar, lcore::getPerformanceCounter());
+
+        RandXorshift128Plus32x8 bulk(lcore::getDefaultSeed64());
+        lcore::ClockType clockBulk = lcore::getPerformanceCounter();
+        bulk.frand2(Count, values);
+        lcore::f64 timeBulk = lcore::calcTime64(clockBulk, lcore::getPerformanceCounter());
+
+        LOG_INFO("frand2 scalar:" << timeScalar << " bulk:" << timeBulk << (isSupportAVX2()? " (AVX2)" : ""));
+        LDELETE_ARRAY(values);
+    }
 }
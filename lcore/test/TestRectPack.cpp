@@ -1,9 +1,49 @@
 #include <catch_wrap.hpp>
 #include "Random.h"
 #include "RectPack.h"
+#include "RectPackUtil.h"
 
 namespace lcore
 {
+namespace
+{
+    bool overlap(const RectPackRect& rect0, const RectPackRect& rect1)
+    {
+        return rect0.X()<(rect1.X()+rect1.W())
+            && rect1.X()<(rect0.X()+rect0.W())
+            && rect0.Y()<(rect1.Y()+rect1.H())
+            && rect1.Y()<(rect0.Y()+rect0.H());
+    }
+
+    bool checkPlaced(s32 numRects, const RectPackRect* rects, const bool* placed, u16 width, u16 height)
+    {
+        for(s32 i=0; i<numRects; ++i){
+            if(!placed[i]){
+                continue;
+            }
+            if(width<(rects[i].X()+rects[i].W()) || height<(rects[i].Y()+rects[i].H())){
+                return false;
+            }
+            for(s32 j=0; j<i; ++j){
+                if(placed[j] && overlap(rects[i], rects[j])){
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    s64 placedArea(s32 numRects, const RectPackRect* rects, const bool* placed)
+    {
+        s64 area = 0;
+        for(s32 i=0; i<numRects; ++i){
+            if(placed[i]){
+                area += static_cast<s64>(rects[i].W())*rects[i].H();
+            }
+        }
+        return area;
+    }
+}
 
     bool collide(const RectPackRect& rect0, const RectPackRect& rect1)
     {
@@ -61,4 +101,136 @@ namespace lcore
             }
         }
     }
+
+    TEST_CASE("TestRectPack::Skyline")
+    {
+        static const s32 NumRects = 512;
+        static const u16 Size = 256;
+        RectPackRect rects[NumRects];
+        bool placed[NumRects];
+        randomRects(NumRects, rects, 1, 2, 24);
+
+        SkylinePack pack;
+        pack.initialize(Size, Size);
+        for(s32 i=0; i<NumRects; ++i){
+            placed[i] = pack.insert(rects[i]);
+        }
+        EXPECT_TRUE(checkPlaced(NumRects, rects, placed, Size, Size));
+
+        RectPackStatistics statistics;
+        pack.getStatistics(statistics);
+        EXPECT_TRUE(placedArea(NumRects, rects, placed) == statistics.usedArea_);
+        EXPECT_TRUE(statistics.freeArea_<=(Size*Size - statistics.usedArea_));
+
+        //The last one is on top of the skyline, so its space comes back
+        s32 last = NumRects-1;
+        while(!placed[last]){
+            --last;
+        }
+        RectPackStatistics before;
+        pack.getStatistics(before);
+        EXPECT_TRUE(pack.remove(rects[last]));
+        placed[last] = false;
+        pack.getStatistics(statistics);
+        EXPECT_TRUE(before.numRects_-1 == statistics.numRects_);
+        EXPECT_TRUE(before.freeArea_<statistics.freeArea_);
+        RectPackRect rect = rects[last];
+        EXPECT_TRUE(pack.insert(rect));
+
+        pack.clear();
+        pack.getStatistics(statistics);
+        EXPECT_TRUE(0 == statistics.numRects_);
+        EXPECT_TRUE(Size*Size == statistics.freeArea_);
+    }
+
+    TEST_CASE("TestRectPack::Guillotine")
+    {
+        static const s32 NumRects = 512;
+        static const u16 Size = 256;
+        RectPackRect rects[NumRects];
+        bool placed[NumRects];
+        randomRects(NumRects, rects, 2, 2, 24);
+
+        GuillotinePack pack;
+        pack.initialize(Size, Size, GuillotinePack::Heuristic_BestShortSideFit);
+        for(s32 i=0; i<NumRects; ++i){
+            placed[i] = pack.insert(rects[i]);
+        }
+        EXPECT_TRUE(checkPlaced(NumRects, rects, placed, Size, Size));
+
+        //Remove some, then fill the holes again
+        RandXorshift128Plus32 random(3);
+        for(s32 i=0; i<NumRects; ++i){
+            if(placed[i] && 0 == (random.rand()&1)){
+                pack.remove(rects[i]);
+                placed[i] = false;
+            }
+        }
+        for(s32 i=0; i<NumRects; ++i){
+            if(!placed[i]){
+                placed[i] = pack.insert(rects[i]);
+            }
+        }
+        EXPECT_TRUE(checkPlaced(NumRects, rects, placed, Size, Size));
+
+        RectPackStatistics statistics;
+        pack.getStatistics(statistics);
+        s64 used = placedArea(NumRects, rects, placed);
+        EXPECT_TRUE(used == statistics.usedArea_);
+        EXPECT_TRUE(Size*Size - used == statistics.freeArea_);
+
+        //Coalescing brings back the whole area
+        for(s32 i=0; i<NumRects; ++i){
+            if(placed[i]){
+                pack.remove(rects[i]);
+            }
+        }
+        pack.getStatistics(statistics);
+        EXPECT_TRUE(0 == statistics.numRects_);
+        EXPECT_TRUE(1 == statistics.numFreeRects_);
+        EXPECT_TRUE(Size*Size == statistics.freeArea_);
+    }
+
+    TEST_CASE("TestRectPack::Utilization")
+    {
+        //More glyphs than fit in the atlas
+        static const s32 NumRects = 2048;
+        static const u16 Size = 256;
+        RectPackRect rects[NumRects];
+        bool placed[NumRects];
+        randomRects(NumRects, rects, 4, 4, 16);
+
+        RectPackRect* batch = LNEW RectPackRect[NumRects];
+        lcore::memcpy(batch, rects, sizeof(RectPackRect)*NumRects);
+        RectPack::Node* nodes = LNEW RectPack::Node[NumRects*4];
+        RectPack::Context context;
+        RectPack::initialize(context, Size, Size, NumRects*4, nodes);
+        RectPack::pack(context, NumRects, batch);
+        for(s32 i=0; i<NumRects; ++i){
+            placed[i] = static_cast<u16>(-1) != batch[i].X();
+        }
+        f32 batchOccupancy = static_cast<f32>(placedArea(NumRects, batch, placed))/(Size*Size);
+        LDELETE_ARRAY(nodes);
+        LDELETE_ARRAY(batch);
+
+        SkylinePack skyline;
+        skyline.initialize(Size, Size);
+        GuillotinePack guillotine;
+        guillotine.initialize(Size, Size);
+        for(s32 i=0; i<NumRects; ++i){
+            RectPackRect rect = rects[i];
+            skyline.insert(rect);
+            guillotine.insert(rect);
+        }
+        RectPackStatistics skylineStatistics;
+        RectPackStatistics guillotineStatistics;
+        skyline.getStatistics(skylineStatistics);
+        guillotine.getStatistics(guillotineStatistics);
+        EXPECT_TRUE(0.8f<skylineStatistics.occupancy_);
+        EXPECT_TRUE(0.8f<guillotineStatistics.occupancy_);
+
+        LOG_INFO("occupancy RectPack: " << batchOccupancy
+            << ", Skyline: " << skylineStatistics.occupancy_
+            << ", Guillotine: " << guillotineStatistics.occupancy_);
+    }
 }
@@ -0,0 +1,168 @@
+#include <catch_wrap.hpp>
+#include "RefCount.h"
+#include "intrusive_ptr.h"
+#include "Thread.h"
+
+namespace lcore
+{
+    namespace
+    {
+        static const s32 NumJobs = 4;
+        static const s32 NumIterations = 100000;
+
+        volatile s32 numAlive = 0;
+
+        template<class Policy>
+        class Counted
+        {
+        public:
+            Counted()
+            {
+                atomicIncrement(numAlive);
+            }
+
+            ~Counted()
+            {
+                atomicDecrement(numAlive);
+            }
+
+            s32 getReferenceCount() const
+            {
+                return referenceCount_.get();
+            }
+
+            friend void intrusive_ptr_addref(Counted* ptr)
+            {
+                ptr->referenceCount_.addRef();
+            }
+
+            friend void intrusive_ptr_release(Counted* ptr)
+            {
+                if(ptr->referenceCount_.release()){
+                    if(NULL != queue_){
+                        queue_->push(ptr);
+                    }else{
+                        LDELETE_RAW(ptr);
+                    }
+                }
+            }
+
+            static DeferredReleaseQueue* queue_;
+        private:
+            RefCount<Policy> referenceCount_;
+        };
+
+        template<class Policy>
+        DeferredReleaseQueue* Counted<Policy>::queue_ = NULL;
+
+        typedef Counted<RefCountSingleThread> SingleCounted;
+        typedef Counted<RefCountMultiThread> MultiCounted;
+
+        struct CountJob
+        {
+            intrusive_ptr<MultiCounted> pointer_;
+        };
+
+#if defined(_WIN32)
+        void countProc(u32 /*threadId*/, void* data)
+#else
+        void countProc(void* data)
+#endif
+        {
+            CountJob* job = reinterpret_cast<CountJob*>(data);
+            for(s32 i=0; i<NumIterations; ++i){
+                intrusive_ptr<MultiCounted> copy(job->pointer_);
+                intrusive_ptr<MultiCounted> copy2(copy);
+            }
+            //Drop the last reference from a worker
+            job->pointer_ = NULL;
+        }
+
+        void runJobs(CountJob* jobs)
+        {
+            ThreadRaw threads[NumJobs];
+            for(s32 i=0; i<NumJobs; ++i){
+                EXPECT_TRUE(threads[i].create(countProc, &jobs[i], false));
+            }
+            for(s32 i=0; i<NumJobs; ++i){
+                threads[i].join();
+            }
+        }
+    }
+
+    TEST_CASE("TestRefCount::Policy")
+    {
+        numAlive = 0;
+        {
+            intrusive_ptr<SingleCounted> single(LNEW SingleCounted());
+            intrusive_ptr<MultiCounted> multi(LNEW MultiCounted());
+            EXPECT_TRUE(2 == numAlive);
+            {
+                intrusive_ptr<SingleCounted> single2(single);
+                intrusive_ptr<MultiCounted> multi2(multi);
+                EXPECT_TRUE(2 == single->getReferenceCount());
+                EXPECT_TRUE(2 == multi->getReferenceCount());
+            }
+            EXPECT_TRUE(1 == single->getReferenceCount());
+            EXPECT_TRUE(1 == multi->getReferenceCount());
+        }
+        EXPECT_TRUE(0 == numAlive);
+
+        //Copies do not inherit the count
+        RefCount<RefCountMultiThread> count;
+        count.addRef();
+        RefCount<RefCountMultiThread> copy(count);
+        EXPECT_TRUE(1 == count.get());
+        EXPECT_TRUE(0 == copy.get());
+        EXPECT_TRUE(count.release());
+    }
+
+    TEST_CASE("TestRefCount::Threads")
+    {
+        numAlive = 0;
+        CountJob jobs[NumJobs];
+        {
+            intrusive_ptr<MultiCounted> pointer(LNEW MultiCounted());
+            for(s32 i=0; i<NumJobs; ++i){
+                jobs[i].pointer_ = pointer;
+            }
+            EXPECT_TRUE(NumJobs+1 == pointer->getReferenceCount());
+        }
+
+        runJobs(jobs);
+        EXPECT_TRUE(0 == numAlive);
+    }
+
+    TEST_CASE("TestRefCount::DeferredReleaseQueue")
+    {
+        numAlive = 0;
+        DeferredReleaseQueue queue;
+        MultiCounted::queue_ = &queue;
+        {
+            intrusive_ptr<MultiCounted> pointer0(LNEW MultiCounted());
+            intrusive_ptr<MultiCounted> pointer1(LNEW MultiCounted());
+            pointer0 = NULL;
+            EXPECT_TRUE(1 == queue.size());
+        }
+        //Released at the next process, not at the last reference
+        EXPECT_TRUE(2 == queue.size());
+        EXPECT_TRUE(2 == numAlive);
+        EXPECT_TRUE(2 == queue.process());
+        EXPECT_TRUE(0 == numAlive);
+        EXPECT_TRUE(0 == queue.process());
+
+        //Released from workers, deleted by the owner
+        CountJob jobs[NumJobs];
+        {
+            intrusive_ptr<MultiCounted> pointer(LNEW MultiCounted());
+            for(s32 i=0; i<NumJobs; ++i){
+                jobs[i].pointer_ = pointer;
+            }
+        }
+        runJobs(jobs);
+        EXPECT_TRUE(1 == numAlive);
+        EXPECT_TRUE(1 == queue.process());
+        EXPECT_TRUE(0 == numAlive);
+        MultiCounted::queue_ = NULL;
+    }
+}
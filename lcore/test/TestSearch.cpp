@@ -0,0 +1,120 @@
+﻿#include <catch_wrap.hpp>
+#include "lcore.h"
+#include "Search.h"
+#include "Random.h"
+#include "Sort.h"
+
+namespace lcore
+{
+    namespace
+    {
+        template<class T>
+        s32 referenceLowerBound(s32 num, const T* elements, T value)
+        {
+            return static_cast<s32>(lower_bound(elements, elements+num, value) - elements);
+        }
+
+        template<class T>
+        s32 referenceUpperBound(s32 num, const T* elements, T value)
+        {
+            s32 i = 0;
+            while(i<num && !(value<elements[i])){
+                ++i;
+            }
+            return i;
+        }
+
+        /// 重複を含むソート済み配列
+        void sortedValues(s32 num, s32* values, RandXorshift128Plus32& random)
+        {
+            for(s32 i=0; i<num; ++i){
+                values[i] = static_cast<s32>(random.rand()%(num+1)) - num/2;
+            }
+            introsort(num, values);
+        }
+
+        struct Key
+        {
+            f32 time_;
+            s32 value_;
+        };
+
+        struct KeyLessEqual
+        {
+            bool operator()(const Key& key, f32 time) const
+            {
+                return key.time_ <= time;
+            }
+        };
+    }
+
+    TEST_CASE("TestSearch::Bound")
+    {
+        static const s32 MaxSize = 300;
+        RandXorshift128Plus32 random(1234);
+        s32 values[MaxSize];
+        f32 fvalues[MaxSize];
+        bool branchless = true;
+        bool prefetch = true;
+        bool linear = true;
+        for(s32 num=0; num<MaxSize; num+=(num<40)? 1 : 37){
+            sortedValues(num, values, random);
+            for(s32 i=0; i<num; ++i){
+                fvalues[i] = static_cast<f32>(values[i]);
+            }
+            for(s32 query=-num/2-2; query<=num/2+2; ++query){
+                s32 lower = referenceLowerBound(num, values, query);
+                s32 upper = referenceUpperBound(num, values, query);
+                f32 fquery = static_cast<f32>(query) + ((query&1)? 0.5f : 0.0f);
+                s32 flower = referenceLowerBound(num, fvalues, fquery);
+                s32 fupper = referenceUpperBound(num, fvalues, fquery);
+
+                branchless = branchless && lower == branchlessLowerBound(num, values, query);
+                branchless = branchless && upper == branchlessUpperBound(num, values, query);
+                branchless = branchless && flower == branchlessLowerBound(num, fvalues, fquery);
+                prefetch = prefetch && lower == prefetchLowerBound(num, values, query);
+                prefetch = prefetch && upper == prefetchUpperBound(num, values, query);
+                linear = linear && lower == linearLowerBound(num, values, query);
+                linear = linear && upper == linearUpperBound(num, values, query);
+                linear = linear && flower == linearLowerBound(num, fvalues, fquery);
+                linear = linear && fupper == linearUpperBound(num, fvalues, fquery);
+            }
+        }
+        EXPECT_TRUE(branchless);
+        EXPECT_TRUE(prefetch);
+        EXPECT_TRUE(linear);
+    }
+
+    TEST_CASE("TestSearch::Comparator")
+    {
+        Key keys[5] = {{0.0f, 0}, {0.5f, 1}, {0.5f, 2}, {1.0f, 3}, {2.0f, 4}};
+        EXPECT_TRUE(0 == branchlessUpperBound(5, keys, -1.0f, KeyLessEqual()));
+        EXPECT_TRUE(3 == branchlessUpperBound(5, keys, 0.5f, KeyLessEqual()));
+        EXPECT_TRUE(4 == branchlessUpperBound(5, keys, 1.5f, KeyLessEqual()));
+        EXPECT_TRUE(5 == branchlessUpperBound(5, keys, 2.0f, KeyLessEqual()));
+    }
+
+    TEST_CASE("TestSearch::Eytzinger")
+    {
+        static const s32 MaxSize = 1100;
+        RandXorshift128Plus32 random(5678);
+        s32* values = LNEW s32[MaxSize];
+        EytzingerArray<s32> eytzinger;
+        EXPECT_TRUE(0 == eytzinger.lowerBound(0));
+
+        bool lowerBound = true;
+        bool upperBound = true;
+        for(s32 num=0; num<MaxSize; num+=(num<70)? 1 : 97){
+            sortedValues(num, values, random);
+            eytzinger.build(num, values);
+            EXPECT_TRUE(num == eytzinger.size());
+            for(s32 query=-num/2-2; query<=num/2+2; ++query){
+                lowerBound = lowerBound && referenceLowerBound(num, values, query) == eytzinger.lowerBound(query);
+                upperBound = upperBound && referenceUpperBound(num, values, query) == eytzinger.upperBound(query);
+            }
+        }
+        EXPECT_TRUE(lowerBound);
+        EXPECT_TRUE(upperBound);
+        LDELETE_ARRAY(values);
+    }
+}
@@ -0,0 +1,272 @@
+#include <catch_wrap.hpp>
+
+#include "Socket.h"
+#include "SyncObject.h"
+#include "Thread.h"
+
+namespace lcore
+{
+    namespace
+    {
+        static const u16 BatchPort = 18612;
+        static const u16 FanOutPort = 18613;
+        static const s32 NumPackets = 64;
+        static const s32 PayloadSize = 512;
+
+        void getLoopback(sockaddr_in& address, u16 port)
+        {
+            lcore::memset(&address, 0, sizeof(sockaddr_in));
+            address.sin_family = AF_INET;
+            address.sin_port = htons(port);
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        }
+
+        void fillPayload(Char* data, u32 sequence, s32 size)
+        {
+            lcore::memcpy(data, &sequence, sizeof(u32));
+            for(s32 i=sizeof(u32); i<size; ++i){
+                data[i] = static_cast<Char>(sequence+i);
+            }
+        }
+
+        bool checkPayload(const Char* data, s32 size)
+        {
+            u32 sequence;
+            lcore::memcpy(&sequence, data, sizeof(u32));
+            for(s32 i=sizeof(u32); i<size; ++i){
+                if(data[i] != static_cast<Char>(sequence+i)){
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        bool waitReadable(Socket& socket, u32 milliSeconds)
+        {
+            FDSet readSet;
+            readSet.zero();
+            readSet.set(socket);
+            timeval tv;
+            tv.tv_sec = milliSeconds/1000;
+            tv.tv_usec = (milliSeconds%1000)*1000;
+            return 0<SocketUtil::select(static_cast<s32>(socket.getRaw()+1), &readSet.set_, NULL, NULL, &tv);
+        }
+
+        s32 receiveAll(Socket& socket, PacketArena& arena, s32 count, PacketCounter& counter)
+        {
+            while(arena.size()<count && waitReadable(socket, 1000)){
+                if(socket.recvBatch(arena, 0, &counter)<0){
+                    break;
+                }
+            }
+            return arena.size();
+        }
+    }
+
+    TEST_CASE("TestSocket::Batch")
+    {
+        SocketSystem::initialize();
+
+        Socket receiver;
+        bool result = SocketUtil::createDatagramGroup(&receiver, 1, BatchPort, htonl(INADDR_LOOPBACK));
+        EXPECT_TRUE(result);
+        receiver.setNonBlock();
+
+        Socket sender;
+        result = sender.create(Family_INET, SocketType_DGRAM, Protocol_UDP);
+        EXPECT_TRUE(result);
+
+        sockaddr_in address;
+        getLoopback(address, BatchPort);
+        const SOCKADDR* to = reinterpret_cast<const SOCKADDR*>(&address);
+
+        PacketCounter sendCounter;
+        PacketCounter receiveCounter;
+        PacketArena sendArena(NumPackets, PayloadSize);
+        PacketArena receiveArena(NumPackets, PacketArena::DefaultPacketSize);
+
+        //Batch
+        for(s32 i=0; i<NumPackets; ++i){
+            PacketArena::Packet* packet = sendArena.push(to, sizeof(sockaddr_in));
+            fillPayload(packet->data_, i, PayloadSize);
+            packet->size_ = PayloadSize;
+        }
+        EXPECT_TRUE(sendArena.full());
+        s32 sent = sender.sendBatch(sendArena, 0, sendArena.size(), 0, &sendCounter);
+        EXPECT_TRUE(NumPackets == sent);
+
+        s32 received = receiveAll(receiver, receiveArena, NumPackets, receiveCounter);
+        EXPECT_TRUE(NumPackets == received);
+        for(s32 i=0; i<received; ++i){
+            const PacketArena::Packet& packet = receiveArena[i];
+            u32 sequence;
+            lcore::memcpy(&sequence, packet.data_, sizeof(u32));
+            EXPECT_TRUE(static_cast<u32>(i) == sequence);
+            EXPECT_TRUE(PayloadSize == packet.size_);
+            EXPECT_TRUE(checkPayload(packet.data_, packet.size_));
+            EXPECT_TRUE(static_cast<s32>(sizeof(sockaddr_in)) == packet.addressLength_);
+        }
+        EXPECT_TRUE(static_cast<u64>(NumPackets) == sendCounter.getSentPackets());
+        EXPECT_TRUE(static_cast<u64>(NumPackets) == receiveCounter.getReceivedPackets());
+        LOG_INFO("recvBatch calls: " << receiveCounter.getReceiveCalls() << " for " << received << " packets");
+
+        //Segmentation
+        receiveArena.clear();
+        static const s32 NumSegments = 10;
+        Char buffer[PayloadSize*NumSegments];
+        for(s32 i=0; i<NumSegments; ++i){
+            fillPayload(buffer+PayloadSize*i, i, PayloadSize);
+        }
+        sent = sender.sendSegments(buffer, PayloadSize*NumSegments-1, PayloadSize, 0, to, sizeof(sockaddr_in), &sendCounter);
+        EXPECT_TRUE(PayloadSize*NumSegments-1 == sent);
+        received = receiveAll(receiver, receiveArena, NumSegments, receiveCounter);
+        EXPECT_TRUE(NumSegments == received);
+        for(s32 i=0; i<received; ++i){
+            s32 size = (i == (NumSegments-1))? PayloadSize-1 : PayloadSize;
+            EXPECT_TRUE(size == receiveArena[i].size_);
+            EXPECT_TRUE(checkPayload(receiveArena[i].data_, receiveArena[i].size_));
+        }
+        LOG_INFO("UDP_SEGMENT: " << (SocketUtil::isUDPSegmentAvailable()? "available" : "unavailable"));
+
+        sender.close();
+        receiver.close();
+        SocketSystem::terminate();
+    }
+
+#if defined(SO_REUSEPORT)
+    namespace
+    {
+        static const s32 NumWorkers = 4;
+        static const s32 MaxInFlight = 64;
+#ifdef _DEBUG
+        static const s32 NumFanOutPackets = 10000;
+#else
+        static const s32 NumFanOutPackets = 200000;
+#endif
+
+        struct Worker
+        {
+            Socket* socket_;
+            PacketArena arena_;
+            PacketCounter counter_;
+            volatile s32* running_;
+            volatile s32* received_;
+            bool error_;
+        };
+
+        void workerProc(u32 /*threadId*/, s32 /*jobId*/, void* data)
+        {
+            Worker& worker = *reinterpret_cast<Worker*>(data);
+            worker.counter_.reset();
+            while(0 != atomicLoad(*worker.running_)){
+                s32 received = worker.socket_->recvBatch(worker.arena_, 0, &worker.counter_);
+                if(received<0){
+                    worker.error_ = true;
+                    break;
+                }
+                if(0 == received){
+                    waitReadable(*worker.socket_, 1);
+                    continue;
+                }
+                for(s32 i=0; i<worker.arena_.size(); ++i){
+                    if(!checkPayload(worker.arena_[i].data_, worker.arena_[i].size_)){
+                        worker.error_ = true;
+                    }
+                }
+                worker.arena_.clear();
+                atomicAdd(*worker.received_, received);
+            }
+        }
+    }
+
+    TEST_CASE("TestSocket::ReusePortFanOut")
+    {
+        SocketSystem::initialize();
+
+        Socket sockets[NumWorkers];
+        bool result = SocketUtil::createDatagramGroup(sockets, NumWorkers, FanOutPort, htonl(INADDR_LOOPBACK));
+        EXPECT_TRUE(result);
+
+        volatile s32 running = 1;
+        volatile s32 received = 0;
+        Worker workers[NumWorkers];
+        ThreadPool threadPool(NumWorkers, NumWorkers);
+        threadPool.start();
+        for(s32 i=0; i<NumWorkers; ++i){
+            s32 bufferSize = 4*1024*1024;
+            sockets[i].setOption(SocketOption_RCVBUF, &bufferSize);
+            sockets[i].setNonBlock();
+            workers[i].socket_ = &sockets[i];
+            workers[i].arena_.initialize(MaxInFlight, PayloadSize);
+            workers[i].running_ = &running;
+            workers[i].received_ = &received;
+            workers[i].error_ = false;
+            threadPool.add(workerProc, &workers[i]);
+        }
+
+        //Kernel distributes by the source address, so send from several sockets
+        sockaddr_in address;
+        getLoopback(address, FanOutPort);
+        Socket senders[NumWorkers];
+        PacketArena arena(MaxInFlight, PayloadSize);
+        PacketCounter sendCounter;
+        for(s32 i=0; i<NumWorkers; ++i){
+            senders[i].create(Family_INET, SocketType_DGRAM, Protocol_UDP);
+            senders[i].connect(*reinterpret_cast<const SOCKADDR*>(&address));
+        }
+
+        s32 sent = 0;
+        u32 lastProgress = getTimeMilliSec();
+        while(sent<NumFanOutPackets){
+            s32 inFlight = sent - atomicLoad(received);
+            if(MaxInFlight<=inFlight){
+                //Give up if datagrams were dropped
+                if(1000<(getTimeMilliSec()-lastProgress)){
+                    break;
+                }
+                lcore::sleep(0);
+                continue;
+            }
+            lastProgress = getTimeMilliSec();
+            arena.clear();
+            s32 count = minimum(MaxInFlight-inFlight, NumFanOutPackets-sent);
+            for(s32 i=0; i<count; ++i){
+                PacketArena::Packet* packet = arena.push(NULL, 0);
+                fillPayload(packet->data_, sent+i, PayloadSize);
+                packet->size_ = PayloadSize;
+            }
+            s32 ret = senders[sent%NumWorkers].sendBatch(arena, 0, count, 0, &sendCounter);
+            if(ret<0){
+                break;
+            }
+            sent += ret;
+        }
+        while(atomicLoad(received)<sent && (getTimeMilliSec()-lastProgress)<1000){
+            lcore::sleep(0);
+        }
+        atomicStore(running, 0);
+        threadPool.waitAllFinish(thread::Infinite);
+
+        EXPECT_TRUE(NumFanOutPackets == sent);
+        EXPECT_TRUE(sent == atomicLoad(received));
+
+        PacketCounter total;
+        LOG_INFO("SO_REUSEPORT fan-out: " << NumWorkers << " workers");
+        for(s32 i=0; i<NumWorkers; ++i){
+            EXPECT_FALSE(workers[i].error_);
+            total.add(workers[i].counter_);
+            LOG_INFO("    worker" << i << ": " << workers[i].counter_.getReceivedPackets() << " packets, " << workers[i].counter_.getReceiveCalls() << " calls");
+        }
+        f64 time = sendCounter.getElapsedTime();
+        LOG_INFO("    sent pps: " << sendCounter.getSentPacketsPerSecond());
+        LOG_INFO("    received pps: " << (time>0.0? total.getReceivedPackets()/time : 0.0));
+        LOG_INFO("    packets/recv call: " << (static_cast<f64>(total.getReceivedPackets())/maximum(total.getReceiveCalls(), static_cast<u64>(1))));
+
+        for(s32 i=0; i<NumWorkers; ++i){
+            senders[i].close();
+            sockets[i].close();
+        }
+        SocketSystem::terminate();
+    }
+#endif
+}
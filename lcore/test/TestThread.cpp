@@ -0,0 +1,58 @@
+#include <catch_wrap.hpp>
+
+#include "Thread.h"
+#include "SyncObject.h"
+
+namespace lcore
+{
+    namespace
+    {
+        static const u32 MaxItems = 4096;
+
+        struct Items
+        {
+            s32 counts_[MaxItems];
+        };
+
+        void countItem(void* data, u32 index)
+        {
+            atomicIncrement(reinterpret_cast<Items*>(data)->counts_[index]);
+        }
+
+        bool check(const Items& items, u32 count)
+        {
+            for(u32 i=0; i<MaxItems; ++i){
+                if((i<count? 1 : 0) != items.counts_[i]){
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+
+    TEST_CASE("TestThread::ParallelFor")
+    {
+        static const u32 Counts[] = {0, 1, 2, 3, 17, 1000, MaxItems};
+        Items* items = LNEW Items;
+        ThreadPool threadPool(4, 16);
+        threadPool.start();
+        for(u32 i=0; i<sizeof(Counts)/sizeof(Counts[0]); ++i){
+            //Every item exactly once, with and without workers
+            lcore::memset(items, 0, sizeof(Items));
+            parallelFor(&threadPool, countItem, items, Counts[i]);
+            EXPECT_TRUE(check(*items, Counts[i]));
+
+            lcore::memset(items, 0, sizeof(Items));
+            parallelFor(NULL, countItem, items, Counts[i]);
+            EXPECT_TRUE(check(*items, Counts[i]));
+        }
+
+        //Returns only after the workers finished, so the job on the stack can go at once
+        for(s32 i=0; i<1000; ++i){
+            lcore::memset(items, 0, sizeof(Items));
+            parallelFor(&threadPool, countItem, items, 64);
+            EXPECT_TRUE(check(*items, 64));
+        }
+        LDELETE(items);
+    }
+}
@@ -0,0 +1,75 @@
+#include <catch_wrap.hpp>
+
+#include "Timestamp.h"
+
+namespace lcore
+{
+    TEST_CASE("TestTimestamp::Conversion")
+    {
+        EXPECT_TRUE(0ULL == Timestamp::mulShift32(0, 123456789ULL));
+        EXPECT_TRUE(3ULL == Timestamp::mulShift32(3ULL<<32, 1ULL));
+        EXPECT_TRUE(0xFFFFFFFFULL == Timestamp::mulShift32(0xFFFFFFFFULL, 1ULL<<32));
+        EXPECT_TRUE(1000000000ULL*3 == Timestamp::mulShift32(3ULL<<32, 1000000000ULL));
+        //Result crosses 64 bit intermediate products
+        EXPECT_TRUE(0x123456789ABCDEFULL == Timestamp::mulShift32(0x123456789ABCDEFULL<<4, 1ULL<<28));
+    }
+
+    TEST_CASE("TestTimestamp::Clock")
+    {
+        bool tsc = Timestamp::initialize();
+        EXPECT_TRUE(tsc == Timestamp::isTSC());
+        EXPECT_TRUE(0<Timestamp::getFrequency());
+        LOG_INFO("Timestamp: " << (tsc? "TSC" : "performance counter") << ", invariant TSC: " << (isInvariantTSC()? "yes" : "no") << ", rdtscp: " << (isSupportRDTSCP()? "yes" : "no"));
+        LOG_INFO("    frequency: " << Timestamp::getFrequency() << ", cpuid frequency: " << getTSCFrequencyFromCPUID() << ", max drift: " << Timestamp::getMaxDrift());
+
+        //One second in ticks
+        u64 nanoSeconds = Timestamp::toNanoSeconds(Timestamp::getFrequency());
+        EXPECT_TRUE(999999000ULL<nanoSeconds && nanoSeconds<=1000000000ULL);
+
+        //Monotonic
+        u64 prev = Timestamp::now();
+        bool monotonic = true;
+        for(s32 i=0; i<100000; ++i){
+            u64 t = Timestamp::nowSerialized();
+            if(t<prev){
+                monotonic = false;
+            }
+            prev = t;
+        }
+        EXPECT_TRUE(monotonic);
+
+        //Agrees with the performance counter
+        ClockType clock0 = getPerformanceCounter();
+        u64 t0 = Timestamp::now();
+        u32 start = getTimeMilliSec();
+        while((getTimeMilliSec()-start)<50){
+        }
+        u64 t1 = Timestamp::now();
+        ClockType clock1 = getPerformanceCounter();
+        f64 reference = calcTime64(clock0, clock1);
+        f64 time = Timestamp::toSeconds(t1-t0);
+        LOG_INFO("    50ms busy wait: " << time << " (performance counter " << reference << ")");
+        EXPECT_TRUE(absolute(time-reference) < 0.01);
+        EXPECT_TRUE(absolute(Timestamp::calcNanoSeconds(t0, t1)*1.0e-9 - time) < 1.0e-6);
+    }
+
+    TEST_CASE("TestTimestamp::Overhead")
+    {
+        Timestamp::initialize(false);
+        static const s32 Count = 1000000;
+
+        u64 sum = 0;
+        ClockType start = getPerformanceCounter();
+        for(s32 i=0; i<Count; ++i){
+            sum += Timestamp::now();
+        }
+        f64 timestampTime = calcTime64(start, getPerformanceCounter());
+
+        start = getPerformanceCounter();
+        for(s32 i=0; i<Count; ++i){
+            sum += getPerformanceCounter();
+        }
+        f64 counterTime = calcTime64(start, getPerformanceCounter());
+        LOG_INFO("Timestamp::now: " << (timestampTime*1.0e9/Count) << " ns/call, getPerformanceCounter: " << (counterTime*1.0e9/Count) << " ns/call (" << (sum&1) << ")");
+    }
+}
@@ -5,6 +5,7 @@
 @author t-sakai
 @date 2016/11/06 create
 */
+#include <lcore/Profiler.h>
 #include <lgraphics/InitParam.h>
 #include <lgraphics/Window.h>
 #include "input/linput.h"
@@ -50,6 +51,17 @@ namespace lfw
             u32 exStyle_;
         };
 
+        struct ProfileInitParam
+        {
+            ProfileInitParam()
+                :eventsPerThread_(lcore::Profiler::DefaultEventsPerThread)
+                ,traceFilepath_("profile_trace.json")
+            {}
+
+            s32 eventsPerThread_;
+            const char* traceFilepath_; ///< IChrome trace`ŏo. NULLȂ珑oȂ. I܂ŗLȕ
+        };
+
         struct InitParam
         {
             WindowParam windowParam_;
@@ -58,6 +70,7 @@ namespace lfw
             ECSInitParam ecsParam_;
             RendererInitParam rendererParam_;
             SoundInitParam soundParam_;
+            ProfileInitParam profileParam_; //LENABLE_PROFILE`Ăꍇ̂ݎg
         };
 
         static bool initApplication(InitParam& initParam, const char* title, WNDPROC wndProc);
@@ -94,6 +107,7 @@ namespace lfw
 
         linput::Input input_;
         Timer timer_;
+        const char* profileTraceFilepath_;
     };
 }
 #endif //INC_LFRAMEWORK_APPLICATION_H_
@@ -14,6 +14,7 @@ namespace lfw
 #define LFW_CONFIG_FILENAMESIZE (64)
 #define LFW_CONFIG_FILENAMELENGTH (LFW_CONFIG_FILENAMESIZE-1)
 #define LFW_CONFIG_COMPUTESHADER_NUMTHREADS_BITSHIFT (3)
+/* #undef LFW_CONFIG_SINGLETHREAD_RESOURCE */
 
 #define LFW_CONFIG_ENABLE_GUI
 #define LFW_CONFIG_ENABLE_ONLYDEBUG_GUI
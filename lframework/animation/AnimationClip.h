@@ -7,6 +7,7 @@
 */
 #include "lanim.h"
 #include <lcore/intrusive_ptr.h>
+#include <lcore/RefCount.h>
 #include "JointAnimation.h"
 
 namespace lfw
@@ -48,7 +49,7 @@ namespace lfw
         friend inline void intrusive_ptr_addref(AnimationClip* ptr);
         friend inline void intrusive_ptr_release(AnimationClip* ptr);
 
-        s32 referenceCount_;
+        lcore::RefCount<RefCountPolicy> referenceCount_;
         Name name_;
         f32 lastTime_;
         s32 numJoints_;
@@ -111,12 +112,12 @@ namespace lfw
 
     inline void intrusive_ptr_addref(AnimationClip* ptr)
     {
-        ++ptr->referenceCount_;
+        ptr->referenceCount_.addRef();
     }
 
     inline void intrusive_ptr_release(AnimationClip* ptr)
     {
-        if(--ptr->referenceCount_ == 0){
+        if(ptr->referenceCount_.release()){
             LDELETE_RAW(ptr);
         }
     }
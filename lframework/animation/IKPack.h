@@ -6,6 +6,7 @@
 @date 2016/11/24 create
 */
 #include <lcore/intrusive_ptr.h>
+#include <lcore/RefCount.h>
 #include "lanim.h"
 
 namespace lfw
@@ -58,18 +59,18 @@ namespace lfw
         /// 参照カウント
         void addRef()
         {
-            ++refCount_;
+            refCount_.addRef();
         }
 
         /// 参照カウント開放
         void release()
         {
-            if(--refCount_ == 0){
+            if(refCount_.release()){
                 LDELETE_RAW(this);
             }
         }
 
-        s32 refCount_;
+        lcore::RefCount<RefCountPolicy> refCount_;
 
         s32 numIKs_;
         IKEntry* iks_;
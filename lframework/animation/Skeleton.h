@@ -7,6 +7,7 @@
 */
 #include "lanim.h"
 #include <lcore/intrusive_ptr.h>
+#include <lcore/RefCount.h>
 #include "Joint.h"
 
 namespace lfw
@@ -78,7 +79,7 @@ namespace lfw
         friend void intrusive_ptr_addref(Skeleton* skeleton);
         friend void intrusive_ptr_release(Skeleton* skeleton);
 
-        s32 referenceCount_;
+        lcore::RefCount<RefCountPolicy> referenceCount_;
         Name name_;
         s32 numJoints_;
         Joint* joints_;
@@ -173,13 +174,12 @@ namespace lfw
 
     inline void intrusive_ptr_addref(Skeleton* skeleton)
     {
-        ++skeleton->referenceCount_;
+        skeleton->referenceCount_.addRef();
     }
 
     inline void intrusive_ptr_release(Skeleton* skeleton)
     {
-        --skeleton->referenceCount_;
-        if(0 == skeleton->referenceCount_){
+        if(skeleton->referenceCount_.release()){
             LDELETE_RAW(skeleton);
         }
     }
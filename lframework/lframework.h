@@ -8,6 +8,12 @@
 #include <lcore/lcore.h>
 #include "Config.h"
 
+namespace lcore
+{
+    struct RefCountSingleThread;
+    struct RefCountMultiThread;
+}
+
 namespace lmath
 {
     class Vector4;
@@ -29,6 +35,13 @@ namespace lfw
     using lcore::Char;
     using lcore::size_t;
 
+    /// \[X̎QƃJEg. [_⃏[JƋLȂȂAg~bN߂gȂ
+#ifdef LFW_CONFIG_SINGLETHREAD_RESOURCE
+    typedef lcore::RefCountSingleThread RefCountPolicy;
+#else
+    typedef lcore::RefCountMultiThread RefCountPolicy;
+#endif
+
     static const s32 ComputeShader_NumThreads_Shift = LFW_CONFIG_COMPUTESHADER_NUMTHREADS_BITSHIFT;
     static const s32 ComputeShader_NumThreads = (0x01<<ComputeShader_NumThreads_Shift);
     static const u32 ComputeShader_NumThreads_Mask = ComputeShader_NumThreads-1;
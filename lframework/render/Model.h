@@ -7,6 +7,7 @@
 */
 #include "../lframework.h"
 #include <lcore/intrusive_ptr.h>
+#include <lcore/RefCount.h>
 #include <lmath/Vector4.h>
 #include <lmath/Quaternion.h>
 #include <lmath/geometry/Sphere.h>
@@ -113,7 +114,7 @@ namespace lfw
 
         s32 calcBufferSize() const;
 
-        s32 referenceCount_;
+        lcore::RefCount<RefCountPolicy> referenceCount_;
         lmath::Sphere sphere_;
         Geometry* geometries_;
         Mesh* meshes_; /// bVz
@@ -238,13 +239,12 @@ namespace lfw
 
     inline void intrusive_ptr_addref(Model* model)
     {
-        ++model->referenceCount_;
+        model->referenceCount_.addRef();
     }
 
     inline void intrusive_ptr_release(Model* model)
     {
-        --model->referenceCount_;
-        if(0 == model->referenceCount_){
+        if(model->referenceCount_.release()){
             LDELETE_RAW(model);
         }
     }
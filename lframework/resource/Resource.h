@@ -7,6 +7,7 @@
 */
 #include "../lframework.h"
 #include <lcore/intrusive_ptr.h>
+#include <lcore/RefCount.h>
 
 namespace lfw
 {
@@ -52,6 +53,12 @@ namespace lfw
         {
             return (T::Type == getType())? reinterpret_cast<T*>(this) : NULL;
         }
+
+        /**
+        @brief Where resources go once their count hits zero. NULL releases them immediately
+        @param queue ... The owning thread processes it once per frame
+        */
+        static void setReleaseQueue(lcore::DeferredReleaseQueue* queue);
     protected:
         Resource(const Resource&);
         Resource& operator=(const Resource&);
@@ -60,22 +67,26 @@ namespace lfw
         friend void intrusive_ptr_release(Resource* resource);
 
         Resource()
-            :referenceCount_(0)
-            ,id_(0)
+            :id_(0)
         {}
 
         virtual ~Resource()
         {
-            referenceCount_ = 0;
+            referenceCount_.reset();
         }
 
-        s32 referenceCount_;
+        static void release(Resource* resource);
+        static void destroy(void* ptr);
+
+        static lcore::DeferredReleaseQueue* releaseQueue_;
+
+        lcore::RefCount<RefCountPolicy> referenceCount_;
         u64 id_;
     };
 
     inline s32 Resource::getReferenceCount() const
     {
-        return referenceCount_;
+        return referenceCount_.get();
     }
 
     inline u64 Resource::getID() const
@@ -90,14 +101,13 @@ namespace lfw
 
     inline void intrusive_ptr_addref(Resource* resource)
     {
-        ++resource->referenceCount_;
+        resource->referenceCount_.addRef();
     }
 
     inline void intrusive_ptr_release(Resource* resource)
     {
-        --resource->referenceCount_;
-        if(0 == resource->referenceCount_){
-            LDELETE_RAW(resource);
+        if(resource->referenceCount_.release()){
+            Resource::release(resource);
         }
     }
 }
@@ -8,6 +8,7 @@
 #include "../lframework.h"
 #include <lcore/Array.h>
 #include <lcore/HashMap.h>
+#include <lcore/RefCount.h>
 #include "ResourceSet.h"
 #include "InputLayoutFactory.h"
 #include "ShaderManager.h"
@@ -118,6 +119,11 @@ namespace lfw
         inline Resource::pointer& getEmptyTextureBlack();
         inline Resource::pointer& getEmptyTextureClear();
         inline Resource::pointer& getTextureChecker();
+
+        /**
+        @brief QƂ0ɂȂ\[X. 1t[1, CXbhĂ
+        */
+        void processReleaseQueue();
     private:
         Resources(const Resources&);
         Resources& operator=(const Resources&);
@@ -132,6 +138,9 @@ namespace lfw
         Resource* loadInternal(s32 setID, const Char* path, ResourceType type);
         Resource* loadInternal(const Char* path, ResourceType type, const TextureParameter& param);
 
+        /// ̃o\[X󂯎̂ōŏɐ錾
+        lcore::DeferredReleaseQueue releaseQueue_;
+
         typedef lcore::HopscotchHashMap<u64, Resource::pointer> KeyToResourceMap;
         KeyToResourceMap resources_;
 
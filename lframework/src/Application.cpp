@@ -5,6 +5,7 @@
 */
 #include "Application.h"
 #include <lcore/FileSystem.h>
+#include <lcore/Profiler.h>
 #include <lgraphics/Graphics.h>
 #include <lsound/Context.h>
 #include "System.h"
@@ -37,6 +38,7 @@ namespace lfw
 
 
     Application::Application()
+        :profileTraceFilepath_(NULL)
     {
     }
 
@@ -48,8 +50,10 @@ namespace lfw
     void Application::run()
     {
         initialize();
+        LPROFILE_THREAD_NAME("Main");
 
         for(;;){
+            LPROFILE_FRAME();
             if(false == window_.peekEvent(NULL)){
                 break;
             }
@@ -63,8 +67,10 @@ namespace lfw
     void Application::runEventDriven()
     {
         initialize();
+        LPROFILE_THREAD_NAME("Main");
 
         for(;;){
+            LPROFILE_FRAME();
             if(false == window_.getEvent(NULL)){
                 break;
             }
@@ -83,6 +89,15 @@ namespace lfw
     {
         System::setApplication(this);
 
+#if defined(LENABLE_PROFILE)
+        //Initialize Profiler
+        //-----------------------------------------------------------------
+        //vłȂĂ͑
+        if(lcore::Profiler::initialize(initParam.profileParam_.eventsPerThread_)){
+            profileTraceFilepath_ = initParam.profileParam_.traceFilepath_;
+        }
+#endif
+
         //Initialize Window
         //-----------------------------------------------------------------
         //EBhETCYAr[|[gTCY̓obNobt@ƓɂB
@@ -209,6 +224,16 @@ namespace lfw
         window_.destroy();
 
         System::clear();
+
+#if defined(LENABLE_PROFILE)
+        if(lcore::Profiler::isInitialized()){
+            if(NULL != profileTraceFilepath_){
+                lcore::Profiler::exportChromeTrace(profileTraceFilepath_);
+            }
+            lcore::Profiler::terminate();
+        }
+        profileTraceFilepath_ = NULL;
+#endif
     }
 
     // 
@@ -219,6 +244,7 @@ namespace lfw
     // XV
     void Application::update()
     {
+        LPROFILE_SCOPE("Application::update");
         input_.update();
         timer_.update();
         lsound::Context::getInstance().updateRequests();
@@ -228,10 +254,26 @@ namespace lfw
         CollideManager& collideManager = System::getCollideManager();
 
         renderer.begin();
-        ecsManager.update();
-        collideManager.collideAll();
-        ecsManager.postUpdate();
-        renderer.update();
+        {
+            LPROFILE_SCOPE("ECSManager::update");
+            ecsManager.update();
+        }
+        {
+            LPROFILE_SCOPE("CollideManager::collideAll");
+            collideManager.collideAll();
+        }
+        {
+            LPROFILE_SCOPE("ECSManager::postUpdate");
+            ecsManager.postUpdate();
+        }
+        {
+            LPROFILE_SCOPE("Renderer::update");
+            renderer.update();
+        }
+        {
+            LPROFILE_SCOPE("Resources::processReleaseQueue");
+            System::getResources().processReleaseQueue();
+        }
     }
 
     // I
@@ -10,16 +10,14 @@
 namespace lfw
 {
     AnimationClip::AnimationClip()
-        :referenceCount_(0)
-        ,lastTime_(0.0f)
+        :lastTime_(0.0f)
         ,numJoints_(0)
         ,jointAnims_(NULL)
     {
     }
 
     AnimationClip::AnimationClip(s32 numJoints)
-        :referenceCount_(0)
-        ,lastTime_(0.0f)
+        :lastTime_(0.0f)
         ,numJoints_(numJoints)
     {
         LASSERT(0<=numJoints_);
@@ -8,15 +8,13 @@
 namespace lfw
 {
     IKPack::IKPack()
-        :refCount_(0)
-        ,numIKs_(0)
+        :numIKs_(0)
         ,iks_(NULL)
     {
     }
 
     IKPack::IKPack(s32 numIKs)
-        :refCount_(0)
-        ,numIKs_(numIKs)
+        :numIKs_(numIKs)
     {
         if(numIKs_>0){
             iks_ = static_cast<IKEntry*>(LMALLOC(sizeof(IKEntry)*numIKs_));
@@ -37,7 +35,7 @@ namespace lfw
 
     void IKPack::swap(IKPack& rhs)
     {
-        lcore::swap(refCount_, rhs.refCount_);
+        refCount_.swap(rhs.refCount_);
         lcore::swap(numIKs_, rhs.numIKs_);
         lcore::swap(iks_, rhs.iks_);
     }
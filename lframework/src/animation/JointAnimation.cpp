@@ -5,27 +5,26 @@
 */
 #include "animation/JointAnimation.h"
 #include "animation/JointPose.h"
+#include <lcore/Search.h>
 
 namespace lfw
 {
+namespace
+{
+    struct PoseTimeLessEqual
+    {
+        inline bool operator()(const JointPoseWithTime& pose, f32 time) const
+        {
+            return pose.time_ <= time;
+        }
+    };
+}
+
     s32 JointAnimation::binarySearchIndex(f32 time) const
     {
         LASSERT(0<numPoses_);
-        s32 mid = 0;
-        s32 left = 0;
-        s32 right = numPoses_;
-        while(left < right){
-            mid = (left + right) >> 1;
-            if(poses_[mid].time_ <= time){
-                left = mid + 1;
-            }else{
-                right = mid;
-            }
-        }
-        LASSERT(0<=left && left<=numPoses_);
-        if(left>0){
-            left -= 1;
-        }
-        return left;
+        s32 index = lcore::branchlessUpperBound(numPoses_, poses_, time, PoseTimeLessEqual());
+        LASSERT(0<=index && index<=numPoses_);
+        return (0<index)? index-1 : 0;
     }
 }
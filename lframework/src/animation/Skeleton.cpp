@@ -10,16 +10,14 @@
 namespace lfw
 {
     Skeleton::Skeleton()
-        :referenceCount_(0)
-        ,numJoints_(0)
+        :numJoints_(0)
         ,joints_(NULL)
         ,jointNames_(NULL)
     {
     }
 
     Skeleton::Skeleton(s32 numJoints)
-        :referenceCount_(0)
-        ,numJoints_(numJoints)
+        :numJoints_(numJoints)
     {
         u32 total = (sizeof(Joint) + sizeof(Name)) * numJoints_;
 
@@ -47,7 +45,7 @@ namespace lfw
         numJoints_ = 0;
         LFREE(joints_);
         jointNames_ = NULL;
-        referenceCount_ = 0;
+        referenceCount_.reset();
     }
 
     // 名前からジョイント検索
@@ -78,7 +76,7 @@ namespace lfw
     // スワップ
     void Skeleton::swap(Skeleton& rhs)
     {
-        lcore::swap(referenceCount_, rhs.referenceCount_);
+        referenceCount_.swap(rhs.referenceCount_);
         lcore::swap(numJoints_, rhs.numJoints_);
         lcore::swap(joints_, rhs.joints_);
         lcore::swap(jointNames_, rhs.jointNames_);
@@ -8,8 +8,7 @@
 namespace lfw
 {
     Model::Model()
-        :referenceCount_(0)
-        ,geometries_(NULL)
+        :geometries_(NULL)
         ,meshes_(NULL)
         ,materials_(NULL)
         ,nodes_(NULL)
@@ -26,7 +25,7 @@ namespace lfw
     Model::~Model()
     {
         destroy();
-        referenceCount_ = 0;
+        referenceCount_.reset();
     }
 
     //-----------------------------------------------------
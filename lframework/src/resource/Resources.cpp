@@ -30,10 +30,34 @@ namespace lfw
         0.0f
     };
 
+    lcore::DeferredReleaseQueue* Resource::releaseQueue_ = NULL;
+
+    void Resource::setReleaseQueue(lcore::DeferredReleaseQueue* queue)
+    {
+        releaseQueue_ = queue;
+    }
+
+    void Resource::release(Resource* resource)
+    {
+        //GPU\[XȂǂLXbhŉ邽, [J0ɂȂĂx点
+        if(NULL != releaseQueue_){
+            releaseQueue_->push(resource, Resource::destroy);
+        }else{
+            LDELETE_RAW(resource);
+        }
+    }
+
+    void Resource::destroy(void* ptr)
+    {
+        Resource* resource = static_cast<Resource*>(ptr);
+        LDELETE_RAW(resource);
+    }
+
     Resources* Resources::create(s32 numSets, lcore::FileSystem* fileSystem)
     {
         numSets = lcore::maximum(1, numSets);
         Resources* resources = LNEW Resources(numSets, fileSystem);
+        Resource::setReleaseQueue(&resources->releaseQueue_);
 
         TextureParameter texParam = TextureParameter::NoSRGB_;
         resources->emptyTextureWhite_ = Resource::pointer(ResourceTexture2D::create(0xFFFFFFFFU, texParam));
@@ -80,9 +104,17 @@ namespace lfw
 
     Resources::~Resources()
     {
+        //ȍ~͑ɉ. creleaseQueue_̃fXgN^ŉ
+        Resource::setReleaseQueue(NULL);
         LDELETE_ARRAY(buffer_);
     }
 
+    // QƂ0ɂȂ\[X
+    void Resources::processReleaseQueue()
+    {
+        releaseQueue_.process();
+    }
+
     // 擾
     const ResourceSet& Resources::getSet(s32 setID)
     {
@@ -0,0 +1,110 @@
+﻿#include "Bench.h"
+#include <lcore/Random.h>
+#include "lmath.h"
+#include "geometry/DynamicAABBTree.h"
+#include "geometry/Ray.h"
+
+namespace lmath
+{
+namespace
+{
+    //ns/elemが代理1つの追加時間, 動いた代理1つの更新時間, または光線1本の時間
+    static const s32 NumObjects = 20000;
+    static const s32 NumMoving = NumObjects/20;
+    static const s32 NumRays = 4096;
+
+    f32 frand(lcore::RandXorshift128Plus32& random, f32 low, f32 high)
+    {
+        return low + (high-low)*random.frand();
+    }
+
+    /// 広い床に散らばった箱. 先頭のNumMoving個だけ動く
+    struct World
+    {
+        World()
+            :random_(12345)
+        {
+            for(s32 i=0; i<NumObjects; ++i){
+                lmath::Vector3 center = lmath::Vector3::construct(frand(random_, -500.0f, 500.0f), frand(random_, 0.0f, 20.0f), frand(random_, -500.0f, 500.0f));
+                lmath::Vector3 extent = lmath::Vector3::construct(frand(random_, 0.2f, 2.0f), frand(random_, 0.2f, 2.0f), frand(random_, 0.2f, 2.0f));
+                boxes_[i] = lmath::AABB(center-extent, center+extent);
+                proxies_[i] = tree_.createProxy(boxes_[i], NULL);
+            }
+            for(s32 i=0; i<NumMoving; ++i){
+                velocities_[i] = lmath::Vector3::construct(frand(random_, -0.3f, 0.3f), 0.0f, frand(random_, -0.3f, 0.3f));
+            }
+            for(s32 i=0; i<NumRays; ++i){
+                lmath::Vector3 origin = lmath::Vector3::construct(frand(random_, -500.0f, 500.0f), frand(random_, 0.0f, 20.0f), frand(random_, -500.0f, 500.0f));
+                lmath::Vector3 direction = lmath::Vector3::construct(frand(random_, -1.0f, 1.0f), frand(random_, -0.1f, 0.1f), frand(random_, -1.0f, 1.0f));
+                direction *= 1.0f/lmath::sqrt(dot(direction, direction));
+                rays_[i] = lmath::Ray(origin, direction, 200.0f);
+            }
+            tree_.queryPairs(pairs_);
+        }
+
+        lcore::RandXorshift128Plus32 random_;
+        lmath::DynamicAABBTree tree_;
+        lmath::AABB boxes_[NumObjects];
+        s32 proxies_[NumObjects];
+        lmath::Vector3 velocities_[NumMoving];
+        lmath::Ray rays_[NumRays];
+        lcore::Array<lmath::DynamicAABBTree::Pair> pairs_;
+    };
+
+    World& getWorld()
+    {
+        static World world;
+        return world;
+    }
+
+    f32 countHit(void* data, s32, const lmath::Ray& ray)
+    {
+        ++*reinterpret_cast<s32*>(data);
+        return ray.t_;
+    }
+
+    void benchCreate(lcore::bench::State& state)
+    {
+        World& world = getWorld();
+        lmath::DynamicAABBTree tree;
+        while(state.next()){
+            tree.clear();
+            for(s32 i=0; i<NumObjects; ++i){
+                tree.createProxy(world.boxes_[i], NULL);
+            }
+            lcore::bench::State::consume(tree.getHeight());
+        }
+    }
+
+    /// 1フレーム分の移動と組の更新
+    void benchUpdate(lcore::bench::State& state)
+    {
+        World& world = getWorld();
+        while(state.next()){
+            for(s32 i=0; i<NumMoving; ++i){
+                const lmath::Vector3& velocity = world.velocities_[i];
+                world.boxes_[i] = lmath::AABB(world.boxes_[i].bmin_+velocity, world.boxes_[i].bmax_+velocity);
+                world.tree_.moveProxy(world.proxies_[i], world.boxes_[i], velocity);
+            }
+            world.pairs_.clear();
+            lcore::bench::State::consume(world.tree_.queryPairs(world.pairs_));
+        }
+    }
+
+    void benchRaycast(lcore::bench::State& state)
+    {
+        World& world = getWorld();
+        while(state.next()){
+            s32 hits = 0;
+            for(s32 i=0; i<NumRays; ++i){
+                world.tree_.raycast(world.rays_[i], countHit, &hits);
+            }
+            lcore::bench::State::consume(hits);
+        }
+    }
+}
+
+    static lcore::bench::Registrar registrarCreate("DynamicAABBTree/create", NumObjects, benchCreate);
+    static lcore::bench::Registrar registrarUpdate("DynamicAABBTree/update", NumMoving, benchUpdate);
+    static lcore::bench::Registrar registrarRaycast("DynamicAABBTree/raycast", NumRays, benchRaycast);
+}
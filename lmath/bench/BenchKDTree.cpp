@@ -0,0 +1,125 @@
+﻿#include "Bench.h"
+#include <lcore/Random.h>
+#include "lmath.h"
+#include "geometry/KDTree.h"
+
+namespace lmath
+{
+namespace
+{
+    //ns/elemが点1つの構築時間, または問い合わせ1つの時間
+    static const u32 NumPoints = 200000;
+    static const s32 NumQueries = 4096;
+    static const s32 K = 8;
+
+    f32 frand(lcore::RandXorshift128Plus32& random, f32 low, f32 high)
+    {
+        return low + (high-low)*random.frand();
+    }
+
+    /// 光の経路の当たった点のような, 面に散らばった点
+    struct Points
+    {
+        Points()
+        {
+            lcore::RandXorshift128Plus32 random(12345);
+            for(u32 i=0; i<NumPoints; ++i){
+                f32 x = frand(random, -100.0f, 100.0f);
+                f32 z = frand(random, -100.0f, 100.0f);
+                f32 y = (0 == (i&0x03))? frand(random, 0.0f, 50.0f) : 0.0f;
+                points_[i] = lmath::Vector3::construct(x, y, z);
+            }
+            for(s32 i=0; i<NumQueries; ++i){
+                queries_[i] = points_[random.rand()%NumPoints];
+            }
+            tree_.build(NumPoints, points_);
+            selectTree_.build(NumPoints, points_, kdtree::PointKDTree::BuildMethod_Select);
+        }
+
+        lmath::Vector3 points_[NumPoints];
+        lmath::Vector3 queries_[NumQueries];
+        kdtree::PointKDTree tree_;
+        kdtree::PointKDTree selectTree_; ///< 分け方で問い合わせの速さが変わるかを比べる
+        kdtree::PointKDTree::Neighbor neighbors_[K];
+    };
+
+    Points& getPoints()
+    {
+        static Points points;
+        return points;
+    }
+
+    void benchBuildSelect(lcore::bench::State& state)
+    {
+        Points& points = getPoints();
+        kdtree::PointKDTree tree;
+        while(state.next()){
+            tree.build(NumPoints, points.points_, kdtree::PointKDTree::BuildMethod_Select);
+            lcore::bench::State::consume(tree.getNumNodes());
+        }
+    }
+
+    void benchBuildPresort(lcore::bench::State& state)
+    {
+        Points& points = getPoints();
+        kdtree::PointKDTree tree;
+        while(state.next()){
+            tree.build(NumPoints, points.points_, kdtree::PointKDTree::BuildMethod_Presort);
+            lcore::bench::State::consume(tree.getNumNodes());
+        }
+    }
+
+    void kNearest(lcore::bench::State& state, Points& points, const kdtree::PointKDTree& tree)
+    {
+        while(state.next()){
+            u64 count = 0;
+            for(s32 i=0; i<NumQueries; ++i){
+                count += tree.findKNearest(K, points.neighbors_, points.queries_[i]);
+            }
+            lcore::bench::State::consume(count);
+        }
+    }
+
+    void radius(lcore::bench::State& state, Points& points, const kdtree::PointKDTree& tree)
+    {
+        while(state.next()){
+            u64 count = 0;
+            for(s32 i=0; i<NumQueries; ++i){
+                count += tree.findRadius(K, points.neighbors_, points.queries_[i], 1.0f);
+            }
+            lcore::bench::State::consume(count);
+        }
+    }
+
+    void benchKNearest(lcore::bench::State& state)
+    {
+        Points& points = getPoints();
+        kNearest(state, points, points.tree_);
+    }
+
+    void benchKNearestSelect(lcore::bench::State& state)
+    {
+        Points& points = getPoints();
+        kNearest(state, points, points.selectTree_);
+    }
+
+    void benchRadius(lcore::bench::State& state)
+    {
+        Points& points = getPoints();
+        radius(state, points, points.tree_);
+    }
+
+    void benchRadiusSelect(lcore::bench::State& state)
+    {
+        Points& points = getPoints();
+        radius(state, points, points.selectTree_);
+    }
+}
+
+    static lcore::bench::Registrar registrarBuildSelect("KDTree/build_select", NumPoints, benchBuildSelect);
+    static lcore::bench::Registrar registrarBuildPresort("KDTree/build_presort", NumPoints, benchBuildPresort);
+    static lcore::bench::Registrar registrarKNearest("KDTree/knearest", NumQueries, benchKNearest);
+    static lcore::bench::Registrar registrarRadius("KDTree/radius", NumQueries, benchRadius);
+    static lcore::bench::Registrar registrarKNearestSelect("KDTree/knearest_select", NumQueries, benchKNearestSelect);
+    static lcore::bench::Registrar registrarRadiusSelect("KDTree/radius_select", NumQueries, benchRadiusSelect);
+}
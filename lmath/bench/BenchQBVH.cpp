@@ -0,0 +1,354 @@
+﻿#include "Bench.h"
+#include <lcore/Random.h>
+#include "lmath.h"
+#include "geometry/QBVH.h"
+#include "geometry/OBVH.h"
+#include "geometry/CompressedQBVH.h"
+#include "geometry/Ray.h"
+#include "geometry/Sphere.h"
+
+namespace lmath
+{
+namespace
+{
+    //1要素が光線1本. Melem/sが毎秒の光線数(百万本)
+    static const s32 ImageSize = 64;
+    static const s32 NumRays = ImageSize*ImageSize;
+    static const u32 NumClusters = 12;
+    static const u32 NumClusterFaces = 1500;
+    static const u32 NumFaces = 64*64*2 + NumClusters*NumClusterFaces;
+    static const u32 NumVertices = 65*65 + NumClusters*NumClusterFaces*3;
+
+    f32 frand(lcore::RandXorshift128Plus32& random, f32 low, f32 high)
+    {
+        return low + (high-low)*random.frand();
+    }
+
+    lmath::Vector3 getDirection(const lmath::Vector3& from, const lmath::Vector3& to)
+    {
+        lmath::Vector3 d = to;
+        d -= from;
+        d *= 1.0f/lmath::sqrt(d.x_*d.x_ + d.y_*d.y_ + d.z_*d.z_);
+        return d;
+    }
+
+    /// 地面と三角形の塊. 視点からの光線は2x4画素ごとに並べる
+    struct Scene
+    {
+        Scene()
+        {
+            lcore::RandXorshift128Plus32 random(12345);
+            QBVHConstructor::Vertex* vertices = vertices_;
+            QBVHConstructor::Face* faces = faces_;
+
+            u32 vertex = 0;
+            u32 face = 0;
+            for(u32 z=0; z<65; ++z){
+                for(u32 x=0; x<65; ++x){
+                    vertices[vertex++].position_.set(x*2.0f-64.0f, frand(random, -0.5f, 0.5f), z*2.0f-64.0f);
+                }
+            }
+            for(u32 z=0; z<64; ++z){
+                for(u32 x=0; x<64; ++x){
+                    u16 v = static_cast<u16>(z*65+x);
+                    setFace(faces[face++], v, static_cast<u16>(v+65), static_cast<u16>(v+1));
+                    setFace(faces[face++], static_cast<u16>(v+1), static_cast<u16>(v+65), static_cast<u16>(v+66));
+                }
+            }
+            lmath::Vector3 bmin = vertices[0].position_;
+            lmath::Vector3 bmax = vertices[0].position_;
+            for(u32 i=0; i<NumClusters; ++i){
+                lmath::Vector3 center = lmath::Vector3::construct(frand(random, -50.0f, 50.0f), frand(random, 2.0f, 20.0f), frand(random, -50.0f, 50.0f));
+                for(u32 j=0; j<NumClusterFaces; ++j){
+                    lmath::Vector3 p = lmath::Vector3::construct(frand(random, -4.0f, 4.0f), frand(random, -4.0f, 4.0f), frand(random, -4.0f, 4.0f));
+                    p += center;
+                    u16 v = static_cast<u16>(vertex);
+                    for(u32 k=0; k<3; ++k){
+                        vertices[vertex].position_ = p;
+                        vertices[vertex].position_ += lmath::Vector3::construct(frand(random, -0.5f, 0.5f), frand(random, -0.5f, 0.5f), frand(random, -0.5f, 0.5f));
+                        ++vertex;
+                    }
+                    setFace(faces[face++], v, static_cast<u16>(v+1), static_cast<u16>(v+2));
+                }
+            }
+            for(u32 i=1; i<NumVertices; ++i){
+                bmin = lmath::minimum(bmin, vertices[i].position_);
+                bmax = lmath::maximum(bmax, vertices[i].position_);
+            }
+            bmin_ = bmin;
+            bmax_ = bmax;
+
+            QBVHConstructor constructor;
+            constructor.setSplitMethod(QBVHConstructor::SplitMethod_BinnedSAH);
+            construct(constructor);
+            qbvh_.copyFrom(constructor);
+            obvh_.copyFrom(constructor);
+            compressed_.copyFrom(constructor);
+
+            QBVHConstructor median;
+            construct(median);
+            median_.copyFrom(median);
+
+            //視点から見下ろす光線. 8本の束は2x2を2つ並べた2x4画素
+            lmath::Vector3 eye = lmath::Vector3::construct(0.0f, 40.0f, -90.0f);
+            s32 ray = 0;
+            for(s32 ty=0; ty<ImageSize; ty+=2){
+                for(s32 tx=0; tx<ImageSize; tx+=4){
+                    for(s32 i=0; i<8; ++i){
+                        s32 x = tx + (i>>2)*2 + (i&0x01);
+                        s32 y = ty + ((i>>1)&0x01);
+                        lmath::Vector3 target = lmath::Vector3::construct(x*2.0f-64.0f, 0.0f, 64.0f-y*2.0f);
+                        coherent_[ray++] = lmath::Ray(eye, getDirection(eye, target), 1000.0f);
+                    }
+                }
+            }
+
+            for(s32 i=0; i<NumRays; ++i){
+                lmath::Vector3 origin = lmath::Vector3::construct(frand(random, -80.0f, 80.0f), frand(random, -10.0f, 40.0f), frand(random, -80.0f, 80.0f));
+                lmath::Vector3 target = lmath::Vector3::construct(frand(random, -60.0f, 60.0f), frand(random, -1.0f, 20.0f), frand(random, -60.0f, 60.0f));
+                incoherent_[i] = lmath::Ray(origin, getDirection(origin, target), 1000.0f);
+            }
+        }
+
+        /// 構築は頂点と面の所有権を取るので複製を渡す
+        void construct(QBVHConstructor& constructor) const
+        {
+            QBVHConstructor::Vertex* vertices = LNEW QBVHConstructor::Vertex[NumVertices];
+            QBVHConstructor::Face* faces = LNEW QBVHConstructor::Face[NumFaces];
+            lcore::memcpy(vertices, vertices_, sizeof(QBVHConstructor::Vertex)*NumVertices);
+            lcore::memcpy(faces, faces_, sizeof(QBVHConstructor::Face)*NumFaces);
+            constructor.construct(NumVertices, vertices, NumFaces, faces, bmin_, bmax_);
+        }
+
+        static void setFace(QBVHConstructor::Face& face, u16 v0, u16 v1, u16 v2)
+        {
+            face.normal_ = lmath::Vector3::zero();
+            face.v0_ = v0;
+            face.v1_ = v1;
+            face.v2_ = v2;
+            face.reserved_ = 0;
+        }
+
+        QBVHConstructor::Vertex vertices_[NumVertices];
+        QBVHConstructor::Face faces_[NumFaces];
+        lmath::Vector3 bmin_;
+        lmath::Vector3 bmax_;
+        QBVH qbvh_; ///< ビン分割したSAHで構築
+        QBVH median_; ///< 空間の中央値で構築
+        OBVH obvh_; ///< AVXがなければQBVHと同じ
+        CompressedQBVH compressed_;
+        lmath::Ray coherent_[NumRays];
+        lmath::Ray incoherent_[NumRays];
+        QBVH::HitRecord hitRecords_[NumRays];
+        QBVH::SweepRecord sweepRecords_[NumRays];
+        QBVH::NearestRecord nearestRecords_[NumRays];
+        bool occluded_[NumRays];
+        u32 work_[NumRays];
+    };
+
+    Scene& getScene()
+    {
+        static Scene scene;
+        return scene;
+    }
+
+    void benchSingle(lcore::bench::State& state, const lmath::Ray* rays)
+    {
+        Scene& scene = getScene();
+        while(state.next()){
+            u64 hits = 0;
+            for(s32 i=0; i<NumRays; ++i){
+                hits += scene.qbvh_.test(scene.hitRecords_[i], rays[i])? 1 : 0;
+            }
+            lcore::bench::State::consume(hits);
+        }
+    }
+
+    void benchSingleMedian(lcore::bench::State& state, const lmath::Ray* rays)
+    {
+        Scene& scene = getScene();
+        while(state.next()){
+            u64 hits = 0;
+            for(s32 i=0; i<NumRays; ++i){
+                hits += scene.median_.test(scene.hitRecords_[i], rays[i])? 1 : 0;
+            }
+            lcore::bench::State::consume(hits);
+        }
+    }
+
+    void benchPacket4(lcore::bench::State& state, const lmath::Ray* rays)
+    {
+        Scene& scene = getScene();
+        while(state.next()){
+            u64 hits = 0;
+            for(s32 i=0; i<NumRays; i+=4){
+                hits += scene.qbvh_.test4(scene.hitRecords_+i, rays+i);
+            }
+            lcore::bench::State::consume(hits);
+        }
+    }
+
+    void benchPacket8(lcore::bench::State& state, const lmath::Ray* rays)
+    {
+        Scene& scene = getScene();
+        while(state.next()){
+            u64 hits = 0;
+            for(s32 i=0; i<NumRays; i+=8){
+                hits += scene.qbvh_.test8(scene.hitRecords_+i, rays+i);
+            }
+            lcore::bench::State::consume(hits);
+        }
+    }
+
+    void benchOcclusion(lcore::bench::State& state, const lmath::Ray* rays)
+    {
+        Scene& scene = getScene();
+        while(state.next()){
+            u64 hits = 0;
+            for(s32 i=0; i<NumRays; ++i){
+                hits += scene.qbvh_.testOcclusion(rays[i])? 1 : 0;
+            }
+            lcore::bench::State::consume(hits);
+        }
+    }
+
+    void benchCompressed(lcore::bench::State& state, const lmath::Ray* rays)
+    {
+        Scene& scene = getScene();
+        while(state.next()){
+            u64 hits = 0;
+            for(s32 i=0; i<NumRays; ++i){
+                hits += scene.compressed_.test(scene.hitRecords_[i], rays[i])? 1 : 0;
+            }
+            lcore::bench::State::consume(hits);
+        }
+    }
+
+    void benchOBVH(lcore::bench::State& state, const lmath::Ray* rays)
+    {
+        Scene& scene = getScene();
+        while(state.next()){
+            u64 hits = 0;
+            for(s32 i=0; i<NumRays; ++i){
+                hits += scene.obvh_.test(scene.hitRecords_[i], rays[i])? 1 : 0;
+            }
+            lcore::bench::State::consume(hits);
+        }
+    }
+
+    void benchOBVHOcclusion(lcore::bench::State& state, const lmath::Ray* rays)
+    {
+        Scene& scene = getScene();
+        while(state.next()){
+            u64 hits = 0;
+            for(s32 i=0; i<NumRays; ++i){
+                hits += scene.obvh_.testOcclusion(rays[i])? 1 : 0;
+            }
+            lcore::bench::State::consume(hits);
+        }
+    }
+
+    void benchOcclusion8(lcore::bench::State& state, const lmath::Ray* rays)
+    {
+        Scene& scene = getScene();
+        while(state.next()){
+            u64 hits = 0;
+            for(s32 i=0; i<NumRays; i+=8){
+                hits += scene.qbvh_.testOcclusion8(rays+i);
+            }
+            lcore::bench::State::consume(hits);
+        }
+    }
+
+    void benchStream(lcore::bench::State& state, const lmath::Ray* rays)
+    {
+        Scene& scene = getScene();
+        while(state.next()){
+            lcore::bench::State::consume(scene.qbvh_.testStream(NumRays, scene.hitRecords_, rays, scene.work_));
+        }
+    }
+
+    void benchOcclusionStream(lcore::bench::State& state, const lmath::Ray* rays)
+    {
+        Scene& scene = getScene();
+        while(state.next()){
+            lcore::bench::State::consume(scene.qbvh_.testOcclusionStream(NumRays, scene.occluded_, rays, scene.work_));
+        }
+    }
+
+    //光線の原点から半径0.5の球を10動かす
+    void benchSweptSphere(lcore::bench::State& state)
+    {
+        Scene& scene = getScene();
+        while(state.next()){
+            u64 hits = 0;
+            for(s32 i=0; i<NumRays; ++i){
+                const lmath::Ray& ray = scene.incoherent_[i];
+                hits += scene.qbvh_.testSweptSphere(scene.sweepRecords_[i], lmath::Sphere(ray.origin_, 0.5f), ray.direction_, 10.0f)? 1 : 0;
+            }
+            lcore::bench::State::consume(hits);
+        }
+    }
+
+    //ns/elemが面1つの構築時間
+    void benchBuild(lcore::bench::State& state, QBVHConstructor::SplitMethod method)
+    {
+        Scene& scene = getScene();
+        while(state.next()){
+            QBVHConstructor constructor;
+            constructor.setSplitMethod(method);
+            state.start();
+            scene.construct(constructor);
+            state.stop();
+            lcore::bench::State::consume(constructor.getNumNodes());
+        }
+    }
+
+    void benchBuildMedian(lcore::bench::State& state)
+    {
+        benchBuild(state, QBVHConstructor::SplitMethod_Median);
+    }
+
+    void benchBuildBinnedSAH(lcore::bench::State& state)
+    {
+        benchBuild(state, QBVHConstructor::SplitMethod_BinnedSAH);
+    }
+
+    void benchNearest(lcore::bench::State& state)
+    {
+        Scene& scene = getScene();
+        while(state.next()){
+            u64 hits = 0;
+            for(s32 i=0; i<NumRays; ++i){
+                hits += scene.qbvh_.findNearest(scene.nearestRecords_[i], scene.incoherent_[i].origin_, 20.0f)? 1 : 0;
+            }
+            lcore::bench::State::consume(hits);
+        }
+    }
+}
+
+#define LBENCH_QBVH(name, proc) \
+    static void benchCoherent##proc(lcore::bench::State& state){ proc(state, getScene().coherent_);} \
+    static void benchIncoherent##proc(lcore::bench::State& state){ proc(state, getScene().incoherent_);} \
+    static lcore::bench::Registrar registrarCoherent##proc("QBVH/coherent/" name, NumRays, benchCoherent##proc); \
+    static lcore::bench::Registrar registrarIncoherent##proc("QBVH/incoherent/" name, NumRays, benchIncoherent##proc);
+
+    LBENCH_QBVH("single", benchSingle)
+    LBENCH_QBVH("single_median", benchSingleMedian)
+    LBENCH_QBVH("packet4", benchPacket4)
+    LBENCH_QBVH("packet8", benchPacket8)
+    LBENCH_QBVH("stream", benchStream)
+    LBENCH_QBVH("occlusion", benchOcclusion)
+    LBENCH_QBVH("occlusion8", benchOcclusion8)
+    LBENCH_QBVH("occlusion_stream", benchOcclusionStream)
+    LBENCH_QBVH("obvh", benchOBVH)
+    LBENCH_QBVH("compressed", benchCompressed)
+    LBENCH_QBVH("obvh_occlusion", benchOBVHOcclusion)
+
+#undef LBENCH_QBVH
+
+    static lcore::bench::Registrar registrarBuildMedian("QBVH/build_median", NumFaces, benchBuildMedian);
+    static lcore::bench::Registrar registrarBuildBinnedSAH("QBVH/build_sah", NumFaces, benchBuildBinnedSAH);
+    static lcore::bench::Registrar registrarSweptSphere("QBVH/swept_sphere", NumRays, benchSweptSphere);
+    static lcore::bench::Registrar registrarNearest("QBVH/nearest", NumRays, benchNearest);
+}
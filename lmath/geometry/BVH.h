@@ -5,9 +5,12 @@
 @author t-sakai
 @date 2010/02/07 create
 */
+#include <lcore/Array.h>
 #include "../lmath.h"
 #include "../Vector3.h"
 #include "Ray.h"
+#include "RayTest.h"
+#include "QBVH.h"
 
 namespace lmath
 {
@@ -245,13 +248,14 @@ namespace bvh
     public:
         typedef BVHNode node_type;
         typedef TAlgorithm BVHAlgo;
-        typedef lcore::simple_vector_arena<BVHNode> NodeVector;
+        typedef lcore::Array<BVHNode> NodeVector;
         typedef THitRecord hit_record_type;
 
         BVH()
             :numEntries_(0)
             ,entries_(NULL)
             ,hit_(false)
+            ,buildSAHCost_(0.0f)
 
 #if defined(LMATH_BVH_SUMMARIZE_INFO)
             ,totalLeafs_(0)
@@ -269,8 +273,31 @@ namespace bvh
         bool hit(hit_record_type& hitRecord, const Ray& ray);
 
         void build(T* entries, u32 numEntries);
+
+        /**
+        @brief 要素の箱が変わった後, ノードの箱を葉から根へ計算し直す. 木の形と要素の並びは変わらない
+        */
+        void refit();
+
+        /// 現在の木のSAHコスト. 根の表面積に対するノード, 要素の判定回数の期待値
+        f32 calcSAHCost(f32 traversalCost=1.0f, f32 intersectionCost=1.0f) const;
+
+        /// 構築直後のSAHコスト
+        f32 getBuildSAHCost() const{ return buildSAHCost_;}
+
+        /**
+        @brief 再適合を続けて木の質が落ちたか
+        @param ratio ... 構築直後に対する現在のSAHコストの比がこれを越えたら作り直す. 既定値はQBVHと共通
+        */
+        bool isRebuildRequired(f32 ratio=QBVH::DefaultRebuildRatio) const{ return buildSAHCost_*ratio < calcSAHCost();}
     private:
-        template<class T, class THitRecord> friend class DebugOut;
+        static f32 halfArea(const BVHNode& node)
+        {
+            Vector3 d = node.bboxMax_;
+            d -= node.bboxMin_;
+            return d.x_*d.y_ + d.y_*d.z_ + d.z_*d.x_;
+        }
+        template<class U, class V> friend class DebugOut;
 
         void hitInternal(s32 current, const Ray& ray);
 
@@ -284,6 +311,7 @@ namespace bvh
 
         bool hit_;
         hit_record_type hitRecord_;
+        f32 buildSAHCost_;
 
 #if defined(LMATH_BVH_SUMMARIZE_INFO)
     public:
@@ -337,7 +365,7 @@ namespace bvh
         if(axis == BVHNode::Axis_Leaf){
             u32 index = node.items_.index_;
             u32 num = node.items_.numItems_;
-            HitRecord hitRecord;
+            hit_record_type hitRecord;
             for(u32 i=0; i<num; ++i){
                 const T &entry = entries_[index+i];
                 bool ret = entry.hit(hitRecord, ray);
@@ -379,6 +407,56 @@ namespace bvh
         nodes_.resize(numEntries_ * 2);
 
         buildInternal(0, entries, numEntries_, 0, 0);
+        buildSAHCost_ = calcSAHCost();
+    }
+
+    //--------------------------------------------------------
+    template<class T, class THitRecord, class TAlgorithm>
+    void BVH<T, THitRecord, TAlgorithm>::refit()
+    {
+        if(numEntries_<=0){
+            return;
+        }
+
+        //子は親より後ろにあるので, 後ろから処理すれば子の箱は計算済み
+        for(u32 i=endNode_; 0<i; --i){
+            BVHNode& node = nodes_[i-1];
+            if(node.getFlag() == BVHNode::Axis_Leaf){
+                BVHAlgo::calcBBox(node.bboxMin_, node.bboxMax_, entries_+node.items_.index_, node.items_.numItems_);
+            }else{
+                const BVHNode& left = nodes_[node.getLeftChildIndex()];
+                const BVHNode& right = nodes_[node.getLeftChildIndex()+1];
+                node.bboxMin_ = lmath::minimum(left.bboxMin_, right.bboxMin_);
+                node.bboxMax_ = lmath::maximum(left.bboxMax_, right.bboxMax_);
+            }
+        }
+    }
+
+    //--------------------------------------------------------
+    template<class T, class THitRecord, class TAlgorithm>
+    f32 BVH<T, THitRecord, TAlgorithm>::calcSAHCost(f32 traversalCost, f32 intersectionCost) const
+    {
+        if(numEntries_<=0){
+            return 0.0f;
+        }
+        f32 rootArea = halfArea(nodes_[0]);
+        if(rootArea<=LMATH_F32_EPSILON){
+            //全て1点に縮退している
+            return traversalCost + intersectionCost*numEntries_;
+        }
+
+        f32 invRootArea = 1.0f/rootArea;
+        f32 cost = 0.0f;
+        for(u32 i=0; i<endNode_; ++i){
+            const BVHNode& node = nodes_[i];
+            f32 area = halfArea(node)*invRootArea;
+            if(node.getFlag() == BVHNode::Axis_Leaf){
+                cost += intersectionCost*node.items_.numItems_*area;
+            }else{
+                cost += traversalCost*area;
+            }
+        }
+        return cost;
     }
 
     //--------------------------------------------------------
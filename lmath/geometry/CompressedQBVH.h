@@ -0,0 +1,148 @@
+﻿#ifndef INC_LMATH_COMPRESSEDQBVH_H__
+#define INC_LMATH_COMPRESSEDQBVH_H__
+/**
+@file CompressedQBVH.h
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "QBVH.h"
+
+namespace lmath
+{
+    //----------------------------------------------------
+    //---
+    //--- CompressedQBVH
+    //---
+    //----------------------------------------------------
+    /**
+    @brief 子の箱を8bitに量子化したQBVH. 1ノード64バイトで, キャッシュライン1つに子4つが収まる
+
+    子の箱はノードの箱の最小を原点に, 軸ごとに2のべき乗の刻み幅で表す.
+    最小は切り下げ, 最大は切り上げるので, 復号した箱は元の箱を必ず含む.
+    交差する三角形は元の木と同じ.
+
+    ノード, 頂点, 面は1つのイメージに並べる. saveしたファイルをそのままメモリに写像してattachで使える.
+    イメージは実行環境のバイト順.
+    */
+    class CompressedQBVH
+    {
+    public:
+        static const u32 TestStackSize = QBVH::TestStackSize;
+        static const u32 Magic = 0x56425143U; //'CQBV'
+        static const u32 Version = 1;
+        /// イメージの先頭とノードの揃え
+        static const u32 Alignment = 64;
+
+        typedef QBVH::Face Face;
+        typedef QBVH::Vertex Vertex;
+        typedef QBVH::HitRecord HitRecord;
+
+        struct Node
+        {
+            static const u32 EmptyMask = QBVHConstructor::Node::EmptyMask;
+            static const u32 LeafMask = QBVHConstructor::Node::LeafMask;
+
+            static bool isLeaf(u32 child)
+            {
+                return (LeafMask&child) != 0;
+            }
+
+            static bool isEmpty(u32 child)
+            {
+                return EmptyMask == child;
+            }
+
+            static u32 getFaceIndex(u32 child)
+            {
+                return QBVHConstructor::Node::getFaceIndex(child);
+            }
+
+            static u32 getFaceNum(u32 child)
+            {
+                return QBVHConstructor::Node::getFaceNum(child);
+            }
+
+            s32 getAxis0() const{ return axis_&0x03;}
+            s32 getAxis1() const{ return (axis_>>2)&0x03;}
+            s32 getAxis2() const{ return (axis_>>4)&0x03;}
+
+            f32 origin_[3]; ///< ノードの箱の最小
+            u8 exponent_[3]; ///< 軸ごとの刻み幅. 単精度の指数部で, 2^(exponent_-127)
+            u8 axis_; ///< axis0 | axis1<<2 | axis2<<4
+            u8 bbox_[2][3][4]; ///< [最小, 最大][軸][子]. 空きは最小255, 最大0
+            u32 children_[4];
+            u32 reserved_[2];
+        };
+
+        /// イメージの先頭
+        struct Header
+        {
+            u32 magic_;
+            u32 version_;
+            u32 numNodes_;
+            u32 numVertices_;
+            u32 numFaces_;
+            u32 reserved_;
+            f32 bmin_[3];
+            f32 bmax_[3];
+            u64 verticesOffset_;
+            u64 facesOffset_;
+            u64 size_; ///< イメージ全体のバイト数
+        };
+
+        /// 子の箱を復号する. 空きは最小>最大になる
+        static void decode(lm128 bbox[2][3], const Node& node);
+
+        CompressedQBVH();
+        ~CompressedQBVH();
+
+        void copyFrom(const QBVHConstructor& constructor);
+
+        bool save(const Char* filepath) const;
+
+        /// ファイルを読み込み, 確保したイメージを持つ
+        bool load(const Char* filepath);
+
+        /**
+        @brief 外部のイメージをコピーせずに使う. 写像したファイルなど
+        @param image ... Alignmentに揃っていること. 使い終わるまで解放しない
+        @param size ... imageのバイト数
+        */
+        bool attach(const void* image, s64 size);
+
+        void clear();
+
+        bool test(HitRecord& hitRecord, const lmath::Ray& localRay) const;
+
+        u32 getNumNodes() const{ return numNodes_;}
+        const Node& getNode(u32 index) const{ return nodes_[index];}
+
+        /// イメージ全体のバイト数
+        s64 getImageSize() const{ return (NULL == header_)? 0 : static_cast<s64>(header_->size_);}
+        const void* getImage() const{ return header_;}
+
+        void getBBox(lmath::Vector3& bmin, lmath::Vector3& bmax) const
+        {
+            bmin = bmin_;
+            bmax = bmax_;
+        }
+    private:
+        CompressedQBVH(const CompressedQBVH&);
+        CompressedQBVH& operator=(const CompressedQBVH&);
+
+        static void encode(Node& node, const QBVHConstructor::Node& src);
+        static void setPointers(const Header* header, const Node*& nodes, const Vertex*& vertices, const Face*& faces);
+
+        void* owned_; ///< 自分で確保したイメージ. attachならNULL
+        const Header* header_;
+        u32 numNodes_;
+        const Node* nodes_;
+        const Vertex* vertices_;
+        u32 numFaces_;
+        const Face* faces_;
+
+        lmath::Vector3 bmin_;
+        lmath::Vector3 bmax_;
+    };
+}
+#endif //INC_LMATH_COMPRESSEDQBVH_H__
@@ -0,0 +1,200 @@
+﻿#ifndef INC_LMATH_DYNAMICAABBTREE_H__
+#define INC_LMATH_DYNAMICAABBTREE_H__
+/**
+@file DynamicAABBTree.h
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include <lcore/Array.h>
+#include "../lmath.h"
+#include "AABB.h"
+
+namespace lmath
+{
+    class Ray;
+
+    //----------------------------------------------------
+    //---
+    //--- DynamicAABBTree
+    //---
+    //----------------------------------------------------
+    /**
+    @brief 追加, 削除, 移動ができるAABBの2分木. 衝突判定の広域判定用
+
+    葉には余裕を持たせた太い箱を入れる. 太い箱からはみ出すまで移動しても木は変わらない.
+    追加は面積の増え方が小さい兄弟を選び, 祖先を戻りながら高さの差が2以上なら回転する.
+    回転で下がった節点も差が1以下になるまで回転するので, 全ての節点で子の高さの差は1以下.
+    節点は配列に確保して, 空いた節点はリストでつなぐ.
+
+    木が変わった葉は移動バッファに入る. queryPairsは移動バッファの葉だけ木を問い合わせるので,
+    毎回の手間は全体の数ではなく動いた数に比例する.
+    */
+    class DynamicAABBTree
+    {
+    public:
+        static const s32 Invalid = -1;
+        static const s32 TestStackSize = 128;
+
+        /// 太い箱の余白
+        static const f32 DefaultMargin;
+        /// 移動量を太い箱に足す倍率
+        static const f32 DisplacementMultiplier;
+
+        struct Node
+        {
+            bool isLeaf() const
+            {
+                return Invalid == child0_;
+            }
+
+            AABB bbox_;
+            void* userData_;
+            union
+            {
+                s32 parent_;
+                s32 next_; ///< 空き節点のリスト
+            };
+            s32 child0_;
+            s32 child1_;
+            s32 height_; ///< 葉が0, 空きは-1
+            bool moved_;
+        };
+
+        /// 重なった太い箱の組. proxy0_<proxy1_
+        struct Pair
+        {
+            s32 proxy0_;
+            s32 proxy1_;
+        };
+
+        /**
+        @brief 光線の問い合わせで葉ごとに呼ぶ
+        @return 光線の新しい長さ. 0以下なら打ち切り, ray.t_ならそのまま続ける
+        */
+        typedef f32(*RaycastCallback)(void* data, s32 proxy, const Ray& ray);
+
+        explicit DynamicAABBTree(f32 margin = DefaultMargin);
+        ~DynamicAABBTree();
+
+        void clear();
+
+        /**
+        @brief 追加する
+        @return 代理番号
+        */
+        s32 createProxy(const AABB& bbox, void* userData);
+
+        void destroyProxy(s32 proxy);
+
+        /**
+        @brief 移動する
+        @return 木を変えたらtrue. 太い箱に収まっていればfalse
+        @param displacement ... 予測する移動量. 太い箱をこの方向に伸ばす
+        */
+        bool moveProxy(s32 proxy, const AABB& bbox, const Vector3& displacement);
+
+        /// 移動バッファに入れる. 次のqueryPairsで組を調べ直す
+        void touchProxy(s32 proxy);
+
+        inline void* getUserData(s32 proxy) const;
+        inline const AABB& getFatAABB(s32 proxy) const;
+        inline bool wasMoved(s32 proxy) const;
+
+        inline s32 getNumProxies() const;
+        inline s32 getNumMoved() const;
+        inline f32 getMargin() const;
+
+        /// 根の高さ. 空なら0
+        s32 getHeight() const;
+
+        /// 子の高さの差の最大
+        s32 getMaxBalance() const;
+
+        /// 全節点の面積の和と根の面積の比. 木の質の目安
+        f32 getAreaRatio() const;
+
+        /// 親子のつながり, 箱, 高さを確かめる
+        bool validate() const;
+
+        /**
+        @brief 太い箱がbboxと重なる代理を集める
+        @return 重なった数. maxProxiesを超えた分は数だけ返す
+        */
+        s32 queryOverlap(s32 maxProxies, s32* proxies, const AABB& bbox) const;
+
+        /**
+        @brief 太い箱に光線が当たる代理をcallbackに渡す. 近い箱から順にたどる
+        @return callbackを呼んだ数
+        */
+        s32 raycast(const Ray& ray, RaycastCallback callback, void* data) const;
+
+        /**
+        @brief 移動バッファの代理と太い箱が重なる組を足して, 移動バッファを空にする
+        @return 足した組の数
+
+        動いた代理同士の組は1度だけ足す. 止まっている代理同士の組は足さない.
+        */
+        s32 queryPairs(lcore::Array<Pair>& pairs);
+
+    private:
+        DynamicAABBTree(const DynamicAABBTree&) = delete;
+        DynamicAABBTree& operator=(const DynamicAABBTree&) = delete;
+
+        s32 allocateNode();
+        void releaseNode(s32 index);
+
+        void insertLeaf(s32 leaf);
+        void removeLeaf(s32 leaf);
+        void refit(s32 index);
+        void update(s32 index);
+        s32 balance(s32 index);
+        s32 rotate(s32 index, s32 child);
+
+        void getFatAABB(AABB& fat, const AABB& bbox, const Vector3& displacement) const;
+        void pushMoved(s32 proxy);
+        bool validate(s32 index, s32 parent) const;
+
+        f32 margin_;
+        s32 root_;
+        s32 capacity_;
+        s32 numNodes_;
+        s32 numProxies_;
+        s32 freeList_;
+        Node* nodes_;
+        lcore::Array<s32> moveBuffer_;
+    };
+
+    inline void* DynamicAABBTree::getUserData(s32 proxy) const
+    {
+        LASSERT(0<=proxy && proxy<capacity_);
+        return nodes_[proxy].userData_;
+    }
+
+    inline const AABB& DynamicAABBTree::getFatAABB(s32 proxy) const
+    {
+        LASSERT(0<=proxy && proxy<capacity_);
+        return nodes_[proxy].bbox_;
+    }
+
+    inline bool DynamicAABBTree::wasMoved(s32 proxy) const
+    {
+        LASSERT(0<=proxy && proxy<capacity_);
+        return nodes_[proxy].moved_;
+    }
+
+    inline s32 DynamicAABBTree::getNumProxies() const
+    {
+        return numProxies_;
+    }
+
+    inline s32 DynamicAABBTree::getNumMoved() const
+    {
+        return moveBuffer_.size();
+    }
+
+    inline f32 DynamicAABBTree::getMargin() const
+    {
+        return margin_;
+    }
+}
+#endif //INC_LMATH_DYNAMICAABBTREE_H__
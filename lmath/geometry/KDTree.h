@@ -12,6 +12,11 @@
 #include <lcore/Array.h>
 #include "Ray.h"
 
+namespace lcore
+{
+    class ThreadPool;
+}
+
 namespace lmath
 {
     namespace kdtree
@@ -251,8 +256,8 @@ namespace lmath
         void BKDAlgorithm<T>::calcBBox(f32& bmin, f32& bmax, const T* entries, u32 numEntries, s32 axis)
         {
             LASSERT(entries!=NULL);
-            f32 bmin = std::numeric_limits<f32>::max();
-            f32 bmax = -std::numeric_limits<f32>::max();
+            bmin = std::numeric_limits<f32>::max();
+            bmax = -std::numeric_limits<f32>::max();
 
             for(u32 i=0; i<numEntries; ++i){
                 const Vector3& tmin = entries[i].getBBoxMin();
@@ -311,7 +316,7 @@ namespace lmath
             median.set(0.0f, 0.0f, 0.0f);
             f32 invSize = 1.0f / numEntries;
 
-            for(u32 i=0; i<numEntries_; ++i){
+            for(u32 i=0; i<numEntries; ++i){
                 const Vector3 &tmedian = entries[i].getMedian();
                 median += tmedian;
             }
@@ -358,7 +363,7 @@ namespace lmath
         public:
             typedef BKDNode node_type;
             typedef TAlgorithm BKDAlgo;
-            typedef lcore::simple_vector_arena<BKDNode> NodeVector;
+            typedef lcore::Array<BKDNode> NodeVector;
             typedef THitRecord hit_record_type;
 
             static const f64 EPSILON;
@@ -384,7 +389,7 @@ namespace lmath
 
             void build(T* entries, u32 numEntries);
         private:
-            template<class T, class THitRecord> friend class DebugOut;
+            template<class U, class V> friend class DebugOut;
 
             bool hitInternal(s32 current, const Ray& ray, const Vector3& bmin, const Vector3& bmax);
 
@@ -412,7 +417,7 @@ namespace lmath
             {
                 for(s32 i=0; i<3; ++i){
                     if(bmin[i] > bmax[i]){
-                        lmath::swap(bmin[i], bmax[i]);
+                        lcore::swap(bmin[i], bmax[i]);
                     }
                 }
             }
@@ -504,7 +509,7 @@ namespace lmath
             hitRecord_.shape_ = NULL;
             hit_ = false;
 
-            f64 tmin, tmax;
+            f32 tmin, tmax;
             bool hitTop = lmath::testRayAABB(tmin, tmax, ray, bboxMin_, bboxMax_);
             if(!hitTop){
                 return false;
@@ -538,7 +543,7 @@ namespace lmath
             if(axis == BKDNode::Axis_Leaf){
                 u32 index = node.items_.index_;
                 u32 num = node.items_.numItems_;
-                HitRecord hitRecord;
+                hit_record_type hitRecord;
                 bool tmpHit = false;
                 for(u32 i=0; i<num; ++i){
                     const T &entry = entries_[index+i];
@@ -689,6 +694,130 @@ namespace lmath
 
         }
 
+
+        //--------------------------------------------------------------
+        //---
+        //--- PointKDTree
+        //---
+        //--------------------------------------------------------------
+        /**
+        @brief 点のkd木. k近傍と固定半径の問い合わせ
+
+        節点はBKDNodeで, 左右の子の点の範囲で切る. 葉の点は4つずつSoAにまとめ, 4点の距離を同時に計算する.
+        */
+        class PointKDTree
+        {
+        public:
+            static const u32 MaxLeafPoints = 8;
+            static const u32 TestStackSize = 64;
+            /// 木の深さの上限. 越えたら葉にする
+            static const u32 MaxDepth = TestStackSize-1;
+            /// まとめた問い合わせを並列にするとき, 1つのジョブで処理する数
+            static const u32 QueryChunkSize = 64;
+            static const u32 InvalidIndex = (u32)-1;
+
+            enum BuildMethod
+            {
+                BuildMethod_Select = 0, ///< BKDAlgorithmで平均で分ける
+                BuildMethod_Presort, ///< 軸ごとに1度だけソートし, 中央で分ける. O(n log n)
+            };
+
+            /// 葉の4点. 空きは無限遠でInvalidIndex
+            struct Point4
+            {
+                f32 x_[4];
+                f32 y_[4];
+                f32 z_[4];
+                u32 index_[4];
+            };
+
+            struct Neighbor
+            {
+                u32 index_; ///< build時の点の番号
+                f32 distanceSqr_;
+            };
+
+            PointKDTree();
+            ~PointKDTree();
+
+            void build(u32 numPoints, const Vector3* points, BuildMethod method=BuildMethod_Presort);
+            void clear();
+
+            /**
+            @brief k近傍
+            @return neighborsに書いた数. 近い順
+            @param neighbors ... k個
+            @param maxDistance ... これより遠い点は探さない
+            */
+            s32 findKNearest(s32 k, Neighbor* neighbors, const Vector3& point, f32 maxDistance=lcore::numeric_limits<f32>::maximum()) const;
+
+            /**
+            @brief 半径内の点. 順不同
+            @return 半径内の点の数. maxNeighborsを越えた分は書かない
+            */
+            s32 findRadius(s32 maxNeighbors, Neighbor* neighbors, const Vector3& point, f32 radius) const;
+
+            /**
+            @brief まとめたk近傍
+            @return 見つけた点の総数
+            @param counts ... numPoints個. 点ごとに書いた数
+            @param neighbors ... numPoints*k個. i番目の点はneighbors[i*k]から
+            @param threadPool ... NULLでなければQueryChunkSizeずつ並列に処理する
+            */
+            s32 findKNearest(s32 numPoints, s32* counts, s32 k, Neighbor* neighbors, const Vector3* points, f32 maxDistance, lcore::ThreadPool* threadPool=NULL) const;
+
+            /// @param neighbors ... numPoints*maxNeighbors個
+            s32 findRadius(s32 numPoints, s32* counts, s32 maxNeighbors, Neighbor* neighbors, const Vector3* points, f32 radius, lcore::ThreadPool* threadPool=NULL) const;
+
+            u32 getNumPoints() const{ return numPoints_;}
+            u32 getNumNodes() const{ return nodes_.size();}
+            const BKDNode& getNode(u32 index) const{ return nodes_[index];}
+            u32 getNumBlocks() const{ return numBlocks_;}
+            const Point4& getBlock(u32 index) const{ return blocks_[index];}
+            u32 getDepth() const{ return depth_;}
+
+            void getBBox(Vector3& bmin, Vector3& bmax) const
+            {
+                bmin = bmin_;
+                bmax = bmax_;
+            }
+        private:
+            PointKDTree(const PointKDTree&);
+            PointKDTree& operator=(const PointKDTree&);
+
+            /// BKDAlgorithmに渡す点
+            struct Entry
+            {
+                const Vector3& getBBoxMin() const{ return position_;}
+                const Vector3& getBBoxMax() const{ return position_;}
+                const Vector3& getMedian() const{ return position_;}
+
+                Vector3 position_;
+                u32 index_;
+            };
+
+            struct QueryJob;
+            struct PresortFunc;
+
+            static void kNearestProc(void* data, u32 chunk);
+            static void radiusProc(void* data, u32 chunk);
+            static void processQueries(lcore::ThreadPool* threadPool, void (*proc)(void*, u32), QueryJob& job);
+
+            u32 addNodes();
+            void setLeaf(u32 nodeIndex, u32 numPoints, u32 depth);
+            void buildSelect(u32 nodeIndex, Entry* entries, u32 numEntries, u32 depth, s32 axis);
+            void buildPresort(u32 nodeIndex, u32* sorted[3], u32* work, u8* side, const Vector3* points, u32 begin, u32 numPoints, u32 depth);
+            void fillBlocks(const u32* order, const Vector3* points);
+
+            u32 numPoints_;
+            u32 depth_;
+            Vector3 bmin_;
+            Vector3 bmax_;
+            lcore::Array<BKDNode> nodes_;
+            lcore::Array<u32> leaves_; ///< 葉の節点. 作った順で, 点も同じ順に並ぶ
+            u32 numBlocks_;
+            Point4* blocks_;
+        };
     }
 }
 
@@ -0,0 +1,139 @@
+﻿#ifndef INC_LMATH_OBVH_H__
+#define INC_LMATH_OBVH_H__
+/**
+@file OBVH.h
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "QBVH.h"
+
+namespace lmath
+{
+    //----------------------------------------------------
+    //---
+    //--- OBVH
+    //---
+    //----------------------------------------------------
+    /**
+    @brief 子8つのBVH. QBVHConstructorの4分木を畳んで作る
+
+    各ノードでは, 子が8つに収まる間, 表面積の最も大きい内部ノードの子をその孫で置き換える.
+    2段を機械的にまとめるのではないので, 大きな箱ほど浅く展開される.
+
+    子の箱8つを__m256で判定する. 実行時にAVXが使えなければQBVHに切り替え, 同じ結果を返す.
+    */
+    class OBVH
+    {
+    public:
+        static const u32 TestStackSize = 256;
+
+        typedef QBVH::Face Face;
+        typedef QBVH::Vertex Vertex;
+        typedef QBVH::HitRecord HitRecord;
+
+        struct Node
+        {
+            static const u32 EmptyMask = QBVHConstructor::Node::EmptyMask;
+            static const u32 LeafMask = QBVHConstructor::Node::LeafMask;
+
+            static bool isLeaf(u32 child)
+            {
+                return (LeafMask&child) != 0;
+            }
+
+            static bool isEmpty(u32 child)
+            {
+                return EmptyMask == child;
+            }
+
+            static u32 getFaceIndex(u32 child)
+            {
+                return QBVHConstructor::Node::getFaceIndex(child);
+            }
+
+            static u32 getFaceNum(u32 child)
+            {
+                return QBVHConstructor::Node::getFaceNum(child);
+            }
+
+            /// 光線の向きの8分円で, 近い順のi番目の子
+            static s32 getOrder(u32 order, s32 i)
+            {
+                return (order>>(i*4)) & 0x07;
+            }
+
+            __m256 bbox_[2][3]; ///< 空きは最小>最大で必ず外れる
+            u32 children_[8];
+            u32 order_[8]; ///< 8分円ごとの子の順. 4bitずつ近い順
+        };
+
+        /// CPUとOSがAVXに対応しているか. 結果は最初の呼び出しで決まる
+        static bool isSupported();
+
+        OBVH();
+        ~OBVH();
+
+        /**
+        @brief 構築済みの木を8分木に畳む
+        @param enableAVX ... falseならAVXに対応していてもQBVHで判定する
+        */
+        void copyFrom(QBVHConstructor& constructor, bool enableAVX=true);
+
+        /// AVXの8分木で判定するか
+        bool isAVX() const{ return avx_;}
+
+        bool test(HitRecord& hitRecord, const lmath::Ray& localRay);
+
+        /// 遮蔽判定. 交差が1つ見つかれば打ち切る
+        bool testOcclusion(const lmath::Ray& localRay);
+
+        /// 8分木のノード数. QBVHで判定するなら0
+        u32 getNumNodes() const{ return numNodes_;}
+
+        void getBBox(lmath::Vector3& bmin, lmath::Vector3& bmax) const
+        {
+            bmin = bmin_;
+            bmax = bmax_;
+        }
+    private:
+        OBVH(const OBVH&);
+        OBVH& operator=(const OBVH&);
+
+        /// 畳むときの子の候補
+        struct Child
+        {
+            u32 index_;
+            lmath::Vector3 bmin_;
+            lmath::Vector3 bmax_;
+        };
+
+        /// 畳んだノード. Nodeと同じ並びで, AVXを使わずにコピーできる
+        struct BuildNode
+        {
+            f32 bbox_[2][3][8];
+            u32 children_[8];
+            u32 order_[8];
+        };
+
+        void clear();
+        u32 collapse(lcore::Array<BuildNode>& nodes, const QBVHConstructor& constructor, u32 index);
+        static s32 gatherChildren(Child* children, const QBVHConstructor::Node& node);
+        static void setNode(BuildNode& node, const Child* children, s32 numChildren);
+
+        bool avx_;
+        u32 root_;
+        u32 numNodes_;
+        Node* nodes_;
+
+        u32 numVertices_;
+        Vertex* vertices_;
+        u32 numFaces_;
+        Face* faces_;
+
+        lmath::Vector3 bmin_;
+        lmath::Vector3 bmax_;
+
+        QBVH qbvh_;
+    };
+}
+#endif //INC_LMATH_OBVH_H__
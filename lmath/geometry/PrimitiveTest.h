@@ -162,6 +162,19 @@ namespace lmath
         const lmath::Vector3& bmin,
         const lmath::Vector3& bmax);
 
+    //---------------------------------------------------------------------------------
+    /**
+    @brief 点から三角形上の最近傍点を計算
+    @return 点から三角形への距離の平方
+    @param result ... 出力
+    */
+    f32 closestPointPointTriangle(
+        lmath::Vector3& result,
+        const lmath::Vector3& point,
+        const lmath::Vector3& p0,
+        const lmath::Vector3& p1,
+        const lmath::Vector3& p2);
+
     //---------------------------------------------------------------------------------
     /**
     @return 球と平面が交差するか
@@ -200,6 +213,24 @@ namespace lmath
         const Vector3& q1,
         f32 r1);
 
+    //---------------------------------------------------------------------------------
+    /**
+    @brief 動く球と三角形の最初の接触. 三角形は両面
+    @return [0, tmax]で接触するか. 最初から重なっていればt=0
+    @param t ... 出力. 接触までの距離
+    @param contact ... 出力. 三角形上の接点
+    @param direction ... 正規化した移動方向
+    */
+    bool testSweptSphereTriangle(
+        f32& t,
+        lmath::Vector3& contact,
+        const Sphere& sphere,
+        const lmath::Vector3& direction,
+        f32 tmax,
+        const lmath::Vector3& p0,
+        const lmath::Vector3& p1,
+        const lmath::Vector3& p2);
+
     //---------------------------------------------------------------------------------
     struct Triangle
     {
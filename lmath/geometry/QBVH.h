@@ -12,6 +12,7 @@
 namespace lcore
 {
     class File;
+    class ThreadPool;
 }
 
 namespace lmath
@@ -30,6 +31,23 @@ namespace lmath
         static const u32 MaxLeafFaces = 0xFFU;
         static const u32 MaxFaces = (((u32)-1) >> 9) - 1;
 
+        static const s32 MinBins = 4;
+        static const s32 MaxBins = 32;
+        static const s32 DefaultBins = 16;
+
+        /// 並列構築で1つのジョブにする部分木の三角形数の下限
+        static const u32 MinSubtreeFaces = 1024;
+        /// 並列構築でスレッドあたりに作る部分木の数の目安
+        static const u32 SubtreesPerThread = 8;
+        /// 重心範囲, ビン分割を並列にする三角形数の下限とチャンクの大きさ
+        static const u32 ParallelChunkFaces = 8*1024;
+
+        enum SplitMethod
+        {
+            SplitMethod_Median = 0, ///< 最長軸でソートして中央で分割
+            SplitMethod_BinnedSAH, ///< ビン分割したSAHで分割
+        };
+
         struct FaceSortFunc;
 
         struct Face
@@ -87,15 +105,98 @@ namespace lmath
         ~QBVHConstructor();
 
         void construct(u32 numVertices, Vertex* vertices, u32 numFaces, Face* faces, const lmath::Vector3& bmin, const lmath::Vector3& bmax);
+
+        /**
+        @brief 並列構築. 結果は逐次構築と同じ
+        @param threadPool ... 呼び出したスレッドも処理に加わり, 全て終わるまで戻らない
+
+        上位の階層は重心範囲とビン分割をチャンクに分けて並列に処理し, 残りの部分木を別々のジョブで構築する.
+        部分木のノードはジョブごとの配列に確保し, 最後に逐次構築と同じ順に詰める.
+        中央値分割ではソートが逐次なので, 上位の階層は並列にならない.
+        */
+        void construct(lcore::ThreadPool& threadPool, u32 numVertices, Vertex* vertices, u32 numFaces, Face* faces, const lmath::Vector3& bmin, const lmath::Vector3& bmax);
         void save(const Char* filepath);
 
+        u32 getNumNodes() const{ return nodes_.size();}
+        const Node& getNode(u32 index) const{ return nodes_[index];}
+        u32 getNumFaces() const{ return numFaces_;}
+        const Face& getFace(u32 index) const{ return faces_[index];}
+
         void setBoundingExpantion(f32 expansion){ boundingExpansion_ = expansion;}
 
+        void setSplitMethod(SplitMethod method){ splitMethod_ = method;}
+
+        /// SAHのビン数. [MinBins, MaxBins]
+        void setNumBins(s32 numBins){ numBins_ = lcore::clamp(numBins, MinBins, MaxBins);}
+
+        /**
+        @brief 構築した木の期待コスト(SAH). 根の表面積に対するノード, 三角形の判定回数の期待値
+        @param traversalCost ... ノード1つ(子4つの箱)の判定コスト
+        @param intersectionCost ... 三角形1つの判定コスト
+        */
+        f32 calcSAHCost(f32 traversalCost=1.0f, f32 intersectionCost=1.0f) const;
+
     private:
         friend struct FaceSortFunc;
         friend class QBVH;
+        friend class OBVH;
+        friend class CompressedQBVH;
+
+        /// SAH構築用の三角形の境界
+        struct FaceBound
+        {
+            lmath::Vector3 bmin_;
+            lmath::Vector3 bmax_;
+            lmath::Vector3 centroid_;
+        };
+
+        /// 並列構築で後から構築する部分木
+        struct Subtree
+        {
+            u32 begin_;
+            u32 numFaces_;
+            lmath::Vector3 bmin_;
+            lmath::Vector3 bmax_;
+            u32 root_;
+        };
+
+        /// 構築先. 並列構築の上位の階層だけthreadPool_, subtrees_を持つ
+        struct Build
+        {
+            lcore::Array<Node>* nodes_;
+            lcore::ThreadPool* threadPool_;
+            lcore::Array<Subtree>* subtrees_;
+            u32 subtreeFaces_;
+        };
+
+        struct SubtreeJob;
 
-        u32 recursiveConstruct(u32 begin, u32 numFaces, const lmath::Vector3& bmin, const lmath::Vector3& bmax);
+        /// 部分木の参照. 三角形数0の葉として子に置き, 詰めるときに置き換える
+        static u32 getSubtree(u32 index){ return Node::LeafMask|(index<<8);}
+        static bool isSubtree(u32 child){ return Node::isLeaf(child) && !Node::isEmpty(child) && 0 == Node::getFaceNum(child);}
+        static u32 getSubtreeIndex(u32 child){ return Node::getFaceIndex(child);}
+
+        void initialize(u32 numVertices, Vertex* vertices, u32 numFaces, Face* faces, const lmath::Vector3& bmin, const lmath::Vector3& bmax);
+        void calcFaceBounds(u32 begin, u32 end);
+        u32 pushSubtree(Build& build, u32 begin, u32 numFaces, const lmath::Vector3& bmin, const lmath::Vector3& bmax);
+        u32 compact(const lcore::Array<Node>& src, u32 index, const lcore::Array<Subtree>& subtrees, const lcore::Array<Node>* subtreeNodes);
+
+        static void calcFaceBoundsProc(void* data, u32 chunk);
+        static void constructSubtreeProc(void* data, u32 index);
+
+        u32 recursiveConstruct(Build& build, u32 begin, u32 numFaces, const lmath::Vector3& bmin, const lmath::Vector3& bmax);
+        u32 recursiveConstructSAH(Build& build, u32 begin, u32 numFaces);
+
+        /**
+        @brief [begin, begin+numFaces)をSAH最小で2つに分ける
+        @return 右側の先頭
+        @param axis ... 分割軸
+        @param threadPool ... NULLでなければ重心範囲とビン分割を並列にする
+        */
+        u32 splitSAH(s32& axis, u32 begin, u32 numFaces, lcore::ThreadPool* threadPool);
+        void setNode(Node& node, s32 axis0, s32 axis1, s32 axis2, const lmath::Vector3 minmax[4][2]);
+        void getBBoxSAH(lmath::Vector3& bmin, lmath::Vector3& bmax, u32 begin, u32 numFaces) const;
+        f32 calcSAHCost(u32 index, f32 area, f32 invRootArea, f32 traversalCost, f32 intersectionCost) const;
 
         void sort(u32 numFaces, Face* faces, s32 axis);
         void calcBBox(lmath::Vector3& bmin, lmath::Vector3& bmax, const Face& face);
@@ -103,6 +204,8 @@ namespace lmath
         void getBBox(lmath::Vector3& bmin, lmath::Vector3& bmax, const Face* faces, u32 numFaces);
 
         f32 boundingExpansion_;
+        SplitMethod splitMethod_;
+        s32 numBins_;
         lcore::Array<Node> nodes_;
         lmath::Vector3 bmin_;
         lmath::Vector3 bmax_;
@@ -112,7 +215,7 @@ namespace lmath
 
         u32 numFaces_;
         Face* faces_;
-
+        FaceBound* faceBounds_;
     };
 
 
@@ -125,6 +228,13 @@ namespace lmath
 
         static const u32 TestStackSize = 64;
 
+        /// 再適合を並列にするとき, 1つのジョブで処理するノード数
+        static const u32 RefitChunkNodes = 256;
+        /// 構築直後に対するSAHコストの比がこれを越えたら作り直す. bvh::BVHも使う
+        static const f32 DefaultRebuildRatio;// = 1.5f
+        /// まとめた問い合わせを並列にするとき, 1つのジョブで処理する数
+        static const u32 QueryChunkSize = 64;
+
         struct Face
         {
             lmath::Vector3 normal_;
@@ -183,6 +293,23 @@ namespace lmath
             f32 t_; //光線の半直線距離パラメータ
         };
 
+        /// 球を動かしたときの最初の接触
+        struct SweepRecord
+        {
+            const Face* face_; ///< 接触しなければNULL
+            f32 t_; ///< 接触までの移動距離
+            lmath::Vector3 point_; ///< 三角形上の接点
+            lmath::Vector3 normal_; ///< 接点から接触時の球の中心への向き
+        };
+
+        /// 点に最も近い三角形
+        struct NearestRecord
+        {
+            const Face* face_; ///< 範囲内になければNULL
+            f32 distance_;
+            lmath::Vector3 point_; ///< 三角形上の最近傍点
+        };
+
         QBVH();
         ~QBVH();
 
@@ -196,7 +323,72 @@ namespace lmath
 
         bool test(HitRecord& hitRecord, const lmath::Ray& localRay);
         bool test(HitRecord& hitRecord, const lmath::Vector3& bmin, const lmath::Vector3& bmax);
-        //bool test(HitRecord& hitRecord, const lmath::Sphere& sphere);
+
+        /**
+        @brief 球と交差する三角形を集める. 球は局所座標
+        @return 交差した三角形の数. maxFacesを越えた分は書かない
+        */
+        s32 testSphere(s32 maxFaces, const Face** faces, const lmath::Sphere& sphere) const;
+
+        /**
+        @brief 球を動かしたときに最初に接触する三角形. 近い箱から辿り, 接触より遠い箱は除く
+        @param direction ... 正規化した移動方向
+        @param distance ... 移動距離
+        */
+        bool testSweptSphere(SweepRecord& record, const lmath::Sphere& sphere, const lmath::Vector3& direction, f32 distance) const;
+
+        /**
+        @brief 点に最も近い三角形上の点. 近い箱から辿り, 見つけた距離より遠い箱は除く
+        @param maxDistance ... これより遠い三角形は探さない
+        */
+        bool findNearest(NearestRecord& record, const lmath::Vector3& point, f32 maxDistance) const;
+
+        /**
+        @brief まとめた球の交差
+        @return 交差した三角形の総数
+        @param counts ... numSpheres個. 球ごとに交差した数
+        @param faces ... numSpheres*maxFaces個. i番目の球はfaces[i*maxFaces]から
+        @param threadPool ... NULLでなければQueryChunkSizeずつ並列に処理する
+        */
+        s32 testSphere(s32 numSpheres, s32* counts, s32 maxFaces, const Face** faces, const lmath::Sphere* spheres, lcore::ThreadPool* threadPool=NULL) const;
+
+        /// @return 接触した球の数
+        s32 testSweptSphere(s32 numSpheres, SweepRecord* records, const lmath::Sphere* spheres, const lmath::Vector3* directions, const f32* distances, lcore::ThreadPool* threadPool=NULL) const;
+
+        /// @return 範囲内に三角形が見つかった点の数
+        s32 findNearest(s32 numPoints, NearestRecord* records, const lmath::Vector3* points, f32 maxDistance, lcore::ThreadPool* threadPool=NULL) const;
+
+        /**
+        @brief 光線の束の判定. 向きと原点のそろった光線ほど節点をまとめて棄却できる
+        @return 交差した光線のビット
+        @param hitRecords ... 光線ごとの結果. 交差しなければface_はNULL
+        @param rays ... 局所座標の光線
+        */
+        s32 test4(HitRecord hitRecords[4], const lmath::Ray rays[4]);
+
+        /// AVXが使えるCPUでは8本を1つの束で, そうでなければ4本ずつ判定する
+        s32 test8(HitRecord hitRecords[8], const lmath::Ray rays[8]);
+
+        /// 遮蔽判定. 交差が1つ見つかれば打ち切る
+        bool testOcclusion(const lmath::Ray& localRay);
+
+        /// @return 遮られた光線のビット
+        s32 testOcclusion4(const lmath::Ray rays[4]);
+        s32 testOcclusion8(const lmath::Ray rays[8]);
+
+        /**
+        @brief 向きのばらばらな光線. 向きの8分円ごとにまとめ, 束にして判定する
+        @return 交差した光線の数
+        @param hitRecords ... numRays個. raysと同じ順
+        @param work ... numRays個の作業領域
+        */
+        s32 testStream(s32 numRays, HitRecord* hitRecords, const lmath::Ray* rays, u32* work);
+
+        /**
+        @return 遮られた光線の数
+        @param occluded ... numRays個. 光線ごとに遮られたか
+        */
+        s32 testOcclusionStream(s32 numRays, bool* occluded, const lmath::Ray* rays, u32* work);
 
         void getBBox(lmath::Vector3& bmin, lmath::Vector3& bmax)
         {
@@ -206,13 +398,71 @@ namespace lmath
             bmin += position_;
             bmax += position_;
         }
+
+        u32 getNumNodes() const{ return numNodes_;}
+        const Node& getNode(u32 index) const{ return nodes_[index];}
+
+        /**
+        @brief 頂点を動かした後, ノードの箱を葉から根へ計算し直す. 木の形と面の並びは変わらない
+        @param vertices ... 構築時と同じ数と並び. NULLなら保持している頂点をそのまま使う
+        */
+        void refit(const Vertex* vertices);
+
+        /**
+        @brief 並列の再適合. 深い段から1段ずつ, 段の中のノードを分けて処理する. 結果は逐次と同じ
+        @param threadPool ... 呼び出したスレッドも処理に加わり, 全て終わるまで戻らない
+        */
+        void refit(lcore::ThreadPool& threadPool, const Vertex* vertices);
+
+        Vertex* getVertices(){ return vertices_;}
+
+        /// 現在の木のSAHコスト. QBVHConstructor::calcSAHCostと同じ式
+        f32 calcSAHCost(f32 traversalCost=1.0f, f32 intersectionCost=1.0f) const;
+
+        /// 構築直後のSAHコスト
+        f32 getBuildSAHCost() const{ return buildSAHCost_;}
+
+        /**
+        @brief 再適合を続けて木の質が落ちたか
+        @param ratio ... 構築直後に対する現在のSAHコストの比がこれを越えたら作り直す
+        */
+        bool isRebuildRequired(f32 ratio=DefaultRebuildRatio) const;
     private:
+        struct RefitJob;
+        struct QueryJob;
+
+        static void refitProc(void* data, u32 chunk);
+        static void sphereProc(void* data, u32 chunk);
+        static void sweptSphereProc(void* data, u32 chunk);
+        static void nearestProc(void* data, u32 chunk);
+        static void processQueries(lcore::ThreadPool* threadPool, void (*proc)(void*, u32), QueryJob& job);
+        u32 getRoot() const;
+        void copyVertices(const Vertex* vertices);
+        void refitNode(u32 index);
+        void refitRoot();
+        f32 calcSAHCost(u32 index, f32 area, f32 invRootArea, f32 traversalCost, f32 intersectionCost) const;
+
         bool innerTest(HitRecord& hitRecord, const lmath::Ray& ray, f32 tmin, f32 tmax);
         bool innerTest(HitRecord& hitRecord, const lmath::Vector3& bmin, const lmath::Vector3& bmax);
 
+        /**
+        @brief 束の判定. Tは4本か8本のSIMD
+        @param indices ... 束のi番目の光線はrays[indices[i]], 結果はhitRecords[indices[i]]
+        */
+        template<class T, bool AnyHit>
+        s32 testPacket(HitRecord* hitRecords, const lmath::Ray* rays, const u32* indices, s32 numRays);
+
+        /// 8本の束の判定. AVXが使えるときだけ呼ぶ
+        template<bool AnyHit>
+        s32 testPacketAVX(HitRecord* hitRecords, const lmath::Ray* rays, const u32* indices, s32 numRays);
+
+        void sortByOctant(s32 numRays, const lmath::Ray* rays, u32* work, s32 offsets[9]);
+
         lmath::Vector3 position_;
         s32 raySign_[3];
         u32 numTestFaces_;
+        f32 boundingExpansion_;
+        f32 buildSAHCost_;
 
         u32 numNodes_;
         Node* nodes_;
@@ -226,5 +476,234 @@ namespace lmath
         u32 numFaces_;
         Face* faces_;
     };
+
+    //----------------------------------------------------
+    //---
+    //--- QBVH32Constructor
+    //---
+    //----------------------------------------------------
+    /**
+    @brief 32bit頂点インデックスのQBVH構築
+
+    葉は三角形4つをまとめたブロック(頂点0と2辺のSoA)を指す. 葉の符号は
+    LeafMask | ブロック番号(29bit) << 2 | ブロック数-1 (2bit)
+    で, 約5億ブロックまで扱える. 分割はビン分割SAH.
+    */
+    class QBVH32Constructor
+    {
+    public:
+        static const u32 MinLeafFaces = 4;
+        static const u32 MaxLeafFaces = 16; ///< SAHで葉にする三角形数の上限
+        static const u32 LeafBlockBits = 2;
+        static const u32 MaxBlocks = (((u32)-1) >> (1+LeafBlockBits)) - 1;
+        static const u32 MaxFaces = MaxBlocks;
+        static const u32 InvalidFace = (u32)-1;
+
+        struct Face
+        {
+            u32 v0_;
+            u32 v1_;
+            u32 v2_;
+        };
+
+        typedef QBVHConstructor::Vertex Vertex;
+
+        /// 三角形4つ. 空きは辺が0で必ず外れる
+        struct Triangle4
+        {
+            lmath::lm128 v0_[3];
+            lmath::lm128 edge1_[3]; ///< v1-v0
+            lmath::lm128 edge2_[3]; ///< v2-v0
+            u32 face_[4]; ///< 元の面の番号. 空きはInvalidFace
+        };
+
+        struct Node
+        {
+            static const u32 EmptyMask = (u32)-1;
+            static const u32 LeafMask = ~(EmptyMask>>1);
+
+            static bool isLeaf(u32 child)
+            {
+                return (LeafMask&child) != 0;
+            }
+
+            static bool isEmpty(u32 child)
+            {
+                return EmptyMask == child;
+            }
+
+            static u32 getLeaf(u32 blockIndex, u32 numBlocks)
+            {
+                return LeafMask|(blockIndex<<LeafBlockBits)|((numBlocks-1)&((0x01U<<LeafBlockBits)-1));
+            }
+
+            static u32 getBlockIndex(u32 child)
+            {
+                return ((~LeafMask)&child) >> LeafBlockBits;
+            }
+
+            static u32 getBlockNum(u32 child)
+            {
+                return (child&((0x01U<<LeafBlockBits)-1)) + 1;
+            }
+
+            f32 bbox_[2][3][4];
+            u32 children_[4];
+            s32 axis0_;
+            s32 axis1_;
+            s32 axis2_;
+            s32 reserved_;
+        };
+
+        QBVH32Constructor();
+        ~QBVH32Constructor();
+
+        /**
+        @brief 構築. 頂点と面は構築中だけ参照し, 所有権は移らない
+        */
+        void construct(u32 numVertices, const Vertex* vertices, u32 numFaces, const Face* faces);
+
+        void setBoundingExpantion(f32 expansion){ boundingExpansion_ = expansion;}
+
+        /// SAHのビン数. [MinBins, MaxBins]
+        void setNumBins(s32 numBins){ numBins_ = lcore::clamp(numBins, QBVHConstructor::MinBins, QBVHConstructor::MaxBins);}
+
+        u32 getRoot() const{ return root_;}
+        u32 getNumNodes() const{ return nodes_.size();}
+        const Node& getNode(u32 index) const{ return nodes_[index];}
+        u32 getNumBlocks() const{ return numBlocks_;}
+        const Triangle4& getBlock(u32 index) const{ return blocks_[index];}
+
+    private:
+        friend class QBVH32;
+
+        QBVH32Constructor(const QBVH32Constructor&);
+        QBVH32Constructor& operator=(const QBVH32Constructor&);
+
+        struct FaceBound
+        {
+            lmath::Vector3 bmin_;
+            lmath::Vector3 bmax_;
+            lmath::Vector3 centroid_;
+            u32 face_;
+        };
+
+        struct Leaf
+        {
+            u32 begin_;
+            u32 numFaces_;
+        };
+
+        void clear();
+        u32 recursiveConstruct(u32 begin, u32 numFaces);
+        u32 pushLeaf(u32 begin, u32 numFaces);
+
+        /**
+        @brief [begin, begin+numFaces)をSAH最小で2つに分ける
+        @return 右側の先頭
+        @param cost ... 分けた両側の面積x三角形数の和. 分けられなければ負
+        */
+        u32 splitSAH(s32& axis, f32& cost, u32 begin, u32 numFaces);
+        void getBBox(lmath::Vector3& bmin, lmath::Vector3& bmax, u32 begin, u32 numFaces) const;
+        void setNode(Node& node, s32 axis0, s32 axis1, s32 axis2, const lmath::Vector3 minmax[4][2]);
+        void fillBlocks(const Vertex* vertices, const Face* faces);
+
+        f32 boundingExpansion_;
+        s32 numBins_;
+        u32 root_;
+        lcore::Array<Node> nodes_;
+        lcore::Array<Leaf> leaves_;
+        lmath::Vector3 bmin_;
+        lmath::Vector3 bmax_;
+
+        u32 numBlocks_;
+        Triangle4* blocks_;
+        FaceBound* faceBounds_;
+    };
+
+    //----------------------------------------------------
+    //---
+    //--- QBVH32
+    //---
+    //----------------------------------------------------
+    class QBVH32
+    {
+    public:
+        static const u32 TestStackSize = 128;
+        static const u32 InvalidFace = QBVH32Constructor::InvalidFace;
+
+        typedef QBVH32Constructor::Triangle4 Triangle4;
+
+        struct Node
+        {
+            static const u32 EmptyMask = QBVH32Constructor::Node::EmptyMask;
+            static const u32 LeafMask = QBVH32Constructor::Node::LeafMask;
+
+            static bool isLeaf(u32 child)
+            {
+                return (LeafMask&child) != 0;
+            }
+
+            static bool isEmpty(u32 child)
+            {
+                return EmptyMask == child;
+            }
+
+            static u32 getBlockIndex(u32 child)
+            {
+                return QBVH32Constructor::Node::getBlockIndex(child);
+            }
+
+            static u32 getBlockNum(u32 child)
+            {
+                return QBVH32Constructor::Node::getBlockNum(child);
+            }
+
+            lmath::lm128 bbox_[2][3];
+            u32 children_[4];
+            s32 axis0_;
+            s32 axis1_;
+            s32 axis2_;
+            s32 reserved_;
+        };
+
+        struct HitRecord
+        {
+            u32 face_; ///< 構築時の面の番号
+            f32 t_;
+            f32 v_; ///< 重心座標
+            f32 w_; ///< 重心座標
+        };
+
+        QBVH32();
+        ~QBVH32();
+
+        void copyFrom(const QBVH32Constructor& constructor);
+
+        bool test(HitRecord& hitRecord, const lmath::Ray& localRay) const;
+
+        u32 getNumNodes() const{ return numNodes_;}
+        u32 getNumBlocks() const{ return numBlocks_;}
+
+        void getBBox(lmath::Vector3& bmin, lmath::Vector3& bmax) const
+        {
+            bmin = bmin_;
+            bmax = bmax_;
+        }
+    private:
+        QBVH32(const QBVH32&);
+        QBVH32& operator=(const QBVH32&);
+
+        void clear();
+
+        u32 root_;
+        u32 numNodes_;
+        Node* nodes_;
+        u32 numBlocks_;
+        Triangle4* blocks_;
+
+        lmath::Vector3 bmin_;
+        lmath::Vector3 bmax_;
+    };
 }
 #endif //INC_LMATH_QBVH_H__
@@ -0,0 +1,389 @@
+﻿/**
+@file CompressedQBVH.cpp
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "geometry/CompressedQBVH.h"
+
+#include <math.h>
+#include <lcore/File.h>
+
+#include <lmath/geometry/Ray.h>
+#include <lmath/geometry/RayTest.h>
+
+namespace lmath
+{
+
+namespace
+{
+    static const s32 MinExponent = 1;
+    static const s32 MaxExponent = 254;
+
+    inline u64 alignOffset(u64 offset)
+    {
+        return (offset + CompressedQBVH::Alignment - 1) & ~static_cast<u64>(CompressedQBVH::Alignment - 1);
+    }
+
+    /// 2^(exponent-127)
+    inline f32 getScale(s32 exponent)
+    {
+        lcore::UnionU32F32 u;
+        u.u32_ = static_cast<u32>(exponent)<<23;
+        return u.f32_;
+    }
+
+    /// 255刻みでextentを覆う最小の指数
+    s32 getExponent(f32 extent)
+    {
+        f32 step = extent/255.0f;
+        if(step<=getScale(MinExponent)){
+            return MinExponent;
+        }
+        int e;
+        frexpf(step, &e);
+        return lcore::clamp(e+127, MinExponent, MaxExponent);
+    }
+
+    /**
+    @brief 量子化した値を戻す
+
+    刻み幅が2のべき乗なのでq*scaleは丸めなしで求まり, 加算の丸めだけが残る.
+    復号のSIMDと同じ結果になる.
+    */
+    inline f32 dequantize(f32 origin, s32 q, f32 scale)
+    {
+        return origin + static_cast<f32>(q)*scale;
+    }
+
+    inline lm128 dequantize(const lm128& origin, const u8* q, const lm128& scale)
+    {
+        u32 packed;
+        lcore::memcpy(&packed, q, sizeof(u32));
+        const __m128i zero = _mm_setzero_si128();
+        __m128i x = _mm_cvtsi32_si128(static_cast<s32>(packed));
+        x = _mm_unpacklo_epi8(x, zero);
+        x = _mm_unpacklo_epi16(x, zero);
+        return _mm_add_ps(origin, _mm_mul_ps(_mm_cvtepi32_ps(x), scale));
+    }
+}
+
+    //----------------------------------------------------
+    //---
+    //--- CompressedQBVH
+    //---
+    //----------------------------------------------------
+    void CompressedQBVH::decode(lm128 bbox[2][3], const Node& node)
+    {
+        for(s32 i=0; i<3; ++i){
+            lm128 origin = _mm_set1_ps(node.origin_[i]);
+            lm128 scale = _mm_set1_ps(getScale(node.exponent_[i]));
+            bbox[0][i] = dequantize(origin, node.bbox_[0][i], scale);
+            bbox[1][i] = dequantize(origin, node.bbox_[1][i], scale);
+        }
+    }
+
+    void CompressedQBVH::encode(Node& node, const QBVHConstructor::Node& src)
+    {
+        node.axis_ = static_cast<u8>(src.axis0_ | (src.axis1_<<2) | (src.axis2_<<4));
+        node.reserved_[0] = node.reserved_[1] = 0;
+        lcore::memcpy(node.children_, src.children_, sizeof(u32)*4);
+
+        for(s32 axis=0; axis<3; ++axis){
+            //子の和がノードの箱
+            f32 bmin = lcore::numeric_limits<f32>::maximum();
+            f32 bmax = lcore::numeric_limits<f32>::lowest();
+            for(s32 i=0; i<4; ++i){
+                node.bbox_[0][axis][i] = 0xFFU;
+                node.bbox_[1][axis][i] = 0x00U;
+                if(!Node::isEmpty(src.children_[i])){
+                    bmin = lcore::minimum(bmin, src.bbox_[0][axis][i]);
+                    bmax = lcore::maximum(bmax, src.bbox_[1][axis][i]);
+                }
+            }
+            if(bmax<bmin){
+                node.origin_[axis] = 0.0f;
+                node.exponent_[axis] = 127;
+                continue;
+            }
+
+            //加算の丸めで収まらなければ刻みを広げる
+            node.origin_[axis] = bmin;
+            s32 exponent = getExponent(bmax - bmin);
+            for(; exponent<=MaxExponent; ++exponent){
+                f32 scale = getScale(exponent);
+                bool fit = true;
+                for(s32 i=0; i<4; ++i){
+                    if(Node::isEmpty(src.children_[i])){
+                        continue;
+                    }
+                    f32 cmin = src.bbox_[0][axis][i];
+                    f32 cmax = src.bbox_[1][axis][i];
+                    s32 qmin = lcore::clamp(static_cast<s32>(floorf((cmin-bmin)/scale)), 0, 255);
+                    while(0<qmin && cmin<dequantize(bmin, qmin, scale)){
+                        --qmin;
+                    }
+                    s32 qmax = lcore::clamp(static_cast<s32>(ceilf((cmax-bmin)/scale)), 0, 255);
+                    while(qmax<255 && dequantize(bmin, qmax, scale)<cmax){
+                        ++qmax;
+                    }
+                    if(cmin<dequantize(bmin, qmin, scale) || dequantize(bmin, qmax, scale)<cmax){
+                        fit = false;
+                        break;
+                    }
+                    node.bbox_[0][axis][i] = static_cast<u8>(qmin);
+                    node.bbox_[1][axis][i] = static_cast<u8>(qmax);
+                }
+                if(fit){
+                    break;
+                }
+            }
+            LASSERT(exponent<=MaxExponent);
+            node.exponent_[axis] = static_cast<u8>(exponent);
+        }
+    }
+
+    void CompressedQBVH::setPointers(const Header* header, const Node*& nodes, const Vertex*& vertices, const Face*& faces)
+    {
+        const u8* image = reinterpret_cast<const u8*>(header);
+        nodes = reinterpret_cast<const Node*>(image + alignOffset(sizeof(Header)));
+        vertices = reinterpret_cast<const Vertex*>(image + header->verticesOffset_);
+        faces = reinterpret_cast<const Face*>(image + header->facesOffset_);
+    }
+
+    CompressedQBVH::CompressedQBVH()
+        :owned_(NULL)
+        ,header_(NULL)
+        ,numNodes_(0)
+        ,nodes_(NULL)
+        ,vertices_(NULL)
+        ,numFaces_(0)
+        ,faces_(NULL)
+    {
+        bmin_ = lmath::Vector3::zero();
+        bmax_ = lmath::Vector3::zero();
+    }
+
+    CompressedQBVH::~CompressedQBVH()
+    {
+        clear();
+    }
+
+    void CompressedQBVH::clear()
+    {
+        LALIGNED_FREE(owned_, Alignment);
+        header_ = NULL;
+        numNodes_ = 0;
+        nodes_ = NULL;
+        vertices_ = NULL;
+        numFaces_ = 0;
+        faces_ = NULL;
+    }
+
+    void CompressedQBVH::copyFrom(const QBVHConstructor& constructor)
+    {
+        clear();
+
+        //ヘッダ, ノード, 頂点, 面の順に並べる
+        u32 numNodes = constructor.nodes_.size();
+        u64 nodesOffset = alignOffset(sizeof(Header));
+        u64 verticesOffset = nodesOffset + sizeof(Node)*numNodes;
+        u64 facesOffset = verticesOffset + sizeof(Vertex)*constructor.numVertices_;
+        u64 size = alignOffset(facesOffset + sizeof(Face)*constructor.numFaces_);
+
+        owned_ = LALIGNED_MALLOC(static_cast<std::size_t>(size), Alignment);
+        lcore::memset(owned_, 0, static_cast<std::size_t>(size));
+        Header* header = reinterpret_cast<Header*>(owned_);
+        header->magic_ = Magic;
+        header->version_ = Version;
+        header->numNodes_ = numNodes;
+        header->numVertices_ = constructor.numVertices_;
+        header->numFaces_ = constructor.numFaces_;
+        for(s32 i=0; i<3; ++i){
+            header->bmin_[i] = constructor.bmin_[i];
+            header->bmax_[i] = constructor.bmax_[i];
+        }
+        header->verticesOffset_ = verticesOffset;
+        header->facesOffset_ = facesOffset;
+        header->size_ = size;
+
+        u8* image = reinterpret_cast<u8*>(owned_);
+        Node* nodes = reinterpret_cast<Node*>(image + nodesOffset);
+        for(u32 i=0; i<numNodes; ++i){
+            encode(nodes[i], constructor.nodes_[i]);
+        }
+        lcore::memcpy(image + verticesOffset, constructor.vertices_, sizeof(Vertex)*constructor.numVertices_);
+        lcore::memcpy(image + facesOffset, constructor.faces_, sizeof(Face)*constructor.numFaces_);
+
+        void* owned = owned_;
+        owned_ = NULL;
+        attach(owned, static_cast<s64>(size));
+        owned_ = owned;
+    }
+
+    bool CompressedQBVH::save(const Char* filepath) const
+    {
+        LASSERT(NULL != filepath);
+        if(NULL == header_){
+            return false;
+        }
+        lcore::File out;
+        if(!out.open(filepath, lcore::ios::out)){
+            return false;
+        }
+        return out.write(static_cast<s64>(header_->size_), header_);
+    }
+
+    bool CompressedQBVH::load(const Char* filepath)
+    {
+        LASSERT(NULL != filepath);
+        clear();
+
+        lcore::File in;
+        if(!in.open(filepath, lcore::ios::in)){
+            return false;
+        }
+        Header header;
+        if(!in.read(header) || Magic != header.magic_ || Version != header.version_ || header.size_<sizeof(Header)){
+            return false;
+        }
+
+        void* image = LALIGNED_MALLOC(static_cast<std::size_t>(header.size_), Alignment);
+        lcore::memcpy(image, &header, sizeof(Header));
+        u64 rest = header.size_ - sizeof(Header);
+        if((0<rest && !in.read(static_cast<s64>(rest), reinterpret_cast<u8*>(image)+sizeof(Header)))
+            || !attach(image, static_cast<s64>(header.size_)))
+        {
+            LALIGNED_FREE(image, Alignment);
+            return false;
+        }
+        owned_ = image;
+        return true;
+    }
+
+    bool CompressedQBVH::attach(const void* image, s64 size)
+    {
+        LASSERT(NULL != image);
+        clear();
+        if(0 != (reinterpret_cast<lcore::uintptr_t>(image) & (Alignment-1)) || size<static_cast<s64>(sizeof(Header))){
+            return false;
+        }
+
+        //範囲を越えるイメージは使わない
+        const Header* header = reinterpret_cast<const Header*>(image);
+        if(Magic != header->magic_
+            || Version != header->version_
+            || static_cast<u64>(size)<header->size_
+            || header->verticesOffset_ != alignOffset(sizeof(Header)) + sizeof(Node)*header->numNodes_
+            || header->facesOffset_ != header->verticesOffset_ + sizeof(Vertex)*header->numVertices_
+            || header->size_ < header->facesOffset_ + sizeof(Face)*header->numFaces_)
+        {
+            return false;
+        }
+
+        header_ = header;
+        numNodes_ = header->numNodes_;
+        numFaces_ = header->numFaces_;
+        setPointers(header, nodes_, vertices_, faces_);
+        bmin_.set(header->bmin_[0], header->bmin_[1], header->bmin_[2]);
+        bmax_.set(header->bmax_[0], header->bmax_[1], header->bmax_[2]);
+        return true;
+    }
+
+    bool CompressedQBVH::test(HitRecord& hitRecord, const lmath::Ray& localRay) const
+    {
+        hitRecord.face_ = NULL;
+
+        f32 tmin;
+        f32 tmax;
+        if(NULL == header_ || !lmath::testRayAABB(tmin, tmax, localRay, bmin_, bmax_)){
+            return false;
+        }
+        tmax = localRay.t_;
+
+        if(numFaces_<=0){
+            return false;
+        }
+        //ノードがなければ根が葉
+        u32 root = (0<numNodes_)? 0 : QBVHConstructor::Node::getLeaf(0, numFaces_);
+
+        s32 raySign[3];
+        raySign[0] = (0.0f<=localRay.direction_[0])? 0 : 1;
+        raySign[1] = (0.0f<=localRay.direction_[1])? 0 : 1;
+        raySign[2] = (0.0f<=localRay.direction_[2])? 0 : 1;
+
+        lmath::lm128 origin[3];
+        lmath::lm128 invDir[3];
+        origin[0] = _mm_set1_ps(localRay.origin_.x_);
+        origin[1] = _mm_set1_ps(localRay.origin_.y_);
+        origin[2] = _mm_set1_ps(localRay.origin_.z_);
+
+        invDir[0] = _mm_set1_ps(localRay.invDirection_.x_);
+        invDir[1] = _mm_set1_ps(localRay.invDirection_.y_);
+        invDir[2] = _mm_set1_ps(localRay.invDirection_.z_);
+
+        lmath::lm128 tminSSE = _mm_setzero_ps();
+        lmath::lm128 tmaxSSE = _mm_set1_ps(tmax);
+
+        bool ret = false;
+        s32 stack = 0;
+        u32 nodeStack[TestStackSize];
+        nodeStack[stack] = root;
+        while(0<=stack){
+            u32 index = nodeStack[stack];
+            --stack;
+            if(Node::isLeaf(index)){
+                if(Node::isEmpty(index)){
+                    continue;
+                }
+
+                u32 faceIndex = Node::getFaceIndex(index);
+                u32 numFaces = Node::getFaceNum(index);
+
+                f32 u, v;
+                for(u32 i=faceIndex; i<faceIndex+numFaces; ++i){
+                    const Face& face = faces_[i];
+                    f32 t;
+                    const lmath::Vector3& p0 = vertices_[face.v0_].position_;
+                    const lmath::Vector3& p1 = vertices_[face.v1_].position_;
+                    const lmath::Vector3& p2 = vertices_[face.v2_].position_;
+
+                    if(lmath::testRayTriangleFront(t, u, v, localRay, p0, p1, p2)){
+                        if(0<=t && t<=tmax){
+                            ret = true;
+                            hitRecord.t_ = t;
+                            hitRecord.face_ = &face;
+                            tmax = t;
+                            tmaxSSE = _mm_set1_ps(tmax);
+                        }
+                    }
+                }
+
+            }else{
+                const Node& node = nodes_[index];
+                lm128 bbox[2][3];
+                decode(bbox, node);
+                s32 hit = testRayAABB(tminSSE, tmaxSSE, origin, invDir, raySign, bbox);
+
+                if(0 == hit){
+                    continue;
+                }
+
+                //axis0で0,1と2,3, axis1で0と1, axis2で2と3に分かれている. 近い方を後に積む
+                s32 near0 = raySign[node.getAxis0()]<<1;
+                s32 order[4];
+                order[0] = near0 | raySign[(0==near0)? node.getAxis1() : node.getAxis2()];
+                order[1] = order[0]^0x01;
+                order[2] = (near0^0x02) | raySign[(0==near0)? node.getAxis2() : node.getAxis1()];
+                order[3] = order[2]^0x01;
+                for(s32 i=3; 0<=i; --i){
+                    if(hit & (0x01<<order[i])){
+                        LASSERT((stack+1)<static_cast<s32>(TestStackSize));
+                        ++stack;
+                        nodeStack[stack] = node.children_[order[i]];
+                    }
+                }
+            }
+        }
+        return ret;
+    }
+}
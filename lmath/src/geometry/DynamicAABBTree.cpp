@@ -0,0 +1,581 @@
+﻿/**
+@file DynamicAABBTree.cpp
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "geometry/DynamicAABBTree.h"
+#include "geometry/Ray.h"
+#include "geometry/RayTest.h"
+
+namespace lmath
+{
+namespace
+{
+    AABB merge(const AABB& b0, const AABB& b1)
+    {
+        return AABB(minimum(b0.bmin_, b1.bmin_), maximum(b0.bmax_, b1.bmax_));
+    }
+
+    struct RayEntry
+    {
+        s32 node_;
+        f32 tmin_;
+    };
+}
+
+    const f32 DynamicAABBTree::DefaultMargin = 0.1f;
+    const f32 DynamicAABBTree::DisplacementMultiplier = 2.0f;
+
+    DynamicAABBTree::DynamicAABBTree(f32 margin)
+        :margin_(margin)
+        ,root_(Invalid)
+        ,capacity_(0)
+        ,numNodes_(0)
+        ,numProxies_(0)
+        ,freeList_(Invalid)
+        ,nodes_(NULL)
+    {
+        LASSERT(0.0f<=margin_);
+    }
+
+    DynamicAABBTree::~DynamicAABBTree()
+    {
+        LFREE(nodes_);
+    }
+
+    void DynamicAABBTree::clear()
+    {
+        root_ = Invalid;
+        numNodes_ = 0;
+        numProxies_ = 0;
+        freeList_ = Invalid;
+        for(s32 i=capacity_-1; 0<=i; --i){
+            nodes_[i].next_ = freeList_;
+            nodes_[i].height_ = -1;
+            freeList_ = i;
+        }
+        moveBuffer_.clear();
+    }
+
+    //-----------------------------------------------------------
+    s32 DynamicAABBTree::createProxy(const AABB& bbox, void* userData)
+    {
+        s32 proxy = allocateNode();
+        Node& node = nodes_[proxy];
+        getFatAABB(node.bbox_, bbox, Vector3::zero());
+        node.userData_ = userData;
+        node.height_ = 0;
+        node.moved_ = false;
+        insertLeaf(proxy);
+        pushMoved(proxy);
+        ++numProxies_;
+        return proxy;
+    }
+
+    void DynamicAABBTree::destroyProxy(s32 proxy)
+    {
+        LASSERT(0<=proxy && proxy<capacity_);
+        LASSERT(nodes_[proxy].isLeaf() && 0==nodes_[proxy].height_);
+
+        //移動バッファからは印を消すだけ
+        if(nodes_[proxy].moved_){
+            for(s32 i=0; i<moveBuffer_.size(); ++i){
+                if(proxy == moveBuffer_[i]){
+                    moveBuffer_[i] = Invalid;
+                    break;
+                }
+            }
+        }
+        removeLeaf(proxy);
+        releaseNode(proxy);
+        --numProxies_;
+    }
+
+    bool DynamicAABBTree::moveProxy(s32 proxy, const AABB& bbox, const Vector3& displacement)
+    {
+        LASSERT(0<=proxy && proxy<capacity_);
+        LASSERT(nodes_[proxy].isLeaf() && 0==nodes_[proxy].height_);
+
+        AABB fat;
+        getFatAABB(fat, bbox, displacement);
+
+        //収まっていて, 大きすぎなければそのまま
+        const AABB& current = nodes_[proxy].bbox_;
+        if(current.contains(bbox)){
+            AABB huge = fat;
+            huge.expand(4.0f*margin_);
+            if(huge.contains(current)){
+                return false;
+            }
+        }
+
+        removeLeaf(proxy);
+        nodes_[proxy].bbox_ = fat;
+        insertLeaf(proxy);
+        pushMoved(proxy);
+        return true;
+    }
+
+    void DynamicAABBTree::touchProxy(s32 proxy)
+    {
+        LASSERT(0<=proxy && proxy<capacity_);
+        LASSERT(nodes_[proxy].isLeaf() && 0==nodes_[proxy].height_);
+        pushMoved(proxy);
+    }
+
+    //-----------------------------------------------------------
+    s32 DynamicAABBTree::getHeight() const
+    {
+        return (Invalid == root_)? 0 : nodes_[root_].height_;
+    }
+
+    s32 DynamicAABBTree::getMaxBalance() const
+    {
+        s32 maxBalance = 0;
+        for(s32 i=0; i<capacity_; ++i){
+            const Node& node = nodes_[i];
+            if(node.height_<=1){
+                continue;
+            }
+            s32 balance = lcore::absolute(nodes_[node.child1_].height_ - nodes_[node.child0_].height_);
+            maxBalance = lcore::maximum(maxBalance, balance);
+        }
+        return maxBalance;
+    }
+
+    f32 DynamicAABBTree::getAreaRatio() const
+    {
+        if(Invalid == root_){
+            return 0.0f;
+        }
+        f32 rootArea = nodes_[root_].bbox_.halfArea();
+        f32 totalArea = 0.0f;
+        for(s32 i=0; i<capacity_; ++i){
+            if(0<=nodes_[i].height_){
+                totalArea += nodes_[i].bbox_.halfArea();
+            }
+        }
+        return (0.0f<rootArea)? totalArea/rootArea : 0.0f;
+    }
+
+    bool DynamicAABBTree::validate() const
+    {
+        if(Invalid == root_){
+            return 0 == numNodes_ && 0 == numProxies_;
+        }
+        if(Invalid != nodes_[root_].parent_){
+            return false;
+        }
+        if(!validate(root_, Invalid)){
+            return false;
+        }
+
+        s32 numFree = 0;
+        for(s32 i=freeList_; Invalid != i; i=nodes_[i].next_){
+            if(i<0 || capacity_<=i || 0<=nodes_[i].height_){
+                return false;
+            }
+            ++numFree;
+        }
+        return (numNodes_ + numFree) == capacity_ && (2*numProxies_-1) == numNodes_;
+    }
+
+    bool DynamicAABBTree::validate(s32 index, s32 parent) const
+    {
+        const Node& node = nodes_[index];
+        if(parent != node.parent_){
+            return false;
+        }
+        if(node.isLeaf()){
+            return Invalid == node.child1_ && 0 == node.height_;
+        }
+        if(node.child0_<0 || capacity_<=node.child0_ || node.child1_<0 || capacity_<=node.child1_){
+            return false;
+        }
+        const Node& child0 = nodes_[node.child0_];
+        const Node& child1 = nodes_[node.child1_];
+        if(node.height_ != (1+lcore::maximum(child0.height_, child1.height_))){
+            return false;
+        }
+        AABB bbox = merge(child0.bbox_, child1.bbox_);
+        if(0 != lcore::memcmp(&bbox, &node.bbox_, sizeof(AABB))){
+            return false;
+        }
+        return validate(node.child0_, index) && validate(node.child1_, index);
+    }
+
+    //-----------------------------------------------------------
+    s32 DynamicAABBTree::queryOverlap(s32 maxProxies, s32* proxies, const AABB& bbox) const
+    {
+        LASSERT(0<=maxProxies);
+        LASSERT(0==maxProxies || NULL != proxies);
+        if(Invalid == root_){
+            return 0;
+        }
+
+        s32 count = 0;
+        s32 stack[TestStackSize];
+        s32 top = 0;
+        stack[top++] = root_;
+        while(0<top){
+            const Node& node = nodes_[stack[--top]];
+            if(!node.bbox_.overlaps(bbox)){
+                continue;
+            }
+            if(node.isLeaf()){
+                if(count<maxProxies){
+                    proxies[count] = static_cast<s32>(&node - nodes_);
+                }
+                ++count;
+            }else{
+                LASSERT((top+2)<=TestStackSize);
+                stack[top++] = node.child1_;
+                stack[top++] = node.child0_;
+            }
+        }
+        return count;
+    }
+
+    s32 DynamicAABBTree::raycast(const Ray& ray, RaycastCallback callback, void* data) const
+    {
+        LASSERT(NULL != callback);
+        if(Invalid == root_){
+            return 0;
+        }
+
+        Ray clipped = ray;
+        s32 count = 0;
+        f32 tmin, tmax;
+        if(!testRayAABB(tmin, tmax, clipped, nodes_[root_].bbox_.bmin_, nodes_[root_].bbox_.bmax_)){
+            return 0;
+        }
+
+        RayEntry stack[TestStackSize];
+        s32 top = 0;
+        stack[top].node_ = root_;
+        stack[top].tmin_ = tmin;
+        ++top;
+        while(0<top){
+            --top;
+            if(clipped.t_<stack[top].tmin_){
+                continue;
+            }
+            s32 index = stack[top].node_;
+            const Node& node = nodes_[index];
+            if(node.isLeaf()){
+                ++count;
+                f32 t = callback(data, index, clipped);
+                if(t<=0.0f){
+                    break;
+                }
+                clipped.t_ = lcore::minimum(t, clipped.t_);
+                continue;
+            }
+
+            //遠い子を先に積む
+            f32 tmin0, tmin1;
+            bool hit0 = testRayAABB(tmin0, tmax, clipped, nodes_[node.child0_].bbox_.bmin_, nodes_[node.child0_].bbox_.bmax_);
+            bool hit1 = testRayAABB(tmin1, tmax, clipped, nodes_[node.child1_].bbox_.bmin_, nodes_[node.child1_].bbox_.bmax_);
+            LASSERT((top+2)<=TestStackSize);
+            if(hit0 && hit1){
+                bool first0 = tmin0<=tmin1;
+                stack[top].node_ = first0? node.child1_ : node.child0_;
+                stack[top].tmin_ = first0? tmin1 : tmin0;
+                ++top;
+                stack[top].node_ = first0? node.child0_ : node.child1_;
+                stack[top].tmin_ = first0? tmin0 : tmin1;
+                ++top;
+            }else if(hit0){
+                stack[top].node_ = node.child0_;
+                stack[top].tmin_ = tmin0;
+                ++top;
+            }else if(hit1){
+                stack[top].node_ = node.child1_;
+                stack[top].tmin_ = tmin1;
+                ++top;
+            }
+        }
+        return count;
+    }
+
+    s32 DynamicAABBTree::queryPairs(lcore::Array<Pair>& pairs)
+    {
+        s32 start = pairs.size();
+        s32 stack[TestStackSize];
+        for(s32 i=0; i<moveBuffer_.size(); ++i){
+            s32 proxy = moveBuffer_[i];
+            if(Invalid == proxy){
+                continue;
+            }
+            const AABB& bbox = nodes_[proxy].bbox_;
+
+            s32 top = 0;
+            stack[top++] = root_;
+            while(0<top){
+                s32 index = stack[--top];
+                const Node& node = nodes_[index];
+                if(!node.bbox_.overlaps(bbox)){
+                    continue;
+                }
+                if(!node.isLeaf()){
+                    LASSERT((top+2)<=TestStackSize);
+                    stack[top++] = node.child1_;
+                    stack[top++] = node.child0_;
+                    continue;
+                }
+                //動いた代理同士は番号の小さい方で足す
+                if(index == proxy || (node.moved_ && index<proxy)){
+                    continue;
+                }
+                Pair pair;
+                pair.proxy0_ = lcore::minimum(proxy, index);
+                pair.proxy1_ = lcore::maximum(proxy, index);
+                pairs.push_back(pair);
+            }
+        }
+
+        for(s32 i=0; i<moveBuffer_.size(); ++i){
+            if(Invalid != moveBuffer_[i]){
+                nodes_[moveBuffer_[i]].moved_ = false;
+            }
+        }
+        moveBuffer_.clear();
+        return pairs.size() - start;
+    }
+
+    //-----------------------------------------------------------
+    s32 DynamicAABBTree::allocateNode()
+    {
+        if(Invalid == freeList_){
+            //倍に増やして空きリストにつなぐ
+            s32 capacity = (capacity_<16)? 16 : capacity_*2;
+            Node* nodes = reinterpret_cast<Node*>(LMALLOC(sizeof(Node)*capacity));
+            if(0<capacity_){
+                lcore::memcpy(nodes, nodes_, sizeof(Node)*capacity_);
+            }
+            LFREE(nodes_);
+            nodes_ = nodes;
+            for(s32 i=capacity-1; capacity_<=i; --i){
+                nodes_[i].next_ = freeList_;
+                nodes_[i].height_ = -1;
+                freeList_ = i;
+            }
+            capacity_ = capacity;
+        }
+
+        s32 index = freeList_;
+        Node& node = nodes_[index];
+        freeList_ = node.next_;
+        node.parent_ = Invalid;
+        node.child0_ = Invalid;
+        node.child1_ = Invalid;
+        node.height_ = 0;
+        node.userData_ = NULL;
+        node.moved_ = false;
+        ++numNodes_;
+        return index;
+    }
+
+    void DynamicAABBTree::releaseNode(s32 index)
+    {
+        LASSERT(0<numNodes_);
+        nodes_[index].next_ = freeList_;
+        nodes_[index].height_ = -1;
+        freeList_ = index;
+        --numNodes_;
+    }
+
+    //-----------------------------------------------------------
+    void DynamicAABBTree::insertLeaf(s32 leaf)
+    {
+        if(Invalid == root_){
+            root_ = leaf;
+            nodes_[leaf].parent_ = Invalid;
+            return;
+        }
+
+        //兄弟を選ぶ. 降りるときの費用は親の箱が広がる分
+        const AABB bbox = nodes_[leaf].bbox_;
+        s32 index = root_;
+        while(!nodes_[index].isLeaf()){
+            const Node& node = nodes_[index];
+            f32 area = node.bbox_.halfArea();
+            f32 combinedArea = merge(node.bbox_, bbox).halfArea();
+
+            //ここに新しい親を作る費用と, 子へ降りるときに祖先として増える費用
+            f32 cost = 2.0f*combinedArea;
+            f32 inheritance = 2.0f*(combinedArea - area);
+
+            f32 childCost[2];
+            s32 children[2] = {node.child0_, node.child1_};
+            for(s32 i=0; i<2; ++i){
+                const Node& child = nodes_[children[i]];
+                f32 childArea = merge(child.bbox_, bbox).halfArea();
+                childCost[i] = (child.isLeaf()? childArea : (childArea - child.bbox_.halfArea())) + inheritance;
+            }
+
+            if(cost<childCost[0] && cost<childCost[1]){
+                break;
+            }
+            index = (childCost[0]<childCost[1])? children[0] : children[1];
+        }
+
+        //兄弟と葉の新しい親
+        s32 sibling = index;
+        s32 oldParent = nodes_[sibling].parent_;
+        s32 newParent = allocateNode();
+        Node& parent = nodes_[newParent];
+        parent.parent_ = oldParent;
+        parent.bbox_ = merge(nodes_[sibling].bbox_, bbox);
+        parent.height_ = nodes_[sibling].height_ + 1;
+        parent.child0_ = sibling;
+        parent.child1_ = leaf;
+        nodes_[sibling].parent_ = newParent;
+        nodes_[leaf].parent_ = newParent;
+
+        if(Invalid == oldParent){
+            root_ = newParent;
+        }else if(nodes_[oldParent].child0_ == sibling){
+            nodes_[oldParent].child0_ = newParent;
+        }else{
+            nodes_[oldParent].child1_ = newParent;
+        }
+
+        refit(newParent);
+    }
+
+    void DynamicAABBTree::removeLeaf(s32 leaf)
+    {
+        if(leaf == root_){
+            root_ = Invalid;
+            return;
+        }
+
+        s32 parent = nodes_[leaf].parent_;
+        s32 grandParent = nodes_[parent].parent_;
+        s32 sibling = (nodes_[parent].child0_ == leaf)? nodes_[parent].child1_ : nodes_[parent].child0_;
+
+        //親を兄弟で置き換える
+        nodes_[sibling].parent_ = grandParent;
+        if(Invalid == grandParent){
+            root_ = sibling;
+        }else{
+            if(nodes_[grandParent].child0_ == parent){
+                nodes_[grandParent].child0_ = sibling;
+            }else{
+                nodes_[grandParent].child1_ = sibling;
+            }
+            refit(grandParent);
+        }
+        nodes_[leaf].parent_ = Invalid;
+        releaseNode(parent);
+    }
+
+    /// 根まで戻りながら回転して, 箱と高さを直す
+    void DynamicAABBTree::refit(s32 index)
+    {
+        while(Invalid != index){
+            index = balance(index);
+            index = nodes_[index].parent_;
+        }
+    }
+
+    /// 子から箱と高さを計算する
+    void DynamicAABBTree::update(s32 index)
+    {
+        Node& node = nodes_[index];
+        const Node& child0 = nodes_[node.child0_];
+        const Node& child1 = nodes_[node.child1_];
+        node.height_ = 1 + lcore::maximum(child0.height_, child1.height_);
+        node.bbox_ = merge(child0.bbox_, child1.bbox_);
+    }
+
+    /**
+    @brief 内部節点の子の高さの差が2以上なら, 高い方の子を持ち上げる. 箱と高さも直す
+    @return 部分木の新しい根
+
+    子の部分木はそれぞれ高さの差が1以下であること.
+    葉を内部節点の隣に入れると差は2より大きくなることがあるが, 回転を繰り返して1以下にする.
+    */
+    s32 DynamicAABBTree::balance(s32 index)
+    {
+        const Node& node = nodes_[index];
+        LASSERT(!node.isLeaf());
+
+        s32 diff = nodes_[node.child1_].height_ - nodes_[node.child0_].height_;
+        if(1<diff){
+            return rotate(index, node.child1_);
+        }
+        if(diff<-1){
+            return rotate(index, node.child0_);
+        }
+        update(index);
+        return index;
+    }
+
+    /**
+    @brief childをindexの位置に上げる. childの高い方の子はchildに残し, 低い方をindexに渡す
+    @return child
+
+    indexに残る2つの子はまだ偏っていることがあるので, indexを先に釣り合わせてからchildを直す.
+    */
+    s32 DynamicAABBTree::rotate(s32 index, s32 child)
+    {
+        Node& a = nodes_[index];
+        Node& c = nodes_[child];
+        s32 other = (a.child0_ == child)? a.child1_ : a.child0_;
+
+        //cを親の位置に
+        c.parent_ = a.parent_;
+        a.parent_ = child;
+        if(Invalid == c.parent_){
+            root_ = child;
+        }else if(nodes_[c.parent_].child0_ == index){
+            nodes_[c.parent_].child0_ = child;
+        }else{
+            nodes_[c.parent_].child1_ = child;
+        }
+
+        s32 high = c.child0_;
+        s32 low = c.child1_;
+        if(nodes_[high].height_<nodes_[low].height_){
+            lcore::swap(high, low);
+        }
+
+        //aの子はotherとlow, cの子はaとhigh
+        a.child0_ = other;
+        a.child1_ = low;
+        nodes_[low].parent_ = index;
+        c.child0_ = index;
+        c.child1_ = high;
+
+        //aの部分木の根が替わればcの子もつなぎ替わる
+        balance(index);
+        update(child);
+        return child;
+    }
+
+    //-----------------------------------------------------------
+    void DynamicAABBTree::getFatAABB(AABB& fat, const AABB& bbox, const Vector3& displacement) const
+    {
+        fat = bbox;
+        fat.expand(margin_);
+        Vector3 d = displacement*DisplacementMultiplier;
+        for(s32 i=0; i<3; ++i){
+            if(d[i]<0.0f){
+                fat.bmin_[i] += d[i];
+            }else{
+                fat.bmax_[i] += d[i];
+            }
+        }
+    }
+
+    void DynamicAABBTree::pushMoved(s32 proxy)
+    {
+        if(nodes_[proxy].moved_){
+            return;
+        }
+        nodes_[proxy].moved_ = true;
+        moveBuffer_.push_back(proxy);
+    }
+}
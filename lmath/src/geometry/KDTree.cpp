@@ -0,0 +1,538 @@
+﻿/**
+@file KDTree.cpp
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "geometry/KDTree.h"
+
+#include <lcore/Sort.h>
+#include <lcore/Thread.h>
+
+namespace lmath
+{
+namespace kdtree
+{
+namespace
+{
+    //-----------------------------------------------------------
+    /// 葉の4点への距離の平方
+    inline lmath::lm128 distanceSqr(const PointKDTree::Point4& block, const lmath::lm128 point[3])
+    {
+        lmath::lm128 dx = _mm_sub_ps(_mm_load_ps(block.x_), point[0]);
+        lmath::lm128 dy = _mm_sub_ps(_mm_load_ps(block.y_), point[1]);
+        lmath::lm128 dz = _mm_sub_ps(_mm_load_ps(block.z_), point[2]);
+        return _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+    }
+
+    //-----------------------------------------------------------
+    /// 距離順に辿るスタックの要素
+    struct QueryEntry
+    {
+        u32 node_;
+        f32 distanceSqr_; ///< 節点の範囲までの距離の下限
+    };
+
+    /**
+    @brief 子を遠い順に積む. 範囲より遠い子は積まない
+    @param x ... 問い合わせ点の分割軸の座標
+    */
+    inline s32 pushChildren(QueryEntry* stack, s32 top, const QueryEntry& entry, const BKDNode& node, f32 x, f32 bound)
+    {
+        f32 gap[2];
+        gap[0] = lcore::maximum(x - node.clip_[0], 0.0f);
+        gap[1] = lcore::maximum(node.clip_[1] - x, 0.0f);
+
+        s32 first = (gap[0]<=gap[1])? 0 : 1;
+        s32 order[2] = {1-first, first};
+        for(s32 i=0; i<2; ++i){
+            s32 side = order[i];
+            f32 distanceSqr = lcore::maximum(entry.distanceSqr_, gap[side]*gap[side]);
+            if(bound<distanceSqr){
+                continue;
+            }
+            LASSERT((top+1)<static_cast<s32>(PointKDTree::TestStackSize));
+            ++top;
+            stack[top].node_ = node.getChildIndex() + side;
+            stack[top].distanceSqr_ = distanceSqr;
+        }
+        return top;
+    }
+
+    //-----------------------------------------------------------
+    /// 先頭が最も遠い二分ヒープ
+    void pushHeap(PointKDTree::Neighbor* heap, s32 count, const PointKDTree::Neighbor& neighbor)
+    {
+        s32 i = count;
+        while(0<i){
+            s32 parent = (i-1)>>1;
+            if(neighbor.distanceSqr_<=heap[parent].distanceSqr_){
+                break;
+            }
+            heap[i] = heap[parent];
+            i = parent;
+        }
+        heap[i] = neighbor;
+    }
+
+    void replaceTop(PointKDTree::Neighbor* heap, s32 count, const PointKDTree::Neighbor& neighbor)
+    {
+        s32 i = 0;
+        for(;;){
+            s32 child = 2*i+1;
+            if(count<=child){
+                break;
+            }
+            if((child+1)<count && heap[child].distanceSqr_<heap[child+1].distanceSqr_){
+                ++child;
+            }
+            if(heap[child].distanceSqr_<=neighbor.distanceSqr_){
+                break;
+            }
+            heap[i] = heap[child];
+            i = child;
+        }
+        heap[i] = neighbor;
+    }
+}
+
+    //--------------------------------------------------------------
+    //---
+    //--- PointKDTree
+    //---
+    //--------------------------------------------------------------
+    /// 軸の座標でソート. 同じなら番号順
+    struct PointKDTree::PresortFunc
+    {
+        PresortFunc(const Vector3* points, s32 axis)
+            :points_(points)
+            ,axis_(axis)
+        {}
+
+        bool operator()(const u32& lhs, const u32& rhs) const
+        {
+            f32 l = points_[lhs][axis_];
+            f32 r = points_[rhs][axis_];
+            return (l<r) || (l==r && lhs<rhs);
+        }
+
+        const Vector3* points_;
+        s32 axis_;
+    };
+
+    /// まとめた問い合わせ. QueryChunkSizeずつ分ける
+    struct PointKDTree::QueryJob
+    {
+        const PointKDTree* tree_;
+        s32 count_;
+        s32* counts_;
+        s32 maxNeighbors_;
+        Neighbor* neighbors_;
+        const Vector3* points_;
+        f32 distance_;
+    };
+
+    PointKDTree::PointKDTree()
+        :numPoints_(0)
+        ,depth_(0)
+        ,numBlocks_(0)
+        ,blocks_(NULL)
+    {
+        bmin_ = Vector3::zero();
+        bmax_ = Vector3::zero();
+    }
+
+    PointKDTree::~PointKDTree()
+    {
+        clear();
+    }
+
+    void PointKDTree::clear()
+    {
+        numPoints_ = 0;
+        depth_ = 0;
+        bmin_ = Vector3::zero();
+        bmax_ = Vector3::zero();
+        nodes_.clear();
+        leaves_.clear();
+        numBlocks_ = 0;
+        LALIGNED_FREE(blocks_, 16);
+    }
+
+    void PointKDTree::build(u32 numPoints, const Vector3* points, BuildMethod method)
+    {
+        LASSERT(0==numPoints || NULL != points);
+        clear();
+        if(numPoints<=0){
+            return;
+        }
+        numPoints_ = numPoints;
+        bmin_ = bmax_ = points[0];
+        for(u32 i=1; i<numPoints; ++i){
+            bmin_ = minimum(bmin_, points[i]);
+            bmax_ = maximum(bmax_, points[i]);
+        }
+
+        BKDNode root;
+        root.index_ = 0;
+        nodes_.push_back(root);
+
+        u32* order = (u32*)LMALLOC(sizeof(u32)*numPoints);
+        if(BuildMethod_Select == method){
+            Entry* entries = (Entry*)LMALLOC(sizeof(Entry)*numPoints);
+            for(u32 i=0; i<numPoints; ++i){
+                entries[i].position_ = points[i];
+                entries[i].index_ = i;
+            }
+            buildSelect(0, entries, numPoints, 0, 0);
+            for(u32 i=0; i<numPoints; ++i){
+                order[i] = entries[i].index_;
+            }
+            LFREE(entries);
+
+        }else{
+            //軸ごとにソートした並びを, 分割のたびに安定に左右へ分ける
+            u32* buffer = (u32*)LMALLOC(sizeof(u32)*numPoints*4);
+            u8* side = (u8*)LMALLOC(sizeof(u8)*numPoints);
+            u32* sorted[3] = {buffer, buffer+numPoints, buffer+numPoints*2};
+            for(s32 i=0; i<3; ++i){
+                for(u32 j=0; j<numPoints; ++j){
+                    sorted[i][j] = j;
+                }
+                lcore::introsort(static_cast<s32>(numPoints), sorted[i], PresortFunc(points, i));
+            }
+            buildPresort(0, sorted, buffer+numPoints*3, side, points, 0, numPoints, 0);
+            lcore::memcpy(order, sorted[0], sizeof(u32)*numPoints);
+            LFREE(side);
+            LFREE(buffer);
+        }
+        fillBlocks(order, points);
+        LFREE(order);
+    }
+
+    u32 PointKDTree::addNodes()
+    {
+        u32 index = nodes_.size();
+        BKDNode node;
+        node.index_ = 0;
+        nodes_.push_back(node);
+        nodes_.push_back(node);
+        return index;
+    }
+
+    void PointKDTree::setLeaf(u32 nodeIndex, u32 numPoints, u32 depth)
+    {
+        BKDNode& node = nodes_[nodeIndex];
+        node.setFlag(BKDNode::Axis_Leaf);
+        node.items_.index_ = numBlocks_;
+        node.items_.numItems_ = numPoints;
+        numBlocks_ += (numPoints+3)>>2;
+        leaves_.push_back(nodeIndex);
+        depth_ = lcore::maximum(depth_, depth);
+    }
+
+    void PointKDTree::buildSelect(u32 nodeIndex, Entry* entries, u32 numEntries, u32 depth, s32 axis)
+    {
+        if(numEntries<=MaxLeafPoints || MaxDepth<=depth){
+            setLeaf(nodeIndex, numEntries, depth);
+            return;
+        }
+
+        u32 numLeft = 0;
+        f32 splitLeft, splitRight;
+        s32 splitAxis = BKDAlgorithm<Entry>::split(entries, numEntries, numLeft, splitLeft, splitRight, bmin_, bmax_, axis);
+        if(splitAxis<0){
+            //全て同じ位置
+            setLeaf(nodeIndex, numEntries, depth);
+            return;
+        }
+
+        u32 child = addNodes();
+        BKDNode& node = nodes_[nodeIndex];
+        node.setFlag(static_cast<BKDNode::Axis>(splitAxis));
+        node.setChildIndex(child);
+        node.clip_[0] = splitLeft;
+        node.clip_[1] = splitRight;
+
+        buildSelect(child, entries, numLeft, depth+1, splitAxis);
+        buildSelect(child+1, entries+numLeft, numEntries-numLeft, depth+1, splitAxis);
+    }
+
+    void PointKDTree::buildPresort(u32 nodeIndex, u32* sorted[3], u32* work, u8* side, const Vector3* points, u32 begin, u32 numPoints, u32 depth)
+    {
+        if(numPoints<=MaxLeafPoints || MaxDepth<=depth){
+            setLeaf(nodeIndex, numPoints, depth);
+            return;
+        }
+
+        //ソート済みなので範囲は両端
+        u32 end = begin + numPoints - 1;
+        s32 axis = 0;
+        f32 extent = points[sorted[0][end]].x_ - points[sorted[0][begin]].x_;
+        for(s32 i=1; i<3; ++i){
+            f32 e = points[sorted[i][end]][i] - points[sorted[i][begin]][i];
+            if(extent<e){
+                extent = e;
+                axis = i;
+            }
+        }
+        if(extent<=0.0f){
+            //全て同じ位置
+            setLeaf(nodeIndex, numPoints, depth);
+            return;
+        }
+
+        u32 numLeft = numPoints>>1;
+        const u32* axisSorted = sorted[axis] + begin;
+        for(u32 i=0; i<numLeft; ++i){
+            side[axisSorted[i]] = 0;
+        }
+        for(u32 i=numLeft; i<numPoints; ++i){
+            side[axisSorted[i]] = 1;
+        }
+        for(s32 i=0; i<3; ++i){
+            if(i == axis){
+                continue;
+            }
+            u32* values = sorted[i] + begin;
+            u32 left = 0;
+            u32 right = numLeft;
+            for(u32 j=0; j<numPoints; ++j){
+                u32 index = values[j];
+                if(0 == side[index]){
+                    work[left++] = index;
+                }else{
+                    work[right++] = index;
+                }
+            }
+            lcore::memcpy(values, work, sizeof(u32)*numPoints);
+        }
+
+        u32 child = addNodes();
+        BKDNode& node = nodes_[nodeIndex];
+        node.setFlag(static_cast<BKDNode::Axis>(axis));
+        node.setChildIndex(child);
+        node.clip_[0] = points[axisSorted[numLeft-1]][axis];
+        node.clip_[1] = points[axisSorted[numLeft]][axis];
+
+        buildPresort(child, sorted, work, side, points, begin, numLeft, depth+1);
+        buildPresort(child+1, sorted, work, side, points, begin+numLeft, numPoints-numLeft, depth+1);
+    }
+
+    void PointKDTree::fillBlocks(const u32* order, const Vector3* points)
+    {
+        blocks_ = (Point4*)LALIGNED_MALLOC(sizeof(Point4)*numBlocks_, 16);
+        const f32 infinity = lcore::numeric_limits<f32>::maximum();
+        u32 point = 0;
+        for(u32 i=0; i<leaves_.size(); ++i){
+            const BKDNode& node = nodes_[leaves_[i]];
+            Point4* block = blocks_ + node.items_.index_;
+            for(u32 j=0; j<node.items_.numItems_; j+=4){
+                for(u32 k=0; k<4; ++k){
+                    if((j+k)<node.items_.numItems_){
+                        u32 index = order[point++];
+                        block->x_[k] = points[index].x_;
+                        block->y_[k] = points[index].y_;
+                        block->z_[k] = points[index].z_;
+                        block->index_[k] = index;
+                    }else{
+                        block->x_[k] = block->y_[k] = block->z_[k] = infinity;
+                        block->index_[k] = InvalidIndex;
+                    }
+                }
+                ++block;
+            }
+        }
+        LASSERT(point == numPoints_);
+    }
+
+    s32 PointKDTree::findKNearest(s32 k, Neighbor* neighbors, const Vector3& point, f32 maxDistance) const
+    {
+        if(k<=0 || numPoints_<=0){
+            return 0;
+        }
+        //埋まるまでは範囲内の全て, 埋まった後はヒープの先頭より近い点. 空きの無限遠は含めない
+        f32 bound = lcore::minimum(maxDistance*maxDistance, lcore::numeric_limits<f32>::maximum());
+        lmath::lm128 pointSSE[3];
+        pointSSE[0] = _mm_set1_ps(point.x_);
+        pointSSE[1] = _mm_set1_ps(point.y_);
+        pointSSE[2] = _mm_set1_ps(point.z_);
+
+        s32 count = 0;
+        s32 top = 0;
+        QueryEntry stack[TestStackSize];
+        stack[top].node_ = 0;
+        stack[top].distanceSqr_ = 0.0f;
+        while(0<=top){
+            QueryEntry entry = stack[top];
+            --top;
+            if(bound<entry.distanceSqr_){
+                continue;
+            }
+            const BKDNode& node = nodes_[entry.node_];
+            s32 axis = node.getFlag();
+            if(BKDNode::Axis_Leaf != axis){
+                top = pushChildren(stack, top, entry, node, point[axis], bound);
+                continue;
+            }
+
+            const Point4* block = blocks_ + node.items_.index_;
+            const Point4* end = block + ((node.items_.numItems_+3)>>2);
+            for(; block<end; ++block){
+                lmath::lm128 distance = distanceSqr(*block, pointSSE);
+                s32 mask = _mm_movemask_ps(_mm_cmple_ps(distance, _mm_set1_ps(bound)));
+                if(0 == mask){
+                    continue;
+                }
+                LALIGN16 f32 distances[4];
+                _mm_store_ps(distances, distance);
+                for(s32 i=0; i<4; ++i){
+                    if(0 == ((mask>>i)&0x01)){
+                        continue;
+                    }
+                    Neighbor neighbor = {block->index_[i], distances[i]};
+                    if(count<k){
+                        pushHeap(neighbors, count, neighbor);
+                        ++count;
+                        if(count == k){
+                            bound = neighbors[0].distanceSqr_;
+                        }
+                    }else if(neighbor.distanceSqr_<bound){
+                        replaceTop(neighbors, count, neighbor);
+                        bound = neighbors[0].distanceSqr_;
+                    }
+                }
+            }
+        }
+
+        //ヒープを近い順に並べる
+        for(s32 i=count-1; 0<i; --i){
+            Neighbor neighbor = neighbors[i];
+            neighbors[i] = neighbors[0];
+            replaceTop(neighbors, i, neighbor);
+        }
+        return count;
+    }
+
+    s32 PointKDTree::findRadius(s32 maxNeighbors, Neighbor* neighbors, const Vector3& point, f32 radius) const
+    {
+        if(numPoints_<=0){
+            return 0;
+        }
+        f32 bound = lcore::minimum(radius*radius, lcore::numeric_limits<f32>::maximum());
+        lmath::lm128 boundSSE = _mm_set1_ps(bound);
+        lmath::lm128 pointSSE[3];
+        pointSSE[0] = _mm_set1_ps(point.x_);
+        pointSSE[1] = _mm_set1_ps(point.y_);
+        pointSSE[2] = _mm_set1_ps(point.z_);
+
+        s32 count = 0;
+        s32 top = 0;
+        QueryEntry stack[TestStackSize];
+        stack[top].node_ = 0;
+        stack[top].distanceSqr_ = 0.0f;
+        while(0<=top){
+            QueryEntry entry = stack[top];
+            --top;
+            const BKDNode& node = nodes_[entry.node_];
+            s32 axis = node.getFlag();
+            if(BKDNode::Axis_Leaf != axis){
+                top = pushChildren(stack, top, entry, node, point[axis], bound);
+                continue;
+            }
+
+            const Point4* block = blocks_ + node.items_.index_;
+            const Point4* end = block + ((node.items_.numItems_+3)>>2);
+            for(; block<end; ++block){
+                lmath::lm128 distance = distanceSqr(*block, pointSSE);
+                s32 mask = _mm_movemask_ps(_mm_cmple_ps(distance, boundSSE));
+                if(0 == mask){
+                    continue;
+                }
+                LALIGN16 f32 distances[4];
+                _mm_store_ps(distances, distance);
+                for(s32 i=0; i<4; ++i){
+                    if(0 == ((mask>>i)&0x01)){
+                        continue;
+                    }
+                    if(count<maxNeighbors){
+                        neighbors[count].index_ = block->index_[i];
+                        neighbors[count].distanceSqr_ = distances[i];
+                    }
+                    ++count;
+                }
+            }
+        }
+        return count;
+    }
+
+    void PointKDTree::kNearestProc(void* data, u32 chunk)
+    {
+        QueryJob& job = *reinterpret_cast<QueryJob*>(data);
+        s32 begin = static_cast<s32>(chunk*QueryChunkSize);
+        s32 end = lcore::minimum(begin+static_cast<s32>(QueryChunkSize), job.count_);
+        for(s32 i=begin; i<end; ++i){
+            job.counts_[i] = job.tree_->findKNearest(job.maxNeighbors_, job.neighbors_ + i*job.maxNeighbors_, job.points_[i], job.distance_);
+        }
+    }
+
+    void PointKDTree::radiusProc(void* data, u32 chunk)
+    {
+        QueryJob& job = *reinterpret_cast<QueryJob*>(data);
+        s32 begin = static_cast<s32>(chunk*QueryChunkSize);
+        s32 end = lcore::minimum(begin+static_cast<s32>(QueryChunkSize), job.count_);
+        for(s32 i=begin; i<end; ++i){
+            job.counts_[i] = job.tree_->findRadius(job.maxNeighbors_, job.neighbors_ + i*job.maxNeighbors_, job.points_[i], job.distance_);
+        }
+    }
+
+    void PointKDTree::processQueries(lcore::ThreadPool* threadPool, void (*proc)(void*, u32), QueryJob& job)
+    {
+        u32 numChunks = (static_cast<u32>(job.count_) + QueryChunkSize - 1)/QueryChunkSize;
+        lcore::parallelFor(threadPool, proc, &job, numChunks);
+    }
+
+    s32 PointKDTree::findKNearest(s32 numPoints, s32* counts, s32 k, Neighbor* neighbors, const Vector3* points, f32 maxDistance, lcore::ThreadPool* threadPool) const
+    {
+        if(numPoints<=0){
+            return 0;
+        }
+        QueryJob job;
+        job.tree_ = this;
+        job.count_ = numPoints;
+        job.counts_ = counts;
+        job.maxNeighbors_ = k;
+        job.neighbors_ = neighbors;
+        job.points_ = points;
+        job.distance_ = maxDistance;
+        processQueries(threadPool, kNearestProc, job);
+
+        s32 total = 0;
+        for(s32 i=0; i<numPoints; ++i){
+            total += counts[i];
+        }
+        return total;
+    }
+
+    s32 PointKDTree::findRadius(s32 numPoints, s32* counts, s32 maxNeighbors, Neighbor* neighbors, const Vector3* points, f32 radius, lcore::ThreadPool* threadPool) const
+    {
+        if(numPoints<=0){
+            return 0;
+        }
+        QueryJob job;
+        job.tree_ = this;
+        job.count_ = numPoints;
+        job.counts_ = counts;
+        job.maxNeighbors_ = maxNeighbors;
+        job.neighbors_ = neighbors;
+        job.points_ = points;
+        job.distance_ = radius;
+        processQueries(threadPool, radiusProc, job);
+
+        s32 total = 0;
+        for(s32 i=0; i<numPoints; ++i){
+            total += counts[i];
+        }
+        return total;
+    }
+}
+}
@@ -0,0 +1,373 @@
+﻿/**
+@file OBVH.cpp
+@author t-sakai
+@date 2026/10/19 create
+*/
+#include "geometry/OBVH.h"
+
+#include <lcore/CPU.h>
+
+#include <lmath/geometry/Ray.h>
+#include <lmath/geometry/RayTest.h>
+
+namespace lmath
+{
+
+namespace
+{
+    inline f32 halfArea(const lmath::Vector3& bmin, const lmath::Vector3& bmax)
+    {
+        lmath::Vector3 d = bmax;
+        d -= bmin;
+        return d.x_*d.y_ + d.y_*d.z_ + d.z_*d.x_;
+    }
+
+    struct StackEntry
+    {
+        u32 index_;
+        f32 tnear_; ///< 箱に入る距離. 見つけた交差より遠ければ捨てる
+    };
+
+#if defined(LCORE_CPU_X86)
+    /**
+    @brief 8分木の走査. 子は光線の8分円の順で近いものから取り出す
+    @param AnyHit ... 交差が1つ見つかれば打ち切る
+    */
+    template<bool AnyHit>
+    LCORE_TARGET("avx") bool traverseAVX(
+        OBVH::HitRecord& hitRecord,
+        const OBVH::Node* nodes,
+        u32 root,
+        const OBVH::Face* faces,
+        const OBVH::Vertex* vertices,
+        const lmath::Ray& ray,
+        f32 tmax)
+    {
+        s32 sign[3];
+        sign[0] = (0.0f<=ray.direction_.x_)? 0 : 1;
+        sign[1] = (0.0f<=ray.direction_.y_)? 0 : 1;
+        sign[2] = (0.0f<=ray.direction_.z_)? 0 : 1;
+        s32 octant = sign[0] | (sign[1]<<1) | (sign[2]<<2);
+
+        __m256 origin[3];
+        __m256 invDir[3];
+        origin[0] = _mm256_set1_ps(ray.origin_.x_);
+        origin[1] = _mm256_set1_ps(ray.origin_.y_);
+        origin[2] = _mm256_set1_ps(ray.origin_.z_);
+
+        invDir[0] = _mm256_set1_ps(ray.invDirection_.x_);
+        invDir[1] = _mm256_set1_ps(ray.invDirection_.y_);
+        invDir[2] = _mm256_set1_ps(ray.invDirection_.z_);
+
+        const __m256 tmin8 = _mm256_setzero_ps();
+        __m256 tmax8 = _mm256_set1_ps(tmax);
+
+        bool ret = false;
+        s32 stack = 0;
+        StackEntry nodeStack[OBVH::TestStackSize];
+        nodeStack[0].index_ = root;
+        nodeStack[0].tnear_ = 0.0f;
+        while(0<=stack){
+            u32 index = nodeStack[stack].index_;
+            f32 tnear = nodeStack[stack].tnear_;
+            --stack;
+            if(tmax<tnear){
+                continue;
+            }
+
+            if(OBVH::Node::isLeaf(index)){
+                if(OBVH::Node::isEmpty(index)){
+                    continue;
+                }
+                u32 faceIndex = OBVH::Node::getFaceIndex(index);
+                u32 numFaces = OBVH::Node::getFaceNum(index);
+
+                f32 u, v;
+                for(u32 i=faceIndex; i<faceIndex+numFaces; ++i){
+                    const OBVH::Face& face = faces[i];
+                    f32 t;
+                    const lmath::Vector3& p0 = vertices[face.v0_].position_;
+                    const lmath::Vector3& p1 = vertices[face.v1_].position_;
+                    const lmath::Vector3& p2 = vertices[face.v2_].position_;
+
+                    if(lmath::testRayTriangleFront(t, u, v, ray, p0, p1, p2)){
+                        if(0<=t && t<=tmax){
+                            ret = true;
+                            hitRecord.t_ = t;
+                            hitRecord.face_ = &face;
+                            if(AnyHit){
+                                return true;
+                            }
+                            tmax = t;
+                        }
+                    }
+                }
+                tmax8 = _mm256_set1_ps(tmax);
+                continue;
+            }
+
+            const OBVH::Node& node = nodes[index];
+            __m256 tnear8 = tmin8;
+            __m256 tfar8 = tmax8;
+            for(s32 i=0; i<3; ++i){
+                tnear8 = _mm256_max_ps(tnear8, _mm256_mul_ps(_mm256_sub_ps(node.bbox_[sign[i]][i], origin[i]), invDir[i]));
+                tfar8 = _mm256_min_ps(tfar8, _mm256_mul_ps(_mm256_sub_ps(node.bbox_[1-sign[i]][i], origin[i]), invDir[i]));
+            }
+            s32 hit = _mm256_movemask_ps(_mm256_cmp_ps(tnear8, tfar8, _CMP_LE_OQ));
+            if(0 == hit){
+                continue;
+            }
+
+            f32 tnears[8];
+            _mm256_storeu_ps(tnears, tnear8);
+
+            //遠い順に積み, 近い子から取り出す
+            u32 order = node.order_[octant];
+            for(s32 i=7; 0<=i; --i){
+                s32 child = OBVH::Node::getOrder(order, i);
+                if(hit & (0x01<<child)){
+                    LASSERT((stack+1)<static_cast<s32>(OBVH::TestStackSize));
+                    ++stack;
+                    nodeStack[stack].index_ = node.children_[child];
+                    nodeStack[stack].tnear_ = tnears[child];
+                }
+            }
+        }
+        return ret;
+    }
+#endif
+}
+
+    //----------------------------------------------------
+    //---
+    //--- OBVH
+    //---
+    //----------------------------------------------------
+    bool OBVH::isSupported()
+    {
+#if defined(LCORE_CPU_X86)
+        static const bool avx = lcore::isSupportAVX();
+        return avx;
+#else
+        return false;
+#endif
+    }
+
+    OBVH::OBVH()
+        :avx_(false)
+        ,root_(Node::EmptyMask)
+        ,numNodes_(0)
+        ,nodes_(NULL)
+        ,numVertices_(0)
+        ,vertices_(NULL)
+        ,numFaces_(0)
+        ,faces_(NULL)
+    {
+        bmin_ = lmath::Vector3::zero();
+        bmax_ = lmath::Vector3::zero();
+    }
+
+    OBVH::~OBVH()
+    {
+        clear();
+    }
+
+    void OBVH::clear()
+    {
+        avx_ = false;
+        root_ = Node::EmptyMask;
+        numNodes_ = 0;
+        numVertices_ = 0;
+        numFaces_ = 0;
+        LFREE(faces_);
+        LFREE(vertices_);
+        LALIGNED_FREE(nodes_, 32);
+    }
+
+    void OBVH::copyFrom(QBVHConstructor& constructor, bool enableAVX)
+    {
+        clear();
+        bmin_ = constructor.bmin_;
+        bmax_ = constructor.bmax_;
+
+        avx_ = enableAVX && isSupported();
+        if(!avx_){
+            qbvh_.copyFrom(constructor);
+            return;
+        }
+
+        if(constructor.nodes_.size()<=0){
+            //三角形が少なければ根が葉
+            root_ = (0<constructor.numFaces_)? QBVHConstructor::Node::getLeaf(0, constructor.numFaces_) : Node::EmptyMask;
+        }else{
+            lcore::Array<BuildNode> nodes;
+            root_ = collapse(nodes, constructor, 0);
+            numNodes_ = nodes.size();
+
+            //BuildNodeとNodeは同じ並び
+            nodes_ = (Node*)LALIGNED_MALLOC(sizeof(Node)*numNodes_, 32);
+            lcore::memcpy(nodes_, &nodes[0], sizeof(Node)*numNodes_);
+        }
+
+        numVertices_ = constructor.numVertices_;
+        vertices_ = (Vertex*)LMALLOC(sizeof(Vertex)*numVertices_);
+        lcore::memcpy(vertices_, constructor.vertices_, sizeof(Vertex)*numVertices_);
+
+        numFaces_ = constructor.numFaces_;
+        faces_ = (Face*)LMALLOC(sizeof(Face)*numFaces_);
+        lcore::memcpy(faces_, constructor.faces_, sizeof(Face)*numFaces_);
+    }
+
+    u32 OBVH::collapse(lcore::Array<BuildNode>& nodes, const QBVHConstructor& constructor, u32 index)
+    {
+        Child children[8];
+        s32 numChildren = gatherChildren(children, constructor.nodes_[index]);
+
+        //8つに収まる間, 表面積の大きい内部ノードを孫と置き換える
+        for(;;){
+            s32 best = -1;
+            s32 bestNum = 0;
+            f32 bestArea = -1.0f;
+            Child grandChildren[4];
+            for(s32 i=0; i<numChildren; ++i){
+                if(Node::isLeaf(children[i].index_)){
+                    continue;
+                }
+                f32 area = halfArea(children[i].bmin_, children[i].bmax_);
+                if(area<=bestArea){
+                    continue;
+                }
+                s32 num = gatherChildren(grandChildren, constructor.nodes_[children[i].index_]);
+                if(numChildren-1+num <= 8){
+                    best = i;
+                    bestNum = num;
+                    bestArea = area;
+                }
+            }
+            if(best<0){
+                break;
+            }
+
+            gatherChildren(grandChildren, constructor.nodes_[children[best].index_]);
+            if(bestNum<=0){
+                children[best] = children[--numChildren];
+                continue;
+            }
+            children[best] = grandChildren[0];
+            for(s32 i=1; i<bestNum; ++i){
+                children[numChildren++] = grandChildren[i];
+            }
+        }
+
+        u32 nindex = nodes.size();
+        nodes.push_back(BuildNode());
+        setNode(nodes[nindex], children, numChildren);
+
+        for(s32 i=0; i<numChildren; ++i){
+            if(!Node::isLeaf(children[i].index_)){
+                u32 child = collapse(nodes, constructor, children[i].index_);
+                nodes[nindex].children_[i] = child;
+            }
+        }
+        return nindex;
+    }
+
+    s32 OBVH::gatherChildren(Child* children, const QBVHConstructor::Node& node)
+    {
+        s32 numChildren = 0;
+        for(s32 i=0; i<4; ++i){
+            if(Node::isEmpty(node.children_[i])){
+                continue;
+            }
+            Child& child = children[numChildren++];
+            child.index_ = node.children_[i];
+            child.bmin_.set(node.bbox_[0][0][i], node.bbox_[0][1][i], node.bbox_[0][2][i]);
+            child.bmax_.set(node.bbox_[1][0][i], node.bbox_[1][1][i], node.bbox_[1][2][i]);
+        }
+        return numChildren;
+    }
+
+    void OBVH::setNode(BuildNode& node, const Child* children, s32 numChildren)
+    {
+        for(s32 i=0; i<8; ++i){
+            if(i<numChildren){
+                node.children_[i] = children[i].index_;
+                for(s32 j=0; j<3; ++j){
+                    node.bbox_[0][j][i] = children[i].bmin_[j];
+                    node.bbox_[1][j][i] = children[i].bmax_[j];
+                }
+            }else{
+                node.children_[i] = Node::EmptyMask;
+                for(s32 j=0; j<3; ++j){
+                    node.bbox_[0][j][i] = lcore::numeric_limits<f32>::maximum();
+                    node.bbox_[1][j][i] = -lcore::numeric_limits<f32>::maximum();
+                }
+            }
+        }
+
+        //8分円ごとに, 向きへ射影した中心の近い順. 空きは最後
+        for(s32 octant=0; octant<8; ++octant){
+            f32 dir[3];
+            for(s32 j=0; j<3; ++j){
+                dir[j] = (octant & (0x01<<j))? -1.0f : 1.0f;
+            }
+            s32 order[8];
+            f32 keys[8];
+            for(s32 i=0; i<numChildren; ++i){
+                lmath::Vector3 center = children[i].bmin_;
+                center += children[i].bmax_;
+                f32 key = center.x_*dir[0] + center.y_*dir[1] + center.z_*dir[2];
+
+                s32 j = i;
+                for(; 0<j && key<keys[j-1]; --j){
+                    keys[j] = keys[j-1];
+                    order[j] = order[j-1];
+                }
+                keys[j] = key;
+                order[j] = i;
+            }
+            for(s32 i=numChildren; i<8; ++i){
+                order[i] = i;
+            }
+
+            node.order_[octant] = 0;
+            for(s32 i=0; i<8; ++i){
+                node.order_[octant] |= static_cast<u32>(order[i]) << (i*4);
+            }
+        }
+    }
+
+    bool OBVH::test(HitRecord& hitRecord, const lmath::Ray& localRay)
+    {
+        if(!avx_){
+            return qbvh_.test(hitRecord, localRay);
+        }
+        hitRecord.face_ = NULL;
+#if defined(LCORE_CPU_X86)
+        f32 tmin, tmax;
+        if(!lmath::testRayAABB(tmin, tmax, localRay, bmin_, bmax_)){
+            return false;
+        }
+        return traverseAVX<false>(hitRecord, nodes_, root_, faces_, vertices_, localRay, localRay.t_);
+#else
+        return false;
+#endif
+    }
+
+    bool OBVH::testOcclusion(const lmath::Ray& localRay)
+    {
+        if(!avx_){
+            return qbvh_.testOcclusion(localRay);
+        }
+#if defined(LCORE_CPU_X86)
+        f32 tmin, tmax;
+        if(!lmath::testRayAABB(tmin, tmax, localRay, bmin_, bmax_)){
+            return false;
+        }
+        HitRecord hitRecord;
+        return traverseAVX<true>(hitRecord, nodes_, root_, faces_, vertices_, localRay, localRay.t_);
+#else
+        return false;
+#endif
+    }
+}
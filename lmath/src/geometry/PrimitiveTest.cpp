@@ -244,6 +244,88 @@ namespace lmath
         }
     }
 
+    //---------------------------------------------------------------------------------
+    // 点から三角形上の最近傍点を計算
+    f32 closestPointPointTriangle(
+        lmath::Vector3& result,
+        const lmath::Vector3& point,
+        const lmath::Vector3& p0,
+        const lmath::Vector3& p1,
+        const lmath::Vector3& p2)
+    {
+        //点がどのボロノイ領域にあるかで分ける
+        lmath::Vector3 e01 = p1 - p0;
+        lmath::Vector3 e02 = p2 - p0;
+
+        lmath::Vector3 d0 = point - p0;
+        f32 a1 = dot(e01, d0);
+        f32 a2 = dot(e02, d0);
+        if(a1<=0.0f && a2<=0.0f){
+            result = p0;
+            return dot(d0, d0);
+        }
+
+        lmath::Vector3 d1 = point - p1;
+        f32 a3 = dot(e01, d1);
+        f32 a4 = dot(e02, d1);
+        if(0.0f<=a3 && a4<=a3){
+            result = p1;
+            return dot(d1, d1);
+        }
+
+        f32 v2 = a1*a4 - a3*a2;
+        if(v2<=0.0f && 0.0f<=a1 && a3<=0.0f){
+            result = p0 + (a1/(a1-a3))*e01;
+            return distanceSqr(point, result);
+        }
+
+        lmath::Vector3 d2 = point - p2;
+        f32 a5 = dot(e01, d2);
+        f32 a6 = dot(e02, d2);
+        if(0.0f<=a6 && a5<=a6){
+            result = p2;
+            return dot(d2, d2);
+        }
+
+        f32 v1 = a5*a2 - a1*a6;
+        if(v1<=0.0f && 0.0f<=a2 && a6<=0.0f){
+            result = p0 + (a2/(a2-a6))*e02;
+            return distanceSqr(point, result);
+        }
+
+        f32 v0 = a3*a6 - a5*a4;
+        if(v0<=0.0f && 0.0f<=(a4-a3) && 0.0f<=(a5-a6)){
+            result = p1 + ((a4-a3)/((a4-a3)+(a5-a6)))*(p2-p1);
+            return distanceSqr(point, result);
+        }
+
+        f32 sum = v0 + v1 + v2;
+        if(sum<=0.0f){
+            //縮退した三角形は辺の最近傍点
+            lmath::Vector3 c;
+            closestPointPointSegment(result, point, p0, p1);
+            f32 minDistanceSqr = distanceSqr(point, result);
+            closestPointPointSegment(c, point, p1, p2);
+            f32 d = distanceSqr(point, c);
+            if(d<minDistanceSqr){
+                minDistanceSqr = d;
+                result = c;
+            }
+            closestPointPointSegment(c, point, p2, p0);
+            d = distanceSqr(point, c);
+            if(d<minDistanceSqr){
+                minDistanceSqr = d;
+                result = c;
+            }
+            return minDistanceSqr;
+        }
+
+        //面の内側
+        f32 invSum = 1.0f/sum;
+        result = p0 + (v1*invSum)*e01 + (v2*invSum)*e02;
+        return distanceSqr(point, result);
+    }
+
     //---------------------------------------------------------------------------------
     // 球と平面が交差するか
     bool testSpherePlane(f32 &t, const Sphere& sphere, const Plane& plane)
@@ -346,6 +428,113 @@ namespace lmath
         return distanceSqr <= (radius*radius);
     }
 
+    //---------------------------------------------------------------------------------
+    // 動く球と三角形の最初の接触
+    bool testSweptSphereTriangle(
+        f32& t,
+        lmath::Vector3& contact,
+        const Sphere& sphere,
+        const lmath::Vector3& direction,
+        f32 tmax,
+        const lmath::Vector3& p0,
+        const lmath::Vector3& p1,
+        const lmath::Vector3& p2)
+    {
+        const lmath::Vector3& center = sphere.position();
+        f32 radius = sphere.radius();
+        f32 radiusSqr = radius*radius;
+        if(closestPointPointTriangle(contact, center, p0, p1, p2) <= radiusSqr){
+            t = 0.0f;
+            return true;
+        }
+
+        //面の内側で接するなら, それが最初の接触
+        lmath::Vector3 normal = cross(p1-p0, p2-p0);
+        f32 lengthSqr = dot(normal, normal);
+        if(LMATH_F32_EPSILON<lengthSqr){
+            normal *= 1.0f/lmath::sqrt(lengthSqr);
+            f32 distance = dot(center-p0, normal);
+            if(distance<0.0f){
+                normal = -normal;
+                distance = -distance;
+            }
+            f32 speed = -dot(direction, normal);
+            if(LMATH_F32_EPSILON<speed){
+                f32 s = (distance-radius)/speed;
+                if(tmax<s){
+                    return false;
+                }
+                if(0.0f<=s){
+                    lmath::Vector3 q = center + s*direction - radius*normal;
+                    f32 c0 = dot(cross(p1-p0, q-p0), normal);
+                    f32 c1 = dot(cross(p2-p1, q-p1), normal);
+                    f32 c2 = dot(cross(p0-p2, q-p2), normal);
+                    if((0.0f<=c0 && 0.0f<=c1 && 0.0f<=c2) || (c0<=0.0f && c1<=0.0f && c2<=0.0f)){
+                        t = s;
+                        contact = q;
+                        return true;
+                    }
+                }
+            }else if(radius<distance){
+                //離れていく
+                return false;
+            }
+        }
+
+        //頂点の球と辺の円柱
+        bool hit = false;
+        const lmath::Vector3* points[4] = {&p0, &p1, &p2, &p0};
+        for(s32 i=0; i<3; ++i){
+            const lmath::Vector3& p = *points[i];
+            lmath::Vector3 m = center - p;
+            f32 b = dot(m, direction);
+            f32 c = dot(m, m) - radiusSqr;
+            f32 discriminant = b*b - c;
+            if(b<0.0f && 0.0f<=discriminant){
+                f32 s = -b - lmath::sqrt(discriminant);
+                if(s<=tmax){
+                    tmax = s;
+                    contact = p;
+                    hit = true;
+                }
+            }
+        }
+
+        for(s32 i=0; i<3; ++i){
+            const lmath::Vector3& p = *points[i];
+            lmath::Vector3 e = *points[i+1] - p;
+            lmath::Vector3 m = center - p;
+            f32 ee = dot(e, e);
+            f32 md = dot(m, e);
+            f32 nd = dot(direction, e);
+            f32 a = ee - nd*nd;
+            if(a<=LMATH_F32_EPSILON*ee){
+                //辺に平行. 端の球で判定済み
+                continue;
+            }
+            f32 b = ee*dot(m, direction) - md*nd;
+            f32 c = ee*(dot(m, m) - radiusSqr) - md*md;
+            f32 discriminant = b*b - a*c;
+            if(discriminant<0.0f){
+                continue;
+            }
+            f32 s = (-b - lmath::sqrt(discriminant))/a;
+            if(s<0.0f || tmax<s){
+                continue;
+            }
+            f32 u = md + s*nd;
+            if(0.0f<=u && u<=ee){
+                tmax = s;
+                contact = p + (u/ee)*e;
+                hit = true;
+            }
+        }
+        if(hit){
+            t = tmax;
+        }
+        return hit;
+    }
+
     //---------------------------------------------------------------------------------
     void clipTriangle(
         s32& numTriangles,
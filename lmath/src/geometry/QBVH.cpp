@@ -5,12 +5,23 @@
 */
 #include "geometry/QBVH.h"
 
+#include <lcore/CPU.h>
 #include <lcore/File.h>
 
 #include <lcore/Sort.h>
+#include <lcore/Thread.h>
 
 #include <lmath/geometry/Ray.h>
 #include <lmath/geometry/RayTest.h>
+#include <lmath/geometry/Sphere.h>
+#include <lmath/geometry/PrimitiveTest.h>
+
+//4本と8本の束で共通の判定. GCCは必ず展開して, 呼び出し側の命令セットで生成する
+#if defined(__GNUC__)
+#define LMATH_QBVH_KERNEL inline __attribute__((always_inline))
+#else
+#define LMATH_QBVH_KERNEL inline
+#endif
 
 namespace lmath
 {
@@ -52,6 +63,357 @@ namespace
     }
 
 
+    //-----------------------------------------------------------
+    /// 4本の光線を並べるSIMD
+    struct Lane4
+    {
+        typedef lm128 value_type;
+        static const s32 Size = 4;
+        static const s32 AllMask = 0x0F;
+
+        static lm128 set1(f32 x){ return _mm_set1_ps(x);}
+        static lm128 zero(){ return _mm_setzero_ps();}
+        static lm128 loadu(const f32* x){ return _mm_loadu_ps(x);}
+        static void storeu(f32* x, const lm128& v){ _mm_storeu_ps(x, v);}
+
+        static lm128 add(const lm128& x0, const lm128& x1){ return _mm_add_ps(x0, x1);}
+        static lm128 sub(const lm128& x0, const lm128& x1){ return _mm_sub_ps(x0, x1);}
+        static lm128 mul(const lm128& x0, const lm128& x1){ return _mm_mul_ps(x0, x1);}
+        static lm128 div(const lm128& x0, const lm128& x1){ return _mm_div_ps(x0, x1);}
+        static lm128 minimum(const lm128& x0, const lm128& x1){ return _mm_min_ps(x0, x1);}
+        static lm128 maximum(const lm128& x0, const lm128& x1){ return _mm_max_ps(x0, x1);}
+        static lm128 cmple(const lm128& x0, const lm128& x1){ return _mm_cmple_ps(x0, x1);}
+        static lm128 cmplt(const lm128& x0, const lm128& x1){ return _mm_cmplt_ps(x0, x1);}
+        static lm128 and_(const lm128& x0, const lm128& x1){ return _mm_and_ps(x0, x1);}
+        static s32 movemask(const lm128& x){ return _mm_movemask_ps(x);}
+
+        /// maskのビットが立っていればx1, そうでなければx0
+        static lm128 select(const lm128& x0, const lm128& x1, s32 mask)
+        {
+            lm128 m = _mm_castsi128_ps(_mm_setr_epi32(-(mask&0x01), -((mask>>1)&0x01), -((mask>>2)&0x01), -((mask>>3)&0x01)));
+            return _mm_or_ps(_mm_and_ps(m, x1), _mm_andnot_ps(m, x0));
+        }
+    };
+
+    /// 8本の光線を並べるSIMD. AVXの関数の中でだけ使う
+    struct Lane8
+    {
+        typedef __m256 value_type;
+        static const s32 Size = 8;
+        static const s32 AllMask = 0xFF;
+
+        LCORE_TARGET("avx") static inline __m256 set1(f32 x){ return _mm256_set1_ps(x);}
+        LCORE_TARGET("avx") static inline __m256 zero(){ return _mm256_setzero_ps();}
+        LCORE_TARGET("avx") static inline __m256 loadu(const f32* x){ return _mm256_loadu_ps(x);}
+        LCORE_TARGET("avx") static inline void storeu(f32* x, const __m256& v){ _mm256_storeu_ps(x, v);}
+
+        LCORE_TARGET("avx") static inline __m256 add(const __m256& x0, const __m256& x1){ return _mm256_add_ps(x0, x1);}
+        LCORE_TARGET("avx") static inline __m256 sub(const __m256& x0, const __m256& x1){ return _mm256_sub_ps(x0, x1);}
+        LCORE_TARGET("avx") static inline __m256 mul(const __m256& x0, const __m256& x1){ return _mm256_mul_ps(x0, x1);}
+        LCORE_TARGET("avx") static inline __m256 div(const __m256& x0, const __m256& x1){ return _mm256_div_ps(x0, x1);}
+        LCORE_TARGET("avx") static inline __m256 minimum(const __m256& x0, const __m256& x1){ return _mm256_min_ps(x0, x1);}
+        LCORE_TARGET("avx") static inline __m256 maximum(const __m256& x0, const __m256& x1){ return _mm256_max_ps(x0, x1);}
+        LCORE_TARGET("avx") static inline __m256 cmple(const __m256& x0, const __m256& x1){ return _mm256_cmp_ps(x0, x1, _CMP_LE_OQ);}
+        LCORE_TARGET("avx") static inline __m256 cmplt(const __m256& x0, const __m256& x1){ return _mm256_cmp_ps(x0, x1, _CMP_LT_OQ);}
+        LCORE_TARGET("avx") static inline __m256 and_(const __m256& x0, const __m256& x1){ return _mm256_and_ps(x0, x1);}
+        LCORE_TARGET("avx") static inline s32 movemask(const __m256& x){ return _mm256_movemask_ps(x);}
+
+        LCORE_TARGET("avx") static inline __m256 select(const __m256& x0, const __m256& x1, s32 mask)
+        {
+            __m256 m = _mm256_castsi256_ps(_mm256_setr_epi32(
+                -(mask&0x01), -((mask>>1)&0x01), -((mask>>2)&0x01), -((mask>>3)&0x01),
+                -((mask>>4)&0x01), -((mask>>5)&0x01), -((mask>>6)&0x01), -((mask>>7)&0x01)));
+            return _mm256_blendv_ps(x0, x1, m);
+        }
+    };
+
+    /// 8本の束を使うか. 結果は最初の呼び出しで決まる
+    bool useAVX()
+    {
+        static const bool avx = lcore::isSupportAVX();
+        return avx;
+    }
+
+//カーネルはAVXの入口に必ず展開されるので, AVXでない関数との間で__m256を受け渡すことはない
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+    /**
+    @brief 頂点0と2辺で表した三角形と光線の交差判定. 表面のみ
+    @return 下位Sizeビットが結果フラグ
+
+    RayTestのtestRayTriangleFrontと同じ計算を, 辺を前計算した形で行う.
+    辺が0の三角形は必ず外れる.
+    */
+    template<class T>
+    LMATH_QBVH_KERNEL s32 testRayTriangleFront(
+        typename T::value_type& t,
+        typename T::value_type& v,
+        typename T::value_type& w,
+        const typename T::value_type origin[3],
+        const typename T::value_type direction[3],
+        const typename T::value_type v0[3],
+        const typename T::value_type e1[3],
+        const typename T::value_type e2[3])
+    {
+        typedef typename T::value_type value_type;
+
+        //c = direction x e2
+        value_type cx = T::sub(T::mul(direction[1], e2[2]), T::mul(direction[2], e2[1]));
+        value_type cy = T::sub(T::mul(direction[2], e2[0]), T::mul(direction[0], e2[2]));
+        value_type cz = T::sub(T::mul(direction[0], e2[1]), T::mul(direction[1], e2[0]));
+
+        value_type zero = T::zero();
+        value_type discr = T::add(T::add(T::mul(cx, e1[0]), T::mul(cy, e1[1])), T::mul(cz, e1[2]));
+        //表面判定
+        value_type disc0 = T::cmplt(T::set1(LMATH_F32_EPSILON), discr);
+
+        value_type tvecx = T::sub(origin[0], v0[0]);
+        value_type tvecy = T::sub(origin[1], v0[1]);
+        value_type tvecz = T::sub(origin[2], v0[2]);
+        v = T::add(T::add(T::mul(cx, tvecx), T::mul(cy, tvecy)), T::mul(cz, tvecz));
+        value_type disc1 = T::and_(T::cmple(zero, v), T::cmple(v, discr));
+
+        //q = tvec x e1
+        value_type qx = T::sub(T::mul(tvecy, e1[2]), T::mul(tvecz, e1[1]));
+        value_type qy = T::sub(T::mul(tvecz, e1[0]), T::mul(tvecx, e1[2]));
+        value_type qz = T::sub(T::mul(tvecx, e1[1]), T::mul(tvecy, e1[0]));
+        w = T::add(T::add(T::mul(direction[0], qx), T::mul(direction[1], qy)), T::mul(direction[2], qz));
+        value_type disc2 = T::and_(T::cmple(zero, w), T::cmple(T::add(v, w), discr));
+
+        value_type invDiscr = T::div(T::set1(1.0f), discr);
+
+        t = T::add(T::add(T::mul(e2[0], qx), T::mul(e2[1], qy)), T::mul(e2[2], qz));
+        t = T::mul(t, invDiscr);
+        v = T::mul(v, invDiscr);
+        w = T::mul(w, invDiscr);
+        return T::movemask(T::and_(disc0, T::and_(disc1, disc2)));
+    }
+
+    inline lm128 minimum4(const lm128& x0, const lm128& x1, const lm128& x2, const lm128& x3)
+    {
+        return _mm_min_ps(_mm_min_ps(x0, x1), _mm_min_ps(x2, x3));
+    }
+
+    inline lm128 maximum4(const lm128& x0, const lm128& x1, const lm128& x2, const lm128& x3)
+    {
+        return _mm_max_ps(_mm_max_ps(x0, x1), _mm_max_ps(x2, x3));
+    }
+
+    /// 束の光線の原点と逆数の範囲
+    struct Frustum
+    {
+        lm128 originMin_[3];
+        lm128 originMax_[3];
+        lm128 invDirMin_[3];
+        lm128 invDirMax_[3];
+    };
+
+    /**
+    @brief 束の錐台で4つの子をまとめて判定する
+    @return どれかの光線が当たるかもしれない子のビット
+
+    (箱の面 - 原点)x逆数 を区間で計算し, 入る距離の下限が出る距離の上限を越える子を棄却する.
+    逆数の符号が軸ごとにそろっている束でだけ使える.
+    */
+    s32 testFrustum(const Frustum& frustum, const lm128 bbox[2][3], f32 tmax)
+    {
+        lm128 tnear = _mm_setzero_ps();
+        lm128 tfar = _mm_set1_ps(tmax);
+        for(s32 i=0; i<3; ++i){
+            lm128 n0 = _mm_sub_ps(bbox[0][i], frustum.originMax_[i]);
+            lm128 n1 = _mm_sub_ps(bbox[0][i], frustum.originMin_[i]);
+            lm128 f0 = _mm_sub_ps(bbox[1][i], frustum.originMax_[i]);
+            lm128 f1 = _mm_sub_ps(bbox[1][i], frustum.originMin_[i]);
+            const lm128& imin = frustum.invDirMin_[i];
+            const lm128& imax = frustum.invDirMax_[i];
+
+            lm128 nmin = minimum4(_mm_mul_ps(n0, imin), _mm_mul_ps(n0, imax), _mm_mul_ps(n1, imin), _mm_mul_ps(n1, imax));
+            lm128 nmax = maximum4(_mm_mul_ps(n0, imin), _mm_mul_ps(n0, imax), _mm_mul_ps(n1, imin), _mm_mul_ps(n1, imax));
+            lm128 fmin = minimum4(_mm_mul_ps(f0, imin), _mm_mul_ps(f0, imax), _mm_mul_ps(f1, imin), _mm_mul_ps(f1, imax));
+            lm128 fmax = maximum4(_mm_mul_ps(f0, imin), _mm_mul_ps(f0, imax), _mm_mul_ps(f1, imin), _mm_mul_ps(f1, imax));
+
+            //軸ごとの入る距離はmin, 出る距離はmax
+            tnear = _mm_max_ps(tnear, _mm_min_ps(nmin, fmin));
+            tfar = _mm_min_ps(tfar, _mm_max_ps(nmax, fmax));
+        }
+        return _mm_movemask_ps(_mm_cmple_ps(tnear, tfar));
+    }
+
+    inline u32 getBlockCount(u32 numFaces)
+    {
+        return (numFaces+3)>>2;
+    }
+
+    inline f32 halfArea(const lmath::Vector3& bmin, const lmath::Vector3& bmax)
+    {
+        lmath::Vector3 d = bmax;
+        d -= bmin;
+        return d.x_*d.y_ + d.y_*d.z_ + d.z_*d.x_;
+    }
+
+    inline void clearBBox(lmath::Vector3& bmin, lmath::Vector3& bmax)
+    {
+        bmin.set(lcore::numeric_limits<f32>::maximum(), lcore::numeric_limits<f32>::maximum(), lcore::numeric_limits<f32>::maximum());
+        bmax.set(lcore::numeric_limits<f32>::lowest(), lcore::numeric_limits<f32>::lowest(), lcore::numeric_limits<f32>::lowest());
+    }
+
+    //-----------------------------------------------------------
+    /// SAHのビン
+    struct Bin
+    {
+        lmath::Vector3 bmin_;
+        lmath::Vector3 bmax_;
+        u32 count_;
+    };
+
+    inline s32 getBin(f32 centroid, f32 cmin, f32 scale, s32 numBins)
+    {
+        s32 bin = static_cast<s32>((centroid-cmin)*scale);
+        return lcore::clamp(bin, 0, numBins-1);
+    }
+
+    typedef Bin Bins[3][QBVHConstructor::MaxBins];
+
+    void clearBins(Bins& bins, s32 numBins)
+    {
+        for(s32 i=0; i<3; ++i){
+            for(s32 j=0; j<numBins; ++j){
+                clearBBox(bins[i][j].bmin_, bins[i][j].bmax_);
+                bins[i][j].count_ = 0;
+            }
+        }
+    }
+
+    /// min, maxと個数だけなので, どの順に合わせても同じ結果になる
+    void mergeBins(Bins& bins, const Bins& src, s32 numBins)
+    {
+        for(s32 i=0; i<3; ++i){
+            for(s32 j=0; j<numBins; ++j){
+                bins[i][j].bmin_ = lmath::minimum(bins[i][j].bmin_, src[i][j].bmin_);
+                bins[i][j].bmax_ = lmath::maximum(bins[i][j].bmax_, src[i][j].bmax_);
+                bins[i][j].count_ += src[i][j].count_;
+            }
+        }
+    }
+
+    template<class T>
+    void getCentroidBounds(lmath::Vector3& cmin, lmath::Vector3& cmax, const T* bounds, u32 begin, u32 end)
+    {
+        cmin = bounds[begin].centroid_;
+        cmax = bounds[begin].centroid_;
+        for(u32 i=begin+1; i<end; ++i){
+            cmin = lmath::minimum(cmin, bounds[i].centroid_);
+            cmax = lmath::maximum(cmax, bounds[i].centroid_);
+        }
+    }
+
+    template<class T>
+    void binning(Bins& bins, const T* bounds, u32 begin, u32 end, const lmath::Vector3& cmin, const f32 scale[3], s32 numBins)
+    {
+        for(u32 i=begin; i<end; ++i){
+            const T& bound = bounds[i];
+            for(s32 j=0; j<3; ++j){
+                if(scale[j]<=0.0f){
+                    continue;
+                }
+                Bin& bin = bins[j][getBin(bound.centroid_[j], cmin[j], scale[j], numBins)];
+                bin.bmin_ = lmath::minimum(bin.bmin_, bound.bmin_);
+                bin.bmax_ = lmath::maximum(bin.bmax_, bound.bmax_);
+                ++bin.count_;
+            }
+        }
+    }
+
+    /**
+    @brief 左右から掃引して, 面積x個数の和が最小の面を探す
+    @return 最小のコスト. 分けられなければbestAxisは-1
+    */
+    f32 findSplit(s32& bestAxis, s32& bestPlane, const Bins& bins, const f32 scale[3], s32 numBins, u32 numFaces)
+    {
+        f32 bestCost = lcore::numeric_limits<f32>::maximum();
+        bestAxis = -1;
+        bestPlane = 0;
+        f32 rightCost[QBVHConstructor::MaxBins];
+        for(s32 i=0; i<3; ++i){
+            if(scale[i]<=0.0f){
+                continue;
+            }
+            lmath::Vector3 bmin, bmax;
+            u32 count = 0;
+            clearBBox(bmin, bmax);
+            for(s32 j=numBins-1; 0<j; --j){
+                const Bin& bin = bins[i][j];
+                if(0<bin.count_){
+                    bmin = lmath::minimum(bmin, bin.bmin_);
+                    bmax = lmath::maximum(bmax, bin.bmax_);
+                    count += bin.count_;
+                }
+                rightCost[j] = (0<count)? halfArea(bmin, bmax)*count : 0.0f;
+            }
+
+            count = 0;
+            clearBBox(bmin, bmax);
+            for(s32 j=0; j<numBins-1; ++j){
+                const Bin& bin = bins[i][j];
+                if(0<bin.count_){
+                    bmin = lmath::minimum(bmin, bin.bmin_);
+                    bmax = lmath::maximum(bmax, bin.bmax_);
+                    count += bin.count_;
+                }
+                if(count<=0 || numFaces<=count){
+                    continue;
+                }
+                f32 cost = halfArea(bmin, bmax)*count + rightCost[j+1];
+                if(cost<bestCost){
+                    bestCost = cost;
+                    bestAxis = i;
+                    bestPlane = j;
+                }
+            }
+        }
+        return bestCost;
+    }
+
+    inline u32 getNumChunks(u32 numFaces)
+    {
+        return (numFaces + QBVHConstructor::ParallelChunkFaces - 1)/QBVHConstructor::ParallelChunkFaces;
+    }
+
+    /// チャンクごとに重心範囲とビンを作る
+    template<class T>
+    struct BinningJob
+    {
+        static void centroidProc(void* data, u32 chunk)
+        {
+            BinningJob& job = *reinterpret_cast<BinningJob*>(data);
+            u32 begin = job.begin_ + chunk*QBVHConstructor::ParallelChunkFaces;
+            u32 end = lcore::minimum(begin+QBVHConstructor::ParallelChunkFaces, job.end_);
+            getCentroidBounds(job.cmin_[chunk], job.cmax_[chunk], job.bounds_, begin, end);
+        }
+
+        static void binningProc(void* data, u32 chunk)
+        {
+            BinningJob& job = *reinterpret_cast<BinningJob*>(data);
+            u32 begin = job.begin_ + chunk*QBVHConstructor::ParallelChunkFaces;
+            u32 end = lcore::minimum(begin+QBVHConstructor::ParallelChunkFaces, job.end_);
+            clearBins(job.bins_[chunk], job.numBins_);
+            binning(job.bins_[chunk], job.bounds_, begin, end, job.centroidMin_, job.scale_, job.numBins_);
+        }
+
+        const T* bounds_;
+        u32 begin_;
+        u32 end_;
+        lmath::Vector3* cmin_;
+        lmath::Vector3* cmax_;
+        Bins* bins_;
+        lmath::Vector3 centroidMin_;
+        f32 scale_[3];
+        s32 numBins_;
+    };
+
     //-----------------------------------------------------------
     //AABBの交差判定
     s32 testAABB(const lmath::lm128 bbox0[2][3], const lmath::lm128 bbox1[2][3]){
@@ -83,9 +445,75 @@ namespace
         }
         return _mm_movemask_ps(t);
     }
+
+    //-----------------------------------------------------------
+    /// 点から4つの箱への距離の平方. 空きの箱は無限大
+    lmath::lm128 distanceSqrAABB(const lmath::lm128 point[3], const lmath::lm128 bbox[2][3])
+    {
+        lmath::lm128 zero = _mm_setzero_ps();
+        lmath::lm128 distance = zero;
+        for(s32 i=0; i<3; ++i){
+            lmath::lm128 d = _mm_max_ps(_mm_sub_ps(bbox[0][i], point[i]), _mm_sub_ps(point[i], bbox[1][i]));
+            d = _mm_max_ps(d, zero);
+            distance = _mm_add_ps(distance, _mm_mul_ps(d, d));
+        }
+        return distance;
+    }
+
+    /**
+    @brief 動く球と4つの箱. 箱を半径だけ広げて光線で判定する
+    @param tnear ... 出力. 広げた箱に入る距離
+    @param sign ... 移動方向の符号. 負なら1
+    */
+    s32 testSweptSphereAABB(
+        lmath::lm128& tnear,
+        const lmath::lm128 origin[3],
+        const lmath::lm128 invDir[3],
+        const s32 sign[3],
+        const lmath::lm128& radius,
+        const lmath::lm128& tmax,
+        const lmath::lm128 bbox[2][3])
+    {
+        tnear = _mm_setzero_ps();
+        lmath::lm128 tfar = tmax;
+        for(s32 i=0; i<3; ++i){
+            lmath::lm128 bnear = (0==sign[i])? _mm_sub_ps(bbox[0][i], radius) : _mm_add_ps(bbox[1][i], radius);
+            lmath::lm128 bfar = (0==sign[i])? _mm_add_ps(bbox[1][i], radius) : _mm_sub_ps(bbox[0][i], radius);
+            tnear = _mm_max_ps(tnear, _mm_mul_ps(_mm_sub_ps(bnear, origin[i]), invDir[i]));
+            tfar = _mm_min_ps(tfar, _mm_mul_ps(_mm_sub_ps(bfar, origin[i]), invDir[i]));
+        }
+        return _mm_movemask_ps(_mm_cmple_ps(tnear, tfar));
+    }
+
+    //-----------------------------------------------------------
+    /// 距離順に辿るスタックの要素
+    struct QueryEntry
+    {
+        u32 index_;
+        f32 key_; ///< 箱までの距離. 小さいほど先に取り出す
+    };
+
+    /// 遠い順に積んで, 近い子を先に取り出す
+    inline s32 pushOrdered(QueryEntry* stack, s32 top, QueryEntry* children, s32 numChildren)
+    {
+        for(s32 i=1; i<numChildren; ++i){
+            QueryEntry entry = children[i];
+            s32 j = i;
+            for(; 0<j && children[j-1].key_<entry.key_; --j){
+                children[j] = children[j-1];
+            }
+            children[j] = entry;
+        }
+        for(s32 i=0; i<numChildren; ++i){
+            LASSERT((top+1)<static_cast<s32>(QBVH::TestStackSize));
+            stack[++top] = children[i];
+        }
+        return top;
+    }
 }
 
     const f32 QBVHConstructor::BoundingExpansion = LMATH_F32_EPSILON*2.0f;
+    const f32 QBVH::DefaultRebuildRatio = 1.5f;
 
     struct QBVHConstructor::FaceSortFunc
     {
@@ -115,10 +543,13 @@ namespace
 
     QBVHConstructor::QBVHConstructor()
         :boundingExpansion_(BoundingExpansion)
+        ,splitMethod_(SplitMethod_Median)
+        ,numBins_(DefaultBins)
         ,numVertices_(0)
         ,vertices_(NULL)
         ,numFaces_(0)
         ,faces_(NULL)
+        ,faceBounds_(NULL)
     {
     }
 
@@ -128,7 +559,68 @@ namespace
         LDELETE_ARRAY(faces_);
     }
 
+    struct QBVHConstructor::SubtreeJob
+    {
+        QBVHConstructor* constructor_;
+        lcore::Array<Subtree>* subtrees_;
+        lcore::Array<Node>* nodes_;
+    };
+
     void QBVHConstructor::construct(u32 numVertices, Vertex* vertices, u32 numFaces, Face* faces, const lmath::Vector3& bmin, const lmath::Vector3& bmax)
+    {
+        initialize(numVertices, vertices, numFaces, faces, bmin, bmax);
+
+        Build build = {&nodes_, NULL, NULL, 0};
+        if(SplitMethod_BinnedSAH == splitMethod_){
+            faceBounds_ = LNEW FaceBound[numFaces];
+            calcFaceBounds(0, numFaces);
+            recursiveConstructSAH(build, 0, numFaces);
+            LDELETE_ARRAY(faceBounds_);
+        }else{
+            recursiveConstruct(build, 0, numFaces, bmin, bmax);
+        }
+    }
+
+    void QBVHConstructor::construct(lcore::ThreadPool& threadPool, u32 numVertices, Vertex* vertices, u32 numFaces, Face* faces, const lmath::Vector3& bmin, const lmath::Vector3& bmax)
+    {
+        u32 numThreads = static_cast<u32>(threadPool.getNumMaxThreads()) + 1;
+        u32 subtreeFaces = lcore::maximum(MinSubtreeFaces, numFaces/(numThreads*SubtreesPerThread));
+        if(numFaces<=subtreeFaces){
+            construct(numVertices, vertices, numFaces, faces, bmin, bmax);
+            return;
+        }
+        initialize(numVertices, vertices, numFaces, faces, bmin, bmax);
+
+        //上位の階層. 小さくなった部分木は後回しにする
+        lcore::Array<Node> top;
+        lcore::Array<Subtree> subtrees;
+        Build build = {&top, &threadPool, &subtrees, subtreeFaces};
+        if(SplitMethod_BinnedSAH == splitMethod_){
+            faceBounds_ = LNEW FaceBound[numFaces];
+            lcore::parallelFor(&threadPool, calcFaceBoundsProc, this, getNumChunks(numFaces));
+            recursiveConstructSAH(build, 0, numFaces);
+        }else{
+            recursiveConstruct(build, 0, numFaces, bmin, bmax);
+        }
+
+        //部分木ごとに別の配列へ構築する
+        lcore::Array<Node>* subtreeNodes = LNEW lcore::Array<Node>[subtrees.size()];
+        SubtreeJob job = {this, &subtrees, subtreeNodes};
+        lcore::parallelFor(&threadPool, constructSubtreeProc, &job, subtrees.size());
+
+        //逐次構築と同じ順に詰める
+        s32 numNodes = top.size();
+        for(s32 i=0; i<subtrees.size(); ++i){
+            numNodes += subtreeNodes[i].size();
+        }
+        nodes_.reserve(numNodes);
+        compact(top, 0, subtrees, subtreeNodes);
+
+        LDELETE_ARRAY(subtreeNodes);
+        LDELETE_ARRAY(faceBounds_);
+    }
+
+    void QBVHConstructor::initialize(u32 numVertices, Vertex* vertices, u32 numFaces, Face* faces, const lmath::Vector3& bmin, const lmath::Vector3& bmax)
     {
         LASSERT(NULL != vertices);
         LASSERT(NULL != faces);
@@ -147,7 +639,123 @@ namespace
         u32 numNodes = static_cast<u32>(lmath::pow(4.0f, depth));
         nodes_.clear();
         nodes_.reserve(numNodes);
-        recursiveConstruct(0, numFaces, bmin, bmax);
+    }
+
+    void QBVHConstructor::calcFaceBounds(u32 begin, u32 end)
+    {
+        for(u32 i=begin; i<end; ++i){
+            FaceBound& bound = faceBounds_[i];
+            calcBBox(bound.bmin_, bound.bmax_, faces_[i]);
+            bound.centroid_ = bound.bmin_;
+            bound.centroid_ += bound.bmax_;
+            bound.centroid_ *= 0.5f;
+        }
+    }
+
+    void QBVHConstructor::calcFaceBoundsProc(void* data, u32 chunk)
+    {
+        QBVHConstructor* constructor = reinterpret_cast<QBVHConstructor*>(data);
+        u32 begin = chunk*ParallelChunkFaces;
+        u32 end = lcore::minimum(begin+ParallelChunkFaces, constructor->numFaces_);
+        constructor->calcFaceBounds(begin, end);
+    }
+
+    void QBVHConstructor::constructSubtreeProc(void* data, u32 index)
+    {
+        SubtreeJob& job = *reinterpret_cast<SubtreeJob*>(data);
+        QBVHConstructor* constructor = job.constructor_;
+        Subtree& subtree = (*job.subtrees_)[index];
+        Build build = {&job.nodes_[index], NULL, NULL, 0};
+        if(SplitMethod_BinnedSAH == constructor->splitMethod_){
+            subtree.root_ = constructor->recursiveConstructSAH(build, subtree.begin_, subtree.numFaces_);
+        }else{
+            subtree.root_ = constructor->recursiveConstruct(build, subtree.begin_, subtree.numFaces_, subtree.bmin_, subtree.bmax_);
+        }
+    }
+
+    u32 QBVHConstructor::pushSubtree(Build& build, u32 begin, u32 numFaces, const lmath::Vector3& bmin, const lmath::Vector3& bmax)
+    {
+        Subtree subtree;
+        subtree.begin_ = begin;
+        subtree.numFaces_ = numFaces;
+        subtree.bmin_ = bmin;
+        subtree.bmax_ = bmax;
+        subtree.root_ = Node::EmptyMask;
+        u32 index = build.subtrees_->size();
+        build.subtrees_->push_back(subtree);
+        return getSubtree(index);
+    }
+
+    u32 QBVHConstructor::compact(const lcore::Array<Node>& src, u32 index, const lcore::Array<Subtree>& subtrees, const lcore::Array<Node>* subtreeNodes)
+    {
+        //先に親を置いて, 子を順に辿る
+        u32 nindex = nodes_.size();
+        nodes_.push_back(src[index]);
+        for(s32 i=0; i<4; ++i){
+            u32 child = src[index].children_[i];
+            if(isSubtree(child)){
+                u32 subtree = getSubtreeIndex(child);
+                child = subtrees[subtree].root_;
+                if(!Node::isLeaf(child)){
+                    child = compact(subtreeNodes[subtree], child, subtrees, subtreeNodes);
+                }
+            }else if(!Node::isLeaf(child)){
+                child = compact(src, child, subtrees, subtreeNodes);
+            }
+            nodes_[nindex].children_[i] = child;
+        }
+        return nindex;
+    }
+
+    f32 QBVHConstructor::calcSAHCost(f32 traversalCost, f32 intersectionCost) const
+    {
+        if(nodes_.size()<=0){
+            return intersectionCost*numFaces_;
+        }
+
+        //根の境界は子の境界の和
+        const Node& root = nodes_[0];
+        lmath::Vector3 bmin, bmax;
+        clearBBox(bmin, bmax);
+        for(s32 i=0; i<4; ++i){
+            if(Node::isEmpty(root.children_[i])){
+                continue;
+            }
+            for(s32 j=0; j<3; ++j){
+                bmin[j] = lcore::minimum(bmin[j], root.bbox_[0][j][i]);
+                bmax[j] = lcore::maximum(bmax[j], root.bbox_[1][j][i]);
+            }
+        }
+        f32 area = halfArea(bmin, bmax);
+        if(area<=LMATH_F32_EPSILON){
+            //全て1点に縮退している
+            return traversalCost + intersectionCost*numFaces_;
+        }
+        return calcSAHCost(0, area, 1.0f/area, traversalCost, intersectionCost);
+    }
+
+    f32 QBVHConstructor::calcSAHCost(u32 index, f32 area, f32 invRootArea, f32 traversalCost, f32 intersectionCost) const
+    {
+        const Node& node = nodes_[index];
+        f32 cost = traversalCost*area*invRootArea;
+        for(s32 i=0; i<4; ++i){
+            u32 child = node.children_[i];
+            if(Node::isEmpty(child)){
+                continue;
+            }
+            lmath::Vector3 bmin, bmax;
+            for(s32 j=0; j<3; ++j){
+                bmin[j] = node.bbox_[0][j][i];
+                bmax[j] = node.bbox_[1][j][i];
+            }
+            f32 childArea = halfArea(bmin, bmax);
+            if(Node::isLeaf(child)){
+                cost += intersectionCost*Node::getFaceNum(child)*childArea*invRootArea;
+            }else{
+                cost += calcSAHCost(child, childArea, invRootArea, traversalCost, intersectionCost);
+            }
+        }
+        return cost;
     }
 
     void QBVHConstructor::save(const Char* filepath)
@@ -208,7 +816,7 @@ namespace
         out.close();
     }
 
-    u32 QBVHConstructor::recursiveConstruct(u32 begin, u32 numFaces, const lmath::Vector3& bmin, const lmath::Vector3& bmax)
+    u32 QBVHConstructor::recursiveConstruct(Build& build, u32 begin, u32 numFaces, const lmath::Vector3& bmin, const lmath::Vector3& bmax)
     {
         if(0 == numFaces){
             return Node::EmptyMask;
@@ -218,6 +826,9 @@ namespace
             return Node::getLeaf(begin, numFaces);
 
         }
+        if(NULL != build.subtrees_ && numFaces<=build.subtreeFaces_){
+            return pushSubtree(build, begin, numFaces, bmin, bmax);
+        }
         //u32 end = begin + numFaces - 1;
         s32 axis0;
         s32 axis1;
@@ -251,7 +862,8 @@ namespace
             sort(num, faces_+mid0, axis2);
         }
 
-        u32 nindex = nodes_.size();
+        lcore::Array<Node>& nodes = *build.nodes_;
+        u32 nindex = nodes.size();
         u32 ranges[4][2];
 
         ranges[0][0] = begin;
@@ -264,91 +876,240 @@ namespace
         ranges[3][1] = begin + numFaces;
 
         lmath::Vector3 minmax[4][2];
-        LALIGN16 f32 bbox[2][3][4];
         {
             for(s32 i=0; i<4; ++i){
                 u32 num = ranges[i][1] - ranges[i][0];
                 getBBox(minmax[i][0], minmax[i][1], faces_+ranges[i][0], num);
             }
 
-            for(s32 i=0; i<3; ++i){
-                for(s32 j=0; j<4; ++j){
-                    bbox[0][i][j] = minmax[j][0][i] - boundingExpansion_;
-                    bbox[1][i][j] = minmax[j][1][i] + boundingExpansion_;
-                }
-            }
-
-            nodes_.push_back(Node());
-            Node& node = nodes_[nindex];
-            node.axis0_ = axis0;
-            node.axis1_ = axis1;
-            node.axis2_ = axis2;
-            for(s32 i=0; i<2; ++i){
-                for(s32 j=0; j<3; ++j){
-                    //node.bbox_[i][j] = _mm_loadu_ps(bbox[i][j]);
-                    lcore::memcpy(node.bbox_[i][j], bbox[i][j], sizeof(f32)*4);
-                }
-            }
+            nodes.push_back(Node());
+            setNode(nodes[nindex], axis0, axis1, axis2, minmax);
         }
 
         u32 ret;
         for(s32 i=0; i<4; ++i){
             u32 num = ranges[i][1] - ranges[i][0];
-            ret = recursiveConstruct(ranges[i][0], num, minmax[i][0], minmax[i][1]);
-            nodes_[nindex].children_[i] = ret;
+            ret = recursiveConstruct(build, ranges[i][0], num, minmax[i][0], minmax[i][1]);
+            nodes[nindex].children_[i] = ret;
         }
         return nindex;
     }
 
-
-    void QBVHConstructor::sort(u32 numFaces, Face* faces, s32 axis)
-    {
-        FaceSortFunc func(axis, this);
-        lcore::heapsort(numFaces, faces, func);
-    }
-
-    void QBVHConstructor::calcBBox(lmath::Vector3& bmin, lmath::Vector3& bmax, const Face& face)
+    u32 QBVHConstructor::recursiveConstructSAH(Build& build, u32 begin, u32 numFaces)
     {
-        const lmath::Vector3& v0 = vertices_[face.v0_].position_;
-        const lmath::Vector3& v1 = vertices_[face.v1_].position_;
-        const lmath::Vector3& v2 = vertices_[face.v2_].position_;
-
-        bmin.x_ = lcore::minimum(v0.x_, v1.x_);
-        bmin.y_ = lcore::minimum(v0.y_, v1.y_);
-        bmin.z_ = lcore::minimum(v0.z_, v1.z_);
+        if(0 == numFaces){
+            return Node::EmptyMask;
+        }
 
-        bmax.x_ = lcore::maximum(v0.x_, v1.x_);
-        bmax.y_ = lcore::maximum(v0.y_, v1.y_);
-        bmax.z_ = lcore::maximum(v0.z_, v1.z_);
+        if(numFaces<=MinLeafFaces){
+            return Node::getLeaf(begin, numFaces);
+        }
+        if(NULL != build.subtrees_ && numFaces<=build.subtreeFaces_){
+            return pushSubtree(build, begin, numFaces, bmin_, bmax_);
+        }
 
-        bmin.x_ = lcore::minimum(bmin.x_, v2.x_);
-        bmin.y_ = lcore::minimum(bmin.y_, v2.y_);
-        bmin.z_ = lcore::minimum(bmin.z_, v2.z_);
+        //2分割を2段まとめて4分岐にする. 葉の大きさ以下の半分は分けない
+        u32 end = begin + numFaces;
+        s32 axis0;
+        u32 mid0 = splitSAH(axis0, begin, numFaces, build.threadPool_);
 
-        bmax.x_ = lcore::maximum(bmax.x_, v2.x_);
-        bmax.y_ = lcore::maximum(bmax.y_, v2.y_);
-        bmax.z_ = lcore::maximum(bmax.z_, v2.z_);
-    }
+        s32 axis1 = axis0;
+        u32 mid1 = mid0;
+        if(MinLeafFaces < (mid0-begin)){
+            mid1 = splitSAH(axis1, begin, mid0-begin, build.threadPool_);
+        }
 
-    void QBVHConstructor::getBBox(lmath::Vector3& bmin, lmath::Vector3& bmax, const Face* faces, u32 numFaces)
-    {
-        bmin.set(lcore::numeric_limits<f32>::maximum(), lcore::numeric_limits<f32>::maximum(), lcore::numeric_limits<f32>::maximum());
-        bmax.set(lcore::numeric_limits<f32>::lowest(), lcore::numeric_limits<f32>::lowest(), lcore::numeric_limits<f32>::lowest());
+        s32 axis2 = axis0;
+        u32 mid2 = end;
+        if(MinLeafFaces < (end-mid0)){
+            mid2 = splitSAH(axis2, mid0, end-mid0, build.threadPool_);
+        }
 
-        lmath::Vector3 tmin, tmax;
-        for(u32 i=0; i<numFaces; ++i){
-            calcBBox(tmin, tmax, faces[i]);
+        u32 ranges[4][2];
+        ranges[0][0] = begin;
+        ranges[0][1] = mid1;
+        ranges[1][0] = mid1;
+        ranges[1][1] = mid0;
+        ranges[2][0] = mid0;
+        ranges[2][1] = mid2;
+        ranges[3][0] = mid2;
+        ranges[3][1] = end;
 
-            for(s32 j=0; j<3; ++j){
-                bmin[j] = lcore::minimum(tmin[j], bmin[j]);
-                bmax[j] = lcore::maximum(tmax[j], bmax[j]);
+        lcore::Array<Node>& nodes = *build.nodes_;
+        u32 nindex = nodes.size();
+        {
+            lmath::Vector3 minmax[4][2];
+            for(s32 i=0; i<4; ++i){
+                getBBoxSAH(minmax[i][0], minmax[i][1], ranges[i][0], ranges[i][1]-ranges[i][0]);
+            }
+            nodes.push_back(Node());
+            setNode(nodes[nindex], axis0, axis1, axis2, minmax);
+        }
+
+        for(s32 i=0; i<4; ++i){
+            u32 child = recursiveConstructSAH(build, ranges[i][0], ranges[i][1]-ranges[i][0]);
+            nodes[nindex].children_[i] = child;
+        }
+        return nindex;
+    }
+
+    u32 QBVHConstructor::splitSAH(s32& axis, u32 begin, u32 numFaces, lcore::ThreadPool* threadPool)
+    {
+        LASSERT(1<numFaces);
+        u32 end = begin + numFaces;
+
+        u32 numChunks = getNumChunks(numFaces);
+        bool parallel = NULL != threadPool && 1<numChunks;
+        BinningJob<FaceBound> job;
+        if(parallel){
+            job.bounds_ = faceBounds_;
+            job.begin_ = begin;
+            job.end_ = end;
+            job.cmin_ = LNEW lmath::Vector3[numChunks*2];
+            job.cmax_ = job.cmin_ + numChunks;
+            job.bins_ = LNEW Bins[numChunks];
+            job.numBins_ = numBins_;
+        }
+
+        //重心の範囲でビンを切る
+        lmath::Vector3 cmin;
+        lmath::Vector3 cmax;
+        if(parallel){
+            lcore::parallelFor(threadPool, BinningJob<FaceBound>::centroidProc, &job, numChunks);
+            cmin = job.cmin_[0];
+            cmax = job.cmax_[0];
+            for(u32 i=1; i<numChunks; ++i){
+                cmin = lmath::minimum(cmin, job.cmin_[i]);
+                cmax = lmath::maximum(cmax, job.cmax_[i]);
+            }
+        }else{
+            getCentroidBounds(cmin, cmax, faceBounds_, begin, end);
+        }
+
+        Bins bins;
+        f32 scale[3];
+        for(s32 i=0; i<3; ++i){
+            f32 extent = cmax[i] - cmin[i];
+            scale[i] = (LMATH_F32_EPSILON<extent)? static_cast<f32>(numBins_)/extent : 0.0f;
+        }
+        clearBins(bins, numBins_);
+
+        if(parallel){
+            job.centroidMin_ = cmin;
+            for(s32 i=0; i<3; ++i){
+                job.scale_[i] = scale[i];
+            }
+            lcore::parallelFor(threadPool, BinningJob<FaceBound>::binningProc, &job, numChunks);
+            for(u32 i=0; i<numChunks; ++i){
+                mergeBins(bins, job.bins_[i], numBins_);
+            }
+            LDELETE_ARRAY(job.bins_);
+            LDELETE_ARRAY(job.cmin_);
+        }else{
+            binning(bins, faceBounds_, begin, end, cmin, scale, numBins_);
+        }
+
+        s32 bestAxis;
+        s32 bestPlane;
+        findSplit(bestAxis, bestPlane, bins, scale, numBins_, numFaces);
+
+        if(bestAxis<0){
+            //重心が全て同じ位置. 個数で半分にする
+            lmath::Vector3 bmin, bmax;
+            getBBoxSAH(bmin, bmax, begin, numFaces);
+            axis = calcAxis(bmin, bmax);
+            return begin + (numFaces>>1);
+        }
+
+        u32 left = begin;
+        u32 right = end;
+        while(left<right){
+            if(getBin(faceBounds_[left].centroid_[bestAxis], cmin[bestAxis], scale[bestAxis], numBins_)<=bestPlane){
+                ++left;
+            }else{
+                --right;
+                lcore::swap(faces_[left], faces_[right]);
+                lcore::swap(faceBounds_[left], faceBounds_[right]);
+            }
+        }
+        axis = bestAxis;
+        return left;
+    }
+
+    void QBVHConstructor::setNode(Node& node, s32 axis0, s32 axis1, s32 axis2, const lmath::Vector3 minmax[4][2])
+    {
+        node.axis0_ = axis0;
+        node.axis1_ = axis1;
+        node.axis2_ = axis2;
+        node.reserved_ = 0;
+        for(s32 i=0; i<3; ++i){
+            for(s32 j=0; j<4; ++j){
+                node.bbox_[0][i][j] = minmax[j][0][i] - boundingExpansion_;
+                node.bbox_[1][i][j] = minmax[j][1][i] + boundingExpansion_;
+            }
+        }
+    }
+
+    void QBVHConstructor::getBBoxSAH(lmath::Vector3& bmin, lmath::Vector3& bmax, u32 begin, u32 numFaces) const
+    {
+        clearBBox(bmin, bmax);
+        for(u32 i=begin; i<begin+numFaces; ++i){
+            bmin = lmath::minimum(bmin, faceBounds_[i].bmin_);
+            bmax = lmath::maximum(bmax, faceBounds_[i].bmax_);
+        }
+    }
+
+
+    void QBVHConstructor::sort(u32 numFaces, Face* faces, s32 axis)
+    {
+        FaceSortFunc func(axis, this);
+        lcore::heapsort(numFaces, faces, func);
+    }
+
+    void QBVHConstructor::calcBBox(lmath::Vector3& bmin, lmath::Vector3& bmax, const Face& face)
+    {
+        const lmath::Vector3& v0 = vertices_[face.v0_].position_;
+        const lmath::Vector3& v1 = vertices_[face.v1_].position_;
+        const lmath::Vector3& v2 = vertices_[face.v2_].position_;
+
+        bmin.x_ = lcore::minimum(v0.x_, v1.x_);
+        bmin.y_ = lcore::minimum(v0.y_, v1.y_);
+        bmin.z_ = lcore::minimum(v0.z_, v1.z_);
+
+        bmax.x_ = lcore::maximum(v0.x_, v1.x_);
+        bmax.y_ = lcore::maximum(v0.y_, v1.y_);
+        bmax.z_ = lcore::maximum(v0.z_, v1.z_);
+
+        bmin.x_ = lcore::minimum(bmin.x_, v2.x_);
+        bmin.y_ = lcore::minimum(bmin.y_, v2.y_);
+        bmin.z_ = lcore::minimum(bmin.z_, v2.z_);
+
+        bmax.x_ = lcore::maximum(bmax.x_, v2.x_);
+        bmax.y_ = lcore::maximum(bmax.y_, v2.y_);
+        bmax.z_ = lcore::maximum(bmax.z_, v2.z_);
+    }
+
+    void QBVHConstructor::getBBox(lmath::Vector3& bmin, lmath::Vector3& bmax, const Face* faces, u32 numFaces)
+    {
+        bmin.set(lcore::numeric_limits<f32>::maximum(), lcore::numeric_limits<f32>::maximum(), lcore::numeric_limits<f32>::maximum());
+        bmax.set(lcore::numeric_limits<f32>::lowest(), lcore::numeric_limits<f32>::lowest(), lcore::numeric_limits<f32>::lowest());
+
+        lmath::Vector3 tmin, tmax;
+        for(u32 i=0; i<numFaces; ++i){
+            calcBBox(tmin, tmax, faces[i]);
+
+            for(s32 j=0; j<3; ++j){
+                bmin[j] = lcore::minimum(tmin[j], bmin[j]);
+                bmax[j] = lcore::maximum(tmax[j], bmax[j]);
             }
         }
     }
 
 
     QBVH::QBVH()
-        :numNodes_(0)
+        :boundingExpansion_(QBVHConstructor::BoundingExpansion)
+        ,buildSAHCost_(0.0f)
+        ,numNodes_(0)
         ,nodes_(NULL)
         ,numVertices_(0)
         ,vertices_(NULL)
@@ -425,6 +1186,9 @@ namespace
 
         faces_ = (Face*)LMALLOC(sizeof(Face)*numFaces_);
         in.read(sizeof(Face)*numFaces_, faces_);
+
+        boundingExpansion_ = QBVHConstructor::BoundingExpansion;
+        buildSAHCost_ = calcSAHCost();
         return true;
     }
 
@@ -474,6 +1238,9 @@ namespace
 
         faces_ = (Face*)LMALLOC(sizeof(Face)*numFaces_);
         lcore::memcpy(faces_, constructor.faces_, sizeof(Face)*numFaces_);
+
+        boundingExpansion_ = constructor.boundingExpansion_;
+        buildSAHCost_ = calcSAHCost();
     }
 
     bool QBVH::test(HitRecord& hitRecord, const lmath::Ray& localRay)
@@ -536,9 +1303,354 @@ namespace
         return innerTest(hitRecord, bmin, bmax);
     }
 
-    //bool QBVH::test(HitRecord& hitRecord, const lmath::Sphere& sphere)
-    //{
-    //}
+    u32 QBVH::getRoot() const
+    {
+        //ノードがなければ全ての面が1つの葉
+        LASSERT(0<numNodes_ || numFaces_<=MaxLeafFaces);
+        return (0<numNodes_)? 0 : Node::getLeaf(0, numFaces_);
+    }
+
+    s32 QBVH::testSphere(s32 maxFaces, const Face** faces, const lmath::Sphere& sphere) const
+    {
+        if(numFaces_<=0){
+            return 0;
+        }
+        const lmath::Vector3& center = sphere.position();
+        f32 radiusSqr = sphere.radius()*sphere.radius();
+
+        lmath::lm128 point[3];
+        point[0] = _mm_set1_ps(center.x_);
+        point[1] = _mm_set1_ps(center.y_);
+        point[2] = _mm_set1_ps(center.z_);
+        lmath::lm128 radiusSqrSSE = _mm_set1_ps(radiusSqr);
+
+        s32 count = 0;
+        s32 stack = 0;
+        u32 nodeStack[TestStackSize];
+        nodeStack[stack] = getRoot();
+        while(stack>=0){
+            u32 index = nodeStack[stack];
+            --stack;
+            if(Node::isLeaf(index)){
+                if(Node::isEmpty(index)){
+                    continue;
+                }
+
+                u32 faceIndex = Node::getFaceIndex(index);
+                u32 numFaces = Node::getFaceNum(index);
+                lmath::Vector3 closest;
+                for(u32 i=faceIndex; i<faceIndex+numFaces; ++i){
+                    const Face& face = faces_[i];
+                    const lmath::Vector3& p0 = vertices_[face.v0_].position_;
+                    const lmath::Vector3& p1 = vertices_[face.v1_].position_;
+                    const lmath::Vector3& p2 = vertices_[face.v2_].position_;
+                    if(lmath::closestPointPointTriangle(closest, center, p0, p1, p2)<=radiusSqr){
+                        if(count<maxFaces){
+                            faces[count] = &face;
+                        }
+                        ++count;
+                    }
+                }
+
+            }else{
+                const Node& node = nodes_[index];
+                s32 hit = _mm_movemask_ps(_mm_cmple_ps(distanceSqrAABB(point, node.bbox_), radiusSqrSSE));
+                for(s32 i=0; i<4; ++i){
+                    if(((hit>>i)&0x01) && !Node::isEmpty(node.children_[i])){
+                        LASSERT((stack+1)<static_cast<s32>(TestStackSize));
+                        ++stack;
+                        nodeStack[stack] = node.children_[i];
+                    }
+                }
+            }
+        }
+        return count;
+    }
+
+    bool QBVH::testSweptSphere(SweepRecord& record, const lmath::Sphere& sphere, const lmath::Vector3& direction, f32 distance) const
+    {
+        record.face_ = NULL;
+        if(numFaces_<=0){
+            return false;
+        }
+        const lmath::Ray ray(sphere.position(), direction, distance);
+        f32 tmax = distance;
+
+        lmath::lm128 origin[3];
+        lmath::lm128 invDir[3];
+        s32 sign[3];
+        for(s32 i=0; i<3; ++i){
+            origin[i] = _mm_set1_ps(ray.origin_[i]);
+            invDir[i] = _mm_set1_ps(ray.invDirection_[i]);
+            sign[i] = (0.0f<=ray.direction_[i])? 0 : 1;
+        }
+        lmath::lm128 radius = _mm_set1_ps(sphere.radius());
+
+        s32 top = 0;
+        QueryEntry stack[TestStackSize];
+        stack[top].index_ = getRoot();
+        stack[top].key_ = 0.0f;
+        while(0<=top){
+            QueryEntry entry = stack[top];
+            --top;
+            if(tmax<entry.key_){
+                //見つけた接触より遠い
+                continue;
+            }
+            if(Node::isLeaf(entry.index_)){
+                if(Node::isEmpty(entry.index_)){
+                    continue;
+                }
+
+                u32 faceIndex = Node::getFaceIndex(entry.index_);
+                u32 numFaces = Node::getFaceNum(entry.index_);
+                f32 t;
+                lmath::Vector3 contact;
+                for(u32 i=faceIndex; i<faceIndex+numFaces; ++i){
+                    const Face& face = faces_[i];
+                    const lmath::Vector3& p0 = vertices_[face.v0_].position_;
+                    const lmath::Vector3& p1 = vertices_[face.v1_].position_;
+                    const lmath::Vector3& p2 = vertices_[face.v2_].position_;
+                    if(lmath::testSweptSphereTriangle(t, contact, sphere, direction, tmax, p0, p1, p2)){
+                        tmax = t;
+                        record.face_ = &face;
+                        record.t_ = t;
+                        record.point_ = contact;
+                    }
+                }
+
+            }else{
+                const Node& node = nodes_[entry.index_];
+                lmath::lm128 tnear;
+                s32 hit = testSweptSphereAABB(tnear, origin, invDir, sign, radius, _mm_set1_ps(tmax), node.bbox_);
+                LALIGN16 f32 keys[4];
+                _mm_store_ps(keys, tnear);
+
+                QueryEntry children[4];
+                s32 numChildren = 0;
+                for(s32 i=0; i<4; ++i){
+                    if(((hit>>i)&0x01) && !Node::isEmpty(node.children_[i])){
+                        children[numChildren].index_ = node.children_[i];
+                        children[numChildren].key_ = keys[i];
+                        ++numChildren;
+                    }
+                }
+                top = pushOrdered(stack, top, children, numChildren);
+            }
+        }
+        if(NULL == record.face_){
+            return false;
+        }
+
+        lmath::Vector3 normal = sphere.position() + record.t_*direction - record.point_;
+        f32 lengthSqr = lmath::dot(normal, normal);
+        if(lengthSqr<=LMATH_F32_EPSILON){
+            //中心が三角形上にある. 移動方向に向かい合う面の法線
+            const Face& face = *record.face_;
+            const lmath::Vector3& p0 = vertices_[face.v0_].position_;
+            normal = lmath::cross(vertices_[face.v1_].position_-p0, vertices_[face.v2_].position_-p0);
+            if(0.0f<lmath::dot(normal, direction)){
+                normal = -normal;
+            }
+            lengthSqr = lmath::dot(normal, normal);
+            if(lengthSqr<=LMATH_F32_EPSILON){
+                normal = -direction;
+                lengthSqr = 1.0f;
+            }
+        }
+        normal *= 1.0f/lmath::sqrt(lengthSqr);
+        record.normal_ = normal;
+        return true;
+    }
+
+    bool QBVH::findNearest(NearestRecord& record, const lmath::Vector3& point, f32 maxDistance) const
+    {
+        record.face_ = NULL;
+        if(numFaces_<=0){
+            return false;
+        }
+        f32 best = maxDistance*maxDistance;
+
+        lmath::lm128 pointSSE[3];
+        pointSSE[0] = _mm_set1_ps(point.x_);
+        pointSSE[1] = _mm_set1_ps(point.y_);
+        pointSSE[2] = _mm_set1_ps(point.z_);
+
+        s32 top = 0;
+        QueryEntry stack[TestStackSize];
+        stack[top].index_ = getRoot();
+        stack[top].key_ = 0.0f;
+        while(0<=top){
+            QueryEntry entry = stack[top];
+            --top;
+            if(best<entry.key_){
+                continue;
+            }
+            if(Node::isLeaf(entry.index_)){
+                if(Node::isEmpty(entry.index_)){
+                    continue;
+                }
+
+                u32 faceIndex = Node::getFaceIndex(entry.index_);
+                u32 numFaces = Node::getFaceNum(entry.index_);
+                lmath::Vector3 closest;
+                for(u32 i=faceIndex; i<faceIndex+numFaces; ++i){
+                    const Face& face = faces_[i];
+                    const lmath::Vector3& p0 = vertices_[face.v0_].position_;
+                    const lmath::Vector3& p1 = vertices_[face.v1_].position_;
+                    const lmath::Vector3& p2 = vertices_[face.v2_].position_;
+                    f32 d = lmath::closestPointPointTriangle(closest, point, p0, p1, p2);
+                    if(d<best || (d<=best && NULL == record.face_)){
+                        best = d;
+                        record.face_ = &face;
+                        record.point_ = closest;
+                    }
+                }
+
+            }else{
+                const Node& node = nodes_[entry.index_];
+                lmath::lm128 distance = distanceSqrAABB(pointSSE, node.bbox_);
+                s32 hit = _mm_movemask_ps(_mm_cmple_ps(distance, _mm_set1_ps(best)));
+                LALIGN16 f32 keys[4];
+                _mm_store_ps(keys, distance);
+
+                QueryEntry children[4];
+                s32 numChildren = 0;
+                for(s32 i=0; i<4; ++i){
+                    if(((hit>>i)&0x01) && !Node::isEmpty(node.children_[i])){
+                        children[numChildren].index_ = node.children_[i];
+                        children[numChildren].key_ = keys[i];
+                        ++numChildren;
+                    }
+                }
+                top = pushOrdered(stack, top, children, numChildren);
+            }
+        }
+        if(NULL == record.face_){
+            return false;
+        }
+        record.distance_ = lmath::sqrt(best);
+        return true;
+    }
+
+    //----------------------------------------------------
+    /// まとめた問い合わせ. QueryChunkSizeずつ分ける
+    struct QBVH::QueryJob
+    {
+        const QBVH* qbvh_;
+        s32 count_;
+
+        s32 maxFaces_;
+        s32* counts_;
+        const Face** faces_;
+
+        const lmath::Sphere* spheres_;
+        const lmath::Vector3* directions_;
+        const f32* distances_;
+        SweepRecord* sweepRecords_;
+
+        const lmath::Vector3* points_;
+        f32 maxDistance_;
+        NearestRecord* nearestRecords_;
+    };
+
+    void QBVH::sphereProc(void* data, u32 chunk)
+    {
+        QueryJob& job = *reinterpret_cast<QueryJob*>(data);
+        s32 begin = static_cast<s32>(chunk*QueryChunkSize);
+        s32 end = lcore::minimum(begin+static_cast<s32>(QueryChunkSize), job.count_);
+        for(s32 i=begin; i<end; ++i){
+            job.counts_[i] = job.qbvh_->testSphere(job.maxFaces_, job.faces_ + i*job.maxFaces_, job.spheres_[i]);
+        }
+    }
+
+    void QBVH::sweptSphereProc(void* data, u32 chunk)
+    {
+        QueryJob& job = *reinterpret_cast<QueryJob*>(data);
+        s32 begin = static_cast<s32>(chunk*QueryChunkSize);
+        s32 end = lcore::minimum(begin+static_cast<s32>(QueryChunkSize), job.count_);
+        for(s32 i=begin; i<end; ++i){
+            job.qbvh_->testSweptSphere(job.sweepRecords_[i], job.spheres_[i], job.directions_[i], job.distances_[i]);
+        }
+    }
+
+    void QBVH::nearestProc(void* data, u32 chunk)
+    {
+        QueryJob& job = *reinterpret_cast<QueryJob*>(data);
+        s32 begin = static_cast<s32>(chunk*QueryChunkSize);
+        s32 end = lcore::minimum(begin+static_cast<s32>(QueryChunkSize), job.count_);
+        for(s32 i=begin; i<end; ++i){
+            job.qbvh_->findNearest(job.nearestRecords_[i], job.points_[i], job.maxDistance_);
+        }
+    }
+
+    void QBVH::processQueries(lcore::ThreadPool* threadPool, void (*proc)(void*, u32), QueryJob& job)
+    {
+        u32 numChunks = (static_cast<u32>(job.count_) + QueryChunkSize - 1)/QueryChunkSize;
+        lcore::parallelFor(threadPool, proc, &job, numChunks);
+    }
+
+    s32 QBVH::testSphere(s32 numSpheres, s32* counts, s32 maxFaces, const Face** faces, const lmath::Sphere* spheres, lcore::ThreadPool* threadPool) const
+    {
+        if(numSpheres<=0){
+            return 0;
+        }
+        QueryJob job = {};
+        job.qbvh_ = this;
+        job.count_ = numSpheres;
+        job.maxFaces_ = maxFaces;
+        job.counts_ = counts;
+        job.faces_ = faces;
+        job.spheres_ = spheres;
+        processQueries(threadPool, sphereProc, job);
+
+        s32 total = 0;
+        for(s32 i=0; i<numSpheres; ++i){
+            total += counts[i];
+        }
+        return total;
+    }
+
+    s32 QBVH::testSweptSphere(s32 numSpheres, SweepRecord* records, const lmath::Sphere* spheres, const lmath::Vector3* directions, const f32* distances, lcore::ThreadPool* threadPool) const
+    {
+        if(numSpheres<=0){
+            return 0;
+        }
+        QueryJob job = {};
+        job.qbvh_ = this;
+        job.count_ = numSpheres;
+        job.spheres_ = spheres;
+        job.directions_ = directions;
+        job.distances_ = distances;
+        job.sweepRecords_ = records;
+        processQueries(threadPool, sweptSphereProc, job);
+
+        s32 count = 0;
+        for(s32 i=0; i<numSpheres; ++i){
+            count += (NULL != records[i].face_)? 1 : 0;
+        }
+        return count;
+    }
+
+    s32 QBVH::findNearest(s32 numPoints, NearestRecord* records, const lmath::Vector3* points, f32 maxDistance, lcore::ThreadPool* threadPool) const
+    {
+        if(numPoints<=0){
+            return 0;
+        }
+        QueryJob job = {};
+        job.qbvh_ = this;
+        job.count_ = numPoints;
+        job.points_ = points;
+        job.maxDistance_ = maxDistance;
+        job.nearestRecords_ = records;
+        processQueries(threadPool, nearestProc, job);
+
+        s32 count = 0;
+        for(s32 i=0; i<numPoints; ++i){
+            count += (NULL != records[i].face_)? 1 : 0;
+        }
+        return count;
+    }
 
     bool QBVH::innerTest(HitRecord& hitRecord, const lmath::Ray& ray, f32 tmin, f32 tmax)
     {
@@ -661,4 +1773,949 @@ namespace
         return ret;
     }
 
+    //----------------------------------------------------
+    /// 並列の再適合. 1段のノードをチャンクに分ける
+    struct QBVH::RefitJob
+    {
+        QBVH* qbvh_;
+        const u32* order_;
+        u32 begin_;
+        u32 end_;
+    };
+
+    void QBVH::refitProc(void* data, u32 chunk)
+    {
+        RefitJob& job = *reinterpret_cast<RefitJob*>(data);
+        u32 begin = job.begin_ + chunk*RefitChunkNodes;
+        u32 end = lcore::minimum(begin+RefitChunkNodes, job.end_);
+        for(u32 i=begin; i<end; ++i){
+            job.qbvh_->refitNode(job.order_[i]);
+        }
+    }
+
+    void QBVH::refit(const Vertex* vertices)
+    {
+        copyVertices(vertices);
+
+        //子は親より後ろにあるので, 後ろから処理すれば子の箱は計算済み
+        for(u32 i=numNodes_; 0<i; --i){
+            refitNode(i-1);
+        }
+        refitRoot();
+    }
+
+    void QBVH::refit(lcore::ThreadPool& threadPool, const Vertex* vertices)
+    {
+        if(numNodes_<=RefitChunkNodes){
+            refit(vertices);
+            return;
+        }
+        copyVertices(vertices);
+
+        //幅優先に並べると段ごとに連続する
+        u32* order = (u32*)LMALLOC(sizeof(u32)*numNodes_);
+        lcore::Array<u32> levels;
+        order[0] = 0;
+        u32 end = 1;
+        for(u32 begin=0; begin<end;){
+            levels.push_back(begin);
+            u32 levelEnd = end;
+            for(u32 i=begin; i<levelEnd; ++i){
+                const Node& node = nodes_[order[i]];
+                for(s32 j=0; j<4; ++j){
+                    if(!Node::isLeaf(node.children_[j])){
+                        order[end++] = node.children_[j];
+                    }
+                }
+            }
+            begin = levelEnd;
+        }
+        LASSERT(end == numNodes_);
+        levels.push_back(end);
+
+        RefitJob job;
+        job.qbvh_ = this;
+        job.order_ = order;
+        for(s32 i=levels.size()-2; 0<=i; --i){
+            job.begin_ = levels[i];
+            job.end_ = levels[i+1];
+            u32 numChunks = (job.end_ - job.begin_ + RefitChunkNodes - 1)/RefitChunkNodes;
+            if(numChunks<=1){
+                refitProc(&job, 0);
+            }else{
+                lcore::parallelFor(&threadPool, refitProc, &job, numChunks);
+            }
+        }
+        LFREE(order);
+        refitRoot();
+    }
+
+    void QBVH::copyVertices(const Vertex* vertices)
+    {
+        if(NULL != vertices && vertices != vertices_){
+            lcore::memcpy(vertices_, vertices, sizeof(Vertex)*numVertices_);
+        }
+    }
+
+    void QBVH::refitNode(u32 index)
+    {
+        Node& node = nodes_[index];
+        LALIGN16 f32 bbox[2][3][4];
+        for(s32 i=0; i<4; ++i){
+            u32 child = node.children_[i];
+            lmath::Vector3 bmin, bmax;
+            clearBBox(bmin, bmax);
+            if(Node::isEmpty(child)){
+                //空きは最小>最大のまま
+            }else if(Node::isLeaf(child)){
+                u32 faceIndex = Node::getFaceIndex(child);
+                u32 numFaces = Node::getFaceNum(child);
+                for(u32 j=faceIndex; j<faceIndex+numFaces; ++j){
+                    const Face& face = faces_[j];
+                    const lmath::Vector3& p0 = vertices_[face.v0_].position_;
+                    const lmath::Vector3& p1 = vertices_[face.v1_].position_;
+                    const lmath::Vector3& p2 = vertices_[face.v2_].position_;
+                    bmin = lmath::minimum(bmin, lmath::minimum(p0, lmath::minimum(p1, p2)));
+                    bmax = lmath::maximum(bmax, lmath::maximum(p0, lmath::maximum(p1, p2)));
+                }
+                for(s32 j=0; j<3; ++j){
+                    bmin[j] -= boundingExpansion_;
+                    bmax[j] += boundingExpansion_;
+                }
+            }else{
+                //子の箱は広げてあるので和をとるだけ
+                LASSERT(index<child);
+                const Node& childNode = nodes_[child];
+                for(s32 j=0; j<3; ++j){
+                    lm128 cmin = childNode.bbox_[0][j];
+                    lm128 cmax = childNode.bbox_[1][j];
+                    cmin = _mm_min_ps(cmin, _mm_shuffle_ps(cmin, cmin, _MM_SHUFFLE(2, 3, 0, 1)));
+                    cmin = _mm_min_ps(cmin, _mm_shuffle_ps(cmin, cmin, _MM_SHUFFLE(1, 0, 3, 2)));
+                    cmax = _mm_max_ps(cmax, _mm_shuffle_ps(cmax, cmax, _MM_SHUFFLE(2, 3, 0, 1)));
+                    cmax = _mm_max_ps(cmax, _mm_shuffle_ps(cmax, cmax, _MM_SHUFFLE(1, 0, 3, 2)));
+                    bmin[j] = _mm_cvtss_f32(cmin);
+                    bmax[j] = _mm_cvtss_f32(cmax);
+                }
+            }
+
+            for(s32 j=0; j<3; ++j){
+                bbox[0][j][i] = bmin[j];
+                bbox[1][j][i] = bmax[j];
+            }
+        }
+
+        for(u32 i=0; i<2; ++i){
+            for(u32 j=0; j<3; ++j){
+                node.bbox_[i][j] = _mm_load_ps(bbox[i][j]);
+            }
+        }
+    }
+
+    void QBVH::refitRoot()
+    {
+        if(numNodes_<=0){
+            clearBBox(bmin_, bmax_);
+            for(u32 i=0; i<numFaces_; ++i){
+                const Face& face = faces_[i];
+                bmin_ = lmath::minimum(bmin_, lmath::minimum(vertices_[face.v0_].position_, lmath::minimum(vertices_[face.v1_].position_, vertices_[face.v2_].position_)));
+                bmax_ = lmath::maximum(bmax_, lmath::maximum(vertices_[face.v0_].position_, lmath::maximum(vertices_[face.v1_].position_, vertices_[face.v2_].position_)));
+            }
+            return;
+        }
+
+        LALIGN16 f32 bbox[2][4];
+        for(s32 i=0; i<3; ++i){
+            _mm_store_ps(bbox[0], nodes_[0].bbox_[0][i]);
+            _mm_store_ps(bbox[1], nodes_[0].bbox_[1][i]);
+            bmin_[i] = lcore::minimum(lcore::minimum(bbox[0][0], bbox[0][1]), lcore::minimum(bbox[0][2], bbox[0][3]));
+            bmax_[i] = lcore::maximum(lcore::maximum(bbox[1][0], bbox[1][1]), lcore::maximum(bbox[1][2], bbox[1][3]));
+        }
+    }
+
+    f32 QBVH::calcSAHCost(f32 traversalCost, f32 intersectionCost) const
+    {
+        if(numNodes_<=0){
+            return intersectionCost*numFaces_;
+        }
+
+        const Node& root = nodes_[0];
+        LALIGN16 f32 bbox[2][3][4];
+        for(s32 i=0; i<3; ++i){
+            _mm_store_ps(bbox[0][i], root.bbox_[0][i]);
+            _mm_store_ps(bbox[1][i], root.bbox_[1][i]);
+        }
+        lmath::Vector3 bmin, bmax;
+        clearBBox(bmin, bmax);
+        for(s32 i=0; i<4; ++i){
+            if(Node::isEmpty(root.children_[i])){
+                continue;
+            }
+            for(s32 j=0; j<3; ++j){
+                bmin[j] = lcore::minimum(bmin[j], bbox[0][j][i]);
+                bmax[j] = lcore::maximum(bmax[j], bbox[1][j][i]);
+            }
+        }
+        f32 area = halfArea(bmin, bmax);
+        if(area<=LMATH_F32_EPSILON){
+            return traversalCost + intersectionCost*numFaces_;
+        }
+        return calcSAHCost(0, area, 1.0f/area, traversalCost, intersectionCost);
+    }
+
+    f32 QBVH::calcSAHCost(u32 index, f32 area, f32 invRootArea, f32 traversalCost, f32 intersectionCost) const
+    {
+        const Node& node = nodes_[index];
+        LALIGN16 f32 bbox[2][3][4];
+        for(s32 i=0; i<3; ++i){
+            _mm_store_ps(bbox[0][i], node.bbox_[0][i]);
+            _mm_store_ps(bbox[1][i], node.bbox_[1][i]);
+        }
+
+        f32 cost = traversalCost*area*invRootArea;
+        for(s32 i=0; i<4; ++i){
+            u32 child = node.children_[i];
+            if(Node::isEmpty(child)){
+                continue;
+            }
+            lmath::Vector3 bmin, bmax;
+            for(s32 j=0; j<3; ++j){
+                bmin[j] = bbox[0][j][i];
+                bmax[j] = bbox[1][j][i];
+            }
+            f32 childArea = halfArea(bmin, bmax);
+            if(Node::isLeaf(child)){
+                cost += intersectionCost*Node::getFaceNum(child)*childArea*invRootArea;
+            }else{
+                cost += calcSAHCost(child, childArea, invRootArea, traversalCost, intersectionCost);
+            }
+        }
+        return cost;
+    }
+
+    bool QBVH::isRebuildRequired(f32 ratio) const
+    {
+        return buildSAHCost_*ratio < calcSAHCost();
+    }
+
+    void QBVH::sortByOctant(s32 numRays, const lmath::Ray* rays, u32* work, s32 offsets[9])
+    {
+        //8分円ごとの個数を数えて, 安定に並べる
+        for(s32 i=0; i<9; ++i){
+            offsets[i] = 0;
+        }
+        for(s32 i=0; i<numRays; ++i){
+            const lmath::Vector3& direction = rays[i].direction_;
+            s32 octant = ((direction.x_<0.0f)? 1 : 0) | ((direction.y_<0.0f)? 2 : 0) | ((direction.z_<0.0f)? 4 : 0);
+            ++offsets[octant+1];
+        }
+        for(s32 i=1; i<9; ++i){
+            offsets[i] += offsets[i-1];
+        }
+        s32 heads[8];
+        for(s32 i=0; i<8; ++i){
+            heads[i] = offsets[i];
+        }
+        for(s32 i=0; i<numRays; ++i){
+            const lmath::Vector3& direction = rays[i].direction_;
+            s32 octant = ((direction.x_<0.0f)? 1 : 0) | ((direction.y_<0.0f)? 2 : 0) | ((direction.z_<0.0f)? 4 : 0);
+            work[heads[octant]++] = i;
+        }
+    }
+
+    template<class T, bool AnyHit>
+    LMATH_QBVH_KERNEL s32 QBVH::testPacket(HitRecord* hitRecords, const lmath::Ray* rays, const u32* indices, s32 numRays)
+    {
+        typedef typename T::value_type value_type;
+        LASSERT(0<numRays && numRays<=T::Size);
+
+        s32 active = T::AllMask >> (T::Size-numRays);
+        if(!AnyHit){
+            for(s32 i=0; i<numRays; ++i){
+                hitRecords[indices[i]].face_ = NULL;
+            }
+        }
+        if(numFaces_<=0){
+            return 0;
+        }
+
+        //SoAに並べる. 空きは先頭の光線で埋める
+        f32 values[10][T::Size];
+        for(s32 i=0; i<T::Size; ++i){
+            const lmath::Ray& ray = rays[indices[(i<numRays)? i : 0]];
+            for(s32 j=0; j<3; ++j){
+                values[j][i] = ray.origin_[j];
+                values[3+j][i] = ray.direction_[j];
+                values[6+j][i] = ray.invDirection_[j];
+            }
+            values[9][i] = ray.t_;
+        }
+        value_type origin[3];
+        value_type direction[3];
+        value_type invDir[3];
+        for(s32 i=0; i<3; ++i){
+            origin[i] = T::loadu(values[i]);
+            direction[i] = T::loadu(values[3+i]);
+            invDir[i] = T::loadu(values[6+i]);
+        }
+        value_type zero = T::zero();
+        value_type tmax = T::loadu(values[9]);
+        f32 packetTmax = values[9][0];
+        for(s32 i=1; i<numRays; ++i){
+            packetTmax = lcore::maximum(packetTmax, values[9][i]);
+        }
+
+        //全ての光線の逆数の符号が軸ごとにそろっていれば, 錐台で子をまとめて棄却する
+        Frustum frustum;
+        bool coherent = true;
+        for(s32 i=0; i<3; ++i){
+            f32 omin = values[i][0];
+            f32 omax = values[i][0];
+            f32 imin = values[6+i][0];
+            f32 imax = values[6+i][0];
+            for(s32 j=1; j<numRays; ++j){
+                omin = lcore::minimum(omin, values[i][j]);
+                omax = lcore::maximum(omax, values[i][j]);
+                imin = lcore::minimum(imin, values[6+i][j]);
+                imax = lcore::maximum(imax, values[6+i][j]);
+            }
+            coherent = coherent && (0.0f<imin || imax<0.0f);
+            frustum.originMin_[i] = _mm_set1_ps(omin);
+            frustum.originMax_[i] = _mm_set1_ps(omax);
+            frustum.invDirMin_[i] = _mm_set1_ps(imin);
+            frustum.invDirMax_[i] = _mm_set1_ps(imax);
+        }
+
+        //子を辿る順は先頭の光線の向きで決める
+        s32 raySign[3];
+        raySign[0] = (0.0f<=values[3][0])? 0 : 1;
+        raySign[1] = (0.0f<=values[4][0])? 0 : 1;
+        raySign[2] = (0.0f<=values[5][0])? 0 : 1;
+
+        s32 hitMask = 0;
+        s32 stack = 0;
+        u32 nodeStack[TestStackSize];
+        s32 maskStack[TestStackSize];
+        nodeStack[stack] = (0<numNodes_)? 0 : Node::getLeaf(0, numFaces_);
+        maskStack[stack] = active;
+        while(0<=stack){
+            u32 index = nodeStack[stack];
+            s32 mask = maskStack[stack];
+            --stack;
+            if(AnyHit){
+                mask &= ~hitMask;
+                if(0 == mask){
+                    continue;
+                }
+            }
+
+            if(Node::isLeaf(index)){
+                if(Node::isEmpty(index)){
+                    continue;
+                }
+
+                u32 faceIndex = Node::getFaceIndex(index);
+                u32 numFaces = Node::getFaceNum(index);
+                for(u32 i=faceIndex; i<faceIndex+numFaces; ++i){
+                    const Face& face = faces_[i];
+                    const lmath::Vector3& p0 = vertices_[face.v0_].position_;
+                    const lmath::Vector3& p1 = vertices_[face.v1_].position_;
+                    const lmath::Vector3& p2 = vertices_[face.v2_].position_;
+                    value_type v0[3];
+                    value_type e1[3];
+                    value_type e2[3];
+                    for(s32 j=0; j<3; ++j){
+                        v0[j] = T::set1(p0[j]);
+                        e1[j] = T::set1(p1[j]-p0[j]);
+                        e2[j] = T::set1(p2[j]-p0[j]);
+                    }
+
+                    value_type t, v, w;
+                    s32 hit = testRayTriangleFront<T>(t, v, w, origin, direction, v0, e1, e2);
+                    hit &= mask & T::movemask(T::and_(T::cmple(zero, t), T::cmple(t, tmax)));
+                    if(0 == hit){
+                        continue;
+                    }
+                    hitMask |= hit;
+                    if(AnyHit){
+                        if(active == hitMask){
+                            return hitMask;
+                        }
+                        mask &= ~hit;
+                        if(0 == mask){
+                            break;
+                        }
+                        continue;
+                    }
+
+                    f32 ts[T::Size];
+                    T::storeu(ts, t);
+                    for(s32 j=0; j<numRays; ++j){
+                        if((hit>>j)&0x01){
+                            hitRecords[indices[j]].face_ = &face;
+                            hitRecords[indices[j]].t_ = ts[j];
+                        }
+                    }
+                    tmax = T::select(tmax, t, hit);
+                    T::storeu(ts, tmax);
+                    packetTmax = ts[0];
+                    for(s32 j=1; j<numRays; ++j){
+                        packetTmax = lcore::maximum(packetTmax, ts[j]);
+                    }
+                }
+
+            }else{
+                const Node& node = nodes_[index];
+                s32 candidates = (coherent)? testFrustum(frustum, node.bbox_, packetTmax) : 0x0F;
+                if(0 == candidates){
+                    continue;
+                }
+
+                //残った子ごとに光線ごとの判定
+                s32 hit = 0;
+                s32 childMasks[4];
+                for(s32 i=0; i<4; ++i){
+                    if(0 == ((candidates>>i)&0x01)){
+                        continue;
+                    }
+                    value_type tnear = zero;
+                    value_type tfar = tmax;
+                    for(s32 j=0; j<3; ++j){
+                        value_type bmin = T::set1(reinterpret_cast<const f32*>(&node.bbox_[0][j])[i]);
+                        value_type bmax = T::set1(reinterpret_cast<const f32*>(&node.bbox_[1][j])[i]);
+                        value_type t0 = T::mul(T::sub(bmin, origin[j]), invDir[j]);
+                        value_type t1 = T::mul(T::sub(bmax, origin[j]), invDir[j]);
+                        tnear = T::maximum(tnear, T::minimum(t0, t1));
+                        tfar = T::minimum(tfar, T::maximum(t0, t1));
+                    }
+                    childMasks[i] = mask & T::movemask(T::cmple(tnear, tfar));
+                    if(0 != childMasks[i]){
+                        hit |= 0x01<<i;
+                    }
+                }
+
+                if(hit){
+                    s32 nodeIndex = (raySign[node.axis0_] << 2) | (raySign[node.axis1_] << 1) |(raySign[node.axis2_] << 0);
+                    s32 order = OrderTable[hit*8 + nodeIndex];
+
+                    while(!(order&0x04)){
+                        LASSERT(stack+1 < static_cast<s32>(TestStackSize));
+                        ++stack;
+                        nodeStack[stack] = node.children_[order&0x03];
+                        maskStack[stack] = childMasks[order&0x03];
+                        order >>= 4;
+                    }
+                }
+            }
+        }
+        return hitMask;
+    }
+
+    //呼び出しより先に定義する. 属性を見る前に使うとGCCはAVXなしの呼び出し規約で生成する
+    template<bool AnyHit>
+    LCORE_TARGET("avx") s32 QBVH::testPacketAVX(HitRecord* hitRecords, const lmath::Ray* rays, const u32* indices, s32 numRays)
+    {
+        return testPacket<Lane8, AnyHit>(hitRecords, rays, indices, numRays);
+    }
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+    s32 QBVH::test4(HitRecord hitRecords[4], const lmath::Ray rays[4])
+    {
+        static const u32 indices[4] = {0, 1, 2, 3};
+        return testPacket<Lane4, false>(hitRecords, rays, indices, 4);
+    }
+
+    s32 QBVH::test8(HitRecord hitRecords[8], const lmath::Ray rays[8])
+    {
+        static const u32 indices[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+        if(useAVX()){
+            return testPacketAVX<false>(hitRecords, rays, indices, 8);
+        }
+        return testPacket<Lane4, false>(hitRecords, rays, indices, 4)
+            | (testPacket<Lane4, false>(hitRecords, rays, indices+4, 4)<<4);
+    }
+
+    bool QBVH::testOcclusion(const lmath::Ray& localRay)
+    {
+        static const u32 indices[1] = {0};
+        return 0 != testPacket<Lane4, true>(NULL, &localRay, indices, 1);
+    }
+
+    s32 QBVH::testOcclusion4(const lmath::Ray rays[4])
+    {
+        static const u32 indices[4] = {0, 1, 2, 3};
+        return testPacket<Lane4, true>(NULL, rays, indices, 4);
+    }
+
+    s32 QBVH::testOcclusion8(const lmath::Ray rays[8])
+    {
+        static const u32 indices[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+        if(useAVX()){
+            return testPacketAVX<true>(NULL, rays, indices, 8);
+        }
+        return testPacket<Lane4, true>(NULL, rays, indices, 4)
+            | (testPacket<Lane4, true>(NULL, rays, indices+4, 4)<<4);
+    }
+
+    s32 QBVH::testStream(s32 numRays, HitRecord* hitRecords, const lmath::Ray* rays, u32* work)
+    {
+        LASSERT(0<=numRays);
+        LASSERT(0 == numRays || (NULL != hitRecords && NULL != rays && NULL != work));
+
+        s32 offsets[9];
+        sortByOctant(numRays, rays, work, offsets);
+
+        bool avx = useAVX();
+        s32 packetSize = (avx)? Lane8::Size : Lane4::Size;
+        s32 numHits = 0;
+        for(s32 i=0; i<8; ++i){
+            //束は8分円をまたがない
+            for(s32 j=offsets[i]; j<offsets[i+1]; j+=packetSize){
+                s32 n = lcore::minimum(packetSize, offsets[i+1]-j);
+                s32 hit = (avx)
+                    ? testPacketAVX<false>(hitRecords, rays, work+j, n)
+                    : testPacket<Lane4, false>(hitRecords, rays, work+j, n);
+                numHits += lcore::populationCount(static_cast<u8>(hit));
+            }
+        }
+        return numHits;
+    }
+
+    s32 QBVH::testOcclusionStream(s32 numRays, bool* occluded, const lmath::Ray* rays, u32* work)
+    {
+        LASSERT(0<=numRays);
+        LASSERT(0 == numRays || (NULL != occluded && NULL != rays && NULL != work));
+
+        s32 offsets[9];
+        sortByOctant(numRays, rays, work, offsets);
+
+        bool avx = useAVX();
+        s32 packetSize = (avx)? Lane8::Size : Lane4::Size;
+        s32 numOccluded = 0;
+        for(s32 i=0; i<8; ++i){
+            for(s32 j=offsets[i]; j<offsets[i+1]; j+=packetSize){
+                s32 n = lcore::minimum(packetSize, offsets[i+1]-j);
+                s32 hit = (avx)
+                    ? testPacketAVX<true>(NULL, rays, work+j, n)
+                    : testPacket<Lane4, true>(NULL, rays, work+j, n);
+                for(s32 k=0; k<n; ++k){
+                    occluded[work[j+k]] = 0 != ((hit>>k)&0x01);
+                }
+                numOccluded += lcore::populationCount(static_cast<u8>(hit));
+            }
+        }
+        return numOccluded;
+    }
+
+    //----------------------------------------------------
+    //---
+    //--- QBVH32Constructor
+    //---
+    //----------------------------------------------------
+    QBVH32Constructor::QBVH32Constructor()
+        :boundingExpansion_(QBVHConstructor::BoundingExpansion)
+        ,numBins_(QBVHConstructor::DefaultBins)
+        ,root_(Node::EmptyMask)
+        ,numBlocks_(0)
+        ,blocks_(NULL)
+        ,faceBounds_(NULL)
+    {
+        bmin_ = lmath::Vector3::zero();
+        bmax_ = lmath::Vector3::zero();
+    }
+
+    QBVH32Constructor::~QBVH32Constructor()
+    {
+        clear();
+    }
+
+    void QBVH32Constructor::clear()
+    {
+        root_ = Node::EmptyMask;
+        nodes_.clear();
+        leaves_.clear();
+        numBlocks_ = 0;
+        LALIGNED_FREE(blocks_, 16);
+        LDELETE_ARRAY(faceBounds_);
+    }
+
+    void QBVH32Constructor::construct(u32 numVertices, const Vertex* vertices, u32 numFaces, const Face* faces)
+    {
+        LASSERT(NULL != vertices);
+        LASSERT(NULL != faces);
+        LASSERT(numFaces<=MaxFaces);
+
+        clear();
+        bmin_ = lmath::Vector3::zero();
+        bmax_ = lmath::Vector3::zero();
+        if(numFaces<=0){
+            return;
+        }
+
+        faceBounds_ = LNEW FaceBound[numFaces];
+        clearBBox(bmin_, bmax_);
+        for(u32 i=0; i<numFaces; ++i){
+            const Face& face = faces[i];
+            LASSERT(face.v0_<numVertices && face.v1_<numVertices && face.v2_<numVertices);
+            const lmath::Vector3& p0 = vertices[face.v0_].position_;
+            const lmath::Vector3& p1 = vertices[face.v1_].position_;
+            const lmath::Vector3& p2 = vertices[face.v2_].position_;
+
+            FaceBound& bound = faceBounds_[i];
+            bound.bmin_ = lmath::minimum(lmath::minimum(p0, p1), p2);
+            bound.bmax_ = lmath::maximum(lmath::maximum(p0, p1), p2);
+            bound.centroid_ = bound.bmin_;
+            bound.centroid_ += bound.bmax_;
+            bound.centroid_ *= 0.5f;
+            bound.face_ = i;
+
+            bmin_ = lmath::minimum(bmin_, bound.bmin_);
+            bmax_ = lmath::maximum(bmax_, bound.bmax_);
+        }
+
+        nodes_.reserve(numFaces/(MinLeafFaces*2) + 1);
+        root_ = recursiveConstruct(0, numFaces);
+        fillBlocks(vertices, faces);
+
+        leaves_.clear();
+        LDELETE_ARRAY(faceBounds_);
+    }
+
+    u32 QBVH32Constructor::recursiveConstruct(u32 begin, u32 numFaces)
+    {
+        if(0 == numFaces){
+            return Node::EmptyMask;
+        }
+
+        if(numFaces<=MinLeafFaces){
+            return pushLeaf(begin, numFaces);
+        }
+
+        u32 end = begin + numFaces;
+        s32 axis0;
+        f32 cost;
+        u32 mid0 = splitSAH(axis0, cost, begin, numFaces);
+        if(numFaces<=MaxLeafFaces){
+            //葉は4つずつ判定するので, ブロック数とノード1つ分の判定を比べる
+            lmath::Vector3 bmin, bmax;
+            getBBox(bmin, bmax, begin, numFaces);
+            f32 area = halfArea(bmin, bmax);
+            if(cost<0.0f || area*getBlockCount(numFaces) <= area + 0.25f*cost){
+                return pushLeaf(begin, numFaces);
+            }
+        }
+
+        s32 axis1 = axis0;
+        u32 mid1 = mid0;
+        if(MinLeafFaces < (mid0-begin)){
+            mid1 = splitSAH(axis1, cost, begin, mid0-begin);
+        }
+
+        s32 axis2 = axis0;
+        u32 mid2 = end;
+        if(MinLeafFaces < (end-mid0)){
+            mid2 = splitSAH(axis2, cost, mid0, end-mid0);
+        }
+
+        u32 ranges[4][2];
+        ranges[0][0] = begin;
+        ranges[0][1] = mid1;
+        ranges[1][0] = mid1;
+        ranges[1][1] = mid0;
+        ranges[2][0] = mid0;
+        ranges[2][1] = mid2;
+        ranges[3][0] = mid2;
+        ranges[3][1] = end;
+
+        u32 nindex = nodes_.size();
+        {
+            lmath::Vector3 minmax[4][2];
+            for(s32 i=0; i<4; ++i){
+                getBBox(minmax[i][0], minmax[i][1], ranges[i][0], ranges[i][1]-ranges[i][0]);
+            }
+            nodes_.push_back(Node());
+            setNode(nodes_[nindex], axis0, axis1, axis2, minmax);
+        }
+
+        for(s32 i=0; i<4; ++i){
+            u32 child = recursiveConstruct(ranges[i][0], ranges[i][1]-ranges[i][0]);
+            nodes_[nindex].children_[i] = child;
+        }
+        return nindex;
+    }
+
+    u32 QBVH32Constructor::pushLeaf(u32 begin, u32 numFaces)
+    {
+        u32 numBlocks = getBlockCount(numFaces);
+        LASSERT(numBlocks <= (0x01U<<LeafBlockBits));
+
+        //葉は面の順に並ぶので, ブロックも同じ順に割り当てる
+        Leaf leaf = {begin, numFaces};
+        leaves_.push_back(leaf);
+        u32 blockIndex = numBlocks_;
+        numBlocks_ += numBlocks;
+        LASSERT(numBlocks_<=MaxBlocks);
+        return Node::getLeaf(blockIndex, numBlocks);
+    }
+
+    u32 QBVH32Constructor::splitSAH(s32& axis, f32& cost, u32 begin, u32 numFaces)
+    {
+        LASSERT(1<numFaces);
+        u32 end = begin + numFaces;
+
+        lmath::Vector3 cmin;
+        lmath::Vector3 cmax;
+        getCentroidBounds(cmin, cmax, faceBounds_, begin, end);
+
+        Bins bins;
+        f32 scale[3];
+        for(s32 i=0; i<3; ++i){
+            f32 extent = cmax[i] - cmin[i];
+            scale[i] = (LMATH_F32_EPSILON<extent)? static_cast<f32>(numBins_)/extent : 0.0f;
+        }
+        clearBins(bins, numBins_);
+        binning(bins, faceBounds_, begin, end, cmin, scale, numBins_);
+
+        s32 bestAxis;
+        s32 bestPlane;
+        cost = findSplit(bestAxis, bestPlane, bins, scale, numBins_, numFaces);
+
+        if(bestAxis<0){
+            //重心が全て同じ位置. 個数で半分にする
+            cost = -1.0f;
+            lmath::Vector3 bmin, bmax;
+            getBBox(bmin, bmax, begin, numFaces);
+            axis = calcAxis(bmin, bmax);
+            return begin + (numFaces>>1);
+        }
+
+        u32 left = begin;
+        u32 right = end;
+        while(left<right){
+            if(getBin(faceBounds_[left].centroid_[bestAxis], cmin[bestAxis], scale[bestAxis], numBins_)<=bestPlane){
+                ++left;
+            }else{
+                --right;
+                lcore::swap(faceBounds_[left], faceBounds_[right]);
+            }
+        }
+        axis = bestAxis;
+        return left;
+    }
+
+    void QBVH32Constructor::getBBox(lmath::Vector3& bmin, lmath::Vector3& bmax, u32 begin, u32 numFaces) const
+    {
+        clearBBox(bmin, bmax);
+        for(u32 i=begin; i<begin+numFaces; ++i){
+            bmin = lmath::minimum(bmin, faceBounds_[i].bmin_);
+            bmax = lmath::maximum(bmax, faceBounds_[i].bmax_);
+        }
+    }
+
+    void QBVH32Constructor::setNode(Node& node, s32 axis0, s32 axis1, s32 axis2, const lmath::Vector3 minmax[4][2])
+    {
+        node.axis0_ = axis0;
+        node.axis1_ = axis1;
+        node.axis2_ = axis2;
+        node.reserved_ = 0;
+        for(s32 i=0; i<3; ++i){
+            for(s32 j=0; j<4; ++j){
+                node.bbox_[0][i][j] = minmax[j][0][i] - boundingExpansion_;
+                node.bbox_[1][i][j] = minmax[j][1][i] + boundingExpansion_;
+            }
+        }
+    }
+
+    void QBVH32Constructor::fillBlocks(const Vertex* vertices, const Face* faces)
+    {
+        blocks_ = reinterpret_cast<Triangle4*>(LALIGNED_MALLOC(sizeof(Triangle4)*numBlocks_, 16));
+
+        u32 block = 0;
+        for(s32 i=0; i<leaves_.size(); ++i){
+            const Leaf& leaf = leaves_[i];
+            u32 numBlocks = getBlockCount(leaf.numFaces_);
+            for(u32 j=0; j<(numBlocks<<2); ++j){
+                Triangle4& triangle = blocks_[block + (j>>2)];
+                u32 lane = j&0x03U;
+                f32* v0 = reinterpret_cast<f32*>(triangle.v0_);
+                f32* e1 = reinterpret_cast<f32*>(triangle.edge1_);
+                f32* e2 = reinterpret_cast<f32*>(triangle.edge2_);
+                if(leaf.numFaces_<=j){
+                    for(s32 k=0; k<3; ++k){
+                        v0[k*4+lane] = 0.0f;
+                        e1[k*4+lane] = 0.0f;
+                        e2[k*4+lane] = 0.0f;
+                    }
+                    triangle.face_[lane] = InvalidFace;
+                    continue;
+                }
+
+                u32 index = faceBounds_[leaf.begin_+j].face_;
+                const Face& face = faces[index];
+                const lmath::Vector3& p0 = vertices[face.v0_].position_;
+                const lmath::Vector3& p1 = vertices[face.v1_].position_;
+                const lmath::Vector3& p2 = vertices[face.v2_].position_;
+                for(s32 k=0; k<3; ++k){
+                    v0[k*4+lane] = p0[k];
+                    e1[k*4+lane] = p1[k] - p0[k];
+                    e2[k*4+lane] = p2[k] - p0[k];
+                }
+                triangle.face_[lane] = index;
+            }
+            block += numBlocks;
+        }
+    }
+
+    //----------------------------------------------------
+    //---
+    //--- QBVH32
+    //---
+    //----------------------------------------------------
+    QBVH32::QBVH32()
+        :root_(Node::EmptyMask)
+        ,numNodes_(0)
+        ,nodes_(NULL)
+        ,numBlocks_(0)
+        ,blocks_(NULL)
+    {
+        bmin_ = lmath::Vector3::zero();
+        bmax_ = lmath::Vector3::zero();
+    }
+
+    QBVH32::~QBVH32()
+    {
+        clear();
+    }
+
+    void QBVH32::clear()
+    {
+        root_ = Node::EmptyMask;
+        numNodes_ = 0;
+        numBlocks_ = 0;
+        LALIGNED_FREE(blocks_, 16);
+        LALIGNED_FREE(nodes_, 16);
+    }
+
+    void QBVH32::copyFrom(const QBVH32Constructor& constructor)
+    {
+        clear();
+        root_ = constructor.root_;
+        numNodes_ = constructor.nodes_.size();
+        numBlocks_ = constructor.numBlocks_;
+        bmin_ = constructor.bmin_;
+        bmax_ = constructor.bmax_;
+
+        if(0<numNodes_){
+            nodes_ = reinterpret_cast<Node*>(LALIGNED_MALLOC(sizeof(Node)*numNodes_, 16));
+            for(u32 i=0; i<numNodes_; ++i){
+                const QBVH32Constructor::Node& src = constructor.nodes_[i];
+                lcore::memcpy(nodes_[i].bbox_, src.bbox_, sizeof(f32)*2*3*4);
+                lcore::memcpy(nodes_[i].children_, src.children_, sizeof(u32)*4);
+                nodes_[i].axis0_ = src.axis0_;
+                nodes_[i].axis1_ = src.axis1_;
+                nodes_[i].axis2_ = src.axis2_;
+                nodes_[i].reserved_ = src.reserved_;
+            }
+        }
+
+        if(0<numBlocks_){
+            blocks_ = reinterpret_cast<Triangle4*>(LALIGNED_MALLOC(sizeof(Triangle4)*numBlocks_, 16));
+            lcore::memcpy(blocks_, constructor.blocks_, sizeof(Triangle4)*numBlocks_);
+        }
+    }
+
+    bool QBVH32::test(HitRecord& hitRecord, const lmath::Ray& localRay) const
+    {
+        hitRecord.face_ = InvalidFace;
+        if(Node::isEmpty(root_)){
+            return false;
+        }
+
+        f32 tmin;
+        f32 tmax;
+        if(!lmath::testRayAABB(tmin, tmax, localRay, bmin_, bmax_)){
+            return false;
+        }
+        tmax = localRay.t_;
+
+        s32 raySign[3];
+        raySign[0] = (0.0f<=localRay.direction_[0])? 0 : 1;
+        raySign[1] = (0.0f<=localRay.direction_[1])? 0 : 1;
+        raySign[2] = (0.0f<=localRay.direction_[2])? 0 : 1;
+
+        lmath::lm128 origin[3];
+        lmath::lm128 direction[3];
+        lmath::lm128 invDir[3];
+        for(s32 i=0; i<3; ++i){
+            origin[i] = _mm_set1_ps(localRay.origin_[i]);
+            direction[i] = _mm_set1_ps(localRay.direction_[i]);
+            invDir[i] = _mm_set1_ps(localRay.invDirection_[i]);
+        }
+        lmath::lm128 zero = _mm_setzero_ps();
+        lmath::lm128 tmaxSSE = _mm_set1_ps(tmax);
+
+        bool ret = false;
+        s32 stack = 0;
+        u32 nodeStack[TestStackSize];
+        nodeStack[stack] = root_;
+        while(0<=stack){
+            u32 index = nodeStack[stack];
+            --stack;
+            if(Node::isLeaf(index)){
+                if(Node::isEmpty(index)){
+                    continue;
+                }
+
+                u32 block = Node::getBlockIndex(index);
+                u32 end = block + Node::getBlockNum(index);
+                for(; block<end; ++block){
+                    lmath::lm128 t, v, w;
+                    s32 hit = testRayTriangleFront<Lane4>(t, v, w, origin, direction, blocks_[block].v0_, blocks_[block].edge1_, blocks_[block].edge2_);
+                    hit &= _mm_movemask_ps(_mm_and_ps(_mm_cmple_ps(zero, t), _mm_cmple_ps(t, tmaxSSE)));
+                    if(0 == hit){
+                        continue;
+                    }
+
+                    LALIGN16 f32 ts[4];
+                    LALIGN16 f32 vs[4];
+                    LALIGN16 f32 ws[4];
+                    _mm_store_ps(ts, t);
+                    _mm_store_ps(vs, v);
+                    _mm_store_ps(ws, w);
+                    for(s32 i=0; i<4; ++i){
+                        if(0 == ((hit>>i)&0x01) || tmax<ts[i]){
+                            continue;
+                        }
+                        tmax = ts[i];
+                        hitRecord.face_ = blocks_[block].face_[i];
+                        hitRecord.t_ = ts[i];
+                        hitRecord.v_ = vs[i];
+                        hitRecord.w_ = ws[i];
+                    }
+                    tmaxSSE = _mm_set1_ps(tmax);
+                    ret = true;
+                }
+
+            }else{
+                const Node& node = nodes_[index];
+                s32 hit = testRayAABB(zero, tmaxSSE, origin, invDir, raySign, node.bbox_);
+
+                if(hit){
+                    s32 nodeIndex = (raySign[node.axis0_] << 2) | (raySign[node.axis1_] << 1) |(raySign[node.axis2_] << 0);
+                    s32 order = OrderTable[hit*8 + nodeIndex];
+
+                    while(!(order&0x04)){
+                        LASSERT(stack+1 < static_cast<s32>(TestStackSize));
+                        ++stack;
+                        nodeStack[stack] = node.children_[order&0x03];
+                        order >>= 4;
+                    }
+                }
+            }
+        }
+
+        return ret;
+    }
 }
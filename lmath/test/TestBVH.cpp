@@ -0,0 +1,152 @@
+﻿#include <catch_wrap.hpp>
+#include "lmath.h"
+#include "geometry/BVH.h"
+#include "geometry/Ray.h"
+#include "geometry/RayTest.h"
+#include <lcore/Random.h>
+
+namespace lmath
+{
+    namespace
+    {
+        static const u32 NumClusters = 8;
+        static const u32 NumClusterBoxes = 200;
+        static const u32 NumBoxes = NumClusters*NumClusterBoxes;
+        static const u32 NumRays = 2000;
+
+        f32 frand(lcore::RandXorshift128Plus32& random, f32 low, f32 high)
+        {
+            return low + (high-low)*random.frand();
+        }
+
+        struct Box;
+
+        struct BoxHitRecord
+        {
+            f32 t_;
+            const Box* shape_;
+        };
+
+        struct Box
+        {
+            const Vector3& getBBoxMin() const{ return bmin_;}
+            const Vector3& getBBoxMax() const{ return bmax_;}
+            const Vector3& getMedian() const{ return median_;}
+
+            bool hit(BoxHitRecord& hitRecord, const Ray& ray) const
+            {
+                f32 tmin, tmax;
+                if(!lmath::testRayAABB(tmin, tmax, ray, bmin_, bmax_)){
+                    return false;
+                }
+                hitRecord.t_ = tmin;
+                hitRecord.shape_ = this;
+                return true;
+            }
+
+            void set(const Vector3& center, const Vector3& extent)
+            {
+                bmin_ = center - extent;
+                bmax_ = center + extent;
+                median_ = center;
+            }
+
+            void translate(const Vector3& offset)
+            {
+                bmin_ += offset;
+                bmax_ += offset;
+                median_ += offset;
+            }
+
+            Vector3 bmin_;
+            Vector3 bmax_;
+            Vector3 median_;
+        };
+
+        typedef bvh::BVH<Box, BoxHitRecord> BoxBVH;
+
+        /// 原点の周りに散らばった, 小さな箱の塊
+        void createBoxes(Box* boxes, u32 seed)
+        {
+            lcore::RandXorshift128Plus32 random(seed);
+            for(u32 i=0; i<NumClusters; ++i){
+                Vector3 center = Vector3::construct(frand(random, -50.0f, 50.0f), frand(random, 0.0f, 20.0f), frand(random, -50.0f, 50.0f));
+                for(u32 j=0; j<NumClusterBoxes; ++j){
+                    Vector3 position = center + Vector3::construct(frand(random, -3.0f, 3.0f), frand(random, -3.0f, 3.0f), frand(random, -3.0f, 3.0f));
+                    Vector3 extent = Vector3::construct(frand(random, 0.05f, 0.2f), frand(random, 0.05f, 0.2f), frand(random, 0.05f, 0.2f));
+                    boxes[i*NumClusterBoxes + j].set(position, extent);
+                }
+            }
+        }
+
+        bool bruteForce(f32& t, const Box* boxes, const Ray& ray)
+        {
+            bool hit = false;
+            t = ray.t_;
+            for(u32 i=0; i<NumBoxes; ++i){
+                BoxHitRecord hitRecord;
+                if(boxes[i].hit(hitRecord, ray) && hitRecord.t_<t){
+                    t = hitRecord.t_;
+                    hit = true;
+                }
+            }
+            return hit;
+        }
+
+        bool testRays(BoxBVH& bvh, const Box* boxes, u32 seed)
+        {
+            lcore::RandXorshift128Plus32 random(seed);
+            bool same = true;
+            for(u32 i=0; i<NumRays; ++i){
+                Vector3 origin = Vector3::construct(frand(random, -80.0f, 80.0f), frand(random, -10.0f, 40.0f), frand(random, -80.0f, 80.0f));
+                Vector3 target = Vector3::construct(frand(random, -60.0f, 60.0f), frand(random, -1.0f, 20.0f), frand(random, -60.0f, 60.0f));
+                Vector3 direction = target - origin;
+                direction *= 1.0f/lmath::sqrt(dot(direction, direction));
+                Ray ray(origin, direction, 1000.0f);
+
+                f32 t;
+                bool hit = bruteForce(t, boxes, ray);
+                BoxHitRecord hitRecord;
+                same = same && hit == bvh.hit(hitRecord, ray) && (!hit || lmath::isEqual(t, hitRecord.t_, 1.0e-4f));
+            }
+            return same;
+        }
+    }
+
+    TEST_CASE("TestBVH::Refit")
+    {
+        Box* boxes = LNEW Box[NumBoxes];
+        createBoxes(boxes, 5151);
+
+        //構築は要素を並べ替えて, そのまま参照する
+        BoxBVH bvh;
+        bvh.build(boxes, NumBoxes);
+        EXPECT_TRUE(lmath::isEqual(bvh.calcSAHCost(), bvh.getBuildSAHCost(), 1.0e-3f));
+        EXPECT_FALSE(bvh.isRebuildRequired());
+        EXPECT_TRUE(testRays(bvh, boxes, 4321));
+
+        //塊ごとに平行移動するだけなら, 木の質は変わらない
+        lcore::RandXorshift128Plus32 random(2525);
+        for(u32 i=0; i<NumBoxes; ++i){
+            boxes[i].translate(Vector3::construct(frand(random, -0.05f, 0.05f), 3.0f, frand(random, -0.05f, 0.05f)));
+        }
+        bvh.refit();
+        EXPECT_FALSE(bvh.isRebuildRequired());
+        EXPECT_TRUE(testRays(bvh, boxes, 1234));
+
+        //箱をばらばらにすると節点の箱が大きく重なり, 作り直しが必要になる
+        for(u32 i=0; i<NumBoxes; ++i){
+            boxes[i].translate(Vector3::construct(frand(random, -50.0f, 50.0f), 0.0f, frand(random, -50.0f, 50.0f)));
+        }
+        bvh.refit();
+        EXPECT_TRUE(bvh.isRebuildRequired());
+        EXPECT_TRUE(testRays(bvh, boxes, 8765));
+
+        //作り直せば元の質に戻る
+        bvh.build(boxes, NumBoxes);
+        EXPECT_FALSE(bvh.isRebuildRequired());
+        EXPECT_TRUE(testRays(bvh, boxes, 8765));
+
+        LDELETE_ARRAY(boxes);
+    }
+}
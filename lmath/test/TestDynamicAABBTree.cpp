@@ -0,0 +1,308 @@
+﻿#include <catch_wrap.hpp>
+#include "lmath.h"
+#include "geometry/DynamicAABBTree.h"
+#include "geometry/Ray.h"
+#include "geometry/RayTest.h"
+#include <lcore/Random.h>
+#include <lcore/Sort.h>
+
+namespace lmath
+{
+    namespace
+    {
+        static const s32 NumObjects = 2000;
+        static const s32 NumSteps = 30;
+        static const s32 NumQueries = 200;
+
+        f32 frand(lcore::RandXorshift128Plus32& random, f32 low, f32 high)
+        {
+            return low + (high-low)*random.frand();
+        }
+
+        AABB createBox(lcore::RandXorshift128Plus32& random, const Vector3& center)
+        {
+            Vector3 extent = Vector3::construct(frand(random, 0.1f, 2.0f), frand(random, 0.1f, 2.0f), frand(random, 0.1f, 2.0f));
+            return AABB(center-extent, center+extent);
+        }
+
+        bool lessPair(const DynamicAABBTree::Pair& lhs, const DynamicAABBTree::Pair& rhs)
+        {
+            return (lhs.proxy0_ == rhs.proxy0_)? lhs.proxy1_<rhs.proxy1_ : lhs.proxy0_<rhs.proxy0_;
+        }
+
+        bool lessProxy(const s32& lhs, const s32& rhs)
+        {
+            return lhs<rhs;
+        }
+
+        struct RaycastData
+        {
+            const DynamicAABBTree* tree_;
+            s32 count_;
+            s32* proxies_;
+        };
+
+        /// 当たった代理を全て集める
+        f32 raycastAll(void* data, s32 proxy, const Ray& ray)
+        {
+            RaycastData* raycastData = reinterpret_cast<RaycastData*>(data);
+            raycastData->proxies_[raycastData->count_++] = proxy;
+            return ray.t_;
+        }
+
+        /// 太い箱の入口を光線の長さにして, 一番近いものを探す
+        f32 raycastClosest(void* data, s32 proxy, const Ray& ray)
+        {
+            RaycastData* raycastData = reinterpret_cast<RaycastData*>(data);
+            const AABB& bbox = raycastData->tree_->getFatAABB(proxy);
+            f32 tmin, tmax;
+            if(!testRayAABB(tmin, tmax, ray, bbox.bmin_, bbox.bmax_)){
+                return ray.t_;
+            }
+            raycastData->proxies_[0] = proxy;
+            raycastData->count_ = 1;
+            return lcore::maximum(tmin, 1.0e-6f);
+        }
+    }
+
+    TEST_CASE("TestDynamicAABBTree::Balance")
+    {
+        static const s32 NumProxies = 4000;
+        lcore::RandXorshift128Plus32 random(4000);
+        DynamicAABBTree tree;
+        s32* proxies = LNEW s32[NumProxies];
+
+        //大きさのばらばらな箱を足すと, 内部節点の隣に葉が入って偏りやすい
+        bool balanced = true;
+        for(s32 i=0; i<NumProxies; ++i){
+            Vector3 center = Vector3::construct(frand(random, -100.0f, 100.0f), frand(random, -20.0f, 20.0f), frand(random, -100.0f, 100.0f));
+            AABB bbox = createBox(random, center);
+            bbox.expand(((i&0x0F) == 0)? frand(random, 0.0f, 40.0f) : 0.0f);
+            proxies[i] = tree.createProxy(bbox, NULL);
+            balanced = balanced && tree.getMaxBalance()<=1;
+        }
+        EXPECT_TRUE(balanced);
+        EXPECT_TRUE(tree.validate());
+
+        //半分を消しても偏らない
+        for(s32 i=0; i<NumProxies; i+=2){
+            tree.destroyProxy(proxies[i]);
+            balanced = balanced && tree.getMaxBalance()<=1;
+        }
+        EXPECT_TRUE(balanced);
+        EXPECT_TRUE(tree.validate());
+        EXPECT_TRUE(NumProxies/2 == tree.getNumProxies());
+        //高さの差1ならおよそ1.44log2(n)
+        EXPECT_TRUE(tree.getHeight() <= 16);
+
+        LDELETE_ARRAY(proxies);
+    }
+
+    TEST_CASE("TestDynamicAABBTree::DynamicAABBTree")
+    {
+        lcore::RandXorshift128Plus32 random(1234);
+        DynamicAABBTree tree;
+        s32 proxies[NumObjects];
+        Vector3 centers[NumObjects];
+        AABB boxes[NumObjects];
+        bool alive[NumObjects];
+
+        for(s32 i=0; i<NumObjects; ++i){
+            centers[i] = Vector3::construct(frand(random, -100.0f, 100.0f), frand(random, -20.0f, 20.0f), frand(random, -100.0f, 100.0f));
+            boxes[i] = createBox(random, centers[i]);
+            proxies[i] = tree.createProxy(boxes[i], &alive[i]);
+            alive[i] = true;
+        }
+        EXPECT_TRUE(NumObjects == tree.getNumProxies());
+        EXPECT_TRUE(tree.validate());
+        EXPECT_TRUE(tree.getMaxBalance() <= 1);
+        //高さの差1ならおよそ1.44log2(n)
+        EXPECT_TRUE(tree.getHeight() <= 16);
+
+        //作った代理は全て動いた扱い. 組は太い箱を総当りしたものと同じ
+        lcore::Array<DynamicAABBTree::Pair> pairs;
+        lcore::Array<DynamicAABBTree::Pair> expected;
+        tree.queryPairs(pairs);
+        for(s32 i=0; i<NumObjects; ++i){
+            for(s32 j=i+1; j<NumObjects; ++j){
+                if(tree.getFatAABB(proxies[i]).overlaps(tree.getFatAABB(proxies[j]))){
+                    DynamicAABBTree::Pair pair = {lcore::minimum(proxies[i], proxies[j]), lcore::maximum(proxies[i], proxies[j])};
+                    expected.push_back(pair);
+                }
+            }
+        }
+        EXPECT_TRUE(expected.size() == pairs.size());
+        lcore::introsort(pairs.size(), pairs.begin(), lessPair);
+        lcore::introsort(expected.size(), expected.begin(), lessPair);
+        EXPECT_TRUE(0 == lcore::memcmp(expected.begin(), pairs.begin(), sizeof(DynamicAABBTree::Pair)*pairs.size()));
+        EXPECT_TRUE(0 == tree.getNumMoved());
+
+        s32 found[NumObjects];
+        s32 bruteForce[NumObjects];
+        for(s32 step=0; step<NumSteps; ++step){
+            //一部だけ動かす, 消す, 足し直す
+            Vector3 direction = Vector3::construct(frand(random, -1.0f, 1.0f), 0.0f, frand(random, -1.0f, 1.0f));
+            s32 numMoved = 0;
+            for(s32 i=0; i<NumObjects; ++i){
+                u32 r = random.rand()%100;
+                if(!alive[i]){
+                    if(r<30){
+                        proxies[i] = tree.createProxy(boxes[i], &alive[i]);
+                        alive[i] = true;
+                    }
+                    continue;
+                }
+                if(r<2){
+                    tree.destroyProxy(proxies[i]);
+                    alive[i] = false;
+                }else if(r<12){
+                    Vector3 displacement = direction*frand(random, 0.0f, 0.5f);
+                    centers[i] += displacement;
+                    boxes[i] = AABB(boxes[i].bmin_+displacement, boxes[i].bmax_+displacement);
+                    numMoved += tree.moveProxy(proxies[i], boxes[i], displacement)? 1 : 0;
+                    EXPECT_TRUE(tree.getFatAABB(proxies[i]).contains(boxes[i]));
+                }
+            }
+            EXPECT_TRUE(numMoved <= tree.getNumMoved());
+            EXPECT_TRUE(tree.validate());
+            EXPECT_TRUE(tree.getMaxBalance() <= 1);
+
+            //組は少なくとも片方が動いたものだけ
+            pairs.clear();
+            s32 numPairs = tree.queryPairs(pairs);
+            EXPECT_TRUE(pairs.size() == numPairs);
+            expected.clear();
+            for(s32 i=0; i<NumObjects; ++i){
+                for(s32 j=i+1; j<NumObjects; ++j){
+                    if(!alive[i] || !alive[j]){
+                        continue;
+                    }
+                    if(tree.getFatAABB(proxies[i]).overlaps(tree.getFatAABB(proxies[j]))){
+                        DynamicAABBTree::Pair pair = {lcore::minimum(proxies[i], proxies[j]), lcore::maximum(proxies[i], proxies[j])};
+                        expected.push_back(pair);
+                    }
+                }
+            }
+            lcore::introsort(pairs.size(), pairs.begin(), lessPair);
+            bool same = true;
+            for(s32 i=1; i<pairs.size(); ++i){
+                same = same && lessPair(pairs[i-1], pairs[i]);
+            }
+            //実際に重なる組で, 重なる箱と同じ組は全て見つかる
+            for(s32 i=0; i<pairs.size() && same; ++i){
+                same = tree.getFatAABB(pairs[i].proxy0_).overlaps(tree.getFatAABB(pairs[i].proxy1_));
+            }
+            for(s32 i=0; i<pairs.size(); ++i){
+                same = same && pairs[i].proxy0_<pairs[i].proxy1_;
+            }
+            EXPECT_TRUE(same);
+            EXPECT_TRUE(pairs.size() <= expected.size());
+        }
+
+        //重なりの問い合わせは総当りと同じ
+        bool same = true;
+        for(s32 q=0; q<NumQueries; ++q){
+            Vector3 center = Vector3::construct(frand(random, -100.0f, 100.0f), frand(random, -20.0f, 20.0f), frand(random, -100.0f, 100.0f));
+            AABB bbox = createBox(random, center);
+            bbox.expand(frand(random, 0.0f, 10.0f));
+            s32 numExpected = 0;
+            for(s32 i=0; i<NumObjects; ++i){
+                if(alive[i] && tree.getFatAABB(proxies[i]).overlaps(bbox)){
+                    bruteForce[numExpected++] = proxies[i];
+                }
+            }
+            s32 count = tree.queryOverlap(NumObjects, found, bbox);
+            lcore::introsort(count, found, lessProxy);
+            lcore::introsort(numExpected, bruteForce, lessProxy);
+            same = same && count == numExpected && 0 == lcore::memcmp(found, bruteForce, sizeof(s32)*count);
+            same = same && count == tree.queryOverlap(0, NULL, bbox);
+        }
+        EXPECT_TRUE(same);
+
+        //光線は当たる箱を全て, または一番近い箱を返す
+        same = true;
+        s32 totalHits = 0;
+        for(s32 q=0; q<NumQueries; ++q){
+            Vector3 origin = Vector3::construct(frand(random, -100.0f, 100.0f), frand(random, -20.0f, 20.0f), frand(random, -100.0f, 100.0f));
+            Vector3 target = Vector3::construct(frand(random, -100.0f, 100.0f), frand(random, -20.0f, 20.0f), frand(random, -100.0f, 100.0f));
+            Vector3 direction = target - origin;
+            f32 length = lmath::sqrt(dot(direction, direction));
+            direction *= 1.0f/length;
+            Ray ray(origin, direction, length);
+
+            s32 numExpected = 0;
+            f32 closest = ray.t_;
+            s32 closestProxy = DynamicAABBTree::Invalid;
+            for(s32 i=0; i<NumObjects; ++i){
+                if(!alive[i]){
+                    continue;
+                }
+                const AABB& bbox = tree.getFatAABB(proxies[i]);
+                f32 tmin, tmax;
+                if(testRayAABB(tmin, tmax, ray, bbox.bmin_, bbox.bmax_)){
+                    bruteForce[numExpected++] = proxies[i];
+                    if(tmin<closest){
+                        closest = tmin;
+                        closestProxy = proxies[i];
+                    }
+                }
+            }
+
+            RaycastData data = {&tree, 0, found};
+            s32 count = tree.raycast(ray, raycastAll, &data);
+            lcore::introsort(data.count_, found, lessProxy);
+            lcore::introsort(numExpected, bruteForce, lessProxy);
+            same = same && count == numExpected && 0 == lcore::memcmp(found, bruteForce, sizeof(s32)*count);
+            totalHits += count;
+
+            data.count_ = 0;
+            count = tree.raycast(ray, raycastClosest, &data);
+            same = same && count<=numExpected;
+            if(DynamicAABBTree::Invalid != closestProxy && 0.0f<closest){
+                f32 tmin, tmax;
+                const AABB& bbox = tree.getFatAABB(found[0]);
+                testRayAABB(tmin, tmax, ray, bbox.bmin_, bbox.bmax_);
+                same = same && 1 == data.count_ && lcore::absolute(closest-tmin)<=1.0e-4f;
+            }
+        }
+        EXPECT_TRUE(same);
+        EXPECT_TRUE(0 < totalHits);
+
+        //全て消すと空
+        for(s32 i=0; i<NumObjects; ++i){
+            if(alive[i]){
+                tree.destroyProxy(proxies[i]);
+            }
+        }
+        EXPECT_TRUE(0 == tree.getNumProxies());
+        EXPECT_TRUE(0 == tree.getHeight());
+        EXPECT_TRUE(tree.validate());
+        EXPECT_TRUE(0 == tree.queryOverlap(NumObjects, found, AABB(Vector3::construct(-1000.0f, -1000.0f, -1000.0f), Vector3::construct(1000.0f, 1000.0f, 1000.0f))));
+
+        //止まっている代理同士は組にならず, 太い箱に収まる移動は木を変えない
+        tree.clear();
+        s32 a = tree.createProxy(AABB(Vector3::construct(0.0f, 0.0f, 0.0f), Vector3::construct(1.0f, 1.0f, 1.0f)), NULL);
+        s32 b = tree.createProxy(AABB(Vector3::construct(0.5f, 0.5f, 0.5f), Vector3::construct(2.0f, 2.0f, 2.0f)), NULL);
+        s32 c = tree.createProxy(AABB(Vector3::construct(5.0f, 5.0f, 5.0f), Vector3::construct(6.0f, 6.0f, 6.0f)), NULL);
+        pairs.clear();
+        EXPECT_TRUE(1 == tree.queryPairs(pairs));
+        EXPECT_TRUE(lcore::minimum(a, b) == pairs[0].proxy0_);
+        EXPECT_TRUE(lcore::maximum(a, b) == pairs[0].proxy1_);
+        pairs.clear();
+        EXPECT_TRUE(0 == tree.queryPairs(pairs));
+
+        EXPECT_FALSE(tree.moveProxy(c, AABB(Vector3::construct(5.05f, 5.0f, 5.0f), Vector3::construct(6.05f, 6.0f, 6.0f)), Vector3::construct(0.05f, 0.0f, 0.0f)));
+        EXPECT_TRUE(0 == tree.getNumMoved());
+        EXPECT_TRUE(tree.moveProxy(c, AABB(Vector3::construct(1.5f, 1.5f, 1.5f), Vector3::construct(2.5f, 2.5f, 2.5f)), Vector3::construct(-3.5f, -3.5f, -3.5f)));
+        EXPECT_TRUE(tree.wasMoved(c));
+        EXPECT_TRUE(2 == tree.queryPairs(pairs));
+        EXPECT_TRUE(tree.validate());
+
+        //消した代理は移動バッファからも消える
+        tree.touchProxy(a);
+        tree.destroyProxy(a);
+        pairs.clear();
+        EXPECT_TRUE(0 == tree.queryPairs(pairs));
+        EXPECT_TRUE(tree.validate());
+    }
+}
@@ -0,0 +1,183 @@
+﻿#include <catch_wrap.hpp>
+#include "lmath.h"
+#include "geometry/KDTree.h"
+#include <lcore/Random.h>
+#include <lcore/Sort.h>
+#include <lcore/Thread.h>
+
+namespace lmath
+{
+    namespace
+    {
+        static const u32 NumPoints = 20000;
+        static const s32 NumQueries = 300;
+        static const s32 K = 16;
+
+        f32 frand(lcore::RandXorshift128Plus32& random, f32 low, f32 high)
+        {
+            return low + (high-low)*random.frand();
+        }
+
+        /// 一様な点と密集した塊, 同じ位置の点
+        void createPoints(Vector3* points, u32 numPoints, u32 seed)
+        {
+            lcore::RandXorshift128Plus32 random(seed);
+            Vector3 center = Vector3::zero();
+            for(u32 i=0; i<numPoints; ++i){
+                if(0 == (i%1000)){
+                    center = Vector3::construct(frand(random, -50.0f, 50.0f), frand(random, -50.0f, 50.0f), frand(random, -50.0f, 50.0f));
+                }
+                if(i<numPoints/2){
+                    points[i] = Vector3::construct(frand(random, -100.0f, 100.0f), frand(random, -100.0f, 100.0f), frand(random, -100.0f, 100.0f));
+                }else if(i<numPoints-100){
+                    points[i] = center + Vector3::construct(frand(random, -1.0f, 1.0f), frand(random, -1.0f, 1.0f), frand(random, -1.0f, 1.0f));
+                }else{
+                    points[i] = Vector3::construct(1.0f, 2.0f, 3.0f);
+                }
+            }
+        }
+
+        bool lessDistance(const f32& lhs, const f32& rhs)
+        {
+            return lhs<rhs;
+        }
+
+        /// 総当りで近い順の距離の平方
+        s32 bruteForce(f32* distances, const Vector3* points, u32 numPoints, const Vector3& point, f32 radius)
+        {
+            s32 count = 0;
+            for(u32 i=0; i<numPoints; ++i){
+                f32 d = distanceSqr(points[i], point);
+                if(d<=radius*radius){
+                    distances[count++] = d;
+                }
+            }
+            lcore::introsort(count, distances, lessDistance);
+            return count;
+        }
+
+        bool isSame(f32 expected, f32 actual)
+        {
+            return lcore::absolute(expected-actual) <= 1.0e-4f*lcore::maximum(1.0f, expected);
+        }
+    }
+
+    TEST_CASE("TestKDTree::PointKDTree")
+    {
+        Vector3* points = LNEW Vector3[NumPoints];
+        createPoints(points, NumPoints, 1234);
+        f32* expected = LNEW f32[NumPoints];
+
+        lcore::RandXorshift128Plus32 random(5678);
+        Vector3 queries[NumQueries];
+        for(s32 i=0; i<NumQueries; ++i){
+            queries[i] = (0 == (i&0x01))
+                ? Vector3::construct(frand(random, -110.0f, 110.0f), frand(random, -110.0f, 110.0f), frand(random, -110.0f, 110.0f))
+                : points[random.rand()%NumPoints];
+        }
+
+        kdtree::PointKDTree::Neighbor neighbors[NumQueries*K];
+        for(s32 method=0; method<2; ++method){
+            kdtree::PointKDTree tree;
+            tree.build(NumPoints, points, static_cast<kdtree::PointKDTree::BuildMethod>(method));
+            EXPECT_TRUE(NumPoints == tree.getNumPoints());
+            EXPECT_TRUE(tree.getDepth() < kdtree::PointKDTree::MaxDepth);
+
+            //全ての点が1度ずつ葉にある
+            u32 numValid = 0;
+            u32 sum = 0;
+            for(u32 i=0; i<tree.getNumBlocks(); ++i){
+                for(s32 j=0; j<4; ++j){
+                    u32 index = tree.getBlock(i).index_[j];
+                    if(kdtree::PointKDTree::InvalidIndex != index){
+                        ++numValid;
+                        sum += index;
+                    }
+                }
+            }
+            EXPECT_TRUE(NumPoints == numValid);
+            EXPECT_TRUE(NumPoints*(NumPoints-1)/2 == sum);
+
+            //k近傍は総当りと同じ距離を近い順に返す
+            bool same = true;
+            for(s32 i=0; i<NumQueries; ++i){
+                s32 numExpected = bruteForce(expected, points, NumPoints, queries[i], 1000.0f);
+                s32 count = tree.findKNearest(K, neighbors, queries[i]);
+                same = same && lcore::minimum(numExpected, K) == count;
+                for(s32 j=0; j<count && same; ++j){
+                    same = isSame(expected[j], neighbors[j].distanceSqr_);
+                    same = same && isSame(neighbors[j].distanceSqr_, distanceSqr(points[neighbors[j].index_], queries[i]));
+                }
+            }
+            EXPECT_TRUE(same);
+
+            //範囲を絞ると範囲内だけ
+            same = true;
+            for(s32 i=0; i<NumQueries; ++i){
+                s32 numExpected = bruteForce(expected, points, NumPoints, queries[i], 2.0f);
+                s32 count = tree.findKNearest(K, neighbors, queries[i], 2.0f);
+                same = same && lcore::minimum(numExpected, K) == count;
+            }
+            EXPECT_TRUE(same);
+
+            //半径内は順不同で全て. 溢れた分は数だけ返す
+            same = true;
+            s32 total = 0;
+            for(s32 i=0; i<NumQueries; ++i){
+                s32 numExpected = bruteForce(expected, points, NumPoints, queries[i], 3.0f);
+                s32 count = tree.findRadius(K, neighbors, queries[i], 3.0f);
+                same = same && numExpected == count;
+                for(s32 j=0; j<lcore::minimum(count, K) && same; ++j){
+                    same = distanceSqr(points[neighbors[j].index_], queries[i]) <= 9.0f;
+                }
+                total += count;
+            }
+            EXPECT_TRUE(same);
+            EXPECT_TRUE(NumQueries*K < total);
+        }
+
+        //まとめた問い合わせは1つずつと同じ
+        kdtree::PointKDTree tree;
+        tree.build(NumPoints, points);
+        lcore::ThreadPool threadPool(4, 16);
+        threadPool.start();
+        kdtree::PointKDTree::Neighbor batch[NumQueries*K];
+        s32 counts[NumQueries];
+        for(s32 k=0; k<2; ++k){
+            lcore::ThreadPool* pool = (0==k)? NULL : &threadPool;
+            s32 total = tree.findKNearest(NumQueries, counts, K, batch, queries, 1000.0f, pool);
+            bool same = true;
+            s32 expectedTotal = 0;
+            for(s32 i=0; i<NumQueries; ++i){
+                s32 count = tree.findKNearest(K, neighbors, queries[i], 1000.0f);
+                same = same && count == counts[i] && 0 == lcore::memcmp(neighbors, batch + i*K, sizeof(kdtree::PointKDTree::Neighbor)*count);
+                expectedTotal += count;
+            }
+            EXPECT_TRUE(same);
+            EXPECT_TRUE(expectedTotal == total);
+
+            total = tree.findRadius(NumQueries, counts, K, batch, queries, 3.0f, pool);
+            same = true;
+            expectedTotal = 0;
+            for(s32 i=0; i<NumQueries; ++i){
+                s32 count = tree.findRadius(K, neighbors, queries[i], 3.0f);
+                same = same && count == counts[i] && 0 == lcore::memcmp(neighbors, batch + i*K, sizeof(kdtree::PointKDTree::Neighbor)*lcore::minimum(count, K));
+                expectedTotal += count;
+            }
+            EXPECT_TRUE(same);
+            EXPECT_TRUE(expectedTotal == total);
+        }
+
+        //空と1点
+        kdtree::PointKDTree empty;
+        empty.build(0, NULL);
+        EXPECT_TRUE(0 == empty.findKNearest(K, neighbors, queries[0]));
+        EXPECT_TRUE(0 == empty.findRadius(K, neighbors, queries[0], 10.0f));
+        empty.build(1, points);
+        EXPECT_TRUE(1 == empty.findKNearest(K, neighbors, queries[0]));
+        EXPECT_TRUE(0u == neighbors[0].index_);
+
+        LDELETE_ARRAY(expected);
+        LDELETE_ARRAY(points);
+    }
+}
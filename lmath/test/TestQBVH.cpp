@@ -0,0 +1,871 @@
+﻿#include <catch_wrap.hpp>
+#include "lmath.h"
+#include "geometry/QBVH.h"
+#include "geometry/OBVH.h"
+#include "geometry/CompressedQBVH.h"
+#include "geometry/Ray.h"
+#include "geometry/RayTest.h"
+#include "geometry/Sphere.h"
+#include "geometry/PrimitiveTest.h"
+#include <lcore/Random.h>
+#include <lcore/Thread.h>
+#include <lcore/File.h>
+#include <stdio.h>
+
+namespace lmath
+{
+    namespace
+    {
+        static const u32 NumClusters = 8;
+        static const u32 NumClusterFaces = 600;
+        static const u32 NumGroundFaces = 32*32*2;
+        static const u32 NumRays = 2000;
+
+        f32 frand(lcore::RandXorshift128Plus32& random, f32 low, f32 high)
+        {
+            return low + (high-low)*random.frand();
+        }
+
+        lmath::Vector3 getDirection(const lmath::Vector3& from, const lmath::Vector3& to)
+        {
+            lmath::Vector3 d = to;
+            d -= from;
+            d *= 1.0f/lmath::sqrt(d.x_*d.x_ + d.y_*d.y_ + d.z_*d.z_);
+            return d;
+        }
+
+        /// 広い地面と, 密集した小さい三角形の塊
+        struct Mesh
+        {
+            void create(u32 seed, u32 numClusterFaces=NumClusterFaces)
+            {
+                lcore::RandXorshift128Plus32 random(seed);
+                numFaces_ = NumGroundFaces + NumClusters*numClusterFaces;
+                numVertices_ = 33*33 + NumClusters*numClusterFaces*3;
+                vertices_ = LNEW QBVHConstructor::Vertex[numVertices_];
+                faces_ = LNEW QBVHConstructor::Face[numFaces_];
+
+                u32 vertex = 0;
+                u32 face = 0;
+                for(u32 z=0; z<33; ++z){
+                    for(u32 x=0; x<33; ++x){
+                        vertices_[vertex++].position_.set(x*4.0f-64.0f, frand(random, -0.5f, 0.5f), z*4.0f-64.0f);
+                    }
+                }
+                for(u32 z=0; z<32; ++z){
+                    for(u32 x=0; x<32; ++x){
+                        u16 v = static_cast<u16>(z*33+x);
+                        setFace(face++, v, static_cast<u16>(v+33), static_cast<u16>(v+1));
+                        setFace(face++, static_cast<u16>(v+1), static_cast<u16>(v+33), static_cast<u16>(v+34));
+                    }
+                }
+
+                for(u32 i=0; i<NumClusters; ++i){
+                    lmath::Vector3 center = lmath::Vector3::construct(frand(random, -50.0f, 50.0f), frand(random, 2.0f, 20.0f), frand(random, -50.0f, 50.0f));
+                    for(u32 j=0; j<numClusterFaces; ++j){
+                        lmath::Vector3 p = lmath::Vector3::construct(frand(random, -3.0f, 3.0f), frand(random, -3.0f, 3.0f), frand(random, -3.0f, 3.0f));
+                        p += center;
+                        u16 v = static_cast<u16>(vertex);
+                        for(u32 k=0; k<3; ++k){
+                            vertices_[vertex].position_ = p;
+                            vertices_[vertex].position_ += lmath::Vector3::construct(frand(random, -0.5f, 0.5f), frand(random, -0.5f, 0.5f), frand(random, -0.5f, 0.5f));
+                            ++vertex;
+                        }
+                        setFace(face++, v, static_cast<u16>(v+1), static_cast<u16>(v+2));
+                    }
+                }
+
+                bmin_ = bmax_ = vertices_[0].position_;
+                for(u32 i=1; i<numVertices_; ++i){
+                    bmin_ = lmath::minimum(bmin_, vertices_[i].position_);
+                    bmax_ = lmath::maximum(bmax_, vertices_[i].position_);
+                }
+            }
+
+            void setFace(u32 index, u16 v0, u16 v1, u16 v2)
+            {
+                faces_[index].v0_ = v0;
+                faces_[index].v1_ = v1;
+                faces_[index].v2_ = v2;
+                faces_[index].reserved_ = 0;
+                const lmath::Vector3& p0 = vertices_[v0].position_;
+                const lmath::Vector3& p1 = vertices_[v1].position_;
+                const lmath::Vector3& p2 = vertices_[v2].position_;
+                lmath::Vector3 e0 = p1; e0 -= p0;
+                lmath::Vector3 e1 = p2; e1 -= p0;
+                lmath::Vector3 n = lmath::Vector3::construct(e0.y_*e1.z_-e0.z_*e1.y_, e0.z_*e1.x_-e0.x_*e1.z_, e0.x_*e1.y_-e0.y_*e1.x_);
+                faces_[index].normal_ = getDirection(lmath::Vector3::zero(), n);
+            }
+
+            /// QBVHConstructorへ所有権を移す
+            void construct(QBVHConstructor& constructor)
+            {
+                constructor.construct(numVertices_, vertices_, numFaces_, faces_, bmin_, bmax_);
+                vertices_ = NULL;
+                faces_ = NULL;
+            }
+
+            void construct(QBVHConstructor& constructor, lcore::ThreadPool& threadPool)
+            {
+                constructor.construct(threadPool, numVertices_, vertices_, numFaces_, faces_, bmin_, bmax_);
+                vertices_ = NULL;
+                faces_ = NULL;
+            }
+
+            u32 numVertices_;
+            QBVHConstructor::Vertex* vertices_;
+            u32 numFaces_;
+            QBVHConstructor::Face* faces_;
+            lmath::Vector3 bmin_;
+            lmath::Vector3 bmax_;
+        };
+
+        bool bruteForce(f32& t, const Mesh& mesh, const lmath::Ray& ray)
+        {
+            bool hit = false;
+            t = ray.t_;
+            for(u32 i=0; i<mesh.numFaces_; ++i){
+                const QBVHConstructor::Face& face = mesh.faces_[i];
+                f32 ft, u, v;
+                if(lmath::testRayTriangleFront(ft, u, v, ray,
+                    mesh.vertices_[face.v0_].position_,
+                    mesh.vertices_[face.v1_].position_,
+                    mesh.vertices_[face.v2_].position_))
+                {
+                    if(0.0f<=ft && ft<=t){
+                        t = ft;
+                        hit = true;
+                    }
+                }
+            }
+            return hit;
+        }
+
+        /// 総当りと同じ結果になるか
+        bool checkRays(QBVHConstructor& constructor, const Mesh& reference)
+        {
+            QBVH qbvh;
+            qbvh.copyFrom(constructor);
+
+            lcore::RandXorshift128Plus32 random(4321);
+            for(u32 i=0; i<NumRays; ++i){
+                lmath::Vector3 origin = lmath::Vector3::construct(frand(random, -80.0f, 80.0f), frand(random, -10.0f, 40.0f), frand(random, -80.0f, 80.0f));
+                lmath::Vector3 target = lmath::Vector3::construct(frand(random, -60.0f, 60.0f), frand(random, -1.0f, 20.0f), frand(random, -60.0f, 60.0f));
+                lmath::Ray ray(origin, getDirection(origin, target), 1000.0f);
+
+                f32 t;
+                bool hit = bruteForce(t, reference, ray);
+                QBVH::HitRecord hitRecord;
+                if(hit != qbvh.test(hitRecord, ray)){
+                    return false;
+                }
+                if(hit && !lmath::isEqual(t, hitRecord.t_, 1.0e-4f)){
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /// ノードと面の並びが完全に一致するか
+        bool isSame(const QBVHConstructor& lhs, const QBVHConstructor& rhs)
+        {
+            if(lhs.getNumNodes() != rhs.getNumNodes() || lhs.getNumFaces() != rhs.getNumFaces()){
+                return false;
+            }
+            for(u32 i=0; i<lhs.getNumNodes(); ++i){
+                if(0 != lcore::memcmp(&lhs.getNode(i), &rhs.getNode(i), sizeof(QBVHConstructor::Node))){
+                    return false;
+                }
+            }
+            for(u32 i=0; i<lhs.getNumFaces(); ++i){
+                if(0 != lcore::memcmp(&lhs.getFace(i), &rhs.getFace(i), sizeof(QBVHConstructor::Face))){
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /// 総当りの最近傍. 見つからなければmaxDistanceを返す
+        f32 bruteForceNearest(const Mesh& mesh, const lmath::Vector3& point, f32 maxDistance)
+        {
+            f32 best = maxDistance*maxDistance;
+            lmath::Vector3 closest;
+            for(u32 i=0; i<mesh.numFaces_; ++i){
+                const QBVHConstructor::Face& face = mesh.faces_[i];
+                best = lcore::minimum(best, lmath::closestPointPointTriangle(closest, point,
+                    mesh.vertices_[face.v0_].position_,
+                    mesh.vertices_[face.v1_].position_,
+                    mesh.vertices_[face.v2_].position_));
+            }
+            return lmath::sqrt(best);
+        }
+    }
+
+    TEST_CASE("TestQBVH::BinnedSAH")
+    {
+        Mesh reference;
+        reference.create(1234);
+
+        Mesh mesh;
+        mesh.create(1234);
+        QBVHConstructor median;
+        mesh.construct(median);
+
+        mesh.create(1234);
+        QBVHConstructor sah;
+        sah.setSplitMethod(QBVHConstructor::SplitMethod_BinnedSAH);
+        sah.setNumBins(32);
+        mesh.construct(sah);
+
+        EXPECT_TRUE(checkRays(median, reference));
+        EXPECT_TRUE(checkRays(sah, reference));
+
+        f32 medianCost = median.calcSAHCost();
+        f32 sahCost = sah.calcSAHCost();
+        EXPECT_TRUE(sahCost < medianCost);
+        LOG_INFO("SAH cost median: " << medianCost << ", binned SAH: " << sahCost);
+
+        //ビン数を変えても結果は正しい
+        mesh.create(1234);
+        QBVHConstructor sah4;
+        sah4.setSplitMethod(QBVHConstructor::SplitMethod_BinnedSAH);
+        sah4.setNumBins(1);
+        mesh.construct(sah4);
+        EXPECT_TRUE(checkRays(sah4, reference));
+
+        LDELETE_ARRAY(reference.vertices_);
+        LDELETE_ARRAY(reference.faces_);
+    }
+
+    TEST_CASE("TestQBVH::Degenerate")
+    {
+        //全ての三角形が同じ位置
+        Mesh mesh;
+        mesh.create(99);
+        for(u32 i=0; i<mesh.numFaces_; ++i){
+            mesh.faces_[i] = mesh.faces_[0];
+        }
+        QBVHConstructor sah;
+        sah.setSplitMethod(QBVHConstructor::SplitMethod_BinnedSAH);
+        mesh.construct(sah);
+        EXPECT_TRUE(0.0f < sah.calcSAHCost());
+    }
+
+    TEST_CASE("TestQBVH::Parallel")
+    {
+        //並列に分けた後のビン分けも通るように大きめにする
+        static const u32 NumLargeClusterFaces = 2500;
+        Mesh reference;
+        reference.create(777, NumLargeClusterFaces);
+
+        lcore::ThreadPool threadPool(4, 16);
+        threadPool.start();
+
+        for(s32 method=QBVHConstructor::SplitMethod_Median; method<=QBVHConstructor::SplitMethod_BinnedSAH; ++method){
+            Mesh mesh;
+            mesh.create(777, NumLargeClusterFaces);
+            QBVHConstructor serial;
+            serial.setSplitMethod(static_cast<QBVHConstructor::SplitMethod>(method));
+            mesh.construct(serial);
+
+            mesh.create(777, NumLargeClusterFaces);
+            QBVHConstructor parallel;
+            parallel.setSplitMethod(static_cast<QBVHConstructor::SplitMethod>(method));
+            mesh.construct(parallel, threadPool);
+
+            EXPECT_TRUE(isSame(serial, parallel));
+            EXPECT_TRUE(checkRays(parallel, reference));
+
+            //小さいと逐次と同じ
+            mesh.create(777, 10);
+            QBVHConstructor small;
+            small.setSplitMethod(static_cast<QBVHConstructor::SplitMethod>(method));
+            mesh.construct(small, threadPool);
+            EXPECT_TRUE(0u < small.getNumNodes());
+        }
+
+        LDELETE_ARRAY(reference.vertices_);
+        LDELETE_ARRAY(reference.faces_);
+    }
+
+    TEST_CASE("TestQBVH::QBVH32")
+    {
+        //葉の符号は24bitを越える番号を表せる
+        u32 leaf = QBVH32Constructor::Node::getLeaf(20000000, 3);
+        EXPECT_TRUE(QBVH32::Node::isLeaf(leaf));
+        EXPECT_FALSE(QBVH32::Node::isEmpty(leaf));
+        EXPECT_TRUE(20000000u == QBVH32::Node::getBlockIndex(leaf));
+        EXPECT_TRUE(3u == QBVH32::Node::getBlockNum(leaf));
+        EXPECT_TRUE(0xFFFFFFu < QBVH32Constructor::MaxFaces);
+
+        //16bitに収まらない頂点数の地面
+        static const u32 Width = 300;
+        static const u32 NumVertices = Width*Width;
+        static const u32 NumFaces = (Width-1)*(Width-1)*2;
+        static const u32 NumWideRays = 200;
+        lcore::RandXorshift128Plus32 random(5678);
+        QBVH32Constructor::Vertex* vertices = LNEW QBVH32Constructor::Vertex[NumVertices];
+        QBVH32Constructor::Face* faces = LNEW QBVH32Constructor::Face[NumFaces];
+        for(u32 z=0; z<Width; ++z){
+            for(u32 x=0; x<Width; ++x){
+                vertices[z*Width+x].position_.set(x*0.5f-75.0f, frand(random, -2.0f, 2.0f), z*0.5f-75.0f);
+            }
+        }
+        u32 face = 0;
+        for(u32 z=0; z<Width-1; ++z){
+            for(u32 x=0; x<Width-1; ++x){
+                u32 v = z*Width+x;
+                QBVH32Constructor::Face f0 = {v, v+Width, v+1};
+                QBVH32Constructor::Face f1 = {v+1, v+Width, v+Width+1};
+                faces[face++] = f0;
+                faces[face++] = f1;
+            }
+        }
+
+        QBVH32Constructor constructor;
+        constructor.construct(NumVertices, vertices, NumFaces, faces);
+        QBVH32 qbvh;
+        qbvh.copyFrom(constructor);
+        EXPECT_TRUE(0u < qbvh.getNumNodes());
+        EXPECT_TRUE((NumFaces+3)/4 <= qbvh.getNumBlocks());
+
+        s32 numHits = 0;
+        bool same = true;
+        for(u32 i=0; i<NumWideRays; ++i){
+            lmath::Vector3 origin = lmath::Vector3::construct(frand(random, -80.0f, 80.0f), frand(random, 5.0f, 30.0f), frand(random, -80.0f, 80.0f));
+            lmath::Vector3 target = lmath::Vector3::construct(frand(random, -70.0f, 70.0f), 0.0f, frand(random, -70.0f, 70.0f));
+            lmath::Ray ray(origin, getDirection(origin, target), 1000.0f);
+
+            bool hit = false;
+            f32 t = ray.t_;
+            for(u32 j=0; j<NumFaces; ++j){
+                f32 ft, u, v;
+                if(lmath::testRayTriangleFront(ft, u, v, ray,
+                    vertices[faces[j].v0_].position_,
+                    vertices[faces[j].v1_].position_,
+                    vertices[faces[j].v2_].position_))
+                {
+                    if(0.0f<=ft && ft<=t){
+                        t = ft;
+                        hit = true;
+                    }
+                }
+            }
+
+            QBVH32::HitRecord hitRecord;
+            if(hit != qbvh.test(hitRecord, ray)){
+                same = false;
+                continue;
+            }
+            if(hit){
+                ++numHits;
+                same = same && lmath::isEqual(t, hitRecord.t_, 1.0e-4f) && hitRecord.face_<NumFaces;
+            }
+        }
+        EXPECT_TRUE(same);
+        EXPECT_TRUE(0 < numHits);
+
+        //葉だけの木
+        QBVH32Constructor small;
+        small.construct(NumVertices, vertices, 2, faces);
+        QBVH32 smallQBVH;
+        smallQBVH.copyFrom(small);
+        EXPECT_TRUE(0u == smallQBVH.getNumNodes());
+        EXPECT_TRUE(1u == smallQBVH.getNumBlocks());
+        lmath::Vector3 origin = lmath::Vector3::construct(-74.8f, 10.0f, -74.9f);
+        lmath::Ray ray(origin, lmath::Vector3::construct(0.0f, -1.0f, 0.0f), 100.0f);
+        QBVH32::HitRecord hitRecord;
+        EXPECT_TRUE(smallQBVH.test(hitRecord, ray));
+        EXPECT_TRUE(0u == hitRecord.face_);
+
+        LDELETE_ARRAY(faces);
+        LDELETE_ARRAY(vertices);
+    }
+
+    TEST_CASE("TestQBVH::Packet")
+    {
+        static const s32 NumPackets = 256;
+        Mesh mesh;
+        mesh.create(2468);
+        QBVHConstructor constructor;
+        constructor.setSplitMethod(QBVHConstructor::SplitMethod_BinnedSAH);
+        mesh.construct(constructor);
+        QBVH qbvh;
+        qbvh.copyFrom(constructor);
+
+        //半分は原点と向きのそろった束, 半分はばらばら
+        lcore::RandXorshift128Plus32 random(1357);
+        lmath::Ray* rays = LNEW lmath::Ray[NumPackets*8];
+        for(s32 i=0; i<NumPackets; ++i){
+            lmath::Vector3 origin = lmath::Vector3::construct(frand(random, -80.0f, 80.0f), frand(random, -10.0f, 40.0f), frand(random, -80.0f, 80.0f));
+            lmath::Vector3 target = lmath::Vector3::construct(frand(random, -60.0f, 60.0f), frand(random, -1.0f, 20.0f), frand(random, -60.0f, 60.0f));
+            for(s32 j=0; j<8; ++j){
+                lmath::Vector3 o = origin;
+                lmath::Vector3 t = target;
+                if(i&0x01){
+                    o = lmath::Vector3::construct(frand(random, -80.0f, 80.0f), frand(random, -10.0f, 40.0f), frand(random, -80.0f, 80.0f));
+                    t = lmath::Vector3::construct(frand(random, -60.0f, 60.0f), frand(random, -1.0f, 20.0f), frand(random, -60.0f, 60.0f));
+                }else{
+                    t += lmath::Vector3::construct(frand(random, -2.0f, 2.0f), frand(random, -2.0f, 2.0f), frand(random, -2.0f, 2.0f));
+                }
+                rays[i*8+j] = lmath::Ray(o, getDirection(o, t), (j&0x01)? 1000.0f : frand(random, 1.0f, 60.0f));
+            }
+        }
+
+        QBVH::HitRecord* single = LNEW QBVH::HitRecord[NumPackets*8];
+        bool* singleHit = LNEW bool[NumPackets*8];
+        s32 numHits = 0;
+        for(s32 i=0; i<NumPackets*8; ++i){
+            singleHit[i] = qbvh.test(single[i], rays[i]);
+            numHits += (singleHit[i])? 1 : 0;
+        }
+        EXPECT_TRUE(0 < numHits);
+
+        bool same4 = true;
+        bool same8 = true;
+        bool occlusion = true;
+        for(s32 i=0; i<NumPackets; ++i){
+            const lmath::Ray* packet = rays + i*8;
+            QBVH::HitRecord hitRecords[8];
+            s32 hit4 = qbvh.test4(hitRecords, packet) | (qbvh.test4(hitRecords+4, packet+4)<<4);
+            for(s32 j=0; j<8; ++j){
+                bool hit = 0 != ((hit4>>j)&0x01);
+                same4 = same4 && hit == singleHit[i*8+j] && (NULL != hitRecords[j].face_) == hit;
+                same4 = same4 && (!hit || lmath::isEqual(single[i*8+j].t_, hitRecords[j].t_, 1.0e-4f));
+            }
+
+            s32 hit8 = qbvh.test8(hitRecords, packet);
+            s32 occluded8 = qbvh.testOcclusion8(packet);
+            s32 occluded4 = qbvh.testOcclusion4(packet);
+            for(s32 j=0; j<8; ++j){
+                bool hit = 0 != ((hit8>>j)&0x01);
+                same8 = same8 && hit == singleHit[i*8+j];
+                same8 = same8 && (!hit || lmath::isEqual(single[i*8+j].t_, hitRecords[j].t_, 1.0e-4f));
+                occlusion = occlusion && (0 != ((occluded8>>j)&0x01)) == singleHit[i*8+j];
+                occlusion = occlusion && qbvh.testOcclusion(packet[j]) == singleHit[i*8+j];
+            }
+            occlusion = occlusion && occluded4 == (occluded8&0x0F);
+        }
+        EXPECT_TRUE(same4);
+        EXPECT_TRUE(same8);
+        EXPECT_TRUE(occlusion);
+
+        //流れは8分円で並べ替えても元の順で返る
+        QBVH::HitRecord* stream = LNEW QBVH::HitRecord[NumPackets*8];
+        bool* occluded = LNEW bool[NumPackets*8];
+        u32* work = LNEW u32[NumPackets*8];
+        EXPECT_TRUE(numHits == qbvh.testStream(NumPackets*8, stream, rays, work));
+        EXPECT_TRUE(numHits == qbvh.testOcclusionStream(NumPackets*8, occluded, rays, work));
+        bool sameStream = true;
+        for(s32 i=0; i<NumPackets*8; ++i){
+            sameStream = sameStream && (NULL != stream[i].face_) == singleHit[i] && occluded[i] == singleHit[i];
+            sameStream = sameStream && (!singleHit[i] || lmath::isEqual(single[i].t_, stream[i].t_, 1.0e-4f));
+        }
+        EXPECT_TRUE(sameStream);
+
+        LDELETE_ARRAY(work);
+        LDELETE_ARRAY(occluded);
+        LDELETE_ARRAY(stream);
+        LDELETE_ARRAY(singleHit);
+        LDELETE_ARRAY(single);
+        LDELETE_ARRAY(rays);
+    }
+
+    TEST_CASE("TestQBVH::OBVH")
+    {
+        Mesh reference;
+        reference.create(3579);
+
+        for(s32 method=QBVHConstructor::SplitMethod_Median; method<=QBVHConstructor::SplitMethod_BinnedSAH; ++method){
+            Mesh mesh;
+            mesh.create(3579);
+            QBVHConstructor constructor;
+            constructor.setSplitMethod(static_cast<QBVHConstructor::SplitMethod>(method));
+            mesh.construct(constructor);
+
+            //AVXがなければQBVHで判定する
+            OBVH obvh;
+            obvh.copyFrom(constructor);
+            EXPECT_TRUE(OBVH::isSupported() == obvh.isAVX());
+            if(obvh.isAVX()){
+                EXPECT_TRUE(0u < obvh.getNumNodes());
+                EXPECT_TRUE(obvh.getNumNodes() < constructor.getNumNodes());
+            }
+            OBVH fallback;
+            fallback.copyFrom(constructor, false);
+            EXPECT_FALSE(fallback.isAVX());
+
+            lcore::RandXorshift128Plus32 random(8642);
+            bool same = true;
+            s32 numHits = 0;
+            for(u32 i=0; i<NumRays; ++i){
+                lmath::Vector3 origin = lmath::Vector3::construct(frand(random, -80.0f, 80.0f), frand(random, -10.0f, 40.0f), frand(random, -80.0f, 80.0f));
+                lmath::Vector3 target = lmath::Vector3::construct(frand(random, -60.0f, 60.0f), frand(random, -1.0f, 20.0f), frand(random, -60.0f, 60.0f));
+                lmath::Ray ray(origin, getDirection(origin, target), (i&0x01)? 1000.0f : frand(random, 1.0f, 60.0f));
+
+                f32 t;
+                bool hit = bruteForce(t, reference, ray);
+                numHits += (hit)? 1 : 0;
+                OBVH::HitRecord hitRecord;
+                same = same && hit == obvh.test(hitRecord, ray) && (!hit || lmath::isEqual(t, hitRecord.t_, 1.0e-4f));
+                same = same && hit == fallback.test(hitRecord, ray) && (!hit || lmath::isEqual(t, hitRecord.t_, 1.0e-4f));
+                same = same && hit == obvh.testOcclusion(ray) && hit == fallback.testOcclusion(ray);
+            }
+            EXPECT_TRUE(0 < numHits);
+            EXPECT_TRUE(same);
+        }
+
+        //三角形が少なく根が葉
+        Mesh small;
+        small.create(3579);
+        small.numFaces_ = 3;
+        lmath::Vector3 origin = lmath::Vector3::construct(-62.0f, 10.0f, -62.0f);
+        lmath::Ray ray(origin, getDirection(origin, lmath::Vector3::construct(-62.5f, 0.0f, -61.0f)), 1000.0f);
+        f32 t;
+        bool hit = bruteForce(t, small, ray);
+        EXPECT_TRUE(hit);
+        QBVHConstructor constructor;
+        small.construct(constructor);
+        EXPECT_TRUE(0u == constructor.getNumNodes());
+        OBVH obvh;
+        obvh.copyFrom(constructor);
+        OBVH::HitRecord hitRecord;
+        EXPECT_TRUE(obvh.test(hitRecord, ray));
+        EXPECT_TRUE(lmath::isEqual(t, hitRecord.t_, 1.0e-4f));
+
+        LDELETE_ARRAY(reference.vertices_);
+        LDELETE_ARRAY(reference.faces_);
+    }
+
+    TEST_CASE("TestQBVH::Refit")
+    {
+        //並列に分ける段ができるように大きめにする
+        static const u32 NumLargeClusterFaces = 2500;
+        Mesh reference;
+        reference.create(5151, NumLargeClusterFaces);
+        Mesh mesh;
+        mesh.create(5151, NumLargeClusterFaces);
+        QBVHConstructor constructor;
+        constructor.setSplitMethod(QBVHConstructor::SplitMethod_BinnedSAH);
+        mesh.construct(constructor);
+
+        QBVH qbvh;
+        qbvh.copyFrom(constructor);
+        EXPECT_TRUE(lmath::isEqual(constructor.calcSAHCost(), qbvh.getBuildSAHCost(), 1.0e-3f));
+        EXPECT_FALSE(qbvh.isRebuildRequired());
+        QBVH parallel;
+        parallel.copyFrom(constructor);
+        EXPECT_TRUE(QBVH::RefitChunkNodes < parallel.getNumNodes());
+
+        lcore::ThreadPool threadPool(4, 16);
+        threadPool.start();
+
+        //地面を波打たせ, 塊を少しずつ動かす
+        lcore::RandXorshift128Plus32 random(2525);
+        QBVH::Vertex* vertices = LNEW QBVH::Vertex[reference.numVertices_];
+        for(u32 i=0; i<reference.numVertices_; ++i){
+            lmath::Vector3& position = reference.vertices_[i].position_;
+            if(i<33*33){
+                position.y_ += 2.0f*lmath::sinf(position.x_*0.1f);
+            }else{
+                position += lmath::Vector3::construct(frand(random, -0.1f, 0.1f), 3.0f, frand(random, -0.1f, 0.1f));
+            }
+            vertices[i].position_ = position;
+        }
+        qbvh.refit(vertices);
+        parallel.refit(threadPool, vertices);
+        EXPECT_FALSE(qbvh.isRebuildRequired());
+
+        bool same = true;
+        for(u32 i=0; i<qbvh.getNumNodes(); ++i){
+            same = same && 0 == lcore::memcmp(&qbvh.getNode(i), &parallel.getNode(i), sizeof(QBVH::Node));
+        }
+        EXPECT_TRUE(same);
+
+        lcore::RandXorshift128Plus32 rayRandom(4321);
+        bool hitSame = true;
+        for(u32 i=0; i<NumRays; ++i){
+            lmath::Vector3 origin = lmath::Vector3::construct(frand(rayRandom, -80.0f, 80.0f), frand(rayRandom, -10.0f, 40.0f), frand(rayRandom, -80.0f, 80.0f));
+            lmath::Vector3 target = lmath::Vector3::construct(frand(rayRandom, -60.0f, 60.0f), frand(rayRandom, -1.0f, 20.0f), frand(rayRandom, -60.0f, 60.0f));
+            lmath::Ray ray(origin, getDirection(origin, target), 1000.0f);
+
+            f32 t;
+            bool hit = bruteForce(t, reference, ray);
+            QBVH::HitRecord hitRecord;
+            hitSame = hitSame && hit == qbvh.test(hitRecord, ray) && (!hit || lmath::isEqual(t, hitRecord.t_, 1.0e-4f));
+        }
+        EXPECT_TRUE(hitSame);
+
+        //塊をばらばらにすると箱が大きく重なり, 作り直しが必要になる
+        for(u32 i=33*33; i<reference.numVertices_; i+=3){
+            lmath::Vector3 offset = lmath::Vector3::construct(frand(random, -50.0f, 50.0f), 0.0f, frand(random, -50.0f, 50.0f));
+            for(u32 j=0; j<3; ++j){
+                vertices[i+j].position_ += offset;
+            }
+        }
+        qbvh.refit(vertices);
+        EXPECT_TRUE(qbvh.isRebuildRequired());
+
+        LDELETE_ARRAY(vertices);
+        LDELETE_ARRAY(reference.vertices_);
+        LDELETE_ARRAY(reference.faces_);
+    }
+
+    TEST_CASE("TestQBVH::Compressed")
+    {
+        static const Char* Filename = "TestCompressedQBVH.bin";
+        static_assert(64 == sizeof(CompressedQBVH::Node), "CompressedQBVH::Node must fit a cache line");
+
+        Mesh mesh;
+        mesh.create(9753);
+        QBVHConstructor constructor;
+        constructor.setSplitMethod(QBVHConstructor::SplitMethod_BinnedSAH);
+        mesh.construct(constructor);
+        QBVH qbvh;
+        qbvh.copyFrom(constructor);
+        CompressedQBVH compressed;
+        compressed.copyFrom(constructor);
+        EXPECT_TRUE(constructor.getNumNodes() == compressed.getNumNodes());
+
+        //復号した箱は元の箱を含み, 刻み2つ分より広がらない
+        bool conservative = true;
+        bool tight = true;
+        for(u32 i=0; i<compressed.getNumNodes(); ++i){
+            const QBVHConstructor::Node& node = constructor.getNode(i);
+            lm128 bbox[2][3];
+            CompressedQBVH::decode(bbox, compressed.getNode(i));
+            LALIGN16 f32 decoded[2][3][4];
+            for(s32 j=0; j<3; ++j){
+                _mm_store_ps(decoded[0][j], bbox[0][j]);
+                _mm_store_ps(decoded[1][j], bbox[1][j]);
+            }
+            for(s32 j=0; j<3; ++j){
+                f32 bmin = lcore::numeric_limits<f32>::maximum();
+                f32 bmax = lcore::numeric_limits<f32>::lowest();
+                for(s32 k=0; k<4; ++k){
+                    if(!QBVHConstructor::Node::isEmpty(node.children_[k])){
+                        bmin = lcore::minimum(bmin, node.bbox_[0][j][k]);
+                        bmax = lcore::maximum(bmax, node.bbox_[1][j][k]);
+                    }
+                }
+                f32 slack = (bmax-bmin)*(4.0f/255.0f) + 1.0e-5f;
+                for(s32 k=0; k<4; ++k){
+                    if(QBVHConstructor::Node::isEmpty(node.children_[k])){
+                        conservative = conservative && decoded[1][j][k]<decoded[0][j][k];
+                        continue;
+                    }
+                    conservative = conservative && decoded[0][j][k]<=node.bbox_[0][j][k] && node.bbox_[1][j][k]<=decoded[1][j][k];
+                    tight = tight && (node.bbox_[0][j][k]-decoded[0][j][k])<=slack && (decoded[1][j][k]-node.bbox_[1][j][k])<=slack;
+                }
+            }
+        }
+        EXPECT_TRUE(conservative);
+        EXPECT_TRUE(tight);
+
+        //保存したイメージを読み込んでも, 揃えたメモリに置いて直接使っても同じ
+        EXPECT_TRUE(compressed.save(Filename));
+        CompressedQBVH loaded;
+        EXPECT_TRUE(loaded.load(Filename));
+        CHECK(compressed.getImageSize() == loaded.getImageSize());
+        EXPECT_TRUE(0 == lcore::memcmp(compressed.getImage(), loaded.getImage(), static_cast<u32>(compressed.getImageSize())));
+
+        s64 size = loaded.getImageSize();
+        u8* image = reinterpret_cast<u8*>(LALIGNED_MALLOC(static_cast<u32>(size)+CompressedQBVH::Alignment, CompressedQBVH::Alignment));
+        lcore::File file;
+        CHECK(file.open(Filename, lcore::ios::in));
+        CHECK(file.read(size, image));
+        file.close();
+        CompressedQBVH attached;
+        EXPECT_TRUE(attached.attach(image, size));
+        EXPECT_FALSE(attached.attach(image, size-1));
+
+        lcore::RandXorshift128Plus32 random(3141);
+        bool same = true;
+        s32 numHits = 0;
+        for(u32 i=0; i<NumRays; ++i){
+            lmath::Vector3 origin = lmath::Vector3::construct(frand(random, -80.0f, 80.0f), frand(random, -10.0f, 40.0f), frand(random, -80.0f, 80.0f));
+            lmath::Vector3 target = lmath::Vector3::construct(frand(random, -60.0f, 60.0f), frand(random, -1.0f, 20.0f), frand(random, -60.0f, 60.0f));
+            lmath::Ray ray(origin, getDirection(origin, target), 1000.0f);
+
+            QBVH::HitRecord expected;
+            bool hit = qbvh.test(expected, ray);
+            numHits += (hit)? 1 : 0;
+            CompressedQBVH::HitRecord hitRecord;
+            same = same && hit == compressed.test(hitRecord, ray) && (!hit || expected.t_ == hitRecord.t_);
+            same = same && hit == loaded.test(hitRecord, ray) && (!hit || expected.t_ == hitRecord.t_);
+            attached.attach(image, size);
+            same = same && hit == attached.test(hitRecord, ray) && (!hit || expected.t_ == hitRecord.t_);
+        }
+        EXPECT_TRUE(0 < numHits);
+        EXPECT_TRUE(same);
+
+        //揃っていない, 壊れたイメージは使わない
+        lcore::memmove(image+4, image, static_cast<u32>(size));
+        EXPECT_FALSE(attached.attach(image+4, size));
+        image[0] ^= 0xFFU;
+        EXPECT_FALSE(attached.attach(image, size));
+
+        LALIGNED_FREE(image, CompressedQBVH::Alignment);
+        ::remove(Filename);
+    }
+
+    TEST_CASE("TestQBVH::Sphere")
+    {
+        static const s32 NumQueries = 500;
+        static const s32 MaxFaces = 4096;
+        Mesh reference;
+        reference.create(2718);
+        Mesh mesh;
+        mesh.create(2718);
+        QBVHConstructor constructor;
+        constructor.setSplitMethod(QBVHConstructor::SplitMethod_BinnedSAH);
+        mesh.construct(constructor);
+        QBVH qbvh;
+        qbvh.copyFrom(constructor);
+
+        lcore::RandXorshift128Plus32 random(1414);
+        lmath::Sphere* spheres = LNEW lmath::Sphere[NumQueries];
+        lmath::Vector3* directions = LNEW lmath::Vector3[NumQueries];
+        f32* distances = LNEW f32[NumQueries];
+        for(s32 i=0; i<NumQueries; ++i){
+            lmath::Vector3 center = lmath::Vector3::construct(frand(random, -70.0f, 70.0f), frand(random, -5.0f, 25.0f), frand(random, -70.0f, 70.0f));
+            spheres[i] = lmath::Sphere(center, frand(random, 0.1f, 4.0f));
+            lmath::Vector3 target = lmath::Vector3::construct(frand(random, -60.0f, 60.0f), frand(random, -1.0f, 20.0f), frand(random, -60.0f, 60.0f));
+            directions[i] = getDirection(center, target);
+            distances[i] = frand(random, 1.0f, 100.0f);
+        }
+
+        //重なる三角形の数は総当りと同じ
+        const QBVH::Face** faces = LNEW const QBVH::Face*[NumQueries*MaxFaces];
+        s32* counts = LNEW s32[NumQueries];
+        bool same = true;
+        s32 total = 0;
+        for(s32 i=0; i<NumQueries; ++i){
+            const lmath::Sphere& sphere = spheres[i];
+            s32 expected = 0;
+            lmath::Vector3 closest;
+            for(u32 j=0; j<reference.numFaces_; ++j){
+                const QBVHConstructor::Face& face = reference.faces_[j];
+                if(lmath::closestPointPointTriangle(closest, sphere.position(),
+                    reference.vertices_[face.v0_].position_,
+                    reference.vertices_[face.v1_].position_,
+                    reference.vertices_[face.v2_].position_) <= sphere.radius()*sphere.radius())
+                {
+                    ++expected;
+                }
+            }
+            s32 count = qbvh.testSphere(MaxFaces, faces, sphere);
+            same = same && expected == count;
+            total += count;
+        }
+        EXPECT_TRUE(same);
+        EXPECT_TRUE(0 < total);
+
+        //maxFacesを越えた分は数えるだけで書かない
+        lmath::Sphere large(lmath::Vector3::construct(0.0f, 0.0f, 0.0f), 10.0f);
+        s32 numLarge = qbvh.testSphere(MaxFaces, faces, large);
+        faces[1] = NULL;
+        EXPECT_TRUE(1 < numLarge);
+        EXPECT_TRUE(numLarge == qbvh.testSphere(1, faces, large));
+        EXPECT_TRUE(NULL == faces[1]);
+
+        //最近傍の距離は総当りと同じ
+        same = true;
+        s32 numFound = 0;
+        for(s32 i=0; i<NumQueries; ++i){
+            const lmath::Vector3& point = spheres[i].position();
+            f32 expected = bruteForceNearest(reference, point, 10.0f);
+            QBVH::NearestRecord record;
+            bool found = qbvh.findNearest(record, point, 10.0f);
+            same = same && found == (expected<10.0f);
+            if(found){
+                ++numFound;
+                same = same && lmath::isEqual(expected, record.distance_, 1.0e-4f);
+                same = same && lmath::isEqual(record.distance_, lmath::distance(point, record.point_), 1.0e-4f);
+            }
+        }
+        EXPECT_TRUE(same);
+        EXPECT_TRUE(0 < numFound);
+
+        //掃引は総当りと同じ. 接触した位置で球が接し, 少し手前では離れている
+        same = true;
+        s32 numSwept = 0;
+        for(s32 i=0; i<NumQueries; ++i){
+            const lmath::Sphere& sphere = spheres[i];
+            f32 expected = distances[i];
+            bool hit = false;
+            for(u32 j=0; j<reference.numFaces_; ++j){
+                const QBVHConstructor::Face& face = reference.faces_[j];
+                f32 t;
+                lmath::Vector3 contact;
+                if(lmath::testSweptSphereTriangle(t, contact, sphere, directions[i], expected,
+                    reference.vertices_[face.v0_].position_,
+                    reference.vertices_[face.v1_].position_,
+                    reference.vertices_[face.v2_].position_))
+                {
+                    expected = t;
+                    hit = true;
+                }
+            }
+            QBVH::SweepRecord record;
+            same = same && hit == qbvh.testSweptSphere(record, sphere, directions[i], distances[i]);
+            if(!hit){
+                continue;
+            }
+            ++numSwept;
+            same = same && lmath::isEqual(expected, record.t_, 1.0e-3f);
+            lmath::Vector3 center = sphere.position() + record.t_*directions[i];
+            if(0.0f<record.t_){
+                same = same && lmath::isEqual(sphere.radius(), bruteForceNearest(reference, center, 100.0f), 1.0e-3f);
+                lmath::Vector3 before = sphere.position() + lcore::maximum(record.t_-0.01f, 0.0f)*directions[i];
+                same = same && (sphere.radius() - 1.0e-3f) <= bruteForceNearest(reference, before, 100.0f);
+            }
+            same = same && lmath::isEqual(1.0f, lmath::dot(record.normal_, record.normal_), 1.0e-4f);
+        }
+        EXPECT_TRUE(same);
+        EXPECT_TRUE(0 < numSwept);
+
+        //まとめた問い合わせは1つずつと同じ
+        lcore::ThreadPool threadPool(4, 16);
+        threadPool.start();
+        QBVH::SweepRecord* sweepRecords = LNEW QBVH::SweepRecord[NumQueries];
+        QBVH::NearestRecord* nearestRecords = LNEW QBVH::NearestRecord[NumQueries];
+        lmath::Vector3* points = LNEW lmath::Vector3[NumQueries];
+        for(s32 i=0; i<NumQueries; ++i){
+            points[i] = spheres[i].position();
+        }
+        for(s32 k=0; k<2; ++k){
+            lcore::ThreadPool* pool = (0==k)? NULL : &threadPool;
+            EXPECT_TRUE(total == qbvh.testSphere(NumQueries, counts, MaxFaces, faces, spheres, pool));
+            EXPECT_TRUE(numFound == qbvh.findNearest(NumQueries, nearestRecords, points, 10.0f, pool));
+            EXPECT_TRUE(numSwept == qbvh.testSweptSphere(NumQueries, sweepRecords, spheres, directions, distances, pool));
+
+            same = true;
+            for(s32 i=0; i<NumQueries; ++i){
+                const QBVH::Face* sphereFaces[MaxFaces];
+                s32 count = qbvh.testSphere(MaxFaces, sphereFaces, spheres[i]);
+                same = same && count == counts[i] && 0 == lcore::memcmp(sphereFaces, faces + i*MaxFaces, sizeof(const QBVH::Face*)*lcore::minimum(count, MaxFaces));
+
+                QBVH::NearestRecord nearest;
+                qbvh.findNearest(nearest, points[i], 10.0f);
+                same = same && nearest.face_ == nearestRecords[i].face_ && (NULL == nearest.face_ || nearest.distance_ == nearestRecords[i].distance_);
+
+                QBVH::SweepRecord sweep;
+                qbvh.testSweptSphere(sweep, spheres[i], directions[i], distances[i]);
+                same = same && sweep.face_ == sweepRecords[i].face_ && (NULL == sweep.face_ || sweep.t_ == sweepRecords[i].t_);
+            }
+            EXPECT_TRUE(same);
+        }
+
+        LDELETE_ARRAY(points);
+        LDELETE_ARRAY(nearestRecords);
+        LDELETE_ARRAY(sweepRecords);
+        LDELETE_ARRAY(counts);
+        LDELETE_ARRAY(faces);
+        LDELETE_ARRAY(distances);
+        LDELETE_ARRAY(directions);
+        LDELETE_ARRAY(spheres);
+        LDELETE_ARRAY(reference.vertices_);
+        LDELETE_ARRAY(reference.faces_);
+    }
+}